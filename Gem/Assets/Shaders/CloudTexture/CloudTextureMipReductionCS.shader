@@ -0,0 +1,16 @@
+{
+  "Source": "CloudTextureMipReductionCS.azsl",
+  "AddBuildArguments": {
+    "debug": true
+  },
+  "ProgramSettings":
+  {
+    "EntryPoints":
+    [
+      {
+        "name": "MainCS",
+        "type": "Compute"
+      }
+    ]
+  }
+}
@@ -17,7 +17,7 @@
     },
 
     "GlobalTargetBlendState" : {
-      "Enable" : true
+      "Enable" : false
     },
 
     "ProgramSettings":
@@ -7,9 +7,11 @@
 #pragma once
 
 #include <VolumetricClouds/VolumetricCloudsTypeIds.h>
+#include <VolumetricClouds/CloudTextureStats.h>
 
 #include <AzCore/EBus/EBus.h>
 #include <AzCore/Interface/Interface.h>
+#include <AzCore/std/smart_ptr/shared_ptr.h>
 
 #include <Atom/RPI.Reflect/Image/Image.h>
 #include <AtomCore/Instance/Instance.h>
@@ -25,6 +27,11 @@ namespace VolumetricClouds
 
         // The returned image must be a 3D Texture.
         virtual AZ::Data::Instance<AZ::RPI::Image> GetCloudTextureImage() = 0;
+
+        // Per channel, per mip level, stats of the image returned by GetCloudTextureImage().
+        // Returns null if the stats are not known, e.g. the texture comes from a StreamingImageAsset,
+        // or it was computed on the GPU without readback.
+        virtual AZStd::shared_ptr<const CloudTextureStats> GetCloudTextureStats() { return nullptr; }
     };
 
     class CloudTextureProviderRequestBusTraits
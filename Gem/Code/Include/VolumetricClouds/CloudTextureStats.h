@@ -0,0 +1,53 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+#pragma once
+
+#include <AzCore/base.h>
+#include <AzCore/std/containers/array.h>
+#include <AzCore/std/containers/vector.h>
+
+namespace VolumetricClouds
+{
+    // Statistics of one channel of one mip level of a cloud noise Texture3D.
+    // All values are normalized, between 0 and 1, whatever the pixel format is.
+    struct CloudTextureChannelStats
+    {
+        // The bin i counts the values that round to i / 255, so with 8 bits per channel
+        // there's one bin per code value.
+        static constexpr uint32_t HistogramBinCount = 256;
+
+        float m_min = 0.0f;
+        float m_max = 0.0f;
+        float m_mean = 0.0f;
+        AZStd::array<uint32_t, HistogramBinCount> m_histogram = {};
+    };
+
+    struct CloudTextureMipStats
+    {
+        static constexpr uint32_t MaxChannelCount = 4;
+
+        uint16_t m_mipSlice = 0;
+        // Only the first CloudTextureStats::m_channelCount channels are valid.
+        AZStd::array<CloudTextureChannelStats, MaxChannelCount> m_channels;
+    };
+
+    // Per channel, per mip level, statistics of a cloud noise Texture3D, as stored.
+    // When the channels were renormalized to the full range, @m_sourceRangeMin and @m_sourceRangeMax
+    // keep the range of each channel before the remap, so the original value of a texel is:
+    //     sourceRangeMin + value * (sourceRangeMax - sourceRangeMin)
+    struct CloudTextureStats
+    {
+        uint32_t m_channelCount = 0;
+        bool m_normalized = false;
+        AZStd::array<float, CloudTextureMipStats::MaxChannelCount> m_sourceRangeMin = { 0.0f, 0.0f, 0.0f, 0.0f };
+        AZStd::array<float, CloudTextureMipStats::MaxChannelCount> m_sourceRangeMax = { 1.0f, 1.0f, 1.0f, 1.0f };
+        AZStd::vector<CloudTextureMipStats> m_mipLevels;
+
+        bool IsValid() const { return (m_channelCount > 0) && !m_mipLevels.empty(); }
+    };
+
+} // namespace VolumetricClouds
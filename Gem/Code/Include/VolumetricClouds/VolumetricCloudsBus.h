@@ -62,6 +62,10 @@ namespace VolumetricClouds
         // Cloud Material Properties 
         virtual const CloudMaterialProperties& GetCloudMaterialProperties() = 0;
         virtual void SetCloudMaterialProperties(const CloudMaterialProperties& cmp) = 0;
+        // Stats
+        // Tiles of the screen ray marched in a recent frame, and the total number of tiles. The tiles where
+        // no ray can find clouds are skipped. Read back from the GPU every few frames, both are 0 until then.
+        virtual AZStd::tuple<uint32_t, uint32_t> GetRayMarchTileCounts() = 0;
 
         // Submits the current state of the parameters to the renderer.
         virtual void EndCallBatch() = 0;
@@ -1,4 +1,4 @@
 
 set(PAL_TRAIT_VOLUMETRICCLOUDS_SUPPORTED TRUE)
-set(PAL_TRAIT_VOLUMETRICCLOUDS_TEST_SUPPORTED FALSE)
+set(PAL_TRAIT_VOLUMETRICCLOUDS_TEST_SUPPORTED TRUE)
 set(PAL_TRAIT_VOLUMETRICCLOUDS_EDITOR_TEST_SUPPORTED FALSE)
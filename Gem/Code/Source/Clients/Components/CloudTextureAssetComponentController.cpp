@@ -6,12 +6,18 @@
 */
 
 #include <AzCore/Asset/AssetSerializer.h>
+#include <AzCore/IO/FileIO.h>
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/Jobs/JobFunction.h>
 #include <AzCore/Serialization/SerializeContext.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
 
 #include <Atom/RPI.Public/Scene.h>
 #include <Atom/RPI.Public/RPIUtils.h>
 
+#include <Renderer/CloudTexturesComputeFeatureProcessor.h>
 #include <Renderer/CloudTexturesDebugViewerFeatureProcessor.h>
+#include <Renderer/CloudVolumeFile.h>
 #include "CloudTextureAssetComponentController.h"
 
 namespace VolumetricClouds
@@ -21,8 +27,9 @@ namespace VolumetricClouds
             if (auto serializeContext = azrtti_cast<AZ::SerializeContext*>(context))
             {
                 serializeContext->Class<CloudTextureAssetComponentConfig, AZ::ComponentConfig>()
-                    ->Version(1)
+                    ->Version(2)
                     ->Field("CloudTextureAsset", &CloudTextureAssetComponentConfig::m_cloudTextureAsset)
+                    ->Field("CloudVolumeFilePath", &CloudTextureAssetComponentConfig::m_cloudVolumeFilePath)
                     ->Field("PresentationData", &CloudTextureAssetComponentConfig::m_presentationData)
                     ;
 
@@ -34,6 +41,8 @@ namespace VolumetricClouds
                         ->Attribute(AZ::Edit::Attributes::AutoExpand, true)
                         ->Attribute(AZ::Edit::Attributes::Visibility, AZ::Edit::PropertyVisibility::Show)
                         ->DataElement(AZ::Edit::UIHandlers::Default, &CloudTextureAssetComponentConfig::m_cloudTextureAsset, "3D Texture Asset", "")
+                        ->DataElement(AZ::Edit::UIHandlers::Default, &CloudTextureAssetComponentConfig::m_cloudVolumeFilePath, "Cloud Volume File",
+                            "Optional path, or alias like @projectroot@, of a .cloudvol file. When set, the texture is loaded from this file instead of the asset.")
                         ->DataElement(AZ::Edit::UIHandlers::Default, &CloudTextureAssetComponentConfig::m_presentationData, "Presentation", "")
                         ;
                 }
@@ -90,6 +99,12 @@ namespace VolumetricClouds
             AZ::TransformNotificationBus::Handler::BusConnect(entityId);
             CloudTextureProviderRequestBus::Handler::BusConnect(entityId);
 
+            if (!m_configuration.m_cloudVolumeFilePath.empty())
+            {
+                LoadCloudVolumeFile();
+                return;
+            }
+
             auto textureAssetId = m_configuration.m_cloudTextureAsset.GetId();
             if (textureAssetId.IsValid())
             {
@@ -100,6 +115,7 @@ namespace VolumetricClouds
 
         void CloudTextureAssetComponentController::Deactivate()
         {
+            m_cloudVolumeLoadToken.reset();
             AZ::Data::AssetBus::Handler::BusDisconnect();
             CloudTextureProviderRequestBus::Handler::BusDisconnect();
             AZ::TransformNotificationBus::Handler::BusDisconnect();
@@ -181,21 +197,87 @@ namespace VolumetricClouds
                 m_configuration.m_cloudTextureAsset = asset;
                 auto updateTexture = [this]()
                 {
-                    m_cloudTextureImage = AZ::RPI::StreamingImage::FindOrCreate(m_configuration.m_cloudTextureAsset);
+                    SetCloudTextureImage(AZ::RPI::StreamingImage::FindOrCreate(m_configuration.m_cloudTextureAsset), nullptr);
+                };
+                AZ::TickBus::QueueFunction(AZStd::move(updateTexture));
+            } 
+        }
+
+        void CloudTextureAssetComponentController::SetCloudTextureImage(AZ::Data::Instance<AZ::RPI::StreamingImage> image,
+            AZStd::shared_ptr<const CloudTextureStats> stats)
+        {
+            m_cloudTextureImage = image;
+            m_cloudTextureStats = stats;
 
-                    CloudTextureProviderNotificationBus::Event(m_entityId, &CloudTextureProviderNotificationBus::Handler::OnCloudTextureImageReady, m_cloudTextureImage);
+            CloudTextureProviderNotificationBus::Event(m_entityId, &CloudTextureProviderNotificationBus::Handler::OnCloudTextureImageReady, m_cloudTextureImage);
+
+            if (!m_configuration.m_presentationData.IsHidden() && !m_debugViewerFeatureProcessor)
+            {
+                AZ::Transform transform = AZ::Transform::CreateIdentity();
+                AZ::TransformBus::EventResult(transform, m_entityId, &AZ::TransformBus::Events::GetWorldTM);
+                auto debugViewerProcessor = GetDebugViewerFeatureProcessor();
+                debugViewerProcessor->AddCloudTextureInstance(m_entityId, m_cloudTextureImage, transform, m_configuration.m_presentationData);
+            }
+        }
+
+        void CloudTextureAssetComponentController::LoadCloudVolumeFile()
+        {
+            AZ::IO::FixedMaxPath filePath;
+            auto fileIO = AZ::IO::FileIOBase::GetInstance();
+            if (!fileIO || !fileIO->ResolvePath(filePath, m_configuration.m_cloudVolumeFilePath.c_str()))
+            {
+                AZ_Error(LogName, false, "Failed to resolve the path of the cloud volume file: %s", m_configuration.m_cloudVolumeFilePath.c_str());
+                return;
+            }
+
+            m_cloudVolumeLoadToken = AZStd::make_shared<int>(0);
+            AZStd::weak_ptr<int> loadToken = m_cloudVolumeLoadToken;
+            auto loadFunction = [this, loadToken, filePath = AZ::IO::Path(filePath.Native())]()
+            {
+                // The bricks are decompressed by other jobs, straight into the mip buffers.
+                auto mipLevels = AZStd::make_shared<AZStd::vector<CloudTextureMipData>>();
+                CloudVolumeFileReader reader;
+                if (!reader.Open(filePath) || !reader.LoadMipChain(*mipLevels))
+                {
+                    AZ_Error(LogName, false, "Failed to load the cloud volume file: %s", filePath.c_str());
+                    return;
+                }
+                AZ_Info(LogName, "Loaded the cloud volume file: %s", filePath.c_str());
 
-                    if (!m_configuration.m_presentationData.IsHidden() && !m_debugViewerFeatureProcessor)
+                // Files written before the stats were added to the format have none.
+                AZStd::shared_ptr<CloudTextureStats> stats;
+                if (reader.HasStats())
+                {
+                    stats = AZStd::make_shared<CloudTextureStats>();
+                    if (!reader.GetStats(*stats))
                     {
-                        AZ::Transform transform = AZ::Transform::CreateIdentity();
-                        AZ::TransformBus::EventResult(transform, m_entityId, &AZ::TransformBus::Events::GetWorldTM);
-                        auto debugViewerProcessor = GetDebugViewerFeatureProcessor();
-                        debugViewerProcessor->AddCloudTextureInstance(m_entityId, m_cloudTextureImage, transform, m_configuration.m_presentationData);
+                        stats.reset();
                     }
+                }
 
-                };
-                AZ::TickBus::QueueFunction(AZStd::move(updateTexture));
-            } 
+                const AZ::RHI::Format format = reader.GetFormat();
+                AZ::TickBus::QueueFunction([this, loadToken, mipLevels, format, stats]()
+                    {
+                        if (loadToken.expired())
+                        {
+                            return;
+                        }
+                        auto image = CloudTexturesComputeFeatureProcessor::CreateTexture3DFromMipChain(*mipLevels, format);
+                        if (image)
+                        {
+                            SetCloudTextureImage(image, stats);
+                        }
+                    });
+            };
+
+            if (AZ::JobContext::GetGlobalContext())
+            {
+                AZ::CreateJobFunction(AZStd::move(loadFunction), true)->Start();
+            }
+            else
+            {
+                loadFunction();
+            }
         }
 
         ////////////////////////////////////////////////////////////////////////
@@ -230,6 +312,11 @@ namespace VolumetricClouds
         {
             return m_cloudTextureImage;
         }
+
+        AZStd::shared_ptr<const CloudTextureStats> CloudTextureAssetComponentController::GetCloudTextureStats()
+        {
+            return m_cloudTextureStats;
+        }
         /////////////////////////////////////////////////////////
 
 } // namespace VolumetricClouds
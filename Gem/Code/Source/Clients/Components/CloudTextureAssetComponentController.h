@@ -37,6 +37,10 @@ namespace VolumetricClouds
 
         AZ::Data::Asset<AZ::RPI::StreamingImageAsset> m_cloudTextureAsset;
 
+        // Optional path, or alias, of a .cloudvol file. When not empty, the texture
+        // is loaded from this file instead of @m_cloudTextureAsset.
+        AZStd::string m_cloudVolumeFilePath;
+
         // How to Debug render the Texture3D in the scene.
         CloudTexturePresentationData m_presentationData;
 
@@ -68,6 +72,7 @@ namespace VolumetricClouds
         /////////////////////////////////////////////////////////
         // CloudTextureProviderRequestBus::Handler overrides ....
         AZ::Data::Instance<AZ::RPI::Image> GetCloudTextureImage() override;
+        AZStd::shared_ptr<const CloudTextureStats> GetCloudTextureStats() override;
         /////////////////////////////////////////////////////////
 
     private:
@@ -85,6 +90,12 @@ namespace VolumetricClouds
 
         void OnConfigurationChanged();
 
+        // Decompresses the .cloudvol file from a job, the texture is created on the main thread once it is done.
+        void LoadCloudVolumeFile();
+        // Common functionality for textures that come from the asset or from a .cloudvol file.
+        // @stats is null for assets, which don't carry stats.
+        void SetCloudTextureImage(AZ::Data::Instance<AZ::RPI::StreamingImage> image, AZStd::shared_ptr<const CloudTextureStats> stats);
+
         CloudTexturesDebugViewerFeatureProcessor* GetDebugViewerFeatureProcessor();
     
         AZ::EntityId m_entityId;
@@ -95,6 +106,11 @@ namespace VolumetricClouds
         CloudTexturesDebugViewerFeatureProcessor* m_debugViewerFeatureProcessor = nullptr;
 
         AZ::Data::Instance<AZ::RPI::StreamingImage> m_cloudTextureImage;
+        AZStd::shared_ptr<const CloudTextureStats> m_cloudTextureStats;
+
+        // Reset on Deactivate(), so a .cloudvol file that finishes loading after
+        // the component is deactivated is discarded.
+        AZStd::shared_ptr<int> m_cloudVolumeLoadToken;
     };
 
 } // namespace VolumetricClouds
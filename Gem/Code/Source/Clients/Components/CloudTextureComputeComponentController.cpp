@@ -94,9 +94,15 @@ namespace VolumetricClouds
         CloudTextureProviderRequestBus::Handler::BusConnect(entityId);
     
         m_textureReadyEventHandler = CloudTexturesComputeFeatureProcessor::TextureReadyEvent::Handler(
-            [this](AZ::Data::Instance<AZ::RPI::Image> image)
+            [this](AZ::Data::Instance<AZ::RPI::Image> image, AZStd::shared_ptr<const CloudTextureStats> stats)
             {
+                if (!image)
+                {
+                    // The texture could not be generated, keep the previous one.
+                    return;
+                }
                 m_cloudTextureImage = image;
+                m_cloudTextureStats = stats;
                 // Enqueue on the TickBus a notification that this texture is ready.
                 auto notifyTextureReadyFn = [entityId = m_entityId, image = m_cloudTextureImage]()
                 {
@@ -129,6 +135,14 @@ namespace VolumetricClouds
         {
             m_debugViewerFeatureProcessor->RemoveCloudTextureInstance(m_entityId);
         }
+
+        if (m_computeFeatureProcessor)
+        {
+            m_computeFeatureProcessor->ReleaseTexture(m_entityId);
+        }
+        // The attachment image goes back to the pool only when nobody references it.
+        m_cloudTextureImage = nullptr;
+        m_cloudTextureStats = nullptr;
         
         CloudTextureProviderRequestBus::Handler::BusDisconnect(m_entityId);
         m_entityId = AZ::EntityId(AZ::EntityId::InvalidEntityId);
@@ -241,6 +255,11 @@ namespace VolumetricClouds
     {
         return m_cloudTextureImage;
     }
+
+    AZStd::shared_ptr<const CloudTextureStats> CloudTextureComputeComponentController::GetCloudTextureStats()
+    {
+        return m_cloudTextureStats;
+    }
     /////////////////////////////////////////////////////////
 
 
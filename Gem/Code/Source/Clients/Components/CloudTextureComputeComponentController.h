@@ -69,6 +69,7 @@ namespace VolumetricClouds
         /////////////////////////////////////////////////////////
         // CloudTextureProviderRequestBus::Handler overrides ....
         AZ::Data::Instance<AZ::RPI::Image> GetCloudTextureImage() override;
+        AZStd::shared_ptr<const CloudTextureStats> GetCloudTextureStats() override;
         /////////////////////////////////////////////////////////
 
     private:
@@ -97,6 +98,8 @@ namespace VolumetricClouds
         // Generated by the CloudTexturesComputeFeatureProcessor and we keep a reference
         // to it.
         AZ::Data::Instance<AZ::RPI::Image> m_cloudTextureImage;
+        // Only available when the texture was read back or loaded from the on-disk cache.
+        AZStd::shared_ptr<const CloudTextureStats> m_cloudTextureStats;
     };
 
 } // namespace VolumetricClouds
@@ -6,7 +6,12 @@
 */
 
 #include <AzCore/Asset/AssetSerializer.h>
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/Jobs/JobFunction.h>
 #include <AzCore/Serialization/SerializeContext.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+
+#include <cmath>
 
 #include <Atom/RPI.Public/Scene.h>
 #include <Atom/RPI.Public/RPIUtils.h>
@@ -14,6 +19,8 @@
 #include <Atom/RPI.Public/ViewportContext.h>
 
 #include <Renderer/CloudscapeFeatureProcessor.h>
+#include <Renderer/CloudTexturesComputeFeatureProcessor.h>
+#include <Renderer/Cpu/WeatherMapPyramid.h>
 #include "CloudscapeComponentController.h"
 
 namespace VolumetricClouds
@@ -123,6 +130,8 @@ namespace VolumetricClouds
                     // Cloud Material Properties
                     ->Event("GetCloudMaterialProperties", &VolumetricCloudsRequestBus::Events::GetCloudMaterialProperties)
                     ->Event("SetCloudMaterialProperties", &VolumetricCloudsRequestBus::Events::SetCloudMaterialProperties)
+                    // Stats
+                    ->Event("GetRayMarchTileCounts", &VolumetricCloudsRequestBus::Events::GetRayMarchTileCounts)
                     ;
             }
         }
@@ -209,6 +218,7 @@ namespace VolumetricClouds
                 return;
             }
 
+            m_weatherMapPyramidToken.reset();
             VolumetricCloudsRequestBus::Handler::BusDisconnect();
             AZ::RPI::ViewportContextIdNotificationBus::Handler::BusDisconnect();
             m_directionalLightConfigChangedEventHandler.Disconnect();
@@ -258,6 +268,9 @@ namespace VolumetricClouds
                 {
                     m_configuration.m_shaderConstantData.m_weatherMap.reset();
                 }
+                m_weatherMapPyramidToken.reset();
+                m_configuration.m_shaderConstantData.m_weatherMapPyramid.reset();
+                m_configuration.m_shaderConstantData.m_weatherMapPyramidLevels = 0;
                 AZ::Data::AssetBus::Handler::BusConnect(weatherMapAssetId);
                 m_configuration.m_weatherMap.QueueLoad();
             }
@@ -398,6 +411,7 @@ namespace VolumetricClouds
                     }
                 };
                 AZ::TickBus::QueueFunction(AZStd::move(updateTexture));
+                BuildWeatherMapPyramid();
             } 
             //else if (m_shaderAsset.GetId() == asset.GetId())
             //{
@@ -411,6 +425,68 @@ namespace VolumetricClouds
             //}
         }
 
+        void CloudscapeComponentController::BuildWeatherMapPyramid()
+        {
+            m_weatherMapPyramidToken = AZStd::make_shared<int>(0);
+            AZStd::weak_ptr<int> buildToken = m_weatherMapPyramidToken;
+            AZ::Data::Asset<AZ::RPI::StreamingImageAsset> weatherMapAsset = m_configuration.m_weatherMap;
+            auto buildFunction = [this, buildToken, weatherMapAsset]()
+            {
+                const AZ::RHI::Size imageSize = weatherMapAsset->GetImageDescriptor().m_size;
+                const uint32_t width = imageSize.m_width;
+                const uint32_t height = imageSize.m_height;
+                AZStd::vector<uint8_t> pixels(static_cast<size_t>(width) * height * WeatherMapPyramid::BytesPerPixel, 0);
+                for (uint32_t channel = 0; channel < WeatherMapPyramid::BytesPerPixel; channel++)
+                {
+                    // Rounding up keeps the bound conservative, and zero stays zero.
+                    const bool success = AZ::RPI::GetSubImagePixelValues<float>(weatherMapAsset, { 0, 0 }, { width, height },
+                        [&pixels, width, channel](const AZ::u32& x, const AZ::u32& y, const float& value)
+                        {
+                            const float code = AZStd::clamp(std::ceil(value * 255.0f), 0.0f, 255.0f);
+                            pixels[(static_cast<size_t>(y) * width + x) * WeatherMapPyramid::BytesPerPixel + channel] = static_cast<uint8_t>(code);
+                        }, channel);
+                    if (!success)
+                    {
+                        AZ_Warning(LogName, false, "Failed to read the pixels of the weather map %s. Empty space won't be skipped.",
+                            weatherMapAsset.GetHint().c_str());
+                        return;
+                    }
+                }
+
+                auto pyramid = AZStd::make_shared<WeatherMapPyramid>();
+                if (!pyramid->Build(pixels.data(), width, height))
+                {
+                    return;
+                }
+
+                AZ::TickBus::QueueFunction([this, buildToken, pyramid]()
+                    {
+                        if (buildToken.expired() || !m_cloudscapeFeatureProcessor)
+                        {
+                            return;
+                        }
+                        const auto& levels = pyramid->GetLevels();
+                        auto image = CloudTexturesComputeFeatureProcessor::CreateTexture2DFromMipChain(levels, AZ::RHI::Format::R8G8B8A8_UNORM);
+                        if (!image)
+                        {
+                            return;
+                        }
+                        m_configuration.m_shaderConstantData.m_weatherMapPyramid = image;
+                        m_configuration.m_shaderConstantData.m_weatherMapPyramidLevels = static_cast<uint32_t>(levels.size());
+                        m_cloudscapeFeatureProcessor->UpdateShaderConstantData(m_configuration.m_shaderConstantData);
+                    });
+            };
+
+            if (AZ::JobContext::GetGlobalContext())
+            {
+                AZ::CreateJobFunction(AZStd::move(buildFunction), true)->Start();
+            }
+            else
+            {
+                buildFunction();
+            }
+        }
+
         ////////////////////////////////////////////////////////////////////////
         //! Data::AssetBus START
         void CloudscapeComponentController::OnAssetReady(AZ::Data::Asset<AZ::Data::AssetData> asset)
@@ -669,6 +745,17 @@ namespace VolumetricClouds
             SubmitShaderConstantData();
         }
 
+        AZStd::tuple<uint32_t, uint32_t> CloudscapeComponentController::GetRayMarchTileCounts()
+        {
+            uint32_t liveTileCount = 0;
+            uint32_t totalTileCount = 0;
+            if (m_cloudscapeFeatureProcessor)
+            {
+                m_cloudscapeFeatureProcessor->GetRayMarchTileCounts(liveTileCount, totalTileCount);
+            }
+            return AZStd::make_tuple(liveTileCount, totalTileCount);
+        }
+
         void CloudscapeComponentController::EndCallBatch()
         {
             if (!m_isBatchingShaderConstantChanges)
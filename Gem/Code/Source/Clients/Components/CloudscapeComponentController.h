@@ -113,6 +113,8 @@ namespace VolumetricClouds
         // Cloud Material Properties
         const CloudMaterialProperties& GetCloudMaterialProperties() override;
         void SetCloudMaterialProperties(const CloudMaterialProperties& cmp) override;
+        // Stats
+        AZStd::tuple<uint32_t, uint32_t> GetRayMarchTileCounts() override;
 
         void EndCallBatch() override;
         // VolumetricCloudsRequestBus::Handler overrides END
@@ -145,6 +147,10 @@ namespace VolumetricClouds
         //! Common functionality of AssetBus events.
         void OnAssetStateChanged(AZ::Data::Asset<AZ::Data::AssetData> asset, bool isReload);
 
+        // Reads the weather map asset in a job, and builds the WeatherMapPyramid used by
+        // CloudscapeCS.azsl to skip empty space. The texture is submitted on the main thread.
+        void BuildWeatherMapPyramid();
+
         ////////////////////////////////////////////////////////////////////
         //! AZ::TransformNotificationBus::Handler
         void OnTransformChanged(const AZ::Transform& /*local*/, const AZ::Transform& /*world*/) override;
@@ -169,6 +175,10 @@ namespace VolumetricClouds
         CloudscapeFeatureProcessor* m_cloudscapeFeatureProcessor = nullptr;
 
         AZ::Render::DirectionalLightConfigurationChangedEvent::Handler m_directionalLightConfigChangedEventHandler;
+
+        // Reset on Deactivate(), and each time the weather map changes, so a pyramid
+        // that finishes building for a stale weather map is discarded.
+        AZStd::shared_ptr<int> m_weatherMapPyramidToken;
     };
 
 } // namespace VolumetricClouds
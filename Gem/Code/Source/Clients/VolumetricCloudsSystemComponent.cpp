@@ -12,8 +12,12 @@
 
 #include <VolumetricClouds/VolumetricCloudsTypeIds.h>
 #include <Renderer/Passes/CloudTextureComputePass.h>
+#include <Renderer/Passes/CloudTextureMipReductionPass.h>
 #include <Renderer/Passes/CloudscapeComputePass.h>
+#include <Renderer/Passes/CloudscapeOpticalDepthPass.h>
 #include <Renderer/Passes/CloudscapeRasterPass.h>
+#include <Renderer/Passes/CloudscapeTileClassificationPass.h>
+#include <Renderer/Passes/DepthBufferCopyPass.h>
 #include <Renderer/CloudTexturesComputeFeatureProcessor.h>
 #include <Renderer/CloudTexturesDebugViewerFeatureProcessor.h>
 #include <Renderer/CloudscapeFeatureProcessor.h>
@@ -77,8 +81,12 @@ namespace VolumetricClouds
 
         // Register volumetric clouds related custom passes
         passSystem->AddPassCreator(AZ::Name("CloudTextureComputePass"), &CloudTextureComputePass::Create);
+        passSystem->AddPassCreator(AZ::Name("CloudTextureMipReductionPass"), &CloudTextureMipReductionPass::Create);
         passSystem->AddPassCreator(AZ::Name("CloudscapeComputePass"), &CloudscapeComputePass::Create);
+        passSystem->AddPassCreator(AZ::Name("CloudscapeOpticalDepthPass"), &CloudscapeOpticalDepthPass::Create);
         passSystem->AddPassCreator(AZ::Name("CloudscapeRasterPass"), &CloudscapeRasterPass::Create);
+        passSystem->AddPassCreator(AZ::Name("CloudscapeTileClassificationPass"), &CloudscapeTileClassificationPass::Create);
+        passSystem->AddPassCreator(AZ::Name("DepthBufferCopyPass"), &DepthBufferCopyPass::Create);
 
         // Setup handler for load pass templates mappings
         m_loadTemplatesHandler = AZ::RPI::PassSystemInterface::OnReadyLoadTemplatesEvent::Handler([this]() { this->LoadPassTemplateMappings(); });
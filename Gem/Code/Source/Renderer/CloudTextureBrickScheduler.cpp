@@ -0,0 +1,75 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/std/algorithm.h>
+
+#include "CloudTextureBrickScheduler.h"
+
+namespace VolumetricClouds
+{
+    CloudTextureBrickScheduler::CloudTextureBrickScheduler(uint32_t pixelSize, uint32_t brickSize)
+    {
+        m_brickSize = AZStd::clamp(brickSize, 1u, AZStd::max(pixelSize, 1u));
+        m_bricksPerAxis = AZStd::max(pixelSize / m_brickSize, 1u);
+        m_brickCount = m_bricksPerAxis * m_bricksPerAxis * m_bricksPerAxis;
+    }
+
+    CloudTextureBrickScheduler::BrickRange CloudTextureBrickScheduler::ScheduleNextFrame(uint32_t frameBudgetMicroseconds)
+    {
+        BrickRange range;
+        range.m_firstBrick = m_nextBrick;
+        const uint32_t remainingBricks = m_brickCount - m_nextBrick;
+        if (remainingBricks == 0)
+        {
+            return range;
+        }
+
+        if (frameBudgetMicroseconds == 0)
+        {
+            range.m_brickCount = remainingBricks;
+        }
+        else if (m_estimatedBrickCostMicroseconds <= 0.0f)
+        {
+            // Nothing is known about the cost yet, start small.
+            range.m_brickCount = 1;
+        }
+        else
+        {
+            const float affordableBricks = static_cast<float>(frameBudgetMicroseconds) / m_estimatedBrickCostMicroseconds;
+            range.m_brickCount = AZStd::clamp(static_cast<uint32_t>(affordableBricks), 1u, remainingBricks);
+        }
+
+        m_nextBrick += range.m_brickCount;
+        return range;
+    }
+
+    void CloudTextureBrickScheduler::ReportFrameCost(uint32_t brickCount, uint64_t microseconds)
+    {
+        if (brickCount == 0)
+        {
+            return;
+        }
+
+        const float brickCost = static_cast<float>(microseconds) / static_cast<float>(brickCount);
+        if (m_estimatedBrickCostMicroseconds <= 0.0f)
+        {
+            m_estimatedBrickCostMicroseconds = brickCost;
+            return;
+        }
+        m_estimatedBrickCostMicroseconds += (brickCost - m_estimatedBrickCostMicroseconds) * CostSmoothingFactor;
+    }
+
+    CloudTextureBrickScheduler::BrickOffset CloudTextureBrickScheduler::GetBrickOffset(uint32_t brickIndex) const
+    {
+        BrickOffset offset;
+        offset.m_x = (brickIndex % m_bricksPerAxis) * m_brickSize;
+        offset.m_y = ((brickIndex / m_bricksPerAxis) % m_bricksPerAxis) * m_brickSize;
+        offset.m_z = (brickIndex / (m_bricksPerAxis * m_bricksPerAxis)) * m_brickSize;
+        return offset;
+    }
+
+} // namespace VolumetricClouds
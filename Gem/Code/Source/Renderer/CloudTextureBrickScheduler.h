@@ -0,0 +1,76 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/base.h>
+
+namespace VolumetricClouds
+{
+    // Splits the mip 0 of a cloud noise texture into cubic bricks, and decides how many
+    // bricks should be dispatched each frame so the GPU time stays within a per frame budget.
+    // The cost of a brick is learned from the GPU times reported with ReportFrameCost().
+    // Bricks are always dispatched in linear order, X first, then Y, then Z, so each frame
+    // gets a contiguous range of brick indices.
+    // This class has no dependencies on the renderer so it can be unit tested headlessly.
+    class CloudTextureBrickScheduler final
+    {
+    public:
+        static constexpr uint32_t DefaultBrickSize = 32;
+
+        struct BrickRange
+        {
+            uint32_t m_firstBrick = 0;
+            uint32_t m_brickCount = 0;
+        };
+
+        struct BrickOffset
+        {
+            uint32_t m_x = 0;
+            uint32_t m_y = 0;
+            uint32_t m_z = 0;
+        };
+
+        // @pixelSize and @brickSize must be powers of two. If @brickSize is larger than
+        // @pixelSize, the whole volume becomes a single brick.
+        CloudTextureBrickScheduler(uint32_t pixelSize, uint32_t brickSize = DefaultBrickSize);
+        ~CloudTextureBrickScheduler() = default;
+
+        // Returns the range of bricks to dispatch this frame, and considers them dispatched.
+        // At least one brick is returned while there are bricks left, so progress is guaranteed
+        // even if a single brick costs more than @frameBudgetMicroseconds.
+        // A budget of 0 means no time slicing, all the remaining bricks are returned.
+        BrickRange ScheduleNextFrame(uint32_t frameBudgetMicroseconds);
+
+        // Updates the estimated cost of a brick, given that dispatching
+        // @brickCount bricks took @microseconds of GPU time.
+        void ReportFrameCost(uint32_t brickCount, uint64_t microseconds);
+
+        // Position, in pixels, of the first voxel of the brick.
+        BrickOffset GetBrickOffset(uint32_t brickIndex) const;
+
+        uint32_t GetBrickSize() const { return m_brickSize; }
+        uint32_t GetBricksPerAxis() const { return m_bricksPerAxis; }
+        uint32_t GetBrickCount() const { return m_brickCount; }
+        uint32_t GetScheduledBrickCount() const { return m_nextBrick; }
+        bool IsFullyScheduled() const { return m_nextBrick >= m_brickCount; }
+
+        // Zero until the first call to ReportFrameCost().
+        float GetEstimatedBrickCostMicroseconds() const { return m_estimatedBrickCostMicroseconds; }
+
+    private:
+        // Weight of the newest sample in the moving average of the brick cost.
+        static constexpr float CostSmoothingFactor = 0.25f;
+
+        uint32_t m_brickSize = DefaultBrickSize;
+        uint32_t m_bricksPerAxis = 1;
+        uint32_t m_brickCount = 1;
+        uint32_t m_nextBrick = 0;
+        float m_estimatedBrickCostMicroseconds = 0.0f;
+    };
+
+} // namespace VolumetricClouds
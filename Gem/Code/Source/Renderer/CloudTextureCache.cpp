@@ -0,0 +1,352 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/IO/SystemFile.h>
+#include <AzCore/std/sort.h>
+#include <AzCore/std/string/string.h>
+
+#include <Renderer/Passes/CloudTextureComputePass.h>
+#include "CloudTextureCache.h"
+
+namespace VolumetricClouds
+{
+    CloudTextureCache::CloudTextureCache(const AZ::IO::Path& cacheFolder, uint64_t maxSizeInBytes)
+        : m_cacheFolder(cacheFolder)
+        , m_maxSizeInBytes(maxSizeInBytes)
+    {
+        AZStd::scoped_lock lock(m_mutex);
+        ScanCacheFolder();
+        EvictIfNeeded();
+    }
+
+    CloudTextureCache::KeyData CloudTextureCache::GetKeyData(const CloudTextureComputeData& computeData)
+    {
+        KeyData keyData;
+        keyData.m_pixelSize = computeData.m_pixelSize;
+        keyData.m_frequency = computeData.m_frequency;
+        keyData.m_perlinOctaves = computeData.m_perlinOctaves;
+        keyData.m_perlinGain = computeData.m_perlinGain;
+        keyData.m_perlinAmplitude = computeData.m_perlinAmplitude;
+        keyData.m_worleyOctaves = computeData.m_worleyOctaves;
+        keyData.m_worleyGain = computeData.m_worleyGain;
+        keyData.m_worleyAmplitude = computeData.m_worleyAmplitude;
+        keyData.m_mipFilter = computeData.m_mipFilter;
+        keyData.m_channelLayout = computeData.m_channelLayout;
+        return keyData;
+    }
+
+    uint64_t CloudTextureCache::CalculateKey(const CloudTextureComputeData& computeData)
+    {
+        return CalculateKey(GetKeyData(computeData));
+    }
+
+    uint64_t CloudTextureCache::CalculateKey(const KeyData& keyData)
+    {
+        // 64 bits FNV-1a. Unlike AZStd::hash, it gives the same value
+        // across platforms and compilers, which is a must for files on disk.
+        static_assert(sizeof(KeyData) == 44, "KeyData is expected to have no padding");
+        constexpr uint64_t FnvOffsetBasis = 14695981039346656037ull;
+        constexpr uint64_t FnvPrime = 1099511628211ull;
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&keyData);
+        uint64_t hash = FnvOffsetBasis;
+        for (size_t i = 0; i < sizeof(KeyData); i++)
+        {
+            hash ^= bytes[i];
+            hash *= FnvPrime;
+        }
+        return hash;
+    }
+
+    AZ::IO::Path CloudTextureCache::GetFilePath(uint64_t key) const
+    {
+        return m_cacheFolder / AZStd::string::format("%016llx%s", static_cast<unsigned long long>(key), FileExtension);
+    }
+
+    bool CloudTextureCache::Load(const CloudTextureComputeData& computeData, AZStd::vector<CloudTextureMipData>& mipLevels)
+    {
+        const KeyData keyData = GetKeyData(computeData);
+        const uint64_t key = CalculateKey(keyData);
+
+        AZStd::scoped_lock lock(m_mutex);
+        if (m_entries.find(key) == m_entries.end())
+        {
+            m_stats.m_misses++;
+            return false;
+        }
+
+        const AZ::IO::Path filePath = GetFilePath(key);
+        auto discardEntry = [&](const char* reason)
+        {
+            AZ_Warning(LogName, false, "Discarding cache entry %s: %s.", filePath.c_str(), reason);
+            RemoveEntry(key);
+            AZ::IO::SystemFile::Delete(filePath.c_str());
+            m_stats.m_misses++;
+            return false;
+        };
+
+        AZ::IO::SystemFile file;
+        if (!file.Open(filePath.c_str(), AZ::IO::SystemFile::SF_OPEN_READ_ONLY))
+        {
+            return discardEntry("Failed to open the file");
+        }
+
+        FileHeader fileHeader;
+        if (file.Read(sizeof(FileHeader), &fileHeader) != sizeof(FileHeader)
+            || fileHeader.m_magic != FileHeader::Magic || fileHeader.m_version != FileHeader::CurrentVersion)
+        {
+            return discardEntry("Invalid header");
+        }
+
+        if (memcmp(&fileHeader.m_keyData, &keyData, sizeof(KeyData)) != 0)
+        {
+            // Hash collision, or an old noise algorithm version. Either way, the new texture
+            // will replace this entry.
+            return discardEntry("Key mismatch");
+        }
+
+        // The key matched, so the pixel size and channel layout are the requested ones. Nothing else in
+        // the file is trusted before allocating memory for it.
+        if (fileHeader.m_mipCount != CloudTextureComputePass::CalculateMipCount(computeData.m_pixelSize))
+        {
+            return discardEntry("Unexpected mip count");
+        }
+
+        AZStd::vector<MipHeader> mipHeaders(fileHeader.m_mipCount);
+        const size_t mipHeadersByteCount = sizeof(MipHeader) * mipHeaders.size();
+        if (file.Read(mipHeadersByteCount, mipHeaders.data()) != mipHeadersByteCount)
+        {
+            return discardEntry("Truncated mip headers");
+        }
+
+        const uint64_t bytesPerPixel = AZ::RHI::GetFormatSize(
+            CloudTextureComputePass::GetImageFormat(static_cast<CloudTextureChannelLayout>(computeData.m_channelLayout)));
+        uint64_t remainingByteCount = file.Length() - sizeof(FileHeader) - mipHeadersByteCount;
+        for (uint32_t mipIndex = 0; mipIndex < fileHeader.m_mipCount; mipIndex++)
+        {
+            const auto& mipHeader = mipHeaders[mipIndex];
+            const uint32_t mipSize = computeData.m_pixelSize >> mipIndex;
+            if ((mipHeader.m_width != mipSize) || (mipHeader.m_height != mipSize) || (mipHeader.m_depth != mipSize)
+                || (mipHeader.m_byteCount != static_cast<uint64_t>(mipSize) * mipSize * mipSize * bytesPerPixel))
+            {
+                return discardEntry("Unexpected mip size");
+            }
+            if (mipHeader.m_byteCount > remainingByteCount)
+            {
+                return discardEntry("Truncated pixel data");
+            }
+            remainingByteCount -= mipHeader.m_byteCount;
+        }
+
+        AZStd::vector<CloudTextureMipData> loadedMipLevels;
+        loadedMipLevels.reserve(mipHeaders.size());
+        for (uint32_t mipIndex = 0; mipIndex < fileHeader.m_mipCount; mipIndex++)
+        {
+            const auto& mipHeader = mipHeaders[mipIndex];
+            CloudTextureMipData& mipData = loadedMipLevels.emplace_back();
+            mipData.m_mipSlice = static_cast<uint16_t>(mipIndex);
+            mipData.m_mipSize = AZ::RHI::Size(mipHeader.m_width, mipHeader.m_height, mipHeader.m_depth);
+            mipData.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(mipHeader.m_byteCount);
+            if (file.Read(mipHeader.m_byteCount, mipData.m_dataBuffer->data()) != mipHeader.m_byteCount)
+            {
+                return discardEntry("Truncated pixel data");
+            }
+        }
+
+        file.Close();
+
+        // Rewrites the header with the same bytes, so the modification time of the file
+        // reflects the last use, and ScanCacheFolder() restores the LRU order in the next session.
+        AZ::IO::SystemFile touchedFile;
+        if (touchedFile.Open(filePath.c_str(), AZ::IO::SystemFile::SF_OPEN_READ_WRITE))
+        {
+            touchedFile.Write(&fileHeader, sizeof(FileHeader));
+        }
+
+        mipLevels = AZStd::move(loadedMipLevels);
+        TouchEntry(key, m_entries.at(key)->m_sizeInBytes);
+        m_stats.m_hits++;
+        return true;
+    }
+
+    bool CloudTextureCache::Store(const CloudTextureComputeData& computeData, const AZStd::vector<CloudTextureMipData>& mipLevels)
+    {
+        if (mipLevels.empty())
+        {
+            return false;
+        }
+
+        FileHeader fileHeader;
+        fileHeader.m_keyData = GetKeyData(computeData);
+        fileHeader.m_mipCount = static_cast<uint32_t>(mipLevels.size());
+        const uint64_t key = CalculateKey(fileHeader.m_keyData);
+
+        AZStd::vector<MipHeader> mipHeaders;
+        mipHeaders.reserve(mipLevels.size());
+        uint64_t fileSize = sizeof(FileHeader);
+        for (const auto& mipData : mipLevels)
+        {
+            if (!mipData.m_dataBuffer)
+            {
+                AZ_Error(LogName, false, "Mip level %u has no data.", mipData.m_mipSlice);
+                return false;
+            }
+            MipHeader& mipHeader = mipHeaders.emplace_back();
+            mipHeader.m_width = mipData.m_mipSize.m_width;
+            mipHeader.m_height = mipData.m_mipSize.m_height;
+            mipHeader.m_depth = mipData.m_mipSize.m_depth;
+            mipHeader.m_byteCount = mipData.m_dataBuffer->size();
+            fileSize += sizeof(MipHeader) + mipHeader.m_byteCount;
+        }
+
+        AZStd::scoped_lock lock(m_mutex);
+
+        // Write to a temporary file first, so a crash in the middle
+        // of the write never leaves a partial entry.
+        const AZ::IO::Path filePath = GetFilePath(key);
+        AZ::IO::Path tmpFilePath = filePath;
+        tmpFilePath.ReplaceExtension(".tmp");
+        {
+            AZ::IO::SystemFile file;
+            const int openMode = AZ::IO::SystemFile::SF_OPEN_CREATE | AZ::IO::SystemFile::SF_OPEN_CREATE_PATH | AZ::IO::SystemFile::SF_OPEN_WRITE_ONLY;
+            if (!file.Open(tmpFilePath.c_str(), openMode))
+            {
+                AZ_Error(LogName, false, "Failed to create file %s.", tmpFilePath.c_str());
+                return false;
+            }
+
+            bool success = (file.Write(&fileHeader, sizeof(FileHeader)) == sizeof(FileHeader));
+            const size_t mipHeadersByteCount = sizeof(MipHeader) * mipHeaders.size();
+            success = success && (file.Write(mipHeaders.data(), mipHeadersByteCount) == mipHeadersByteCount);
+            for (const auto& mipData : mipLevels)
+            {
+                success = success && (file.Write(mipData.m_dataBuffer->data(), mipData.m_dataBuffer->size()) == mipData.m_dataBuffer->size());
+            }
+            file.Close();
+
+            if (!success)
+            {
+                AZ_Error(LogName, false, "Failed to write file %s.", tmpFilePath.c_str());
+                AZ::IO::SystemFile::Delete(tmpFilePath.c_str());
+                return false;
+            }
+        }
+
+        if (!AZ::IO::SystemFile::Rename(tmpFilePath.c_str(), filePath.c_str(), true))
+        {
+            AZ_Error(LogName, false, "Failed to rename %s as %s.", tmpFilePath.c_str(), filePath.c_str());
+            AZ::IO::SystemFile::Delete(tmpFilePath.c_str());
+            return false;
+        }
+
+        TouchEntry(key, fileSize);
+        m_stats.m_stores++;
+        EvictIfNeeded();
+        return true;
+    }
+
+    void CloudTextureCache::SetMaxSizeInBytes(uint64_t maxSizeInBytes)
+    {
+        AZStd::scoped_lock lock(m_mutex);
+        m_maxSizeInBytes = maxSizeInBytes;
+        EvictIfNeeded();
+    }
+
+    void CloudTextureCache::Clear()
+    {
+        AZStd::scoped_lock lock(m_mutex);
+        while (!m_lruList.empty())
+        {
+            const uint64_t key = m_lruList.back().m_key;
+            AZ::IO::SystemFile::Delete(GetFilePath(key).c_str());
+            RemoveEntry(key);
+        }
+    }
+
+    CloudTextureCache::Stats CloudTextureCache::GetStats() const
+    {
+        AZStd::scoped_lock lock(m_mutex);
+        return m_stats;
+    }
+
+    void CloudTextureCache::ScanCacheFolder()
+    {
+        struct FoundFile
+        {
+            uint64_t m_key;
+            uint64_t m_sizeInBytes;
+            uint64_t m_modificationTime;
+        };
+        AZStd::vector<FoundFile> foundFiles;
+
+        const AZ::IO::Path filter = m_cacheFolder / AZStd::string::format("*%s", FileExtension);
+        AZ::IO::SystemFile::FindFiles(filter.c_str(), [&](const char* fileName, bool isFile)
+            {
+                if (!isFile)
+                {
+                    return true;
+                }
+                const AZ::IO::Path filePath = m_cacheFolder / fileName;
+                const AZStd::string stem(filePath.Stem().Native());
+                char* parseEnd = nullptr;
+                const uint64_t key = strtoull(stem.c_str(), &parseEnd, 16);
+                if (stem.empty() || (*parseEnd != '\0'))
+                {
+                    // Not a file created by this cache.
+                    return true;
+                }
+                foundFiles.push_back({ key, AZ::IO::SystemFile::Length(filePath.c_str()), AZ::IO::SystemFile::ModificationTime(filePath.c_str()) });
+                return true;
+            });
+
+        // Most recently modified first.
+        AZStd::sort(foundFiles.begin(), foundFiles.end(), [](const FoundFile& lhs, const FoundFile& rhs)
+            {
+                return lhs.m_modificationTime > rhs.m_modificationTime;
+            });
+        for (const auto& foundFile : foundFiles)
+        {
+            m_lruList.push_back({ foundFile.m_key, foundFile.m_sizeInBytes });
+            m_entries.emplace(foundFile.m_key, AZStd::prev(m_lruList.end()));
+            m_stats.m_sizeInBytes += foundFile.m_sizeInBytes;
+        }
+        m_stats.m_entryCount = m_entries.size();
+    }
+
+    void CloudTextureCache::TouchEntry(uint64_t key, uint64_t sizeInBytes)
+    {
+        RemoveEntry(key);
+        m_lruList.push_front({ key, sizeInBytes });
+        m_entries.emplace(key, m_lruList.begin());
+        m_stats.m_sizeInBytes += sizeInBytes;
+        m_stats.m_entryCount = m_entries.size();
+    }
+
+    void CloudTextureCache::RemoveEntry(uint64_t key)
+    {
+        auto itor = m_entries.find(key);
+        if (itor == m_entries.end())
+        {
+            return;
+        }
+        m_stats.m_sizeInBytes -= itor->second->m_sizeInBytes;
+        m_lruList.erase(itor->second);
+        m_entries.erase(itor);
+        m_stats.m_entryCount = m_entries.size();
+    }
+
+    void CloudTextureCache::EvictIfNeeded()
+    {
+        while (!m_lruList.empty() && (m_stats.m_sizeInBytes > m_maxSizeInBytes))
+        {
+            const uint64_t key = m_lruList.back().m_key;
+            AZ::IO::SystemFile::Delete(GetFilePath(key).c_str());
+            RemoveEntry(key);
+            m_stats.m_evictions++;
+        }
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,145 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/IO/Path/Path.h>
+#include <AzCore/std/containers/list.h>
+#include <AzCore/std/containers/unordered_map.h>
+#include <AzCore/std/parallel/mutex.h>
+
+#include <Renderer/Passes/CloudTextureComputeData.h>
+#include "CloudTextureMipData.h"
+
+namespace VolumetricClouds
+{
+    // A content addressed, size bounded, on-disk cache of cloud noise textures.
+    // Each entry is a single file that contains the whole mip chain, in the format of its channel layout. The file name
+    // is the hash of the CloudTextureComputeData along with NoiseAlgorithmVersion, so
+    // any change in the parameters, or in the noise algorithm, produces a different entry.
+    // CloudTextureComputeData::m_normalizeChannelRange is not part of the key. Entries always
+    // have the texture as generated, and the channels are renormalized after loading it.
+    // When the total size goes above the limit, the least recently used entries are deleted.
+    // All public functions are thread safe.
+    class CloudTextureCache final
+    {
+    public:
+        // Increase this number each time CloudTextureCS.azsl, CloudTextureMipReductionCS.azsl,
+        // or any of the noise functions change in a way that modifies the output.
+        static constexpr uint32_t NoiseAlgorithmVersion = 2;
+
+        static constexpr char FileExtension[] = ".cloudtex";
+
+        struct Stats
+        {
+            uint64_t m_hits = 0;
+            uint64_t m_misses = 0;
+            uint64_t m_stores = 0;
+            uint64_t m_evictions = 0;
+            uint64_t m_entryCount = 0;
+            uint64_t m_sizeInBytes = 0;
+        };
+
+        // Scans @cacheFolder for existing entries. The folder is created on the first Store().
+        CloudTextureCache(const AZ::IO::Path& cacheFolder, uint64_t maxSizeInBytes);
+        ~CloudTextureCache() = default;
+
+        static uint64_t CalculateKey(const CloudTextureComputeData& computeData);
+
+        // Returns true if there's an entry for @computeData, in which case @mipLevels
+        // will contain the whole mip chain. Entries that are corrupt, or whose mip chain doesn't
+        // match the pixel size and channel layout of @computeData, are deleted.
+        // The whole file is read, so it must not be called from the render thread.
+        bool Load(const CloudTextureComputeData& computeData, AZStd::vector<CloudTextureMipData>& mipLevels);
+
+        // Adds, or replaces, the entry for @computeData. @mipLevels must contain the whole mip chain.
+        bool Store(const CloudTextureComputeData& computeData, const AZStd::vector<CloudTextureMipData>& mipLevels);
+
+        // Evicts entries right away if the cache is bigger than @maxSizeInBytes.
+        void SetMaxSizeInBytes(uint64_t maxSizeInBytes);
+
+        // Deletes all entries.
+        void Clear();
+
+        Stats GetStats() const;
+
+        const AZ::IO::Path& GetCacheFolder() const { return m_cacheFolder; }
+
+    private:
+        AZ_DISABLE_COPY_MOVE(CloudTextureCache);
+
+        static constexpr char LogName[] = "CloudTextureCache";
+
+        // All the values that define the content of a noise texture.
+        // Stored in the file header to detect hash collisions.
+        // Only 4 bytes fields, so there's no padding.
+        struct KeyData
+        {
+            uint32_t m_noiseAlgorithmVersion = NoiseAlgorithmVersion;
+            uint32_t m_pixelSize = 0;
+            float m_frequency = 0.0f;
+            int32_t m_perlinOctaves = 0;
+            float m_perlinGain = 0.0f;
+            float m_perlinAmplitude = 0.0f;
+            int32_t m_worleyOctaves = 0;
+            float m_worleyGain = 0.0f;
+            float m_worleyAmplitude = 0.0f;
+            uint32_t m_mipFilter = 0;
+            uint32_t m_channelLayout = 0;
+        };
+
+        struct FileHeader
+        {
+            static constexpr uint32_t Magic = 0x43544356; // "VCTC"
+            static constexpr uint32_t CurrentVersion = 2;
+
+            uint32_t m_magic = Magic;
+            uint32_t m_version = CurrentVersion;
+            KeyData m_keyData;
+            uint32_t m_mipCount = 0;
+            uint32_t m_reserved = 0;
+        };
+
+        // One for each mip level, right after the FileHeader, followed by the pixel data of all mips.
+        struct MipHeader
+        {
+            uint32_t m_width = 0;
+            uint32_t m_height = 0;
+            uint32_t m_depth = 0;
+            uint32_t m_reserved = 0;
+            uint64_t m_byteCount = 0;
+        };
+
+        struct Entry
+        {
+            uint64_t m_key = 0;
+            uint64_t m_sizeInBytes = 0;
+        };
+
+        static KeyData GetKeyData(const CloudTextureComputeData& computeData);
+        static uint64_t CalculateKey(const KeyData& keyData);
+        AZ::IO::Path GetFilePath(uint64_t key) const;
+
+        // Registers all the files in @m_cacheFolder, the most recently modified
+        // files become the most recently used entries. Load() touches the file of each hit.
+        void ScanCacheFolder();
+        // Moves the entry to the front of the LRU list and adds it if not present.
+        void TouchEntry(uint64_t key, uint64_t sizeInBytes);
+        void RemoveEntry(uint64_t key);
+        void EvictIfNeeded();
+
+        AZ::IO::Path m_cacheFolder;
+        uint64_t m_maxSizeInBytes = 0;
+
+        mutable AZStd::mutex m_mutex;
+        // Front is the most recently used entry.
+        AZStd::list<Entry> m_lruList;
+        AZStd::unordered_map<uint64_t, AZStd::list<Entry>::iterator> m_entries;
+        Stats m_stats;
+    };
+
+} // namespace VolumetricClouds
@@ -5,6 +5,7 @@
 *
 */
 
+#include <Atom/RHI.Reflect/Limits.h>
 #include <Atom/RPI.Public/Pass/Pass.h>
 #include <Atom/RPI.Public/Pass/PassSystemInterface.h>
 #include <Atom/RPI.Public/Pass/PassFilter.h>
@@ -14,136 +15,457 @@
 #include <Atom/RPI.Reflect/System/AnyAsset.h>
 
 #include <Renderer/Passes/CloudTextureComputePass.h>
+#include <Renderer/Passes/CloudTextureMipReductionPass.h>
 #include "CloudTextureComputePipeline.h"
 
 namespace VolumetricClouds
 {
     CloudTextureComputePipeline::RenderTaskId CloudTextureComputePipeline::m_renderTaskCounter = 0;
+    uint32_t CloudTextureComputePipeline::m_pipelineCounter = 0;
 
-    CloudTextureComputePipeline::RenderTaskId CloudTextureComputePipeline::StartTextureCompute(AZ::RPI::Scene* scene, AZ::Data::Instance<AZ::RPI::AttachmentImage> texture3DAttachment,
-        const CloudTextureComputeData& computeData, CloudTextureRenderCallback callback, bool withAttachmentReadback)
+    CloudTextureComputePipeline::~CloudTextureComputePipeline()
     {
-        m_scene = scene;
-        AZ_Assert(m_isRendering == false, "CloudTextureComputePipeline::StartRender called while a noise Texture render was already in progress");
-        if (m_isRendering)
+        AZ_Warning(LogName, !IsInitialized(), "CloudTextureComputePipeline destroyed without calling Shutdown()");
+    }
+
+    bool CloudTextureComputePipeline::Initialize(AZ::RPI::Scene* scene)
+    {
+        AZ_Assert(!IsInitialized(), "CloudTextureComputePipeline::Initialize called twice");
+        if (IsInitialized())
         {
-            return 0;
+            return true;
         }
-    
-        m_isRendering = true;
-        m_callback = callback;
 
         AZ::Data::Asset<AZ::RPI::AnyAsset> pipelineAsset = AZ::RPI::AssetUtils::LoadAssetByProductPath<AZ::RPI::AnyAsset>(PipelineDescriptorAssetPath, AZ::RPI::AssetUtils::TraceLevel::Error);
         if (!pipelineAsset.IsReady())
         {
             AZ_Assert(false, "Failed to load pipeline asset at %s", PipelineDescriptorAssetPath);
             AZ_Error(LogName, false, "Failed to load pipeline asset at %s", PipelineDescriptorAssetPath);
-            return 0;
+            return false;
         }
 
         const AZ::RPI::RenderPipelineDescriptor* tmpRenderPipelineDescriptor = AZ::RPI::GetDataFromAnyAsset<AZ::RPI::RenderPipelineDescriptor>(pipelineAsset);
         AZ_Assert(!!tmpRenderPipelineDescriptor, "Couldn't read asset %s as RenderPipelineDescriptor", PipelineDescriptorAssetPath);
         if (!tmpRenderPipelineDescriptor)
         {
-            return 0;
+            return false;
         }
         AZ::RPI::RenderPipelineDescriptor renderPipelineDescriptor = *tmpRenderPipelineDescriptor;
         // Define a unique name for the pipeline within the scene.
-        m_renderTaskCounter++;
-        m_renderTaskId = m_renderTaskCounter;
-        renderPipelineDescriptor.m_name = AZStd::string::format("CloudTexturePipeline_%u", m_renderTaskId);
+        m_pipelineCounter++;
+        renderPipelineDescriptor.m_name = AZStd::string::format("CloudTexturePipeline_%u", m_pipelineCounter);
 
         AZ::RPI::RenderPipelinePtr renderPipeline = AZ::RPI::RenderPipeline::CreateRenderPipeline(renderPipelineDescriptor);
+
+        m_taskPasses.clear();
+        for (uint32_t taskIndex = 0; taskIndex < MaxBatchSize; taskIndex++)
+        {
+            const auto taskPassName = AZ::Name(AZStd::string::format("CloudTextureTask%u", taskIndex));
+            AZ::RPI::Ptr<AZ::RPI::Pass> taskPass = renderPipeline->GetRootPass()->FindChildPass(taskPassName);
+            if (!taskPass || !taskPass->AsParent())
+            {
+                AZ_Error(LogName, false, "%s Failed to find pass: %s", __FUNCTION__, taskPassName.GetCStr());
+                m_taskPasses.clear();
+                return false;
+            }
+            // Enabled only when there's a texture for this task.
+            taskPass->SetEnabled(false);
+            m_taskPasses.push_back(taskPass->AsParent());
+        }
+
+        // Add the pipeline to the scene
+        m_scene = scene;
         m_renderPipelineId = renderPipeline->GetId();
+        m_scene->AddRenderPipeline(renderPipeline);
+        return true;
+    }
+
+    void CloudTextureComputePipeline::Shutdown()
+    {
+        if (!IsInitialized())
+        {
+            return;
+        }
+
+        for (auto& textureTask : m_textureTasks)
+        {
+            ClearTextureTask(textureTask);
+        }
+        m_textureTasks.clear();
+        m_taskPasses.clear();
+        m_isRendering = false;
+
+        // Note: this must not be called in the scope of a feature processor Simulate or Render to avoid a race condition with other feature processors
+        m_scene->RemoveRenderPipeline(m_renderPipelineId);
+        m_scene = nullptr;
+    }
+
+    AZStd::vector<CloudTextureComputePipeline::RenderTaskId> CloudTextureComputePipeline::StartTextureCompute(
+        const AZStd::vector<TextureComputeRequest>& requests, CloudTextureRenderCallback callback,
+        uint32_t brickSize, uint32_t frameBudgetMicroseconds)
+    {
+        AZ_Assert(m_isRendering == false, "CloudTextureComputePipeline::StartRender called while a noise Texture render was already in progress");
+        if (m_isRendering || !IsInitialized())
+        {
+            return {};
+        }
+
+        if (requests.empty() || (requests.size() > MaxBatchSize))
+        {
+            AZ_Error(LogName, false, "Got %zu texture requests. Expected between 1 and %u.", requests.size(), MaxBatchSize);
+            return {};
+        }
+
+        m_callback = callback;
+        m_textureTasks.clear();
+        m_textureTasks.resize(requests.size());
+
+        AZStd::vector<RenderTaskId> renderTaskIds;
+        for (uint32_t taskIndex = 0; taskIndex < MaxBatchSize; taskIndex++)
+        {
+            auto taskPass = m_taskPasses[taskIndex];
+            if (taskIndex >= requests.size())
+            {
+                // Not needed by this batch.
+                taskPass->SetEnabled(false);
+                continue;
+            }
+
+            auto& textureTask = m_textureTasks[taskIndex];
+            m_renderTaskCounter++;
+            textureTask.m_renderTaskId = m_renderTaskCounter;
+            taskPass->SetEnabled(true);
+            if (!SetupTextureTask(taskPass, requests[taskIndex], brickSize, textureTask))
+            {
+                AZ_Error(LogName, false, "Failed to set render data for CloudTextureTask%u", taskIndex);
+                for (auto& textureTaskToClear : m_textureTasks)
+                {
+                    ClearTextureTask(textureTaskToClear);
+                }
+                // The tasks enabled so far, including the one that failed, and the ones
+                // left enabled by a previous batch, must not run in the next frames.
+                for (auto taskPassToDisable : m_taskPasses)
+                {
+                    taskPassToDisable->SetEnabled(false);
+                }
+                m_textureTasks.clear();
+                return {};
+            }
+            renderTaskIds.push_back(textureTask.m_renderTaskId);
+        }
+
+        m_isRendering = true;
+        DispatchNextBricks(frameBudgetMicroseconds);
+
+        return renderTaskIds;
+    }
+
+    void CloudTextureComputePipeline::ClearTextureTask(TextureTask& textureTask)
+    {
+        if (textureTask.m_textureComputePass)
+        {
+            textureTask.m_textureComputePass->ClearRenderData();
+        }
+        for (auto mipReductionPass : textureTask.m_mipReductionPasses)
+        {
+            mipReductionPass->ClearRenderData();
+        }
+        textureTask.m_attachmentsReadback.reset();
+    }
+
+    bool CloudTextureComputePipeline::SetupTextureTask(AZ::RPI::ParentPass* taskPass, const TextureComputeRequest& request,
+        uint32_t brickSize, TextureTask& textureTask)
+    {
+        const auto& computeData = request.m_computeData;
+        textureTask.m_pixelSize = computeData.m_pixelSize;
+        textureTask.m_withAttachmentReadback = request.m_withAttachmentReadback;
+        textureTask.m_brickScheduler = CloudTextureBrickScheduler(computeData.m_pixelSize, brickSize);
 
         // Hold a reference to the compute pass
         const auto passName = AZ::Name("CloudTextureComputePass");
-        AZ::RPI::PassFilter passFilter = AZ::RPI::PassFilter::CreateWithPassName(passName, renderPipeline.get());
-        AZ::RPI::Pass* existingPass = AZ::RPI::PassSystemInterface::Get()->FindFirstPass(passFilter);
-        m_textureComputePass = azrtti_cast<CloudTextureComputePass*>(existingPass);
-        if (!m_textureComputePass)
+        textureTask.m_textureComputePass = taskPass ? azrtti_cast<CloudTextureComputePass*>(taskPass->FindChildPass(passName).get()) : nullptr;
+        if (!textureTask.m_textureComputePass)
         {
             AZ_Error(LogName, false, "%s Failed to find pass: %s", __FUNCTION__, passName.GetCStr());
-            return 0;
+            return false;
         }
-        m_textureComputePass->SetEnabled(false);
+        textureTask.m_textureComputePass->SetEnabled(false);
         // If the data is correct, SetRenderData() will enable the Pass.
-        if (!m_textureComputePass->SetRenderData(texture3DAttachment, computeData))
+        if (!textureTask.m_textureComputePass->SetRenderData(request.m_texture3DAttachment, computeData, textureTask.m_brickScheduler))
         {
-            AZ_Assert(false, "Failed to set render data for CloudTexturePipeline with name %s", renderPipelineDescriptor.m_name.c_str());
-            AZ_Error(LogName, false, "Failed to set render data for CloudTexturePipeline with name %s", renderPipelineDescriptor.m_name.c_str());
-            return 0;
+            return false;
+        }
+
+        return SetupMipReductionPasses(taskPass, request, textureTask);
+    }
+
+    void CloudTextureComputePipeline::DispatchNextBricks(uint32_t frameBudgetMicroseconds)
+    {
+        if (!m_isRendering)
+        {
+            return;
         }
-    
-        // Add the pipeline to the scene
-        m_scene->AddRenderPipeline(renderPipeline);
 
-        if (withAttachmentReadback)
+        // The textures of the batch share the budget, in order.
+        uint32_t remainingBudget = frameBudgetMicroseconds;
+        // Running many AttachmentReadbacks at the same time is prone to crashes, so a texture
+        // that needs a readback waits until the readback of other textures are done.
+        bool isReadbackInFlight = IsAnyReadbackInFlight();
+        for (auto& textureTask : m_textureTasks)
+        {
+            auto textureComputePass = textureTask.m_textureComputePass;
+            if (textureTask.m_isComplete || !textureComputePass)
+            {
+                continue;
+            }
+
+            const bool needsReadback = textureTask.m_withAttachmentReadback && !textureTask.m_attachmentsReadback;
+            if (textureTask.m_brickScheduler.IsFullyScheduled())
+            {
+                if (textureComputePass->IsFinished() && !textureTask.m_isMipReductionStarted && !(needsReadback && isReadbackInFlight))
+                {
+                    StartMipReduction(textureTask);
+                    isReadbackInFlight = isReadbackInFlight || textureTask.m_withAttachmentReadback;
+                }
+                continue;
+            }
+
+            if (textureComputePass->HasQueuedBricks())
+            {
+                // The bricks of the previous call haven't been dispatched yet.
+                continue;
+            }
+
+            if ((frameBudgetMicroseconds > 0) && (remainingBudget == 0))
+            {
+                continue;
+            }
+
+            const bool isMip0Only = textureTask.m_mipReductionPasses.empty();
+            if (isMip0Only && needsReadback && isReadbackInFlight)
+            {
+                // With a single mip the readback goes along with the last bricks, so we
+                // can't know in advance if this is the last range. Wait for the readback.
+                continue;
+            }
+
+            const auto brickRange = textureTask.m_brickScheduler.ScheduleNextFrame(remainingBudget);
+            textureComputePass->SetBrickRange(brickRange);
+            ReportBrickCost(textureTask, brickRange.m_brickCount);
+
+            if (frameBudgetMicroseconds > 0)
+            {
+                const float estimatedCost = brickRange.m_brickCount * textureTask.m_brickScheduler.GetEstimatedBrickCostMicroseconds();
+                remainingBudget = (estimatedCost >= remainingBudget) ? 0 : remainingBudget - static_cast<uint32_t>(estimatedCost);
+            }
+
+            if (textureTask.m_brickScheduler.IsFullyScheduled() && isMip0Only && needsReadback)
+            {
+                // There's only mip 0, so the readback goes along with the last bricks.
+                textureTask.m_isMipReductionStarted = true;
+                SetupAttachmentReadback(textureTask);
+                isReadbackInFlight = true;
+            }
+        }
+    }
+
+    void CloudTextureComputePipeline::ReportBrickCost(TextureTask& textureTask, uint32_t dispatchedBrickCount)
+    {
+        textureTask.m_dispatchedBrickCounts.push_back(dispatchedBrickCount);
+        if (textureTask.m_dispatchedBrickCounts.size() <= AZ::RHI::Limits::Device::FrameCountMax)
+        {
+            return;
+        }
+        const uint32_t measuredBrickCount = textureTask.m_dispatchedBrickCounts.front();
+        textureTask.m_dispatchedBrickCounts.pop_front();
+
+        const uint64_t nanoseconds = textureTask.m_textureComputePass->GetLatestTimestampResult().GetDurationInNanoseconds();
+        if (nanoseconds > 0)
+        {
+            textureTask.m_brickScheduler.ReportFrameCost(measuredBrickCount, nanoseconds / 1000);
+        }
+    }
+
+    void CloudTextureComputePipeline::StartMipReduction(TextureTask& textureTask)
+    {
+        textureTask.m_isMipReductionStarted = true;
+        for (auto mipReductionPass : textureTask.m_mipReductionPasses)
+        {
+            mipReductionPass->SetEnabled(true);
+        }
+
+        if (textureTask.m_withAttachmentReadback)
         {
             // Setup the attachment readback if the user needs to read the Texture3D from GPU to CPU memory.
-            SetupAttachmentReadback(computeData.m_pixelSize);
+            SetupAttachmentReadback(textureTask);
+        }
+    }
+
+    void CloudTextureComputePipeline::CheckTextureCompletion()
+    {
+        if (!m_isRendering)
+        {
+            return;
+        }
+
+        bool areAllTasksComplete = true;
+        for (auto& textureTask : m_textureTasks)
+        {
+            if (textureTask.m_isComplete)
+            {
+                continue;
+            }
+
+            if (!IsTextureComputeFinished(textureTask) || (textureTask.m_attachmentsReadback && !textureTask.m_isReadbackComplete))
+            {
+                areAllTasksComplete = false;
+                continue;
+            }
+
+            textureTask.m_isComplete = true;
+            m_callback(textureTask.m_renderTaskId, textureTask.m_attachmentsReadbackData);
+            // The passes don't need the attachment anymore.
+            ClearTextureTask(textureTask);
         }
 
-        return m_renderTaskId;
+        if (!areAllTasksComplete)
+        {
+            return;
+        }
+
+        // The pipeline stays in the scene, with all passes disabled, until the next batch.
+        m_isRendering = false;
+        m_textureTasks.clear();
     }
-    
-    void CloudTextureComputePipeline::CheckAndRemovePipeline()
+
+    bool CloudTextureComputePipeline::SetupMipReductionPasses(AZ::RPI::ParentPass* taskPass, const TextureComputeRequest& request,
+        TextureTask& textureTask)
     {
-        if (m_textureComputePass && m_textureComputePass->IsFinished())
+        textureTask.m_mipReductionPasses.clear();
+
+        const auto& computeData = request.m_computeData;
+        const uint16_t mipsCount = CloudTextureComputePass::CalculateMipCount(CloudTextureComputePass::MAX_PIXEL_SIZE);
+        const uint16_t activeMipsCount = CloudTextureComputePass::CalculateMipCount(computeData.m_pixelSize);
+        const auto mipFilter = static_cast<CloudTextureMipFilter>(computeData.m_mipFilter);
+        for (uint16_t mipIndex = 1; mipIndex < mipsCount; mipIndex++)
         {
-            if (m_attachmentsReadback && !m_isReadbackComplete)
+            const auto passName = AZ::Name(AZStd::string::format("CloudTextureMipReductionPass%u", mipIndex));
+            auto mipReductionPass = azrtti_cast<CloudTextureMipReductionPass*>(taskPass->FindChildPass(passName).get());
+            if (!mipReductionPass)
+            {
+                AZ_Error(LogName, false, "%s Failed to find pass: %s", __FUNCTION__, passName.GetCStr());
+                return false;
+            }
+            mipReductionPass->SetEnabled(false);
+            if (mipIndex >= activeMipsCount)
+            {
+                // The texture doesn't have this mip level.
+                continue;
+            }
+            // If the data is correct, SetRenderData() will enable the Pass.
+            if (!mipReductionPass->SetRenderData(request.m_texture3DAttachment, mipIndex, mipFilter))
             {
-                return;
+                return false;
             }
+            // Bindings are built with the render data, but the pass must wait for all the bricks of mip 0.
+            mipReductionPass->SetEnabled(false);
+            textureTask.m_mipReductionPasses.push_back(mipReductionPass);
+        }
+        return true;
+    }
+
+    bool CloudTextureComputePipeline::IsTextureComputeFinished(const TextureTask& textureTask) const
+    {
+        if (!textureTask.m_textureComputePass || !textureTask.m_textureComputePass->IsFinished())
+        {
+            return false;
+        }
 
-            m_callback(m_renderTaskId, m_attachmentsReadbackData);
+        if (!textureTask.m_mipReductionPasses.empty() && !textureTask.m_isMipReductionStarted)
+        {
+            return false;
+        }
 
-            m_isRendering = false;
-    
-            // remove the cubemap pipeline
-            // Note: this must not be called in the scope of a feature processor Simulate or Render to avoid a race condition with other feature processors
-            m_scene->RemoveRenderPipeline(m_renderPipelineId);
-            m_attachmentsReadback.reset();
-            m_textureComputePass = nullptr;
+        for (const auto mipReductionPass : textureTask.m_mipReductionPasses)
+        {
+            if (!mipReductionPass->IsFinished())
+            {
+                return false;
+            }
         }
+        return true;
+    }
+
+    bool CloudTextureComputePipeline::IsAnyReadbackInFlight() const
+    {
+        for (const auto& textureTask : m_textureTasks)
+        {
+            if (textureTask.m_attachmentsReadback && !textureTask.m_isReadbackComplete)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    CloudTextureComputePipeline::TextureTask* CloudTextureComputePipeline::FindTextureTask(RenderTaskId renderTaskId)
+    {
+        for (auto& textureTask : m_textureTasks)
+        {
+            if (textureTask.m_renderTaskId == renderTaskId)
+            {
+                return &textureTask;
+            }
+        }
+        return nullptr;
     }
 
     void CloudTextureComputePipeline::AttachmentReadbackCallback(const AZ::RPI::AttachmentReadback::ReadbackResult& result)
     {
-        AZ_Assert(result.m_userIdentifier == m_renderTaskId, "Got unexpected user identifier <%u>. Was expecting <%u>.", result.m_userIdentifier, m_renderTaskId);
+        TextureTask* textureTask = FindTextureTask(static_cast<RenderTaskId>(result.m_userIdentifier));
+        AZ_Assert(textureTask, "Got unexpected user identifier <%u>.", result.m_userIdentifier);
+        if (!textureTask)
+        {
+            return;
+        }
 
         for (const auto& mipDataBuffer : result.m_mipDataBuffers)
         {
             const auto mipIdx = mipDataBuffer.m_mipInfo.m_slice;
-            m_attachmentsReadbackData[mipIdx].m_dataBuffer = mipDataBuffer.m_mipBuffer;
-            m_attachmentsReadbackData[mipIdx].m_mipSlice = mipIdx;
-            m_attachmentsReadbackData[mipIdx].m_mipSize = mipDataBuffer.m_mipInfo.m_size;
+            textureTask->m_attachmentsReadbackData[mipIdx].m_dataBuffer = mipDataBuffer.m_mipBuffer;
+            textureTask->m_attachmentsReadbackData[mipIdx].m_mipSlice = mipIdx;
+            textureTask->m_attachmentsReadbackData[mipIdx].m_mipSize = mipDataBuffer.m_mipInfo.m_size;
         }
 
-        m_isReadbackComplete = true;
+        textureTask->m_isReadbackComplete = true;
     }
 
-    void CloudTextureComputePipeline::SetupAttachmentReadback(uint32_t pixelSize)
+    void CloudTextureComputePipeline::SetupAttachmentReadback(TextureTask& textureTask)
     {
-        AZStd::fixed_string<128> scope_name = AZStd::fixed_string<128>::format("Texture3DCapture_%u", m_renderTaskId);
-        m_attachmentsReadback = AZStd::make_shared<AZ::RPI::AttachmentReadback>(AZ::RHI::ScopeId{ scope_name });
-        m_attachmentsReadback->SetCallback(AZStd::bind(&CloudTextureComputePipeline::AttachmentReadbackCallback, this, AZStd::placeholders::_1));
-        m_attachmentsReadback->SetUserIdentifier(m_renderTaskId);
+        const RenderTaskId renderTaskId = textureTask.m_renderTaskId;
+        AZStd::fixed_string<128> scope_name = AZStd::fixed_string<128>::format("Texture3DCapture_%u", renderTaskId);
+        textureTask.m_attachmentsReadback = AZStd::make_shared<AZ::RPI::AttachmentReadback>(AZ::RHI::ScopeId{ scope_name });
+        textureTask.m_attachmentsReadback->SetCallback(AZStd::bind(&CloudTextureComputePipeline::AttachmentReadbackCallback, this, AZStd::placeholders::_1));
+        textureTask.m_attachmentsReadback->SetUserIdentifier(renderTaskId);
 
-        m_isReadbackComplete = false;
-        AZ::Name slotName("OutputMip0");
+        textureTask.m_isReadbackComplete = false;
 
-        const auto mipsCount = CloudTextureComputePass::CalculateMipCount(pixelSize);
-        m_attachmentsReadbackData.reserve(mipsCount);
-        for (uint16_t i = 0; i < mipsCount; i++)
-        {
-            m_attachmentsReadbackData.push_back({});
-        }
+        const auto mipsCount = CloudTextureComputePass::CalculateMipCount(textureTask.m_pixelSize);
+        textureTask.m_attachmentsReadbackData.clear();
+        textureTask.m_attachmentsReadbackData.resize(mipsCount);
         const uint16_t mipSliceMax = mipsCount - 1;
         AZ::RHI::ImageSubresourceRange mipsRange(0 /*mipSliceMin*/, mipSliceMax, 0, 0);
-        const bool result = m_textureComputePass->ReadbackAttachment(m_attachmentsReadback, m_renderTaskId,
+        // The readback must happen after the last mip level is written.
+        AZ::RPI::Pass* lastPass = textureTask.m_textureComputePass;
+        AZ::Name slotName("OutputMip0");
+        if (!textureTask.m_mipReductionPasses.empty())
+        {
+            lastPass = textureTask.m_mipReductionPasses.back();
+            slotName = AZ::Name("OutputMip");
+        }
+        const bool result = lastPass->ReadbackAttachment(textureTask.m_attachmentsReadback, renderTaskId,
             slotName, AZ::RPI::PassAttachmentReadbackOption::Output, &mipsRange);
         AZ_Error(LogName, result, "%s Failed to initialize ReadbackAttachment\n", __FUNCTION__);
     }
-    
+
 } // namespace VolumetricClouds
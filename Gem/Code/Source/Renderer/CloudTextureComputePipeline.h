@@ -7,69 +7,150 @@
 
 #pragma once
 
+#include <AzCore/std/containers/deque.h>
+
 #include <Atom/RPI.Public/Base.h>
 #include <Atom/RPI.Public/Scene.h>
 #include <Atom/RPI.Public/Pass/AttachmentReadback.h>
+#include <Atom/RPI.Public/Pass/ParentPass.h>
 
 #include <Renderer/Passes/CloudTextureComputeData.h>
+#include "CloudTextureBrickScheduler.h"
+#include "CloudTextureMipData.h"
 
 namespace VolumetricClouds
 {
     class CloudTextureComputePass;
-    
-    // This class generates a 3D noise texture used for clouds. The Texture3D
-    // is generated along with all of its mipmap levels, all in a single pass.
+    class CloudTextureMipReductionPass;
+
+    // This class generates a batch of 3D noise textures used for clouds. Each Texture3D
+    // is generated along with all of its mipmap levels.
+    // Mip 0 is generated by the CloudTextureComputePass, one range of bricks per frame, as decided
+    // by a CloudTextureBrickScheduler. Once all bricks are done, each one of the remaining
+    // mips is downsampled from the previous mip by a CloudTextureMipReductionPass, all in a single frame.
     // This class instantiates a minimal render pipeline, which in turn instantiates
-    // the CloudTextureComputePass to generate the Texture3D, optionally you can
-    // enable an AttachmentReadback pass to read the Texture3D into CPU memory.
+    // one CloudTextureTask (a CloudTextureComputePass plus the CloudTextureMipReductionPass(es))
+    // per Texture3D, all the textures of the batch are generated at the same time.
+    // The render pipeline is created once, by Initialize(), and stays in the scene until Shutdown().
+    // Each batch rebinds the passes to the new render data, and when idle, all the passes are disabled.
+    // Optionally you can enable an AttachmentReadback pass to read each Texture3D into CPU memory.
     class CloudTextureComputePipeline final
     {
     public:
         CloudTextureComputePipeline() = default;
-        ~CloudTextureComputePipeline() = default;
+        ~CloudTextureComputePipeline();
+
+        // Must match the number of CloudTextureTask(s) in CloudTexturePipeline.pass
+        static constexpr uint32_t MaxBatchSize = 8;
 
         using RenderTaskId = uint32_t;
-        struct CloudTextureSubresourceReadback
-        {
-            AZStd::shared_ptr<AZStd::vector<uint8_t>> m_dataBuffer;
-            uint16_t m_mipSlice = 0;
-            AZ::RHI::Size m_mipSize = {};
-        };
+        using CloudTextureSubresourceReadback = CloudTextureMipData;
         // readbackResults will be empty if there was no request to readback the Texture3D mip subresoruces from GPU to CPU.
+        // Called once for each texture of the batch, as soon as the texture is ready.
         using CloudTextureRenderCallback = AZStd::function<void(RenderTaskId renderTaskId, const AZStd::vector<CloudTextureSubresourceReadback>& readbackResults)>;
 
-        // Instantiates a short lived render pipeline that spawns a compute pass that generates
-        // a Texture3D. Returns a unique RenderTaskId ( greater than 0, if successful) for this job that will be used in the callback.
-        RenderTaskId StartTextureCompute(AZ::RPI::Scene* scene, AZ::Data::Instance<AZ::RPI::AttachmentImage> texture3DAttachment
-                                       , const CloudTextureComputeData& computeData, CloudTextureRenderCallback callback, bool withAttachmentReadback = false);
-    
-        // removes the render pipeline from the scene if rendering is complete
+        struct TextureComputeRequest
+        {
+            AZ::Data::Instance<AZ::RPI::AttachmentImage> m_texture3DAttachment;
+            CloudTextureComputeData m_computeData;
+            bool m_withAttachmentReadback = false;
+        };
+
+        // Loads the pipeline asset, creates the render pipeline and adds it to @scene.
+        bool Initialize(AZ::RPI::Scene* scene);
+        // Removes the render pipeline from the scene. Textures in progress are abandoned
+        // and the callback won't be called for them.
+        // Note: must be called outside of the feature processor Simulate/Render phases
+        void Shutdown();
+        bool IsInitialized() const { return m_scene != nullptr; }
+
+        // Binds the compute passes that generate the Texture3D(s) to the new render data.
+        // Returns a unique RenderTaskId ( greater than 0) for each request, in the same order,
+        // that will be used in the callback. Returns an empty list, with all the task passes disabled, if something goes wrong.
+        // At most MaxBatchSize requests can be given, and the pipeline must be initialized and idle.
+        // @brickSize Size in pixels of the bricks of mip 0.
+        // @frameBudgetMicroseconds GPU time budget for the bricks of the first frame. 0 means all bricks in one frame.
+        AZStd::vector<RenderTaskId> StartTextureCompute(const AZStd::vector<TextureComputeRequest>& requests,
+                                                        CloudTextureRenderCallback callback,
+                                                        uint32_t brickSize = CloudTextureBrickScheduler::DefaultBrickSize, uint32_t frameBudgetMicroseconds = 0);
+
+        // Queues the bricks for the next frame, as many as fit in @frameBudgetMicroseconds. The budget
+        // is shared by all the textures of the batch.
+        // Must be called once per frame, outside of the feature processor Simulate/Render phases.
+        // Once all the bricks of a texture are done, starts its mip reduction passes.
+        void DispatchNextBricks(uint32_t frameBudgetMicroseconds);
+
+        // Calls the callback for the textures that are done. Once all the textures
+        // of the batch are complete, the pipeline becomes idle.
         // Note: must be called outside of the feature processor Simulate/Render phases
-        void CheckAndRemovePipeline();
-    
+        void CheckTextureCompletion();
+
         bool IsRenderingNoiseTexture() const { return m_isRendering; }
-    
+
     private:
         AZ_DISABLE_COPY_MOVE(CloudTextureComputePipeline);
 
-        void SetupAttachmentReadback(uint32_t pixelSize);
+        // State of each Texture3D in the batch.
+        struct TextureTask
+        {
+            RenderTaskId m_renderTaskId = 0;
+            uint32_t m_pixelSize = 0;
+            bool m_withAttachmentReadback = false;
+
+            CloudTextureComputePass* m_textureComputePass = nullptr;
+            // Only the passes that have work to do. mip 1 is at index 0, mip 2 at index 1, etc.
+            AZStd::vector<CloudTextureMipReductionPass*> m_mipReductionPasses;
+
+            CloudTextureBrickScheduler m_brickScheduler{ 0 };
+            // Number of bricks dispatched in each one of the last frames. GPU timestamps
+            // are available a few frames later, so this is used to match a timestamp
+            // with the number of bricks it measured.
+            AZStd::deque<uint32_t> m_dispatchedBrickCounts;
+            bool m_isMipReductionStarted = false;
+
+            AZStd::shared_ptr<AZ::RPI::AttachmentReadback> m_attachmentsReadback;
+            // This vector will be as long as the number of expected mip maps.
+            AZStd::vector<CloudTextureSubresourceReadback> m_attachmentsReadbackData;
+            bool m_isReadbackComplete = false;
+
+            // True after the callback was called for this texture.
+            bool m_isComplete = false;
+        };
+
+        // Releases the attachments of the passes of a CloudTextureTask.
+        static void ClearTextureTask(TextureTask& textureTask);
+        // Finds the passes of the CloudTextureTask @taskPass and sets their render data.
+        bool SetupTextureTask(AZ::RPI::ParentPass* taskPass, const TextureComputeRequest& request,
+                              uint32_t brickSize, TextureTask& textureTask);
+        // Finds the CloudTextureMipReductionPass(es) and sets their render data. The passes
+        // remain disabled until StartMipReduction() is called.
+        bool SetupMipReductionPasses(AZ::RPI::ParentPass* taskPass, const TextureComputeRequest& request, TextureTask& textureTask);
+        // Called once all the bricks of mip 0 are done.
+        void StartMipReduction(TextureTask& textureTask);
+        // Feeds the GPU time of the CloudTextureComputePass to the brick scheduler.
+        void ReportBrickCost(TextureTask& textureTask, uint32_t dispatchedBrickCount);
+        // Returns true when the CloudTextureComputePass and all the active CloudTextureMipReductionPass(es) are done.
+        bool IsTextureComputeFinished(const TextureTask& textureTask) const;
+        bool IsAnyReadbackInFlight() const;
+        TextureTask* FindTextureTask(RenderTaskId renderTaskId);
+
+        void SetupAttachmentReadback(TextureTask& textureTask);
         // resultNoMips will be cast to  AZ::RPI::AttachmentsReadbackGroup::ReadbackResultWithMips
         void AttachmentReadbackCallback(const AZ::RPI::AttachmentReadback::ReadbackResult& resultNoMips);
 
         static constexpr char PipelineDescriptorAssetPath[] = "Passes/CloudTexturePipelineDescriptor.azasset";
         static constexpr char LogName[] = "CloudTextureComputePipeline";
         static RenderTaskId m_renderTaskCounter;
-    
+        static uint32_t m_pipelineCounter;
+
         AZ::RPI::Scene* m_scene = nullptr;
-    
-        CloudTextureComputePass* m_textureComputePass = nullptr;
+
         AZ::RPI::RenderPipelineId m_renderPipelineId;
-        uint32_t m_renderTaskId = 0;
+        // One CloudTextureTask parent pass for each texture in the batch.
+        AZStd::vector<AZ::RPI::ParentPass*> m_taskPasses;
         CloudTextureRenderCallback m_callback;
         bool m_isRendering = false;
-        AZStd::shared_ptr<AZ::RPI::AttachmentReadback> m_attachmentsReadback;
-        // This vector will be as long as the number of expected mip maps.
-        AZStd::vector<CloudTextureSubresourceReadback> m_attachmentsReadbackData;
-        bool m_isReadbackComplete = false;
+
+        AZStd::vector<TextureTask> m_textureTasks;
     };
 } // namespace VolumetricClouds
@@ -0,0 +1,44 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <Atom/RPI.Public/Image/AttachmentImagePool.h>
+#include <Atom/RPI.Public/Image/ImageSystemInterface.h>
+
+#include "CloudTextureImagePool.h"
+
+namespace VolumetricClouds
+{
+    static constexpr char LogName[] = "CloudTextureImagePool";
+
+    CloudTextureAttachmentImageTraits::Image CloudTextureAttachmentImageTraits::CreateImage(const CloudTextureImagePoolKey& key)
+    {
+        AZ::RHI::ImageDescriptor imageDesc = AZ::RHI::ImageDescriptor::Create3D(
+            AZ::RHI::ImageBindFlags::ShaderReadWrite, key.m_pixelSize, key.m_pixelSize, key.m_pixelSize, key.m_format);
+        imageDesc.m_mipLevels = static_cast<uint16_t>(key.m_mipCount);
+        AZ::RHI::ClearValue clearValue = AZ::RHI::ClearValue::CreateVector4Float(0, 0, 0, 0);
+        AZ::Data::Instance<AZ::RPI::AttachmentImagePool> pool = AZ::RPI::ImageSystemInterface::Get()->GetSystemAttachmentPool();
+        auto image = AZ::RPI::AttachmentImage::Create(*pool.get(), imageDesc, AZ::Name("CloudTextureAttachmentImage"), &clearValue, nullptr);
+        AZ_Error(LogName, image, "Failed to create a %ux%ux%u attachment image.", key.m_pixelSize, key.m_pixelSize, key.m_pixelSize);
+        return image;
+    }
+
+    CloudTextureImagePoolKey CloudTextureAttachmentImageTraits::GetKey(const Image& image)
+    {
+        const auto& imageDesc = image->GetDescriptor();
+        CloudTextureImagePoolKey key;
+        key.m_pixelSize = imageDesc.m_size.m_width;
+        key.m_mipCount = imageDesc.m_mipLevels;
+        key.m_format = imageDesc.m_format;
+        return key;
+    }
+
+    uint32_t CloudTextureAttachmentImageTraits::GetUseCount(const Image& image)
+    {
+        return static_cast<uint32_t>(image->use_count());
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,214 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/list.h>
+
+#include <Atom/RHI.Reflect/Format.h>
+#include <Atom/RPI.Public/Image/AttachmentImage.h>
+
+namespace VolumetricClouds
+{
+    // Images are matched by pixel size, mip count and format.
+    struct CloudTextureImagePoolKey
+    {
+        uint32_t m_pixelSize = 0;
+        uint32_t m_mipCount = 0;
+        AZ::RHI::Format m_format = AZ::RHI::Format::Unknown;
+
+        bool operator==(const CloudTextureImagePoolKey& other) const
+        {
+            return (m_pixelSize == other.m_pixelSize) && (m_mipCount == other.m_mipCount) && (m_format == other.m_format);
+        }
+
+        // Size of the whole mip chain.
+        uint64_t CalculateSizeInBytes() const
+        {
+            const uint64_t bytesPerPixel = AZ::RHI::GetFormatSize(m_format);
+            uint64_t sizeInBytes = 0;
+            for (uint32_t mipLevel = 0; mipLevel < m_mipCount; mipLevel++)
+            {
+                const uint64_t mipSize = AZStd::max(m_pixelSize >> mipLevel, 1u);
+                sizeInBytes += mipSize * mipSize * mipSize * bytesPerPixel;
+            }
+            return sizeInBytes;
+        }
+    };
+
+    struct CloudTextureImagePoolStats
+    {
+        // Images created from the system attachment pool.
+        uint64_t m_allocations = 0;
+        // Requests served with a recycled image, each one is an allocation avoided.
+        uint64_t m_reuses = 0;
+        // Available images destroyed to stay within the memory limit.
+        uint64_t m_evictions = 0;
+        uint64_t m_pendingImageCount = 0;
+        uint64_t m_availableImageCount = 0;
+        uint64_t m_availableSizeInBytes = 0;
+    };
+
+    // Recycles the 3D images where the cloud noise textures are generated.
+    // Tweaking a noise texture in the Editor generates a new texture each time, and without
+    // this pool each one would be a new allocation (64MB for a 256^3 RGBA8 texture).
+    // A released image is not reusable right away. It stays pending until @releaseDelayFrames calls
+    // to Update() went by, for the frames in flight, AND the pool holds the last reference to it, because
+    // the readers that were notified with the texture (e.g. the Cloudscape, the debug viewer) may still sample it.
+    // Only the memory of the available images counts against the limit, the images
+    // in use are never evicted. The least recently released images are evicted first.
+    // @ImageTraits Provides the Image handle type, and how to create it, get its key and its use count.
+    //              See CloudTextureAttachmentImageTraits. The unit tests use fake images.
+    template<typename ImageTraits>
+    class CloudTextureImagePoolBase final
+    {
+    public:
+        static constexpr uint32_t DefaultReleaseDelayFrames = 8;
+
+        using Image = typename ImageTraits::Image;
+        using Key = CloudTextureImagePoolKey;
+        using Stats = CloudTextureImagePoolStats;
+
+        CloudTextureImagePoolBase(uint64_t maxSizeInBytes, uint32_t releaseDelayFrames = DefaultReleaseDelayFrames)
+            : m_maxSizeInBytes(maxSizeInBytes)
+            , m_releaseDelayFrames(releaseDelayFrames)
+        {
+        }
+        ~CloudTextureImagePoolBase() = default;
+
+        // Returns an available image that matches @key, or creates a new one.
+        Image Acquire(const Key& key)
+        {
+            for (auto itor = m_availableImages.begin(); itor != m_availableImages.end(); ++itor)
+            {
+                if (itor->m_key == key)
+                {
+                    Image image = AZStd::move(itor->m_image);
+                    m_stats.m_availableSizeInBytes -= itor->m_sizeInBytes;
+                    m_availableImages.erase(itor);
+                    m_stats.m_reuses++;
+                    return image;
+                }
+            }
+
+            Image image = ImageTraits::CreateImage(key);
+            if (image)
+            {
+                m_stats.m_allocations++;
+            }
+            return image;
+        }
+
+        // The caller gives up its reference to @image. The image becomes available once nobody else references it.
+        // @currentFrame Same frame counter that is given to Update().
+        void Release(Image image, uint64_t currentFrame)
+        {
+            if (!image)
+            {
+                return;
+            }
+            m_pendingImages.push_back({ AZStd::move(image), currentFrame });
+        }
+
+        // Makes available the images that were released long enough ago, and are only referenced by the pool.
+        // Call once per frame.
+        void Update(uint64_t currentFrame)
+        {
+            // An image still referenced doesn't block the ones released after it.
+            for (auto itor = m_pendingImages.begin(); itor != m_pendingImages.end();)
+            {
+                const bool isDelayOver = (currentFrame - itor->m_releaseFrame) >= m_releaseDelayFrames;
+                if (!isDelayOver || (ImageTraits::GetUseCount(itor->m_image) > 1))
+                {
+                    ++itor;
+                    continue;
+                }
+                AvailableImage availableImage;
+                availableImage.m_image = AZStd::move(itor->m_image);
+                itor = m_pendingImages.erase(itor);
+                availableImage.m_key = ImageTraits::GetKey(availableImage.m_image);
+                availableImage.m_sizeInBytes = availableImage.m_key.CalculateSizeInBytes();
+                m_stats.m_availableSizeInBytes += availableImage.m_sizeInBytes;
+                m_availableImages.push_front(AZStd::move(availableImage));
+            }
+            EvictIfNeeded();
+        }
+
+        // Evicts available images right away if they take more than @maxSizeInBytes.
+        void SetMaxSizeInBytes(uint64_t maxSizeInBytes)
+        {
+            m_maxSizeInBytes = maxSizeInBytes;
+            EvictIfNeeded();
+        }
+
+        // Drops all the pending and available images.
+        void Clear()
+        {
+            m_pendingImages.clear();
+            m_availableImages.clear();
+            m_stats.m_availableSizeInBytes = 0;
+        }
+
+        Stats GetStats() const
+        {
+            Stats stats = m_stats;
+            stats.m_pendingImageCount = m_pendingImages.size();
+            stats.m_availableImageCount = m_availableImages.size();
+            return stats;
+        }
+
+    private:
+        AZ_DISABLE_COPY_MOVE(CloudTextureImagePoolBase);
+
+        struct PendingImage
+        {
+            Image m_image;
+            uint64_t m_releaseFrame = 0;
+        };
+
+        struct AvailableImage
+        {
+            Image m_image;
+            Key m_key;
+            uint64_t m_sizeInBytes = 0;
+        };
+
+        void EvictIfNeeded()
+        {
+            while (!m_availableImages.empty() && (m_stats.m_availableSizeInBytes > m_maxSizeInBytes))
+            {
+                m_stats.m_availableSizeInBytes -= m_availableImages.back().m_sizeInBytes;
+                m_availableImages.pop_back();
+                m_stats.m_evictions++;
+            }
+        }
+
+        uint64_t m_maxSizeInBytes = 0;
+        uint32_t m_releaseDelayFrames = DefaultReleaseDelayFrames;
+
+        // Ordered by release frame.
+        AZStd::list<PendingImage> m_pendingImages;
+        // Front is the most recently released image.
+        AZStd::list<AvailableImage> m_availableImages;
+        Stats m_stats;
+    };
+
+    // The 3D attachment images of the CloudTexturesComputeFeatureProcessor, created from the system attachment pool.
+    struct CloudTextureAttachmentImageTraits
+    {
+        using Image = AZ::Data::Instance<AZ::RPI::AttachmentImage>;
+
+        static Image CreateImage(const CloudTextureImagePoolKey& key);
+        static CloudTextureImagePoolKey GetKey(const Image& image);
+        // Number of Instance references to @image, the one of the pool included.
+        static uint32_t GetUseCount(const Image& image);
+    };
+
+    using CloudTextureImagePool = CloudTextureImagePoolBase<CloudTextureAttachmentImageTraits>;
+
+} // namespace VolumetricClouds
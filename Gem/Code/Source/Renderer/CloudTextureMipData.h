@@ -0,0 +1,26 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/smart_ptr/shared_ptr.h>
+
+#include <Atom/RHI.Reflect/Size.h>
+
+namespace VolumetricClouds
+{
+    // CPU copy of a single mip level of a cloud noise Texture3D.
+    // The pixel data is RGBA8, tightly packed, slice after slice.
+    struct CloudTextureMipData
+    {
+        AZStd::shared_ptr<AZStd::vector<uint8_t>> m_dataBuffer;
+        uint16_t m_mipSlice = 0;
+        AZ::RHI::Size m_mipSize = {};
+    };
+
+} // namespace VolumetricClouds
@@ -5,16 +5,52 @@
 *
 */
 
+#include <AzCore/Console/ConsoleTypeHelpers.h>
+#include <AzCore/Console/IConsole.h>
+#include <AzCore/IO/FileIO.h>
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/Jobs/JobFunction.h>
+#include <AzCore/Math/MathUtils.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/parallel/lock.h>
+
+#include <Atom/RHI.Reflect/ImageSubresource.h>
 #include <Atom/RPI.Public/Image/AttachmentImagePool.h>
+#include <Atom/RPI.Public/Image/ImageSystemInterface.h>
+#include <Atom/RPI.Public/Image/StreamingImage.h>
+#include <Atom/RPI.Public/Image/StreamingImagePool.h>
 #include <Atom/RPI.Public/RenderPipeline.h>
 #include <Atom/RPI.Public/Scene.h>
-#include <Atom/RPI.Public/Image/ImageSystemInterface.h>
+#include <Atom/RPI.Reflect/Image/ImageMipChainAssetCreator.h>
+#include <Atom/RPI.Reflect/Image/StreamingImageAssetCreator.h>
 
+#include <Renderer/Cpu/CloudTextureStatistics.h>
 #include <Renderer/Passes/CloudTextureComputePass.h>
 #include "CloudTexturesComputeFeatureProcessor.h"
 
+AZ_CVAR(bool, r_cloudTextureCacheEnabled, true, nullptr, AZ::ConsoleFunctorFlags::Null,
+    "When true, generated cloud noise textures are stored on disk, and loaded from disk instead of being computed again. "
+    "Changes take effect the next time the CloudTexturesComputeFeatureProcessor is activated.");
+AZ_CVAR(uint32_t, r_cloudTextureCacheMaxSizeMB, 512, nullptr, AZ::ConsoleFunctorFlags::Null,
+    "Maximum size, in megabytes, of the on-disk cache of cloud noise textures. Least recently used textures are deleted first.");
+AZ_CVAR(uint32_t, r_cloudTextureFrameBudgetUs, 2000, nullptr, AZ::ConsoleFunctorFlags::Null,
+    "GPU time budget, in microseconds, per frame, for the generation of cloud noise textures. "
+    "The texture is generated in bricks, across as many frames as needed. 0 generates the whole texture in one frame.");
+AZ_CVAR(uint32_t, r_cloudTextureBrickSize, VolumetricClouds::CloudTextureBrickScheduler::DefaultBrickSize, nullptr, AZ::ConsoleFunctorFlags::Null,
+    "Size in pixels of the bricks used to generate cloud noise textures. Must be a power of two, and at least 4.");
+AZ_CVAR(uint32_t, r_cloudTextureBatchSize, VolumetricClouds::CloudTextureComputePipeline::MaxBatchSize, nullptr, AZ::ConsoleFunctorFlags::Null,
+    "Maximum number of queued cloud noise textures that are generated together by the same compute pipeline. "
+    "1 generates one texture at a time.");
+AZ_CVAR(uint32_t, r_cloudTextureImagePoolMaxSizeMB, 256, nullptr, AZ::ConsoleFunctorFlags::Null,
+    "Maximum size, in megabytes, of the unused 3D attachment images that are kept around to be recycled by new cloud noise textures.");
+AZ_CVAR(bool, r_cloudTexturePersistentPipeline, true, nullptr, AZ::ConsoleFunctorFlags::Null,
+    "When true, the render pipeline that generates cloud noise textures is created once and reused by all requests. "
+    "When false, a new render pipeline is created for each batch of requests, and removed from the scene when done.");
+
 namespace VolumetricClouds
 {
+    static constexpr char CloudTextureCacheFolder[] = "@user@/VolumetricClouds/CloudTextureCache";
+
     void CloudTexturesComputeFeatureProcessor::Reflect(AZ::ReflectContext* context)
     {
         if (auto* serializeContext = azrtti_cast<AZ::SerializeContext*>(context))
@@ -30,6 +66,24 @@ namespace VolumetricClouds
     void CloudTexturesComputeFeatureProcessor::Activate()
     {
         ActivateComputeScene();
+
+        m_imagePool = AZStd::make_unique<CloudTextureImagePool>(GetImagePoolMaxSizeInBytes());
+        m_calculatedTextures = AZStd::make_shared<CalculatedTextureQueue>();
+        m_loadedTextures = AZStd::make_shared<LoadedTextureQueue>();
+
+        auto fileIO = AZ::IO::FileIOBase::GetInstance();
+        if (r_cloudTextureCacheEnabled && fileIO)
+        {
+            if (auto cacheFolder = fileIO->ResolvePath(AZ::IO::PathView(CloudTextureCacheFolder)); cacheFolder.has_value())
+            {
+                const uint64_t maxSizeInBytes = static_cast<uint64_t>(static_cast<uint32_t>(r_cloudTextureCacheMaxSizeMB)) * 1024 * 1024;
+                m_cache = AZStd::make_shared<CloudTextureCache>(AZ::IO::Path(cacheFolder->Native()), maxSizeInBytes);
+            }
+            else
+            {
+                AZ_Warning(LogName, false, "Failed to resolve %s. The cloud texture cache is disabled.", CloudTextureCacheFolder);
+            }
+        }
     }
 
     void CloudTexturesComputeFeatureProcessor::ActivateComputeScene()
@@ -48,7 +102,19 @@ namespace VolumetricClouds
 
     void CloudTexturesComputeFeatureProcessor::Deactivate()
     {
+        if (m_textureComputePipeline)
+        {
+            m_textureComputePipeline->Shutdown();
+            m_textureComputePipeline.reset();
+        }
+        m_benchmark.reset();
         m_computeRequests.clear();
+        // The jobs still running complete into their own reference to the queue.
+        m_calculatedTextures.reset();
+        m_loadedTextures.reset();
+        m_cache.reset();
+        m_entityImages.clear();
+        m_imagePool.reset();
 
         DeactivateComputeScene();
     }
@@ -69,35 +135,77 @@ namespace VolumetricClouds
 
     void CloudTexturesComputeFeatureProcessor::OnRenderEnd()
     {
-        // // The C++ 20 new way to do remove erase if.
-        // AZStd::erase_if(m_cloudTextureComputeTasks, [](AZStd::shared_ptr<CloudTextureComputePipeline>& renderer) {
-        //     renderer->CheckAndRemovePipeline();
-        //     return !renderer->IsRenderingNoiseTexture();
-        // });
-        if (m_currentCloudTextureComputeTask)
+        m_frameCounter++;
+        if (m_benchmark && m_benchmark->IsComplete())
         {
-            m_currentCloudTextureComputeTask->CheckAndRemovePipeline();
-            if (m_currentCloudTextureComputeTask->IsRenderingNoiseTexture())
+            m_benchmark->PrintResults(m_frameCounter);
+            for (uint32_t requestIndex = 0; requestIndex < m_benchmark->m_requestCount; requestIndex++)
             {
+                ReleaseTexture(AZ::EntityId(BenchmarkEntityIdBase + requestIndex));
+            }
+            const auto poolStats = m_imagePool->GetStats();
+            AZ_Printf(LogName, "Image pool: %llu allocations, %llu reuses, %llu evictions.\n",
+                static_cast<unsigned long long>(poolStats.m_allocations), static_cast<unsigned long long>(poolStats.m_reuses),
+                static_cast<unsigned long long>(poolStats.m_evictions));
+            m_benchmark.reset();
+        }
+
+        m_imagePool->SetMaxSizeInBytes(GetImagePoolMaxSizeInBytes());
+        m_imagePool->Update(m_frameCounter);
+
+        CompleteLoadedTextures();
+        CompleteCalculatedTextures();
+
+        if (m_textureComputePipeline && m_textureComputePipeline->IsRenderingNoiseTexture())
+        {
+            m_textureComputePipeline->CheckTextureCompletion();
+            if (m_textureComputePipeline->IsRenderingNoiseTexture())
+            {
+                m_textureComputePipeline->DispatchNextBricks(r_cloudTextureFrameBudgetUs);
                 return;
             }
-            m_currentCloudTextureComputeTask.reset();
         }
 
-        while (!m_cloudTextureComputeTasks.empty())
+        if (m_textureComputePipeline && !r_cloudTexturePersistentPipeline)
+        {
+            m_textureComputePipeline->Shutdown();
+            m_textureComputePipeline.reset();
+        }
+
+        // Drain the queue into a single batch, so all the pending textures
+        // are generated by the same CloudTextureComputePipeline.
+        const uint32_t maxBatchSize = AZStd::clamp(static_cast<uint32_t>(r_cloudTextureBatchSize), 1u, CloudTextureComputePipeline::MaxBatchSize);
+        AZStd::vector<AZ::EntityId> batchEntityIds;
+        while (!m_cloudTextureComputeTasks.empty() && (batchEntityIds.size() < maxBatchSize))
         {
             AZ::EntityId entityId = m_cloudTextureComputeTasks.front();
+            if (AZStd::find(batchEntityIds.begin(), batchEntityIds.end(), entityId) != batchEntityIds.end())
+            {
+                // The entity was enqueued again, it will be part of the next batch.
+                break;
+            }
+            if (auto requestItor = m_computeRequests.find(entityId); (requestItor != m_computeRequests.end())
+                && (requestItor->second.m_isCompleting || requestItor->second.m_isLoadingFromCache))
+            {
+                // Its previous texture is still loaded, or its stats calculated, its events must be signaled first.
+                break;
+            }
             m_cloudTextureComputeTasks.pop_front();
             if (!m_computeRequests.contains(entityId))
             {
                 AZ_Info(LogName, "CloudTextureComputeRequest with entityId=%s already gone.\n", entityId.ToString().c_str());
                 continue;
             }
-            auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
-            m_currentCloudTextureComputeTask = CreateTextureComputeTask(CloudTextureComputeRequest);
-            AZ_Info(LogName, "Created new compute task id=%u for entityId=%s.\n",
-                CloudTextureComputeRequest.m_textureComputeTaskId, entityId.ToString().c_str());
-            break;
+            if (StartCacheLoad(entityId))
+            {
+                continue;
+            }
+            batchEntityIds.push_back(entityId);
+        }
+
+        if (!batchEntityIds.empty())
+        {
+            StartTextureComputeBatch(batchEntityIds);
         }
 
     }
@@ -114,7 +222,6 @@ namespace VolumetricClouds
         , CloudTexturesComputeFeatureProcessor::ReadbackEvent::Handler* readbackHandler)
     {
         CloudTextureComputeRequest newRequest;
-        newRequest.m_cloudTextureAttachment = CreateTexture3DAttachmentImage(computeData.m_pixelSize);
         newRequest.m_computeData = computeData;
         newRequest.m_withAttachmentReadback = (readbackHandler != nullptr);
         newRequest.m_textureComputeTaskId = 0; // A valid value will be assigned when the compute pipeline is created for this request.
@@ -139,25 +246,62 @@ namespace VolumetricClouds
         m_cloudTextureComputeTasks.push_back(entityId);
         return true;
     }
+
+    void CloudTexturesComputeFeatureProcessor::ReleaseTexture(const AZ::EntityId& entityId)
+    {
+        auto itor = m_entityImages.find(entityId);
+        if (itor == m_entityImages.end())
+        {
+            return;
+        }
+        m_imagePool->Release(AZStd::move(itor->second), m_frameCounter);
+        m_entityImages.erase(itor);
+    }
+
+    CloudTextureCache::Stats CloudTexturesComputeFeatureProcessor::GetCacheStats() const
+    {
+        return m_cache ? m_cache->GetStats() : CloudTextureCache::Stats{};
+    }
+
+    CloudTextureImagePool::Stats CloudTexturesComputeFeatureProcessor::GetImagePoolStats() const
+    {
+        return m_imagePool ? m_imagePool->GetStats() : CloudTextureImagePool::Stats{};
+    }
     //! Functions called by CloudscapeComponentController END
     /////////////////////////////////////////////////////////////////////
 
-    AZ::Data::Instance<AZ::RPI::AttachmentImage> CloudTexturesComputeFeatureProcessor::CreateTexture3DAttachmentImage(uint32_t pixelSize)
+    AZ::Data::Instance<AZ::RPI::AttachmentImage> CloudTexturesComputeFeatureProcessor::CreateTexture3DAttachmentImage(const CloudTextureComputeData& computeData)
     {
-        AZ::RHI::ImageDescriptor imageDesc = AZ::RHI::ImageDescriptor::Create3D(
-            AZ::RHI::ImageBindFlags::ShaderReadWrite, pixelSize, pixelSize, pixelSize, AZ::RHI::Format::R8G8B8A8_UNORM);
-        imageDesc.m_mipLevels = CloudTextureComputePass::CalculateMipCount(pixelSize);
-        AZ::RHI::ClearValue clearValue = AZ::RHI::ClearValue::CreateVector4Float(0, 0, 0, 0);
-        AZ::Data::Instance<AZ::RPI::AttachmentImagePool> pool = AZ::RPI::ImageSystemInterface::Get()->GetSystemAttachmentPool();
-        return AZ::RPI::AttachmentImage::Create(*pool.get(), imageDesc, AZ::Name("CloudTextureAttachmentImage"), &clearValue, nullptr);
+        CloudTextureImagePool::Key key;
+        key.m_pixelSize = computeData.m_pixelSize;
+        key.m_mipCount = CloudTextureComputePass::CalculateMipCount(computeData.m_pixelSize);
+        key.m_format = CloudTextureComputePass::GetImageFormat(static_cast<CloudTextureChannelLayout>(computeData.m_channelLayout));
+        return m_imagePool->Acquire(key);
+    }
+
+    uint64_t CloudTexturesComputeFeatureProcessor::GetImagePoolMaxSizeInBytes()
+    {
+        return static_cast<uint64_t>(static_cast<uint32_t>(r_cloudTextureImagePoolMaxSizeMB)) * 1024 * 1024;
     }
 
 
-    AZStd::shared_ptr<CloudTextureComputePipeline> CloudTexturesComputeFeatureProcessor::CreateTextureComputeTask(CloudTextureComputeRequest& CloudTextureComputeRequest)
+    void CloudTexturesComputeFeatureProcessor::StartTextureComputeBatch(const AZStd::vector<AZ::EntityId>& batchEntityIds)
     {
-        auto texture3DReadyCB = [&](CloudTextureComputePipeline::RenderTaskId textureComputeTaskId,
-                                    const AZStd::vector<CloudTextureComputePipeline::CloudTextureSubresourceReadback>& readbackResults) {
-            AZ::EntityId foundEntityId;
+        if (!m_textureComputePipeline)
+        {
+            m_textureComputePipeline = AZStd::make_unique<CloudTextureComputePipeline>();
+            if (!m_textureComputePipeline->Initialize(m_computeScene.get()))
+            {
+                AZ_Error(LogName, false, "Failed to initialize the cloud texture compute pipeline.");
+                m_textureComputePipeline.reset();
+                OnTextureComputeStartFailed(batchEntityIds);
+                return;
+            }
+        }
+
+        // Called once for each texture of the batch.
+        auto texture3DReadyCB = [this](CloudTextureComputePipeline::RenderTaskId textureComputeTaskId,
+                                       const AZStd::vector<CloudTextureComputePipeline::CloudTextureSubresourceReadback>& readbackResults) {
             for (auto& [entityId, CloudTextureComputeRequest] : m_computeRequests)
             {
                 if (CloudTextureComputeRequest.m_textureComputeTaskId != textureComputeTaskId)
@@ -165,47 +309,472 @@ namespace VolumetricClouds
                     continue;
                 }
 
-                foundEntityId = entityId;
-
-                CloudTextureComputeRequest.m_readyEvent.Signal(CloudTextureComputeRequest.m_cloudTextureAttachment);
-                for (const auto & subresourceReadback : readbackResults)
+                if (m_cache && !readbackResults.empty() && !CloudTextureComputeRequest.m_skipCache)
                 {
-                    CloudTextureComputeRequest.m_readbackEvent.Signal(CloudTextureComputeRequest.m_cloudTextureAttachment,
-                        subresourceReadback.m_dataBuffer, subresourceReadback.m_mipSlice, subresourceReadback.m_mipSize);
+                    StoreInCache(CloudTextureComputeRequest.m_computeData, readbackResults);
                 }
 
-                CloudTextureComputeRequest.m_textureComputeTaskId = 0;
-                CloudTextureComputeRequest.m_withAttachmentReadback = false;
-
+                // Copy the key, OnTextureComputeComplete may erase the request.
+                const AZ::EntityId foundEntityId = entityId;
+                OnTextureComputeComplete(foundEntityId, CloudTextureComputeRequest.m_cloudTextureAttachment, readbackResults);
                 break;
             }
-            if (foundEntityId.IsValid())
+        };
+
+        AZStd::vector<CloudTextureComputePipeline::TextureComputeRequest> textureRequests;
+        textureRequests.reserve(batchEntityIds.size());
+        for (const auto& entityId : batchEntityIds)
+        {
+            auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
+            CloudTextureComputeRequest.m_cloudTextureAttachment = CreateTexture3DAttachmentImage(CloudTextureComputeRequest.m_computeData);
+
+            auto& textureRequest = textureRequests.emplace_back();
+            textureRequest.m_texture3DAttachment = CloudTextureComputeRequest.m_cloudTextureAttachment;
+            textureRequest.m_computeData = CloudTextureComputeRequest.m_computeData;
+            // The readback is also needed to fill the cache, and to renormalize the channels,
+            // even if the requester didn't ask for it.
+            textureRequest.m_withAttachmentReadback = CloudTextureComputeRequest.m_withAttachmentReadback
+                || (m_cache && !CloudTextureComputeRequest.m_skipCache)
+                || CloudTextureComputeRequest.m_computeData.m_normalizeChannelRange;
+        }
+
+        const auto textureComputeTaskIds = m_textureComputePipeline->StartTextureCompute(
+            textureRequests,
+            texture3DReadyCB,
+            GetBrickSize(),
+            r_cloudTextureFrameBudgetUs);
+        if (textureComputeTaskIds.size() != batchEntityIds.size())
+        {
+            AZ_Error(LogName, false, "Failed to start the compute pipeline for %zu cloud textures.", batchEntityIds.size());
+            OnTextureComputeStartFailed(batchEntityIds);
+            return;
+        }
+        for (size_t taskIndex = 0; taskIndex < textureComputeTaskIds.size(); taskIndex++)
+        {
+            const AZ::EntityId& entityId = batchEntityIds[taskIndex];
+            m_computeRequests.at(entityId).m_textureComputeTaskId = textureComputeTaskIds[taskIndex];
+            AZ_Info(LogName, "Created new compute task id=%u for entityId=%s.\n", textureComputeTaskIds[taskIndex], entityId.ToString().c_str());
+        }
+    }
+
+    void CloudTexturesComputeFeatureProcessor::OnTextureComputeStartFailed(const AZStd::vector<AZ::EntityId>& batchEntityIds)
+    {
+        for (const auto& entityId : batchEntityIds)
+        {
+            auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
+            // Nothing was dispatched, so the attachment image can go back to the pool.
+            m_imagePool->Release(AZStd::move(CloudTextureComputeRequest.m_cloudTextureAttachment), m_frameCounter);
+            CloudTextureComputeRequest.m_cloudTextureAttachment = nullptr;
+
+            if (IsEntityQueued(entityId))
+            {
+                // Enqueued again in the meantime, that request will be the next attempt.
+                continue;
+            }
+
+            CloudTextureComputeRequest.m_startAttemptCount++;
+            if (CloudTextureComputeRequest.m_startAttemptCount < MaxStartAttemptCount)
+            {
+                // E.g. the shaders are not ready yet. Try again with the next batch.
+                m_cloudTextureComputeTasks.push_back(entityId);
+                continue;
+            }
+
+            AZ_Error(LogName, false, "Giving up on the cloud texture of entityId=%s after %u failed attempts.",
+                entityId.ToString().c_str(), CloudTextureComputeRequest.m_startAttemptCount);
+            CloudTextureComputeRequest.m_readyEvent.Signal(nullptr, nullptr);
+            if (!IsEntityQueued(entityId))
+            {
+                m_computeRequests.erase(entityId);
+            }
+        }
+    }
+
+    bool CloudTexturesComputeFeatureProcessor::IsEntityQueued(const AZ::EntityId& entityId) const
+    {
+        return AZStd::find(m_cloudTextureComputeTasks.begin(), m_cloudTextureComputeTasks.end(), entityId) != m_cloudTextureComputeTasks.end();
+    }
+
+    void CloudTexturesComputeFeatureProcessor::OnTextureComputeComplete(const AZ::EntityId& entityId, AZ::Data::Instance<AZ::RPI::Image> image,
+        const AZStd::vector<CloudTextureMipData>& mipLevels)
+    {
+        auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
+        CloudTextureComputeRequest.m_textureComputeTaskId = 0;
+        if (mipLevels.empty())
+        {
+            FinishTextureCompute(entityId, image, nullptr, {});
+            return;
+        }
+
+        CloudTextureComputeRequest.m_isCompleting = true;
+        CloudTextureComputeRequest.m_completedImage = image;
+        CloudTextureComputeRequest.m_completedMipLevels = mipLevels;
+
+        // Up to 64MB are scanned, and renormalized, for a 256^3 RGBA8 texture, which is too slow for the render thread.
+        // The readback buffers are shared, so nothing is copied.
+        const auto format = CloudTextureComputePass::GetImageFormat(
+            static_cast<CloudTextureChannelLayout>(CloudTextureComputeRequest.m_computeData.m_channelLayout));
+        auto statsFunction = [calculatedTextures = m_calculatedTextures, entityId, format,
+            normalizeChannelRange = CloudTextureComputeRequest.m_computeData.m_normalizeChannelRange, mipLevels]()
+        {
+            CalculatedTexture calculatedTexture;
+            calculatedTexture.m_entityId = entityId;
+            calculatedTexture.m_stats = CalculateStatsAndNormalize(format, normalizeChannelRange, mipLevels, calculatedTexture.m_normalizedMipLevels);
+            AZStd::scoped_lock lock(calculatedTextures->m_mutex);
+            calculatedTextures->m_textures.push_back(AZStd::move(calculatedTexture));
+        };
+
+        if (!AZ::JobContext::GetGlobalContext())
+        {
+            statsFunction();
+            return;
+        }
+        AZ::Job* statsJob = AZ::CreateJobFunction(AZStd::move(statsFunction), true);
+        statsJob->Start();
+    }
+
+    void CloudTexturesComputeFeatureProcessor::CompleteCalculatedTextures()
+    {
+        AZStd::vector<CalculatedTexture> calculatedTextures;
+        {
+            AZStd::scoped_lock lock(m_calculatedTextures->m_mutex);
+            AZStd::swap(calculatedTextures, m_calculatedTextures->m_textures);
+        }
+
+        for (auto& calculatedTexture : calculatedTextures)
+        {
+            const AZ::EntityId& entityId = calculatedTexture.m_entityId;
+            auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
+            AZ::Data::Instance<AZ::RPI::Image> image = AZStd::move(CloudTextureComputeRequest.m_completedImage);
+            auto& normalizedMipLevels = calculatedTexture.m_normalizedMipLevels;
+            if (!normalizedMipLevels.empty())
             {
-                // We will erase this entity from the map if it is not in the queue.
-                bool foundInQueue = false;
-                for (const auto& entityId : m_cloudTextureComputeTasks)
+                const auto format = CloudTextureComputePass::GetImageFormat(
+                    static_cast<CloudTextureChannelLayout>(CloudTextureComputeRequest.m_computeData.m_channelLayout));
+                auto normalizedImage = CreateTexture3DFromMipChain(normalizedMipLevels, format);
+                if (normalizedImage)
                 {
-                    if (entityId == foundEntityId)
+                    image = normalizedImage;
+                    // Nobody reads the GPU generated texture, so its attachment image can be recycled right away.
+                    if (CloudTextureComputeRequest.m_cloudTextureAttachment)
                     {
-                        foundInQueue = true;
-                        break;
+                        m_imagePool->Release(AZStd::move(CloudTextureComputeRequest.m_cloudTextureAttachment), m_frameCounter);
+                        CloudTextureComputeRequest.m_cloudTextureAttachment = nullptr;
                     }
                 }
-                if (!foundInQueue)
+                else
                 {
-                    m_computeRequests.erase(foundEntityId);
+                    AZ_Error(LogName, false, "Failed to create the normalized cloud texture. The texture is used as is.");
+                    normalizedMipLevels.clear();
+                    CloudTextureStatistics::Calculate(format, CloudTextureComputeRequest.m_completedMipLevels, *calculatedTexture.m_stats);
                 }
             }
+            FinishTextureCompute(entityId, image, calculatedTexture.m_stats, normalizedMipLevels);
+        }
+    }
+
+    void CloudTexturesComputeFeatureProcessor::FinishTextureCompute(const AZ::EntityId& entityId, AZ::Data::Instance<AZ::RPI::Image> image,
+        AZStd::shared_ptr<const CloudTextureStats> stats, const AZStd::vector<CloudTextureMipData>& normalizedMipLevels)
+    {
+        auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
+        CloudTextureComputeRequest.m_readyEvent.Signal(image, stats);
+
+        // The readers of the previous texture of this entity were just given the new one,
+        // so the previous attachment image can go back to the pool.
+        ReleaseTexture(entityId);
+        if (CloudTextureComputeRequest.m_cloudTextureAttachment)
+        {
+            m_entityImages.emplace(entityId, AZStd::move(CloudTextureComputeRequest.m_cloudTextureAttachment));
+        }
+        if (CloudTextureComputeRequest.m_withAttachmentReadback)
+        {
+            // The readers get the same texels as the texture, normalized or not.
+            const auto& readbackMipLevels = normalizedMipLevels.empty() ? CloudTextureComputeRequest.m_completedMipLevels : normalizedMipLevels;
+            for (const auto& subresourceReadback : readbackMipLevels)
+            {
+                CloudTextureComputeRequest.m_readbackEvent.Signal(image,
+                    subresourceReadback.m_dataBuffer, subresourceReadback.m_mipSlice, subresourceReadback.m_mipSize);
+            }
+        }
+
+        CloudTextureComputeRequest.m_withAttachmentReadback = false;
+        CloudTextureComputeRequest.m_isCompleting = false;
+        CloudTextureComputeRequest.m_cacheMissed = false;
+        CloudTextureComputeRequest.m_completedImage = nullptr;
+        CloudTextureComputeRequest.m_completedMipLevels.clear();
+
+        // We will erase this entity from the map if it is not in the queue.
+        if (!IsEntityQueued(entityId))
+        {
+            m_computeRequests.erase(entityId);
+        }
+    }
+
+    AZStd::shared_ptr<CloudTextureStats> CloudTexturesComputeFeatureProcessor::CalculateStatsAndNormalize(AZ::RHI::Format format,
+        bool normalizeChannelRange, const AZStd::vector<CloudTextureMipData>& mipLevels, AZStd::vector<CloudTextureMipData>& normalizedMipLevels)
+    {
+        auto stats = AZStd::make_shared<CloudTextureStats>();
+        if (!CloudTextureStatistics::Calculate(format, mipLevels, *stats))
+        {
+            return nullptr;
+        }
+        if (normalizeChannelRange && !CloudTextureStatistics::NormalizeChannelRange(format, mipLevels, *stats, normalizedMipLevels))
+        {
+            normalizedMipLevels.clear();
+        }
+        return stats;
+    }
+
+    uint32_t CloudTexturesComputeFeatureProcessor::GetBrickSize()
+    {
+        // The shader works in groups of 4x4x4 threads.
+        const uint32_t brickSize = AZStd::clamp(static_cast<uint32_t>(r_cloudTextureBrickSize),
+            CloudTextureComputePass::MIN_PIXEL_SIZE, CloudTextureComputePass::MAX_PIXEL_SIZE);
+        if (!AZ::IsPowerOfTwo(brickSize))
+        {
+            AZ_Warning(LogName, false, "r_cloudTextureBrickSize=%u is not a power of two. Using %u instead.",
+                brickSize, CloudTextureBrickScheduler::DefaultBrickSize);
+            return CloudTextureBrickScheduler::DefaultBrickSize;
+        }
+        return brickSize;
+    }
+
+    /////////////////////////////////////////////////////////////////////
+    //! Turnaround benchmark START
+    void CloudTexturesComputeFeatureProcessor::r_cloudTextureBenchmarkTurnaround(const AZ::ConsoleCommandContainer& arguments)
+    {
+        if (m_benchmark)
+        {
+            AZ_Warning(LogName, false, "A turnaround benchmark is already running.");
+            return;
+        }
+
+        uint32_t requestCount = 16;
+        uint32_t pixelSize = 64;
+        if (arguments.size() > 0)
+        {
+            AZ::ConsoleTypeHelpers::StringToValue(requestCount, arguments[0]);
+        }
+        if (arguments.size() > 1)
+        {
+            AZ::ConsoleTypeHelpers::StringToValue(pixelSize, arguments[1]);
+        }
+        requestCount = AZStd::clamp(requestCount, 1u, 256u);
+        pixelSize = AZStd::clamp(pixelSize, CloudTextureComputePass::MIN_PIXEL_SIZE, CloudTextureComputePass::MAX_PIXEL_SIZE);
+        if (!AZ::IsPowerOfTwo(pixelSize))
+        {
+            AZ_Error(LogName, false, "The pixel size must be a power of two. Got %u.", pixelSize);
+            return;
+        }
+
+        m_benchmark = AZStd::make_unique<TurnaroundBenchmark>();
+        m_benchmark->m_requestCount = requestCount;
+        m_benchmark->m_startFrame = m_frameCounter;
+        m_benchmark->m_startTime = AZStd::chrono::steady_clock::now();
+        // The handlers must not move once connected.
+        m_benchmark->m_readyHandlers.reserve(requestCount);
+        for (uint32_t requestIndex = 0; requestIndex < requestCount; requestIndex++)
+        {
+            CloudTextureComputeData computeData;
+            computeData.m_pixelSize = pixelSize;
+            computeData.m_frequency = static_cast<float>(1 + (requestIndex % 10));
+
+            auto& readyHandler = m_benchmark->m_readyHandlers.emplace_back([this](AZ::Data::Instance<AZ::RPI::Image>, AZStd::shared_ptr<const CloudTextureStats>)
+                {
+                    m_benchmark->m_completedCount++;
+                });
+            // Entity ids that won't collide with real entities.
+            const AZ::EntityId entityId(BenchmarkEntityIdBase + requestIndex);
+            EnqueueComputeRequest(entityId, computeData, readyHandler);
+            // Always measure the GPU path.
+            m_computeRequests.at(entityId).m_skipCache = true;
+        }
+
+        AZ_Printf(LogName, "Turnaround benchmark started: %u requests of %u pixels, persistent pipeline=%d, batch size=%u.\n",
+            requestCount, pixelSize, static_cast<bool>(r_cloudTexturePersistentPipeline), static_cast<uint32_t>(r_cloudTextureBatchSize));
+    }
+
+    void CloudTexturesComputeFeatureProcessor::TurnaroundBenchmark::PrintResults(uint64_t currentFrame) const
+    {
+        const auto elapsed = AZStd::chrono::steady_clock::now() - m_startTime;
+        const double milliseconds = AZStd::chrono::duration<double, AZStd::milli>(elapsed).count();
+        const uint64_t frames = currentFrame - m_startFrame;
+        AZ_Printf(LogName, "Turnaround benchmark: %u requests in %.3f ms and %llu frames. %.3f ms and %.2f frames per request.\n",
+            m_requestCount, milliseconds, static_cast<unsigned long long>(frames),
+            milliseconds / m_requestCount, static_cast<double>(frames) / m_requestCount);
+    }
+    //! Turnaround benchmark END
+    /////////////////////////////////////////////////////////////////////
+
+    /////////////////////////////////////////////////////////////////////
+    //! On-disk cache START
+    void CloudTexturesComputeFeatureProcessor::r_cloudTexturePrintCacheStats([[maybe_unused]] const AZ::ConsoleCommandContainer& arguments)
+    {
+        if (!m_cache)
+        {
+            AZ_Printf(LogName, "The on-disk cache is disabled. See r_cloudTextureCacheEnabled.\n");
+        }
+        else
+        {
+            const auto cacheStats = GetCacheStats();
+            AZ_Printf(LogName, "On-disk cache %s: %llu hits, %llu misses, %llu stores, %llu evictions, %llu entries, %llu bytes.\n",
+                m_cache->GetCacheFolder().c_str(), static_cast<unsigned long long>(cacheStats.m_hits),
+                static_cast<unsigned long long>(cacheStats.m_misses), static_cast<unsigned long long>(cacheStats.m_stores),
+                static_cast<unsigned long long>(cacheStats.m_evictions), static_cast<unsigned long long>(cacheStats.m_entryCount),
+                static_cast<unsigned long long>(cacheStats.m_sizeInBytes));
+        }
+
+        const auto poolStats = GetImagePoolStats();
+        AZ_Printf(LogName, "Image pool: %llu allocations, %llu reuses, %llu evictions, %llu pending, %llu available (%llu bytes).\n",
+            static_cast<unsigned long long>(poolStats.m_allocations), static_cast<unsigned long long>(poolStats.m_reuses),
+            static_cast<unsigned long long>(poolStats.m_evictions), static_cast<unsigned long long>(poolStats.m_pendingImageCount),
+            static_cast<unsigned long long>(poolStats.m_availableImageCount), static_cast<unsigned long long>(poolStats.m_availableSizeInBytes));
+    }
+
+    bool CloudTexturesComputeFeatureProcessor::StartCacheLoad(const AZ::EntityId& entityId)
+    {
+        auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
+        if (!m_cache || CloudTextureComputeRequest.m_skipCache || CloudTextureComputeRequest.m_cacheMissed)
+        {
+            return false;
+        }
+        CloudTextureComputeRequest.m_isLoadingFromCache = true;
+
+        // Reading the file takes several milliseconds for large textures, and the cache is locked
+        // while a store job writes another entry, so neither can happen on the render thread.
+        const uint64_t maxSizeInBytes = static_cast<uint64_t>(static_cast<uint32_t>(r_cloudTextureCacheMaxSizeMB)) * 1024 * 1024;
+        auto loadFunction = [cache = m_cache, loadedTextures = m_loadedTextures, entityId, maxSizeInBytes,
+            computeData = CloudTextureComputeRequest.m_computeData]()
+        {
+            cache->SetMaxSizeInBytes(maxSizeInBytes);
+            LoadedTexture loadedTexture;
+            loadedTexture.m_entityId = entityId;
+            cache->Load(computeData, loadedTexture.m_mipLevels);
+            AZStd::scoped_lock lock(loadedTextures->m_mutex);
+            loadedTextures->m_textures.push_back(AZStd::move(loadedTexture));
         };
 
-        auto textureComputeTask = AZStd::make_shared<CloudTextureComputePipeline>();
-        CloudTextureComputeRequest.m_textureComputeTaskId = textureComputeTask->StartTextureCompute(
-            m_computeScene.get(),
-            CloudTextureComputeRequest.m_cloudTextureAttachment,
-            CloudTextureComputeRequest.m_computeData,
-            texture3DReadyCB,
-            CloudTextureComputeRequest.m_withAttachmentReadback);
-        return textureComputeTask;
+        if (!AZ::JobContext::GetGlobalContext())
+        {
+            loadFunction();
+            return true;
+        }
+        AZ::Job* loadJob = AZ::CreateJobFunction(AZStd::move(loadFunction), true);
+        loadJob->Start();
+        return true;
     }
 
+    void CloudTexturesComputeFeatureProcessor::CompleteLoadedTextures()
+    {
+        AZStd::vector<LoadedTexture> loadedTextures;
+        {
+            AZStd::scoped_lock lock(m_loadedTextures->m_mutex);
+            AZStd::swap(loadedTextures, m_loadedTextures->m_textures);
+        }
+
+        for (const auto& loadedTexture : loadedTextures)
+        {
+            const AZ::EntityId& entityId = loadedTexture.m_entityId;
+            auto& CloudTextureComputeRequest = m_computeRequests.at(entityId);
+            CloudTextureComputeRequest.m_isLoadingFromCache = false;
+
+            const auto& mipLevels = loadedTexture.m_mipLevels;
+            AZ::Data::Instance<AZ::RPI::StreamingImage> image;
+            if (mipLevels.size() == CloudTextureComputePass::CalculateMipCount(CloudTextureComputeRequest.m_computeData.m_pixelSize))
+            {
+                const auto channelLayout = static_cast<CloudTextureChannelLayout>(CloudTextureComputeRequest.m_computeData.m_channelLayout);
+                image = CreateTexture3DFromMipChain(mipLevels, CloudTextureComputePass::GetImageFormat(channelLayout));
+            }
+            else if (!mipLevels.empty())
+            {
+                AZ_Warning(LogName, false, "Cached texture for entityId=%s has an unexpected number of mips. It will be computed again.",
+                    entityId.ToString().c_str());
+            }
+
+            if (!image)
+            {
+                // The next batch computes it, ahead of the requests queued while the file was read.
+                CloudTextureComputeRequest.m_cacheMissed = true;
+                if (!IsEntityQueued(entityId))
+                {
+                    m_cloudTextureComputeTasks.push_front(entityId);
+                }
+                continue;
+            }
+
+            AZ_Info(LogName, "Loaded cloud texture for entityId=%s from the cache.\n", entityId.ToString().c_str());
+            OnTextureComputeComplete(entityId, image, mipLevels);
+        }
+    }
+
+    AZ::Data::Instance<AZ::RPI::StreamingImage> CloudTexturesComputeFeatureProcessor::CreateTexture3DFromMipChain(const AZStd::vector<CloudTextureMipData>& mipLevels, AZ::RHI::Format format)
+    {
+        const AZ::RHI::Size& mip0Size = mipLevels[0].m_mipSize;
+        AZ::RHI::ImageDescriptor imageDesc = AZ::RHI::ImageDescriptor::Create3D(
+            AZ::RHI::ImageBindFlags::ShaderRead, mip0Size.m_width, mip0Size.m_height, mip0Size.m_depth, format);
+        imageDesc.m_mipLevels = static_cast<uint16_t>(mipLevels.size());
+        return CreateImageFromMipChain(imageDesc, mipLevels);
+    }
+
+    AZ::Data::Instance<AZ::RPI::StreamingImage> CloudTexturesComputeFeatureProcessor::CreateTexture2DFromMipChain(const AZStd::vector<CloudTextureMipData>& mipLevels, AZ::RHI::Format format)
+    {
+        const AZ::RHI::Size& mip0Size = mipLevels[0].m_mipSize;
+        AZ::RHI::ImageDescriptor imageDesc = AZ::RHI::ImageDescriptor::Create2D(
+            AZ::RHI::ImageBindFlags::ShaderRead, mip0Size.m_width, mip0Size.m_height, format);
+        imageDesc.m_mipLevels = static_cast<uint16_t>(mipLevels.size());
+        return CreateImageFromMipChain(imageDesc, mipLevels);
+    }
+
+    AZ::Data::Instance<AZ::RPI::StreamingImage> CloudTexturesComputeFeatureProcessor::CreateImageFromMipChain(const AZ::RHI::ImageDescriptor& imageDesc, const AZStd::vector<CloudTextureMipData>& mipLevels)
+    {
+        AZ::RPI::ImageMipChainAssetCreator mipChainCreator;
+        mipChainCreator.Begin(AZ::Uuid::CreateRandom(), imageDesc.m_mipLevels, 1);
+        for (const auto& mipData : mipLevels)
+        {
+            const auto layout = AZ::RHI::GetImageSubresourceLayout(imageDesc, AZ::RHI::ImageSubresource(mipData.m_mipSlice));
+            mipChainCreator.BeginMip(layout);
+            mipChainCreator.AddSubImage(mipData.m_dataBuffer->data(), mipData.m_dataBuffer->size());
+        }
+        AZ::Data::Asset<AZ::RPI::ImageMipChainAsset> mipChainAsset;
+        if (!mipChainCreator.End(mipChainAsset))
+        {
+            AZ_Error(LogName, false, "Failed to create the mip chain asset of a cloud texture.");
+            return nullptr;
+        }
+
+        AZ::RPI::StreamingImageAssetCreator imageCreator;
+        imageCreator.Begin(AZ::Uuid::CreateRandom());
+        imageCreator.SetImageDescriptor(imageDesc);
+        imageCreator.AddMipChainAsset(*mipChainAsset.Get());
+        imageCreator.SetFlags(AZ::RPI::StreamingImageFlags::NotStreamable);
+        imageCreator.SetPoolAssetId(AZ::RPI::ImageSystemInterface::Get()->GetSystemStreamingPool()->GetAssetId());
+        AZ::Data::Asset<AZ::RPI::StreamingImageAsset> imageAsset;
+        if (!imageCreator.End(imageAsset))
+        {
+            AZ_Error(LogName, false, "Failed to create the image asset of a cloud texture.");
+            return nullptr;
+        }
+
+        return AZ::RPI::StreamingImage::FindOrCreate(imageAsset);
+    }
+
+    void CloudTexturesComputeFeatureProcessor::StoreInCache(const CloudTextureComputeData& computeData, const AZStd::vector<CloudTextureMipData>& mipLevels)
+    {
+        // The job keeps the cache alive, and the readback buffers are shared, so nothing is copied.
+        auto storeFunction = [cache = m_cache, computeData, mipLevels]()
+        {
+            cache->Store(computeData, mipLevels);
+        };
+
+        if (!AZ::JobContext::GetGlobalContext())
+        {
+            storeFunction();
+            return;
+        }
+        AZ::Job* storeJob = AZ::CreateJobFunction(AZStd::move(storeFunction), true);
+        storeJob->Start();
+    }
+    //! On-disk cache END
+    /////////////////////////////////////////////////////////////////////
+
 } // namespace VolumetricClouds
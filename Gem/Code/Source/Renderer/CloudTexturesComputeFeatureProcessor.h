@@ -7,10 +7,18 @@
 
 #pragma once
 
+#include <AzCore/Console/IConsole.h>
+#include <AzCore/std/chrono/chrono.h>
 #include <AzCore/std/containers/deque.h>
+#include <AzCore/std/parallel/mutex.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
 #include <Atom/RPI.Public/FeatureProcessor.h>
+#include <Atom/RPI.Public/Image/StreamingImage.h>
 
+#include <VolumetricClouds/CloudTextureStats.h>
+#include "CloudTextureCache.h"
 #include "CloudTextureComputePipeline.h"
+#include "CloudTextureImagePool.h"
 
 namespace VolumetricClouds
 {
@@ -29,7 +37,11 @@ namespace VolumetricClouds
         virtual ~CloudTexturesComputeFeatureProcessor() = default;
 
         // With this we notify the caller the noise texture has been generated.
-        using TextureReadyEvent = AZ::Event<AZ::Data::Instance<AZ::RPI::Image> /*image*/>;
+        // @param image Null if the texture could not be generated.
+        // @param stats Per channel, per mip level, statistics of the texture. Null when the texture
+        //        was neither read back to the CPU nor loaded from the on-disk cache.
+        using TextureReadyEvent = AZ::Event<AZ::Data::Instance<AZ::RPI::Image> /*image*/,
+                                            AZStd::shared_ptr<const CloudTextureStats> /*stats*/>;
 
         // This event will be signaled each time a cpu data buffer has been readback
         // for a particular mip level.
@@ -50,6 +62,23 @@ namespace VolumetricClouds
                                    TextureReadyEvent::Handler& readyHandler,
                                    ReadbackEvent::Handler* readbackHandler = nullptr);
 
+        // Called when the entity no longer needs its texture. If the texture was generated on the GPU,
+        // its attachment image goes back to the pool, and is recycled by other requests once the entity
+        // and the readers it notified drop their references to it.
+        void ReleaseTexture(const AZ::EntityId& entityId);
+
+        // Hit/miss counters of the on-disk cache. All zeros if the cache is disabled.
+        CloudTextureCache::Stats GetCacheStats() const;
+
+        // Counters of the pool of 3D attachment images. m_reuses is the number of allocations avoided.
+        CloudTextureImagePool::Stats GetImagePoolStats() const;
+
+        // Creates a non streamable Texture3D from a mip chain that is already in memory,
+        // e.g. loaded from the on-disk cache or from a .cloudvol file.
+        static AZ::Data::Instance<AZ::RPI::StreamingImage> CreateTexture3DFromMipChain(const AZStd::vector<CloudTextureMipData>& mipLevels, AZ::RHI::Format format);
+        // Same as above, for a Texture2D whose mip levels have depth 1, e.g. the WeatherMapPyramid.
+        static AZ::Data::Instance<AZ::RPI::StreamingImage> CreateTexture2DFromMipChain(const AZStd::vector<CloudTextureMipData>& mipLevels, AZ::RHI::Format format);
+
         struct CloudTextureComputeRequest
         {
             // When true, the dispatched compute pipeline will also
@@ -66,10 +95,26 @@ namespace VolumetricClouds
             // the texture is ready to be used by the presentation shader
             // or to be saved to Disk, etc.
             CloudTextureComputePipeline::RenderTaskId m_textureComputeTaskId = 0;
+            // Created right before the compute pipeline is dispatched. Remains null
+            // if the texture was found in the on-disk cache.
             AZ::Data::Instance<AZ::RPI::AttachmentImage> m_cloudTextureAttachment;
             CloudTextureComputeData m_computeData;
             TextureReadyEvent m_readyEvent;
             ReadbackEvent m_readbackEvent;
+            // When true the on-disk cache is neither read nor written for this request.
+            bool m_skipCache = false;
+            // Number of times the compute pipeline failed to start for this request.
+            uint32_t m_startAttemptCount = 0;
+            // True while the stats of the texture are calculated in a job. The events are signaled, and
+            // the request can be batched again, once the job completes. See OnTextureComputeComplete().
+            bool m_isCompleting = false;
+            // True while the texture is looked up in the on-disk cache in a job. See StartCacheLoad().
+            bool m_isLoadingFromCache = false;
+            // True once the on-disk cache didn't have the texture, so the next batch computes it without looking it up again.
+            bool m_cacheMissed = false;
+            // The texture, and its CPU copy, given to OnTextureComputeComplete() while the job runs.
+            AZ::Data::Instance<AZ::RPI::Image> m_completedImage;
+            AZStd::vector<CloudTextureMipData> m_completedMipLevels;
         };
 
     private:
@@ -78,8 +123,48 @@ namespace VolumetricClouds
 
         static constexpr char LogName[] = "CloudTexturesComputeFeatureProcessor";
 
-        AZ::Data::Instance<AZ::RPI::AttachmentImage> CreateTexture3DAttachmentImage(uint32_t pixelSize);
-        AZStd::shared_ptr<CloudTextureComputePipeline> CreateTextureComputeTask(CloudTextureComputeRequest& cloudTextureInstance);
+        // Common functionality of CreateTexture3DFromMipChain() and CreateTexture2DFromMipChain().
+        static AZ::Data::Instance<AZ::RPI::StreamingImage> CreateImageFromMipChain(const AZ::RHI::ImageDescriptor& imageDesc,
+            const AZStd::vector<CloudTextureMipData>& mipLevels);
+
+        // Acquires the attachment image from @m_imagePool, with the format of the channel layout.
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> CreateTexture3DAttachmentImage(const CloudTextureComputeData& computeData);
+        // Returns r_cloudTextureImagePoolMaxSizeMB in bytes.
+        static uint64_t GetImagePoolMaxSizeInBytes();
+        // Binds the persistent CloudTextureComputePipeline to the textures of all the entities in @batchEntityIds.
+        // The pipeline is created the first time.
+        void StartTextureComputeBatch(const AZStd::vector<AZ::EntityId>& batchEntityIds);
+        // Called when the compute pipeline fails to start. The requests of @batchEntityIds are queued again, up to
+        // MaxStartAttemptCount times, after which their ready event is signaled with a null image and they are erased.
+        void OnTextureComputeStartFailed(const AZStd::vector<AZ::EntityId>& batchEntityIds);
+        static constexpr uint32_t MaxStartAttemptCount = 3;
+        bool IsEntityQueued(const AZ::EntityId& entityId) const;
+        // Returns r_cloudTextureBrickSize, validated.
+        static uint32_t GetBrickSize();
+
+        // Returns true if the texture is looked up in the on-disk cache, in which case the file is read in a job,
+        // and CompleteLoadedTextures() either completes the request or queues it again for the compute pipeline.
+        bool StartCacheLoad(const AZ::EntityId& entityId);
+        // Completes the requests whose texture was found by the StartCacheLoad() job, and queues the misses again.
+        void CompleteLoadedTextures();
+        // Called from a job with the CPU copy of the texture, when it was read back or loaded from the cache.
+        // Calculates the stats of @mipLevels, and when @normalizeChannelRange is true, renormalizes the
+        // channels to the full range into @normalizedMipLevels. Returns null if the stats could not be calculated.
+        static AZStd::shared_ptr<CloudTextureStats> CalculateStatsAndNormalize(AZ::RHI::Format format, bool normalizeChannelRange,
+            const AZStd::vector<CloudTextureMipData>& mipLevels, AZStd::vector<CloudTextureMipData>& normalizedMipLevels);
+        // When there's a CPU copy of the texture in @mipLevels, its stats are calculated, and the channels renormalized,
+        // in a job that can take several milliseconds for large textures. The events of the request are signaled by
+        // OnRenderEnd() once the job completes. Without a CPU copy, the events are signaled right away.
+        void OnTextureComputeComplete(const AZ::EntityId& entityId, AZ::Data::Instance<AZ::RPI::Image> image,
+                                      const AZStd::vector<CloudTextureMipData>& mipLevels);
+        // Completes the requests whose CalculateStatsAndNormalize() job is done.
+        void CompleteCalculatedTextures();
+        // Signals the events of the request and erases it, unless the entity was enqueued again.
+        // @normalizedMipLevels If not empty, @image was created from them, and the readers get them instead of the read back mips.
+        void FinishTextureCompute(const AZ::EntityId& entityId, AZ::Data::Instance<AZ::RPI::Image> image,
+            AZStd::shared_ptr<const CloudTextureStats> stats, const AZStd::vector<CloudTextureMipData>& normalizedMipLevels);
+        // Writes the mip chain to the on-disk cache from a job.
+        void StoreInCache(const CloudTextureComputeData& computeData, const AZStd::vector<CloudTextureMipData>& mipLevels);
 
         //////////////////////////////////////////////////////////////////
         //! AZ::RPI::FeatureProcessor overrides START...
@@ -96,15 +181,16 @@ namespace VolumetricClouds
         AZStd::unordered_map<AZ::EntityId, CloudTextureComputeRequest> m_computeRequests;
 
         // When a new CloudTextureComputeRequest is created, we add the entityid in this queue.
-        // Periodically we check if there's an entity at the front of the queue. If there's
-        // an entity, we use the  CloudTextureComputeRequest compute data to spawn a new CloudTextureComputePipeline.
+        // Periodically we check if there are entities in the queue. If there are, we drain up to
+        // r_cloudTextureBatchSize entities and spawn a single CloudTextureComputePipeline that generates all their textures.
         // This feature processor only runs one CloudTextureComputePipeline at a time (even though we could,
         // in principle, run all in parallel) because there are crashes related with AttachmentReadbacks when running in parallel.
         // This is why we use a queue instead of a vector.
         AZStd::deque<AZ::EntityId> m_cloudTextureComputeTasks;
 
-        // This compute task relates with the CloudTextureComputeRequest at the front of @m_cloudTextureComputeTasks
-        AZStd::shared_ptr<CloudTextureComputePipeline> m_currentCloudTextureComputeTask;
+        // Generates the textures of the CloudTextureComputeRequest(s) of the last batch drained from @m_cloudTextureComputeTasks.
+        // Created on the first request, and it lives as long as this feature processor, unless r_cloudTexturePersistentPipeline is false.
+        AZStd::unique_ptr<CloudTextureComputePipeline> m_textureComputePipeline;
         // We need to create a scene that will be used by CloudTextureComputePipeline(s)
         // to instantiate their render pipeline that runs the compute pass
         // the generates the 3D Noise Textures. The idea is that if we use the default main scene
@@ -112,5 +198,77 @@ namespace VolumetricClouds
         // and it spawns a mess of notifications that are not relevant to the other feature processors.
         AZ::RPI::ScenePtr m_computeScene;
 
+        // Null when r_cloudTextureCacheEnabled is false. It is a shared_ptr because
+        // the jobs that read and write the cache files may outlive this feature processor.
+        AZStd::shared_ptr<CloudTextureCache> m_cache;
+
+        // Filled by the StartCacheLoad() jobs, drained by OnRenderEnd(). It is a shared_ptr because
+        // the jobs may outlive this feature processor.
+        struct LoadedTexture
+        {
+            AZ::EntityId m_entityId;
+            // Empty if the texture is not in the cache.
+            AZStd::vector<CloudTextureMipData> m_mipLevels;
+        };
+        struct LoadedTextureQueue
+        {
+            AZStd::mutex m_mutex;
+            AZStd::vector<LoadedTexture> m_textures;
+        };
+        AZStd::shared_ptr<LoadedTextureQueue> m_loadedTextures;
+
+        // Filled by the CalculateStatsAndNormalize() jobs, drained by OnRenderEnd(). It is a shared_ptr because
+        // the jobs may outlive this feature processor.
+        struct CalculatedTexture
+        {
+            AZ::EntityId m_entityId;
+            AZStd::shared_ptr<CloudTextureStats> m_stats;
+            AZStd::vector<CloudTextureMipData> m_normalizedMipLevels;
+        };
+        struct CalculatedTextureQueue
+        {
+            AZStd::mutex m_mutex;
+            AZStd::vector<CalculatedTexture> m_textures;
+        };
+        AZStd::shared_ptr<CalculatedTextureQueue> m_calculatedTextures;
+
+        // Recycles the attachment images of the textures that are no longer used.
+        AZStd::unique_ptr<CloudTextureImagePool> m_imagePool;
+        // The attachment image of the last texture generated on the GPU for each entity.
+        // Released to @m_imagePool when the entity gets a new texture, or calls ReleaseTexture().
+        AZStd::unordered_map<AZ::EntityId, AZ::Data::Instance<AZ::RPI::AttachmentImage>> m_entityImages;
+
+        // Number of times OnRenderEnd() has been called.
+        uint64_t m_frameCounter = 0;
+
+        // Measures how long it takes, in milliseconds and frames, to complete a set of requests.
+        // Usage: r_cloudTextureBenchmarkTurnaround [requestCount=16] [pixelSize=64]
+        // Compare the results with r_cloudTexturePersistentPipeline on and off.
+        // The on-disk cache is bypassed, so the GPU path is always measured.
+        void r_cloudTextureBenchmarkTurnaround(const AZ::ConsoleCommandContainer& arguments);
+        AZ_CONSOLEFUNC(CloudTexturesComputeFeatureProcessor, r_cloudTextureBenchmarkTurnaround, AZ::ConsoleFunctorFlags::Null,
+            "Enqueues N cloud noise texture requests, and prints how long it took to complete them. Arguments: [requestCount=16] [pixelSize=64]");
+
+        // Prints the counters of the on-disk cache and of the pool of 3D attachment images.
+        void r_cloudTexturePrintCacheStats(const AZ::ConsoleCommandContainer& arguments);
+        AZ_CONSOLEFUNC(CloudTexturesComputeFeatureProcessor, r_cloudTexturePrintCacheStats, AZ::ConsoleFunctorFlags::Null,
+            "Prints the hit/miss counters of the on-disk cache of cloud noise textures, and the counters of the image pool.");
+
+        struct TurnaroundBenchmark
+        {
+            static constexpr char LogName[] = "CloudTexturesComputeFeatureProcessor";
+
+            bool IsComplete() const { return m_completedCount >= m_requestCount; }
+            void PrintResults(uint64_t currentFrame) const;
+
+            uint32_t m_requestCount = 0;
+            uint32_t m_completedCount = 0;
+            uint64_t m_startFrame = 0;
+            AZStd::chrono::steady_clock::time_point m_startTime;
+            AZStd::vector<TextureReadyEvent::Handler> m_readyHandlers;
+        };
+        static constexpr AZ::u64 BenchmarkEntityIdBase = 0xC10D7E8700000000ull;
+        AZStd::unique_ptr<TurnaroundBenchmark> m_benchmark;
+
     };
 } // namespace VolumetricClouds
@@ -0,0 +1,804 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/IO/SystemFile.h>
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/parallel/atomic.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+
+#if defined(AZ_PLATFORM_WINDOWS)
+#include <AzCore/PlatformIncl.h>
+#include <AzCore/std/string/conversions.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <lz4.h>
+#include <zstd.h>
+
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Renderer/Cpu/CloudTextureStatistics.h>
+#include "CloudTextureCache.h"
+#include "CloudVolumeFile.h"
+
+namespace VolumetricClouds
+{
+    namespace
+    {
+        static_assert(sizeof(CloudVolumeFile::Provenance) == 44, "Provenance is expected to have no padding");
+        static_assert(sizeof(CloudVolumeFile::FileHeader) == 80, "FileHeader is expected to have no padding");
+        static_assert(sizeof(CloudVolumeFile::MipHeader) == 32, "MipHeader is expected to have no padding");
+        static_assert(sizeof(CloudVolumeFile::BrickEntry) == 16, "BrickEntry is expected to have no padding");
+        static_assert(sizeof(CloudVolumeFile::StatsHeader) == 48, "StatsHeader is expected to have no padding");
+        static_assert(sizeof(CloudVolumeFile::ChannelStatsEntry) == 1040, "ChannelStatsEntry is expected to have no padding");
+
+        constexpr int DefaultZStdCompressionLevel = 3;
+
+        // Region of a mip level covered by a brick, in pixels.
+        struct BrickRegion
+        {
+            uint32_t m_x = 0;
+            uint32_t m_y = 0;
+            uint32_t m_z = 0;
+            uint32_t m_width = 0;
+            uint32_t m_height = 0;
+            uint32_t m_depth = 0;
+        };
+
+        BrickRegion GetBrickRegion(const CloudVolumeFile::MipHeader& mipHeader, uint32_t brickSize, uint32_t brickIndex)
+        {
+            BrickRegion region;
+            region.m_x = (brickIndex % mipHeader.m_bricksX) * brickSize;
+            region.m_y = ((brickIndex / mipHeader.m_bricksX) % mipHeader.m_bricksY) * brickSize;
+            region.m_z = (brickIndex / (mipHeader.m_bricksX * mipHeader.m_bricksY)) * brickSize;
+            region.m_width = AZStd::min(brickSize, mipHeader.m_width - region.m_x);
+            region.m_height = AZStd::min(brickSize, mipHeader.m_height - region.m_y);
+            region.m_depth = AZStd::min(brickSize, mipHeader.m_depth - region.m_z);
+            return region;
+        }
+
+        size_t GetBrickByteCount(const BrickRegion& region, uint32_t bytesPerPixel)
+        {
+            return static_cast<size_t>(region.m_width) * region.m_height * region.m_depth * bytesPerPixel;
+        }
+
+        // Calls @rowFunction(mipOffset, brickOffset, rowByteCount) for each row of the brick.
+        template<typename RowFunction>
+        void ForEachBrickRow(const CloudVolumeFile::MipHeader& mipHeader, const BrickRegion& region, uint32_t bytesPerPixel, RowFunction&& rowFunction)
+        {
+            const size_t mipRowPitch = static_cast<size_t>(mipHeader.m_width) * bytesPerPixel;
+            const size_t mipSlicePitch = mipRowPitch * mipHeader.m_height;
+            const size_t brickRowPitch = static_cast<size_t>(region.m_width) * bytesPerPixel;
+            size_t brickOffset = 0;
+            for (uint32_t z = 0; z < region.m_depth; z++)
+            {
+                for (uint32_t y = 0; y < region.m_height; y++)
+                {
+                    const size_t mipOffset = (mipSlicePitch * (region.m_z + z)) + (mipRowPitch * (region.m_y + y))
+                        + (static_cast<size_t>(region.m_x) * bytesPerPixel);
+                    rowFunction(mipOffset, brickOffset, brickRowPitch);
+                    brickOffset += brickRowPitch;
+                }
+            }
+        }
+
+        // The rows of a brick are contiguous in the mip level when it spans the whole width and height.
+        bool IsBrickContiguous(const CloudVolumeFile::MipHeader& mipHeader)
+        {
+            return (mipHeader.m_bricksX == 1) && (mipHeader.m_bricksY == 1);
+        }
+
+        size_t GetBrickMipOffset(const CloudVolumeFile::MipHeader& mipHeader, const BrickRegion& region, uint32_t bytesPerPixel)
+        {
+            return static_cast<size_t>(mipHeader.m_width) * mipHeader.m_height * region.m_z * bytesPerPixel;
+        }
+
+        size_t GetStatsByteCount(uint32_t mipCount, uint32_t channelCount)
+        {
+            return sizeof(CloudVolumeFile::StatsHeader) + (sizeof(CloudVolumeFile::ChannelStatsEntry) * mipCount * channelCount);
+        }
+    }
+
+    CloudVolumeFile::Provenance CloudVolumeFile::GetProvenance(const CloudTextureComputeData& computeData)
+    {
+        Provenance provenance;
+        provenance.m_noiseAlgorithmVersion = CloudTextureCache::NoiseAlgorithmVersion;
+        provenance.m_pixelSize = computeData.m_pixelSize;
+        provenance.m_frequency = computeData.m_frequency;
+        provenance.m_perlinOctaves = computeData.m_perlinOctaves;
+        provenance.m_perlinGain = computeData.m_perlinGain;
+        provenance.m_perlinAmplitude = computeData.m_perlinAmplitude;
+        provenance.m_worleyOctaves = computeData.m_worleyOctaves;
+        provenance.m_worleyGain = computeData.m_worleyGain;
+        provenance.m_worleyAmplitude = computeData.m_worleyAmplitude;
+        provenance.m_mipFilter = computeData.m_mipFilter;
+        provenance.m_channelLayout = computeData.m_channelLayout;
+        return provenance;
+    }
+
+    CloudTextureComputeData CloudVolumeFile::GetComputeData(const Provenance& provenance)
+    {
+        CloudTextureComputeData computeData;
+        computeData.m_pixelSize = provenance.m_pixelSize;
+        computeData.m_frequency = provenance.m_frequency;
+        computeData.m_perlinOctaves = provenance.m_perlinOctaves;
+        computeData.m_perlinGain = provenance.m_perlinGain;
+        computeData.m_perlinAmplitude = provenance.m_perlinAmplitude;
+        computeData.m_worleyOctaves = provenance.m_worleyOctaves;
+        computeData.m_worleyGain = provenance.m_worleyGain;
+        computeData.m_worleyAmplitude = provenance.m_worleyAmplitude;
+        computeData.m_mipFilter = provenance.m_mipFilter;
+        computeData.m_channelLayout = provenance.m_channelLayout;
+        return computeData;
+    }
+
+    void CloudVolumeFile::CalculateBrickGrid(const AZ::RHI::Size& mipSize, uint32_t brickSize,
+        uint32_t& bricksX, uint32_t& bricksY, uint32_t& bricksZ)
+    {
+        bricksX = (mipSize.m_width + brickSize - 1) / brickSize;
+        bricksY = (mipSize.m_height + brickSize - 1) / brickSize;
+        bricksZ = (mipSize.m_depth + brickSize - 1) / brickSize;
+    }
+
+    bool CloudVolumeFile::Write(const AZ::IO::Path& filePath, const CloudTextureComputeData& computeData, AZ::RHI::Format format,
+        const AZStd::vector<CloudTextureMipData>& mipLevels, const CloudVolumeWriteSettings& settings,
+        const ProgressCallback& progressCallback, AZ::JobContext* jobContext, const CloudTextureStats* stats)
+    {
+        CloudTextureChannelLayout channelLayout;
+        if (!CloudTextureFormat::GetChannelLayout(format, channelLayout))
+        {
+            AZ_Error(LogName, false, "Format %s is not the format of any channel layout.", AZ::RHI::ToString(format));
+            return false;
+        }
+        if (mipLevels.empty() || (mipLevels.size() > MaxMipCount))
+        {
+            AZ_Error(LogName, false, "Invalid number of mip levels=%zu.", mipLevels.size());
+            return false;
+        }
+        if ((settings.m_brickSize == 0) || ((settings.m_brickSize & (settings.m_brickSize - 1)) != 0))
+        {
+            AZ_Error(LogName, false, "The brick size=%u must be a power of two.", settings.m_brickSize);
+            return false;
+        }
+        if (settings.m_codec > CloudVolumeCodec::ZStd)
+        {
+            AZ_Error(LogName, false, "Invalid codec=%u.", static_cast<uint32_t>(settings.m_codec));
+            return false;
+        }
+
+        FileHeader fileHeader;
+        fileHeader.m_codec = static_cast<uint32_t>(settings.m_codec);
+        fileHeader.m_brickSize = settings.m_brickSize;
+        fileHeader.m_channelLayout = static_cast<uint32_t>(channelLayout);
+        fileHeader.m_bytesPerPixel = AZ::RHI::GetFormatSize(format);
+        fileHeader.m_mipCount = static_cast<uint32_t>(mipLevels.size());
+        fileHeader.m_provenance = GetProvenance(computeData);
+
+        AZStd::vector<MipHeader> mipHeaders;
+        mipHeaders.reserve(mipLevels.size());
+        for (const auto& mipData : mipLevels)
+        {
+            const auto& mipSize = mipData.m_mipSize;
+            // The same mip chain that CloudVolumeFileReader accepts.
+            const bool isExpectedSize = mipHeaders.empty() ?
+                ((mipSize.m_width <= CloudTextureFormat::MaxPixelSize) && (mipSize.m_height <= CloudTextureFormat::MaxPixelSize)
+                    && (mipSize.m_depth <= CloudTextureFormat::MaxPixelSize)) :
+                ((mipSize.m_width == AZStd::max(mipHeaders.back().m_width / 2, 1u)) && (mipSize.m_height == AZStd::max(mipHeaders.back().m_height / 2, 1u))
+                    && (mipSize.m_depth == AZStd::max(mipHeaders.back().m_depth / 2, 1u)));
+            if (!isExpectedSize)
+            {
+                AZ_Error(LogName, false, "Mip level %u of size %ux%ux%u is not part of a mip chain of at most %u pixels.", mipData.m_mipSlice,
+                    mipSize.m_width, mipSize.m_height, mipSize.m_depth, CloudTextureFormat::MaxPixelSize);
+                return false;
+            }
+            const size_t expectedByteCount = static_cast<size_t>(mipSize.m_width) * mipSize.m_height * mipSize.m_depth * fileHeader.m_bytesPerPixel;
+            if (!mipData.m_dataBuffer || (mipData.m_dataBuffer->size() != expectedByteCount) || (expectedByteCount == 0))
+            {
+                AZ_Error(LogName, false, "Mip level %u has no data, or its size doesn't match its dimensions.", mipData.m_mipSlice);
+                return false;
+            }
+            MipHeader& mipHeader = mipHeaders.emplace_back();
+            mipHeader.m_width = mipSize.m_width;
+            mipHeader.m_height = mipSize.m_height;
+            mipHeader.m_depth = mipSize.m_depth;
+            CalculateBrickGrid(mipSize, settings.m_brickSize, mipHeader.m_bricksX, mipHeader.m_bricksY, mipHeader.m_bricksZ);
+            mipHeader.m_firstBrick = fileHeader.m_brickCount;
+            fileHeader.m_brickCount += mipHeader.m_bricksX * mipHeader.m_bricksY * mipHeader.m_bricksZ;
+        }
+
+        // The stats are written right after the mip headers.
+        AZStd::vector<uint8_t> statsBytes;
+        if (stats)
+        {
+            const uint32_t channelCount = CloudTextureStatistics::GetChannelCount(format);
+            if ((stats->m_channelCount != channelCount) || (stats->m_mipLevels.size() != mipLevels.size()))
+            {
+                AZ_Warning(LogName, false, "The stats don't match the mip chain, they won't be saved in %s.", filePath.c_str());
+            }
+            else
+            {
+                fileHeader.m_flags |= FileHeader::FlagHasStats;
+                statsBytes.resize(GetStatsByteCount(fileHeader.m_mipCount, channelCount));
+                StatsHeader statsHeader;
+                statsHeader.m_channelCount = channelCount;
+                statsHeader.m_normalized = stats->m_normalized ? 1 : 0;
+                for (uint32_t channel = 0; channel < CloudTextureMipStats::MaxChannelCount; channel++)
+                {
+                    statsHeader.m_sourceRangeMin[channel] = stats->m_sourceRangeMin[channel];
+                    statsHeader.m_sourceRangeMax[channel] = stats->m_sourceRangeMax[channel];
+                }
+                memcpy(statsBytes.data(), &statsHeader, sizeof(StatsHeader));
+                size_t statsOffset = sizeof(StatsHeader);
+                for (const auto& mipStats : stats->m_mipLevels)
+                {
+                    for (uint32_t channel = 0; channel < channelCount; channel++)
+                    {
+                        const auto& channelStats = mipStats.m_channels[channel];
+                        ChannelStatsEntry statsEntry;
+                        statsEntry.m_min = channelStats.m_min;
+                        statsEntry.m_max = channelStats.m_max;
+                        statsEntry.m_mean = channelStats.m_mean;
+                        memcpy(statsEntry.m_histogram, channelStats.m_histogram.data(), sizeof(statsEntry.m_histogram));
+                        memcpy(statsBytes.data() + statsOffset, &statsEntry, sizeof(ChannelStatsEntry));
+                        statsOffset += sizeof(ChannelStatsEntry);
+                    }
+                }
+            }
+        }
+
+        AZ::IO::SystemFile file;
+        const int openMode = AZ::IO::SystemFile::SF_OPEN_CREATE | AZ::IO::SystemFile::SF_OPEN_CREATE_PATH | AZ::IO::SystemFile::SF_OPEN_WRITE_ONLY;
+        if (!file.Open(filePath.c_str(), openMode))
+        {
+            AZ_Error(LogName, false, "Failed to create file %s.", filePath.c_str());
+            return false;
+        }
+
+        auto failWrite = [&](const char* reason)
+        {
+            if (reason)
+            {
+                AZ_Error(LogName, false, "Failed to write file %s: %s.", filePath.c_str(), reason);
+            }
+            file.Close();
+            AZ::IO::SystemFile::Delete(filePath.c_str());
+            return false;
+        };
+
+        // The brick table is written last, once the compressed sizes are known.
+        AZStd::vector<BrickEntry> brickTable(fileHeader.m_brickCount);
+        const size_t mipHeadersByteCount = sizeof(MipHeader) * mipHeaders.size();
+        const size_t brickTableByteCount = sizeof(BrickEntry) * brickTable.size();
+        const uint64_t brickTableOffset = sizeof(FileHeader) + mipHeadersByteCount + statsBytes.size();
+        if ((file.Write(&fileHeader, sizeof(FileHeader)) != sizeof(FileHeader))
+            || (file.Write(mipHeaders.data(), mipHeadersByteCount) != mipHeadersByteCount)
+            || (!statsBytes.empty() && (file.Write(statsBytes.data(), statsBytes.size()) != statsBytes.size()))
+            || (file.Write(brickTable.data(), brickTableByteCount) != brickTableByteCount))
+        {
+            return failWrite("Can't write the headers");
+        }
+        uint64_t payloadOffset = brickTableOffset + brickTableByteCount;
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        // The bricks are compressed one mip level at a time, so only the compressed
+        // bricks of a single mip level are kept in memory.
+        const uint32_t bytesPerPixel = fileHeader.m_bytesPerPixel;
+        const int compressionLevel = (settings.m_compressionLevel != 0) ? settings.m_compressionLevel : DefaultZStdCompressionLevel;
+        for (size_t mipIndex = 0; mipIndex < mipLevels.size(); mipIndex++)
+        {
+            const MipHeader& mipHeader = mipHeaders[mipIndex];
+            const uint8_t* mipPixels = mipLevels[mipIndex].m_dataBuffer->data();
+            const uint32_t mipBrickCount = mipHeader.m_bricksX * mipHeader.m_bricksY * mipHeader.m_bricksZ;
+            AZStd::vector<AZStd::vector<uint8_t>> compressedBricks(mipBrickCount);
+            AZStd::atomic_bool compressionFailed{ false };
+            CloudTextureCpuBaker::ForEachSlab(jobContext, mipBrickCount, [&](uint32_t firstBrick, uint32_t brickCount)
+                {
+                    AZStd::vector<uint8_t> brickPixels;
+                    ZSTD_CCtx* compressionContext = (settings.m_codec == CloudVolumeCodec::ZStd) ? ZSTD_createCCtx() : nullptr;
+                    for (uint32_t brickIndex = firstBrick; brickIndex < firstBrick + brickCount; brickIndex++)
+                    {
+                        const BrickRegion region = GetBrickRegion(mipHeader, settings.m_brickSize, brickIndex);
+                        brickPixels.resize_no_construct(GetBrickByteCount(region, bytesPerPixel));
+                        ForEachBrickRow(mipHeader, region, bytesPerPixel, [&](size_t mipOffset, size_t brickOffset, size_t rowByteCount)
+                            {
+                                memcpy(brickPixels.data() + brickOffset, mipPixels + mipOffset, rowByteCount);
+                            });
+
+                        auto& compressedBrick = compressedBricks[brickIndex];
+                        size_t compressedSize = 0;
+                        if (settings.m_codec == CloudVolumeCodec::LZ4)
+                        {
+                            compressedBrick.resize_no_construct(LZ4_compressBound(static_cast<int>(brickPixels.size())));
+                            compressedSize = LZ4_compress_default(reinterpret_cast<const char*>(brickPixels.data()),
+                                reinterpret_cast<char*>(compressedBrick.data()), static_cast<int>(brickPixels.size()), static_cast<int>(compressedBrick.size()));
+                        }
+                        else if (settings.m_codec == CloudVolumeCodec::ZStd)
+                        {
+                            compressedBrick.resize_no_construct(ZSTD_compressBound(brickPixels.size()));
+                            compressedSize = ZSTD_compressCCtx(compressionContext, compressedBrick.data(), compressedBrick.size(),
+                                brickPixels.data(), brickPixels.size(), compressionLevel);
+                            if (ZSTD_isError(compressedSize))
+                            {
+                                compressedSize = 0;
+                            }
+                        }
+
+                        if ((compressedSize == 0) && (settings.m_codec != CloudVolumeCodec::None))
+                        {
+                            compressionFailed = true;
+                        }
+
+                        // Incompressible bricks, and all bricks when there's no codec, are stored raw.
+                        if ((compressedSize == 0) || (compressedSize >= brickPixels.size()))
+                        {
+                            compressedBrick = brickPixels;
+                        }
+                        else
+                        {
+                            compressedBrick.resize(compressedSize);
+                        }
+                    }
+                    ZSTD_freeCCtx(compressionContext);
+                });
+
+            if (compressionFailed)
+            {
+                return failWrite("Brick compression failed");
+            }
+
+            for (uint32_t brickIndex = 0; brickIndex < mipBrickCount; brickIndex++)
+            {
+                const auto& compressedBrick = compressedBricks[brickIndex];
+                BrickEntry& brickEntry = brickTable[mipHeader.m_firstBrick + brickIndex];
+                brickEntry.m_offset = payloadOffset;
+                brickEntry.m_compressedSize = static_cast<uint32_t>(compressedBrick.size());
+                brickEntry.m_uncompressedSize = static_cast<uint32_t>(
+                    GetBrickByteCount(GetBrickRegion(mipHeader, settings.m_brickSize, brickIndex), bytesPerPixel));
+                if (file.Write(compressedBrick.data(), compressedBrick.size()) != compressedBrick.size())
+                {
+                    return failWrite("Can't write the bricks");
+                }
+                payloadOffset += compressedBrick.size();
+
+                if (progressCallback && !progressCallback(brickEntry.m_uncompressedSize))
+                {
+                    return failWrite(nullptr);
+                }
+            }
+        }
+
+        file.Seek(brickTableOffset, AZ::IO::SystemFile::SF_SEEK_BEGIN);
+        if (file.Write(brickTable.data(), brickTableByteCount) != brickTableByteCount)
+        {
+            return failWrite("Can't write the brick table");
+        }
+        file.Close();
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////
+    // CloudVolumeFileReader
+
+    CloudVolumeFileReader::~CloudVolumeFileReader()
+    {
+        Close();
+    }
+
+    bool CloudVolumeFileReader::Open(const AZ::IO::Path& filePath)
+    {
+        Close();
+
+#if defined(AZ_PLATFORM_WINDOWS)
+        AZStd::wstring widePath;
+        AZStd::to_wstring(widePath, filePath.c_str());
+        HANDLE fileHandle = CreateFileW(widePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (fileHandle == INVALID_HANDLE_VALUE)
+        {
+            AZ_Error(LogName, false, "Failed to open file %s.", filePath.c_str());
+            return false;
+        }
+        m_fileHandle = fileHandle;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || (fileSize.QuadPart == 0))
+        {
+            AZ_Error(LogName, false, "Invalid size for file %s.", filePath.c_str());
+            Close();
+            return false;
+        }
+        m_mappingHandle = CreateFileMappingW(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        const void* fileData = m_mappingHandle ? MapViewOfFile(m_mappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!fileData)
+        {
+            AZ_Error(LogName, false, "Failed to map file %s.", filePath.c_str());
+            Close();
+            return false;
+        }
+        m_fileSize = static_cast<size_t>(fileSize.QuadPart);
+#else
+        const int fileDescriptor = open(filePath.c_str(), O_RDONLY);
+        if (fileDescriptor < 0)
+        {
+            AZ_Error(LogName, false, "Failed to open file %s.", filePath.c_str());
+            return false;
+        }
+        struct stat fileStat;
+        if ((fstat(fileDescriptor, &fileStat) != 0) || (fileStat.st_size == 0))
+        {
+            AZ_Error(LogName, false, "Invalid size for file %s.", filePath.c_str());
+            close(fileDescriptor);
+            return false;
+        }
+        void* fileData = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+        // The mapping stays valid after the file descriptor is closed.
+        close(fileDescriptor);
+        if (fileData == MAP_FAILED)
+        {
+            AZ_Error(LogName, false, "Failed to map file %s.", filePath.c_str());
+            return false;
+        }
+        m_fileSize = static_cast<size_t>(fileStat.st_size);
+#endif
+        m_fileData = static_cast<const uint8_t*>(fileData);
+
+        if (!ValidateFile())
+        {
+            AZ_Error(LogName, false, "File %s is not a valid %s file.", filePath.c_str(), CloudVolumeFile::FileExtension);
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void CloudVolumeFileReader::Close()
+    {
+#if defined(AZ_PLATFORM_WINDOWS)
+        if (m_fileData)
+        {
+            UnmapViewOfFile(m_fileData);
+        }
+        if (m_mappingHandle)
+        {
+            CloseHandle(m_mappingHandle);
+            m_mappingHandle = nullptr;
+        }
+        if (m_fileHandle)
+        {
+            CloseHandle(m_fileHandle);
+            m_fileHandle = nullptr;
+        }
+#else
+        if (m_fileData)
+        {
+            munmap(const_cast<uint8_t*>(m_fileData), m_fileSize);
+        }
+#endif
+        m_fileData = nullptr;
+        m_fileSize = 0;
+        m_fileHeader = {};
+        m_mipHeaders.clear();
+        m_brickTable = nullptr;
+        m_statsHeader = nullptr;
+        m_channelStats = nullptr;
+    }
+
+    bool CloudVolumeFileReader::ValidateFile()
+    {
+        using FileHeader = CloudVolumeFile::FileHeader;
+        using MipHeader = CloudVolumeFile::MipHeader;
+        using BrickEntry = CloudVolumeFile::BrickEntry;
+
+        if (m_fileSize < sizeof(FileHeader))
+        {
+            return false;
+        }
+        memcpy(&m_fileHeader, m_fileData, sizeof(FileHeader));
+        const uint32_t brickSize = m_fileHeader.m_brickSize;
+        if ((m_fileHeader.m_magic != FileHeader::Magic)
+            || (m_fileHeader.m_version < FileHeader::MinSupportedVersion) || (m_fileHeader.m_version > FileHeader::CurrentVersion)
+            || ((m_fileHeader.m_version == 1) && (m_fileHeader.m_flags != 0))
+            || (m_fileHeader.m_codec > static_cast<uint32_t>(CloudVolumeCodec::ZStd))
+            || (brickSize == 0) || ((brickSize & (brickSize - 1)) != 0)
+            || (m_fileHeader.m_mipCount == 0) || (m_fileHeader.m_mipCount > CloudVolumeFile::MaxMipCount)
+            || (m_fileHeader.m_channelLayout > static_cast<uint32_t>(CloudTextureChannelLayout::R16F))
+            || (m_fileHeader.m_bytesPerPixel != AZ::RHI::GetFormatSize(GetFormat()))
+            || (m_fileHeader.m_provenance.m_pixelSize > CloudTextureFormat::MaxPixelSize))
+        {
+            return false;
+        }
+
+        const uint64_t mipHeadersEnd = sizeof(FileHeader) + (sizeof(MipHeader) * static_cast<uint64_t>(m_fileHeader.m_mipCount));
+        uint64_t brickTableOffset = mipHeadersEnd;
+        if (m_fileHeader.m_flags & FileHeader::FlagHasStats)
+        {
+            using StatsHeader = CloudVolumeFile::StatsHeader;
+            if (mipHeadersEnd + sizeof(StatsHeader) > m_fileSize)
+            {
+                return false;
+            }
+            // The mapping is page aligned and the headers are multiples of 8 bytes.
+            m_statsHeader = reinterpret_cast<const StatsHeader*>(m_fileData + mipHeadersEnd);
+            if ((m_statsHeader->m_channelCount != CloudTextureStatistics::GetChannelCount(GetFormat()))
+                || (m_statsHeader->m_histogramBinCount != CloudTextureChannelStats::HistogramBinCount))
+            {
+                return false;
+            }
+            m_channelStats = reinterpret_cast<const CloudVolumeFile::ChannelStatsEntry*>(m_fileData + mipHeadersEnd + sizeof(StatsHeader));
+            brickTableOffset += GetStatsByteCount(m_fileHeader.m_mipCount, m_statsHeader->m_channelCount);
+        }
+        const uint64_t payloadOffset = brickTableOffset + (sizeof(BrickEntry) * static_cast<uint64_t>(m_fileHeader.m_brickCount));
+        if (payloadOffset > m_fileSize)
+        {
+            return false;
+        }
+
+        m_mipHeaders.resize(m_fileHeader.m_mipCount);
+        memcpy(m_mipHeaders.data(), m_fileData + sizeof(FileHeader), sizeof(MipHeader) * m_mipHeaders.size());
+        // The table is 8 bytes aligned because the mapping is page aligned and the headers are multiples of 8 bytes.
+        m_brickTable = reinterpret_cast<const BrickEntry*>(m_fileData + brickTableOffset);
+
+        // Mip 0 is at most CloudTextureFormat::MaxPixelSize along each axis, and each mip level is half
+        // the previous one, so the size of the mip buffers is bounded before LoadMipChain() allocates them.
+        AZ::RHI::Size expectedMipSize(CloudTextureFormat::MaxPixelSize, CloudTextureFormat::MaxPixelSize, CloudTextureFormat::MaxPixelSize);
+        uint64_t expectedFirstBrick = 0;
+        for (uint32_t mipLevel = 0; mipLevel < m_fileHeader.m_mipCount; mipLevel++)
+        {
+            const auto& mipHeader = m_mipHeaders[mipLevel];
+            const bool isExpectedSize = (mipLevel == 0) ?
+                ((mipHeader.m_width <= expectedMipSize.m_width) && (mipHeader.m_height <= expectedMipSize.m_height) && (mipHeader.m_depth <= expectedMipSize.m_depth)) :
+                ((mipHeader.m_width == expectedMipSize.m_width) && (mipHeader.m_height == expectedMipSize.m_height) && (mipHeader.m_depth == expectedMipSize.m_depth));
+            if (!isExpectedSize || (mipHeader.m_width == 0) || (mipHeader.m_height == 0) || (mipHeader.m_depth == 0))
+            {
+                return false;
+            }
+            expectedMipSize = AZ::RHI::Size(AZStd::max(mipHeader.m_width / 2, 1u), AZStd::max(mipHeader.m_height / 2, 1u),
+                AZStd::max(mipHeader.m_depth / 2, 1u));
+
+            uint32_t bricksX = 0;
+            uint32_t bricksY = 0;
+            uint32_t bricksZ = 0;
+            const AZ::RHI::Size mipSize(mipHeader.m_width, mipHeader.m_height, mipHeader.m_depth);
+            CloudVolumeFile::CalculateBrickGrid(mipSize, brickSize, bricksX, bricksY, bricksZ);
+            if ((mipHeader.m_bricksX != bricksX) || (mipHeader.m_bricksY != bricksY) || (mipHeader.m_bricksZ != bricksZ)
+                || (mipHeader.m_firstBrick != expectedFirstBrick))
+            {
+                return false;
+            }
+
+            const uint64_t mipBrickCount = static_cast<uint64_t>(bricksX) * bricksY * bricksZ;
+            if (expectedFirstBrick + mipBrickCount > m_fileHeader.m_brickCount)
+            {
+                return false;
+            }
+            for (uint32_t brickIndex = 0; brickIndex < mipBrickCount; brickIndex++)
+            {
+                const BrickEntry& brickEntry = m_brickTable[mipHeader.m_firstBrick + brickIndex];
+                const size_t expectedByteCount = GetBrickByteCount(GetBrickRegion(mipHeader, brickSize, brickIndex), m_fileHeader.m_bytesPerPixel);
+                if ((brickEntry.m_uncompressedSize != expectedByteCount) || (brickEntry.m_compressedSize == 0)
+                    || (brickEntry.m_compressedSize > brickEntry.m_uncompressedSize)
+                    || (brickEntry.m_offset < payloadOffset) || (brickEntry.m_offset + brickEntry.m_compressedSize > m_fileSize))
+                {
+                    return false;
+                }
+            }
+            expectedFirstBrick += mipBrickCount;
+        }
+        return expectedFirstBrick == m_fileHeader.m_brickCount;
+    }
+
+    CloudTextureComputeData CloudVolumeFileReader::GetComputeData() const
+    {
+        CloudTextureComputeData computeData = CloudVolumeFile::GetComputeData(m_fileHeader.m_provenance);
+        computeData.m_normalizeChannelRange = m_statsHeader && (m_statsHeader->m_normalized != 0);
+        return computeData;
+    }
+
+    bool CloudVolumeFileReader::GetStats(CloudTextureStats& stats) const
+    {
+        if (!m_statsHeader)
+        {
+            return false;
+        }
+
+        stats = {};
+        stats.m_channelCount = m_statsHeader->m_channelCount;
+        stats.m_normalized = (m_statsHeader->m_normalized != 0);
+        for (uint32_t channel = 0; channel < CloudTextureMipStats::MaxChannelCount; channel++)
+        {
+            stats.m_sourceRangeMin[channel] = m_statsHeader->m_sourceRangeMin[channel];
+            stats.m_sourceRangeMax[channel] = m_statsHeader->m_sourceRangeMax[channel];
+        }
+        stats.m_mipLevels.resize(m_fileHeader.m_mipCount);
+        const CloudVolumeFile::ChannelStatsEntry* statsEntry = m_channelStats;
+        for (uint32_t mipLevel = 0; mipLevel < m_fileHeader.m_mipCount; mipLevel++)
+        {
+            auto& mipStats = stats.m_mipLevels[mipLevel];
+            mipStats.m_mipSlice = static_cast<uint16_t>(mipLevel);
+            for (uint32_t channel = 0; channel < stats.m_channelCount; channel++, statsEntry++)
+            {
+                auto& channelStats = mipStats.m_channels[channel];
+                channelStats.m_min = statsEntry->m_min;
+                channelStats.m_max = statsEntry->m_max;
+                channelStats.m_mean = statsEntry->m_mean;
+                memcpy(channelStats.m_histogram.data(), statsEntry->m_histogram, sizeof(statsEntry->m_histogram));
+            }
+        }
+        return true;
+    }
+
+    AZ::RHI::Format CloudVolumeFileReader::GetFormat() const
+    {
+        return CloudTextureFormat::GetImageFormat(static_cast<CloudTextureChannelLayout>(m_fileHeader.m_channelLayout));
+    }
+
+    AZ::RHI::Size CloudVolumeFileReader::GetMipSize(uint32_t mipLevel) const
+    {
+        const auto& mipHeader = m_mipHeaders[mipLevel];
+        return AZ::RHI::Size(mipHeader.m_width, mipHeader.m_height, mipHeader.m_depth);
+    }
+
+    uint64_t CloudVolumeFileReader::GetCompressedSizeInBytes() const
+    {
+        uint64_t byteCount = 0;
+        for (uint32_t brickIndex = 0; brickIndex < m_fileHeader.m_brickCount; brickIndex++)
+        {
+            byteCount += m_brickTable[brickIndex].m_compressedSize;
+        }
+        return byteCount;
+    }
+
+    bool CloudVolumeFileReader::DecompressBrick(uint32_t mipLevel, uint32_t brickIndex, uint8_t* dstMipPixels) const
+    {
+        if (!IsOpen() || (mipLevel >= m_fileHeader.m_mipCount))
+        {
+            return false;
+        }
+        const auto& mipHeader = m_mipHeaders[mipLevel];
+        if (brickIndex >= mipHeader.m_bricksX * mipHeader.m_bricksY * mipHeader.m_bricksZ)
+        {
+            return false;
+        }
+        AZStd::vector<uint8_t> scratchBuffer;
+        return DecompressBrickInternal(mipLevel, brickIndex, dstMipPixels, scratchBuffer, nullptr);
+    }
+
+    bool CloudVolumeFileReader::DecompressBrickInternal(uint32_t mipLevel, uint32_t brickIndex, uint8_t* dstMipPixels,
+        AZStd::vector<uint8_t>& scratchBuffer, void* decompressionContext) const
+    {
+        const auto& mipHeader = m_mipHeaders[mipLevel];
+        const auto& brickEntry = m_brickTable[mipHeader.m_firstBrick + brickIndex];
+        const BrickRegion region = GetBrickRegion(mipHeader, m_fileHeader.m_brickSize, brickIndex);
+        const uint32_t bytesPerPixel = m_fileHeader.m_bytesPerPixel;
+        const uint8_t* srcData = m_fileData + brickEntry.m_offset;
+        const bool isContiguous = IsBrickContiguous(mipHeader);
+
+        if (brickEntry.m_compressedSize == brickEntry.m_uncompressedSize)
+        {
+            // Stored raw.
+            if (isContiguous)
+            {
+                memcpy(dstMipPixels + GetBrickMipOffset(mipHeader, region, bytesPerPixel), srcData, brickEntry.m_uncompressedSize);
+                return true;
+            }
+            ForEachBrickRow(mipHeader, region, bytesPerPixel, [&](size_t mipOffset, size_t brickOffset, size_t rowByteCount)
+                {
+                    memcpy(dstMipPixels + mipOffset, srcData + brickOffset, rowByteCount);
+                });
+            return true;
+        }
+
+        // When the rows of the brick are contiguous in the mip level, it is decompressed in place.
+        uint8_t* dstBrick = nullptr;
+        if (isContiguous)
+        {
+            dstBrick = dstMipPixels + GetBrickMipOffset(mipHeader, region, bytesPerPixel);
+        }
+        else
+        {
+            scratchBuffer.resize_no_construct(brickEntry.m_uncompressedSize);
+            dstBrick = scratchBuffer.data();
+        }
+
+        size_t decompressedSize = 0;
+        const auto codec = static_cast<CloudVolumeCodec>(m_fileHeader.m_codec);
+        if (codec == CloudVolumeCodec::LZ4)
+        {
+            const int result = LZ4_decompress_safe(reinterpret_cast<const char*>(srcData), reinterpret_cast<char*>(dstBrick),
+                static_cast<int>(brickEntry.m_compressedSize), static_cast<int>(brickEntry.m_uncompressedSize));
+            decompressedSize = (result > 0) ? static_cast<size_t>(result) : 0;
+        }
+        else if (codec == CloudVolumeCodec::ZStd)
+        {
+            decompressedSize = decompressionContext ?
+                ZSTD_decompressDCtx(static_cast<ZSTD_DCtx*>(decompressionContext), dstBrick, brickEntry.m_uncompressedSize, srcData, brickEntry.m_compressedSize) :
+                ZSTD_decompress(dstBrick, brickEntry.m_uncompressedSize, srcData, brickEntry.m_compressedSize);
+            if (ZSTD_isError(decompressedSize))
+            {
+                decompressedSize = 0;
+            }
+        }
+
+        if (decompressedSize != brickEntry.m_uncompressedSize)
+        {
+            AZ_Error(LogName, false, "Failed to decompress brick %u of mip level %u.", brickIndex, mipLevel);
+            return false;
+        }
+
+        if (!isContiguous)
+        {
+            ForEachBrickRow(mipHeader, region, bytesPerPixel, [&](size_t mipOffset, size_t brickOffset, size_t rowByteCount)
+                {
+                    memcpy(dstMipPixels + mipOffset, dstBrick + brickOffset, rowByteCount);
+                });
+        }
+        return true;
+    }
+
+    bool CloudVolumeFileReader::LoadMipChain(AZStd::vector<CloudTextureMipData>& mipLevels, AZ::JobContext* jobContext) const
+    {
+        if (!IsOpen())
+        {
+            return false;
+        }
+
+        AZStd::vector<CloudTextureMipData> loadedMipLevels(m_fileHeader.m_mipCount);
+        for (uint32_t mipLevel = 0; mipLevel < m_fileHeader.m_mipCount; mipLevel++)
+        {
+            auto& mipData = loadedMipLevels[mipLevel];
+            mipData.m_mipSlice = static_cast<uint16_t>(mipLevel);
+            mipData.m_mipSize = GetMipSize(mipLevel);
+            // ValidateFile() bounded the mip sizes, so this is at most MaxPixelSize^3 pixels.
+            const uint64_t byteCount = static_cast<uint64_t>(mipData.m_mipSize.m_width) * mipData.m_mipSize.m_height
+                * mipData.m_mipSize.m_depth * m_fileHeader.m_bytesPerPixel;
+            mipData.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>();
+            mipData.m_dataBuffer->resize_no_construct(static_cast<size_t>(byteCount));
+        }
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        // The bricks of all the mip levels are spread across the jobs.
+        AZStd::atomic_bool failed{ false };
+        CloudTextureCpuBaker::ForEachSlab(jobContext, m_fileHeader.m_brickCount, [&](uint32_t firstBrick, uint32_t brickCount)
+            {
+                AZStd::vector<uint8_t> scratchBuffer;
+                ZSTD_DCtx* decompressionContext = (m_fileHeader.m_codec == static_cast<uint32_t>(CloudVolumeCodec::ZStd)) ? ZSTD_createDCtx() : nullptr;
+                uint32_t mipLevel = 0;
+                for (uint32_t brickIndex = firstBrick; (brickIndex < firstBrick + brickCount) && !failed; brickIndex++)
+                {
+                    while ((mipLevel + 1 < m_fileHeader.m_mipCount) && (brickIndex >= m_mipHeaders[mipLevel + 1].m_firstBrick))
+                    {
+                        mipLevel++;
+                    }
+                    if (!DecompressBrickInternal(mipLevel, brickIndex - m_mipHeaders[mipLevel].m_firstBrick,
+                        loadedMipLevels[mipLevel].m_dataBuffer->data(), scratchBuffer, decompressionContext))
+                    {
+                        failed = true;
+                    }
+                }
+                ZSTD_freeDCtx(decompressionContext);
+            });
+
+        if (failed)
+        {
+            return false;
+        }
+        mipLevels = AZStd::move(loadedMipLevels);
+        return true;
+    }
+
+} // namespace VolumetricClouds
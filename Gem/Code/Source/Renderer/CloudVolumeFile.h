@@ -0,0 +1,240 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/IO/Path/Path.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/functional.h>
+
+#include <Atom/RHI.Reflect/Format.h>
+
+#include <VolumetricClouds/CloudTextureStats.h>
+#include <Renderer/Passes/CloudTextureComputeData.h>
+#include "CloudTextureMipData.h"
+
+namespace AZ
+{
+    class JobContext;
+}
+
+namespace VolumetricClouds
+{
+    // Compression of the bricks of a .cloudvol file.
+    enum class CloudVolumeCodec : uint32_t
+    {
+        None = 0,
+        // Fast to decode, the default.
+        LZ4 = 1,
+        // Smaller files, slower to decode.
+        ZStd = 2,
+    };
+
+    struct CloudVolumeWriteSettings
+    {
+        CloudVolumeCodec m_codec = CloudVolumeCodec::LZ4;
+        // 0 means the default level of the codec. Only used by ZStd.
+        int32_t m_compressionLevel = 0;
+        // Must be a power of two.
+        uint32_t m_brickSize = 32;
+    };
+
+    // The .cloudvol container for cloud noise volumes.
+    // Unlike DDS, which stores each mip level as one contiguous blob, each mip level is split in
+    // cubic bricks that are compressed independently, so a loader can decompress them in parallel
+    // or only decompress the bricks it needs.
+    // Layout:
+    //     FileHeader
+    //     MipHeader[FileHeader::m_mipCount]
+    //     StatsHeader                           <- Only if FileHeader::m_flags has FlagHasStats.
+    //     ChannelStatsEntry[FileHeader::m_mipCount * StatsHeader::m_channelCount]  <- Mip 0 channels, then mip 1, etc.
+    //     BrickEntry[FileHeader::m_brickCount]  <- All the bricks of mip 0, then mip 1, etc.
+    //     Brick payloads.
+    // Bricks are stored in the same linear order as CloudTextureBrickScheduler, X first, then Y, then Z.
+    // Bricks at the edges of a mip level, or mips smaller than a brick, are clamped to the mip size.
+    // The uncompressed payload of a brick has its rows tightly packed, slice after slice.
+    // A brick whose compressed size equals its uncompressed size is stored raw.
+    // All values are little endian.
+    class CloudVolumeFile final
+    {
+    public:
+        static constexpr char FileExtension[] = ".cloudvol";
+        static constexpr uint32_t DefaultBrickSize = 32;
+        static constexpr uint32_t MaxMipCount = 16;
+
+        // The CloudTextureComputeData that generated the volume.
+        // Only 4 bytes fields, so there's no padding.
+        struct Provenance
+        {
+            uint32_t m_noiseAlgorithmVersion = 0;
+            uint32_t m_pixelSize = 0;
+            float m_frequency = 0.0f;
+            int32_t m_perlinOctaves = 0;
+            float m_perlinGain = 0.0f;
+            float m_perlinAmplitude = 0.0f;
+            int32_t m_worleyOctaves = 0;
+            float m_worleyGain = 0.0f;
+            float m_worleyAmplitude = 0.0f;
+            uint32_t m_mipFilter = 0;
+            uint32_t m_channelLayout = 0;
+        };
+
+        struct FileHeader
+        {
+            static constexpr uint32_t Magic = 0x4C4F5643; // "CVOL"
+            // Version 2 added the optional stats. Version 1 files are still supported.
+            static constexpr uint32_t CurrentVersion = 2;
+            static constexpr uint32_t MinSupportedVersion = 1;
+            // The StatsHeader and the ChannelStatsEntry(s) follow the mip headers.
+            static constexpr uint32_t FlagHasStats = 1u << 0;
+
+            uint32_t m_magic = Magic;
+            uint32_t m_version = CurrentVersion;
+            uint32_t m_codec = 0;
+            uint32_t m_brickSize = DefaultBrickSize;
+            // CloudTextureChannelLayout of the stored pixels. It is not necessarily the same as the
+            // one in the provenance, e.g. the CPU baker always produces RGBA8.
+            uint32_t m_channelLayout = 0;
+            uint32_t m_bytesPerPixel = 0;
+            uint32_t m_mipCount = 0;
+            uint32_t m_brickCount = 0;
+            Provenance m_provenance;
+            // Combination of the Flag* values. Always 0 in version 1.
+            uint32_t m_flags = 0;
+        };
+
+        struct MipHeader
+        {
+            uint32_t m_width = 0;
+            uint32_t m_height = 0;
+            uint32_t m_depth = 0;
+            uint32_t m_bricksX = 0;
+            uint32_t m_bricksY = 0;
+            uint32_t m_bricksZ = 0;
+            // Index, in the brick table, of the first brick of this mip level.
+            uint32_t m_firstBrick = 0;
+            uint32_t m_reserved = 0;
+        };
+
+        // The CloudTextureStats of the stored pixels.
+        struct StatsHeader
+        {
+            uint32_t m_channelCount = 0;
+            uint32_t m_histogramBinCount = CloudTextureChannelStats::HistogramBinCount;
+            // 1 if the channels were renormalized from the source range to [0, 1].
+            uint32_t m_normalized = 0;
+            uint32_t m_reserved = 0;
+            float m_sourceRangeMin[CloudTextureMipStats::MaxChannelCount] = {};
+            float m_sourceRangeMax[CloudTextureMipStats::MaxChannelCount] = {};
+        };
+
+        struct ChannelStatsEntry
+        {
+            float m_min = 0.0f;
+            float m_max = 0.0f;
+            float m_mean = 0.0f;
+            uint32_t m_reserved = 0;
+            uint32_t m_histogram[CloudTextureChannelStats::HistogramBinCount] = {};
+        };
+
+        struct BrickEntry
+        {
+            // From the beginning of the file.
+            uint64_t m_offset = 0;
+            uint32_t m_compressedSize = 0;
+            uint32_t m_uncompressedSize = 0;
+        };
+
+        // Called from the writing thread with the number of uncompressed bytes written since the last call.
+        // Returning false cancels the write.
+        using ProgressCallback = AZStd::function<bool(uint64_t writtenBytes)>;
+
+        static Provenance GetProvenance(const CloudTextureComputeData& computeData);
+        static CloudTextureComputeData GetComputeData(const Provenance& provenance);
+
+        // Number of bricks along each axis for a mip level of @mipSize.
+        static void CalculateBrickGrid(const AZ::RHI::Size& mipSize, uint32_t brickSize,
+            uint32_t& bricksX, uint32_t& bricksY, uint32_t& bricksZ);
+
+        // Compresses the bricks of all the mip levels in jobs, and writes the file from the calling thread.
+        // @format must be the format of one of the CloudTextureChannelLayout(s).
+        // @mipLevels Mip 0 is at most CloudTextureFormat::MaxPixelSize along each axis, and each mip level is half the previous one.
+        // If @jobContext is null the global job context is used, and if there's no job
+        // system at all, the bricks are compressed in the calling thread.
+        // A partially written file is deleted on failure, or if @progressCallback cancels the write.
+        // @stats Optional. Must have been calculated from @mipLevels, otherwise it is not saved.
+        static bool Write(const AZ::IO::Path& filePath, const CloudTextureComputeData& computeData, AZ::RHI::Format format,
+            const AZStd::vector<CloudTextureMipData>& mipLevels, const CloudVolumeWriteSettings& settings = {},
+            const ProgressCallback& progressCallback = nullptr, AZ::JobContext* jobContext = nullptr,
+            const CloudTextureStats* stats = nullptr);
+
+    private:
+        static constexpr char LogName[] = "CloudVolumeFile";
+    };
+
+    // Memory maps a .cloudvol file and decompresses its bricks.
+    // Open() validates the header, the mip chain and the whole brick table, so the decompression functions
+    // never read outside of the mapped file, and the mip buffers are bounded. After Open(), all const functions are thread safe.
+    class CloudVolumeFileReader final
+    {
+    public:
+        CloudVolumeFileReader() = default;
+        ~CloudVolumeFileReader();
+
+        bool Open(const AZ::IO::Path& filePath);
+        void Close();
+        bool IsOpen() const { return m_fileData != nullptr; }
+
+        const CloudVolumeFile::FileHeader& GetFileHeader() const { return m_fileHeader; }
+        // The provenance, plus CloudTextureComputeData::m_normalizeChannelRange from the stats.
+        CloudTextureComputeData GetComputeData() const;
+        // The format of the stored pixels.
+        AZ::RHI::Format GetFormat() const;
+        uint32_t GetMipCount() const { return m_fileHeader.m_mipCount; }
+        AZ::RHI::Size GetMipSize(uint32_t mipLevel) const;
+        const CloudVolumeFile::MipHeader& GetMipHeader(uint32_t mipLevel) const { return m_mipHeaders[mipLevel]; }
+        // The sum of the compressed sizes of all bricks.
+        uint64_t GetCompressedSizeInBytes() const;
+
+        bool HasStats() const { return m_statsHeader != nullptr; }
+        // Returns false if the file has no stats.
+        bool GetStats(CloudTextureStats& stats) const;
+
+        // Decompresses one brick into @dstMipPixels, which must point to the first byte of the whole mip level.
+        bool DecompressBrick(uint32_t mipLevel, uint32_t brickIndex, uint8_t* dstMipPixels) const;
+
+        // Decompresses all the bricks of all the mip levels, in jobs, straight into the mip buffers.
+        // If @jobContext is null the global job context is used, and if there's no job
+        // system at all, the bricks are decompressed in the calling thread.
+        bool LoadMipChain(AZStd::vector<CloudTextureMipData>& mipLevels, AZ::JobContext* jobContext = nullptr) const;
+
+    private:
+        AZ_DISABLE_COPY_MOVE(CloudVolumeFileReader);
+
+        static constexpr char LogName[] = "CloudVolumeFileReader";
+
+        bool ValidateFile();
+        // @decompressionContext is an optional ZSTD_DCtx, reused across the bricks of a job.
+        bool DecompressBrickInternal(uint32_t mipLevel, uint32_t brickIndex, uint8_t* dstMipPixels,
+            AZStd::vector<uint8_t>& scratchBuffer, void* decompressionContext) const;
+
+        const uint8_t* m_fileData = nullptr;
+        size_t m_fileSize = 0;
+#if defined(AZ_PLATFORM_WINDOWS)
+        void* m_fileHandle = nullptr;
+        void* m_mappingHandle = nullptr;
+#endif
+
+        CloudVolumeFile::FileHeader m_fileHeader;
+        AZStd::vector<CloudVolumeFile::MipHeader> m_mipHeaders;
+        const CloudVolumeFile::BrickEntry* m_brickTable = nullptr;
+        // Both null if the file has no stats.
+        const CloudVolumeFile::StatsHeader* m_statsHeader = nullptr;
+        const CloudVolumeFile::ChannelStatsEntry* m_channelStats = nullptr;
+    };
+
+} // namespace VolumetricClouds
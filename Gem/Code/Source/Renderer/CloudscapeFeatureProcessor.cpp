@@ -23,10 +23,16 @@
 #include <Atom/RPI.Public/View.h>
 #include <Atom/RPI.Public/ViewportContext.h>
 #include <Atom/RPI.Public/Image/ImageSystemInterface.h>
+#include <Atom/RPI.Public/Buffer/BufferSystemInterface.h>
 
+#include <Renderer/Cpu/CloudscapeOpticalDepthVolume.h>
+#include <Renderer/Cpu/CloudscapeRaymarchTiles.h>
+#include <Renderer/Cpu/CloudscapeUpsampleFilter.h>
 #include <Renderer/Passes/CloudscapeComputePass.h>
+#include <Renderer/Passes/CloudscapeOpticalDepthPass.h>
 #include <Renderer/Passes/CloudscapeRasterPass.h>
-// #include <Renderer/Passes/DepthBufferCopyPass.h>
+#include <Renderer/Passes/CloudscapeTileClassificationPass.h>
+#include <Renderer/Passes/DepthBufferCopyPass.h>
 #include "CloudscapeFeatureProcessor.h"
 
 namespace VolumetricClouds
@@ -55,11 +61,21 @@ namespace VolumetricClouds
             // This is necessary to avoid pesky error messages of invalid attachments when
             // the feature processor is being destroyed.
             m_cloudscapeComputePass->QueueForRemoval();
+            m_cloudscapeOpticalDepthPass->QueueForRemoval();
+            m_cloudscapeTileClassificationPass->QueueForRemoval();
             m_cloudscapeReprojectionPass->QueueForRemoval();
             m_cloudscapeRenderPass->QueueForRemoval();
-            //m_depthBufferCopyPass->QueueForRemoval();
+            m_depthBufferCopyPass->QueueForRemoval();
         }
 
+        if (m_tileCountReadback)
+        {
+            // Don't get called back once this feature processor is gone.
+            m_tileCountReadback->SetCallback(nullptr);
+            m_tileCountReadback.reset();
+        }
+        m_isTileCountReadbackInFlight = false;
+
         DisableSceneNotification();
         m_viewportSize = { 0,0 };
     }
@@ -68,11 +84,20 @@ namespace VolumetricClouds
     {
         if (m_cloudscapeComputePass)
         {
-            m_cloudscapeComputePass->UpdateFrameCounter(m_frameCounter);
+            m_cloudscapeComputePass->UpdateFrameCounter(m_frameCounter, m_updatePattern);
+            m_cloudscapeTileClassificationPass->UpdateFrameCounter(m_frameCounter, m_updatePattern);
+            if (((m_frameCounter % TileCountReadbackInterval) == 0) && !m_isTileCountReadbackInFlight &&
+                m_cloudscapeTileClassificationPass->IsEnabled())
+            {
+                StartTileCountReadback();
+            }
 
             const auto& passSrg = m_cloudscapeReprojectionPass->GetShaderResourceGroup();
-            const uint32_t pixelIndex4x4 = m_frameCounter % 16;
-            passSrg->SetConstant(m_pixelIndex4x4Index, pixelIndex4x4);
+            uint32_t updatePixelOffset[2];
+            m_updatePattern.GetPixelOffset(m_frameCounter, updatePixelOffset[0], updatePixelOffset[1]);
+            passSrg->SetConstant(m_updateBlockSizeIndex, m_updatePattern.GetBlockSize());
+            passSrg->SetConstant(m_updatePixelOffsetIndex, updatePixelOffset);
+            passSrg->SetConstant(m_outputTextureIndexIndex, m_frameCounter % 2);
 
             m_cloudscapeRenderPass->UpdateFrameCounter(m_frameCounter);
             
@@ -102,6 +127,61 @@ namespace VolumetricClouds
             }
         }
 
+        // The optical depth volume must be ready before the cloudscape is ray marched.
+        AddPassRequestToRenderPipeline(renderPipeline, "Passes/CloudscapeOpticalDepthComputePassRequest.azasset", "CloudscapeComputePass", true /*before*/);
+        // Hold a reference to the compute pass
+        {
+            const auto passName = AZ::Name("CloudscapeOpticalDepthComputePass");
+            AZ::RPI::PassFilter passFilter = AZ::RPI::PassFilter::CreateWithPassName(passName, renderPipeline);
+            AZ::RPI::Pass* existingPass = AZ::RPI::PassSystemInterface::Get()->FindFirstPass(passFilter);
+            m_cloudscapeOpticalDepthPass = azrtti_cast<CloudscapeOpticalDepthPass*>(existingPass);
+            if (!m_cloudscapeOpticalDepthPass)
+            {
+                AZ_Error(LogName, false, "%s Failed to find as RenderPass: %s", __FUNCTION__, passName.GetCStr());
+                return;
+            }
+
+            if (m_shaderConstantData)
+            {
+                m_cloudscapeOpticalDepthPass->UpdateShaderConstantData(*m_shaderConstantData);
+            }
+        }
+
+        // The tile list and the dispatch arguments must be ready before the cloudscape is ray marched.
+        AddPassRequestToRenderPipeline(renderPipeline, "Passes/CloudscapeTileClassificationComputePassRequest.azasset", "CloudscapeComputePass", true /*before*/);
+        // Hold a reference to the compute pass
+        {
+            const auto passName = AZ::Name("CloudscapeTileClassificationComputePass");
+            AZ::RPI::PassFilter passFilter = AZ::RPI::PassFilter::CreateWithPassName(passName, renderPipeline);
+            AZ::RPI::Pass* existingPass = AZ::RPI::PassSystemInterface::Get()->FindFirstPass(passFilter);
+            m_cloudscapeTileClassificationPass = azrtti_cast<CloudscapeTileClassificationPass*>(existingPass);
+            if (!m_cloudscapeTileClassificationPass)
+            {
+                AZ_Error(LogName, false, "%s Failed to find as RenderPass: %s", __FUNCTION__, passName.GetCStr());
+                return;
+            }
+
+            if (m_shaderConstantData)
+            {
+                m_cloudscapeTileClassificationPass->UpdateShaderConstantData(*m_shaderConstantData);
+            }
+        }
+
+        // Once the cloudscape was ray marched, the depth buffer becomes the previous frame depth of the next frame.
+        AddPassRequestToRenderPipeline(renderPipeline, "Passes/DepthBufferCopyPassRequest.azasset", "CloudscapeComputePass", false /*before*/);
+        // Hold a reference to the render pass
+        {
+            const auto passName = AZ::Name("DepthBufferCopyPass");
+            AZ::RPI::PassFilter passFilter = AZ::RPI::PassFilter::CreateWithPassName(passName, renderPipeline);
+            AZ::RPI::Pass* existingPass = AZ::RPI::PassSystemInterface::Get()->FindFirstPass(passFilter);
+            m_depthBufferCopyPass = azrtti_cast<DepthBufferCopyPass*>(existingPass);
+            if (!m_depthBufferCopyPass)
+            {
+                AZ_Error(LogName, false, "%s Failed to find as RenderPass: %s", __FUNCTION__, passName.GetCStr());
+                return;
+            }
+        }
+
         AddPassRequestToRenderPipeline(renderPipeline, "Passes/CloudscapeReprojectionComputePassRequest.azasset", "MotionVectorPass", false /*before*/);
         // Hold a reference to the compute pass
         {
@@ -114,7 +194,7 @@ namespace VolumetricClouds
                 AZ_Error(LogName, false, "%s Failed to find as RenderPass: %s", __FUNCTION__, passName.GetCStr());
                 return;
             }
-            m_cloudscapeReprojectionPass->SetTargetThreadCounts(m_viewportSize.m_width, m_viewportSize.m_height, 1);
+            m_cloudscapeReprojectionPass->SetTargetThreadCounts(m_cloudOutputSize.m_width, m_cloudOutputSize.m_height, 1);
         }
 
 
@@ -143,10 +223,35 @@ namespace VolumetricClouds
     void CloudscapeFeatureProcessor::UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData)
     {
         m_shaderConstantData = &shaderData;
+        UpdateResolutionScale(shaderData.m_resolutionScale);
+        if (shaderData.m_updateBlockSize != m_updatePattern.GetBlockSize())
+        {
+            if (!m_updatePattern.Generate(shaderData.m_updateBlockSize))
+            {
+                AZ_Warning(LogName, false, "Invalid update block size %u. Using %u.", shaderData.m_updateBlockSize,
+                    CloudscapeUpdatePattern::DefaultBlockSize);
+                m_updatePattern.Generate(CloudscapeUpdatePattern::DefaultBlockSize);
+            }
+        }
         if (m_cloudscapeComputePass)
         {
             m_cloudscapeComputePass->UpdateShaderConstantData(shaderData);
         }
+        if (m_cloudscapeOpticalDepthPass)
+        {
+            m_cloudscapeOpticalDepthPass->UpdateShaderConstantData(shaderData);
+        }
+        if (m_cloudscapeTileClassificationPass)
+        {
+            m_cloudscapeTileClassificationPass->UpdateShaderConstantData(shaderData);
+        }
+    }
+
+    void CloudscapeFeatureProcessor::GetRayMarchTileCounts(uint32_t& liveTileCount, uint32_t& totalTileCount) const
+    {
+        AZStd::scoped_lock lock(m_tileCountsMutex);
+        liveTileCount = m_liveTileCount;
+        totalTileCount = m_totalTileCount;
     }
 
     //! Functions called by CloudscapeComponentController END
@@ -159,24 +264,176 @@ namespace VolumetricClouds
         auto viewportContext = viewportContextInterface->GetViewportContextByScene(GetParentScene());
         m_viewportSize = viewportContext->GetViewportSize();
 
-        m_cloudOutput0 = CreateCloudscapeOutputAttachment(AZ::Name("CloudscapeOutput0"), m_viewportSize);
-        AZ_Assert(!!m_cloudOutput0, "Failed to create CloudscapeOutput0");
-        m_cloudOutput1 = CreateCloudscapeOutputAttachment(AZ::Name("CloudscapeOutput1"), m_viewportSize);
-        AZ_Assert(!!m_cloudOutput1, "Failed to create CloudscapeOutput1");
+        CreateCloudscapeOutputs();
+        m_opticalDepthVolume = CreateOpticalDepthVolumeAttachment();
+        AZ_Assert(!!m_opticalDepthVolume, "Failed to create CloudscapeOpticalDepthVolume");
+        m_previousFrameDepthBuffer = CreatePreviousFrameDepthAttachment(m_viewportSize);
+        AZ_Assert(!!m_previousFrameDepthBuffer, "Failed to create CloudscapePreviousFrameDepth");
+        CreateTileBuffers();
+
+        // UpdateShaderConstantData() generates it again when the block size changes.
+        m_updatePattern.Generate(CloudscapeUpdatePattern::DefaultBlockSize);
 
         DisableSceneNotification();
         EnableSceneNotification();
     }
 
 
+    void CloudscapeFeatureProcessor::CreateCloudscapeOutputs()
+    {
+        m_cloudOutputSize.m_width = CloudscapeUpsampleFilter::GetReducedSize(m_viewportSize.m_width, m_resolutionScale);
+        m_cloudOutputSize.m_height = CloudscapeUpsampleFilter::GetReducedSize(m_viewportSize.m_height, m_resolutionScale);
+
+        // The size is part of the name. The attachment images are found by name, and the passes may
+        // still hold the outputs of the previous size until they are built again.
+        for (uint32_t outputIndex = 0; outputIndex < 2; outputIndex++)
+        {
+            const AZStd::string outputName = AZStd::string::format("CloudscapeOutput%u_%ux%u", outputIndex,
+                m_cloudOutputSize.m_width, m_cloudOutputSize.m_height);
+            auto& cloudOutput = (outputIndex == 0) ? m_cloudOutput0 : m_cloudOutput1;
+            cloudOutput = CreateCloudscapeOutputAttachment(AZ::Name(outputName), m_cloudOutputSize, AZ::RHI::Format::R8G8B8A8_UNORM);
+            AZ_Assert(!!cloudOutput, "Failed to create %s", outputName.c_str());
+
+            // The 8 bits store every sample count of CloudscapeTemporalAccumulation exactly.
+            const AZStd::string confidenceName = AZStd::string::format("CloudscapeHistoryConfidence%u_%ux%u", outputIndex,
+                m_cloudOutputSize.m_width, m_cloudOutputSize.m_height);
+            auto& historyConfidence = (outputIndex == 0) ? m_historyConfidence0 : m_historyConfidence1;
+            historyConfidence = CreateCloudscapeOutputAttachment(AZ::Name(confidenceName), m_cloudOutputSize, AZ::RHI::Format::R8_UNORM);
+            AZ_Assert(!!historyConfidence, "Failed to create %s", confidenceName.c_str());
+        }
+    }
+
+    void CloudscapeFeatureProcessor::UpdateResolutionScale(uint32_t resolutionScale)
+    {
+        if ((resolutionScale != 1) && (resolutionScale != 2) && (resolutionScale != 4))
+        {
+            AZ_Warning(LogName, false, "Invalid resolution scale %u. Using full resolution.", resolutionScale);
+            resolutionScale = 1;
+        }
+        if (resolutionScale == m_resolutionScale)
+        {
+            return;
+        }
+        m_resolutionScale = resolutionScale;
+
+        if (m_viewportSize.m_width == 0)
+        {
+            // Not active, ActivateInternal() creates the outputs at this scale.
+            return;
+        }
+        CreateCloudscapeOutputs();
+
+        if (m_cloudscapeComputePass)
+        {
+            // The passes bind the outputs in BuildInternal(), directly or through their connections
+            // to the CloudscapeComputePass.
+            m_cloudscapeComputePass->QueueForBuildAndInitialization();
+            m_cloudscapeTileClassificationPass->QueueForBuildAndInitialization();
+            m_cloudscapeReprojectionPass->QueueForBuildAndInitialization();
+            m_cloudscapeReprojectionPass->SetTargetThreadCounts(m_cloudOutputSize.m_width, m_cloudOutputSize.m_height, 1);
+            m_cloudscapeRenderPass->QueueForBuildAndInitialization();
+        }
+    }
+
     AZ::Data::Instance<AZ::RPI::AttachmentImage> CloudscapeFeatureProcessor::CreateCloudscapeOutputAttachment(const AZ::Name& attachmentName
-        , const AzFramework::WindowSize attachmentSize) const
+        , const AzFramework::WindowSize attachmentSize, AZ::RHI::Format format) const
     {
         AZ::RHI::ImageDescriptor imageDesc = AZ::RHI::ImageDescriptor::Create2D(
-            AZ::RHI::ImageBindFlags::ShaderReadWrite, attachmentSize.m_width, attachmentSize.m_height, AZ::RHI::Format::R8G8B8A8_UNORM);
+            AZ::RHI::ImageBindFlags::ShaderReadWrite, attachmentSize.m_width, attachmentSize.m_height, format);
         AZ::RHI::ClearValue clearValue = AZ::RHI::ClearValue::CreateVector4Float(0, 0, 0, 0);
         AZ::Data::Instance<AZ::RPI::AttachmentImagePool> pool = AZ::RPI::ImageSystemInterface::Get()->GetSystemAttachmentPool();
         return AZ::RPI::AttachmentImage::Create(*pool.get(), imageDesc, attachmentName, &clearValue, nullptr);
     }
 
+    AZ::Data::Instance<AZ::RPI::AttachmentImage> CloudscapeFeatureProcessor::CreateOpticalDepthVolumeAttachment() const
+    {
+        // Its size doesn't depend on the viewport. Half precision is plenty for an optical depth.
+        AZ::RHI::ImageDescriptor imageDesc = AZ::RHI::ImageDescriptor::Create3D(
+            AZ::RHI::ImageBindFlags::ShaderReadWrite, CloudscapeOpticalDepthVolume::Width, CloudscapeOpticalDepthVolume::Height,
+            CloudscapeOpticalDepthVolume::Depth, AZ::RHI::Format::R16_FLOAT);
+        AZ::RHI::ClearValue clearValue = AZ::RHI::ClearValue::CreateVector4Float(0, 0, 0, 0);
+        AZ::Data::Instance<AZ::RPI::AttachmentImagePool> pool = AZ::RPI::ImageSystemInterface::Get()->GetSystemAttachmentPool();
+        return AZ::RPI::AttachmentImage::Create(*pool.get(), imageDesc, AZ::Name("CloudscapeOpticalDepthVolume"), &clearValue, nullptr);
+    }
+
+    AZ::Data::Instance<AZ::RPI::AttachmentImage> CloudscapeFeatureProcessor::CreatePreviousFrameDepthAttachment(const AzFramework::WindowSize attachmentSize) const
+    {
+        // A render target for the DepthBufferCopyPass, and a texture for the cloudscape compute passes.
+        AZ::RHI::ImageDescriptor imageDesc = AZ::RHI::ImageDescriptor::Create2D(
+            AZ::RHI::ImageBindFlags::Color | AZ::RHI::ImageBindFlags::ShaderRead, attachmentSize.m_width, attachmentSize.m_height,
+            AZ::RHI::Format::R32_FLOAT);
+        // Same as the far plane with reverse depth. Until the first copy nothing is hidden in the "previous" frame.
+        AZ::RHI::ClearValue clearValue = AZ::RHI::ClearValue::CreateVector4Float(0, 0, 0, 0);
+        AZ::Data::Instance<AZ::RPI::AttachmentImagePool> pool = AZ::RPI::ImageSystemInterface::Get()->GetSystemAttachmentPool();
+        return AZ::RPI::AttachmentImage::Create(*pool.get(), imageDesc, AZ::Name("CloudscapePreviousFrameDepth"), &clearValue, nullptr);
+    }
+
+    void CloudscapeFeatureProcessor::CreateTileBuffers()
+    {
+        // Same tile grid as CloudscapeTileClassificationPass, for the smallest block size at full resolution,
+        // so the tile list never needs to grow.
+        const uint32_t maxTileCount = CloudscapeRaymarchTiles::GetTileCount(m_viewportSize.m_width, 1) *
+            CloudscapeRaymarchTiles::GetTileCount(m_viewportSize.m_height, 1);
+
+        // Thread group count X, Y and Z, padded to 16 bytes.
+        const uint32_t initialDispatchArgs[4] = { 0, 1, 1, 0 };
+        AZ::RPI::CommonBufferDescriptor argsDesc;
+        argsDesc.m_poolType = AZ::RPI::CommonBufferPoolType::Indirect;
+        argsDesc.m_bufferName = "CloudscapeTileDispatchArgs";
+        argsDesc.m_elementSize = sizeof(uint32_t);
+        argsDesc.m_elementFormat = AZ::RHI::Format::R32_UINT;
+        argsDesc.m_byteCount = sizeof(initialDispatchArgs);
+        argsDesc.m_bufferData = initialDispatchArgs;
+        argsDesc.m_isUniqueName = true;
+        m_tileDispatchArgsBuffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(argsDesc);
+        AZ_Assert(!!m_tileDispatchArgsBuffer, "Failed to create CloudscapeTileDispatchArgs");
+
+        AZ::RPI::CommonBufferDescriptor listDesc;
+        listDesc.m_poolType = AZ::RPI::CommonBufferPoolType::ReadWrite;
+        listDesc.m_bufferName = "CloudscapeTileList";
+        listDesc.m_elementSize = sizeof(uint32_t);
+        listDesc.m_elementFormat = AZ::RHI::Format::R32_UINT;
+        listDesc.m_byteCount = AZStd::max(maxTileCount, 1u) * sizeof(uint32_t);
+        listDesc.m_isUniqueName = true;
+        m_tileListBuffer = AZ::RPI::BufferSystemInterface::Get()->CreateBufferFromCommonPool(listDesc);
+        AZ_Assert(!!m_tileListBuffer, "Failed to create CloudscapeTileList");
+    }
+
+    void CloudscapeFeatureProcessor::StartTileCountReadback()
+    {
+        if (!m_tileCountReadback)
+        {
+            m_tileCountReadback = AZStd::make_shared<AZ::RPI::AttachmentReadback>(AZ::RHI::ScopeId{ "CloudscapeTileCountReadback" });
+            m_tileCountReadback->SetCallback(AZStd::bind(&CloudscapeFeatureProcessor::TileCountReadbackCallback, this, AZStd::placeholders::_1));
+        }
+
+        const uint32_t blockSize = m_updatePattern.GetBlockSize();
+        m_readbackTotalTileCount = CloudscapeRaymarchTiles::GetTileCount(m_cloudOutputSize.m_width, blockSize) *
+            CloudscapeRaymarchTiles::GetTileCount(m_cloudOutputSize.m_height, blockSize);
+
+        // The count is final once the classification pass is done.
+        m_isTileCountReadbackInFlight = m_cloudscapeTileClassificationPass->ReadbackAttachment(m_tileCountReadback, m_frameCounter,
+            AZ::Name("TileDispatchArgs"), AZ::RPI::PassAttachmentReadbackOption::Output);
+        AZ_Error(LogName, m_isTileCountReadbackInFlight, "%s Failed to initialize ReadbackAttachment\n", __FUNCTION__);
+    }
+
+    void CloudscapeFeatureProcessor::TileCountReadbackCallback(const AZ::RPI::AttachmentReadback::ReadbackResult& result)
+    {
+        if ((result.m_state == AZ::RPI::AttachmentReadback::ReadbackState::Success) && !result.m_mipDataBuffers.empty())
+        {
+            const auto& dataBuffer = result.m_mipDataBuffers.front().m_mipBuffer;
+            if (dataBuffer && (dataBuffer->size() >= sizeof(uint32_t)))
+            {
+                // The thread group count X of the indirect dispatch.
+                uint32_t liveTileCount = 0;
+                memcpy(&liveTileCount, dataBuffer->data(), sizeof(uint32_t));
+
+                AZStd::scoped_lock lock(m_tileCountsMutex);
+                m_liveTileCount = liveTileCount;
+                m_totalTileCount = m_readbackTotalTileCount;
+            }
+        }
+        m_isTileCountReadbackInFlight = false;
+    }
+
 } // namespace VolumetricClouds
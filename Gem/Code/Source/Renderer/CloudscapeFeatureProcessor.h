@@ -15,10 +15,15 @@
 #include <Atom/RPI.Public/ViewportContextBus.h>
 #include <Atom/RPI.Public/FeatureProcessor.h>
 #include <Atom/RPI.Public/Pass/ComputePass.h>
+#include <Atom/RPI.Public/Pass/AttachmentReadback.h>
+
+#include <AzCore/std/parallel/atomic.h>
+#include <AzCore/std/parallel/mutex.h>
 
 #include <Renderer/CloudTexturePresentationData.h>
 #include <Renderer/Passes/CloudTextureComputeData.h>
 #include <Renderer/CloudscapeShaderConstantData.h>
+#include <Renderer/Cpu/CloudscapeUpdatePattern.h>
 
 class AZ::RPI::Scene;
 
@@ -38,23 +43,51 @@ namespace VolumetricClouds
 
         void UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData);
 
+        // Number of tiles ray marched by the CloudscapeComputePass in a recent frame, and the total number of tiles
+        // of the screen. See CloudscapeRaymarchTiles. The live tile count is read back from the GPU every few frames,
+        // both are 0 until the first readback completes.
+        void GetRayMarchTileCounts(uint32_t& liveTileCount, uint32_t& totalTileCount) const;
+
     private:
         CloudscapeFeatureProcessor(const CloudscapeFeatureProcessor&) = delete;
 
         friend class CloudscapeComputePass;
+        friend class CloudscapeOpticalDepthPass;
         friend class CloudscapeRasterPass;
-        //friend class DepthBufferCopyPass;
+        friend class CloudscapeTileClassificationPass;
+        friend class DepthBufferCopyPass;
 
         static constexpr char LogName[] = "CloudscapeFeatureProcessor";
 
         void ActivateInternal();
 
+        // Creates m_cloudOutput0, m_cloudOutput1 and their history confidence, at the viewport size divided by m_resolutionScale.
+        void CreateCloudscapeOutputs();
+        // Recreates the outputs, and rebuilds the passes that use them, when @resolutionScale changes.
+        void UpdateResolutionScale(uint32_t resolutionScale);
+
         AZ::Data::Instance<AZ::RPI::AttachmentImage> CreateCloudscapeOutputAttachment(const AZ::Name& attachmentName
-            , const AzFramework::WindowSize attachmentSize) const;
+            , const AzFramework::WindowSize attachmentSize, AZ::RHI::Format format) const;
 
         // Call by the passes owned by this feature processor.
         AZ::Data::Instance<AZ::RPI::AttachmentImage> GetOutput0ImageAttachment() { return m_cloudOutput0; }
         AZ::Data::Instance<AZ::RPI::AttachmentImage> GetOutput1ImageAttachment() { return m_cloudOutput1; }
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> GetHistoryConfidence0ImageAttachment() { return m_historyConfidence0; }
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> GetHistoryConfidence1ImageAttachment() { return m_historyConfidence1; }
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> GetOpticalDepthVolumeImageAttachment() { return m_opticalDepthVolume; }
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> GetPreviousFrameDepthImageAttachment() { return m_previousFrameDepthBuffer; }
+
+        AZ::Data::Instance<AZ::RPI::Buffer> GetTileDispatchArgsBuffer() { return m_tileDispatchArgsBuffer; }
+        AZ::Data::Instance<AZ::RPI::Buffer> GetTileListBuffer() { return m_tileListBuffer; }
+
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> CreateOpticalDepthVolumeAttachment() const;
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> CreatePreviousFrameDepthAttachment(const AzFramework::WindowSize attachmentSize) const;
+        // Creates m_tileDispatchArgsBuffer and m_tileListBuffer.
+        void CreateTileBuffers();
+
+        // Reads back, from m_tileDispatchArgsBuffer, the live tile count of the current frame.
+        void StartTileCountReadback();
+        void TileCountReadbackCallback(const AZ::RPI::AttachmentReadback::ReadbackResult& result);
 
         //////////////////////////////////////////////////////////////////
         //! AZ::RPI::FeatureProcessor overrides START...
@@ -72,32 +105,75 @@ namespace VolumetricClouds
         // Each frame one of the attachments is the current attachment and the other
         // represents the previous frame. This means that for all the passes involved
         // in cloudscape rendering these attachments become "Imported" attachments.
+        // Their size is m_cloudOutputSize, and the CloudscapeRasterPass upsamples them to the viewport size.
         AZ::Data::Instance<AZ::RPI::AttachmentImage> m_cloudOutput0;
         AZ::Data::Instance<AZ::RPI::AttachmentImage> m_cloudOutput1;
 
-        // We need a copy of the previous frame depth buffer, because we reproject 15/16 pixels each frame.
+        // The history confidence of each pixel of m_cloudOutput0 and m_cloudOutput1, written by m_cloudscapeComputePass
+        // and m_cloudscapeReprojectionPass. See CloudscapeTemporalAccumulation.
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_historyConfidence0;
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_historyConfidence1;
+
+        // We need a copy of the previous frame depth buffer, because we reproject (N*N-1)/(N*N) pixels each frame.
         // This causes visible artifacts at the borders of moving objects. The solution is that if
         // in the current frame a pixel is one of those non-raymarched pixels, and it is visible now, but was not visible
         // in the previous frame then we can choose to ray march it, or interpolate it.
-        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_previousFrameDepthBuffer; 
-
-        // We keep track of the number of rendered frames so we can do the modulo 16 and pass
-        // the counter to the Cloudscape passes so they know who is the current frame and who is the
-        // previous frame.
+        // It is also how the pixels hidden by the geometry in both frames are found, see CloudscapeOccludedPixelPolicy.
+        // Written by m_depthBufferCopyPass after m_cloudscapeComputePass, so during the ray marching it still has
+        // the depth of the previous frame.
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_previousFrameDepthBuffer;
+
+        // Optical depth towards the sun, for the cloud slab around the camera. Written each frame
+        // by m_cloudscapeOpticalDepthPass and read by m_cloudscapeComputePass.
+        // See CloudscapeOpticalDepthVolume for the layout.
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_opticalDepthVolume;
+
+        // Written each frame by m_cloudscapeTileClassificationPass, and read by m_cloudscapeComputePass.
+        // The indirect dispatch arguments of m_cloudscapeComputePass, thread group count X, Y and Z, where
+        // X is the number of live tiles. And the list of live tiles, large enough for all the tiles of the screen
+        // with 1x1 blocks. See CloudscapeRaymarchTiles.
+        AZ::Data::Instance<AZ::RPI::Buffer> m_tileDispatchArgsBuffer;
+        AZ::Data::Instance<AZ::RPI::Buffer> m_tileListBuffer;
+
+        // A readback of the live tile count is started every TileCountReadbackInterval frames, if the previous one completed.
+        static constexpr uint32_t TileCountReadbackInterval = 16;
+        AZStd::shared_ptr<AZ::RPI::AttachmentReadback> m_tileCountReadback;
+        AZStd::atomic_bool m_isTileCountReadbackInFlight{ false };
+        // The total tile count when the readback in flight was started.
+        uint32_t m_readbackTotalTileCount = 0;
+        // The readback callback may come from the render thread.
+        mutable AZStd::mutex m_tileCountsMutex;
+        uint32_t m_liveTileCount = 0;
+        uint32_t m_totalTileCount = 0;
+
+        // We keep track of the number of rendered frames so we can pick the ray marched pixel from
+        // m_updatePattern, and pass the counter to the Cloudscape passes so they know who is the current
+        // frame and who is the previous frame.
         uint32_t m_frameCounter = 0;
 
+        // Generated when CloudscapeShaderConstantData::m_updateBlockSize changes.
+        CloudscapeUpdatePattern m_updatePattern;
+
         // The passes managed by this feature processor.
         CloudscapeComputePass* m_cloudscapeComputePass = nullptr;
+        CloudscapeOpticalDepthPass* m_cloudscapeOpticalDepthPass = nullptr;
+        CloudscapeTileClassificationPass* m_cloudscapeTileClassificationPass = nullptr;
         AZ::RPI::ComputePass* m_cloudscapeReprojectionPass = nullptr;
         CloudscapeRasterPass* m_cloudscapeRenderPass = nullptr;
+        DepthBufferCopyPass* m_depthBufferCopyPass = nullptr;
 
         // Shader constants for m_cloudscapeReprojectionPass
-        AZ::RHI::ShaderInputNameIndex m_pixelIndex4x4Index = "m_pixelIndex4x4";
+        AZ::RHI::ShaderInputNameIndex m_updateBlockSizeIndex = "m_updateBlockSize";
+        AZ::RHI::ShaderInputNameIndex m_updatePixelOffsetIndex = "m_updatePixelOffset";
+        AZ::RHI::ShaderInputNameIndex m_outputTextureIndexIndex = "m_outputTextureIndex";
 
         const CloudscapeShaderConstantData* m_shaderConstantData = nullptr;
 
         ////////////////////////////////////////////////////
 
         AzFramework::WindowSize m_viewportSize{0,0};
+        // One of CloudscapeResolutionScale, from CloudscapeShaderConstantData::m_resolutionScale.
+        uint32_t m_resolutionScale = 1;
+        AzFramework::WindowSize m_cloudOutputSize{0,0};
     };
 } // namespace VolumetricClouds
@@ -18,6 +18,33 @@ namespace VolumetricClouds
     AZ_TYPE_INFO_WITH_NAME_IMPL(CloudscapeShaderConstantData, "VolumetricClouds::CloudscapeShaderConstantData", CloudscapeShaderConstantDataTypeId);
     AZ_RTTI_NO_TYPE_INFO_IMPL(CloudscapeShaderConstantData);
 
+    CloudscapeQualitySettings CloudscapeQualitySettings::Get(CloudscapeQualityTier qualityTier)
+    {
+        CloudscapeQualitySettings settings;
+        switch (qualityTier)
+        {
+        case CloudscapeQualityTier::Low:
+            settings.m_lightSampleCount = 3;
+            settings.m_maxOctaves = 2;
+            settings.m_largeStepIncrement = 2;
+            settings.m_dualLobeWeightQuarters = 0;
+            settings.m_highFrequencyDetail = false;
+            break;
+        case CloudscapeQualityTier::Medium:
+            settings.m_lightSampleCount = 4;
+            settings.m_maxOctaves = 2;
+            break;
+        case CloudscapeQualityTier::Ultra:
+            settings.m_lightSampleCount = 8;
+            settings.m_maxOctaves = 4;
+            break;
+        case CloudscapeQualityTier::High:
+        default:
+            break;
+        }
+        return settings;
+    }
+
     void CloudscapeShaderConstantData::Reflect(AZ::ReflectContext* context)
     {
         CloudMaterialProperties::Reflect(context);
@@ -30,6 +57,11 @@ namespace VolumetricClouds
                 ->Field("MaxMipLevels", &CloudscapeShaderConstantData::m_maxMipLevels)
                 ->Field("MinRayMarchingSteps", &CloudscapeShaderConstantData::m_minRayMarchingSteps)
                 ->Field("MaxRayMarchingSteps", &CloudscapeShaderConstantData::m_maxRayMarchingSteps)
+                ->Field("QualityTier", &CloudscapeShaderConstantData::m_qualityTier)
+                ->Field("UpdateBlockSize", &CloudscapeShaderConstantData::m_updateBlockSize)
+                ->Field("ResolutionScale", &CloudscapeShaderConstantData::m_resolutionScale)
+                ->Field("OccludedPixelPolicy", &CloudscapeShaderConstantData::m_occludedPixelPolicy)
+                ->Field("TemporalBlendFactor", &CloudscapeShaderConstantData::m_temporalBlendFactor)
                 ->Field("PlanetRadiusKm", &CloudscapeShaderConstantData::m_planetRadiusKm)
                 ->Field("CloudSlabDistanceAboveSeaLevelKm", &CloudscapeShaderConstantData::m_cloudSlabDistanceAboveSeaLevelKm)
                 ->Field("CloudSlabThicknessKm", &CloudscapeShaderConstantData::m_cloudSlabThicknessKm)
@@ -43,6 +75,8 @@ namespace VolumetricClouds
                 ->Field("WindDirection", &CloudscapeShaderConstantData::m_windDirection)
                 ->Field("CloudTopOffsetKm", &CloudscapeShaderConstantData::m_cloudTopOffsetKm)
                 ->Field("CloudMaterialProperties", &CloudscapeShaderConstantData::m_cloudMaterialProperties)
+                ->Field("UseOpticalDepthVolume", &CloudscapeShaderConstantData::m_useOpticalDepthVolume)
+                ->Field("OpticalDepthVolumeSizeKm", &CloudscapeShaderConstantData::m_opticalDepthVolumeSizeKm)
                 ;
 
             if (auto editContext = serializeContext->GetEditContext())
@@ -66,6 +100,33 @@ namespace VolumetricClouds
                             ->Attribute(AZ::Edit::Attributes::Min, 1)
                             ->Attribute(AZ::Edit::Attributes::Max, 128)
                     ->EndGroup()
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &CloudscapeShaderConstantData::m_qualityTier, "Quality Tier",
+                        "Light samples, scattering octaves, empty space step and detail noise used by the ray marching. Each tier is a different shader variant.")
+                        ->EnumAttribute(CloudscapeQualityTier::Low, "Low")
+                        ->EnumAttribute(CloudscapeQualityTier::Medium, "Medium")
+                        ->EnumAttribute(CloudscapeQualityTier::High, "High")
+                        ->EnumAttribute(CloudscapeQualityTier::Ultra, "Ultra")
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &CloudscapeShaderConstantData::m_updateBlockSize, "Update Block Size",
+                        "Each frame only one pixel of each block is ray marched, the other ones are reprojected. Larger blocks are faster but take longer to converge.")
+                        ->EnumAttribute(CloudscapeUpdateBlockSize::Block1x1, "1x1 (every pixel, every frame)")
+                        ->EnumAttribute(CloudscapeUpdateBlockSize::Block2x2, "2x2")
+                        ->EnumAttribute(CloudscapeUpdateBlockSize::Block3x3, "3x3")
+                        ->EnumAttribute(CloudscapeUpdateBlockSize::Block4x4, "4x4")
+                        ->EnumAttribute(CloudscapeUpdateBlockSize::Block8x8, "8x8")
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &CloudscapeShaderConstantData::m_resolutionScale, "Resolution Scale",
+                        "The clouds are ray marched and reprojected at this fraction of the viewport size, then upsampled following the depth buffer. Half and Quarter are much faster on 4K displays.")
+                        ->EnumAttribute(CloudscapeResolutionScale::Full, "Full")
+                        ->EnumAttribute(CloudscapeResolutionScale::Half, "Half")
+                        ->EnumAttribute(CloudscapeResolutionScale::Quarter, "Quarter")
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &CloudscapeShaderConstantData::m_occludedPixelPolicy, "Occluded Pixel Policy",
+                        "What to do with the pixels where the geometry hides the cloud slab, in this frame and in the previous one. Skip is the fastest, but may show holes in the clouds behind moving objects.")
+                        ->EnumAttribute(CloudscapeOccludedPixelPolicy::RayMarch, "Ray March")
+                        ->EnumAttribute(CloudscapeOccludedPixelPolicy::ReducedSteps, "Reduced Steps")
+                        ->EnumAttribute(CloudscapeOccludedPixelPolicy::Skip, "Skip")
+                    ->DataElement(AZ::Edit::UIHandlers::Slider, &CloudscapeShaderConstantData::m_temporalBlendFactor, "Temporal Blend Factor",
+                        "Minimum weight of each freshly ray marched pixel when it is blended with the previous frames. Lower values average more ray marching noise, so less ray marching steps are needed, but the clouds respond slower to changes. 1 disables the accumulation.")
+                        ->Attribute(AZ::Edit::Attributes::Min, 0.05)
+                        ->Attribute(AZ::Edit::Attributes::Max, 1.0)
                     ->ClassElement(AZ::Edit::ClassElements::Group, "Planetary Data")
                     ->Attribute(AZ::Edit::Attributes::AutoExpand, true)
                         ->DataElement(AZ::Edit::UIHandlers::Default, &CloudscapeShaderConstantData::m_planetRadiusKm, "Planet Radius", "Defaults to Earth Radius = 6371[Km]")
@@ -109,6 +170,14 @@ namespace VolumetricClouds
                             ->Attribute(AZ::Edit::Attributes::Max, 5.0)
                     ->EndGroup()
                     ->DataElement(AZ::Edit::UIHandlers::Default, &CloudscapeShaderConstantData::m_cloudMaterialProperties, "Cloud Material Properties", "")
+                    ->ClassElement(AZ::Edit::ClassElements::Group, "Light Marching")
+                    ->Attribute(AZ::Edit::Attributes::AutoExpand, true)
+                        ->DataElement(AZ::Edit::UIHandlers::Default, &CloudscapeShaderConstantData::m_useOpticalDepthVolume, "Use Optical Depth Volume", "When enabled, the optical depth towards the sun is calculated once per frame in a volume around the camera. When disabled, it is cone sampled at each ray marching step, which is slower.")
+                        ->DataElement(AZ::Edit::UIHandlers::Slider, &CloudscapeShaderConstantData::m_opticalDepthVolumeSizeKm, "Optical Depth Volume Size", "Length of each side of the optical depth volume, centered around the camera. Beyond it the optical depth is cone sampled.")
+                            ->Attribute(AZ::Edit::Attributes::Suffix, " Km")
+                            ->Attribute(AZ::Edit::Attributes::Min, 4.0)
+                            ->Attribute(AZ::Edit::Attributes::Max, 200.0)
+                    ->EndGroup()
                     ;
             }
         }
@@ -121,6 +190,11 @@ namespace VolumetricClouds
                (m_maxMipLevels == rhs.m_maxMipLevels) &&
                (m_minRayMarchingSteps == rhs.m_minRayMarchingSteps) &&
                (m_maxRayMarchingSteps == rhs.m_maxRayMarchingSteps) &&
+               (m_qualityTier == rhs.m_qualityTier) &&
+               (m_updateBlockSize == rhs.m_updateBlockSize) &&
+               (m_resolutionScale == rhs.m_resolutionScale) &&
+               (m_occludedPixelPolicy == rhs.m_occludedPixelPolicy) &&
+               AZ::IsClose(m_temporalBlendFactor, rhs.m_temporalBlendFactor) &&
                (m_planetRadiusKm ==  rhs.m_planetRadiusKm) &&
                AZ::IsClose(m_cloudSlabDistanceAboveSeaLevelKm, rhs.m_cloudSlabDistanceAboveSeaLevelKm) &&
                AZ::IsClose(m_cloudSlabThicknessKm, rhs.m_cloudSlabThicknessKm) &&
@@ -133,7 +207,9 @@ namespace VolumetricClouds
                AZ::IsClose(m_windSpeedKmPerSec, rhs.m_windSpeedKmPerSec) &&
                m_windDirection.IsClose(rhs.m_windDirection) &&
                AZ::IsClose(m_cloudTopOffsetKm, rhs.m_cloudTopOffsetKm) &&
-               (m_cloudMaterialProperties == rhs.m_cloudMaterialProperties)
+               (m_cloudMaterialProperties == rhs.m_cloudMaterialProperties) &&
+               (m_useOpticalDepthVolume == rhs.m_useOpticalDepthVolume) &&
+               AZ::IsClose(m_opticalDepthVolumeSizeKm, rhs.m_opticalDepthVolumeSizeKm)
                ;
     }
 
@@ -17,6 +17,71 @@
 
 namespace VolumetricClouds
 {
+    // Performance/quality tradeoff of the ray marching in CloudscapeCS.azsl.
+    // Each tier is a set of static shader options, see CloudscapeQualitySettings,
+    // baked as its own variant in CloudscapeCS.shadervariantlist.
+    enum class CloudscapeQualityTier : uint32_t
+    {
+        Low = 0,
+        Medium = 1,
+        High = 2,
+        Ultra = 3,
+    };
+
+    // The values of the quality shader options of CloudscapeCS.azsl for a CloudscapeQualityTier.
+    struct CloudscapeQualitySettings
+    {
+        // o_lightSampleCount. Cone samples towards the sun. At most 12.
+        uint32_t m_lightSampleCount = 6;
+        // o_maxOctaves. Octaves of multiple scattering.
+        uint32_t m_maxOctaves = 3;
+        // o_largeStepIncrement. Steps taken at once while sampling cheaply in empty space.
+        uint32_t m_largeStepIncrement = 1;
+        // o_dualLobeWeightQuarters. Weight of the backward lobe of the phase function, in quarters.
+        uint32_t m_dualLobeWeightQuarters = 3;
+        // o_highFrequencyDetail.
+        bool m_highFrequencyDetail = true;
+
+        // Must match the variants in CloudscapeCS.shadervariantlist.
+        static CloudscapeQualitySettings Get(CloudscapeQualityTier qualityTier);
+    };
+
+    // Size of the blocks of pixels in which only one pixel is ray marched per frame.
+    // See CloudscapeUpdatePattern.
+    enum class CloudscapeUpdateBlockSize : uint32_t
+    {
+        Block1x1 = 1,
+        Block2x2 = 2,
+        Block3x3 = 3,
+        Block4x4 = 4,
+        Block8x8 = 8,
+    };
+
+    // Fraction of the viewport size at which the cloudscape is ray marched and reprojected.
+    // Cloudscape.azsl upsamples it with a joint bilateral filter, see CloudscapeUpsampleFilter.
+    enum class CloudscapeResolutionScale : uint32_t
+    {
+        Full = 1,
+        Half = 2,
+        Quarter = 4,
+    };
+
+    // What CloudscapeCS.azsl does with the pixels where the geometry hides the cloud slab, in the current frame
+    // and in the previous one, see the previous frame depth copied by the DepthBufferCopyPass.
+    // Pixels hidden only in one of the two frames are always ray marched, so the reprojection has
+    // valid clouds to show when the geometry moves.
+    enum class CloudscapeOccludedPixelPolicy : uint32_t
+    {
+        // Ray marched as any other pixel.
+        RayMarch = 0,
+        // Ray marched with a quarter of the steps. Cheaper, and still good enough for the
+        // reprojection if the pixel shows up later.
+        ReducedSteps = 1,
+        // Not ray marched, and the tiles where all pixels are hidden are culled.
+        // Fastest, but the pixels that show up later are reprojected as empty sky until they are ray marched again.
+        Skip = 2,
+    };
+
     // Consolidates all the data for the shader constants needed
     // by the cloudscape shader.
     // See declaration of CloudscapeComponentConfig for details on each parameter.
@@ -52,6 +117,22 @@ namespace VolumetricClouds
         uint8_t m_minRayMarchingSteps = 32;
         uint8_t m_maxRayMarchingSteps = 64;
 
+        // One of CloudscapeQualityTier. High matches the values that used to be hard coded in CloudscapeCS.azsl.
+        uint32_t m_qualityTier = static_cast<uint32_t>(CloudscapeQualityTier::High);
+        // One of CloudscapeUpdateBlockSize. Each frame only one pixel of each block is ray marched, and the
+        // other ones are reprojected from the previous frame. Every pixel is ray marched once every N x N frames.
+        uint32_t m_updateBlockSize = static_cast<uint32_t>(CloudscapeUpdateBlockSize::Block4x4);
+        // One of CloudscapeResolutionScale. The viewport size is divided by this value. Combines with @m_updateBlockSize,
+        // the blocks are made of reduced resolution pixels.
+        uint32_t m_resolutionScale = static_cast<uint32_t>(CloudscapeResolutionScale::Full);
+        // One of CloudscapeOccludedPixelPolicy. The tiles where no ray reaches the cloud slab are never ray marched,
+        // see CloudscapeRaymarchTiles. This is for the pixels where the geometry hides the cloud slab.
+        uint32_t m_occludedPixelPolicy = static_cast<uint32_t>(CloudscapeOccludedPixelPolicy::ReducedSteps);
+        // Minimum weight of each fresh ray marched pixel when it is blended with its history, see CloudscapeTemporalAccumulation.
+        // The lower, the more ray marching noise is averaged over time, and the slower the clouds respond to changes.
+        // 1 disables the accumulation.
+        float m_temporalBlendFactor = 0.2f;
+
         float m_planetRadiusKm = 6371.0f; // TODO: Get this value from Sky Atmosphere Component.
         // Distance, above sea level, where the cloud slab begins.
         float m_cloudSlabDistanceAboveSeaLevelKm = 1.5f;
@@ -68,6 +149,14 @@ namespace VolumetricClouds
 
         CloudMaterialProperties m_cloudMaterialProperties;
 
+        // When true, the optical depth towards the sun is calculated once per frame in a volume
+        // around the camera, see CloudscapeOpticalDepthVolume, and each ray marching step reads it
+        // with a single fetch. When false, each ray marching step cone samples the cloud density towards the sun.
+        bool m_useOpticalDepthVolume = true;
+        // Length of each side of the square, centered around the camera, covered by the optical depth volume.
+        // Beyond it the cone sampling is used.
+        float m_opticalDepthVolumeSizeKm = 48.0f;
+
         //////////////////////////////////////////////////////////////
         // ******************* Weather Data Start
         // The weather map is a texture representing a squared area.
@@ -92,6 +181,11 @@ namespace VolumetricClouds
         // B: Peak height.
         // A: density
         AZ::Data::Instance<AZ::RPI::Image> m_weatherMap; // DO NOT REFLECT
+        // Max pyramid of @m_weatherMap, built on the CPU, see WeatherMapPyramid. Used to skip
+        // the empty space of the cloud slab during ray marching. While it is being built,
+        // @m_weatherMapPyramidLevels is 0 and every step is ray marched.
+        AZ::Data::Instance<AZ::RPI::Image> m_weatherMapPyramid; // DO NOT REFLECT
+        uint32_t m_weatherMapPyramidLevels = 0; // DO NOT REFLECT
         // ******************* Weather Data End
         //////////////////////////////////////////////////////////////
 
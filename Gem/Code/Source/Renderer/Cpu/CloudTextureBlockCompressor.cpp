@@ -0,0 +1,825 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/limits.h>
+
+#include <cmath>
+
+#include "CloudTextureCpuBaker.h"
+#include "CloudTextureBlockCompressor.h"
+
+namespace VolumetricClouds
+{
+    namespace
+    {
+        // Interpolation weights of the 2 and 4 bits indices, out of 64.
+        constexpr uint32_t BC7Weights2[4] = { 0, 21, 43, 64 };
+        constexpr uint32_t BC7Weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+        // The mode is the position of the first bit set.
+        constexpr uint32_t BC7Mode5Bit = 1 << 5;
+        constexpr uint32_t BC7Mode6Bit = 1 << 6;
+
+        // Bits are stored LSB first, starting at bit 0 of byte 0.
+        class BlockBitWriter
+        {
+        public:
+            explicit BlockBitWriter(uint8_t* block) : m_block(block) {}
+
+            void Write(uint32_t value, uint32_t bitCount)
+            {
+                for (uint32_t i = 0; i < bitCount; i++, m_bitPosition++)
+                {
+                    if ((value >> i) & 1)
+                    {
+                        m_block[m_bitPosition >> 3] |= static_cast<uint8_t>(1 << (m_bitPosition & 7));
+                    }
+                }
+            }
+
+        private:
+            uint8_t* m_block;
+            uint32_t m_bitPosition = 0;
+        };
+
+        class BlockBitReader
+        {
+        public:
+            explicit BlockBitReader(const uint8_t* block) : m_block(block) {}
+
+            uint32_t Read(uint32_t bitCount)
+            {
+                uint32_t value = 0;
+                for (uint32_t i = 0; i < bitCount; i++, m_bitPosition++)
+                {
+                    value |= ((m_block[m_bitPosition >> 3] >> (m_bitPosition & 7)) & 1u) << i;
+                }
+                return value;
+            }
+
+        private:
+            const uint8_t* m_block;
+            uint32_t m_bitPosition = 0;
+        };
+
+        void GetBC4Palette(uint8_t alpha0, uint8_t alpha1, uint8_t palette[8])
+        {
+            palette[0] = alpha0;
+            palette[1] = alpha1;
+            if (alpha0 > alpha1)
+            {
+                for (uint32_t i = 1; i < 7; i++)
+                {
+                    palette[i + 1] = static_cast<uint8_t>(((7 - i) * alpha0 + i * alpha1 + 3) / 7);
+                }
+            }
+            else
+            {
+                for (uint32_t i = 1; i < 5; i++)
+                {
+                    palette[i + 1] = static_cast<uint8_t>(((5 - i) * alpha0 + i * alpha1 + 2) / 5);
+                }
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+        }
+
+        // Returns the sum of the squared errors.
+        uint32_t FindBC4Indices(const uint8_t values[16], uint8_t alpha0, uint8_t alpha1, uint8_t indices[16])
+        {
+            uint8_t palette[8];
+            GetBC4Palette(alpha0, alpha1, palette);
+            uint32_t totalError = 0;
+            for (uint32_t pixel = 0; pixel < 16; pixel++)
+            {
+                uint32_t bestError = AZStd::numeric_limits<uint32_t>::max();
+                for (uint32_t entry = 0; entry < 8; entry++)
+                {
+                    const int32_t diff = static_cast<int32_t>(values[pixel]) - static_cast<int32_t>(palette[entry]);
+                    const uint32_t error = static_cast<uint32_t>(diff * diff);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        indices[pixel] = static_cast<uint8_t>(entry);
+                    }
+                }
+                totalError += bestError;
+            }
+            return totalError;
+        }
+
+        uint8_t InterpolateBC7(uint8_t endpoint0, uint8_t endpoint1, uint32_t weight)
+        {
+            return static_cast<uint8_t>(((64 - weight) * endpoint0 + weight * endpoint1 + 32) >> 6);
+        }
+
+        // Maps an unquantized endpoint to the closest representable one, as 8 bits values.
+        using EndpointQuantizer = void(*)(const float endpoint[4], uint32_t channelCount, uint8_t quantized[4]);
+
+        // Mode 6: 7 bits per channel plus one p-bit shared by all channels. The p-bit is the LSB of the values.
+        void QuantizeMode6Endpoint(const float endpoint[4], uint32_t channelCount, uint8_t quantized[4])
+        {
+            float bestError = AZStd::numeric_limits<float>::max();
+            for (uint32_t pBit = 0; pBit < 2; pBit++)
+            {
+                uint8_t candidate[4];
+                float error = 0.0f;
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    const float bits7 = AZStd::clamp(std::floor((endpoint[channel] - pBit) * 0.5f + 0.5f), 0.0f, 127.0f);
+                    candidate[channel] = static_cast<uint8_t>((static_cast<uint32_t>(bits7) << 1) | pBit);
+                    const float diff = static_cast<float>(candidate[channel]) - endpoint[channel];
+                    error += diff * diff;
+                }
+                if (error < bestError)
+                {
+                    bestError = error;
+                    memcpy(quantized, candidate, channelCount);
+                }
+            }
+        }
+
+        // Mode 5 color: 7 bits per channel, expanded to 8 bits by replicating the MSB.
+        void QuantizeMode5ColorEndpoint(const float endpoint[4], uint32_t channelCount, uint8_t quantized[4])
+        {
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                const int32_t center = static_cast<int32_t>(endpoint[channel] * (127.0f / 255.0f) + 0.5f);
+                float bestError = AZStd::numeric_limits<float>::max();
+                for (int32_t bits7 = AZStd::max(center - 1, 0); bits7 <= AZStd::min(center + 1, 127); bits7++)
+                {
+                    const uint8_t value = static_cast<uint8_t>((bits7 << 1) | (bits7 >> 6));
+                    const float error = std::fabs(static_cast<float>(value) - endpoint[channel]);
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        quantized[channel] = value;
+                    }
+                }
+            }
+        }
+
+        // Mode 5 alpha: 8 bits.
+        void QuantizeMode5AlphaEndpoint(const float endpoint[4], uint32_t channelCount, uint8_t quantized[4])
+        {
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                quantized[channel] = static_cast<uint8_t>(AZStd::clamp(endpoint[channel], 0.0f, 255.0f) + 0.5f);
+            }
+        }
+
+        // Returns the sum of the squared errors of the @channelCount @channels.
+        uint32_t FindBC7Indices(const uint8_t rgba[64], const uint32_t* channels, uint32_t channelCount,
+            const uint8_t endpoint0[4], const uint8_t endpoint1[4], const uint32_t* weights, uint32_t weightCount, uint8_t indices[16])
+        {
+            uint8_t palette[16][4];
+            for (uint32_t entry = 0; entry < weightCount; entry++)
+            {
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    palette[entry][channel] = InterpolateBC7(endpoint0[channel], endpoint1[channel], weights[entry]);
+                }
+            }
+
+            uint32_t totalError = 0;
+            for (uint32_t pixel = 0; pixel < 16; pixel++)
+            {
+                const uint8_t* color = rgba + pixel * 4;
+                uint32_t bestError = AZStd::numeric_limits<uint32_t>::max();
+                for (uint32_t entry = 0; entry < weightCount; entry++)
+                {
+                    uint32_t error = 0;
+                    for (uint32_t channel = 0; channel < channelCount; channel++)
+                    {
+                        const int32_t diff = static_cast<int32_t>(color[channels[channel]]) - static_cast<int32_t>(palette[entry][channel]);
+                        error += static_cast<uint32_t>(diff * diff);
+                    }
+                    if (error < bestError)
+                    {
+                        bestError = error;
+                        indices[pixel] = static_cast<uint8_t>(entry);
+                    }
+                }
+                totalError += bestError;
+            }
+            return totalError;
+        }
+
+        // Principal axis of the @channels of the pixels, by power iteration on the covariance matrix.
+        // Returns a zero vector if all the pixels are the same.
+        void CalculatePrincipalAxis(const uint8_t rgba[64], const uint32_t* channels, uint32_t channelCount,
+            const float mean[4], float axis[4])
+        {
+            float covariance[4][4] = {};
+            for (uint32_t pixel = 0; pixel < 16; pixel++)
+            {
+                float centered[4];
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    centered[channel] = static_cast<float>(rgba[pixel * 4 + channels[channel]]) - mean[channel];
+                }
+                for (uint32_t row = 0; row < channelCount; row++)
+                {
+                    for (uint32_t column = 0; column < channelCount; column++)
+                    {
+                        covariance[row][column] += centered[row] * centered[column];
+                    }
+                }
+            }
+
+            // Start with the column of the channel with the largest variance.
+            uint32_t largestChannel = 0;
+            for (uint32_t channel = 1; channel < channelCount; channel++)
+            {
+                if (covariance[channel][channel] > covariance[largestChannel][largestChannel])
+                {
+                    largestChannel = channel;
+                }
+            }
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                axis[channel] = covariance[channel][largestChannel];
+            }
+
+            constexpr uint32_t PowerIterations = 8;
+            for (uint32_t iteration = 0; iteration < PowerIterations; iteration++)
+            {
+                float nextAxis[4] = {};
+                for (uint32_t row = 0; row < channelCount; row++)
+                {
+                    for (uint32_t column = 0; column < channelCount; column++)
+                    {
+                        nextAxis[row] += covariance[row][column] * axis[column];
+                    }
+                }
+                float lengthSq = 0.0f;
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    lengthSq += nextAxis[channel] * nextAxis[channel];
+                }
+                if (lengthSq < 1e-12f)
+                {
+                    axis[0] = axis[1] = axis[2] = axis[3] = 0.0f;
+                    return;
+                }
+                const float invLength = 1.0f / std::sqrt(lengthSq);
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    axis[channel] = nextAxis[channel] * invLength;
+                }
+            }
+        }
+
+        // Fits a pair of endpoints to the @channels of the pixels, and picks the index of each pixel.
+        // The initial endpoints are the extremes of the pixels projected on their principal axis,
+        // followed by a few least squares refinements. Returns the sum of the squared errors.
+        uint32_t FitBC7Endpoints(const uint8_t rgba[64], const uint32_t* channels, uint32_t channelCount,
+            const uint32_t* weights, uint32_t weightCount, EndpointQuantizer quantize,
+            uint8_t endpoint0[4], uint8_t endpoint1[4], uint8_t indices[16])
+        {
+            float mean[4] = {};
+            for (uint32_t pixel = 0; pixel < 16; pixel++)
+            {
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    mean[channel] += static_cast<float>(rgba[pixel * 4 + channels[channel]]);
+                }
+            }
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                mean[channel] /= 16.0f;
+            }
+
+            float axis[4];
+            CalculatePrincipalAxis(rgba, channels, channelCount, mean, axis);
+            float minProjection = 0.0f;
+            float maxProjection = 0.0f;
+            for (uint32_t pixel = 0; pixel < 16; pixel++)
+            {
+                float projection = 0.0f;
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    projection += (static_cast<float>(rgba[pixel * 4 + channels[channel]]) - mean[channel]) * axis[channel];
+                }
+                minProjection = AZStd::min(minProjection, projection);
+                maxProjection = AZStd::max(maxProjection, projection);
+            }
+            float endpoints[2][4];
+            for (uint32_t channel = 0; channel < channelCount; channel++)
+            {
+                endpoints[0][channel] = AZStd::clamp(mean[channel] + minProjection * axis[channel], 0.0f, 255.0f);
+                endpoints[1][channel] = AZStd::clamp(mean[channel] + maxProjection * axis[channel], 0.0f, 255.0f);
+            }
+
+            quantize(endpoints[0], channelCount, endpoint0);
+            quantize(endpoints[1], channelCount, endpoint1);
+            uint32_t bestError = FindBC7Indices(rgba, channels, channelCount, endpoint0, endpoint1, weights, weightCount, indices);
+
+            constexpr uint32_t RefinementIterations = 2;
+            for (uint32_t iteration = 0; (iteration < RefinementIterations) && (bestError > 0); iteration++)
+            {
+                float sumAA = 0.0f, sumAB = 0.0f, sumBB = 0.0f;
+                float sumAX[4] = {}, sumBX[4] = {};
+                for (uint32_t pixel = 0; pixel < 16; pixel++)
+                {
+                    const float b = static_cast<float>(weights[indices[pixel]]) / 64.0f;
+                    const float a = 1.0f - b;
+                    sumAA += a * a;
+                    sumAB += a * b;
+                    sumBB += b * b;
+                    for (uint32_t channel = 0; channel < channelCount; channel++)
+                    {
+                        const float x = static_cast<float>(rgba[pixel * 4 + channels[channel]]);
+                        sumAX[channel] += a * x;
+                        sumBX[channel] += b * x;
+                    }
+                }
+                const float determinant = sumAA * sumBB - sumAB * sumAB;
+                if (std::fabs(determinant) < 1e-6f)
+                {
+                    break;
+                }
+                const float invDeterminant = 1.0f / determinant;
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    endpoints[0][channel] = AZStd::clamp((sumBB * sumAX[channel] - sumAB * sumBX[channel]) * invDeterminant, 0.0f, 255.0f);
+                    endpoints[1][channel] = AZStd::clamp((sumAA * sumBX[channel] - sumAB * sumAX[channel]) * invDeterminant, 0.0f, 255.0f);
+                }
+
+                uint8_t candidate0[4];
+                uint8_t candidate1[4];
+                uint8_t candidateIndices[16];
+                quantize(endpoints[0], channelCount, candidate0);
+                quantize(endpoints[1], channelCount, candidate1);
+                const uint32_t error = FindBC7Indices(rgba, channels, channelCount, candidate0, candidate1, weights, weightCount, candidateIndices);
+                if (error >= bestError)
+                {
+                    break;
+                }
+                bestError = error;
+                memcpy(endpoint0, candidate0, channelCount);
+                memcpy(endpoint1, candidate1, channelCount);
+                memcpy(indices, candidateIndices, 16);
+            }
+            return bestError;
+        }
+
+        // The most significant bit of the index of the anchor pixel (pixel 0) is implicitly zero.
+        void FixBC7Anchor(uint8_t endpoint0[4], uint8_t endpoint1[4], uint8_t indices[16], uint32_t indexBits)
+        {
+            const uint32_t maxIndex = (1u << indexBits) - 1;
+            if (indices[0] <= (maxIndex >> 1))
+            {
+                return;
+            }
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                AZStd::swap(endpoint0[channel], endpoint1[channel]);
+            }
+            for (uint32_t pixel = 0; pixel < 16; pixel++)
+            {
+                indices[pixel] = static_cast<uint8_t>(maxIndex - indices[pixel]);
+            }
+        }
+    } // namespace
+
+    AZ::RHI::Format CloudTextureBlockCompressor::GetFormat(CloudTextureCompression compression)
+    {
+        switch (compression)
+        {
+        case CloudTextureCompression::BC4:
+            return AZ::RHI::Format::BC4_UNORM;
+        case CloudTextureCompression::BC5:
+            return AZ::RHI::Format::BC5_UNORM;
+        case CloudTextureCompression::BC7:
+            return AZ::RHI::Format::BC7_UNORM;
+        default:
+            return AZ::RHI::Format::Unknown;
+        }
+    }
+
+    uint32_t CloudTextureBlockCompressor::GetChannelCount(CloudTextureCompression compression)
+    {
+        switch (compression)
+        {
+        case CloudTextureCompression::BC4:
+            return 1;
+        case CloudTextureCompression::BC5:
+            return 2;
+        default:
+            return 4;
+        }
+    }
+
+    uint32_t CloudTextureBlockCompressor::GetBytesPerBlock(CloudTextureCompression compression)
+    {
+        switch (compression)
+        {
+        case CloudTextureCompression::BC4:
+            return 8;
+        case CloudTextureCompression::BC5:
+        case CloudTextureCompression::BC7:
+            return 16;
+        default:
+            return PixelsPerBlock * BytesPerPixel;
+        }
+    }
+
+    size_t CloudTextureBlockCompressor::CalculateMipSizeInBytes(CloudTextureCompression compression, const AZ::RHI::Size& mipSize)
+    {
+        const size_t blocksX = (mipSize.m_width + BlockDimension - 1) / BlockDimension;
+        const size_t blocksY = (mipSize.m_height + BlockDimension - 1) / BlockDimension;
+        return blocksX * blocksY * mipSize.m_depth * GetBytesPerBlock(compression);
+    }
+
+    AZStd::vector<CloudTextureBlockCompressor::CompressedMipLevel> CloudTextureBlockCompressor::Compress(
+        CloudTextureCompression compression, uint32_t firstChannel,
+        const AZStd::vector<CloudTextureMipData>& mipLevels, AZ::JobContext* jobContext)
+    {
+        if (compression == CloudTextureCompression::None)
+        {
+            AZ_Error(LogName, false, "Nothing to compress.");
+            return {};
+        }
+        if (compression == CloudTextureCompression::BC7)
+        {
+            firstChannel = 0;
+        }
+        if (firstChannel + GetChannelCount(compression) > BytesPerPixel)
+        {
+            AZ_Error(LogName, false, "Invalid first channel=%u for %u channels.", firstChannel, GetChannelCount(compression));
+            return {};
+        }
+
+        AZStd::vector<CompressedMipLevel> compressedMips(mipLevels.size());
+        // The first slice of each mip in the list of all slices.
+        AZStd::vector<uint32_t> firstSliceOfMip(mipLevels.size() + 1, 0);
+        for (size_t mipIndex = 0; mipIndex < mipLevels.size(); mipIndex++)
+        {
+            const auto& mipSize = mipLevels[mipIndex].m_mipSize;
+            const size_t expectedSize = static_cast<size_t>(mipSize.m_width) * mipSize.m_height * mipSize.m_depth * BytesPerPixel;
+            if (!mipLevels[mipIndex].m_dataBuffer || (mipLevels[mipIndex].m_dataBuffer->size() < expectedSize))
+            {
+                AZ_Error(LogName, false, "Mip level %zu has no data, or less data than expected.", mipIndex);
+                return {};
+            }
+            compressedMips[mipIndex].m_mipSize = mipSize;
+            compressedMips[mipIndex].m_data.resize_no_construct(CalculateMipSizeInBytes(compression, mipSize));
+            firstSliceOfMip[mipIndex + 1] = firstSliceOfMip[mipIndex] + mipSize.m_depth;
+        }
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        // All the slices, of all the mips, are independent work items. The small mips
+        // have few slices, so they would barely use the workers if each mip was compressed on its own.
+        const uint32_t totalSliceCount = firstSliceOfMip.back();
+        AZStd::vector<uint64_t> sliceSquaredErrors(totalSliceCount, 0);
+        CloudTextureCpuBaker::ForEachSlab(jobContext, totalSliceCount,
+            [&](uint32_t firstSlice, uint32_t sliceCount)
+            {
+                for (uint32_t slice = firstSlice; slice < firstSlice + sliceCount; slice++)
+                {
+                    const auto mipItor = AZStd::upper_bound(firstSliceOfMip.begin(), firstSliceOfMip.end(), slice);
+                    const size_t mipIndex = AZStd::distance(firstSliceOfMip.begin(), mipItor) - 1;
+                    const uint32_t z = slice - firstSliceOfMip[mipIndex];
+                    const auto& mipSize = mipLevels[mipIndex].m_mipSize;
+
+                    const size_t srcSlicePitch = static_cast<size_t>(mipSize.m_width) * mipSize.m_height * BytesPerPixel;
+                    const size_t dstSlicePitch = compressedMips[mipIndex].m_data.size() / mipSize.m_depth;
+                    sliceSquaredErrors[slice] = CompressSlice(compression, firstChannel,
+                        mipLevels[mipIndex].m_dataBuffer->data() + srcSlicePitch * z, mipSize.m_width, mipSize.m_height,
+                        compressedMips[mipIndex].m_data.data() + dstSlicePitch * z);
+                }
+            });
+
+        const uint32_t channelCount = GetChannelCount(compression);
+        for (size_t mipIndex = 0; mipIndex < mipLevels.size(); mipIndex++)
+        {
+            uint64_t squaredError = 0;
+            for (uint32_t slice = firstSliceOfMip[mipIndex]; slice < firstSliceOfMip[mipIndex + 1]; slice++)
+            {
+                squaredError += sliceSquaredErrors[slice];
+            }
+
+            const auto& mipSize = mipLevels[mipIndex].m_mipSize;
+            const double sampleCount = static_cast<double>(mipSize.m_width) * mipSize.m_height * mipSize.m_depth * channelCount;
+            if (squaredError == 0)
+            {
+                compressedMips[mipIndex].m_psnr = AZStd::numeric_limits<double>::infinity();
+            }
+            else
+            {
+                const double meanSquaredError = static_cast<double>(squaredError) / sampleCount;
+                compressedMips[mipIndex].m_psnr = 10.0 * std::log10((255.0 * 255.0) / meanSquaredError);
+            }
+        }
+
+        return compressedMips;
+    }
+
+    uint64_t CloudTextureBlockCompressor::CompressSlice(CloudTextureCompression compression, uint32_t firstChannel,
+        const uint8_t* srcSlice, uint32_t width, uint32_t height, uint8_t* dstSlice)
+    {
+        const uint32_t blocksX = (width + BlockDimension - 1) / BlockDimension;
+        const uint32_t blocksY = (height + BlockDimension - 1) / BlockDimension;
+        const uint32_t bytesPerBlock = GetBytesPerBlock(compression);
+        const uint32_t channelCount = GetChannelCount(compression);
+
+        uint64_t squaredError = 0;
+        uint8_t* dstBlock = dstSlice;
+        for (uint32_t blockY = 0; blockY < blocksY; blockY++)
+        {
+            for (uint32_t blockX = 0; blockX < blocksX; blockX++, dstBlock += bytesPerBlock)
+            {
+                // Mips smaller than a block replicate their last row and column.
+                uint8_t srcPixels[PixelsPerBlock * BytesPerPixel];
+                bool isInside[PixelsPerBlock];
+                for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+                {
+                    const uint32_t x = blockX * BlockDimension + (pixel % BlockDimension);
+                    const uint32_t y = blockY * BlockDimension + (pixel / BlockDimension);
+                    isInside[pixel] = (x < width) && (y < height);
+                    const uint8_t* src = srcSlice + (static_cast<size_t>(AZStd::min(y, height - 1)) * width + AZStd::min(x, width - 1)) * BytesPerPixel;
+                    memcpy(srcPixels + pixel * BytesPerPixel, src, BytesPerPixel);
+                }
+
+                uint8_t decodedPixels[PixelsPerBlock * BytesPerPixel];
+                if (compression == CloudTextureCompression::BC7)
+                {
+                    CompressBlockBC7(srcPixels, dstBlock);
+                    DecompressBlockBC7(dstBlock, decodedPixels);
+                }
+                else
+                {
+                    // BC5 is two BC4 blocks, one after the other.
+                    for (uint32_t channel = 0; channel < channelCount; channel++)
+                    {
+                        uint8_t values[PixelsPerBlock];
+                        uint8_t decodedValues[PixelsPerBlock];
+                        for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+                        {
+                            values[pixel] = srcPixels[pixel * BytesPerPixel + firstChannel + channel];
+                        }
+                        CompressBlockBC4(values, dstBlock + channel * 8);
+                        DecompressBlockBC4(dstBlock + channel * 8, decodedValues);
+                        for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+                        {
+                            decodedPixels[pixel * BytesPerPixel + firstChannel + channel] = decodedValues[pixel];
+                        }
+                    }
+                }
+
+                for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+                {
+                    if (!isInside[pixel])
+                    {
+                        continue;
+                    }
+                    for (uint32_t channel = firstChannel; channel < firstChannel + channelCount; channel++)
+                    {
+                        const int32_t diff = static_cast<int32_t>(srcPixels[pixel * BytesPerPixel + channel]) -
+                            static_cast<int32_t>(decodedPixels[pixel * BytesPerPixel + channel]);
+                        squaredError += static_cast<uint64_t>(diff * diff);
+                    }
+                }
+            }
+        }
+        return squaredError;
+    }
+
+    void CloudTextureBlockCompressor::CompressBlockBC4(const uint8_t values[PixelsPerBlock], uint8_t block[8])
+    {
+        uint8_t minValue = 255;
+        uint8_t maxValue = 0;
+        // Range of the values that are not exactly 0 or 255, for the mode with 6 interpolated values.
+        uint8_t minInnerValue = 255;
+        uint8_t maxInnerValue = 0;
+        for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+        {
+            minValue = AZStd::min(minValue, values[pixel]);
+            maxValue = AZStd::max(maxValue, values[pixel]);
+            if ((values[pixel] != 0) && (values[pixel] != 255))
+            {
+                minInnerValue = AZStd::min(minInnerValue, values[pixel]);
+                maxInnerValue = AZStd::max(maxInnerValue, values[pixel]);
+            }
+        }
+        if (minInnerValue > maxInnerValue)
+        {
+            minInnerValue = maxInnerValue = 0;
+        }
+
+        uint8_t alpha0 = minInnerValue;
+        uint8_t alpha1 = maxInnerValue;
+        uint8_t indices[PixelsPerBlock];
+        uint32_t error = FindBC4Indices(values, alpha0, alpha1, indices);
+        if (maxValue > minValue)
+        {
+            uint8_t candidateIndices[PixelsPerBlock];
+            const uint32_t candidateError = FindBC4Indices(values, maxValue, minValue, candidateIndices);
+            if (candidateError < error)
+            {
+                alpha0 = maxValue;
+                alpha1 = minValue;
+                error = candidateError;
+                memcpy(indices, candidateIndices, sizeof(indices));
+            }
+        }
+
+        block[0] = alpha0;
+        block[1] = alpha1;
+        uint64_t packedIndices = 0;
+        for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+        {
+            packedIndices |= static_cast<uint64_t>(indices[pixel]) << (3 * pixel);
+        }
+        for (uint32_t byteIndex = 0; byteIndex < 6; byteIndex++)
+        {
+            block[2 + byteIndex] = static_cast<uint8_t>(packedIndices >> (8 * byteIndex));
+        }
+    }
+
+    void CloudTextureBlockCompressor::DecompressBlockBC4(const uint8_t block[8], uint8_t values[PixelsPerBlock])
+    {
+        uint8_t palette[8];
+        GetBC4Palette(block[0], block[1], palette);
+        uint64_t packedIndices = 0;
+        for (uint32_t byteIndex = 0; byteIndex < 6; byteIndex++)
+        {
+            packedIndices |= static_cast<uint64_t>(block[2 + byteIndex]) << (8 * byteIndex);
+        }
+        for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+        {
+            values[pixel] = palette[(packedIndices >> (3 * pixel)) & 7];
+        }
+    }
+
+    void CloudTextureBlockCompressor::CompressBlockBC7(const uint8_t rgba[PixelsPerBlock * BytesPerPixel], uint8_t block[16])
+    {
+        // Mode 6: a single line through the four channels.
+        constexpr uint32_t AllChannels[4] = { 0, 1, 2, 3 };
+        uint8_t mode6Endpoint0[4] = {};
+        uint8_t mode6Endpoint1[4] = {};
+        uint8_t mode6Indices[PixelsPerBlock];
+        const uint32_t mode6Error = FitBC7Endpoints(rgba, AllChannels, 4, BC7Weights4, 16, QuantizeMode6Endpoint,
+            mode6Endpoint0, mode6Endpoint1, mode6Indices);
+
+        // Mode 5: one line for three channels, and an independent line for the fourth channel,
+        // which is chosen with the rotation. The channels of the noise textures are weakly correlated,
+        // so this often beats mode 6, even with fewer index bits.
+        constexpr uint32_t ColorChannels[3] = { 0, 1, 2 };
+        constexpr uint32_t AlphaChannel[1] = { 3 };
+        uint32_t bestMode5Error = AZStd::numeric_limits<uint32_t>::max();
+        uint32_t bestRotation = 0;
+        uint8_t mode5Endpoints[4][4] = {}; // color0, color1, alpha0, alpha1
+        uint8_t mode5Indices[2][PixelsPerBlock] = {}; // color, alpha
+        for (uint32_t rotation = 0; rotation < 4; rotation++)
+        {
+            uint8_t rotated[PixelsPerBlock * BytesPerPixel];
+            memcpy(rotated, rgba, sizeof(rotated));
+            if (rotation > 0)
+            {
+                for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+                {
+                    AZStd::swap(rotated[pixel * 4 + rotation - 1], rotated[pixel * 4 + 3]);
+                }
+            }
+
+            uint8_t endpoints[4][4] = {};
+            uint8_t indices[2][PixelsPerBlock];
+            const uint32_t error =
+                FitBC7Endpoints(rotated, ColorChannels, 3, BC7Weights2, 4, QuantizeMode5ColorEndpoint, endpoints[0], endpoints[1], indices[0]) +
+                FitBC7Endpoints(rotated, AlphaChannel, 1, BC7Weights2, 4, QuantizeMode5AlphaEndpoint, endpoints[2], endpoints[3], indices[1]);
+            if (error < bestMode5Error)
+            {
+                bestMode5Error = error;
+                bestRotation = rotation;
+                memcpy(mode5Endpoints, endpoints, sizeof(endpoints));
+                memcpy(mode5Indices, indices, sizeof(indices));
+            }
+        }
+
+        memset(block, 0, 16);
+        BlockBitWriter writer(block);
+        if (mode6Error <= bestMode5Error)
+        {
+            FixBC7Anchor(mode6Endpoint0, mode6Endpoint1, mode6Indices, 4);
+            writer.Write(BC7Mode6Bit, 7);
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                writer.Write(mode6Endpoint0[channel] >> 1, 7);
+                writer.Write(mode6Endpoint1[channel] >> 1, 7);
+            }
+            writer.Write(mode6Endpoint0[0] & 1, 1);
+            writer.Write(mode6Endpoint1[0] & 1, 1);
+            writer.Write(mode6Indices[0], 3);
+            for (uint32_t pixel = 1; pixel < PixelsPerBlock; pixel++)
+            {
+                writer.Write(mode6Indices[pixel], 4);
+            }
+            return;
+        }
+
+        FixBC7Anchor(mode5Endpoints[0], mode5Endpoints[1], mode5Indices[0], 2);
+        FixBC7Anchor(mode5Endpoints[2], mode5Endpoints[3], mode5Indices[1], 2);
+        writer.Write(BC7Mode5Bit, 6);
+        writer.Write(bestRotation, 2);
+        for (uint32_t channel = 0; channel < 3; channel++)
+        {
+            writer.Write(mode5Endpoints[0][channel] >> 1, 7);
+            writer.Write(mode5Endpoints[1][channel] >> 1, 7);
+        }
+        writer.Write(mode5Endpoints[2][0], 8);
+        writer.Write(mode5Endpoints[3][0], 8);
+        for (uint32_t indexSet = 0; indexSet < 2; indexSet++)
+        {
+            writer.Write(mode5Indices[indexSet][0], 1);
+            for (uint32_t pixel = 1; pixel < PixelsPerBlock; pixel++)
+            {
+                writer.Write(mode5Indices[indexSet][pixel], 2);
+            }
+        }
+    }
+
+    bool CloudTextureBlockCompressor::DecompressBlockBC7(const uint8_t block[16], uint8_t rgba[PixelsPerBlock * BytesPerPixel])
+    {
+        BlockBitReader reader(block);
+        if ((block[0] & 0x7F) == BC7Mode6Bit)
+        {
+            reader.Read(7);
+            uint8_t endpoints[2][4];
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                endpoints[0][channel] = static_cast<uint8_t>(reader.Read(7) << 1);
+                endpoints[1][channel] = static_cast<uint8_t>(reader.Read(7) << 1);
+            }
+            const uint32_t pBit0 = reader.Read(1);
+            const uint32_t pBit1 = reader.Read(1);
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                endpoints[0][channel] |= pBit0;
+                endpoints[1][channel] |= pBit1;
+            }
+            for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+            {
+                const uint32_t index = reader.Read(pixel == 0 ? 3 : 4);
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    rgba[pixel * 4 + channel] = InterpolateBC7(endpoints[0][channel], endpoints[1][channel], BC7Weights4[index]);
+                }
+            }
+            return true;
+        }
+
+        if ((block[0] & 0x3F) == BC7Mode5Bit)
+        {
+            reader.Read(6);
+            const uint32_t rotation = reader.Read(2);
+            uint8_t endpoints[2][4];
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                for (uint32_t endpoint = 0; endpoint < 2; endpoint++)
+                {
+                    const uint32_t bits7 = reader.Read(7);
+                    endpoints[endpoint][channel] = static_cast<uint8_t>((bits7 << 1) | (bits7 >> 6));
+                }
+            }
+            endpoints[0][3] = static_cast<uint8_t>(reader.Read(8));
+            endpoints[1][3] = static_cast<uint8_t>(reader.Read(8));
+            uint32_t indices[2][PixelsPerBlock];
+            for (uint32_t indexSet = 0; indexSet < 2; indexSet++)
+            {
+                for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+                {
+                    indices[indexSet][pixel] = reader.Read(pixel == 0 ? 1 : 2);
+                }
+            }
+            for (uint32_t pixel = 0; pixel < PixelsPerBlock; pixel++)
+            {
+                uint8_t* color = rgba + pixel * 4;
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    const uint32_t index = indices[channel == 3 ? 1 : 0][pixel];
+                    color[channel] = InterpolateBC7(endpoints[0][channel], endpoints[1][channel], BC7Weights2[index]);
+                }
+                if (rotation > 0)
+                {
+                    AZStd::swap(color[rotation - 1], color[3]);
+                }
+            }
+            return true;
+        }
+
+        memset(rgba, 0, PixelsPerBlock * BytesPerPixel);
+        return false;
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,96 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+
+#include <Atom/RHI.Reflect/Format.h>
+
+#include <Renderer/CloudTextureMipData.h>
+
+namespace AZ
+{
+    class JobContext;
+}
+
+namespace VolumetricClouds
+{
+    // Block compression formats for the cloud noise textures written to disk.
+    enum class CloudTextureCompression : uint32_t
+    {
+        // RGBA8, 4 bytes per voxel.
+        None = 0,
+        // One channel, 0.5 bytes per voxel.
+        BC4 = 1,
+        // Two channels, 1 byte per voxel.
+        BC5 = 2,
+        // Four channels, 1 byte per voxel.
+        BC7 = 3,
+    };
+
+    // CPU block compressor for the RGBA8 mip chains of the cloud noise textures.
+    // Each Z slice of a mip level is compressed as an independent 2D image made of 4x4 blocks,
+    // which is how D3D and Vulkan lay out block compressed volume textures.
+    // BC4 and BC5 take their channels from the RGBA8 source starting at @firstChannel, so the
+    // channels of a texture can be split, e.g. the high frequency noise, whose only sampled channels
+    // are gba, can be saved as BC5 (gb) plus BC4 (a).
+    // BC7 only uses the single subset modes, which work well for smooth data like noise and are much faster
+    // to encode than a full mode search. Each block is encoded with both, and the one with the smallest
+    // squared error is written, mode 6 on ties:
+    // - Mode 6: one line through RGBA, 7777 endpoints with p-bits and 4 bits indices.
+    // - Mode 5: one line through three channels (7 bits endpoints, 2 bits indices) and an independent line for
+    //   the fourth one (8 bits endpoints, 2 bits indices). The fourth channel is picked with the rotation bits,
+    //   trying all four. It wins when one channel doesn't follow the others, which is common in the noise textures.
+    class CloudTextureBlockCompressor final
+    {
+    public:
+        static constexpr uint32_t BlockDimension = 4;
+        static constexpr uint32_t PixelsPerBlock = BlockDimension * BlockDimension;
+        static constexpr uint32_t BytesPerPixel = 4; // RGBA8 source.
+
+        struct CompressedMipLevel
+        {
+            AZStd::vector<uint8_t> m_data;
+            AZ::RHI::Size m_mipSize = {};
+            // Peak signal to noise ratio, in decibels, of the compressed channels against the source.
+            // Infinity if the compression was lossless.
+            double m_psnr = 0.0;
+        };
+
+        // Returns AZ::RHI::Format::Unknown for CloudTextureCompression::None.
+        static AZ::RHI::Format GetFormat(CloudTextureCompression compression);
+        static uint32_t GetChannelCount(CloudTextureCompression compression);
+        static uint32_t GetBytesPerBlock(CloudTextureCompression compression);
+        // Size of a compressed mip level. Each dimension of a slice is rounded up to whole blocks.
+        static size_t CalculateMipSizeInBytes(CloudTextureCompression compression, const AZ::RHI::Size& mipSize);
+
+        // Compresses all the mip levels. The slices of all mips are spread across jobs.
+        // @firstChannel First source channel for BC4 and BC5. Ignored for BC7.
+        // If @jobContext is null the global job context is used, and if there's no job
+        // system at all, everything is compressed in the calling thread.
+        // Returns an empty list if @compression is None or if @firstChannel is out of range.
+        static AZStd::vector<CompressedMipLevel> Compress(CloudTextureCompression compression, uint32_t firstChannel,
+            const AZStd::vector<CloudTextureMipData>& mipLevels, AZ::JobContext* jobContext = nullptr);
+
+        // Single block functions. @values has 16 values in row major order, and @rgba 16 RGBA8 pixels.
+        static void CompressBlockBC4(const uint8_t values[PixelsPerBlock], uint8_t block[8]);
+        static void DecompressBlockBC4(const uint8_t block[8], uint8_t values[PixelsPerBlock]);
+        static void CompressBlockBC7(const uint8_t rgba[PixelsPerBlock * BytesPerPixel], uint8_t block[16]);
+        // Decodes modes 5, with any rotation, and 6, the modes CompressBlockBC7() writes.
+        // Returns false, and black pixels, for any other mode.
+        static bool DecompressBlockBC7(const uint8_t block[16], uint8_t rgba[PixelsPerBlock * BytesPerPixel]);
+
+    private:
+        static constexpr char LogName[] = "CloudTextureBlockCompressor";
+
+        // Compresses one slice of a mip level, and returns the sum of the squared errors of the compressed channels.
+        static uint64_t CompressSlice(CloudTextureCompression compression, uint32_t firstChannel,
+            const uint8_t* srcSlice, uint32_t width, uint32_t height, uint8_t* dstSlice);
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,296 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Jobs/JobCompletion.h>
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/Jobs/JobFunction.h>
+#include <AzCore/Jobs/JobManager.h>
+#include <AzCore/Math/MathUtils.h>
+#include <AzCore/std/math.h>
+#include <AzCore/std/algorithm.h>
+
+#include <cstring>
+
+#include "CloudTextureMipReduction.h"
+#include "CloudTextureStatistics.h"
+#include "CloudTextureCpuBaker.h"
+
+namespace VolumetricClouds
+{
+    PerlinWorleyNoiseParameters CloudTextureCpuBaker::GetNoiseParameters(const CloudTextureComputeData& computeData)
+    {
+        PerlinWorleyNoiseParameters params;
+        params.m_frequency = AZStd::round(AZStd::clamp(computeData.m_frequency, 1.0f, 10.0f));
+        params.m_perlinOctaves = AZStd::clamp(computeData.m_perlinOctaves, 1, 10);
+        params.m_perlinGain = AZStd::clamp(computeData.m_perlinGain, 0.1f, 2.0f);
+        params.m_perlinAmplitude = AZStd::clamp(computeData.m_perlinAmplitude, 0.1f, 2.0f);
+        params.m_worleyOctaves = AZStd::clamp(computeData.m_worleyOctaves, 1, 10);
+        params.m_worleyGain = AZStd::clamp(computeData.m_worleyGain, 0.1f, 2.0f);
+        params.m_worleyAmplitude = AZStd::clamp(computeData.m_worleyAmplitude, 0.1f, 2.0f);
+        return params;
+    }
+
+    void CloudTextureCpuBaker::PackCloudChannels(const float cloudChannels[4], float packedChannels[2])
+    {
+        const float worleyFbm = cloudChannels[1] * 0.625f + cloudChannels[2] * 0.25f + cloudChannels[3] * 0.125f;
+        // Same as Remap(cloudChannels[0], worleyFbm - 1.0, 1.0, 0.0, 1.0)
+        packedChannels[0] = AZStd::clamp((cloudChannels[0] - (worleyFbm - 1.0f)) / (2.0f - worleyFbm), 0.0f, 1.0f);
+        packedChannels[1] = worleyFbm;
+    }
+
+    AZStd::vector<CloudTextureCpuBaker::MipLevelData> CloudTextureCpuBaker::Bake(const CloudTextureComputeData& computeData,
+        PerlinWorleyNoiseVariant variant, AZ::JobContext* jobContext, bool useWorleyFeaturePointTables)
+    {
+        const uint32_t pixelSize = computeData.m_pixelSize;
+        if ((pixelSize < CloudTextureFormat::MinPixelSize) || (pixelSize > CloudTextureFormat::MaxPixelSize)
+            || !AZ::IsPowerOfTwo(pixelSize))
+        {
+            AZ_Error(LogName, false, "Invalid pixel size %u. Expecting a power of two between %u and %u.",
+                pixelSize, CloudTextureFormat::MinPixelSize, CloudTextureFormat::MaxPixelSize);
+            return {};
+        }
+
+        const PerlinWorleyNoiseParameters params = GetNoiseParameters(computeData);
+        const AZ::RHI::Format pixelFormat = CloudTextureFormat::GetImageFormat(
+            static_cast<CloudTextureChannelLayout>(computeData.m_channelLayout));
+        const bool packChannels = (pixelFormat != AZ::RHI::Format::R8G8B8A8_UNORM);
+        const uint16_t mipCount = CloudTextureFormat::CalculateMipCount(pixelSize);
+
+        AZStd::vector<MipLevelData> mipLevels;
+        mipLevels.reserve(mipCount);
+        uint32_t mipPixelSize = pixelSize;
+        for (uint16_t mipIndex = 0; mipIndex < mipCount; mipIndex++)
+        {
+            MipLevelData& mipLevelData = mipLevels.emplace_back();
+            mipLevelData.m_mipSlice = mipIndex;
+            mipLevelData.m_mipSize = AZ::RHI::Size(mipPixelSize, mipPixelSize, mipPixelSize);
+            mipLevelData.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(
+                static_cast<size_t>(mipPixelSize) * mipPixelSize * mipPixelSize * BytesPerPixel);
+            mipPixelSize >>= 1;
+        }
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        // Mip 0 is the only level that evaluates the noise functions.
+        const uint32_t mip0Size = mipLevels[0].m_mipSize.m_width;
+        uint8_t* mip0Pixels = mipLevels[0].m_dataBuffer->data();
+        const size_t mip0SliceByteSize = static_cast<size_t>(mip0Size) * mip0Size * BytesPerPixel;
+        WorleyFeaturePointTables worleyTables;
+        if (useWorleyFeaturePointTables)
+        {
+            BuildWorleyFeaturePointTables(params, variant, mip0Size, worleyTables, jobContext);
+        }
+        ForEachSlab(jobContext, mip0Size, [&](uint32_t firstSlice, uint32_t sliceCount)
+            {
+                BakeSlices(params, variant, mip0Size, firstSlice, sliceCount, mip0Pixels + (mip0SliceByteSize * firstSlice),
+                    useWorleyFeaturePointTables ? &worleyTables : nullptr, packChannels);
+            });
+
+        // Each mip is downsampled from the previous one.
+        const auto mipFilter = static_cast<CloudTextureMipFilter>(computeData.m_mipFilter);
+        for (uint16_t mipIndex = 1; mipIndex < mipCount; mipIndex++)
+        {
+            const uint32_t srcSize = mipLevels[mipIndex - 1].m_mipSize.m_width;
+            const uint8_t* srcPixels = mipLevels[mipIndex - 1].m_dataBuffer->data();
+            const uint32_t dstSize = mipLevels[mipIndex].m_mipSize.m_width;
+            uint8_t* dstPixels = mipLevels[mipIndex].m_dataBuffer->data();
+            const size_t dstSliceByteSize = static_cast<size_t>(dstSize) * dstSize * BytesPerPixel;
+            ForEachSlab(jobContext, dstSize, [&](uint32_t firstSlice, uint32_t sliceCount)
+                {
+                    CloudTextureMipReduction::ReduceSlices(mipFilter, srcPixels, srcSize,
+                        firstSlice, sliceCount, dstPixels + (dstSliceByteSize * firstSlice));
+                });
+        }
+
+        // Same as CloudTextureMipReductionCS.azsl, the mips of the smaller layouts are reduced from the packed channels.
+        if (packChannels)
+        {
+            for (auto& mipLevelData : mipLevels)
+            {
+                ConvertPackedMipLevel(pixelFormat, mipLevelData, jobContext);
+            }
+        }
+
+        return mipLevels;
+    }
+
+    void CloudTextureCpuBaker::ConvertPackedMipLevel(AZ::RHI::Format pixelFormat, MipLevelData& mipData, AZ::JobContext* jobContext)
+    {
+        const uint32_t mipSize = mipData.m_mipSize.m_width;
+        const size_t pixelsPerSlice = static_cast<size_t>(mipSize) * mipSize;
+        const uint32_t dstBytesPerPixel = AZ::RHI::GetFormatSize(pixelFormat);
+        const uint8_t* srcPixels = mipData.m_dataBuffer->data();
+        auto dstBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(pixelsPerSlice * mipSize * dstBytesPerPixel);
+        uint8_t* dstPixels = dstBuffer->data();
+        ForEachSlab(jobContext, mipSize, [&](uint32_t firstSlice, uint32_t sliceCount)
+            {
+                const size_t firstPixel = pixelsPerSlice * firstSlice;
+                const size_t endPixel = firstPixel + (pixelsPerSlice * sliceCount);
+                for (size_t pixelIndex = firstPixel; pixelIndex < endPixel; pixelIndex++)
+                {
+                    const uint8_t* src = srcPixels + (pixelIndex * BytesPerPixel);
+                    uint8_t* dst = dstPixels + (pixelIndex * dstBytesPerPixel);
+                    switch (pixelFormat)
+                    {
+                    case AZ::RHI::Format::R8G8_UNORM:
+                        dst[0] = src[0];
+                        dst[1] = src[1];
+                        break;
+                    case AZ::RHI::Format::R16_FLOAT:
+                        {
+                            const uint16_t halfValue = CloudTextureStatistics::FloatToHalf(static_cast<float>(src[0]) / 255.0f);
+                            memcpy(dst, &halfValue, sizeof(uint16_t));
+                        }
+                        break;
+                    default:
+                        dst[0] = src[0];
+                        break;
+                    }
+                }
+            });
+        mipData.m_dataBuffer = AZStd::move(dstBuffer);
+    }
+
+    void CloudTextureCpuBaker::ForEachSlab(AZ::JobContext* jobContext, uint32_t sliceCount,
+        const AZStd::function<void(uint32_t firstSlice, uint32_t sliceCount)>& slabFunction)
+    {
+        if (!jobContext)
+        {
+            slabFunction(0, sliceCount);
+            return;
+        }
+
+        // Each slab of Z slices goes into its own job. Small volumes are split in fewer slabs
+        // but never less than one slice per slab.
+        const uint32_t workerCount = AZStd::max(jobContext->GetJobManager().GetNumWorkerThreads(), 1u);
+        const uint32_t slabDepth = AZStd::max(sliceCount / workerCount, 1u);
+        AZ::JobCompletion jobCompletion(jobContext);
+        for (uint32_t firstSlice = 0; firstSlice < sliceCount; firstSlice += slabDepth)
+        {
+            const uint32_t slabSliceCount = AZStd::min(slabDepth, sliceCount - firstSlice);
+            AZ::Job* job = AZ::CreateJobFunction([&slabFunction, firstSlice, slabSliceCount]()
+                {
+                    slabFunction(firstSlice, slabSliceCount);
+                }, true, jobContext);
+            job->SetDependent(&jobCompletion);
+            job->Start();
+        }
+        jobCompletion.StartAndWaitForCompletion();
+    }
+
+    void CloudTextureCpuBaker::BuildWorleyFeaturePointTables(const PerlinWorleyNoiseParameters& params, PerlinWorleyNoiseVariant variant,
+        uint32_t mipPixelSize, WorleyFeaturePointTables& worleyTables, AZ::JobContext* jobContext)
+    {
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        worleyTables.Initialize(WorleyFeaturePointTables::GetTablePeriods(params.m_frequency, params.m_worleyOctaves, mipPixelSize));
+        for (auto& table : worleyTables.GetTables())
+        {
+            ForEachSlab(jobContext, table.GetPaddedSize(), [&table, variant](uint32_t firstSlice, uint32_t sliceCount)
+                {
+                    // The table is filled with the same SIMD type BakeSlicesInternal() uses, so the feature points
+                    // are bit exact with the ones the hash per sample path calculates.
+                    if (variant == PerlinWorleyNoiseVariant::A)
+                    {
+                        PerlinWorleyNoiseKernels<AZ::Simd::Vec4, PerlinWorleyNoiseVariant::A>::FillWorleyFeaturePointTable(table, firstSlice, sliceCount);
+                    }
+                    else
+                    {
+                        PerlinWorleyNoiseKernels<AZ::Simd::Vec4, PerlinWorleyNoiseVariant::B>::FillWorleyFeaturePointTable(table, firstSlice, sliceCount);
+                    }
+                });
+        }
+    }
+
+    void CloudTextureCpuBaker::BakeSlices(const PerlinWorleyNoiseParameters& params, PerlinWorleyNoiseVariant variant,
+        uint32_t mipPixelSize, uint32_t firstSlice, uint32_t sliceCount, uint8_t* dstPixels,
+        const WorleyFeaturePointTables* worleyTables, bool packChannels)
+    {
+        if (variant == PerlinWorleyNoiseVariant::A)
+        {
+            BakeSlicesInternal<PerlinWorleyNoiseVariant::A>(params, mipPixelSize, firstSlice, sliceCount, dstPixels, worleyTables, packChannels);
+        }
+        else
+        {
+            BakeSlicesInternal<PerlinWorleyNoiseVariant::B>(params, mipPixelSize, firstSlice, sliceCount, dstPixels, worleyTables, packChannels);
+        }
+    }
+
+    template<PerlinWorleyNoiseVariant Variant>
+    void CloudTextureCpuBaker::BakeSlicesInternal(const PerlinWorleyNoiseParameters& params,
+        uint32_t mipPixelSize, uint32_t firstSlice, uint32_t sliceCount, uint8_t* dstPixels,
+        const WorleyFeaturePointTables* worleyTables, bool packChannels)
+    {
+        // Texture sizes are powers of two and at least CloudTextureFormat::MinPixelSize wide, so each
+        // row is always a multiple of the lane count.
+        using Vec = AZ::Simd::Vec4;
+        using Kernels = PerlinWorleyNoiseKernels<Vec, Variant>;
+        static constexpr uint32_t LaneCount = Kernels::LaneCount;
+        static_assert((CloudTextureFormat::MinPixelSize % LaneCount) == 0, "Rows must be a multiple of the SIMD lane count");
+
+        const float invPixelSize = 1.0f / static_cast<float>(mipPixelSize);
+        alignas(16) float laneCoords[LaneCount];
+        alignas(16) float channels[4][LaneCount];
+
+        uint8_t* dst = dstPixels;
+        for (uint32_t z = firstSlice; z < firstSlice + sliceCount; z++)
+        {
+            for (uint32_t y = 0; y < mipPixelSize; y++)
+            {
+                for (uint32_t x = 0; x < mipPixelSize; x += LaneCount)
+                {
+                    for (uint32_t lane = 0; lane < LaneCount; lane++)
+                    {
+                        laneCoords[lane] = static_cast<float>(x + lane) * invPixelSize;
+                    }
+
+                    // Same as CloudTexturePassSrg::GetNormalizedPointFromThreadIds().
+                    typename Kernels::Float3 input;
+                    input.m_x = Vec::LoadAligned(laneCoords);
+                    input.m_y = Vec::Splat(static_cast<float>(y) * invPixelSize);
+                    input.m_z = Vec::Splat(static_cast<float>(z) * invPixelSize);
+
+                    const typename Kernels::Float4 result = Kernels::CloudTextureChannels(input, params, worleyTables);
+                    Vec::StoreAligned(channels[0], result.m_r);
+                    Vec::StoreAligned(channels[1], result.m_g);
+                    Vec::StoreAligned(channels[2], result.m_b);
+                    Vec::StoreAligned(channels[3], result.m_a);
+                    if (packChannels)
+                    {
+                        for (uint32_t lane = 0; lane < LaneCount; lane++)
+                        {
+                            const float cloudChannels[4] = { channels[0][lane], channels[1][lane], channels[2][lane], channels[3][lane] };
+                            float packedChannels[2];
+                            PackCloudChannels(cloudChannels, packedChannels);
+                            channels[0][lane] = packedChannels[0];
+                            channels[1][lane] = packedChannels[1];
+                            channels[2][lane] = 0.0f;
+                            channels[3][lane] = 0.0f;
+                        }
+                    }
+
+                    // Same conversion the GPU does when writing to an R8G8B8A8_UNORM texture.
+                    for (uint32_t lane = 0; lane < LaneCount; lane++)
+                    {
+                        for (uint32_t channel = 0; channel < 4; channel++)
+                        {
+                            const float value = AZStd::clamp(channels[channel][lane], 0.0f, 1.0f);
+                            *dst++ = static_cast<uint8_t>(value * 255.0f + 0.5f);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,91 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/functional.h>
+
+#include <Renderer/CloudTextureMipData.h>
+#include <Renderer/Passes/CloudTextureComputeData.h>
+#include "PerlinWorleyNoiseKernels.h"
+#include "WorleyFeaturePointTable.h"
+
+namespace AZ
+{
+    class JobContext;
+}
+
+namespace VolumetricClouds
+{
+    // CPU implementation of CloudTextureCS.azsl followed by CloudTextureMipReductionCS.azsl.
+    // Generates the same RGBA8 mip chain that the GPU path delivers with
+    // CloudTexturesComputeFeatureProcessor::ReadbackEvent, so the results can be given
+    // as is to any of the ICloudTextureWriter(s).
+    // The pixel format of the mip chain is CloudTextureFormat::GetImageFormat(CloudTextureComputeData::m_channelLayout).
+    // The smaller layouts are packed with PackCloudChannels() and downsampled as 8 bit channels, so the R16F
+    // layout has the precision of R8.
+    // Voxels are evaluated with SIMD, four at a time along the X axis, and the volume is split in
+    // slabs of Z slices, where each slab is baked by a job from the AZ job system.
+    // Only mip 0 evaluates the noise, the other mips are downsampled from the previous mip level.
+    // The feature points of the low frequency Worley octaves are calculated once per bake, in
+    // WorleyFeaturePointTables, and shared by all the voxels, octaves and channels.
+    class CloudTextureCpuBaker final
+    {
+    public:
+        // Same type as CloudTextureComputePipeline::CloudTextureSubresourceReadback.
+        using MipLevelData = CloudTextureMipData;
+
+        static constexpr uint32_t BytesPerPixel = 4; // RGBA8, the other layouts are converted after the mips are reduced.
+
+        // Returns the same clamped values CloudTextureCS.azsl uses.
+        static PerlinWorleyNoiseParameters GetNoiseParameters(const CloudTextureComputeData& computeData);
+
+        // Same as PackCloudChannels() in CloudTextureCS.azsl. Combines the RGBA channels the same way the
+        // Cloudscape does for the RGBA8 layout. @packedChannels gets the base cloud shape and the combined Worley FBM.
+        static void PackCloudChannels(const float cloudChannels[4], float packedChannels[2]);
+
+        // Bakes the whole mip chain. Returns an empty list if @computeData has an invalid pixel size.
+        // If @jobContext is null the global job context is used, and if there's no job
+        // system at all, the volume is baked in the calling thread.
+        // @useWorleyFeaturePointTables Only false to measure, or test, the hash per sample path.
+        // Both paths produce the exact same texture.
+        static AZStd::vector<MipLevelData> Bake(const CloudTextureComputeData& computeData,
+            PerlinWorleyNoiseVariant variant = PerlinWorleyNoiseVariant::A, AZ::JobContext* jobContext = nullptr,
+            bool useWorleyFeaturePointTables = true);
+
+        // Creates and fills, in jobs, the Worley feature point tables worth having for a volume with size @mipPixelSize.
+        static void BuildWorleyFeaturePointTables(const PerlinWorleyNoiseParameters& params, PerlinWorleyNoiseVariant variant,
+            uint32_t mipPixelSize, WorleyFeaturePointTables& worleyTables, AZ::JobContext* jobContext = nullptr);
+
+        // Evaluates the noise for the slices [firstSlice, firstSlice + sliceCount) of a volume
+        // with size @mipPixelSize into @dstPixels, which must point to the first byte of @firstSlice.
+        // @worleyTables is optional, and must have been built with the same @params and @variant.
+        // @packChannels Stores the PackCloudChannels() result in rg, and zero in ba.
+        static void BakeSlices(const PerlinWorleyNoiseParameters& params, PerlinWorleyNoiseVariant variant,
+            uint32_t mipPixelSize, uint32_t firstSlice, uint32_t sliceCount, uint8_t* dstPixels,
+            const WorleyFeaturePointTables* worleyTables = nullptr, bool packChannels = false);
+
+        // Splits [0, sliceCount) in slabs and calls @slabFunction for each slab from a job.
+        // Returns after all slabs are done. If @jobContext is null, @slabFunction is called
+        // once, in the calling thread, for the whole range.
+        static void ForEachSlab(AZ::JobContext* jobContext, uint32_t sliceCount,
+            const AZStd::function<void(uint32_t firstSlice, uint32_t sliceCount)>& slabFunction);
+
+    private:
+        static constexpr char LogName[] = "CloudTextureCpuBaker";
+
+        template<PerlinWorleyNoiseVariant Variant>
+        static void BakeSlicesInternal(const PerlinWorleyNoiseParameters& params,
+            uint32_t mipPixelSize, uint32_t firstSlice, uint32_t sliceCount, uint8_t* dstPixels,
+            const WorleyFeaturePointTables* worleyTables, bool packChannels);
+
+        // Replaces the packed RGBA8 data of @mipData with the rg channels in @pixelFormat.
+        static void ConvertPackedMipLevel(AZ::RHI::Format pixelFormat, MipLevelData& mipData, AZ::JobContext* jobContext);
+    };
+
+} // namespace VolumetricClouds
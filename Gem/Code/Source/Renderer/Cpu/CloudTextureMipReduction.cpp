@@ -0,0 +1,109 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/std/algorithm.h>
+
+#include "CloudTextureMipReduction.h"
+
+namespace VolumetricClouds
+{
+    void CloudTextureMipReduction::ReduceSlices(CloudTextureMipFilter filter, const uint8_t* srcPixels, uint32_t srcPixelSize,
+        uint32_t firstDstSlice, uint32_t dstSliceCount, uint8_t* dstPixels)
+    {
+        if (filter == CloudTextureMipFilter::Kaiser)
+        {
+            KaiserReduceSlices(srcPixels, srcPixelSize, firstDstSlice, dstSliceCount, dstPixels);
+        }
+        else
+        {
+            BoxReduceSlices(srcPixels, srcPixelSize, firstDstSlice, dstSliceCount, dstPixels);
+        }
+    }
+
+    void CloudTextureMipReduction::BoxReduceSlices(const uint8_t* srcPixels, uint32_t srcPixelSize,
+        uint32_t firstDstSlice, uint32_t dstSliceCount, uint8_t* dstPixels)
+    {
+        const uint32_t dstPixelSize = srcPixelSize >> 1;
+        const size_t srcRowPitch = static_cast<size_t>(srcPixelSize) * BytesPerPixel;
+        const size_t srcSlicePitch = srcRowPitch * srcPixelSize;
+
+        uint8_t* dst = dstPixels;
+        for (uint32_t z = firstDstSlice; z < firstDstSlice + dstSliceCount; z++)
+        {
+            for (uint32_t y = 0; y < dstPixelSize; y++)
+            {
+                for (uint32_t x = 0; x < dstPixelSize; x++)
+                {
+                    uint32_t sums[BytesPerPixel] = { 0, 0, 0, 0 };
+                    for (uint32_t k = 0; k < 8; k++)
+                    {
+                        const uint32_t srcX = (x << 1) + (k & 1);
+                        const uint32_t srcY = (y << 1) + ((k >> 1) & 1);
+                        const uint32_t srcZ = (z << 1) + ((k >> 2) & 1);
+                        const uint8_t* src = srcPixels + (srcSlicePitch * srcZ) + (srcRowPitch * srcY) + (static_cast<size_t>(srcX) * BytesPerPixel);
+                        for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                        {
+                            sums[channel] += src[channel];
+                        }
+                    }
+                    // Rounded average.
+                    for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                    {
+                        *dst++ = static_cast<uint8_t>((sums[channel] + 4) >> 3);
+                    }
+                }
+            }
+        }
+    }
+
+    void CloudTextureMipReduction::KaiserReduceSlices(const uint8_t* srcPixels, uint32_t srcPixelSize,
+        uint32_t firstDstSlice, uint32_t dstSliceCount, uint8_t* dstPixels)
+    {
+        const uint32_t dstPixelSize = srcPixelSize >> 1;
+        const size_t srcRowPitch = static_cast<size_t>(srcPixelSize) * BytesPerPixel;
+        const size_t srcSlicePitch = srcRowPitch * srcPixelSize;
+        // srcPixelSize is always a power of two.
+        const uint32_t wrapMask = srcPixelSize - 1;
+
+        uint8_t* dst = dstPixels;
+        for (uint32_t z = firstDstSlice; z < firstDstSlice + dstSliceCount; z++)
+        {
+            for (uint32_t y = 0; y < dstPixelSize; y++)
+            {
+                for (uint32_t x = 0; x < dstPixelSize; x++)
+                {
+                    float sums[BytesPerPixel] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                    for (uint32_t tapZ = 0; tapZ < 4; tapZ++)
+                    {
+                        const uint32_t srcZ = ((z << 1) + tapZ - 1) & wrapMask;
+                        for (uint32_t tapY = 0; tapY < 4; tapY++)
+                        {
+                            const uint32_t srcY = ((y << 1) + tapY - 1) & wrapMask;
+                            const float weightYZ = KaiserWeights[tapZ] * KaiserWeights[tapY];
+                            const uint8_t* srcRow = srcPixels + (srcSlicePitch * srcZ) + (srcRowPitch * srcY);
+                            for (uint32_t tapX = 0; tapX < 4; tapX++)
+                            {
+                                const uint32_t srcX = ((x << 1) + tapX - 1) & wrapMask;
+                                const float weight = weightYZ * KaiserWeights[tapX];
+                                const uint8_t* src = srcRow + (static_cast<size_t>(srcX) * BytesPerPixel);
+                                for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                                {
+                                    sums[channel] += weight * static_cast<float>(src[channel]);
+                                }
+                            }
+                        }
+                    }
+                    for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                    {
+                        *dst++ = static_cast<uint8_t>(AZStd::clamp(sums[channel], 0.0f, 255.0f) + 0.5f);
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace VolumetricClouds
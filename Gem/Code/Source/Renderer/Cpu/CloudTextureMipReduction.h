@@ -0,0 +1,44 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/base.h>
+
+#include <Renderer/Passes/CloudTextureComputeData.h>
+
+namespace VolumetricClouds
+{
+    // CPU implementation of CloudTextureMipReductionCS.azsl.
+    // Downsamples an RGBA8 mip level of a cubic Texture3D into the next mip level.
+    // The noise textures are tileable, so the filter taps wrap around the edges.
+    class CloudTextureMipReduction final
+    {
+    public:
+        static constexpr uint32_t BytesPerPixel = 4; // RGBA8
+
+        // Weights of the separable Kaiser windowed sinc kernel (alpha = 4, radius = 2 source texels).
+        // The destination texel center sits between source texels 2*d and 2*d+1, so the taps
+        // are at source texels 2*d-1, 2*d, 2*d+1 and 2*d+2. The weights are already normalized.
+        // Must match the values in CloudTextureMipReductionCS.azsl.
+        static constexpr float KaiserWeights[4] = { 0.0540271f, 0.4459729f, 0.4459729f, 0.0540271f };
+
+        // Calculates the destination slices [firstDstSlice, firstDstSlice + dstSliceCount)
+        // of the mip level with size (@srcPixelSize / 2).
+        // @srcPixels points to the first byte of the whole source mip level.
+        // @dstPixels points to the first byte of @firstDstSlice.
+        static void ReduceSlices(CloudTextureMipFilter filter, const uint8_t* srcPixels, uint32_t srcPixelSize,
+            uint32_t firstDstSlice, uint32_t dstSliceCount, uint8_t* dstPixels);
+
+    private:
+        static void BoxReduceSlices(const uint8_t* srcPixels, uint32_t srcPixelSize,
+            uint32_t firstDstSlice, uint32_t dstSliceCount, uint8_t* dstPixels);
+        static void KaiserReduceSlices(const uint8_t* srcPixels, uint32_t srcPixelSize,
+            uint32_t firstDstSlice, uint32_t dstSliceCount, uint8_t* dstPixels);
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,384 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/parallel/lock.h>
+#include <AzCore/std/parallel/mutex.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+
+#include <cfloat>
+#include <cstring>
+
+#include "CloudTextureCpuBaker.h"
+#include "CloudTextureStatistics.h"
+
+namespace VolumetricClouds
+{
+    namespace
+    {
+        constexpr uint32_t BinCount = CloudTextureChannelStats::HistogramBinCount;
+        constexpr uint32_t MaxChannelCount = CloudTextureMipStats::MaxChannelCount;
+
+        // Partial stats of a slab of slices. With 8 bits per channel only the histogram is needed,
+        // the min, max and mean are calculated from it once all the slabs are merged.
+        struct StatsAccumulator
+        {
+            AZStd::array<AZStd::array<uint32_t, BinCount>, MaxChannelCount> m_histograms = {};
+            AZStd::array<float, MaxChannelCount> m_min = { FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX };
+            AZStd::array<float, MaxChannelCount> m_max = { -FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX };
+            AZStd::array<double, MaxChannelCount> m_sum = {};
+
+            void Merge(const StatsAccumulator& other, uint32_t channelCount)
+            {
+                for (uint32_t channel = 0; channel < channelCount; channel++)
+                {
+                    for (uint32_t bin = 0; bin < BinCount; bin++)
+                    {
+                        m_histograms[channel][bin] += other.m_histograms[channel][bin];
+                    }
+                    m_min[channel] = AZStd::min(m_min[channel], other.m_min[channel]);
+                    m_max[channel] = AZStd::max(m_max[channel], other.m_max[channel]);
+                    m_sum[channel] += other.m_sum[channel];
+                }
+            }
+        };
+
+        uint32_t GetHistogramBin(float value)
+        {
+            // Also maps NaN to the first bin.
+            const float scaledValue = AZStd::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f);
+            return (scaledValue >= 0.0f) ? static_cast<uint32_t>(scaledValue) : 0;
+        }
+    }
+
+    uint32_t CloudTextureStatistics::GetChannelCount(AZ::RHI::Format format)
+    {
+        switch (format)
+        {
+        case AZ::RHI::Format::R8G8B8A8_UNORM:
+            return 4;
+        case AZ::RHI::Format::R8G8_UNORM:
+            return 2;
+        case AZ::RHI::Format::R8_UNORM:
+        case AZ::RHI::Format::R16_FLOAT:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    bool CloudTextureStatistics::Calculate(AZ::RHI::Format format, const AZStd::vector<CloudTextureMipData>& mipLevels,
+        CloudTextureStats& stats, AZ::JobContext* jobContext)
+    {
+        const uint32_t channelCount = GetChannelCount(format);
+        if (channelCount == 0)
+        {
+            AZ_Error(LogName, false, "Format %s is not the format of any channel layout.", AZ::RHI::ToString(format));
+            return false;
+        }
+        const size_t bytesPerPixel = AZ::RHI::GetFormatSize(format);
+        for (const auto& mipData : mipLevels)
+        {
+            const auto& mipSize = mipData.m_mipSize;
+            const size_t expectedByteCount = static_cast<size_t>(mipSize.m_width) * mipSize.m_height * mipSize.m_depth * bytesPerPixel;
+            if (!mipData.m_dataBuffer || (mipData.m_dataBuffer->size() != expectedByteCount) || (expectedByteCount == 0))
+            {
+                AZ_Error(LogName, false, "Mip level %u has no data, or its size doesn't match its dimensions.", mipData.m_mipSlice);
+                return false;
+            }
+        }
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        stats = {};
+        stats.m_channelCount = channelCount;
+        stats.m_mipLevels.resize(mipLevels.size());
+        for (size_t mipIndex = 0; mipIndex < mipLevels.size(); mipIndex++)
+        {
+            CalculateMipStats(format, mipLevels[mipIndex], stats.m_mipLevels[mipIndex], jobContext);
+        }
+        return true;
+    }
+
+    void CloudTextureStatistics::CalculateMipStats(AZ::RHI::Format format, const CloudTextureMipData& mipData,
+        CloudTextureMipStats& mipStats, AZ::JobContext* jobContext)
+    {
+        const uint32_t channelCount = GetChannelCount(format);
+        const bool isHalfFloat = (format == AZ::RHI::Format::R16_FLOAT);
+        const auto& mipSize = mipData.m_mipSize;
+        const size_t pixelsPerSlice = static_cast<size_t>(mipSize.m_width) * mipSize.m_height;
+        const size_t sliceByteCount = pixelsPerSlice * AZ::RHI::GetFormatSize(format);
+        const uint8_t* mipPixels = mipData.m_dataBuffer->data();
+
+        StatsAccumulator total;
+        AZStd::mutex totalMutex;
+        CloudTextureCpuBaker::ForEachSlab(jobContext, mipSize.m_depth, [&](uint32_t firstSlice, uint32_t sliceCount)
+            {
+                StatsAccumulator slab;
+                const size_t pixelCount = pixelsPerSlice * sliceCount;
+                const uint8_t* slabPixels = mipPixels + (sliceByteCount * firstSlice);
+                if (isHalfFloat)
+                {
+                    for (size_t pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++)
+                    {
+                        uint16_t halfValue;
+                        memcpy(&halfValue, slabPixels + (pixelIndex * sizeof(uint16_t)), sizeof(uint16_t));
+                        const float value = HalfToFloat(halfValue);
+                        slab.m_histograms[0][GetHistogramBin(value)]++;
+                        slab.m_min[0] = AZStd::min(slab.m_min[0], value);
+                        slab.m_max[0] = AZStd::max(slab.m_max[0], value);
+                        slab.m_sum[0] += value;
+                    }
+                }
+                else
+                {
+                    // The channels are interleaved, so the histogram of each channel is updated in turn.
+                    const uint8_t* src = slabPixels;
+                    for (size_t pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++)
+                    {
+                        for (uint32_t channel = 0; channel < channelCount; channel++)
+                        {
+                            slab.m_histograms[channel][*src++]++;
+                        }
+                    }
+                }
+
+                AZStd::scoped_lock lock(totalMutex);
+                total.Merge(slab, channelCount);
+            });
+
+        mipStats.m_mipSlice = mipData.m_mipSlice;
+        const double pixelCount = static_cast<double>(pixelsPerSlice) * mipSize.m_depth;
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            CloudTextureChannelStats& channelStats = mipStats.m_channels[channel];
+            channelStats.m_histogram = total.m_histograms[channel];
+            if (isHalfFloat)
+            {
+                channelStats.m_min = total.m_min[channel];
+                channelStats.m_max = total.m_max[channel];
+                channelStats.m_mean = static_cast<float>(total.m_sum[channel] / pixelCount);
+                continue;
+            }
+
+            // Each bin is one code value.
+            uint32_t minCode = BinCount - 1;
+            uint32_t maxCode = 0;
+            uint64_t codeSum = 0;
+            for (uint32_t bin = 0; bin < BinCount; bin++)
+            {
+                const uint32_t binCount = channelStats.m_histogram[bin];
+                if (binCount > 0)
+                {
+                    minCode = AZStd::min(minCode, bin);
+                    maxCode = bin;
+                    codeSum += static_cast<uint64_t>(binCount) * bin;
+                }
+            }
+            channelStats.m_min = static_cast<float>(minCode) / 255.0f;
+            channelStats.m_max = static_cast<float>(maxCode) / 255.0f;
+            channelStats.m_mean = static_cast<float>(static_cast<double>(codeSum) / (pixelCount * 255.0));
+        }
+    }
+
+    bool CloudTextureStatistics::NormalizeChannelRange(AZ::RHI::Format format, const AZStd::vector<CloudTextureMipData>& mipLevels,
+        CloudTextureStats& stats, AZStd::vector<CloudTextureMipData>& normalizedMipLevels, AZ::JobContext* jobContext)
+    {
+        const uint32_t channelCount = GetChannelCount(format);
+        if ((channelCount == 0) || (stats.m_channelCount != channelCount) || (stats.m_mipLevels.size() != mipLevels.size()))
+        {
+            AZ_Error(LogName, false, "The stats don't belong to the mip chain, or format %s is not supported.", AZ::RHI::ToString(format));
+            return false;
+        }
+
+        // The range of each channel across the whole mip chain. Mips are filtered from mip 0,
+        // so in practice it is the range of mip 0.
+        AZStd::array<float, MaxChannelCount> rangeMin = { 0.0f, 0.0f, 0.0f, 0.0f };
+        AZStd::array<float, MaxChannelCount> rangeMax = { 1.0f, 1.0f, 1.0f, 1.0f };
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            float channelMin = FLT_MAX;
+            float channelMax = -FLT_MAX;
+            for (const auto& mipStats : stats.m_mipLevels)
+            {
+                channelMin = AZStd::min(channelMin, mipStats.m_channels[channel].m_min);
+                channelMax = AZStd::max(channelMax, mipStats.m_channels[channel].m_max);
+            }
+            if ((channelMax - channelMin) >= MinNormalizationRange)
+            {
+                rangeMin[channel] = channelMin;
+                rangeMax[channel] = channelMax;
+            }
+        }
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        // With 8 bits per channel the remap of each channel is a lookup table.
+        const bool isHalfFloat = (format == AZ::RHI::Format::R16_FLOAT);
+        AZStd::array<AZStd::array<uint8_t, 256>, MaxChannelCount> lookupTables;
+        for (uint32_t channel = 0; channel < channelCount; channel++)
+        {
+            const float scale = 1.0f / (rangeMax[channel] - rangeMin[channel]);
+            for (uint32_t code = 0; code < 256; code++)
+            {
+                const float value = AZStd::clamp((static_cast<float>(code) / 255.0f - rangeMin[channel]) * scale, 0.0f, 1.0f);
+                lookupTables[channel][code] = static_cast<uint8_t>(value * 255.0f + 0.5f);
+            }
+        }
+
+        normalizedMipLevels.clear();
+        normalizedMipLevels.reserve(mipLevels.size());
+        const size_t bytesPerPixel = AZ::RHI::GetFormatSize(format);
+        for (const auto& mipData : mipLevels)
+        {
+            CloudTextureMipData& normalizedMipData = normalizedMipLevels.emplace_back();
+            normalizedMipData.m_mipSlice = mipData.m_mipSlice;
+            normalizedMipData.m_mipSize = mipData.m_mipSize;
+            normalizedMipData.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>();
+            normalizedMipData.m_dataBuffer->resize_no_construct(mipData.m_dataBuffer->size());
+
+            const size_t pixelsPerSlice = static_cast<size_t>(mipData.m_mipSize.m_width) * mipData.m_mipSize.m_height;
+            const size_t sliceByteCount = pixelsPerSlice * bytesPerPixel;
+            const uint8_t* srcPixels = mipData.m_dataBuffer->data();
+            uint8_t* dstPixels = normalizedMipData.m_dataBuffer->data();
+            CloudTextureCpuBaker::ForEachSlab(jobContext, mipData.m_mipSize.m_depth, [&](uint32_t firstSlice, uint32_t sliceCount)
+                {
+                    const size_t offset = sliceByteCount * firstSlice;
+                    const size_t pixelCount = pixelsPerSlice * sliceCount;
+                    if (isHalfFloat && (rangeMin[0] == 0.0f) && (rangeMax[0] == 1.0f))
+                    {
+                        // Not worth a remap, and values out of [0, 1] are kept as is.
+                        memcpy(dstPixels + offset, srcPixels + offset, pixelCount * sizeof(uint16_t));
+                        return;
+                    }
+                    if (isHalfFloat)
+                    {
+                        const float scale = 1.0f / (rangeMax[0] - rangeMin[0]);
+                        for (size_t pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++)
+                        {
+                            const size_t byteOffset = offset + (pixelIndex * sizeof(uint16_t));
+                            uint16_t halfValue;
+                            memcpy(&halfValue, srcPixels + byteOffset, sizeof(uint16_t));
+                            const float value = AZStd::clamp((HalfToFloat(halfValue) - rangeMin[0]) * scale, 0.0f, 1.0f);
+                            halfValue = FloatToHalf(value);
+                            memcpy(dstPixels + byteOffset, &halfValue, sizeof(uint16_t));
+                        }
+                        return;
+                    }
+
+                    const uint8_t* src = srcPixels + offset;
+                    uint8_t* dst = dstPixels + offset;
+                    for (size_t pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++)
+                    {
+                        for (uint32_t channel = 0; channel < channelCount; channel++)
+                        {
+                            *dst++ = lookupTables[channel][*src++];
+                        }
+                    }
+                });
+        }
+
+        if (!Calculate(format, normalizedMipLevels, stats, jobContext))
+        {
+            return false;
+        }
+        stats.m_normalized = true;
+        stats.m_sourceRangeMin = rangeMin;
+        stats.m_sourceRangeMax = rangeMax;
+        return true;
+    }
+
+    float CloudTextureStatistics::HalfToFloat(uint16_t value)
+    {
+        const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+        uint32_t exponent = (value >> 10) & 0x1Fu;
+        uint32_t mantissa = value & 0x3FFu;
+        uint32_t bits = 0;
+        if (exponent == 0x1Fu)
+        {
+            // Infinity or NaN.
+            bits = sign | 0x7F800000u | (mantissa << 13);
+        }
+        else if (exponent != 0)
+        {
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        }
+        else if (mantissa != 0)
+        {
+            // Subnormal halfs are normal floats.
+            exponent = 127 - 15 + 1;
+            while ((mantissa & 0x400u) == 0)
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FFu) << 13);
+        }
+        else
+        {
+            bits = sign;
+        }
+        float result;
+        memcpy(&result, &bits, sizeof(float));
+        return result;
+    }
+
+    uint16_t CloudTextureStatistics::FloatToHalf(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(float));
+        const uint32_t sign = (bits >> 16) & 0x8000u;
+        bits &= 0x7FFFFFFFu;
+
+        if (bits >= 0x7F800000u)
+        {
+            // Infinity stays infinity, NaN stays a quiet NaN.
+            return static_cast<uint16_t>(sign | 0x7C00u | ((bits > 0x7F800000u) ? 0x200u : 0u));
+        }
+        if (bits >= 0x477FF000u)
+        {
+            // 65520 and above round to infinity.
+            return static_cast<uint16_t>(sign | 0x7C00u);
+        }
+        if (bits < 0x38800000u)
+        {
+            // Below the smallest normal half, 2^-14.
+            if (bits < 0x33000000u)
+            {
+                return static_cast<uint16_t>(sign);
+            }
+            const uint32_t exponent = bits >> 23;
+            const uint32_t mantissa = (bits & 0x7FFFFFu) | 0x800000u;
+            const uint32_t shift = 126 - exponent;
+            uint32_t result = mantissa >> shift;
+            const uint32_t remainder = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+            if ((remainder > halfway) || ((remainder == halfway) && (result & 1u)))
+            {
+                result++;
+            }
+            return static_cast<uint16_t>(sign | result);
+        }
+
+        // Rebias the exponent, and round the mantissa. A carry out of the mantissa correctly bumps the exponent.
+        uint32_t result = (bits - 0x38000000u) >> 13;
+        const uint32_t remainder = bits & 0x1FFFu;
+        if ((remainder > 0x1000u) || ((remainder == 0x1000u) && (result & 1u)))
+        {
+            result++;
+        }
+        return static_cast<uint16_t>(sign | result);
+    }
+
+} // namespace VolumetricClouds
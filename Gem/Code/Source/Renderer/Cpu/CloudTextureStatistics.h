@@ -0,0 +1,69 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+
+#include <Atom/RHI.Reflect/Format.h>
+
+#include <VolumetricClouds/CloudTextureStats.h>
+#include <Renderer/CloudTextureMipData.h>
+
+namespace AZ
+{
+    class JobContext;
+}
+
+namespace VolumetricClouds
+{
+    // Calculates the CloudTextureStats of a mip chain read back from the GPU, loaded from disk, or baked
+    // on the CPU, and optionally renormalizes each channel to the full [0, 1] range.
+    // The noise rarely uses the whole range of an 8 bits channel, e.g. the Worley FBMs may
+    // only use [0.3, 0.9], which wastes precision and forces the artists to compensate with
+    // the cloud coverage of the cloudscape.
+    // Supports the formats of all the CloudTextureChannelLayout(s).
+    // Each mip level is split in slabs of Z slices, and each slab is processed by a job
+    // from the AZ job system. The partial results of the slabs are merged at the end.
+    class CloudTextureStatistics final
+    {
+    public:
+        // Returns 0 if @format is not the format of any CloudTextureChannelLayout.
+        static uint32_t GetChannelCount(AZ::RHI::Format format);
+
+        // Calculates the stats of all the mip levels. @stats.m_normalized is false, and the source range is [0, 1].
+        // If @jobContext is null the global job context is used, and if there's no job
+        // system at all, the stats are calculated in the calling thread.
+        // Returns false if @format is not supported, or a mip level has no data.
+        static bool Calculate(AZ::RHI::Format format, const AZStd::vector<CloudTextureMipData>& mipLevels,
+            CloudTextureStats& stats, AZ::JobContext* jobContext = nullptr);
+
+        // Remaps each channel of all the mip levels from the range in @stats, which must have been
+        // calculated from @mipLevels, to [0, 1]. All the mip levels are remapped with the same range, the
+        // range of the whole mip chain, so they keep filtering into each other.
+        // Channels whose range is too small to be worth a remap, e.g. constant channels, are left as is.
+        // The result goes into new buffers in @normalizedMipLevels, because the buffers of @mipLevels
+        // may be shared with other readers, e.g. the job that writes the on-disk cache.
+        // On success, @stats is replaced by the stats of @normalizedMipLevels, with the source range of each channel.
+        static bool NormalizeChannelRange(AZ::RHI::Format format, const AZStd::vector<CloudTextureMipData>& mipLevels,
+            CloudTextureStats& stats, AZStd::vector<CloudTextureMipData>& normalizedMipLevels, AZ::JobContext* jobContext = nullptr);
+
+        // Channels whose range, max - min, is smaller than this are not remapped.
+        static constexpr float MinNormalizationRange = 1.0f / 255.0f;
+
+        // IEEE 754 half precision conversions, used by R16_FLOAT. The conversion to half rounds to nearest even.
+        static float HalfToFloat(uint16_t value);
+        static uint16_t FloatToHalf(float value);
+
+    private:
+        static constexpr char LogName[] = "CloudTextureStatistics";
+
+        static void CalculateMipStats(AZ::RHI::Format format, const CloudTextureMipData& mipData,
+            CloudTextureMipStats& mipStats, AZ::JobContext* jobContext);
+    };
+
+} // namespace VolumetricClouds
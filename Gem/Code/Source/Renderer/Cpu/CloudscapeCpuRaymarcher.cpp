@@ -0,0 +1,281 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/Math/MathUtils.h>
+#include <AzCore/Math/Vector4.h>
+#include <AzCore/std/algorithm.h>
+
+#include <cmath>
+
+#include <Renderer/CloudscapeShaderConstantData.h>
+#include "CloudTextureCpuBaker.h"
+#include "CloudscapeCpuRaymarcher.h"
+
+namespace VolumetricClouds
+{
+    CloudscapeRaymarchConstants CloudscapeCpuRaymarcher::GetConstants(const CloudscapeShaderConstantData& shaderConstantData,
+        uint32_t lowFrequencyNoiseMipCount, float timeSeconds)
+    {
+        CloudscapeRaymarchConstants constants;
+        constants.m_uvwScale = shaderConstantData.m_uvwScale;
+        constants.m_maxMipLevels = AZStd::max(1u, AZStd::min(lowFrequencyNoiseMipCount, shaderConstantData.m_maxMipLevels));
+        constants.m_minRayMarchingSteps = AZStd::min<uint32_t>(shaderConstantData.m_minRayMarchingSteps, shaderConstantData.m_maxRayMarchingSteps);
+        constants.m_maxRayMarchingSteps = AZStd::max<uint32_t>(shaderConstantData.m_minRayMarchingSteps, shaderConstantData.m_maxRayMarchingSteps);
+
+        const auto qualitySettings = CloudscapeQualitySettings::Get(static_cast<CloudscapeQualityTier>(shaderConstantData.m_qualityTier));
+        constants.m_lightSampleCount = qualitySettings.m_lightSampleCount;
+        constants.m_maxOctaves = qualitySettings.m_maxOctaves;
+        constants.m_largeStepIncrement = static_cast<int>(qualitySettings.m_largeStepIncrement);
+        constants.m_dualLobePhaseFunctionWeight = static_cast<float>(qualitySettings.m_dualLobeWeightQuarters) * 0.25f;
+        constants.m_highFrequencyDetail = qualitySettings.m_highFrequencyDetail;
+
+        constants.m_planetRadiusKm = shaderConstantData.m_planetRadiusKm;
+        constants.m_cloudSlabDistanceAboveSeaLevelKm = shaderConstantData.m_cloudSlabDistanceAboveSeaLevelKm;
+        constants.m_cloudSlabThicknessKm = shaderConstantData.m_cloudSlabThicknessKm;
+
+        shaderConstantData.m_sunColor.StoreToFloat3(constants.m_sunColorAndIntensity);
+        constants.m_sunColorAndIntensity[3] = shaderConstantData.m_sunLightIntensity;
+        constants.m_ambientLightColorAndIntensity[0] = shaderConstantData.m_ambientLightColor.GetR();
+        constants.m_ambientLightColorAndIntensity[1] = shaderConstantData.m_ambientLightColor.GetG();
+        constants.m_ambientLightColorAndIntensity[2] = shaderConstantData.m_ambientLightColor.GetB();
+        constants.m_ambientLightColorAndIntensity[3] = shaderConstantData.m_ambientLightIntensity;
+        shaderConstantData.m_directionTowardsTheSun.StoreToFloat3(constants.m_directionTowardsTheSun);
+
+        const auto& materialProperties = shaderConstantData.m_cloudMaterialProperties;
+        constants.m_aCoef = materialProperties.m_absorptionCoefficient * 1000.0f;
+        constants.m_sCoef = materialProperties.m_scatteringCoefficient * 1000.0f;
+        constants.m_henyeyGreensteinG = materialProperties.m_henyeyGreensteinG;
+        constants.m_multipleScatteringABC[0] = materialProperties.m_multiScatteringA;
+        constants.m_multipleScatteringABC[1] = materialProperties.m_multiScatteringB;
+        constants.m_multipleScatteringABC[2] = materialProperties.m_multiScatteringC;
+
+        constants.m_weatherMapSizeKm = shaderConstantData.m_weatherMapSizeKm;
+        constants.m_globalCloudCoverage = shaderConstantData.m_globalCloudCoverage;
+        constants.m_globalCloudDensity = shaderConstantData.m_globalCloudDensity;
+        constants.m_windSpeedKmPerSec = shaderConstantData.m_windSpeedKmPerSec;
+        AZ::Vector3 windDirection = shaderConstantData.m_windDirection;
+        const float windDirectionLength = windDirection.GetLength();
+        windDirection = AZ::IsClose(windDirectionLength, 0.0f, 0.01f)
+            ? AZ::Vector3::CreateZero()
+            : (windDirection / windDirectionLength);
+        windDirection.StoreToFloat3(constants.m_windDirection);
+        constants.m_cloudTopOffsetKm = shaderConstantData.m_cloudTopOffsetKm;
+
+        constants.m_timeSeconds = timeSeconds;
+        return constants;
+    }
+
+    float CloudscapeCpuRaymarcher::RaySphereClosestHit(const AZ::Vector3& sphereCenter, float sphereRadius,
+        const AZ::Vector3& rayStart, const AZ::Vector3& rayDirection)
+    {
+        const AZ::Vector3 sphereToRayStart = rayStart - sphereCenter;
+        const float a = rayDirection.Dot(rayDirection);
+        const float b = 2.0f * rayDirection.Dot(sphereToRayStart);
+        const float c = sphereToRayStart.Dot(sphereToRayStart) - (sphereRadius * sphereRadius);
+        const float discriminant = b * b - 4.0f * a * c;
+        if (discriminant < 0.0f)
+        {
+            return -1.0f;
+        }
+        const float sqrtDiscriminant = std::sqrt(discriminant);
+        const float closestNumerator = -b - sqrtDiscriminant;
+        if (closestNumerator > 0.0f)
+        {
+            return closestNumerator / (2.0f * a);
+        }
+        const float farthestNumerator = -b + sqrtDiscriminant;
+        if (farthestNumerator > 0.0f)
+        {
+            return farthestNumerator / (2.0f * a);
+        }
+        return -1.0f;
+    }
+
+    bool CloudscapeCpuRaymarcher::GetCloudSlabIntersections(const CloudscapeRaymarchConstants& constants, const View& view,
+        float pixelU, float pixelV, AtmosphereIntersectionInfo& intersectionInfo)
+    {
+        // Same as WorldPositionFromDepthBuffer(). With reverse depth, 1.0 is the near plane, any depth gives the same view ray.
+        const AZ::Vector4 clipPosition((pixelU * 2.0f) - 1.0f, ((1.0f - pixelV) * 2.0f) - 1.0f, 1.0f, 1.0f);
+        const AZ::Vector4 homogeneousPosition = view.m_viewProjectionInverse * clipPosition;
+        const AZ::Vector3 pixelPosWS = homogeneousPosition.GetAsVector3() / homogeneousPosition.GetW();
+        const AZ::Vector3 pixelViewVec = pixelPosWS - view.m_worldPosition;
+        const float distanceToPixel = pixelViewVec.GetLength();
+        if (distanceToPixel <= 0.0f)
+        {
+            return false;
+        }
+        const AZ::Vector3 rayDirection = pixelViewVec / distanceToPixel;
+
+        AZ::Vector3 cameraPositionKm = view.m_worldPosition * 0.001f;
+        cameraPositionKm.SetZ(cameraPositionKm.GetZ() + constants.m_planetRadiusKm); // An approximation.
+
+        const float atmosphereInnerRadiusKm = constants.m_planetRadiusKm + constants.m_cloudSlabDistanceAboveSeaLevelKm;
+        const AZ::Vector3 earthCenter = AZ::Vector3::CreateZero();
+        const float distanceToInnerSphereKm = RaySphereClosestHit(earthCenter, atmosphereInnerRadiusKm, cameraPositionKm, rayDirection);
+        if (distanceToInnerSphereKm < 0.0f)
+        {
+            return false;
+        }
+        const float distanceToOuterSphereKm = RaySphereClosestHit(earthCenter, atmosphereInnerRadiusKm + constants.m_cloudSlabThicknessKm,
+            cameraPositionKm, rayDirection);
+
+        const AZ::Vector3 rayMarchStartPosKm = cameraPositionKm + distanceToInnerSphereKm * rayDirection;
+        if (rayMarchStartPosKm.GetZ() < constants.m_planetRadiusKm)
+        {
+            // A simplification of going below water level.
+            return false;
+        }
+
+        intersectionInfo.m_rayMarchStartPosKm = rayMarchStartPosKm;
+        intersectionInfo.m_rayMarchDistanceKm = distanceToOuterSphereKm - distanceToInnerSphereKm;
+        intersectionInfo.m_rayDirection = rayDirection;
+        intersectionInfo.m_distanceFromCameraToInnerSphereKm = distanceToInnerSphereKm;
+        return true;
+    }
+
+    bool CloudscapeCpuRaymarcher::Render(const CloudscapeShaderConstantData& shaderConstantData, const Textures& textures, const View& view,
+        float timeSeconds, uint32_t width, uint32_t height, Image& image, AZ::JobContext* jobContext, bool useSimd)
+    {
+        image.m_width = 0;
+        image.m_height = 0;
+        image.m_pixels.clear();
+
+        CloudscapeRaymarchTextures samplers;
+        if (!samplers.m_lowFreqNoise.Initialize(textures.m_lowFrequencyNoise, textures.m_lowFrequencyNoiseFormat))
+        {
+            AZ_Error(LogName, false, "Invalid low frequency noise texture.");
+            return false;
+        }
+        if (!samplers.m_highFreqNoise.Initialize(textures.m_highFrequencyNoise, textures.m_highFrequencyNoiseFormat))
+        {
+            AZ_Error(LogName, false, "Invalid high frequency noise texture.");
+            return false;
+        }
+        // Same as CloudscapeComputePass::AreNoiseTexturesSupported().
+        if (!CloudTextureFormat::HasDetailNoise(samplers.m_highFreqNoise.GetChannelLayout()))
+        {
+            AZ_Error(LogName, false, "The high frequency noise texture has no detail noise, use the RGBA8 or RG8 layout.");
+            return false;
+        }
+        if (!samplers.m_weatherMap.Initialize(textures.m_weatherMapPixels, textures.m_weatherMapWidth, textures.m_weatherMapHeight))
+        {
+            AZ_Error(LogName, false, "Invalid weather map.");
+            return false;
+        }
+
+        image.m_width = width;
+        image.m_height = height;
+        image.m_pixels.resize(static_cast<size_t>(width) * height * 4, 0.0f);
+        if ((width == 0) || (height == 0))
+        {
+            return true;
+        }
+
+        const CloudscapeRaymarchConstants constants = GetConstants(shaderConstantData, samplers.m_lowFreqNoise.GetMipCount(), timeSeconds);
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        // Same as the CloudscapeOpticalDepthComputePass, which runs before the cloudscape is ray marched.
+        CloudscapeOpticalDepthVolume opticalDepthVolume;
+        if (shaderConstantData.m_useOpticalDepthVolume)
+        {
+            float originXKm, originYKm;
+            CloudscapeOpticalDepthVolume::GetOriginKm(view.m_worldPosition.GetX(), view.m_worldPosition.GetY(),
+                shaderConstantData.m_opticalDepthVolumeSizeKm, originXKm, originYKm);
+            opticalDepthVolume.Build(constants, samplers, originXKm, originYKm, shaderConstantData.m_opticalDepthVolumeSizeKm, jobContext);
+            samplers.m_opticalDepthVolume = &opticalDepthVolume;
+        }
+
+        const uint32_t tileCountX = (width + TileSize - 1) / TileSize;
+        const uint32_t tileCountY = (height + TileSize - 1) / TileSize;
+        CloudTextureCpuBaker::ForEachSlab(jobContext, tileCountX * tileCountY, [&](uint32_t firstTile, uint32_t tileCount)
+            {
+                for (uint32_t tileIndex = firstTile; tileIndex < firstTile + tileCount; tileIndex++)
+                {
+                    const uint32_t tileX = tileIndex % tileCountX;
+                    const uint32_t tileY = tileIndex / tileCountX;
+                    if (useSimd)
+                    {
+                        RenderTile<AZ::Simd::Vec4>(constants, samplers, view, tileX, tileY, image);
+                    }
+                    else
+                    {
+                        RenderTile<AZ::Simd::Vec1>(constants, samplers, view, tileX, tileY, image);
+                    }
+                }
+            });
+        return true;
+    }
+
+    template<typename VecType>
+    void CloudscapeCpuRaymarcher::RenderTile(const CloudscapeRaymarchConstants& constants, const CloudscapeRaymarchTextures& textures,
+        const View& view, uint32_t tileX, uint32_t tileY, Image& image)
+    {
+        using Kernels = CloudscapeRaymarchKernels<VecType>;
+        static constexpr uint32_t LaneCount = Kernels::LaneCount;
+        static_assert((TileSize % LaneCount) == 0, "Tile rows must be a multiple of the SIMD lane count");
+
+        const uint32_t firstX = tileX * TileSize;
+        const uint32_t firstY = tileY * TileSize;
+        const uint32_t lastX = AZStd::min(firstX + TileSize, image.m_width);
+        const uint32_t lastY = AZStd::min(firstY + TileSize, image.m_height);
+        const float invWidth = 1.0f / static_cast<float>(image.m_width);
+        const float invHeight = 1.0f / static_cast<float>(image.m_height);
+
+        typename Kernels::RayPacket rays;
+        typename Kernels::ColorPacket colors;
+        for (uint32_t y = firstY; y < lastY; y++)
+        {
+            for (uint32_t x = firstX; x < lastX; x += LaneCount)
+            {
+                bool anyRay = false;
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    const uint32_t pixelX = x + lane;
+                    rays.m_pixelLocation[0][lane] = static_cast<float>(pixelX);
+                    rays.m_pixelLocation[1][lane] = static_cast<float>(y);
+                    // Same as MainCS(), the uv of the pixel corner.
+                    AtmosphereIntersectionInfo intersectionInfo;
+                    rays.m_hasRay[lane] = (pixelX < lastX)
+                        && GetCloudSlabIntersections(constants, view, pixelX * invWidth, y * invHeight, intersectionInfo);
+                    if (!rays.m_hasRay[lane])
+                    {
+                        continue;
+                    }
+                    anyRay = true;
+                    for (uint32_t axis = 0; axis < 3; axis++)
+                    {
+                        rays.m_rayMarchStartPosKm[axis][lane] = intersectionInfo.m_rayMarchStartPosKm.GetElement(axis);
+                        rays.m_rayDirection[axis][lane] = intersectionInfo.m_rayDirection.GetElement(axis);
+                    }
+                    rays.m_rayMarchDistanceKm[lane] = intersectionInfo.m_rayMarchDistanceKm;
+                    rays.m_distanceFromCameraToInnerSphereKm[lane] = intersectionInfo.m_distanceFromCameraToInnerSphereKm;
+                }
+                if (!anyRay)
+                {
+                    // The image was cleared to zero, same as the shader output when there's no intersection.
+                    continue;
+                }
+
+                Kernels::GetCloudColor(constants, textures, rays, colors);
+                for (uint32_t lane = 0; (lane < LaneCount) && (x + lane < lastX); lane++)
+                {
+                    float* pixel = image.m_pixels.data() + (static_cast<size_t>(y) * image.m_width + x + lane) * 4;
+                    for (uint32_t channel = 0; channel < 4; channel++)
+                    {
+                        pixel[channel] = colors.m_rgba[channel][lane];
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace VolumetricClouds
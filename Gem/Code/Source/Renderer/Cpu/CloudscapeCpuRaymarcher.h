@@ -0,0 +1,113 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/Math/Matrix4x4.h>
+#include <AzCore/Math/Vector3.h>
+#include <AzCore/std/containers/vector.h>
+
+#include <Atom/RHI.Reflect/Format.h>
+
+#include <Renderer/CloudTextureMipData.h>
+#include "CloudscapeRaymarchKernels.h"
+
+namespace AZ
+{
+    class JobContext;
+}
+
+namespace VolumetricClouds
+{
+    struct CloudscapeShaderConstantData;
+
+    // CPU implementation of CloudscapeCS.azsl. Renders the same premultiplied cloud color and alpha
+    // the compute shader writes into the cloudscape output, for every pixel of the image at once
+    // instead of one pixel of each 4x4 block per frame.
+    // Useful as the golden reference of the shader, and to render skyboxes offline.
+    // Rays are ray marched with SIMD, four at a time along a row, see CloudscapeRaymarchKernels,
+    // and the image is split in tiles where each tile is rendered by a job from the AZ job system.
+    class CloudscapeCpuRaymarcher final
+    {
+    public:
+        static constexpr uint32_t TileSize = 16;
+
+        struct View
+        {
+            // In meters.
+            AZ::Vector3 m_worldPosition = AZ::Vector3::CreateZero();
+            // Same as ViewSrg::m_viewProjectionInverseMatrix.
+            AZ::Matrix4x4 m_viewProjectionInverse = AZ::Matrix4x4::CreateIdentity();
+        };
+
+        // CPU copies of the textures given to CloudscapeCS.azsl. The data is not owned,
+        // and must outlive the call to Render().
+        struct Textures
+        {
+            // Mip chains as read back with CloudTexturesComputeFeatureProcessor::ReadbackEvent,
+            // loaded with CloudVolumeFile, or baked with CloudTextureCpuBaker.
+            const AZStd::vector<CloudTextureMipData>* m_lowFrequencyNoise = nullptr;
+            AZ::RHI::Format m_lowFrequencyNoiseFormat = AZ::RHI::Format::R8G8B8A8_UNORM;
+            const AZStd::vector<CloudTextureMipData>* m_highFrequencyNoise = nullptr;
+            AZ::RHI::Format m_highFrequencyNoiseFormat = AZ::RHI::Format::R8G8B8A8_UNORM;
+            // RGBA8, linear, mip 0 only.
+            const uint8_t* m_weatherMapPixels = nullptr;
+            uint32_t m_weatherMapWidth = 0;
+            uint32_t m_weatherMapHeight = 0;
+        };
+
+        // RGBA float pixels, row by row, with the same content as the cloudscape output of CloudscapeCS.azsl.
+        struct Image
+        {
+            uint32_t m_width = 0;
+            uint32_t m_height = 0;
+            AZStd::vector<float> m_pixels;
+        };
+
+        // Same as the struct with the same name in CloudscapeCS.azsl.
+        struct AtmosphereIntersectionInfo
+        {
+            AZ::Vector3 m_rayMarchStartPosKm = AZ::Vector3::CreateZero();
+            float m_rayMarchDistanceKm = 0.0f;
+            AZ::Vector3 m_rayDirection = AZ::Vector3::CreateAxisZ();
+            float m_distanceFromCameraToInnerSphereKm = 0.0f;
+        };
+
+        // Returns the PassSrg constants that CloudscapeComputePass::CompileResources() sets from @shaderConstantData.
+        // @lowFrequencyNoiseMipCount is used to clamp CloudscapeShaderConstantData::m_maxMipLevels.
+        // @timeSeconds is the value of SceneSrg::m_time.
+        static CloudscapeRaymarchConstants GetConstants(const CloudscapeShaderConstantData& shaderConstantData,
+            uint32_t lowFrequencyNoiseMipCount, float timeSeconds);
+
+        // Same as RaySphereClosestHitWS(). Returns -1 if the ray doesn't hit the sphere.
+        static float RaySphereClosestHit(const AZ::Vector3& sphereCenter, float sphereRadius,
+            const AZ::Vector3& rayStart, const AZ::Vector3& rayDirection);
+
+        // Same as GetCloudSlabIntersections(), without the depth buffer, as if all the pixels were sky.
+        // Returns false if the view ray of @pixelUV doesn't reach the cloud slab.
+        static bool GetCloudSlabIntersections(const CloudscapeRaymarchConstants& constants, const View& view,
+            float pixelU, float pixelV, AtmosphereIntersectionInfo& intersectionInfo);
+
+        // Renders the cloudscape of @view into @image, which is resized to @width x @height.
+        // When CloudscapeShaderConstantData::m_useOpticalDepthVolume is true, the optical depth volume
+        // around the camera is built first, see CloudscapeOpticalDepthVolume.
+        // If @jobContext is null the global job context is used, and if there's no job
+        // system at all, the image is rendered in the calling thread.
+        // @useSimd Only false to measure, or test, the scalar path. Both paths produce the same image.
+        // Returns false if any of the textures is missing or has an unsupported format.
+        static bool Render(const CloudscapeShaderConstantData& shaderConstantData, const Textures& textures, const View& view,
+            float timeSeconds, uint32_t width, uint32_t height, Image& image, AZ::JobContext* jobContext = nullptr, bool useSimd = true);
+
+    private:
+        static constexpr char LogName[] = "CloudscapeCpuRaymarcher";
+
+        template<typename VecType>
+        static void RenderTile(const CloudscapeRaymarchConstants& constants, const CloudscapeRaymarchTextures& textures,
+            const View& view, uint32_t tileX, uint32_t tileY, Image& image);
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,164 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/std/algorithm.h>
+
+#include <cmath>
+#include <cstring>
+
+#include <Renderer/Passes/CloudTextureComputePass.h>
+#include "CloudTextureStatistics.h"
+#include "CloudscapeCpuTextures.h"
+
+namespace VolumetricClouds
+{
+    namespace
+    {
+        // Same as the texel addressing of a linear filter: returns the two texels around @coord,
+        // already wrapped around, and the weight of the second one.
+        void GetLinearTexels(float coord, uint32_t size, uint32_t& texel0, uint32_t& texel1, float& weight1)
+        {
+            const float texelCoord = coord * static_cast<float>(size) - 0.5f;
+            const float floorCoord = std::floor(texelCoord);
+            weight1 = texelCoord - floorCoord;
+            const int64_t signedSize = static_cast<int64_t>(size);
+            const int64_t wrapped = ((static_cast<int64_t>(floorCoord) % signedSize) + signedSize) % signedSize;
+            texel0 = static_cast<uint32_t>(wrapped);
+            texel1 = (texel0 + 1 == size) ? 0 : texel0 + 1;
+        }
+    }
+
+    bool CloudNoiseTextureSampler::Initialize(const AZStd::vector<CloudTextureMipData>* mipLevels, AZ::RHI::Format format)
+    {
+        m_mipLevels = nullptr;
+        if (!mipLevels || mipLevels->empty() || !CloudTextureComputePass::GetChannelLayout(format, m_channelLayout))
+        {
+            return false;
+        }
+        m_channelCount = CloudTextureStatistics::GetChannelCount(format);
+        m_bytesPerPixel = AZ::RHI::GetFormatSize(format);
+        for (const auto& mipData : *mipLevels)
+        {
+            const auto& mipSize = mipData.m_mipSize;
+            const size_t expectedSize = static_cast<size_t>(mipSize.m_width) * mipSize.m_height * mipSize.m_depth * m_bytesPerPixel;
+            if (!mipData.m_dataBuffer || (expectedSize == 0) || (mipData.m_dataBuffer->size() != expectedSize))
+            {
+                return false;
+            }
+        }
+        m_mipLevels = mipLevels;
+        return true;
+    }
+
+    uint32_t CloudNoiseTextureSampler::GetMipCount() const
+    {
+        return m_mipLevels ? static_cast<uint32_t>(m_mipLevels->size()) : 0;
+    }
+
+    uint32_t CloudNoiseTextureSampler::GetSize() const
+    {
+        return m_mipLevels ? (*m_mipLevels)[0].m_mipSize.m_width : 0;
+    }
+
+    void CloudNoiseTextureSampler::SampleLevel(float u, float v, float w, float mipLevel, float rgba[4]) const
+    {
+        // Same as a sampler with MipFilter = Linear, the mip level is clamped to the mip chain.
+        const float maxMipLevel = static_cast<float>(GetMipCount() - 1);
+        const float clampedMipLevel = AZStd::clamp(mipLevel, 0.0f, maxMipLevel);
+        const uint32_t mip0 = static_cast<uint32_t>(clampedMipLevel);
+        const float mipWeight = clampedMipLevel - static_cast<float>(mip0);
+        SampleMip(mip0, u, v, w, rgba);
+        if (mipWeight > 0.0f)
+        {
+            float rgba1[4];
+            SampleMip(mip0 + 1, u, v, w, rgba1);
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                rgba[channel] += (rgba1[channel] - rgba[channel]) * mipWeight;
+            }
+        }
+    }
+
+    void CloudNoiseTextureSampler::SampleMip(uint32_t mipIndex, float u, float v, float w, float rgba[4]) const
+    {
+        const CloudTextureMipData& mipData = (*m_mipLevels)[mipIndex];
+        const auto& mipSize = mipData.m_mipSize;
+        uint32_t x[2], y[2], z[2];
+        float weightX, weightY, weightZ;
+        GetLinearTexels(u, mipSize.m_width, x[0], x[1], weightX);
+        GetLinearTexels(v, mipSize.m_height, y[0], y[1], weightY);
+        GetLinearTexels(w, mipSize.m_depth, z[0], z[1], weightZ);
+
+        const size_t rowPitch = static_cast<size_t>(mipSize.m_width) * m_bytesPerPixel;
+        const size_t slicePitch = rowPitch * mipSize.m_height;
+        const uint8_t* pixels = mipData.m_dataBuffer->data();
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            if (channel >= m_channelCount)
+            {
+                rgba[channel] = 0.0f;
+                continue;
+            }
+            float zValues[2];
+            for (uint32_t k = 0; k < 2; k++)
+            {
+                float yValues[2];
+                for (uint32_t j = 0; j < 2; j++)
+                {
+                    const uint8_t* row = pixels + (slicePitch * z[k]) + (rowPitch * y[j]);
+                    const float value0 = FetchChannel(row + static_cast<size_t>(x[0]) * m_bytesPerPixel, channel);
+                    const float value1 = FetchChannel(row + static_cast<size_t>(x[1]) * m_bytesPerPixel, channel);
+                    yValues[j] = value0 + (value1 - value0) * weightX;
+                }
+                zValues[k] = yValues[0] + (yValues[1] - yValues[0]) * weightY;
+            }
+            rgba[channel] = zValues[0] + (zValues[1] - zValues[0]) * weightZ;
+        }
+    }
+
+    float CloudNoiseTextureSampler::FetchChannel(const uint8_t* texel, uint32_t channel) const
+    {
+        if (m_channelLayout == CloudTextureChannelLayout::R16F)
+        {
+            uint16_t halfValue;
+            memcpy(&halfValue, texel, sizeof(halfValue));
+            return CloudTextureStatistics::HalfToFloat(halfValue);
+        }
+        return static_cast<float>(texel[channel]) * (1.0f / 255.0f);
+    }
+
+    bool WeatherMapSampler::Initialize(const uint8_t* weatherMapPixels, uint32_t width, uint32_t height)
+    {
+        m_pixels = nullptr;
+        if (!weatherMapPixels || (width == 0) || (height == 0))
+        {
+            return false;
+        }
+        m_pixels = weatherMapPixels;
+        m_width = width;
+        m_height = height;
+        return true;
+    }
+
+    void WeatherMapSampler::Sample(float u, float v, float rgba[4]) const
+    {
+        uint32_t x0, x1, y0, y1;
+        float weightX, weightY;
+        GetLinearTexels(u, m_width, x0, x1, weightX);
+        GetLinearTexels(v, m_height, y0, y1, weightY);
+        const size_t rowPitch = static_cast<size_t>(m_width) * BytesPerPixel;
+        const uint8_t* row0 = m_pixels + rowPitch * y0;
+        const uint8_t* row1 = m_pixels + rowPitch * y1;
+        for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+        {
+            const float top = row0[x0 * BytesPerPixel + channel] + (row0[x1 * BytesPerPixel + channel] - row0[x0 * BytesPerPixel + channel]) * weightX;
+            const float bottom = row1[x0 * BytesPerPixel + channel] + (row1[x1 * BytesPerPixel + channel] - row1[x0 * BytesPerPixel + channel]) * weightX;
+            rgba[channel] = (top + (bottom - top) * weightY) * (1.0f / 255.0f);
+        }
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,70 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+
+#include <Atom/RHI.Reflect/Format.h>
+
+#include <Renderer/CloudTextureMipData.h>
+#include <Renderer/Passes/CloudTextureComputeData.h>
+
+namespace VolumetricClouds
+{
+    // CPU equivalent of SampleLevel() with the WrapLinearSampler of CloudscapeCS.azsl, for
+    // the CPU copy of a cloud noise Texture3D. Supports the formats of all the CloudTextureChannelLayout(s).
+    // Doesn't own the pixel data, the mip chain must outlive the sampler.
+    class CloudNoiseTextureSampler final
+    {
+    public:
+        // Returns false if @format is not the format of any CloudTextureChannelLayout, or if the size
+        // of any of the buffers doesn't match the size of its mip level.
+        bool Initialize(const AZStd::vector<CloudTextureMipData>* mipLevels, AZ::RHI::Format format);
+
+        bool IsValid() const { return m_mipLevels != nullptr; }
+        CloudTextureChannelLayout GetChannelLayout() const { return m_channelLayout; }
+        uint32_t GetMipCount() const;
+        // Width of mip 0, or 0 if the sampler is not valid.
+        uint32_t GetSize() const;
+
+        // Trilinear sample, the uvw wrap around and @mipLevel is clamped to the available mips.
+        // Channels that don't exist in the channel layout are set to 0.
+        void SampleLevel(float u, float v, float w, float mipLevel, float rgba[4]) const;
+
+    private:
+        void SampleMip(uint32_t mipIndex, float u, float v, float w, float rgba[4]) const;
+        // Returns the value of @channel of a single texel as a float.
+        float FetchChannel(const uint8_t* texel, uint32_t channel) const;
+
+        const AZStd::vector<CloudTextureMipData>* m_mipLevels = nullptr;
+        CloudTextureChannelLayout m_channelLayout = CloudTextureChannelLayout::RGBA8;
+        uint32_t m_bytesPerPixel = 4;
+        uint32_t m_channelCount = 4;
+    };
+
+    // CPU equivalent of GetWeatherData() in CloudscapeCS.azsl. Bilinear, wrap around, sampling of
+    // mip 0 of an RGBA8 (linear) weather map. Doesn't own the pixels, they must outlive the sampler.
+    class WeatherMapSampler final
+    {
+    public:
+        static constexpr uint32_t BytesPerPixel = 4; // RGBA8
+
+        // @weatherMapPixels are stored row by row. Returns false if the size is 0.
+        bool Initialize(const uint8_t* weatherMapPixels, uint32_t width, uint32_t height);
+
+        bool IsValid() const { return m_pixels != nullptr; }
+
+        void Sample(float u, float v, float rgba[4]) const;
+
+    private:
+        const uint8_t* m_pixels = nullptr;
+        uint32_t m_width = 0;
+        uint32_t m_height = 0;
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,202 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/std/algorithm.h>
+
+#include <cmath>
+
+#include "CloudTextureCpuBaker.h"
+#include "CloudscapeRaymarchKernels.h"
+#include "CloudscapeOpticalDepthVolume.h"
+
+namespace VolumetricClouds
+{
+    namespace
+    {
+        // Same as the texel addressing of a linear filter with clamp addressing: returns the two texels
+        // around @coord and the weight of the second one.
+        void GetClampedLinearTexels(float coord, uint32_t size, uint32_t& texel0, uint32_t& texel1, float& weight1)
+        {
+            const float texelCoord = coord * static_cast<float>(size) - 0.5f;
+            const float floorCoord = std::floor(texelCoord);
+            weight1 = texelCoord - floorCoord;
+            const float maxTexel = static_cast<float>(size - 1);
+            texel0 = static_cast<uint32_t>(AZStd::clamp(floorCoord, 0.0f, maxTexel));
+            texel1 = static_cast<uint32_t>(AZStd::clamp(floorCoord + 1.0f, 0.0f, maxTexel));
+        }
+    }
+
+    void CloudscapeOpticalDepthVolume::GetOriginKm(float cameraPositionX, float cameraPositionY, float sizeKm, float& originXKm, float& originYKm)
+    {
+        const float voxelSizeXKm = sizeKm / static_cast<float>(Width);
+        const float voxelSizeYKm = sizeKm / static_cast<float>(Height);
+        originXKm = std::floor((cameraPositionX * 0.001f) / voxelSizeXKm + 0.5f) * voxelSizeXKm;
+        originYKm = std::floor((cameraPositionY * 0.001f) / voxelSizeYKm + 0.5f) * voxelSizeYKm;
+    }
+
+    void CloudscapeOpticalDepthVolume::GetVoxelPositionKm(const CloudscapeRaymarchConstants& constants, float originXKm, float originYKm,
+        float sizeKm, uint32_t x, uint32_t y, uint32_t z, float positionKm[3])
+    {
+        const float u = (static_cast<float>(x) + 0.5f) / static_cast<float>(Width);
+        const float v = (static_cast<float>(y) + 0.5f) / static_cast<float>(Height);
+        const float w = (static_cast<float>(z) + 0.5f) / static_cast<float>(Depth);
+        positionKm[0] = originXKm + (u - 0.5f) * sizeKm;
+        positionKm[1] = originYKm + (v - 0.5f) * sizeKm;
+        const float innerSphereRadiusKm = constants.m_planetRadiusKm + constants.m_cloudSlabDistanceAboveSeaLevelKm;
+        const float radiusKm = innerSphereRadiusKm + w * constants.m_cloudSlabThicknessKm;
+        positionKm[2] = std::sqrt(AZStd::max(radiusKm * radiusKm - positionKm[0] * positionKm[0] - positionKm[1] * positionKm[1], 0.0f));
+    }
+
+    float CloudscapeOpticalDepthVolume::GetMipLevel(const CloudscapeRaymarchConstants& constants, uint32_t lowFrequencyNoiseSize, float sizeKm)
+    {
+        // The mip whose texels are about the size of a voxel.
+        const float voxelSizeKm = sizeKm / static_cast<float>(Width);
+        const float mipLevel = std::log2(voxelSizeKm * constants.m_uvwScale * static_cast<float>(lowFrequencyNoiseSize));
+        return AZStd::clamp(mipLevel, 0.0f, static_cast<float>(constants.m_maxMipLevels - 1));
+    }
+
+    void CloudscapeOpticalDepthVolume::Build(const CloudscapeRaymarchConstants& constants, const CloudscapeRaymarchTextures& textures,
+        float originXKm, float originYKm, float sizeKm, AZ::JobContext* jobContext)
+    {
+        using Kernels = CloudscapeRaymarchKernels<AZ::Simd::Vec4>;
+        using VecType = AZ::Simd::Vec4;
+        static constexpr uint32_t LaneCount = Kernels::LaneCount;
+        static_assert((Width % LaneCount) == 0, "Volume rows must be a multiple of the SIMD lane count");
+
+        m_originKm[0] = originXKm;
+        m_originKm[1] = originYKm;
+        m_sizeKm = sizeKm;
+        m_values.resize(static_cast<size_t>(Width) * Height * Depth);
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        const float outerSphereRadiusKm = constants.m_planetRadiusKm + constants.m_cloudSlabDistanceAboveSeaLevelKm + constants.m_cloudSlabThicknessKm;
+        const float maxLightMarchDistanceKm = constants.m_cloudSlabThicknessKm * MaxLightMarchDistanceFactor;
+        const float eCoef = constants.m_aCoef + constants.m_sCoef;
+        const float* sunDirection = constants.m_directionTowardsTheSun;
+        const auto uvwScale = VecType::Splat(constants.m_uvwScale);
+        const auto mipLevel = VecType::Splat(GetMipLevel(constants, textures.m_lowFreqNoise.GetSize(), sizeKm));
+        const bool noHighFreqNoise[LaneCount] = {};
+
+        // Each job ray marches whole rows of voxels, four voxels at a time.
+        CloudTextureCpuBaker::ForEachSlab(jobContext, Height * Depth, [&](uint32_t firstRow, uint32_t rowCount)
+            {
+                for (uint32_t rowIndex = firstRow; rowIndex < firstRow + rowCount; rowIndex++)
+                {
+                    const uint32_t y = rowIndex % Height;
+                    const uint32_t z = rowIndex / Height;
+                    float* row = m_values.data() + static_cast<size_t>(rowIndex) * Width;
+                    for (uint32_t x = 0; x < Width; x += LaneCount)
+                    {
+                        alignas(16) float voxelPosKm[3][LaneCount];
+                        alignas(16) float stepSizeKm[LaneCount];
+                        for (uint32_t lane = 0; lane < LaneCount; lane++)
+                        {
+                            float positionKm[3];
+                            GetVoxelPositionKm(constants, originXKm, originYKm, sizeKm, x + lane, y, z, positionKm);
+                            // Distance, towards the sun, to the outer sphere of the cloud slab.
+                            const float b = positionKm[0] * sunDirection[0] + positionKm[1] * sunDirection[1] + positionKm[2] * sunDirection[2];
+                            const float c = positionKm[0] * positionKm[0] + positionKm[1] * positionKm[1] + positionKm[2] * positionKm[2]
+                                - outerSphereRadiusKm * outerSphereRadiusKm;
+                            const float distanceToOuterSphereKm = -b + std::sqrt(AZStd::max(b * b - c, 0.0f));
+                            stepSizeKm[lane] = AZStd::min(distanceToOuterSphereKm, maxLightMarchDistanceKm) / static_cast<float>(LightMarchSteps);
+                            for (uint32_t axis = 0; axis < 3; axis++)
+                            {
+                                voxelPosKm[axis][lane] = positionKm[axis];
+                            }
+                        }
+
+                        const auto stepSize = VecType::LoadAligned(stepSizeKm);
+                        auto densitySum = VecType::ZeroFloat();
+                        for (uint32_t stepIdx = 0; stepIdx < LightMarchSteps; stepIdx++)
+                        {
+                            const auto distanceKm = VecType::Mul(stepSize, VecType::Splat(static_cast<float>(stepIdx) + 0.5f));
+                            const Kernels::Float3 samplePosKm = {
+                                VecType::Add(VecType::LoadAligned(voxelPosKm[0]), VecType::Mul(VecType::Splat(sunDirection[0]), distanceKm)),
+                                VecType::Add(VecType::LoadAligned(voxelPosKm[1]), VecType::Mul(VecType::Splat(sunDirection[1]), distanceKm)),
+                                VecType::Add(VecType::LoadAligned(voxelPosKm[2]), VecType::Mul(VecType::Splat(sunDirection[2]), distanceKm)),
+                            };
+                            const auto heightFraction = Kernels::GetHeightFraction(constants, samplePosKm);
+
+                            alignas(16) float heightFractionLanes[LaneCount];
+                            VecType::StoreAligned(heightFractionLanes, heightFraction);
+                            bool sampleLanes[LaneCount];
+                            bool anySample = false;
+                            for (uint32_t lane = 0; lane < LaneCount; lane++)
+                            {
+                                sampleLanes[lane] = (heightFractionLanes[lane] >= 0.0f) && (heightFractionLanes[lane] <= 1.0f);
+                                anySample = anySample || sampleLanes[lane];
+                            }
+                            if (!anySample)
+                            {
+                                continue;
+                            }
+
+                            // Always sample cheaply, same as the cone sampling.
+                            const auto density = Kernels::SampleCloudDensity(constants, textures, samplePosKm, uvwScale, mipLevel,
+                                heightFraction, sampleLanes, noHighFreqNoise);
+                            alignas(16) float densityLanes[LaneCount];
+                            VecType::StoreAligned(densityLanes, VecType::Max(density, VecType::ZeroFloat()));
+                            for (uint32_t lane = 0; lane < LaneCount; lane++)
+                            {
+                                densityLanes[lane] = sampleLanes[lane] ? densityLanes[lane] : 0.0f;
+                            }
+                            densitySum = VecType::Add(densitySum, VecType::LoadAligned(densityLanes));
+                        }
+
+                        alignas(16) float opticalDepth[LaneCount];
+                        VecType::StoreAligned(opticalDepth, VecType::Mul(VecType::Mul(densitySum, stepSize), VecType::Splat(eCoef)));
+                        for (uint32_t lane = 0; lane < LaneCount; lane++)
+                        {
+                            row[x + lane] = opticalDepth[lane];
+                        }
+                    }
+                }
+            });
+    }
+
+    bool CloudscapeOpticalDepthVolume::GetUVW(const float worldPosKm[3], float heightFraction, float uvw[3]) const
+    {
+        uvw[0] = ((worldPosKm[0] - m_originKm[0]) / m_sizeKm) + 0.5f;
+        uvw[1] = ((worldPosKm[1] - m_originKm[1]) / m_sizeKm) + 0.5f;
+        uvw[2] = heightFraction;
+        return (uvw[0] >= 0.0f) && (uvw[0] <= 1.0f) && (uvw[1] >= 0.0f) && (uvw[1] <= 1.0f);
+    }
+
+    float CloudscapeOpticalDepthVolume::Sample(const float uvw[3]) const
+    {
+        uint32_t x[2], y[2], z[2];
+        float weightX, weightY, weightZ;
+        GetClampedLinearTexels(uvw[0], Width, x[0], x[1], weightX);
+        GetClampedLinearTexels(uvw[1], Height, y[0], y[1], weightY);
+        GetClampedLinearTexels(uvw[2], Depth, z[0], z[1], weightZ);
+
+        float zValues[2];
+        for (uint32_t k = 0; k < 2; k++)
+        {
+            float yValues[2];
+            for (uint32_t j = 0; j < 2; j++)
+            {
+                const float value0 = GetVoxel(x[0], y[j], z[k]);
+                const float value1 = GetVoxel(x[1], y[j], z[k]);
+                yValues[j] = value0 + (value1 - value0) * weightX;
+            }
+            zValues[k] = yValues[0] + (yValues[1] - yValues[0]) * weightY;
+        }
+        return zValues[0] + (zValues[1] - zValues[0]) * weightZ;
+    }
+
+    float CloudscapeOpticalDepthVolume::GetVoxel(uint32_t x, uint32_t y, uint32_t z) const
+    {
+        return m_values[(static_cast<size_t>(z) * Height + y) * Width + x];
+    }
+
+} // namespace VolumetricClouds
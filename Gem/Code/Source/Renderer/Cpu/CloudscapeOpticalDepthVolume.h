@@ -0,0 +1,71 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+
+namespace AZ
+{
+    class JobContext;
+}
+
+namespace VolumetricClouds
+{
+    struct CloudscapeRaymarchConstants;
+    struct CloudscapeRaymarchTextures;
+
+    // CPU implementation of CloudscapeOpticalDepthCS.azsl, and of the addressing in CloudscapeOpticalDepthVolume.azsli.
+    // The volume covers a square of @sizeKm around the camera in X and Y, snapped to the voxel size,
+    // and the thickness of the cloud slab in Z. Z is indexed by height fraction, so the volume bends with the planet.
+    // Each voxel stores the optical depth, already multiplied by the extinction coefficient, from the voxel
+    // center towards the sun, which replaces the cone sampling of GetMultiScatteredLuminance().
+    class CloudscapeOpticalDepthVolume final
+    {
+    public:
+        // Size of CloudscapeFeatureProcessor::m_opticalDepthVolume.
+        static constexpr uint32_t Width = 128;
+        static constexpr uint32_t Height = 128;
+        static constexpr uint32_t Depth = 32;
+        // Same as OPTICAL_DEPTH_LIGHT_MARCH_STEPS.
+        static constexpr uint32_t LightMarchSteps = 16;
+        // Same as OPTICAL_DEPTH_MAX_DISTANCE_FACTOR.
+        static constexpr float MaxLightMarchDistanceFactor = 4.0f;
+
+        // Same as GetOpticalDepthVolumeOriginKm(). @cameraPositionX and @cameraPositionY are in meters.
+        static void GetOriginKm(float cameraPositionX, float cameraPositionY, float sizeKm, float& originXKm, float& originYKm);
+
+        // Same as GetOpticalDepthVoxelPositionKm(), the planet centered position of the center of a voxel.
+        static void GetVoxelPositionKm(const CloudscapeRaymarchConstants& constants, float originXKm, float originYKm, float sizeKm,
+            uint32_t x, uint32_t y, uint32_t z, float positionKm[3]);
+
+        // Same as the mip level used by CloudscapeOpticalDepthCS.azsl to sample the low frequency noise.
+        static float GetMipLevel(const CloudscapeRaymarchConstants& constants, uint32_t lowFrequencyNoiseSize, float sizeKm);
+
+        // Ray marches, towards the sun, from the center of every voxel. Same as CloudscapeOpticalDepthCS.azsl.
+        // If @jobContext is null the global job context is used.
+        void Build(const CloudscapeRaymarchConstants& constants, const CloudscapeRaymarchTextures& textures,
+            float originXKm, float originYKm, float sizeKm, AZ::JobContext* jobContext = nullptr);
+
+        bool IsValid() const { return !m_values.empty(); }
+
+        // Same as GetOpticalDepthVolumeUVW(). Returns false if @worldPosKm is outside the footprint of the volume.
+        bool GetUVW(const float worldPosKm[3], float heightFraction, float uvw[3]) const;
+
+        // Trilinear sample, same as SampleLevel() with the ClampLinearSampler of CloudscapeCS.azsl.
+        float Sample(const float uvw[3]) const;
+
+        float GetVoxel(uint32_t x, uint32_t y, uint32_t z) const;
+
+    private:
+        float m_originKm[2] = { 0.0f, 0.0f };
+        float m_sizeKm = 0.0f;
+        // Width x Height x Depth values, row by row, slice by slice.
+        AZStd::vector<float> m_values;
+    };
+
+} // namespace VolumetricClouds
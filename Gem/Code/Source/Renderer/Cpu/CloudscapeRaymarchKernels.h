@@ -0,0 +1,753 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/Math/SimdMath.h>
+#include <AzCore/std/algorithm.h>
+
+#include <cmath>
+
+#include "CloudscapeCpuTextures.h"
+#include "CloudscapeOpticalDepthVolume.h"
+
+namespace VolumetricClouds
+{
+    // The PassSrg constants of CloudscapeCS.azsl, derived from a CloudscapeShaderConstantData
+    // the same way CloudscapeComputePass::CompileResources() does it.
+    // See CloudscapeCpuRaymarcher::GetConstants().
+    struct CloudscapeRaymarchConstants
+    {
+        float m_uvwScale = 0.25f;
+        uint32_t m_maxMipLevels = 1;
+        uint32_t m_minRayMarchingSteps = 32;
+        uint32_t m_maxRayMarchingSteps = 64;
+
+        float m_planetRadiusKm = 6371.0f;
+        float m_cloudSlabDistanceAboveSeaLevelKm = 1.5f;
+        float m_cloudSlabThicknessKm = 3.5f;
+
+        float m_sunColorAndIntensity[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        float m_ambientLightColorAndIntensity[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        float m_directionTowardsTheSun[3] = { 0.0f, 0.0f, 1.0f };
+
+        // In [Km-1].
+        float m_aCoef = 10.0f;
+        float m_sCoef = 30.0f;
+        float m_henyeyGreensteinG = 0.2f;
+        float m_multipleScatteringABC[3] = { 0.5f, 0.5f, 0.5f };
+
+        float m_weatherMapSizeKm = 60.0f;
+        float m_globalCloudCoverage = 0.75f;
+        float m_globalCloudDensity = 1.0f;
+        float m_windSpeedKmPerSec = 0.0f;
+        // Normalized, or zero.
+        float m_windDirection[3] = { 0.0f, 0.0f, 0.0f };
+        float m_cloudTopOffsetKm = 0.0f;
+
+        // The quality shader options of CloudscapeCS.azsl, see CloudscapeQualitySettings.
+        uint32_t m_lightSampleCount = 6;
+        uint32_t m_maxOctaves = 3;
+        int m_largeStepIncrement = 1;
+        // o_dualLobeWeightQuarters * 0.25.
+        float m_dualLobePhaseFunctionWeight = 0.75f;
+        bool m_highFrequencyDetail = true;
+
+        // SceneSrg::m_time, in seconds. Animates the clouds along the wind direction.
+        float m_timeSeconds = 0.0f;
+    };
+
+    // The textures read by CloudscapeCS.azsl.
+    struct CloudscapeRaymarchTextures
+    {
+        CloudNoiseTextureSampler m_lowFreqNoise;
+        CloudNoiseTextureSampler m_highFreqNoise;
+        WeatherMapSampler m_weatherMap;
+        // Same as PassSrg::m_opticalDepthVolume with o_useOpticalDepthVolume. When null, or outside
+        // the footprint of the volume, the optical depth is cone sampled.
+        const CloudscapeOpticalDepthVolume* m_opticalDepthVolume = nullptr;
+    };
+
+    // CPU port of GetCloudColor(), SampleCloudDensity() and GetMultiScatteredLuminance() in CloudscapeCS.azsl.
+    // The functions are templated on an AZ::Simd vector type, and each lane of the vector is an independent ray.
+    // Each ray has its own step count and its own path through the loop of GetCloudColor(), so the control flow
+    // is evaluated per lane, with scalars, while the math of each step, the light march towards the sun
+    // and the phase functions are evaluated for all the lanes at once. Texture samples are gathered per lane.
+    // AZ::Simd::Vec4 and AZ::Simd::Vec1 produce the same color for a given ray.
+    template<typename VecType>
+    class CloudscapeRaymarchKernels final
+    {
+    public:
+        using FloatType = typename VecType::FloatType;
+        static constexpr uint32_t LaneCount = VecType::ElementCount;
+
+        struct Float3
+        {
+            FloatType m_x;
+            FloatType m_y;
+            FloatType m_z;
+        };
+
+        // One ray per lane. Same data as the AtmosphereIntersectionInfo in CloudscapeCS.azsl,
+        // see CloudscapeCpuRaymarcher::GetCloudSlabIntersections().
+        struct RayPacket
+        {
+            alignas(16) float m_rayMarchStartPosKm[3][LaneCount];
+            alignas(16) float m_rayDirection[3][LaneCount];
+            float m_rayMarchDistanceKm[LaneCount];
+            float m_distanceFromCameraToInnerSphereKm[LaneCount];
+            // In pixels, used to jitter the start of the ray.
+            float m_pixelLocation[2][LaneCount];
+            // False for the lanes without a ray, or whose ray doesn't reach the cloud slab.
+            bool m_hasRay[LaneCount];
+        };
+
+        // Premultiplied cloud color and alpha of each lane. Zero for the lanes without a ray.
+        struct ColorPacket
+        {
+            float m_rgba[4][LaneCount];
+        };
+
+        // Same as GetCloudColor(), for each lane of @rays.
+        static void GetCloudColor(const CloudscapeRaymarchConstants& constants, const CloudscapeRaymarchTextures& textures,
+            const RayPacket& rays, ColorPacket& colors)
+        {
+            // State of the ray marching loop of each lane.
+            alignas(16) float startPosKm[3][LaneCount];
+            alignas(16) float direction[3][LaneCount];
+            alignas(16) float stepSizeKm[LaneCount];
+            alignas(16) float stepIndex[LaneCount];
+            alignas(16) float mipLevel[LaneCount];
+            float mipLevelStep[LaneCount];
+            int numSamples[LaneCount];
+            int stepIdx[LaneCount];
+            int zeroDensitySampleCount[LaneCount];
+            bool isEmptySpace[LaneCount];
+            bool isMarching[LaneCount];
+            float totalColor[3][LaneCount];
+            float totalTransmittance[LaneCount];
+
+            const int minRayMarchingSteps = AZStd::max(static_cast<int>(constants.m_minRayMarchingSteps), 1);
+            const int maxRayMarchingSteps = AZStd::min(static_cast<int>(constants.m_maxRayMarchingSteps), 128);
+            // Extinction/Attenuation coefficent.
+            const float eCoef = AZStd::max(constants.m_aCoef + constants.m_sCoef, 0.00000001f);
+
+            bool anyMarching = false;
+            for (uint32_t lane = 0; lane < LaneCount; lane++)
+            {
+                totalColor[0][lane] = totalColor[1][lane] = totalColor[2][lane] = 0.0f;
+                totalTransmittance[lane] = 1.0f;
+                stepIdx[lane] = 0;
+                zeroDensitySampleCount[lane] = 0;
+                isEmptySpace[lane] = true;
+                isMarching[lane] = rays.m_hasRay[lane];
+                if (!isMarching[lane])
+                {
+                    // Keeps the math of the idle lanes finite.
+                    for (uint32_t axis = 0; axis < 3; axis++)
+                    {
+                        startPosKm[axis][lane] = 0.0f;
+                        direction[axis][lane] = (axis == 2) ? 1.0f : 0.0f;
+                    }
+                    stepSizeKm[lane] = 0.0f;
+                    mipLevel[lane] = 0.0f;
+                    mipLevelStep[lane] = 0.0f;
+                    numSamples[lane] = 0;
+                    continue;
+                }
+                anyMarching = true;
+
+                const float rayMarchDistanceKm = rays.m_rayMarchDistanceKm[lane];
+                const float distanceToInnerSphereKm = rays.m_distanceFromCameraToInnerSphereKm[lane];
+                const float samples = AZStd::min((minRayMarchingSteps * rayMarchDistanceKm) / constants.m_cloudSlabThicknessKm,
+                    static_cast<float>(maxRayMarchingSteps));
+                numSamples[lane] = static_cast<int>(AZStd::max(samples, 1.0f));
+                stepSizeKm[lane] = rayMarchDistanceKm / numSamples[lane];
+
+                const float jitter = GetJitterOffset(rays.m_pixelLocation[0][lane], rays.m_pixelLocation[1][lane]);
+                for (uint32_t axis = 0; axis < 3; axis++)
+                {
+                    direction[axis][lane] = rays.m_rayDirection[axis][lane];
+                    startPosKm[axis][lane] = rays.m_rayMarchStartPosKm[axis][lane] + direction[axis][lane] * jitter * stepSizeKm[lane];
+                }
+
+                mipLevel[lane] = AZStd::max(0.0f, Remap(distanceToInnerSphereKm,
+                    constants.m_cloudSlabDistanceAboveSeaLevelKm,
+                    distanceToInnerSphereKm + rayMarchDistanceKm,
+                    0.0f, static_cast<float>(constants.m_maxMipLevels - 1)));
+                mipLevelStep[lane] = static_cast<float>(constants.m_maxMipLevels) / static_cast<float>(numSamples[lane]);
+            }
+
+            const Float3 rayDirection = Load3(direction);
+            const Float3 rayMarchStartPosKm = Load3(startPosKm);
+            const FloatType stepSize = VecType::LoadAligned(stepSizeKm);
+            const FloatType uvwScale = VecType::Splat(constants.m_uvwScale);
+
+            while (anyMarching)
+            {
+                bool sampleHighFreqNoise[LaneCount];
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    stepIndex[lane] = static_cast<float>(stepIdx[lane]);
+                    sampleHighFreqNoise[lane] = constants.m_highFrequencyDetail && isMarching[lane] && !isEmptySpace[lane];
+                }
+
+                const Float3 rayWorldPosKm = Add3(rayMarchStartPosKm, Scale(Scale(rayDirection, VecType::LoadAligned(stepIndex)), stepSize));
+                const FloatType heightFraction = GetHeightFraction(constants, rayWorldPosKm);
+                const FloatType sampledCloudDensity = SampleCloudDensity(constants, textures, rayWorldPosKm, uvwScale,
+                    VecType::LoadAligned(mipLevel), heightFraction, isMarching, sampleHighFreqNoise);
+                alignas(16) float density[LaneCount];
+                VecType::StoreAligned(density, sampledCloudDensity);
+
+                // The branches of the loop in GetCloudColor() that don't integrate light.
+                bool isIntegrating[LaneCount];
+                bool anyIntegrating = false;
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    isIntegrating[lane] = false;
+                    if (!isMarching[lane])
+                    {
+                        continue;
+                    }
+                    if (density[lane] <= 0.0f)
+                    {
+                        if (isEmptySpace[lane])
+                        {
+                            // Keep doing cheap sampling at large steps.
+                            stepIdx[lane] += constants.m_largeStepIncrement;
+                        }
+                        else
+                        {
+                            zeroDensitySampleCount[lane]++;
+                            stepIdx[lane]++;
+                            if (zeroDensitySampleCount[lane] >= 6)
+                            {
+                                isEmptySpace[lane] = true;
+                            }
+                        }
+                        continue;
+                    }
+                    zeroDensitySampleCount[lane] = 0;
+
+                    // We found a cloud, but if we were doing cheap sampling in empty space
+                    // we need to step back and start doing "expensive" sampling in small steps.
+                    if (isEmptySpace[lane])
+                    {
+                        isEmptySpace[lane] = false;
+                        stepIdx[lane] = AZStd::max(stepIdx[lane] - constants.m_largeStepIncrement, 0);
+                        continue;
+                    }
+                    isIntegrating[lane] = true;
+                    anyIntegrating = true;
+                }
+
+                if (anyIntegrating)
+                {
+                    const FloatType stepTransmittance = ExpPerLane(VecType::Mul(VecType::Mul(VecType::Splat(-eCoef), sampledCloudDensity), stepSize));
+
+                    // Calculate the Light Energy that arrives as this point in the raymarch.
+                    const Float3 scatteredLuminance = GetMultiScatteredLuminance(constants, textures, rayWorldPosKm, stepSize, rayDirection, isIntegrating);
+                    const Float3 luminance = Add3(scatteredLuminance, GetAmbientLightColor(constants, heightFraction));
+
+                    // The frostbite trick for better integration.
+                    const FloatType invECoef = VecType::Splat(eCoef);
+                    const Float3 integScatt = {
+                        VecType::Div(VecType::Sub(luminance.m_x, VecType::Mul(luminance.m_x, stepTransmittance)), invECoef),
+                        VecType::Div(VecType::Sub(luminance.m_y, VecType::Mul(luminance.m_y, stepTransmittance)), invECoef),
+                        VecType::Div(VecType::Sub(luminance.m_z, VecType::Mul(luminance.m_z, stepTransmittance)), invECoef),
+                    };
+                    alignas(16) float integScattLanes[3][LaneCount];
+                    alignas(16) float stepTransmittanceLanes[LaneCount];
+                    Store3(integScattLanes, integScatt);
+                    VecType::StoreAligned(stepTransmittanceLanes, stepTransmittance);
+
+                    for (uint32_t lane = 0; lane < LaneCount; lane++)
+                    {
+                        if (!isIntegrating[lane])
+                        {
+                            continue;
+                        }
+                        for (uint32_t channel = 0; channel < 3; channel++)
+                        {
+                            totalColor[channel][lane] += totalTransmittance[lane] * integScattLanes[channel][lane];
+                        }
+                        totalTransmittance[lane] *= stepTransmittanceLanes[lane];
+                        if (totalTransmittance[lane] <= 0.05f)
+                        {
+                            // Not getting any more dense than this.
+                            isMarching[lane] = false;
+                            continue;
+                        }
+                        stepIdx[lane]++;
+                        mipLevel[lane] += mipLevelStep[lane];
+                    }
+                }
+
+                anyMarching = false;
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    isMarching[lane] = isMarching[lane] && (stepIdx[lane] < numSamples[lane]);
+                    anyMarching = anyMarching || isMarching[lane];
+                }
+            }
+
+            for (uint32_t lane = 0; lane < LaneCount; lane++)
+            {
+                if (!rays.m_hasRay[lane])
+                {
+                    colors.m_rgba[0][lane] = colors.m_rgba[1][lane] = colors.m_rgba[2][lane] = colors.m_rgba[3][lane] = 0.0f;
+                    continue;
+                }
+
+                float totalAlpha = 1.0f - totalTransmittance[lane];
+                float color[3] = { totalColor[0][lane], totalColor[1][lane], totalColor[2][lane] };
+
+                // Fade out the clouds that are too far away.
+                const float distanceToInnerSphereKm = rays.m_distanceFromCameraToInnerSphereKm[lane];
+                const float alphaReduceStartDistance = (10 * 1024.0f) * 0.001f;
+                if (distanceToInnerSphereKm >= alphaReduceStartDistance)
+                {
+                    const float maxDistance = alphaReduceStartDistance * 3.0f;
+                    const float fraction = AZStd::clamp((distanceToInnerSphereKm - alphaReduceStartDistance) / maxDistance, 0.0f, 1.0f);
+                    totalAlpha = totalAlpha + (0.0f - totalAlpha) * fraction;
+                    for (float& channel : color)
+                    {
+                        channel = channel + (0.0f - channel) * fraction;
+                    }
+                }
+                colors.m_rgba[0][lane] = color[0];
+                colors.m_rgba[1][lane] = color[1];
+                colors.m_rgba[2][lane] = color[2];
+                colors.m_rgba[3][lane] = totalAlpha;
+            }
+        }
+
+        // Same as GetHeightFraction().
+        static FloatType GetHeightFraction(const CloudscapeRaymarchConstants& constants, const Float3& worldPosKm)
+        {
+            // This function assumes the center of the world is 0, 0, 0 (sphere center)
+            const float innerSphereRadiusKm = constants.m_planetRadiusKm + constants.m_cloudSlabDistanceAboveSeaLevelKm;
+            const float outerSphereRadiusKm = innerSphereRadiusKm + constants.m_cloudSlabThicknessKm;
+            const FloatType distanceToCenter = VecType::Sqrt(Dot(worldPosKm, worldPosKm));
+            return VecType::Div(VecType::Sub(distanceToCenter, VecType::Splat(innerSphereRadiusKm)),
+                VecType::Splat(outerSphereRadiusKm - innerSphereRadiusKm));
+        }
+
+        // Same as SampleCloudDensity(). The textures are only read for the lanes in @sampleLanes, the density of the
+        // other lanes is meaningless. The detail noise is only applied to the lanes in @sampleHighFreqNoise.
+        static FloatType SampleCloudDensity(const CloudscapeRaymarchConstants& constants, const CloudscapeRaymarchTextures& textures,
+            const Float3& rayWorldPosKm, const FloatType& uvwScale, const FloatType& mipLevel, const FloatType& heightFraction,
+            const bool (&sampleLanes)[LaneCount], const bool (&sampleHighFreqNoise)[LaneCount])
+        {
+            const Float3 worldPosKm = ApplyWindEffect(constants, rayWorldPosKm, heightFraction);
+            const Float3 uvw = Scale(worldPosKm, uvwScale);
+
+            // Same as GetWeatherMapUV().
+            const FloatType one = VecType::Splat(1.0f);
+            const FloatType weatherMapSizeKm = VecType::Splat(constants.m_weatherMapSizeKm);
+            const FloatType halfWorldSizeKm = VecType::Splat(constants.m_weatherMapSizeKm * 0.5f);
+            const FloatType weatherMapU = VecType::Add(one, VecType::Div(VecType::Sub(worldPosKm.m_x, halfWorldSizeKm), weatherMapSizeKm));
+            const FloatType weatherMapV = VecType::Add(one, VecType::Div(VecType::Sub(worldPosKm.m_y, halfWorldSizeKm), weatherMapSizeKm));
+
+            // Gather the texture samples of each lane.
+            alignas(16) float uvwLanes[3][LaneCount];
+            alignas(16) float weatherMapUVLanes[2][LaneCount];
+            alignas(16) float mipLevelLanes[LaneCount];
+            Store3(uvwLanes, uvw);
+            VecType::StoreAligned(weatherMapUVLanes[0], weatherMapU);
+            VecType::StoreAligned(weatherMapUVLanes[1], weatherMapV);
+            VecType::StoreAligned(mipLevelLanes, mipLevel);
+            alignas(16) float lowFreqNoise[4][LaneCount];
+            alignas(16) float highFreqNoise[4][LaneCount];
+            alignas(16) float weatherData[4][LaneCount];
+            for (uint32_t lane = 0; lane < LaneCount; lane++)
+            {
+                float lowFreqRgba[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                float highFreqRgba[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                float weatherRgba[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+                if (sampleLanes[lane])
+                {
+                    textures.m_lowFreqNoise.SampleLevel(uvwLanes[0][lane], uvwLanes[1][lane], uvwLanes[2][lane], mipLevelLanes[lane], lowFreqRgba);
+                    textures.m_weatherMap.Sample(weatherMapUVLanes[0][lane], weatherMapUVLanes[1][lane], weatherRgba);
+                    if (sampleHighFreqNoise[lane])
+                    {
+                        textures.m_highFreqNoise.SampleLevel(uvwLanes[0][lane], uvwLanes[1][lane], uvwLanes[2][lane],
+                            AZStd::max(mipLevelLanes[lane] - 2.0f, 0.0f), highFreqRgba);
+                    }
+                }
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    lowFreqNoise[channel][lane] = lowFreqRgba[channel];
+                    highFreqNoise[channel][lane] = highFreqRgba[channel];
+                    weatherData[channel][lane] = weatherRgba[channel];
+                }
+            }
+
+            const FloatType shapeNoiseSample = GetShapeNoise(textures.m_lowFreqNoise.GetChannelLayout(), lowFreqNoise);
+
+            const FloatType zero = VecType::ZeroFloat();
+            const FloatType shapeRemapBottom = Saturate(Remap(heightFraction, zero, VecType::Splat(0.070f), zero, one));
+            const FloatType cloudMaxHeight = VecType::LoadAligned(weatherData[2]);
+            const FloatType shapeRemapTop = Saturate(Remap(heightFraction, VecType::Mul(cloudMaxHeight, VecType::Splat(0.20f)), cloudMaxHeight, one, zero));
+            const FloatType shapeAltering = VecType::Mul(shapeRemapBottom, shapeRemapTop);
+
+            const FloatType densityRemapBottom = VecType::Mul(heightFraction,
+                Saturate(Remap(heightFraction, zero, VecType::Splat(0.15f), zero, VecType::Splat(0.10f))));
+            const FloatType densityRemapTop = Saturate(Remap(heightFraction, VecType::Splat(0.9f), one, one, zero));
+            const FloatType weatherMapDensity = VecType::LoadAligned(weatherData[3]);
+            FloatType densityAlteration = VecType::Mul(VecType::Splat(constants.m_globalCloudDensity), densityRemapBottom);
+            densityAlteration = VecType::Mul(densityAlteration, densityRemapTop);
+            densityAlteration = VecType::Mul(densityAlteration, weatherMapDensity);
+            densityAlteration = VecType::Mul(densityAlteration, VecType::Splat(2.0f));
+
+            const float highCoverageWeight = AZStd::clamp(constants.m_globalCloudCoverage - 0.5f, 0.0f, 1.0f);
+            const FloatType weatherMapCoverage = VecType::Max(VecType::LoadAligned(weatherData[0]),
+                VecType::Mul(VecType::Mul(VecType::Splat(highCoverageWeight), VecType::LoadAligned(weatherData[1])), VecType::Splat(2.0f)));
+
+            const FloatType coverageMin = VecType::Sub(one, VecType::Mul(VecType::Splat(constants.m_globalCloudCoverage), weatherMapCoverage));
+            FloatType result = Saturate(Remap(VecType::Mul(shapeNoiseSample, shapeAltering), coverageMin, one, zero, one));
+
+            bool anyHighFreqNoise = false;
+            for (uint32_t lane = 0; lane < LaneCount; lane++)
+            {
+                anyHighFreqNoise = anyHighFreqNoise || (sampleLanes[lane] && sampleHighFreqNoise[lane]);
+            }
+            if (anyHighFreqNoise)
+            {
+                const FloatType highFreqFBM = GetDetailNoise(textures.m_highFreqNoise.GetChannelLayout(), highFreqNoise);
+                // Per Haggstrom: The entire influence of the detail noise is reduced to be maximum 0.35,
+                // with exp(-gc*0.75) the influence is reduced with the global coverage,
+                // and the linear interpolation ensures that clouds are more
+                // fluffy towards the base and more billowy towards the peak.
+                const float detailInfluence = 0.35f * std::exp(-constants.m_globalCloudCoverage * 0.75f);
+                const FloatType highFreqNoiseModified = VecType::Mul(VecType::Splat(detailInfluence),
+                    Lerp(highFreqFBM, VecType::Sub(one, highFreqFBM), Saturate(heightFraction)));
+                const FloatType detailedResult = Saturate(Remap(result, highFreqNoiseModified, one, zero, one));
+                result = SelectLanes(sampleHighFreqNoise, detailedResult, result);
+            }
+
+            return VecType::Mul(result, densityAlteration);
+        }
+
+        // Same as GetMultiScatteredLuminance(). Only the lanes in @integratingLanes sample the textures.
+        // The lanes within the footprint of CloudscapeRaymarchTextures::m_opticalDepthVolume read it instead of cone sampling.
+        static Float3 GetMultiScatteredLuminance(const CloudscapeRaymarchConstants& constants, const CloudscapeRaymarchTextures& textures,
+            const Float3& rayWorldPosKm, const FloatType& stepSizeKm, const Float3& viewDirection, const bool (&integratingLanes)[LaneCount])
+        {
+            // Cone sampling random offsets. Same as NOISE_KERNEL in CloudscapeCS.azsl.
+            static constexpr float NoiseKernel[12][3] = {
+                { 0.82948634f, -0.47047977f, 0.30100033f },
+                { -0.63479043f, -0.20974313f, 0.74367259f },
+                { -0.84602539f, -0.10106155f, -0.52347646f },
+                { 0.21666301f, 0.86326400f, 0.45588640f },
+                { 0.08032086f, 0.86948881f, 0.48737847f },
+                { -0.81387245f, -0.57331667f, 0.09444381f },
+                { 0.56074663f, 0.63942210f, 0.52602527f },
+                { -0.84755565f, -0.10328429f, -0.52055910f },
+                { -0.70260971f, 0.70208185f, -0.11584761f },
+                { 0.45503186f, 0.22278661f, -0.86215551f },
+                { 0.97105420f, -0.16351118f, -0.17412016f },
+                { -0.40700059f, -0.25467177f, -0.87720739f },
+            };
+            const int numLightSamples = static_cast<int>(AZStd::min(constants.m_lightSampleCount, 12u));
+
+            const float eCoef = constants.m_aCoef + constants.m_sCoef;
+            const FloatType uvwScale = VecType::Splat(constants.m_uvwScale);
+            const bool noHighFreqNoise[LaneCount] = {};
+
+            FloatType opticalDepth = VecType::ZeroFloat();
+
+            // One fetch from the optical depth volume, for the lanes within its footprint.
+            bool coneSamplingLanes[LaneCount];
+            if (textures.m_opticalDepthVolume)
+            {
+                alignas(16) float positionLanes[3][LaneCount];
+                alignas(16) float heightFractionLanes[LaneCount];
+                alignas(16) float opticalDepthLanes[LaneCount];
+                Store3(positionLanes, rayWorldPosKm);
+                VecType::StoreAligned(heightFractionLanes, GetHeightFraction(constants, rayWorldPosKm));
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    const float positionKm[3] = { positionLanes[0][lane], positionLanes[1][lane], positionLanes[2][lane] };
+                    float uvw[3];
+                    const bool isInVolume = integratingLanes[lane]
+                        && textures.m_opticalDepthVolume->GetUVW(positionKm, heightFractionLanes[lane], uvw);
+                    opticalDepthLanes[lane] = isInVolume ? textures.m_opticalDepthVolume->Sample(uvw) : 0.0f;
+                    coneSamplingLanes[lane] = integratingLanes[lane] && !isInVolume;
+                }
+                opticalDepth = VecType::LoadAligned(opticalDepthLanes);
+            }
+            else
+            {
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    coneSamplingLanes[lane] = integratingLanes[lane];
+                }
+            }
+
+            float distanceMultiplier = 1.0f; // Makes sure we sample in increasing step length increments.
+            for (int stepIdx = 0; stepIdx < numLightSamples; stepIdx++)
+            {
+                // The cone directions are the same for all the rays.
+                float randomDirection[3];
+                for (uint32_t axis = 0; axis < 3; axis++)
+                {
+                    randomDirection[axis] = constants.m_directionTowardsTheSun[axis] + NoiseKernel[stepIdx][axis] * 0.1f;
+                }
+                const float invLength = 1.0f / std::sqrt(randomDirection[0] * randomDirection[0]
+                    + randomDirection[1] * randomDirection[1] + randomDirection[2] * randomDirection[2]);
+
+                const FloatType lightStepDistance = VecType::Mul(stepSizeKm, VecType::Splat(distanceMultiplier));
+                const Float3 posInConeKm = Add3(rayWorldPosKm,
+                    Scale(Splat3(randomDirection[0] * invLength, randomDirection[1] * invLength, randomDirection[2] * invLength), lightStepDistance));
+                const FloatType heightFraction = GetHeightFraction(constants, posInConeKm);
+
+                // Only if we are inside the cloud formation spherical slab, we'll do calculations.
+                alignas(16) float heightFractionLanes[LaneCount];
+                VecType::StoreAligned(heightFractionLanes, heightFraction);
+                bool sampleLanes[LaneCount];
+                bool anySample = false;
+                for (uint32_t lane = 0; lane < LaneCount; lane++)
+                {
+                    sampleLanes[lane] = coneSamplingLanes[lane] && (heightFractionLanes[lane] <= 1.0f);
+                    anySample = anySample || sampleLanes[lane];
+                }
+                if (anySample)
+                {
+                    // Always sample cheaply.
+                    const FloatType sampledCloudDensity = SampleCloudDensity(constants, textures, posInConeKm, uvwScale,
+                        VecType::Splat(static_cast<float>(stepIdx)), heightFraction, sampleLanes, noHighFreqNoise);
+                    const FloatType stepOpticalDepth = VecType::Mul(VecType::Mul(VecType::Max(sampledCloudDensity, VecType::ZeroFloat()),
+                        lightStepDistance), VecType::Splat(eCoef));
+                    opticalDepth = SelectLanes(sampleLanes, VecType::Add(opticalDepth, stepOpticalDepth), opticalDepth);
+                }
+
+                distanceMultiplier *= 2.0f; // Doubling at each step makes a huge difference.
+            }
+
+            const float sunColor[3] = {
+                constants.m_sunColorAndIntensity[0] * constants.m_sunColorAndIntensity[3],
+                constants.m_sunColorAndIntensity[1] * constants.m_sunColorAndIntensity[3],
+                constants.m_sunColorAndIntensity[2] * constants.m_sunColorAndIntensity[3],
+            };
+            // The cosine between the view and the sun is the same for all the octaves.
+            const FloatType cosAngle = Dot(Splat3(constants.m_directionTowardsTheSun[0], constants.m_directionTowardsTheSun[1],
+                constants.m_directionTowardsTheSun[2]), viewDirection);
+
+            Float3 luminance = Splat3(0.0f, 0.0f, 0.0f);
+            float powABC[3] = { 1.0f, 1.0f, 1.0f };
+            for (uint32_t octave = 0; octave < constants.m_maxOctaves; octave++)
+            {
+                // Beer Law
+                const FloatType attenuatedTransmittance = ExpPerLane(VecType::Mul(VecType::Splat(-powABC[0]), opticalDepth));
+                const float scatteringContribution = constants.m_sCoef * powABC[1];
+                const FloatType dualLobeHG = CalcDualLobePhaseFunction(constants, cosAngle, powABC[2]);
+
+                const FloatType octaveScale = VecType::Mul(dualLobeHG, attenuatedTransmittance);
+                luminance.m_x = VecType::Add(luminance.m_x, VecType::Mul(VecType::Splat(scatteringContribution * sunColor[0]), octaveScale));
+                luminance.m_y = VecType::Add(luminance.m_y, VecType::Mul(VecType::Splat(scatteringContribution * sunColor[1]), octaveScale));
+                luminance.m_z = VecType::Add(luminance.m_z, VecType::Mul(VecType::Splat(scatteringContribution * sunColor[2]), octaveScale));
+
+                for (uint32_t component = 0; component < 3; component++)
+                {
+                    powABC[component] *= constants.m_multipleScatteringABC[component];
+                }
+            }
+            return luminance;
+        }
+
+    private:
+        //////////////////////////////////////////////////////////////////
+        // PassSrg functions START
+        static Float3 ApplyWindEffect(const CloudscapeRaymarchConstants& constants, const Float3& worldPosKm, const FloatType& heightFraction)
+        {
+            // Skew in wind direction.
+            const Float3 skew = Scale(Splat3(constants.m_windDirection[0] * constants.m_cloudTopOffsetKm,
+                constants.m_windDirection[1] * constants.m_cloudTopOffsetKm, constants.m_windDirection[2] * constants.m_cloudTopOffsetKm), heightFraction);
+            // Animate clouds in wind direction with a small bias upwards.
+            const float windDistanceKm = constants.m_timeSeconds * constants.m_windSpeedKmPerSec;
+            const Float3 windOffset = Splat3(constants.m_windDirection[0] * windDistanceKm, constants.m_windDirection[1] * windDistanceKm,
+                (constants.m_windDirection[2] + 0.1f) * windDistanceKm);
+            return Add3(Add3(worldPosKm, skew), windOffset);
+        }
+
+        static Float3 GetAmbientLightColor(const CloudscapeRaymarchConstants& constants, const FloatType& heightFraction)
+        {
+            const float ambientIntensity = constants.m_ambientLightColorAndIntensity[3] * constants.m_sunColorAndIntensity[3];
+            float ambientColor[3];
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                ambientColor[channel] = constants.m_ambientLightColorAndIntensity[channel] * constants.m_sunColorAndIntensity[channel] * ambientIntensity;
+            }
+            const FloatType t = Saturate(heightFraction);
+            return {
+                Lerp(VecType::Splat(ambientColor[0]), VecType::Splat(ambientColor[0] * 10.0f), t),
+                Lerp(VecType::Splat(ambientColor[1]), VecType::Splat(ambientColor[1] * 10.0f), t),
+                Lerp(VecType::Splat(ambientColor[2]), VecType::Splat(ambientColor[2] * 10.0f), t),
+            };
+        }
+
+        static FloatType CalcHenyeyGreenstein(const FloatType& cosAngle, float g)
+        {
+            static constexpr float Inv4Pi = 1.0f / (4.0f * 3.141590f);
+            const float g2 = g * g;
+            const FloatType denom = VecType::Sub(VecType::Splat(1.0f + g2), VecType::Mul(VecType::Splat(2.0f * g), cosAngle));
+            // We are doing denom*denom*sqrt(denom) instead of pow(denom, 1.5)
+            const FloatType denom15 = VecType::Mul(VecType::Mul(denom, denom), VecType::Sqrt(denom));
+            return VecType::Mul(VecType::Div(VecType::Splat(1.0f - g2), denom15), VecType::Splat(Inv4Pi));
+        }
+
+        // @excentricityAttenuationOctave is the value of c^i, where i is the octave number.
+        static FloatType CalcDualLobePhaseFunction(const CloudscapeRaymarchConstants& constants, const FloatType& cosAngle,
+            float excentricityAttenuationOctave)
+        {
+            const FloatType forwardPhase = CalcHenyeyGreenstein(cosAngle, excentricityAttenuationOctave * constants.m_henyeyGreensteinG);
+            if (constants.m_dualLobePhaseFunctionWeight == 0.0f)
+            {
+                return forwardPhase;
+            }
+            const float backwardG = -constants.m_henyeyGreensteinG * 0.25f;
+            const FloatType backwardPhase = CalcHenyeyGreenstein(cosAngle, excentricityAttenuationOctave * backwardG);
+            return Lerp(forwardPhase, backwardPhase, VecType::Splat(constants.m_dualLobePhaseFunctionWeight));
+        }
+        // PassSrg functions END
+        //////////////////////////////////////////////////////////////////
+
+        // Same as SampleShapeNoise() for the gathered channels of the low frequency texture.
+        static FloatType GetShapeNoise(CloudTextureChannelLayout channelLayout, const float (&lowFreqNoise)[4][LaneCount])
+        {
+            if (channelLayout == CloudTextureChannelLayout::RGBA8)
+            {
+                const FloatType lowFreqFBM = VecType::Add(VecType::Add(
+                    VecType::Mul(VecType::LoadAligned(lowFreqNoise[1]), VecType::Splat(0.625f)),
+                    VecType::Mul(VecType::LoadAligned(lowFreqNoise[2]), VecType::Splat(0.25f))),
+                    VecType::Mul(VecType::LoadAligned(lowFreqNoise[3]), VecType::Splat(0.125f)));
+                return Remap(VecType::LoadAligned(lowFreqNoise[0]), VecType::Sub(lowFreqFBM, VecType::Splat(1.0f)),
+                    VecType::Splat(1.0f), VecType::ZeroFloat(), VecType::Splat(1.0f));
+            }
+            // The other layouts were remapped by CloudTextureCS.azsl.
+            return VecType::LoadAligned(lowFreqNoise[0]);
+        }
+
+        // Same as SampleDetailNoise() for the gathered channels of the high frequency texture.
+        static FloatType GetDetailNoise(CloudTextureChannelLayout channelLayout, const float (&highFreqNoise)[4][LaneCount])
+        {
+            if (channelLayout == CloudTextureChannelLayout::RGBA8)
+            {
+                return VecType::Add(VecType::Add(
+                    VecType::Mul(VecType::LoadAligned(highFreqNoise[1]), VecType::Splat(0.625f)),
+                    VecType::Mul(VecType::LoadAligned(highFreqNoise[2]), VecType::Splat(0.25f))),
+                    VecType::Mul(VecType::LoadAligned(highFreqNoise[3]), VecType::Splat(0.125f)));
+            }
+            if (channelLayout == CloudTextureChannelLayout::RG8)
+            {
+                return VecType::LoadAligned(highFreqNoise[1]);
+            }
+            // The single channel layouts have no detail noise, and are rejected as high frequency noise.
+            return VecType::ZeroFloat();
+        }
+
+        // Same as GetJitterOffset(), "interleaved gradient noise" by Jorge Jimenez.
+        static float GetJitterOffset(float pixelX, float pixelY)
+        {
+            const float dotValue = pixelX * 0.067110560f + pixelY * 0.00583715f;
+            const float innerFrac = dotValue - std::floor(dotValue);
+            const float outer = 52.9829189f * innerFrac;
+            return -1.0f + 2.0f * (outer - std::floor(outer));
+        }
+
+        static float Remap(float value, float oldMin, float oldMax, float newMin, float newMax)
+        {
+            return (((value - oldMin) / (oldMax - oldMin)) * (newMax - newMin)) + newMin;
+        }
+
+        //////////////////////////////////////////////////////////////////
+        // FloatType helpers START
+        static FloatType Remap(const FloatType& value, const FloatType& oldMin, const FloatType& oldMax, const FloatType& newMin, const FloatType& newMax)
+        {
+            return VecType::Add(VecType::Mul(VecType::Div(VecType::Sub(value, oldMin), VecType::Sub(oldMax, oldMin)), VecType::Sub(newMax, newMin)), newMin);
+        }
+
+        // Same as HLSL saturate(), which also maps NaN to 0. Remap() divides by zero when
+        // the peak height or the coverage of the weather map are zero.
+        static FloatType Saturate(const FloatType& value)
+        {
+            const FloatType notNaN = VecType::And(VecType::CmpEq(value, value), value);
+            return VecType::Min(VecType::Max(notNaN, VecType::ZeroFloat()), VecType::Splat(1.0f));
+        }
+
+        static FloatType Lerp(const FloatType& a, const FloatType& b, const FloatType& t)
+        {
+            return VecType::Add(a, VecType::Mul(VecType::Sub(b, a), t));
+        }
+
+        // AZ::Simd only has an estimate of exp(), which is not accurate enough for a reference.
+        static FloatType ExpPerLane(const FloatType& value)
+        {
+            alignas(16) float lanes[LaneCount];
+            VecType::StoreAligned(lanes, value);
+            for (float& lane : lanes)
+            {
+                lane = std::exp(lane);
+            }
+            return VecType::LoadAligned(lanes);
+        }
+
+        // Picks @a for the lanes in @lanes, and @b for the others.
+        static FloatType SelectLanes(const bool (&lanes)[LaneCount], const FloatType& a, const FloatType& b)
+        {
+            alignas(16) float aLanes[LaneCount];
+            alignas(16) float bLanes[LaneCount];
+            VecType::StoreAligned(aLanes, a);
+            VecType::StoreAligned(bLanes, b);
+            for (uint32_t lane = 0; lane < LaneCount; lane++)
+            {
+                bLanes[lane] = lanes[lane] ? aLanes[lane] : bLanes[lane];
+            }
+            return VecType::LoadAligned(bLanes);
+        }
+        // FloatType helpers END
+        //////////////////////////////////////////////////////////////////
+
+        //////////////////////////////////////////////////////////////////
+        // Float3 helpers START
+        static Float3 Splat3(float x, float y, float z)
+        {
+            return { VecType::Splat(x), VecType::Splat(y), VecType::Splat(z) };
+        }
+
+        static Float3 Load3(const float (&lanes)[3][LaneCount])
+        {
+            return { VecType::LoadAligned(lanes[0]), VecType::LoadAligned(lanes[1]), VecType::LoadAligned(lanes[2]) };
+        }
+
+        static void Store3(float (&lanes)[3][LaneCount], const Float3& a)
+        {
+            VecType::StoreAligned(lanes[0], a.m_x);
+            VecType::StoreAligned(lanes[1], a.m_y);
+            VecType::StoreAligned(lanes[2], a.m_z);
+        }
+
+        static Float3 Add3(const Float3& a, const Float3& b)
+        {
+            return { VecType::Add(a.m_x, b.m_x), VecType::Add(a.m_y, b.m_y), VecType::Add(a.m_z, b.m_z) };
+        }
+
+        static Float3 Scale(const Float3& a, const FloatType& s)
+        {
+            return { VecType::Mul(a.m_x, s), VecType::Mul(a.m_y, s), VecType::Mul(a.m_z, s) };
+        }
+
+        static FloatType Dot(const Float3& a, const Float3& b)
+        {
+            return VecType::Add(VecType::Add(VecType::Mul(a.m_x, b.m_x), VecType::Mul(a.m_y, b.m_y)), VecType::Mul(a.m_z, b.m_z));
+        }
+        // Float3 helpers END
+        //////////////////////////////////////////////////////////////////
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,56 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/std/algorithm.h>
+
+#include "CloudscapeRaymarchTiles.h"
+
+namespace VolumetricClouds
+{
+    uint32_t CloudscapeRaymarchTiles::GetTileCount(uint32_t outputSize, uint32_t blockSize)
+    {
+        // One thread per block, one group per tile.
+        const uint32_t blockCount = (outputSize + blockSize - 1) / blockSize;
+        return (blockCount + TileSize - 1) / TileSize;
+    }
+
+    uint32_t CloudscapeRaymarchTiles::PackTileLocation(uint32_t tileX, uint32_t tileY)
+    {
+        return (tileY << 16) | (tileX & 0xFFFF);
+    }
+
+    void CloudscapeRaymarchTiles::UnpackTileLocation(uint32_t packedTile, uint32_t& tileX, uint32_t& tileY)
+    {
+        tileX = packedTile & 0xFFFF;
+        tileY = packedTile >> 16;
+    }
+
+    void CloudscapeRaymarchTiles::TileBounds::AddPixel(bool reachesSlab, float distanceToSlabKm, float distanceToGeometryKm, bool wasOccluded)
+    {
+        if (!reachesSlab)
+        {
+            return;
+        }
+        m_anyRayReachesSlab = true;
+        m_minDistanceToSlabKm = AZStd::min(m_minDistanceToSlabKm, distanceToSlabKm);
+        m_maxDistanceToGeometryKm = AZStd::max(m_maxDistanceToGeometryKm, distanceToGeometryKm);
+        m_anyRayWasVisible = m_anyRayWasVisible || !wasOccluded;
+    }
+
+    bool CloudscapeRaymarchTiles::TileBounds::IsLive(bool cullOccluded) const
+    {
+        if (!m_anyRayReachesSlab)
+        {
+            return false;
+        }
+        // A tile hidden in this frame, but not in the previous one, is still ray marched, so the reprojection
+        // doesn't keep stale clouds where the geometry moved.
+        const bool isOccluded = (m_maxDistanceToGeometryKm <= m_minDistanceToSlabKm) && !m_anyRayWasVisible;
+        return !cullOccluded || !isOccluded;
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,58 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/base.h>
+
+namespace VolumetricClouds
+{
+    // CPU side of the tile classification done by CloudscapeTileClassificationCS.azsl.
+    // A tile is one thread group of CloudscapeCS.azsl: TileSize x TileSize blocks of the update pattern,
+    // see CloudscapeUpdatePattern. Only the pixel ray marched in the current frame of each block is classified.
+    // The live tiles are appended to a list, and CloudscapeCS.azsl is dispatched indirectly, one group per live tile.
+    class CloudscapeRaymarchTiles final
+    {
+    public:
+        // Same as TILE_SIZE, the numthreads of CloudscapeCS.azsl and CloudscapeTileClassificationCS.azsl.
+        static constexpr uint32_t TileSize = 8;
+        // Same as SKY_DISTANCE_KM, the distance to the geometry of the pixels that only see the sky.
+        static constexpr float SkyDistanceKm = 1.0e30f;
+
+        // Number of tiles along one side of the output, of @outputSize pixels, when it is updated in blocks of @blockSize pixels.
+        static uint32_t GetTileCount(uint32_t outputSize, uint32_t blockSize);
+
+        // Same as PackTileLocation() and UnpackTileLocation(), the entries of the tile list.
+        static uint32_t PackTileLocation(uint32_t tileX, uint32_t tileY);
+        static void UnpackTileLocation(uint32_t packedTile, uint32_t& tileX, uint32_t& tileY);
+
+        // Conservative bounds of a tile, accumulated one ray marched pixel at a time.
+        // Same as the group shared reduction of CloudscapeTileClassificationCS.azsl.
+        struct TileBounds
+        {
+            // @reachesSlab is false for the pixels where GetCloudSlabIntersections() returns false,
+            // the ray goes below the horizon or misses the slab. In that case the other arguments are ignored.
+            // @wasOccluded is true if the geometry hid the slab entry of the ray in the previous frame,
+            // see WasCloudSlabEntryOccluded().
+            void AddPixel(bool reachesSlab, float distanceToSlabKm, float distanceToGeometryKm, bool wasOccluded);
+
+            // Returns false if no ray reaches the slab or, when @cullOccluded is true, if the farthest
+            // geometry of the tile is closer than the nearest entry in the slab and every ray was
+            // occluded in the previous frame too. @cullOccluded is true for CloudscapeOccludedPixelPolicy::Skip.
+            bool IsLive(bool cullOccluded) const;
+
+            bool m_anyRayReachesSlab = false;
+            // Nearest entry in the slab, of the rays that reach it.
+            float m_minDistanceToSlabKm = SkyDistanceKm;
+            // Farthest geometry, of the rays that reach the slab.
+            float m_maxDistanceToGeometryKm = 0.0f;
+            // True if the slab entry of any ray that reaches the slab was visible in the previous frame.
+            bool m_anyRayWasVisible = false;
+        };
+    };
+
+} // namespace VolumetricClouds
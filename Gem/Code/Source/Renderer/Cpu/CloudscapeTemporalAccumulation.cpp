@@ -0,0 +1,110 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Math/MathUtils.h>
+#include <AzCore/std/algorithm.h>
+
+#include "CloudscapeTemporalAccumulation.h"
+
+namespace VolumetricClouds
+{
+    void CloudscapeTemporalAccumulation::NeighborhoodBox::AddSample(const AZ::Vector4& rgba)
+    {
+        const AZ::Vector4 yCoCgA = RgbaToYCoCgA(rgba);
+        if (!m_isValid)
+        {
+            m_min = yCoCgA;
+            m_max = yCoCgA;
+            m_isValid = true;
+            return;
+        }
+        m_min = m_min.GetMin(yCoCgA);
+        m_max = m_max.GetMax(yCoCgA);
+    }
+
+    AZ::Vector4 CloudscapeTemporalAccumulation::RgbaToYCoCgA(const AZ::Vector4& rgba)
+    {
+        const float r = rgba.GetX();
+        const float g = rgba.GetY();
+        const float b = rgba.GetZ();
+        return AZ::Vector4(0.25f * r + 0.5f * g + 0.25f * b, 0.5f * r - 0.5f * b, -0.25f * r + 0.5f * g - 0.25f * b, rgba.GetW());
+    }
+
+    AZ::Vector4 CloudscapeTemporalAccumulation::YCoCgAToRgba(const AZ::Vector4& yCoCgA)
+    {
+        const float y = yCoCgA.GetX();
+        const float co = yCoCgA.GetY();
+        const float cg = yCoCgA.GetZ();
+        return AZ::Vector4(y + co - cg, y + cg, y - co - cg, yCoCgA.GetW());
+    }
+
+    uint32_t CloudscapeTemporalAccumulation::GetHistorySampleCount(float confidence)
+    {
+        const float sampleCount = std::floor(AZStd::clamp(confidence, 0.0f, 1.0f) * MaxHistorySamples + 0.5f);
+        return static_cast<uint32_t>(sampleCount);
+    }
+
+    float CloudscapeTemporalAccumulation::GetRejectedConfidence(float confidence, const AZ::Vector4& historyYCoCgA,
+        const AZ::Vector4& clampedHistoryYCoCgA)
+    {
+        const float clampDistance = (historyYCoCgA - clampedHistoryYCoCgA).GetLength();
+        return confidence * AZStd::clamp(1.0f - clampDistance * HistoryRejectionScale, 0.0f, 1.0f);
+    }
+
+    float CloudscapeTemporalAccumulation::GetBlendWeight(float confidence, float blendFactor)
+    {
+        const float sampleCount = static_cast<float>(GetHistorySampleCount(confidence));
+        return AZStd::max(blendFactor, 1.0f / (sampleCount + 1.0f));
+    }
+
+    CloudscapeTemporalAccumulation::Pixel CloudscapeTemporalAccumulation::ResolveRayMarchedPixel(const AZ::Vector4& freshRgba,
+        const NeighborhoodBox& box, bool hasHistory, const Pixel& history, float blendFactor)
+    {
+        Pixel result;
+        if (!hasHistory)
+        {
+            result.m_rgba = freshRgba;
+            result.m_confidence = 1.0f / MaxHistorySamples;
+            return result;
+        }
+
+        const AZ::Vector4 historyYCoCgA = RgbaToYCoCgA(history.m_rgba);
+        const AZ::Vector4 clampedHistoryYCoCgA = historyYCoCgA.GetClamp(box.m_min, box.m_max);
+        const float confidence = GetRejectedConfidence(history.m_confidence, historyYCoCgA, clampedHistoryYCoCgA);
+
+        const float blendWeight = GetBlendWeight(confidence, blendFactor);
+        const AZ::Vector4 resolvedYCoCgA = clampedHistoryYCoCgA.Lerp(RgbaToYCoCgA(freshRgba), blendWeight);
+        result.m_rgba = YCoCgAToRgba(resolvedYCoCgA);
+        const uint32_t sampleCount = AZStd::min(GetHistorySampleCount(confidence) + 1, MaxHistorySamples);
+        result.m_confidence = static_cast<float>(sampleCount) / MaxHistorySamples;
+        return result;
+    }
+
+    CloudscapeTemporalAccumulation::Pixel CloudscapeTemporalAccumulation::ResolveReprojectedPixel(const NeighborhoodBox& box,
+        bool hasHistory, const Pixel& history, const AZ::Vector4& fallbackRgba)
+    {
+        Pixel result;
+        if (!hasHistory)
+        {
+            result.m_rgba = fallbackRgba;
+            result.m_confidence = 0.0f;
+            return result;
+        }
+        if (!box.m_isValid)
+        {
+            // No fresh pixel around, e.g. blocks partially outside of the screen.
+            return history;
+        }
+
+        const AZ::Vector4 historyYCoCgA = RgbaToYCoCgA(history.m_rgba);
+        const AZ::Vector4 clampedHistoryYCoCgA = historyYCoCgA.GetClamp(box.m_min, box.m_max);
+        result.m_rgba = YCoCgAToRgba(clampedHistoryYCoCgA);
+        result.m_confidence = GetRejectedConfidence(history.m_confidence, historyYCoCgA, clampedHistoryYCoCgA);
+        return result;
+    }
+
+} // namespace VolumetricClouds
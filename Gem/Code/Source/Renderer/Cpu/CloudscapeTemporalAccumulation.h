@@ -0,0 +1,72 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/Math/Vector4.h>
+
+namespace VolumetricClouds
+{
+    // CPU implementation of CloudscapeTemporalAccumulation.azsli, the temporal accumulation of the cloudscape.
+    // Each frame CloudscapeCS.azsl blends the freshly ray marched pixel of each block with its history, the
+    // previous frame reprojected, and CloudscapeReprojectionCS.azsl reprojects the history of the other pixels.
+    // Before being used, the history is clamped to the box, in YCoCg and alpha, of the fresh pixels around it.
+    // So the jitter noise of the ray marching is averaged over time, without ghosting when the clouds change.
+    // Each pixel also has a history confidence, the number of samples accumulated in it divided by MaxHistorySamples,
+    // stored in the history confidence attachments owned by the CloudscapeFeatureProcessor.
+    // Colors are RGBA, and the RGB is converted to YCoCg for the clamping.
+    class CloudscapeTemporalAccumulation final
+    {
+    public:
+        // Same as HISTORY_MAX_SAMPLES. With 8 bits per confidence value, every sample count is stored exactly.
+        static constexpr uint32_t MaxHistorySamples = 32;
+        // Same as HISTORY_REJECTION_SCALE. When the clamping moves the history by 1 / HistoryRejectionScale,
+        // in YCoCg and alpha, the history is discarded.
+        static constexpr float HistoryRejectionScale = 4.0f;
+
+        // The axis aligned box, in YCoCg and alpha, of the fresh pixels around a pixel.
+        struct NeighborhoodBox
+        {
+            void AddSample(const AZ::Vector4& rgba);
+
+            AZ::Vector4 m_min;
+            AZ::Vector4 m_max;
+            bool m_isValid = false;
+        };
+
+        // The result of one pixel, and the confidence of the accumulated history.
+        struct Pixel
+        {
+            AZ::Vector4 m_rgba;
+            float m_confidence = 0.0f;
+        };
+
+        // Same as RgbaToYCoCgA() and YCoCgAToRgba(). Alpha is kept as is.
+        static AZ::Vector4 RgbaToYCoCgA(const AZ::Vector4& rgba);
+        static AZ::Vector4 YCoCgAToRgba(const AZ::Vector4& yCoCgA);
+
+        // Same as GetHistorySampleCount(). Rounded, so it is exact after the 8 bits quantization.
+        static uint32_t GetHistorySampleCount(float confidence);
+
+        // Same as GetRejectedHistoryConfidence(). Both histories are in YCoCg and alpha.
+        static float GetRejectedConfidence(float confidence, const AZ::Vector4& historyYCoCgA, const AZ::Vector4& clampedHistoryYCoCgA);
+
+        // Same as GetHistoryBlendWeight(). The weight of the fresh pixel, at least 1 / (samples + 1), so the
+        // first samples are averaged evenly, and at least @blendFactor. With @blendFactor 1 there's no accumulation.
+        static float GetBlendWeight(float confidence, float blendFactor);
+
+        // Same as ResolveRayMarchedPixel(). @box contains @freshRgba.
+        static Pixel ResolveRayMarchedPixel(const AZ::Vector4& freshRgba, const NeighborhoodBox& box, bool hasHistory,
+            const Pixel& history, float blendFactor);
+
+        // Same as ResolveReprojectedPixel(). When there's no history, the pixel is @fallbackRgba, the
+        // fresh pixel of its block, with no confidence.
+        static Pixel ResolveReprojectedPixel(const NeighborhoodBox& box, bool hasHistory, const Pixel& history,
+            const AZ::Vector4& fallbackRgba);
+    };
+
+} // namespace VolumetricClouds
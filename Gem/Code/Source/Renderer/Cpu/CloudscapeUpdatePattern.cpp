@@ -0,0 +1,97 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/utils.h>
+
+#include "CloudscapeUpdatePattern.h"
+
+namespace VolumetricClouds
+{
+    namespace
+    {
+        // Squared distance between two pixels of a block, wrapping around the borders.
+        uint32_t GetWrappedDistanceSq(uint32_t pixelA, uint32_t pixelB, uint32_t blockSize)
+        {
+            const uint32_t ax = pixelA % blockSize;
+            const uint32_t ay = pixelA / blockSize;
+            const uint32_t bx = pixelB % blockSize;
+            const uint32_t by = pixelB / blockSize;
+            uint32_t dx = (ax > bx) ? (ax - bx) : (bx - ax);
+            uint32_t dy = (ay > by) ? (ay - by) : (by - ay);
+            dx = AZStd::min(dx, blockSize - dx);
+            dy = AZStd::min(dy, blockSize - dy);
+            return dx * dx + dy * dy;
+        }
+    }
+
+    bool CloudscapeUpdatePattern::IsValidBlockSize(uint32_t blockSize)
+    {
+        return ((blockSize >= 1) && (blockSize <= 4)) || (blockSize == 8);
+    }
+
+    bool CloudscapeUpdatePattern::Generate(uint32_t blockSize)
+    {
+        if (!IsValidBlockSize(blockSize))
+        {
+            return false;
+        }
+
+        const uint32_t pixelCount = blockSize * blockSize;
+        AZStd::vector<uint32_t> ordering;
+        ordering.reserve(pixelCount);
+        AZStd::vector<bool> isVisited(pixelCount, false);
+
+        // Always starts at the top left pixel.
+        ordering.push_back(0);
+        isVisited[0] = true;
+        while (ordering.size() < pixelCount)
+        {
+            uint32_t bestPixel = 0;
+            uint32_t bestMinDistanceSq = 0;
+            double bestEnergy = 0.0;
+            bool hasBest = false;
+            for (uint32_t pixel = 0; pixel < pixelCount; pixel++)
+            {
+                if (isVisited[pixel])
+                {
+                    continue;
+                }
+                uint32_t minDistanceSq = pixelCount * pixelCount;
+                double energy = 0.0;
+                for (uint32_t visitedPixel : ordering)
+                {
+                    const uint32_t distanceSq = GetWrappedDistanceSq(pixel, visitedPixel, blockSize);
+                    minDistanceSq = AZStd::min(minDistanceSq, distanceSq);
+                    energy += 1.0 / static_cast<double>(distanceSq);
+                }
+                if (!hasBest || (minDistanceSq > bestMinDistanceSq) ||
+                    ((minDistanceSq == bestMinDistanceSq) && (energy < bestEnergy)))
+                {
+                    bestPixel = pixel;
+                    bestMinDistanceSq = minDistanceSq;
+                    bestEnergy = energy;
+                    hasBest = true;
+                }
+            }
+            ordering.push_back(bestPixel);
+            isVisited[bestPixel] = true;
+        }
+
+        m_blockSize = blockSize;
+        m_ordering = AZStd::move(ordering);
+        return true;
+    }
+
+    void CloudscapeUpdatePattern::GetPixelOffset(uint32_t frameCounter, uint32_t& offsetX, uint32_t& offsetY) const
+    {
+        const uint32_t pixel = m_ordering[frameCounter % GetCycleLength()];
+        offsetX = pixel % m_blockSize;
+        offsetY = pixel / m_blockSize;
+    }
+
+} // namespace VolumetricClouds
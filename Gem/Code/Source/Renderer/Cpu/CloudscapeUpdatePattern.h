@@ -0,0 +1,50 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+
+namespace VolumetricClouds
+{
+    // Each frame, CloudscapeCS.azsl only ray marches one pixel of each N x N block of the screen,
+    // and CloudscapeReprojectionCS.azsl reprojects the other ones from the previous frame.
+    // This class generates the order in which the pixels of a block are ray marched, so that after
+    // N x N frames every pixel of the block was ray marched exactly once.
+    // The order is low discrepancy: each pixel is the farthest one, with wrap around so neighbor
+    // blocks are taken into account, from all the pixels ray marched before it in the cycle.
+    // Ties are broken by the lowest sum of inverse squared distances, then by the lowest pixel index.
+    // For 4x4 the first 4 frames cover a 2x2 lattice, the next 4 fill its centers, and so on, like a Bayer matrix.
+    class CloudscapeUpdatePattern final
+    {
+    public:
+        static constexpr uint32_t DefaultBlockSize = 4;
+
+        // Returns true for the block sizes exposed by CloudscapeShaderConstantData::m_updateBlockSize: 1, 2, 3, 4 and 8.
+        static bool IsValidBlockSize(uint32_t blockSize);
+
+        // Generates the order of a @blockSize x @blockSize block.
+        // Returns false, and keeps the current pattern, if @blockSize is not valid.
+        bool Generate(uint32_t blockSize);
+
+        uint32_t GetBlockSize() const { return m_blockSize; }
+
+        // Number of frames until every pixel of a block is ray marched. @blockSize * @blockSize.
+        uint32_t GetCycleLength() const { return static_cast<uint32_t>(m_ordering.size()); }
+
+        // The pixel index (y * blockSize + x), within the block, ray marched at each frame of the cycle.
+        const AZStd::vector<uint32_t>& GetOrdering() const { return m_ordering; }
+
+        // XY location, within the block, of the pixel ray marched at @frameCounter.
+        void GetPixelOffset(uint32_t frameCounter, uint32_t& offsetX, uint32_t& offsetY) const;
+
+    private:
+        uint32_t m_blockSize = 1;
+        AZStd::vector<uint32_t> m_ordering = { 0 };
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,123 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Math/MathUtils.h>
+#include <AzCore/std/algorithm.h>
+
+#include "CloudscapeUpsampleFilter.h"
+
+namespace VolumetricClouds
+{
+    uint32_t CloudscapeUpsampleFilter::GetReducedSize(uint32_t fullSize, uint32_t resolutionScale)
+    {
+        return AZStd::max((fullSize + resolutionScale - 1) / resolutionScale, 1u);
+    }
+
+    uint32_t CloudscapeUpsampleFilter::GetSourcePixel(uint32_t reducedLocation, uint32_t fullSize, uint32_t reducedSize)
+    {
+        return static_cast<uint32_t>((static_cast<uint64_t>(reducedLocation) * fullSize) / reducedSize);
+    }
+
+    CloudscapeUpsampleFilter::Footprint CloudscapeUpsampleFilter::GetFootprint(uint32_t pixelX, uint32_t pixelY,
+        uint32_t fullWidth, uint32_t fullHeight, uint32_t reducedWidth, uint32_t reducedHeight)
+    {
+        // The texel t sampled the depth at t / reducedSize, so the pixel p is at p * reducedSize / fullSize texels.
+        const float u = static_cast<float>(pixelX) * reducedWidth / fullWidth;
+        const float v = static_cast<float>(pixelY) * reducedHeight / fullHeight;
+        const uint32_t x0 = AZStd::min(static_cast<uint32_t>(u), reducedWidth - 1);
+        const uint32_t y0 = AZStd::min(static_cast<uint32_t>(v), reducedHeight - 1);
+        const uint32_t x1 = AZStd::min(x0 + 1, reducedWidth - 1);
+        const uint32_t y1 = AZStd::min(y0 + 1, reducedHeight - 1);
+        const float fx = u - static_cast<float>(x0);
+        const float fy = v - static_cast<float>(y0);
+
+        Footprint footprint;
+        footprint.m_texelX[0] = x0; footprint.m_texelY[0] = y0;
+        footprint.m_texelX[1] = x1; footprint.m_texelY[1] = y0;
+        footprint.m_texelX[2] = x0; footprint.m_texelY[2] = y1;
+        footprint.m_texelX[3] = x1; footprint.m_texelY[3] = y1;
+        footprint.m_bilinearWeights[0] = (1.0f - fx) * (1.0f - fy);
+        footprint.m_bilinearWeights[1] = fx * (1.0f - fy);
+        footprint.m_bilinearWeights[2] = (1.0f - fx) * fy;
+        footprint.m_bilinearWeights[3] = fx * fy;
+        return footprint;
+    }
+
+    float CloudscapeUpsampleFilter::GetDepthWeight(float pixelDistance, float texelDistance)
+    {
+        const float relativeDifference = std::abs(pixelDistance - texelDistance) / AZStd::max(pixelDistance, AZ::Constants::FloatEpsilon);
+        return std::exp(-DepthSharpness * relativeDifference);
+    }
+
+    void CloudscapeUpsampleFilter::GetWeights(const Footprint& footprint, float pixelDistance, const float texelDistances[4], float weights[4])
+    {
+        float totalWeight = 0.0f;
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            weights[i] = footprint.m_bilinearWeights[i] * GetDepthWeight(pixelDistance, texelDistances[i]);
+            totalWeight += weights[i];
+        }
+
+        if (totalWeight < MinTotalWeight)
+        {
+            // The pixel is on a silhouette that the reduced resolution missed. Take the closest texel.
+            uint32_t closestTexel = 0;
+            for (uint32_t i = 1; i < 4; i++)
+            {
+                if (std::abs(pixelDistance - texelDistances[i]) < std::abs(pixelDistance - texelDistances[closestTexel]))
+                {
+                    closestTexel = i;
+                }
+            }
+            for (uint32_t i = 0; i < 4; i++)
+            {
+                weights[i] = (i == closestTexel) ? 1.0f : 0.0f;
+            }
+            return;
+        }
+
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            weights[i] /= totalWeight;
+        }
+    }
+
+    void CloudscapeUpsampleFilter::Upsample(const AZStd::vector<float>& fullDistances, uint32_t fullWidth, uint32_t fullHeight,
+        const AZStd::vector<float>& reducedColors, uint32_t reducedWidth, uint32_t reducedHeight,
+        AZStd::vector<float>& fullColors)
+    {
+        fullColors.assign(static_cast<size_t>(fullWidth) * fullHeight * 4, 0.0f);
+        for (uint32_t y = 0; y < fullHeight; y++)
+        {
+            for (uint32_t x = 0; x < fullWidth; x++)
+            {
+                const Footprint footprint = GetFootprint(x, y, fullWidth, fullHeight, reducedWidth, reducedHeight);
+                float texelDistances[4];
+                for (uint32_t i = 0; i < 4; i++)
+                {
+                    const uint32_t sourceX = GetSourcePixel(footprint.m_texelX[i], fullWidth, reducedWidth);
+                    const uint32_t sourceY = GetSourcePixel(footprint.m_texelY[i], fullHeight, reducedHeight);
+                    texelDistances[i] = fullDistances[static_cast<size_t>(sourceY) * fullWidth + sourceX];
+                }
+
+                float weights[4];
+                GetWeights(footprint, fullDistances[static_cast<size_t>(y) * fullWidth + x], texelDistances, weights);
+
+                float* fullColor = &fullColors[(static_cast<size_t>(y) * fullWidth + x) * 4];
+                for (uint32_t i = 0; i < 4; i++)
+                {
+                    const float* reducedColor = &reducedColors[(static_cast<size_t>(footprint.m_texelY[i]) * reducedWidth + footprint.m_texelX[i]) * 4];
+                    for (uint32_t channel = 0; channel < 4; channel++)
+                    {
+                        fullColor[channel] += weights[i] * reducedColor[channel];
+                    }
+                }
+            }
+        }
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,61 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+
+namespace VolumetricClouds
+{
+    // CPU implementation of the joint bilateral upsample of Cloudscape.azsl, used when the cloudscape
+    // is ray marched and reprojected at a fraction of the viewport size, see CloudscapeResolutionScale.
+    // Each full resolution pixel blends the 2x2 reduced resolution texels around it. The bilinear weights are
+    // scaled by how close the distance to the geometry of each texel is to the one of the pixel, so the clouds
+    // don't bleed over the silhouettes of the geometry. The distance of a texel is the one of the full resolution
+    // pixel that CloudscapeCS.azsl sampled for it, the texel location times the full size, divided by the reduced size.
+    class CloudscapeUpsampleFilter final
+    {
+    public:
+        // Same as UPSAMPLE_DEPTH_SHARPNESS. The depth weight is exp(-DepthSharpness * relative distance difference).
+        static constexpr float DepthSharpness = 32.0f;
+        // Same as UPSAMPLE_MIN_TOTAL_WEIGHT. Below this total weight, no texel is similar enough to the pixel,
+        // and the texel with the closest distance is used alone.
+        static constexpr float MinTotalWeight = 1.0e-4f;
+
+        // The 2x2 texels, in the order (x0, y0), (x1, y0), (x0, y1), (x1, y1), and their bilinear weights.
+        struct Footprint
+        {
+            uint32_t m_texelX[4];
+            uint32_t m_texelY[4];
+            float m_bilinearWeights[4];
+        };
+
+        // Size of the reduced resolution outputs, for a viewport side of @fullSize pixels.
+        static uint32_t GetReducedSize(uint32_t fullSize, uint32_t resolutionScale);
+
+        // The full resolution pixel, along one side, where the texel @reducedLocation samples the depth.
+        // Same as a point sample at @reducedLocation / @reducedSize.
+        static uint32_t GetSourcePixel(uint32_t reducedLocation, uint32_t fullSize, uint32_t reducedSize);
+
+        // Same as GetUpsampleFootprint().
+        static Footprint GetFootprint(uint32_t pixelX, uint32_t pixelY, uint32_t fullWidth, uint32_t fullHeight,
+            uint32_t reducedWidth, uint32_t reducedHeight);
+
+        // Same as GetUpsampleDepthWeight(). Distances are from the camera to the geometry.
+        static float GetDepthWeight(float pixelDistance, float texelDistance);
+
+        // Same as GetUpsampleWeights(). Returns, in @weights, the normalized weight of each texel of @footprint.
+        static void GetWeights(const Footprint& footprint, float pixelDistance, const float texelDistances[4], float weights[4]);
+
+        // Upsamples the RGBA @reducedColors, one pixel at a time, the same as Cloudscape.azsl.
+        // @fullDistances has the distance to the geometry of each full resolution pixel.
+        static void Upsample(const AZStd::vector<float>& fullDistances, uint32_t fullWidth, uint32_t fullHeight,
+            const AZStd::vector<float>& reducedColors, uint32_t reducedWidth, uint32_t reducedHeight,
+            AZStd::vector<float>& fullColors);
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,556 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/Math/SimdMath.h>
+#include <AzCore/std/algorithm.h>
+
+#include "WorleyFeaturePointTable.h"
+
+namespace VolumetricClouds
+{
+    // There are two implementations of the Perlin-Worley noise in
+    // Shaders/CloudTexture/PerlinWorleyNoise.azsli. At the moment the shader
+    // is hard coded to use variant A.
+    enum class PerlinWorleyNoiseVariant : uint32_t
+    {
+        A, // PerlinWorleyNoise_A/*.azsli
+        B, // PerlinWorleyNoise_B/*.azsli
+    };
+
+    // All the parameters used by the noise FBMs, already clamped
+    // the same way CloudTextureCS.azsl clamps them.
+    struct PerlinWorleyNoiseParameters
+    {
+        float m_frequency = 4.0f;
+        int m_perlinOctaves = 7;
+        float m_perlinGain = 0.5504f;
+        float m_perlinAmplitude = 1.0f;
+        int m_worleyOctaves = 3;
+        float m_worleyGain = 0.45f;
+        float m_worleyAmplitude = 0.625f;
+    };
+
+    // CPU port of the noise functions in Shaders/CloudTexture/PerlinWorleyNoise.azsli
+    // and its variants A and B.
+    // The functions are templated on an AZ::Simd vector type, so each lane of the vector
+    // is an independent voxel. Use AZ::Simd::Vec4 to evaluate four voxels per instruction,
+    // or AZ::Simd::Vec1 to evaluate one voxel at a time. Both produce the same value
+    // for a given voxel because each lane runs the exact same sequence of operations.
+    template<typename VecType, PerlinWorleyNoiseVariant Variant>
+    class PerlinWorleyNoiseKernels final
+    {
+    public:
+        using FloatType = typename VecType::FloatType;
+        using IntType = typename VecType::IntType;
+        static constexpr uint32_t LaneCount = VecType::ElementCount;
+
+        struct Float3
+        {
+            FloatType m_x;
+            FloatType m_y;
+            FloatType m_z;
+        };
+
+        struct Float4
+        {
+            FloatType m_r;
+            FloatType m_g;
+            FloatType m_b;
+            FloatType m_a;
+        };
+
+        // Same as CloudTextureCS.azsl MainCS(). Returns the four channels of the cloud texture
+        // for each point in @input, where each coordinate is between 0.0 and 1.0.
+        // @worleyTables is optional. The Worley octaves whose period has a table read the feature points
+        // from it instead of hashing them, with the exact same result.
+        static Float4 CloudTextureChannels(const Float3& input, const PerlinWorleyNoiseParameters& params,
+            const WorleyFeaturePointTables* worleyTables = nullptr)
+        {
+            Float4 channels;
+            channels.m_r = PerlinWorleyNoise(input, params, worleyTables);
+            const Float3 triplet = WorleyNoiseFbmForCloudsTriplet(input, params.m_frequency,
+                params.m_worleyOctaves, params.m_worleyGain, params.m_worleyAmplitude, worleyTables);
+            channels.m_g = triplet.m_x;
+            channels.m_b = triplet.m_y;
+            channels.m_a = triplet.m_z;
+            return channels;
+        }
+
+        // @input has values between 0.0 and 1.0
+        static FloatType PerlinWorleyNoise(const Float3& input, const PerlinWorleyNoiseParameters& params,
+            const WorleyFeaturePointTables* worleyTables = nullptr)
+        {
+            FloatType perlinNoise = PerlinNoiseFbm(input, params.m_frequency, params.m_perlinOctaves, params.m_perlinGain, params.m_perlinAmplitude);
+            // By default noise color is biased towards black.
+            // let's change that.
+            perlinNoise = Lerp(VecType::Splat(1.0f), perlinNoise, VecType::Splat(0.5f));
+            perlinNoise = VecType::Abs(VecType::Sub(VecType::Mul(perlinNoise, VecType::Splat(2.0f)), VecType::Splat(1.0f)));
+
+            const FloatType worleyNoise = WorleyNoiseFbm(input, params.m_frequency, params.m_worleyOctaves, params.m_worleyGain, params.m_worleyAmplitude, worleyTables);
+            // Remap(perlinNoise, 0.0, 1.0, worleyNoise, 1.0)
+            const FloatType one = VecType::Splat(1.0f);
+            return VecType::Add(VecType::Mul(perlinNoise, VecType::Sub(one, worleyNoise)), worleyNoise);
+        }
+
+        // @input has values between 0.0 and 1.0
+        static Float3 WorleyNoiseFbmForCloudsTriplet(const Float3& input, float frequency, int octaves, float gain, float amplitude,
+            const WorleyFeaturePointTables* worleyTables = nullptr)
+        {
+            Float3 triplet;
+            triplet.m_x = WorleyNoiseFbm(input, frequency * 1.0f, octaves, gain, amplitude, worleyTables);
+            triplet.m_y = WorleyNoiseFbm(input, frequency * 2.0f, octaves, gain, amplitude, worleyTables);
+            triplet.m_z = WorleyNoiseFbm(input, frequency * 4.0f, octaves, gain, amplitude, worleyTables);
+            return triplet;
+        }
+
+        static FloatType PerlinNoiseFbm(const Float3& input, float frequency, int octaves, float gain, float amplitude)
+        {
+            FloatType total = VecType::ZeroFloat();
+            for (int i = 0; i < octaves; i++)
+            {
+                const FloatType noise = TileablePerlin3D(Scale(input, VecType::Splat(frequency)), VecType::Splat(frequency));
+                total = VecType::Add(total, VecType::Mul(noise, VecType::Splat(amplitude)));
+                frequency *= 2.0f;
+                amplitude *= gain;
+            }
+            return total;
+        }
+
+        static FloatType WorleyNoiseFbm(const Float3& input, float frequency, int octaves, float gain, float amplitude,
+            const WorleyFeaturePointTables* worleyTables = nullptr)
+        {
+            FloatType total = VecType::ZeroFloat();
+            for (int i = 0; i < octaves; i++)
+            {
+                const Float3 scaledInput = Scale(input, VecType::Splat(frequency));
+                const WorleyFeaturePointTable* table = worleyTables ? worleyTables->Find(frequency) : nullptr;
+                const FloatType noise = table ? WorleyNoise(scaledInput, *table) : WorleyNoise(scaledInput, VecType::Splat(frequency));
+                total = VecType::Add(total, VecType::Mul(noise, VecType::Splat(amplitude)));
+                amplitude *= gain;
+                frequency *= 2.0f;
+            }
+            return total;
+        }
+
+        // Dispatches to TileablePerlin3D (variant A) or TileableGradientNoise (variant B).
+        static FloatType TileablePerlin3D(const Float3& input, const FloatType& period)
+        {
+            if constexpr (Variant == PerlinWorleyNoiseVariant::A)
+            {
+                return TileablePerlin3D_A(input, period);
+            }
+            else
+            {
+                return TileableGradientNoise_B(input, period);
+            }
+        }
+
+        static FloatType WorleyNoise(const Float3& input, const FloatType& period)
+        {
+            if constexpr (Variant == PerlinWorleyNoiseVariant::A)
+            {
+                return WorleyNoise_A(input, period);
+            }
+            else
+            {
+                return WorleyNoise_B(input, period);
+            }
+        }
+
+        // Same as WorleyNoise(@input, period), but the feature points are read from @table,
+        // whose period must be the frequency of @input.
+        static FloatType WorleyNoise(const Float3& input, const WorleyFeaturePointTable& table)
+        {
+            const uint32_t period = table.GetPeriod();
+            const Float3 baseCell = Floor3(input);
+            alignas(16) float baseCellX[LaneCount];
+            alignas(16) float baseCellY[LaneCount];
+            alignas(16) float baseCellZ[LaneCount];
+            VecType::StoreAligned(baseCellX, baseCell.m_x);
+            VecType::StoreAligned(baseCellY, baseCell.m_y);
+            VecType::StoreAligned(baseCellZ, baseCell.m_z);
+
+            // For each lane, the first feature point of the 3x3x3 neighborhood. The padded cell
+            // (x, y, z) is the cell (x - 1, y - 1, z - 1), so it is the corner of the neighborhood of (x, y, z).
+            const WorleyFeaturePoint* neighborhoods[LaneCount];
+            const float maxCell = static_cast<float>(period - 1);
+            for (uint32_t lane = 0; lane < LaneCount; lane++)
+            {
+                // The inputs are between 0.0 and period, but the float rounding of input * frequency could
+                // land exactly on the period. The table has no padding for the neighborhood of that cell.
+                if (!(baseCellX[lane] >= 0.0f && baseCellX[lane] <= maxCell) ||
+                    !(baseCellY[lane] >= 0.0f && baseCellY[lane] <= maxCell) ||
+                    !(baseCellZ[lane] >= 0.0f && baseCellZ[lane] <= maxCell))
+                {
+                    return WorleyNoise(input, VecType::Splat(static_cast<float>(period)));
+                }
+                neighborhoods[lane] = table.GetFeaturePoints() + table.GetPaddedIndex(
+                    static_cast<uint32_t>(baseCellX[lane]), static_cast<uint32_t>(baseCellY[lane]), static_cast<uint32_t>(baseCellZ[lane]));
+            }
+
+            [[maybe_unused]] const Float3 fracCell = Sub3(input, baseCell);
+            alignas(16) float featurePointX[LaneCount];
+            alignas(16) float featurePointY[LaneCount];
+            alignas(16) float featurePointZ[LaneCount];
+            FloatType shortestDistance = VecType::Splat(10000.0f);
+            // Z outer, X inner, so consecutive reads are close in memory. The minimum doesn't depend on the order.
+            for (int iZ = -1; iZ <= 1; iZ++)
+            {
+                for (int iY = -1; iY <= 1; iY++)
+                {
+                    for (int iX = -1; iX <= 1; iX++)
+                    {
+                        const size_t neighborIndex = table.GetPaddedIndex(iX + 1, iY + 1, iZ + 1);
+                        for (uint32_t lane = 0; lane < LaneCount; lane++)
+                        {
+                            const WorleyFeaturePoint& featurePoint = neighborhoods[lane][neighborIndex];
+                            featurePointX[lane] = featurePoint.m_x;
+                            featurePointY[lane] = featurePoint.m_y;
+                            featurePointZ[lane] = featurePoint.m_z;
+                        }
+                        const Float3 featurePoint = {
+                            VecType::LoadAligned(featurePointX), VecType::LoadAligned(featurePointY), VecType::LoadAligned(featurePointZ) };
+                        const Float3 offset = Splat3(static_cast<float>(iX), static_cast<float>(iY), static_cast<float>(iZ));
+
+                        // The same operations, in the same order, as WorleyNoise_A() and WorleyNoise_B().
+                        Float3 deltaToCell;
+                        if constexpr (Variant == PerlinWorleyNoiseVariant::A)
+                        {
+                            const Float3 cellPosition = Add3(Add3(baseCell, offset), featurePoint);
+                            deltaToCell = Sub3(cellPosition, input);
+                        }
+                        else
+                        {
+                            const Float3 cellPosition = Add3(featurePoint, offset);
+                            deltaToCell = Sub3(fracCell, cellPosition);
+                        }
+                        shortestDistance = VecType::Min(shortestDistance, Dot(deltaToCell, deltaToCell));
+                    }
+                }
+            }
+            // Inverted Worley Noise for the Bubble Shape
+            return VecType::Sub(VecType::Splat(1.0f), shortestDistance);
+        }
+
+        // Calculates the feature points of the padded Z slices [firstPaddedZ, firstPaddedZ + paddedZCount) of @table.
+        static void FillWorleyFeaturePointTable(WorleyFeaturePointTable& table, uint32_t firstPaddedZ, uint32_t paddedZCount)
+        {
+            const uint32_t period = table.GetPeriod();
+            const uint32_t paddedSize = table.GetPaddedSize();
+            // Padded cell to tiled cell, the same value Mod3() returns for the integral cell coordinates.
+            auto tiledCoordinate = [period](uint32_t paddedCoordinate)
+            {
+                return static_cast<float>((paddedCoordinate + period - 1) % period);
+            };
+
+            alignas(16) float laneCoords[LaneCount];
+            alignas(16) float featurePointX[LaneCount];
+            alignas(16) float featurePointY[LaneCount];
+            alignas(16) float featurePointZ[LaneCount];
+            for (uint32_t z = firstPaddedZ; z < firstPaddedZ + paddedZCount; z++)
+            {
+                for (uint32_t y = 0; y < paddedSize; y++)
+                {
+                    WorleyFeaturePoint* row = table.GetFeaturePoints() + table.GetPaddedIndex(0, y, z);
+                    for (uint32_t x = 0; x < paddedSize; x += LaneCount)
+                    {
+                        // The lanes past the end of the row repeat the last cell and are discarded.
+                        for (uint32_t lane = 0; lane < LaneCount; lane++)
+                        {
+                            laneCoords[lane] = tiledCoordinate(AZStd::min(x + lane, paddedSize - 1));
+                        }
+                        Float3 tiledCell;
+                        tiledCell.m_x = VecType::LoadAligned(laneCoords);
+                        tiledCell.m_y = VecType::Splat(tiledCoordinate(y));
+                        tiledCell.m_z = VecType::Splat(tiledCoordinate(z));
+
+                        Float3 featurePoint;
+                        if constexpr (Variant == PerlinWorleyNoiseVariant::A)
+                        {
+                            featurePoint = Rand3dTo3d_A(tiledCell);
+                        }
+                        else
+                        {
+                            const FloatType half = VecType::Splat(0.5f);
+                            const Float3 hash = Hash33_B(tiledCell);
+                            featurePoint = {
+                                VecType::Add(VecType::Mul(hash.m_x, half), half),
+                                VecType::Add(VecType::Mul(hash.m_y, half), half),
+                                VecType::Add(VecType::Mul(hash.m_z, half), half),
+                            };
+                        }
+                        VecType::StoreAligned(featurePointX, featurePoint.m_x);
+                        VecType::StoreAligned(featurePointY, featurePoint.m_y);
+                        VecType::StoreAligned(featurePointZ, featurePoint.m_z);
+
+                        const uint32_t laneCount = AZStd::min(LaneCount, paddedSize - x);
+                        for (uint32_t lane = 0; lane < laneCount; lane++)
+                        {
+                            row[x + lane] = { featurePointX[lane], featurePointY[lane], featurePointZ[lane] };
+                        }
+                    }
+                }
+            }
+        }
+
+        //////////////////////////////////////////////////////////////////
+        // Float3 helpers START
+        static Float3 Splat3(float x, float y, float z)
+        {
+            return { VecType::Splat(x), VecType::Splat(y), VecType::Splat(z) };
+        }
+
+        static Float3 Add3(const Float3& a, const Float3& b)
+        {
+            return { VecType::Add(a.m_x, b.m_x), VecType::Add(a.m_y, b.m_y), VecType::Add(a.m_z, b.m_z) };
+        }
+
+        static Float3 Sub3(const Float3& a, const Float3& b)
+        {
+            return { VecType::Sub(a.m_x, b.m_x), VecType::Sub(a.m_y, b.m_y), VecType::Sub(a.m_z, b.m_z) };
+        }
+
+        static Float3 Scale(const Float3& a, const FloatType& s)
+        {
+            return { VecType::Mul(a.m_x, s), VecType::Mul(a.m_y, s), VecType::Mul(a.m_z, s) };
+        }
+
+        static Float3 Floor3(const Float3& a)
+        {
+            return { VecType::Floor(a.m_x), VecType::Floor(a.m_y), VecType::Floor(a.m_z) };
+        }
+
+        static FloatType Dot(const Float3& a, const Float3& b)
+        {
+            return VecType::Add(VecType::Add(VecType::Mul(a.m_x, b.m_x), VecType::Mul(a.m_y, b.m_y)), VecType::Mul(a.m_z, b.m_z));
+        }
+
+        static FloatType Frac(const FloatType& v)
+        {
+            return VecType::Sub(v, VecType::Floor(v));
+        }
+
+        static FloatType Lerp(const FloatType& a, const FloatType& b, const FloatType& t)
+        {
+            return VecType::Add(a, VecType::Mul(VecType::Sub(b, a), t));
+        }
+
+        // Same as glsl mod(), aka x - y * floor(x/y).
+        // For the integral cell coordinates used by the noise functions, this is also
+        // equivalent to modulo() in Common_A.azsli.
+        static Float3 Mod3(const Float3& x, const FloatType& y)
+        {
+            return {
+                VecType::Sub(x.m_x, VecType::Mul(y, VecType::Floor(VecType::Div(x.m_x, y)))),
+                VecType::Sub(x.m_y, VecType::Mul(y, VecType::Floor(VecType::Div(x.m_y, y)))),
+                VecType::Sub(x.m_z, VecType::Mul(y, VecType::Floor(VecType::Div(x.m_z, y)))),
+            };
+        }
+
+        // 6t^5 - 15t^4 + 10t^3
+        static FloatType Fade(const FloatType& t)
+        {
+            const FloatType poly = VecType::Add(VecType::Mul(t, VecType::Sub(VecType::Mul(t, VecType::Splat(6.0f)), VecType::Splat(15.0f))), VecType::Splat(10.0f));
+            return VecType::Mul(VecType::Mul(VecType::Mul(t, t), t), poly);
+        }
+        // Float3 helpers END
+        //////////////////////////////////////////////////////////////////
+
+        //////////////////////////////////////////////////////////////////
+        // Variant A START
+        // See Common_A.azsli
+        static FloatType Rand3dTo1d_A(const Float3& smallValue, float dirX, float dirY, float dirZ)
+        {
+            static constexpr float Seed = 143758.5453f;
+            const FloatType random = Dot(smallValue, Splat3(dirX, dirY, dirZ));
+            return Frac(VecType::Mul(VecType::Sin(random), VecType::Splat(Seed)));
+        }
+
+        static Float3 Rand3dTo3d_A(const Float3& seedVector)
+        {
+            // make value smaller to avoid artefacts.
+            // Shared by the three components.
+            const Float3 smallValue = { VecType::Sin(seedVector.m_x), VecType::Sin(seedVector.m_y), VecType::Sin(seedVector.m_z) };
+            return {
+                Rand3dTo1d_A(smallValue, 12.989f, 78.233f, 37.719f),
+                Rand3dTo1d_A(smallValue, 39.346f, 11.135f, 83.155f),
+                Rand3dTo1d_A(smallValue, 73.156f, 52.235f, 09.151f),
+            };
+        }
+
+        // See TileablePerlinNoise_A.azsli
+        static FloatType TileablePerlin3D_A(const Float3& input, const FloatType& period)
+        {
+            const Float3 baseCell = Floor3(input);
+            const Float3 fraction = Sub3(input, baseCell);
+            const Float3 interpolator = { Fade(fraction.m_x), Fade(fraction.m_y), Fade(fraction.m_z) };
+            const FloatType one = VecType::Splat(1.0f);
+            const FloatType two = VecType::Splat(2.0f);
+
+            FloatType cellNoiseZ[2];
+            for (int iZ = 0; iZ <= 1; iZ++)
+            {
+                FloatType cellNoiseY[2];
+                for (int iY = 0; iY <= 1; iY++)
+                {
+                    FloatType cellNoiseX[2];
+                    for (int iX = 0; iX <= 1; iX++)
+                    {
+                        const Float3 offset = Splat3(static_cast<float>(iX), static_cast<float>(iY), static_cast<float>(iZ));
+                        const Float3 cell = Mod3(Add3(baseCell, offset), period);
+                        const Float3 rand = Rand3dTo3d_A(cell);
+                        // Guarantees -1 to 1
+                        const Float3 cellDirection = {
+                            VecType::Sub(VecType::Mul(rand.m_x, two), one),
+                            VecType::Sub(VecType::Mul(rand.m_y, two), one),
+                            VecType::Sub(VecType::Mul(rand.m_z, two), one),
+                        };
+                        cellNoiseX[iX] = Dot(cellDirection, Sub3(fraction, offset));
+                    }
+                    cellNoiseY[iY] = Lerp(cellNoiseX[0], cellNoiseX[1], interpolator.m_x);
+                }
+                cellNoiseZ[iZ] = Lerp(cellNoiseY[0], cellNoiseY[1], interpolator.m_y);
+            }
+            return Lerp(cellNoiseZ[0], cellNoiseZ[1], interpolator.m_z);
+        }
+
+        // See TileableWorleyNoise_A.azsli
+        static FloatType WorleyNoise_A(const Float3& input, const FloatType& period)
+        {
+            const Float3 baseCell = Floor3(input);
+            FloatType shortestDistance = VecType::Splat(10000.0f);
+            for (int iX = -1; iX <= 1; iX++)
+            {
+                for (int iY = -1; iY <= 1; iY++)
+                {
+                    for (int iZ = -1; iZ <= 1; iZ++)
+                    {
+                        const Float3 cell = Add3(baseCell, Splat3(static_cast<float>(iX), static_cast<float>(iY), static_cast<float>(iZ)));
+                        const Float3 tiledCell = Mod3(cell, period);
+                        const Float3 cellPosition = Add3(cell, Rand3dTo3d_A(tiledCell));
+                        const Float3 deltaToCell = Sub3(cellPosition, input);
+                        shortestDistance = VecType::Min(shortestDistance, Dot(deltaToCell, deltaToCell));
+                    }
+                }
+            }
+            // Inverted Worley Noise for the Bubble Shape
+            return VecType::Sub(VecType::Splat(1.0f), shortestDistance);
+        }
+        // Variant A END
+        //////////////////////////////////////////////////////////////////
+
+        //////////////////////////////////////////////////////////////////
+        // Variant B START
+        // See Common_B.azsli. Hash by David_Hoskins.
+        static Float3 Hash33_B(const Float3& p)
+        {
+            // The uint constants, as their two's complement int32 representation.
+            // Integer multiplication yields the same low 32 bits either way.
+            static constexpr int32_t UI0 = static_cast<int32_t>(1597334673U);
+            static constexpr int32_t UI1 = static_cast<int32_t>(3812015801U);
+            static constexpr int32_t UI2 = static_cast<int32_t>(2798796415U);
+
+            const IntType qx = VecType::Mul(VecType::ConvertToInt(p.m_x), VecType::Splat(UI0));
+            const IntType qy = VecType::Mul(VecType::ConvertToInt(p.m_y), VecType::Splat(UI1));
+            const IntType qz = VecType::Mul(VecType::ConvertToInt(p.m_z), VecType::Splat(UI2));
+            const IntType n = VecType::Xor(VecType::Xor(qx, qy), qz);
+            return {
+                UintToSignedUnitFloat(VecType::Mul(n, VecType::Splat(UI0))),
+                UintToSignedUnitFloat(VecType::Mul(n, VecType::Splat(UI1))),
+                UintToSignedUnitFloat(VecType::Mul(n, VecType::Splat(UI2))),
+            };
+        }
+
+        // -1.0 + 2.0 * float(q) * UIF, where @q is interpreted as an unsigned integer.
+        static FloatType UintToSignedUnitFloat(const IntType& q)
+        {
+            static constexpr float UIF = 1.0f / 4294967296.0f;
+            FloatType asFloat = VecType::ConvertToFloat(q);
+            // Lanes with the high bit set were converted as negative numbers.
+            const FloatType isNegative = VecType::CmpLt(asFloat, VecType::ZeroFloat());
+            asFloat = VecType::Add(asFloat, VecType::And(isNegative, VecType::Splat(4294967296.0f)));
+            return VecType::Add(VecType::Splat(-1.0f), VecType::Mul(VecType::Splat(2.0f * UIF), asFloat));
+        }
+
+        // See TileablePerlinNoise_B.azsli (Gradient noise by iq, modified to be tileable).
+        static FloatType TileableGradientNoise_B(const Float3& input, const FloatType& freq)
+        {
+            const Float3 p = Floor3(input);
+            const Float3 w = Sub3(input, p);
+            // quintic interpolant
+            const Float3 u = { Fade(w.m_x), Fade(w.m_y), Fade(w.m_z) };
+
+            FloatType v[8];
+            for (int corner = 0; corner < 8; corner++)
+            {
+                const Float3 offset = Splat3(static_cast<float>(corner & 1), static_cast<float>((corner >> 1) & 1), static_cast<float>((corner >> 2) & 1));
+                const Float3 gradient = Hash33_B(Mod3(Add3(p, offset), freq));
+                v[corner] = Dot(gradient, Sub3(w, offset));
+            }
+            const FloatType& va = v[0];
+            const FloatType& vb = v[1];
+            const FloatType& vc = v[2];
+            const FloatType& vd = v[3];
+            const FloatType& ve = v[4];
+            const FloatType& vf = v[5];
+            const FloatType& vg = v[6];
+            const FloatType& vh = v[7];
+
+            // interpolation
+            const FloatType uxy = VecType::Mul(u.m_x, u.m_y);
+            const FloatType uyz = VecType::Mul(u.m_y, u.m_z);
+            const FloatType uzx = VecType::Mul(u.m_z, u.m_x);
+            const FloatType uxyz = VecType::Mul(uxy, u.m_z);
+
+            FloatType result = va;
+            result = VecType::Add(result, VecType::Mul(u.m_x, VecType::Sub(vb, va)));
+            result = VecType::Add(result, VecType::Mul(u.m_y, VecType::Sub(vc, va)));
+            result = VecType::Add(result, VecType::Mul(u.m_z, VecType::Sub(ve, va)));
+            result = VecType::Add(result, VecType::Mul(uxy, VecType::Add(VecType::Sub(VecType::Sub(va, vb), vc), vd)));
+            result = VecType::Add(result, VecType::Mul(uyz, VecType::Add(VecType::Sub(VecType::Sub(va, vc), ve), vg)));
+            result = VecType::Add(result, VecType::Mul(uzx, VecType::Add(VecType::Sub(VecType::Sub(va, vb), ve), vf)));
+            const FloatType cubic = VecType::Add(VecType::Sub(VecType::Sub(VecType::Add(VecType::Sub(VecType::Add(VecType::Sub(vb, va), vc), vd), ve), vf), vg), vh);
+            result = VecType::Add(result, VecType::Mul(uxyz, cubic));
+            return result;
+        }
+
+        // See TileableWorleyNoise_B.azsli
+        static FloatType WorleyNoise_B(const Float3& input, const FloatType& freq)
+        {
+            const Float3 baseCell = Floor3(input);
+            const Float3 fracCell = Sub3(input, baseCell);
+            const FloatType half = VecType::Splat(0.5f);
+            FloatType shortestDistance = VecType::Splat(10000.0f);
+            for (int iX = -1; iX <= 1; iX++)
+            {
+                for (int iY = -1; iY <= 1; iY++)
+                {
+                    for (int iZ = -1; iZ <= 1; iZ++)
+                    {
+                        const Float3 offset = Splat3(static_cast<float>(iX), static_cast<float>(iY), static_cast<float>(iZ));
+                        const Float3 tiledCell = Mod3(Add3(baseCell, offset), freq);
+                        const Float3 hash = Hash33_B(tiledCell);
+                        const Float3 cellPosition = {
+                            VecType::Add(VecType::Add(VecType::Mul(hash.m_x, half), half), offset.m_x),
+                            VecType::Add(VecType::Add(VecType::Mul(hash.m_y, half), half), offset.m_y),
+                            VecType::Add(VecType::Add(VecType::Mul(hash.m_z, half), half), offset.m_z),
+                        };
+                        const Float3 deltaToCell = Sub3(fracCell, cellPosition);
+                        shortestDistance = VecType::Min(shortestDistance, Dot(deltaToCell, deltaToCell));
+                    }
+                }
+            }
+            // Inverted Worley Noise for the Bubble Shape
+            return VecType::Sub(VecType::Splat(1.0f), shortestDistance);
+        }
+        // Variant B END
+        //////////////////////////////////////////////////////////////////
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,178 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+
+#include <cmath>
+
+#include "CloudTextureCpuBaker.h"
+#include "WeatherMapPyramid.h"
+
+namespace VolumetricClouds
+{
+    uint32_t WeatherMapPyramid::GetLevelCount(uint32_t width, uint32_t height)
+    {
+        if ((width == 0) || (height == 0))
+        {
+            return 0;
+        }
+        uint32_t levelCount = 1;
+        while ((width > 1) || (height > 1))
+        {
+            width = (width + 1) >> 1;
+            height = (height + 1) >> 1;
+            levelCount++;
+        }
+        return levelCount;
+    }
+
+    bool WeatherMapPyramid::Build(const uint8_t* weatherMapPixels, uint32_t width, uint32_t height, AZ::JobContext* jobContext)
+    {
+        m_levels.clear();
+        const uint32_t levelCount = GetLevelCount(width, height);
+        if (levelCount == 0)
+        {
+            return false;
+        }
+
+        if (!jobContext)
+        {
+            jobContext = AZ::JobContext::GetGlobalContext();
+        }
+
+        m_levels.resize(levelCount);
+        uint32_t levelWidth = width;
+        uint32_t levelHeight = height;
+        for (uint32_t levelIndex = 0; levelIndex < levelCount; levelIndex++)
+        {
+            CloudTextureMipData& level = m_levels[levelIndex];
+            level.m_mipSlice = static_cast<uint16_t>(levelIndex);
+            level.m_mipSize = AZ::RHI::Size(levelWidth, levelHeight, 1);
+            level.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>();
+            level.m_dataBuffer->resize_no_construct(static_cast<size_t>(levelWidth) * levelHeight * BytesPerPixel);
+
+            const size_t rowPitch = static_cast<size_t>(levelWidth) * BytesPerPixel;
+            uint8_t* dstPixels = level.m_dataBuffer->data();
+            if (levelIndex == 0)
+            {
+                CloudTextureCpuBaker::ForEachSlab(jobContext, levelHeight, [&](uint32_t firstRow, uint32_t rowCount)
+                    {
+                        BuildFirstLevelRows(weatherMapPixels, width, height, firstRow, rowCount, dstPixels + (rowPitch * firstRow));
+                    });
+            }
+            else
+            {
+                const CloudTextureMipData& srcLevel = m_levels[levelIndex - 1];
+                CloudTextureCpuBaker::ForEachSlab(jobContext, levelHeight, [&](uint32_t firstRow, uint32_t rowCount)
+                    {
+                        BuildLevelRows(srcLevel, level, firstRow, rowCount);
+                    });
+            }
+
+            levelWidth = (levelWidth + 1) >> 1;
+            levelHeight = (levelHeight + 1) >> 1;
+        }
+        return true;
+    }
+
+    void WeatherMapPyramid::BuildFirstLevelRows(const uint8_t* weatherMapPixels, uint32_t width, uint32_t height,
+        uint32_t firstRow, uint32_t rowCount, uint8_t* dstPixels)
+    {
+        // A bilinear sample inside the uv range of texel x blends texels x - 1, x and x + 1, and the
+        // sampler wraps around, so each texel is the max of its wrapped 3x3 neighborhood.
+        const size_t rowPitch = static_cast<size_t>(width) * BytesPerPixel;
+        uint8_t* dst = dstPixels;
+        for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+        {
+            const uint32_t rows[3] = { (y + height - 1) % height, y, (y + 1) % height };
+            for (uint32_t x = 0; x < width; x++)
+            {
+                const uint32_t columns[3] = { (x + width - 1) % width, x, (x + 1) % width };
+                uint8_t maxValues[BytesPerPixel] = { 0, 0, 0, 0 };
+                for (uint32_t row : rows)
+                {
+                    for (uint32_t column : columns)
+                    {
+                        const uint8_t* src = weatherMapPixels + (rowPitch * row) + (static_cast<size_t>(column) * BytesPerPixel);
+                        for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                        {
+                            maxValues[channel] = AZStd::max(maxValues[channel], src[channel]);
+                        }
+                    }
+                }
+                for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                {
+                    *dst++ = maxValues[channel];
+                }
+            }
+        }
+    }
+
+    void WeatherMapPyramid::BuildLevelRows(const CloudTextureMipData& srcLevel, const CloudTextureMipData& dstLevel,
+        uint32_t firstRow, uint32_t rowCount)
+    {
+        const uint32_t srcWidth = srcLevel.m_mipSize.m_width;
+        const uint32_t srcHeight = srcLevel.m_mipSize.m_height;
+        const uint32_t dstWidth = dstLevel.m_mipSize.m_width;
+        const size_t srcRowPitch = static_cast<size_t>(srcWidth) * BytesPerPixel;
+        const size_t dstRowPitch = static_cast<size_t>(dstWidth) * BytesPerPixel;
+        const uint8_t* srcPixels = srcLevel.m_dataBuffer->data();
+        uint8_t* dst = dstLevel.m_dataBuffer->data() + (dstRowPitch * firstRow);
+        for (uint32_t y = firstRow; y < firstRow + rowCount; y++)
+        {
+            // With odd sizes the last texel only has one child. There's no wrap around here,
+            // the footprints of the texels of level 0 already include their neighbors.
+            const uint32_t srcY0 = y << 1;
+            const uint32_t srcY1 = AZStd::min(srcY0 + 1, srcHeight - 1);
+            for (uint32_t x = 0; x < dstWidth; x++)
+            {
+                const uint32_t srcX0 = x << 1;
+                const uint32_t srcX1 = AZStd::min(srcX0 + 1, srcWidth - 1);
+                const uint8_t* children[4] = {
+                    srcPixels + (srcRowPitch * srcY0) + (static_cast<size_t>(srcX0) * BytesPerPixel),
+                    srcPixels + (srcRowPitch * srcY0) + (static_cast<size_t>(srcX1) * BytesPerPixel),
+                    srcPixels + (srcRowPitch * srcY1) + (static_cast<size_t>(srcX0) * BytesPerPixel),
+                    srcPixels + (srcRowPitch * srcY1) + (static_cast<size_t>(srcX1) * BytesPerPixel),
+                };
+                for (uint32_t channel = 0; channel < BytesPerPixel; channel++)
+                {
+                    *dst++ = AZStd::max(AZStd::max(children[0][channel], children[1][channel]),
+                        AZStd::max(children[2][channel], children[3][channel]));
+                }
+            }
+        }
+    }
+
+    const uint8_t* WeatherMapPyramid::GetBound(uint32_t level, float u, float v) const
+    {
+        if (level >= m_levels.size())
+        {
+            return nullptr;
+        }
+        // Same math as GetEmptySpaceSkipDistanceKm() in CloudscapeCS.azsl.
+        const auto& level0Size = m_levels[0].m_mipSize;
+        const float wrappedU = u - std::floor(u);
+        const float wrappedV = v - std::floor(v);
+        const uint32_t x = AZStd::min(static_cast<uint32_t>(wrappedU * level0Size.m_width), level0Size.m_width - 1) >> level;
+        const uint32_t y = AZStd::min(static_cast<uint32_t>(wrappedV * level0Size.m_height), level0Size.m_height - 1) >> level;
+        const CloudTextureMipData& levelData = m_levels[level];
+        return levelData.m_dataBuffer->data() + ((static_cast<size_t>(y) * levelData.m_mipSize.m_width + x) * BytesPerPixel);
+    }
+
+    bool WeatherMapPyramid::IsEmpty(float maxLowCoverage, float maxHighCoverage, float maxPeakHeight, float maxDensity, float globalCloudCoverage)
+    {
+        // SampleCloudDensity() remaps the base shape from [1 - globalCloudCoverage * coverage, 1] to [0, 1], so
+        // without coverage nothing is left. Without peak height the shape is cut to zero, and without density
+        // the whole sample is scaled to zero.
+        const float highCoverageWeight = AZStd::clamp(globalCloudCoverage - 0.5f, 0.0f, 1.0f) * 2.0f;
+        const float maxCoverage = AZStd::max(maxLowCoverage, highCoverageWeight * maxHighCoverage);
+        return ((globalCloudCoverage * maxCoverage) <= 0.0f) || (maxPeakHeight <= 0.0f) || (maxDensity <= 0.0f);
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,67 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+
+#include <Renderer/CloudTextureMipData.h>
+
+namespace AZ
+{
+    class JobContext;
+}
+
+namespace VolumetricClouds
+{
+    // A max pyramid of the weather map, used by CloudscapeCS.azsl to leap over the regions of the
+    // cloud slab where the weather map guarantees zero density.
+    // Each texel of level k holds, per channel, the maximum of all the weather map values that a bilinear sample
+    // can return inside its footprint: level 0 texel (x, y) covers the uv range of the weather map texel (x, y),
+    // and level k texel (x, y) covers the level 0 texels [x * 2^k, (x + 1) * 2^k) (same for y), clipped to the size
+    // of the weather map. The channels are the same as the weather map:
+    // R: Max low coverage.
+    // G: Max high coverage.
+    // B: Max peak height.
+    // A: Max density.
+    // The levels are the mips of the RGBA8 texture bound to CloudscapeCS.azsl.
+    class WeatherMapPyramid final
+    {
+    public:
+        static constexpr uint32_t BytesPerPixel = 4; // RGBA8
+
+        // Returns the number of levels, down to a 1x1 level, of a weather map of size @width x @height.
+        static uint32_t GetLevelCount(uint32_t width, uint32_t height);
+
+        // Builds all the levels from an RGBA8 weather map, stored row by row.
+        // Each level is split in slabs of rows, processed by jobs. If @jobContext is null the global job
+        // context is used, and if there's no job system at all, the levels are built in the calling thread.
+        // Returns false if the size is 0.
+        bool Build(const uint8_t* weatherMapPixels, uint32_t width, uint32_t height, AZ::JobContext* jobContext = nullptr);
+
+        // Each level is stored as a mip level with depth 1.
+        const AZStd::vector<CloudTextureMipData>& GetLevels() const { return m_levels; }
+
+        // Returns the RGBA8 bound of the texel of @level that contains @uv. The uv wraps around, like the sampler
+        // of the weather map.
+        const uint8_t* GetBound(uint32_t level, float u, float v) const;
+
+        // Mirrors IsWeatherCellEmpty() in CloudscapeCS.azsl. Returns true if SampleCloudDensity() is zero for all the
+        // weather data bounded by the arguments. The bound is only about the weather map, and the test only
+        // checks for zeros, so it holds for any height, any noise value, and for sRGB weather maps as well.
+        static bool IsEmpty(float maxLowCoverage, float maxHighCoverage, float maxPeakHeight, float maxDensity, float globalCloudCoverage);
+
+    private:
+        static void BuildFirstLevelRows(const uint8_t* weatherMapPixels, uint32_t width, uint32_t height,
+            uint32_t firstRow, uint32_t rowCount, uint8_t* dstPixels);
+        static void BuildLevelRows(const CloudTextureMipData& srcLevel, const CloudTextureMipData& dstLevel,
+            uint32_t firstRow, uint32_t rowCount);
+
+        AZStd::vector<CloudTextureMipData> m_levels;
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,64 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/std/algorithm.h>
+
+#include "WorleyFeaturePointTable.h"
+
+namespace VolumetricClouds
+{
+    WorleyFeaturePointTable::WorleyFeaturePointTable(uint32_t period)
+        : m_period(period)
+    {
+        const size_t paddedSize = GetPaddedSize();
+        m_featurePoints.resize(paddedSize * paddedSize * paddedSize);
+    }
+
+    AZStd::vector<uint32_t> WorleyFeaturePointTables::GetTablePeriods(float frequency, int worleyOctaves, uint32_t pixelSize)
+    {
+        AZStd::vector<uint32_t> periods;
+        // Same frequencies as PerlinWorleyNoiseKernels::WorleyNoiseFbmForCloudsTriplet(). The Worley FBM
+        // of the Perlin-Worley remap uses the same frequencies as the first one.
+        for (float channelMultiplier : { 1.0f, 2.0f, 4.0f })
+        {
+            float octaveFrequency = frequency * channelMultiplier;
+            for (int octave = 0; octave < worleyOctaves; octave++)
+            {
+                const uint32_t period = static_cast<uint32_t>(octaveFrequency);
+                const bool isIntegral = static_cast<float>(period) == octaveFrequency;
+                if (isIntegral && (period >= 1) && (period <= MaxPeriod) && (period <= pixelSize * 2)
+                    && (AZStd::find(periods.begin(), periods.end(), period) == periods.end()))
+                {
+                    periods.push_back(period);
+                }
+                octaveFrequency *= 2.0f;
+            }
+        }
+        return periods;
+    }
+
+    void WorleyFeaturePointTables::Initialize(const AZStd::vector<uint32_t>& periods)
+    {
+        m_tables.clear();
+        m_tables.reserve(periods.size());
+        for (uint32_t period : periods)
+        {
+            m_tables.emplace_back(period);
+        }
+    }
+
+    size_t WorleyFeaturePointTables::GetSizeInBytes() const
+    {
+        size_t sizeInBytes = 0;
+        for (const auto& table : m_tables)
+        {
+            sizeInBytes += table.GetSizeInBytes();
+        }
+        return sizeInBytes;
+    }
+
+} // namespace VolumetricClouds
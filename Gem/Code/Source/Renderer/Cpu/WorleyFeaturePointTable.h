@@ -0,0 +1,101 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/base.h>
+#include <AzCore/std/containers/vector.h>
+
+namespace VolumetricClouds
+{
+    // The feature point of a Worley cell, as an offset from the cell corner.
+    // Variant A: Rand3dTo3d_A(cell). Variant B: Hash33_B(cell) * 0.5 + 0.5.
+    struct WorleyFeaturePoint
+    {
+        float m_x = 0.0f;
+        float m_y = 0.0f;
+        float m_z = 0.0f;
+    };
+
+    // The feature points of all the cells of a tileable Worley noise with an integral period.
+    // The naive Worley noise hashes the 27 cells around each sample, even though, at the low
+    // frequencies, thousands of voxels share the same cells. With the table, the hashes are calculated
+    // once per bake and each sample only reads the 27 feature points.
+    // The table is padded with one cell on each side, with the wrapped around values, so the 3x3x3
+    // neighborhood of any cell in [0, period) is read without the modulo. Cells are stored X first,
+    // so the neighborhood of consecutive voxels along a row shares the same cache lines.
+    // Filled by PerlinWorleyNoiseKernels::FillWorleyFeaturePointTable().
+    class WorleyFeaturePointTable final
+    {
+    public:
+        WorleyFeaturePointTable() = default;
+        explicit WorleyFeaturePointTable(uint32_t period);
+
+        uint32_t GetPeriod() const { return m_period; }
+        // Number of cells along each axis, including the padding.
+        uint32_t GetPaddedSize() const { return m_period + 2; }
+
+        // Index of the padded cell (@x, @y, @z), where each coordinate is between 0 and GetPaddedSize() - 1.
+        // The padded cell (x, y, z) is the cell (x - 1, y - 1, z - 1) wrapped around the period.
+        size_t GetPaddedIndex(uint32_t x, uint32_t y, uint32_t z) const
+        {
+            const size_t paddedSize = GetPaddedSize();
+            return (static_cast<size_t>(z) * paddedSize + y) * paddedSize + x;
+        }
+
+        const WorleyFeaturePoint* GetFeaturePoints() const { return m_featurePoints.data(); }
+        WorleyFeaturePoint* GetFeaturePoints() { return m_featurePoints.data(); }
+
+        size_t GetSizeInBytes() const { return m_featurePoints.size() * sizeof(WorleyFeaturePoint); }
+
+    private:
+        uint32_t m_period = 0;
+        AZStd::vector<WorleyFeaturePoint> m_featurePoints;
+    };
+
+    // The tables for all the Worley periods used by a bake: each octave of the three Worley FBMs of the
+    // cloud texture channels, and of the Perlin-Worley remap. Most periods are shared by several
+    // octaves and channels, e.g. the second octave at frequency x1 is the first octave at frequency x2.
+    class WorleyFeaturePointTables final
+    {
+    public:
+        // Larger periods would need too much memory: (128 + 2)^3 cells are 25MB.
+        static constexpr uint32_t MaxPeriod = 128;
+
+        // Returns the periods of all the Worley octaves of a bake, without duplicates, that are worth
+        // a table for a volume of @pixelSize voxels per axis. A period is worth a table when it is not
+        // larger than MaxPeriod, and when it is not larger than twice the pixel size. With higher periods
+        // the neighborhoods of the voxels barely overlap, so hashing the whole table would cost more than
+        // hashing the neighborhood of each voxel.
+        static AZStd::vector<uint32_t> GetTablePeriods(float frequency, int worleyOctaves, uint32_t pixelSize);
+
+        // Creates empty tables for @periods.
+        void Initialize(const AZStd::vector<uint32_t>& periods);
+
+        // Returns nullptr if there's no table for @period. Only integral periods can have a table.
+        const WorleyFeaturePointTable* Find(float period) const
+        {
+            for (const auto& table : m_tables)
+            {
+                if (static_cast<float>(table.GetPeriod()) == period)
+                {
+                    return &table;
+                }
+            }
+            return nullptr;
+        }
+
+        AZStd::vector<WorleyFeaturePointTable>& GetTables() { return m_tables; }
+        const AZStd::vector<WorleyFeaturePointTable>& GetTables() const { return m_tables; }
+
+        size_t GetSizeInBytes() const;
+
+    private:
+        AZStd::vector<WorleyFeaturePointTable> m_tables;
+    };
+
+} // namespace VolumetricClouds
@@ -9,6 +9,8 @@
 #include <AzCore/Serialization/SerializeContext.h>
 #include <AzCore/Serialization/EditContext.h>
 
+#include <cmath>
+
 #include <VolumetricClouds/VolumetricCloudsTypeIds.h>
 #include "CloudTextureComputeData.h"
 
@@ -23,7 +25,7 @@ namespace VolumetricClouds
         if (auto serializeContext = azrtti_cast<AZ::SerializeContext*>(context))
         {
             serializeContext->Class<CloudTextureComputeData>()
-                ->Version(1)
+                ->Version(4)
                 ->Field("PixelSize", &CloudTextureComputeData::m_pixelSize)
                 ->Field("Frequency", &CloudTextureComputeData::m_frequency)
                 ->Field("PerlinOctaves",   &CloudTextureComputeData::m_perlinOctaves)
@@ -32,6 +34,9 @@ namespace VolumetricClouds
                 ->Field("WorleyOctaves",   &CloudTextureComputeData::m_worleyOctaves)
                 ->Field("WorleyGain",      &CloudTextureComputeData::m_worleyGain)
                 ->Field("WorleyAmplitude", &CloudTextureComputeData::m_worleyAmplitude)
+                ->Field("MipFilter",       &CloudTextureComputeData::m_mipFilter)
+                ->Field("ChannelLayout",   &CloudTextureComputeData::m_channelLayout)
+                ->Field("NormalizeChannelRange", &CloudTextureComputeData::m_normalizeChannelRange)
                 ;
 
             if (auto editContext = serializeContext->GetEditContext())
@@ -68,6 +73,19 @@ namespace VolumetricClouds
                     ->DataElement(AZ::Edit::UIHandlers::Slider, &CloudTextureComputeData::m_worleyAmplitude, "Worley Amplitude", "Starting amplitude of the worley Fbm.")
                         ->Attribute(AZ::Edit::Attributes::Min, 0.1)
                         ->Attribute(AZ::Edit::Attributes::Max, 2.0)
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &CloudTextureComputeData::m_mipFilter, "Mip Filter", "Filter used to downsample each mip level from the previous one.")
+                        ->EnumAttribute(CloudTextureMipFilter::Box,    "Box")
+                        ->EnumAttribute(CloudTextureMipFilter::Kaiser, "Kaiser")
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &CloudTextureComputeData::m_channelLayout, "Channel Layout",
+                        "Channels and pixel format of the Texture3D. Smaller formats are faster to raymarch. "
+                        "The single channel layouts have no detail noise, and can't be the high frequency noise of a cloudscape.")
+                        ->EnumAttribute(CloudTextureChannelLayout::RGBA8, "RGBA8 (4 bytes)")
+                        ->EnumAttribute(CloudTextureChannelLayout::RG8,   "RG8 (2 bytes, pre-combined)")
+                        ->EnumAttribute(CloudTextureChannelLayout::R8,    "R8 (1 byte, pre-combined, low frequency only)")
+                        ->EnumAttribute(CloudTextureChannelLayout::R16F,  "R16F (2 bytes, pre-combined, low frequency only)")
+                    ->DataElement(AZ::Edit::UIHandlers::Default, &CloudTextureComputeData::m_normalizeChannelRange, "Normalize Channel Range",
+                        "Remaps each channel from its min-max range to the full 0-1 range after the texture is generated. "
+                        "Requires reading the texture back to the CPU.")
                     ;
             }
         }
@@ -83,7 +101,10 @@ namespace VolumetricClouds
             (m_perlinAmplitude == rhs.m_perlinAmplitude) &&
             (m_worleyOctaves   == rhs.m_worleyOctaves) &&
             (m_worleyGain      == rhs.m_worleyGain) &&
-            (m_worleyAmplitude == rhs.m_worleyAmplitude)
+            (m_worleyAmplitude == rhs.m_worleyAmplitude) &&
+            (m_mipFilter       == rhs.m_mipFilter) &&
+            (m_channelLayout   == rhs.m_channelLayout) &&
+            (m_normalizeChannelRange == rhs.m_normalizeChannelRange)
             ;
     }
 
@@ -92,4 +113,43 @@ namespace VolumetricClouds
         return !(*this == rhs);
     }
 
+    uint16_t CloudTextureFormat::CalculateMipCount(uint32_t pixelSize)
+    {
+        return static_cast<uint16_t>(log2(pixelSize) - log2(MinPixelSize)) + 1;
+    }
+
+    AZ::RHI::Format CloudTextureFormat::GetImageFormat(CloudTextureChannelLayout channelLayout)
+    {
+        switch (channelLayout)
+        {
+        case CloudTextureChannelLayout::RG8:
+            return AZ::RHI::Format::R8G8_UNORM;
+        case CloudTextureChannelLayout::R8:
+            return AZ::RHI::Format::R8_UNORM;
+        case CloudTextureChannelLayout::R16F:
+            return AZ::RHI::Format::R16_FLOAT;
+        default:
+            return AZ::RHI::Format::R8G8B8A8_UNORM;
+        }
+    }
+
+    bool CloudTextureFormat::GetChannelLayout(AZ::RHI::Format format, CloudTextureChannelLayout& channelLayout)
+    {
+        for (const auto layout : { CloudTextureChannelLayout::RGBA8, CloudTextureChannelLayout::RG8,
+                                   CloudTextureChannelLayout::R8, CloudTextureChannelLayout::R16F })
+        {
+            if (GetImageFormat(layout) == format)
+            {
+                channelLayout = layout;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool CloudTextureFormat::HasDetailNoise(CloudTextureChannelLayout channelLayout)
+    {
+        return (channelLayout == CloudTextureChannelLayout::RGBA8) || (channelLayout == CloudTextureChannelLayout::RG8);
+    }
+
 } // namespace VolumetricClouds
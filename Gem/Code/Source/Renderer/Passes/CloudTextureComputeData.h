@@ -10,6 +10,8 @@
 #include <AzCore/RTTI/TypeInfoSimple.h>
 #include <AzCore/Memory/SystemAllocator.h>
 
+#include <Atom/RHI.Reflect/Format.h>
+
 namespace VolumetricClouds
 {
     enum class CloudTexturePixelSize : uint32_t
@@ -21,6 +23,53 @@ namespace VolumetricClouds
         PixelSize256 = 256,
     };
 
+    // Filter used to reduce each mip level of the Texture3D
+    // from the previous mip level.
+    enum class CloudTextureMipFilter : uint32_t
+    {
+        // Average of the 2x2x2 source texels.
+        Box = 0,
+        // Separable 4x4x4 Kaiser windowed sinc (alpha = 4).
+        // Sharper than Box and with less aliasing.
+        Kaiser = 1,
+    };
+
+    // Channels, and pixel format, of the generated Texture3D.
+    // Fewer bytes per voxel means less bandwidth per raymarching step in CloudscapeCS.azsl,
+    // which picks the matching fetch path from the format of each noise texture.
+    // Except for RGBA8, the channels are pre-combined the same way CloudscapeCS.azsl
+    // combines the RGBA8 channels, so the raymarcher doesn't need to do it per sample.
+    enum class CloudTextureChannelLayout : uint32_t
+    {
+        // R8G8B8A8_UNORM. r: Perlin-Worley, gba: Worley FBM at frequency x1, x2 and x4.
+        RGBA8 = 0,
+        // R8G8_UNORM. r: Base cloud shape (Perlin-Worley remapped by the Worley FBM),
+        // g: The three Worley FBMs combined, used as detail noise.
+        RG8 = 1,
+        // R8_UNORM. r: Base cloud shape. There's no detail noise, so it can only be
+        // the low frequency texture. See CloudTextureFormat::HasDetailNoise().
+        R8 = 2,
+        // R16_FLOAT. Same as R8, with more precision.
+        R16F = 3,
+    };
+
+    // Size limits, mip count and pixel format of the Texture3D generated from a CloudTextureComputeData.
+    // Shared by the CloudTextureComputePass and the CPU baker, which doesn't link the passes.
+    struct CloudTextureFormat
+    {
+        static constexpr uint32_t MaxPixelSize = 512;
+        static constexpr uint32_t MinPixelSize = 4;
+        static uint16_t CalculateMipCount(uint32_t pixelSize);
+
+        // Pixel format of the Texture3D for @channelLayout.
+        static AZ::RHI::Format GetImageFormat(CloudTextureChannelLayout channelLayout);
+        // The inverse of GetImageFormat(). Returns false if @format is not the format of any layout.
+        static bool GetChannelLayout(AZ::RHI::Format format, CloudTextureChannelLayout& channelLayout);
+        // Whether @channelLayout holds the Worley FBM the cloudscape erodes the clouds with,
+        // which is required for the high frequency noise texture.
+        static bool HasDetailNoise(CloudTextureChannelLayout channelLayout);
+    };
+
     // Has all the data the compute shader needs to generate a Texture3D
     // with PerlinWorley noise.
     struct CloudTextureComputeData
@@ -51,6 +100,19 @@ namespace VolumetricClouds
         float m_worleyGain = 0.45;
         // The starting amplitude for the worley FBM.
         float m_worleyAmplitude = 0.625;
+
+        // One of CloudTextureMipFilter. All mips, except mip 0, are downsampled
+        // from the previous mip level with this filter.
+        uint32_t m_mipFilter = static_cast<uint32_t>(CloudTextureMipFilter::Kaiser);
+
+        // One of CloudTextureChannelLayout.
+        uint32_t m_channelLayout = static_cast<uint32_t>(CloudTextureChannelLayout::RGBA8);
+
+        // When true, each channel of the generated texture is remapped from its [min, max] range
+        // to the full [0, 1] range, so 8 bits channels don't waste precision. The remap is done
+        // on the CPU after the readback, see CloudTextureStatistics. The original range of each
+        // channel is kept in CloudTextureStats.
+        bool m_normalizeChannelRange = false;
     };
 
 } // namespace VolumetricClouds
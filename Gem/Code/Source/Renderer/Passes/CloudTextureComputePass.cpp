@@ -8,6 +8,8 @@
 #include <Atom/RHI/FrameGraphAttachmentInterface.h>
 #include <Atom/RHI/FrameGraphBuilder.h>
 #include <Atom/RHI/CommandList.h>
+#include <Atom/RHI/Device.h>
+#include <Atom/RHI/RHISystemInterface.h>
 
 #include <Atom/RPI.Public/Pass/PassUtils.h>
 #include <Atom/RPI.Public/RenderPipeline.h>
@@ -34,7 +36,17 @@ namespace VolumetricClouds
 
     uint16_t CloudTextureComputePass::CalculateMipCount(uint32_t pixelSize)
     {
-        return static_cast<uint16_t>(log2(pixelSize) - log2(MIN_PIXEL_SIZE)) + 1;
+        return CloudTextureFormat::CalculateMipCount(pixelSize);
+    }
+
+    AZ::RHI::Format CloudTextureComputePass::GetImageFormat(CloudTextureChannelLayout channelLayout)
+    {
+        return CloudTextureFormat::GetImageFormat(channelLayout);
+    }
+
+    bool CloudTextureComputePass::GetChannelLayout(AZ::RHI::Format format, CloudTextureChannelLayout& channelLayout)
+    {
+        return CloudTextureFormat::GetChannelLayout(format, channelLayout);
     }
 
     void CloudTextureComputePass::BuildInternal()
@@ -50,46 +62,37 @@ namespace VolumetricClouds
         }
 
         const auto pixelSize = m_computeData.m_pixelSize;
-        // Based on the pixelSize we can calculate all the mips.
-        const uint16_t numMips = CalculateMipCount(pixelSize);
-        uint16_t pixelSizeForMip = static_cast<uint16_t>(pixelSize);
-        const auto shaderInputName = AZ::Name("m_cloudTextureMips");
-        for (uint16_t mipIndex = 0; mipIndex < numMips; mipIndex++)
+        // This pass only writes mip 0. The remaining mips are downsampled
+        // by the CloudTextureMipReductionPass(es) that follow this pass.
+        const auto slotName = AZ::Name("OutputMip0");
+        auto binding = FindAttachmentBinding(slotName);
+        if (!binding)
         {
-            const AZStd::string slotNameStr = AZStd::string::format("OutputMip%u", mipIndex);
-            const auto slotName = AZ::Name(slotNameStr);
-            auto binding = FindAttachmentBinding(slotName);
-            if (!binding)
-            {
-                AZ_Warning(LogName, false, "Failed to find binding for slot %s", slotName.GetCStr());
-                return;
-            }
-
-            // By default, in the *.pass asset we have it as "NoBind" because during asset load time
-            // we have no attachments. Attachments are actually created and defined at runtime by the CloudTextureFeatureProcessor.
-            // Now that we know what the attachment should be, it is time to define the real shader constant name.
-            // REMARK:
-            // The real reason in the *.pass asset we start with "NoBind" is to avoid
-            // harmless AZ::Errors related with the shaders m_cloudTextureMips[]
-            // array binding. The bindings are actually known at runtime and not during
-            // AZ::RPI::RenderPass::InitializeInternal().
-            binding->m_shaderInputName = shaderInputName;
-
-            // Make sure the imageView points to the correct mip level.
-            AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create3D(m_texture3DAttachment->GetDescriptor().m_format,
-                mipIndex, mipIndex, 0, pixelSizeForMip - 1);
-            binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
-
-            AttachImageToSlot(slotName, m_texture3DAttachment);
-
-            pixelSizeForMip = (pixelSizeForMip >> 1);
+            AZ_Warning(LogName, false, "Failed to find binding for slot %s", slotName.GetCStr());
+            return;
         }
 
-        SetTargetThreadCounts(pixelSize, pixelSize, pixelSize);
+        // By default, in the *.pass asset we have it as "NoBind" because during asset load time
+        // we have no attachments. Attachments are actually created and defined at runtime by the CloudTextureFeatureProcessor.
+        // Now that we know what the attachment should be, it is time to define the real shader constant name.
+        binding->m_shaderInputName = AZ::Name("m_cloudTextureMip0");
+
+        // Make sure the imageView points to mip 0 only.
+        AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create3D(m_texture3DAttachment->GetDescriptor().m_format,
+            0, 0, 0, static_cast<uint16_t>(pixelSize - 1));
+        binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+
+        AttachImageToSlot(slotName, m_texture3DAttachment);
     }
 
     void CloudTextureComputePass::FrameBeginInternal(FramePrepareParams params)
     {
+        // The bricks of the current frame are stacked along the Z axis of the dispatch.
+        // CloudTextureCS.azsl converts the thread ids back to volume coordinates.
+        m_currentBrickRange = m_queuedBrickRange;
+        m_queuedBrickRange = {};
+        SetTargetThreadCounts(m_brickSize, m_brickSize, m_brickSize * m_currentBrickRange.m_brickCount);
+
         AZ::RPI::RenderPass::FrameBeginInternal(params);
     }
 
@@ -100,6 +103,13 @@ namespace VolumetricClouds
             return;
         }
 
+        m_dispatchedBrickCount += m_currentBrickRange.m_brickCount;
+        m_currentBrickRange = {};
+        if (m_dispatchedBrickCount < m_brickCount)
+        {
+            return;
+        }
+
         m_isFinished = true;
 
         SetEnabled(false);
@@ -152,6 +162,14 @@ namespace VolumetricClouds
             m_shaderResourceGroup->SetConstant(m_worleyAmplitudeIndex, computeData.m_worleyAmplitude);
 
             m_shaderResourceGroup->SetConstant(m_pixelSizeIndex, computeData.m_pixelSize);
+            // The format of the attachment was validated against the layout in SetRenderData().
+            CloudTextureChannelLayout channelLayout = CloudTextureChannelLayout::RGBA8;
+            GetChannelLayout(m_texture3DAttachment->GetDescriptor().m_format, channelLayout);
+            m_shaderResourceGroup->SetConstant(m_channelLayoutIndex, static_cast<uint32_t>(channelLayout));
+
+            m_shaderResourceGroup->SetConstant(m_brickSizeIndex, m_brickSize);
+            m_shaderResourceGroup->SetConstant(m_bricksPerAxisIndex, m_bricksPerAxis);
+            m_shaderResourceGroup->SetConstant(m_firstBrickIndex, m_currentBrickRange.m_firstBrick);
 
         }
         AZ::RPI::ComputePass::CompileResources(context);
@@ -164,18 +182,24 @@ namespace VolumetricClouds
             return false;
         }
 
-        return !m_isFinished && m_texture3DAttachment;
+        // Nothing to do in frames without bricks.
+        const bool hasBricks = (m_queuedBrickRange.m_brickCount > 0) || (m_currentBrickRange.m_brickCount > 0);
+        return !m_isFinished && m_texture3DAttachment && hasBricks;
     }
 
-    bool CloudTextureComputePass::SetRenderData(AZ::Data::Instance<AZ::RPI::AttachmentImage> texture3DAttachment,
-        CloudTextureComputeData computeData)
+    bool CloudTextureComputePass::SetBrickRange(const CloudTextureBrickScheduler::BrickRange& brickRange)
     {
-        if (m_isFinished)
+        if (HasQueuedBricks())
         {
-            AZ_Error(LogName, false, "This function can not be called after the pass is finished!");
             return false;
         }
+        m_queuedBrickRange = brickRange;
+        return true;
+    }
 
+    bool CloudTextureComputePass::SetRenderData(AZ::Data::Instance<AZ::RPI::AttachmentImage> texture3DAttachment,
+        CloudTextureComputeData computeData, const CloudTextureBrickScheduler& brickScheduler)
+    {
         const auto pixelSize = computeData.m_pixelSize;
         if ( (pixelSize < MIN_PIXEL_SIZE) || (pixelSize > MAX_PIXEL_SIZE) )
         {
@@ -194,11 +218,65 @@ namespace VolumetricClouds
             return false;
         }
 
+        // CloudTextureCS.azsl packs the channels according to the layout, and the format
+        // of the attachment is what the readers use to unpack them.
+        const auto expectedFormat = GetImageFormat(static_cast<CloudTextureChannelLayout>(computeData.m_channelLayout));
+        if (imageDesc.m_format != expectedFormat)
+        {
+            AZ_Error(LogName, false, "Channel layout %u expects format %s in the attachment image. Got %s\n",
+                computeData.m_channelLayout, AZ::RHI::ToString(expectedFormat), AZ::RHI::ToString(imageDesc.m_format));
+            return false;
+        }
+
+        // CloudTextureCS.azsl and the mip reduction store to the attachment through a RWTexture3D<float4>, which needs typed UAV stores.
+        // They are optional for R8_UNORM, R8G8_UNORM and R16_FLOAT on some devices.
+        const auto formatCapabilities = AZ::RHI::RHISystemInterface::Get()->GetDevice(AZ::RHI::MultiDevice::DefaultDeviceIndex)->GetFormatCapabilities(expectedFormat);
+        if (!AZ::RHI::CheckBitsAll(formatCapabilities, AZ::RHI::FormatCapabilities::TypedStoreBuffer))
+        {
+            AZ_Error(LogName, false, "The device doesn't support typed UAV stores to %s, required by channel layout %u. Use the RGBA8 layout instead.\n",
+                AZ::RHI::ToString(expectedFormat), computeData.m_channelLayout);
+            return false;
+        }
+
+        // The shader works in groups of 4x4x4 threads.
+        if ((brickScheduler.GetBrickSize() % 4) != 0 || (brickScheduler.GetBrickSize() * brickScheduler.GetBricksPerAxis() != pixelSize))
+        {
+            AZ_Error(LogName, false, "Invalid brick size %u for pixel size %u.\n", brickScheduler.GetBrickSize(), pixelSize);
+            return false;
+        }
+
         m_texture3DAttachment = texture3DAttachment;
         m_computeData = computeData;
-
+        m_brickSize = brickScheduler.GetBrickSize();
+        m_bricksPerAxis = brickScheduler.GetBricksPerAxis();
+        m_brickCount = brickScheduler.GetBrickCount();
+        m_dispatchedBrickCount = 0;
+        m_queuedBrickRange = {};
+        m_currentBrickRange = {};
+        m_isFinished = false;
+
+        // The GPU time of each frame is used to estimate how many bricks fit in the frame budget.
+        SetTimestampQueryEnabled(true);
+        // The pass can be reused for several textures, so the attachment bindings
+        // are built again each time there's new render data.
+        QueueForBuildAndInitialization();
         SetEnabled(true);
         return true;
     }
 
+    void CloudTextureComputePass::ClearRenderData()
+    {
+        if (!m_texture3DAttachment)
+        {
+            return;
+        }
+        m_texture3DAttachment = nullptr;
+        m_isFinished = false;
+        m_queuedBrickRange = {};
+        m_currentBrickRange = {};
+        // Drops the bindings to the attachment image.
+        QueueForBuildAndInitialization();
+        SetEnabled(false);
+    }
+
 } // namespace VolumetricClouds
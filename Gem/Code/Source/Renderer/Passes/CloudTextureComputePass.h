@@ -17,13 +17,18 @@
 #include <Atom/RPI.Reflect/Pass/PassDescriptor.h>
 
 #include <Atom/RPI.Reflect/Pass/RenderPassData.h>
+#include <Atom/RHI.Reflect/Format.h>
 
+#include <Renderer/CloudTextureBrickScheduler.h>
 #include "CloudTextureComputeData.h"
 
 namespace VolumetricClouds
 {
     //! The compute pass to generate an RGBA Texture3D what contains
     //! the noise data to render clouds.
+    //! Only mip 0 is generated, and it is split in cubic bricks. Each frame the pass
+    //! dispatches the range of bricks given to SetBrickRange(), so the whole texture
+    //! can be generated across several frames without frame spikes.
     class CloudTextureComputePass
         : public AZ::RPI::ComputePass
     {
@@ -34,16 +39,30 @@ namespace VolumetricClouds
         AZ_CLASS_ALLOCATOR(CloudTextureComputePass, AZ::SystemAllocator);
         virtual ~CloudTextureComputePass() = default;
 
-        static constexpr uint32_t MAX_PIXEL_SIZE = 512;
-        static constexpr uint32_t MIN_PIXEL_SIZE = 4;
+        static constexpr uint32_t MAX_PIXEL_SIZE = CloudTextureFormat::MaxPixelSize;
+        static constexpr uint32_t MIN_PIXEL_SIZE = CloudTextureFormat::MinPixelSize;
+        // Same as CloudTextureFormat.
         static uint16_t CalculateMipCount(uint32_t pixelSize);
+        static AZ::RHI::Format GetImageFormat(CloudTextureChannelLayout channelLayout);
+        static bool GetChannelLayout(AZ::RHI::Format format, CloudTextureChannelLayout& channelLayout);
 
         static AZ::RPI::Ptr<CloudTextureComputePass> Create(const AZ::RPI::PassDescriptor& descriptor);
 
-        // Must be called before the pipeline that owns this pass runs.
+        // Must be called before the pipeline that owns this pass runs. Can be called again,
+        // once the pass is finished, to generate another texture.
         // Returns true (success) if the size of the texture3DAttachment is within the limits, etc.
+        // @brickScheduler Defines the brick size. The pass won't dispatch anything until SetBrickRange() is called.
         bool SetRenderData(AZ::Data::Instance<AZ::RPI::AttachmentImage> texture3DAttachment,
-                           CloudTextureComputeData computeData);
+                           CloudTextureComputeData computeData, const CloudTextureBrickScheduler& brickScheduler);
+        // Releases the attachment image and disables the pass.
+        void ClearRenderData();
+
+        // Queues the bricks that will be dispatched in the next frame.
+        // Returns false if there's a range of bricks that hasn't been dispatched yet.
+        bool SetBrickRange(const CloudTextureBrickScheduler::BrickRange& brickRange);
+        bool HasQueuedBricks() const { return m_queuedBrickRange.m_brickCount > 0; }
+
+        // True once all the bricks have been dispatched.
         bool IsFinished() { return m_isFinished; }
 
         //! Besides the standard enable flag,
@@ -76,13 +95,26 @@ namespace VolumetricClouds
         AZ::RHI::ShaderInputNameIndex m_worleyGainIndex = "m_worleyGain";
         AZ::RHI::ShaderInputNameIndex m_worleyAmplitudeIndex = "m_worleyAmplitude";
         AZ::RHI::ShaderInputNameIndex m_pixelSizeIndex = "m_pixelSize";
+        AZ::RHI::ShaderInputNameIndex m_brickSizeIndex = "m_brickSize";
+        AZ::RHI::ShaderInputNameIndex m_bricksPerAxisIndex = "m_bricksPerAxis";
+        AZ::RHI::ShaderInputNameIndex m_firstBrickIndex = "m_firstBrick";
+        AZ::RHI::ShaderInputNameIndex m_channelLayoutIndex = "m_channelLayout";
 
 
-        // This pass runs in one frame, and when done this becomes true.
+        // Becomes true when all the bricks have been dispatched.
         bool m_isFinished = false;
 
         AZ::Data::Instance<AZ::RPI::AttachmentImage> m_texture3DAttachment;
         CloudTextureComputeData m_computeData;
+
+        uint32_t m_brickSize = CloudTextureBrickScheduler::DefaultBrickSize;
+        uint32_t m_bricksPerAxis = 1;
+        uint32_t m_brickCount = 1;
+        uint32_t m_dispatchedBrickCount = 0;
+        // Given by SetBrickRange(). Becomes the current range at the beginning of the next frame.
+        CloudTextureBrickScheduler::BrickRange m_queuedBrickRange;
+        // The bricks being dispatched in the current frame.
+        CloudTextureBrickScheduler::BrickRange m_currentBrickRange;
     };
 
 } // namespace VolumetricClouds
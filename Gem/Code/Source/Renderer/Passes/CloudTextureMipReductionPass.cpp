@@ -0,0 +1,174 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <Atom/RHI/FrameGraphAttachmentInterface.h>
+#include <Atom/RHI/FrameGraphBuilder.h>
+
+#include <Atom/RPI.Public/Pass/PassUtils.h>
+#include <Atom/RPI.Public/RenderPipeline.h>
+#include <Atom/RPI.Public/Scene.h>
+
+#include "CloudTextureComputePass.h"
+#include "CloudTextureMipReductionPass.h"
+
+namespace VolumetricClouds
+{
+    AZ::RPI::Ptr<CloudTextureMipReductionPass> CloudTextureMipReductionPass::Create(const AZ::RPI::PassDescriptor& descriptor)
+    {
+        AZ::RPI::Ptr<CloudTextureMipReductionPass> pass = aznew CloudTextureMipReductionPass(descriptor);
+        return pass;
+    }
+
+    CloudTextureMipReductionPass::CloudTextureMipReductionPass(const AZ::RPI::PassDescriptor& descriptor)
+        : AZ::RPI::ComputePass(descriptor)
+    {
+    }
+
+    void CloudTextureMipReductionPass::BuildInternal()
+    {
+        if (!m_texture3DAttachment)
+        {
+            // Same as CloudTextureComputePass, the attachment is only known
+            // after SetRenderData() is called.
+            return;
+        }
+
+        const auto format = m_texture3DAttachment->GetDescriptor().m_format;
+        const uint16_t srcMipLevel = m_dstMipLevel - 1;
+        const uint32_t srcPixelSize = m_texture3DAttachment->GetDescriptor().m_size.m_width >> srcMipLevel;
+        const uint32_t dstPixelSize = srcPixelSize >> 1;
+
+        struct SlotInfo
+        {
+            const char* m_slotName;
+            const char* m_shaderInputName;
+            uint16_t m_mipLevel;
+            uint32_t m_pixelSize;
+        };
+        const SlotInfo slots[] = {
+            { "InputMip", "m_srcMip", srcMipLevel, srcPixelSize },
+            { "OutputMip", "m_dstMip", m_dstMipLevel, dstPixelSize },
+        };
+        for (const auto& slotInfo : slots)
+        {
+            const auto slotName = AZ::Name(slotInfo.m_slotName);
+            auto binding = FindAttachmentBinding(slotName);
+            if (!binding)
+            {
+                AZ_Warning(LogName, false, "Failed to find binding for slot %s", slotName.GetCStr());
+                return;
+            }
+
+            // Same as CloudTextureComputePass, the slots start as "NoBind" in the *.pass asset.
+            binding->m_shaderInputName = AZ::Name(slotInfo.m_shaderInputName);
+
+            // Each slot sees a single mip level.
+            AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create3D(format,
+                slotInfo.m_mipLevel, slotInfo.m_mipLevel, 0, static_cast<uint16_t>(slotInfo.m_pixelSize - 1));
+            binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+
+            AttachImageToSlot(slotName, m_texture3DAttachment);
+        }
+
+        SetTargetThreadCounts(dstPixelSize, dstPixelSize, dstPixelSize);
+    }
+
+    void CloudTextureMipReductionPass::FrameEndInternal()
+    {
+        if (!m_texture3DAttachment)
+        {
+            return;
+        }
+
+        m_isFinished = true;
+
+        SetEnabled(false);
+    }
+
+    void CloudTextureMipReductionPass::SetupFrameGraphDependencies(AZ::RHI::FrameGraphInterface frameGraph)
+    {
+        if (!m_texture3DAttachment)
+        {
+            AZ_Error(LogName, false, "Where is the texture3DAttachment?");
+            return;
+        }
+
+        // The CloudTextureComputePass, which runs before this pass, already imported the attachment.
+        AZ::RHI::FrameGraphAttachmentInterface attachmentDatabase = frameGraph.GetAttachmentDatabase();
+        if (!attachmentDatabase.IsAttachmentValid(m_texture3DAttachment->GetAttachmentId()))
+        {
+            attachmentDatabase.ImportImage(m_texture3DAttachment->GetAttachmentId(), m_texture3DAttachment->GetRHIImage());
+        }
+
+        AZ::RPI::ComputePass::SetupFrameGraphDependencies(frameGraph);
+    }
+
+    void CloudTextureMipReductionPass::CompileResources(const AZ::RHI::FrameGraphCompileContext& context)
+    {
+        if (m_texture3DAttachment)
+        {
+            const uint32_t srcPixelSize = m_texture3DAttachment->GetDescriptor().m_size.m_width >> (m_dstMipLevel - 1);
+            m_shaderResourceGroup->SetConstant(m_mipFilterIndex, static_cast<uint32_t>(m_mipFilter));
+            m_shaderResourceGroup->SetConstant(m_srcPixelSizeIndex, srcPixelSize);
+        }
+        AZ::RPI::ComputePass::CompileResources(context);
+    }
+
+    bool CloudTextureMipReductionPass::IsEnabled() const
+    {
+        if (!AZ::RPI::Pass::IsEnabled())
+        {
+            return false;
+        }
+
+        return !m_isFinished && m_texture3DAttachment;
+    }
+
+    bool CloudTextureMipReductionPass::SetRenderData(AZ::Data::Instance<AZ::RPI::AttachmentImage> texture3DAttachment,
+        uint16_t dstMipLevel, CloudTextureMipFilter mipFilter)
+    {
+        const auto& imageDesc = texture3DAttachment->GetDescriptor();
+        if ((dstMipLevel < 1) || (dstMipLevel >= imageDesc.m_mipLevels))
+        {
+            AZ_Error(LogName, false, "Invalid destination mip level %u. The attachment image has %u mip levels.\n",
+                dstMipLevel, imageDesc.m_mipLevels);
+            return false;
+        }
+
+        if ((imageDesc.m_size.m_width >> dstMipLevel) < CloudTextureComputePass::MIN_PIXEL_SIZE)
+        {
+            AZ_Error(LogName, false, "Mip level %u would be smaller than %u pixels.\n",
+                dstMipLevel, CloudTextureComputePass::MIN_PIXEL_SIZE);
+            return false;
+        }
+
+        m_texture3DAttachment = texture3DAttachment;
+        m_dstMipLevel = dstMipLevel;
+        m_mipFilter = mipFilter;
+        m_isFinished = false;
+
+        // The pass can be reused for several textures, so the attachment bindings
+        // are built again each time there's new render data.
+        QueueForBuildAndInitialization();
+        SetEnabled(true);
+        return true;
+    }
+
+    void CloudTextureMipReductionPass::ClearRenderData()
+    {
+        if (!m_texture3DAttachment)
+        {
+            return;
+        }
+        m_texture3DAttachment = nullptr;
+        m_isFinished = false;
+        // Drops the bindings to the attachment image.
+        QueueForBuildAndInitialization();
+        SetEnabled(false);
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,75 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+#pragma once
+
+#include <AzCore/Memory/SystemAllocator.h>
+
+#include <Atom/RPI.Public/Pass/ComputePass.h>
+#include <Atom/RPI.Reflect/Pass/ComputePassData.h>
+#include <Atom/RPI.Reflect/Pass/PassDescriptor.h>
+
+#include "CloudTextureComputeData.h"
+
+namespace VolumetricClouds
+{
+    //! Downsamples one mip level of the Texture3D generated by the CloudTextureComputePass
+    //! into the next mip level. The CloudTexturePipeline owns one of these passes for each
+    //! possible mip level (except mip 0), and the passes run in order, so each mip level
+    //! is downsampled from the previous one.
+    class CloudTextureMipReductionPass
+        : public AZ::RPI::ComputePass
+    {
+        AZ_RPI_PASS(CloudTextureMipReductionPass);
+
+    public:
+        AZ_RTTI(CloudTextureMipReductionPass, "{B0D20C89-A044-47B9-8756-C32B811F06C0}", AZ::RPI::ComputePass);
+        AZ_CLASS_ALLOCATOR(CloudTextureMipReductionPass, AZ::SystemAllocator);
+        virtual ~CloudTextureMipReductionPass() = default;
+
+        static AZ::RPI::Ptr<CloudTextureMipReductionPass> Create(const AZ::RPI::PassDescriptor& descriptor);
+
+        // Must be called before the pipeline that owns this pass runs. Can be called again,
+        // once the pass is finished, to downsample another texture.
+        // @dstMipLevel is the mip level written by this pass, and it will be
+        // downsampled from (dstMipLevel - 1). Must be at least 1.
+        bool SetRenderData(AZ::Data::Instance<AZ::RPI::AttachmentImage> texture3DAttachment,
+                           uint16_t dstMipLevel, CloudTextureMipFilter mipFilter);
+        // Releases the attachment image and disables the pass.
+        void ClearRenderData();
+        bool IsFinished() { return m_isFinished; }
+
+        //! Besides the standard enable flag,
+        //! The pass is disabled once it has run, or if it doesn't have render data.
+        bool IsEnabled() const override;
+
+    private:
+        CloudTextureMipReductionPass(const AZ::RPI::PassDescriptor& descriptor);
+
+        static constexpr char LogName[] = "CloudTextureMipReductionPass";
+
+        // Pass overrides
+        void BuildInternal() override;
+
+        // ScopeProducer overrides
+        void SetupFrameGraphDependencies(AZ::RHI::FrameGraphInterface frameGraph) override;
+        void CompileResources(const AZ::RHI::FrameGraphCompileContext& context) override;
+
+        // RenderPass overrides
+        void FrameEndInternal() override;
+
+        AZ::RHI::ShaderInputNameIndex m_mipFilterIndex = "m_mipFilter";
+        AZ::RHI::ShaderInputNameIndex m_srcPixelSizeIndex = "m_srcPixelSize";
+
+        // This pass runs in one frame, and when done this becomes true.
+        bool m_isFinished = false;
+
+        AZ::Data::Instance<AZ::RPI::AttachmentImage> m_texture3DAttachment;
+        uint16_t m_dstMipLevel = 1;
+        CloudTextureMipFilter m_mipFilter = CloudTextureMipFilter::Kaiser;
+    };
+
+} // namespace VolumetricClouds
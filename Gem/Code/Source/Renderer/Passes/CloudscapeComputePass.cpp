@@ -17,7 +17,10 @@
 #include <Atom/RHI/PipelineState.h>
 
 #include <Renderer/CloudscapeFeatureProcessor.h>
+#include "CloudTextureComputePass.h"
 #include "CloudscapeComputePass.h"
+#include "CloudscapeTileClassificationPass.h"
+#include "DepthBufferCopyPass.h"
 
 namespace VolumetricClouds
 {
@@ -72,6 +75,39 @@ namespace VolumetricClouds
         AttachImageToSlot(slotName, attachmentImage);
     }
 
+    void CloudscapeComputePass::SetOpticalDepthVolumeBinding(AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage)
+    {
+        const auto slotName = AZ::Name("OpticalDepthVolume");
+        auto binding = FindAttachmentBinding(slotName);
+        AZ_Assert(!!binding, "Failed to find attachment binding for slot %s", slotName.GetCStr());
+
+        // Starts as "NoBind" for the same reason as the outputs, see SetImageAttachmentBinding().
+        binding->m_shaderInputName = AZ::Name("m_opticalDepthVolume");
+
+        AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create(attachmentImage->GetDescriptor().m_format,
+            0, 0);
+        binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+
+        AttachImageToSlot(slotName, attachmentImage);
+    }
+
+    void CloudscapeComputePass::SetHistoryConfidenceBinding(uint32_t attachmentIndex, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage)
+    {
+        const AZStd::string slotNameStr = AZStd::string::format("HistoryConfidence%u", attachmentIndex);
+        const auto slotName = AZ::Name(slotNameStr);
+        auto binding = FindAttachmentBinding(slotName);
+        AZ_Assert(!!binding, "Failed to find attachment binding for slot %s", slotName.GetCStr());
+
+        // Starts as "NoBind" for the same reason as the outputs, see SetImageAttachmentBinding().
+        binding->m_shaderInputName = AZ::Name("m_historyConfidence");
+
+        AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create(attachmentImage->GetDescriptor().m_format,
+            0, 0);
+        binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+
+        AttachImageToSlot(slotName, attachmentImage);
+    }
+
 
     void CloudscapeComputePass::BuildInternal()
     {
@@ -87,23 +123,19 @@ namespace VolumetricClouds
         // Bind the first attachment
         SetImageAttachmentBinding(0, output0ImageAttachment);
         SetImageAttachmentBinding(1, cloudscapeFeatureProcessor->GetOutput1ImageAttachment());
-
-        const auto attachmentSize = output0ImageAttachment->GetDescriptor().m_size;
-
-        // Each Thread is invoked to write to 1 out of 16 pixels (0..15)
-        // in 4x4 block.
-        // Which means the total thread counts in X = ceil(imageWidth/4)
-        // and for Y = ceil(imageHeight/4);
-        // REMARK: Each frame, the feature processor will call UpdateFrameCounter(), which will
-        // define the pixel index in the range 0..15.
-        
-        //const auto totalThreadsX = attachmentSize.m_width;
-        //const auto totalThreadsY = attachmentSize.m_height;
-
-        const auto totalThreadsX = static_cast<uint32_t>(AZStd::ceil(static_cast<float>(attachmentSize.m_width) / 4.0f));
-        const auto totalThreadsY = static_cast<uint32_t>(AZStd::ceil(static_cast<float>(attachmentSize.m_height) / 4.0f));
-
-        SetTargetThreadCounts(totalThreadsX, totalThreadsY, 1);
+        SetHistoryConfidenceBinding(0, cloudscapeFeatureProcessor->GetHistoryConfidence0ImageAttachment());
+        SetHistoryConfidenceBinding(1, cloudscapeFeatureProcessor->GetHistoryConfidence1ImageAttachment());
+        SetOpticalDepthVolumeBinding(cloudscapeFeatureProcessor->GetOpticalDepthVolumeImageAttachment());
+        DepthBufferCopyPass::SetPreviousFrameDepthBinding(*this, cloudscapeFeatureProcessor->GetPreviousFrameDepthImageAttachment());
+
+        // The thread group count comes from the dispatch arguments written by the CloudscapeTileClassificationPass.
+        CloudscapeTileClassificationPass::SetBufferAttachmentBinding(*this, "TileDispatchArgs", nullptr,
+            cloudscapeFeatureProcessor->GetTileDispatchArgsBuffer());
+        CloudscapeTileClassificationPass::SetBufferAttachmentBinding(*this, "TileList", "m_tileList",
+            cloudscapeFeatureProcessor->GetTileListBuffer());
+
+        // Sets up the indirect dispatch from the "TileDispatchArgs" slot.
+        AZ::RPI::ComputePass::BuildInternal();
     }
 
     // void CloudscapeComputePass::FrameBeginInternal(FramePrepareParams params)
@@ -122,7 +154,12 @@ namespace VolumetricClouds
     {
        AZ_Assert(m_shaderResourceGroup != nullptr, "CloudscapeComputePass %s has a null shader resource group when calling Compile.", GetPathName().GetCStr());
 
-       m_shaderResourceGroup->SetConstant(m_pixelIndex4x4Index, m_pixelIndex4x4);
+       m_shaderResourceGroup->SetConstant(m_updateBlockSizeIndex, m_updateBlockSize);
+       m_shaderResourceGroup->SetConstant(m_updatePixelOffsetIndex, m_updatePixelOffset);
+       m_shaderResourceGroup->SetConstant(m_outputTextureIndexIndex, m_outputTextureIndex);
+       // Without accumulation a different jitter each frame would only make the clouds flicker.
+       const bool isAccumulating = m_shaderConstantData && (m_shaderConstantData->m_temporalBlendFactor < 1.0f);
+       m_shaderResourceGroup->SetConstant(m_jitterFrameIndexIndex, isAccumulating ? m_jitterFrameIndex : 0u);
 
        if (m_srgNeedsUpdate && m_shaderConstantData)
        {
@@ -133,6 +170,8 @@ namespace VolumetricClouds
            const auto maxSteps = AZStd::max<uint32_t>(m_shaderConstantData->m_minRayMarchingSteps, m_shaderConstantData->m_maxRayMarchingSteps);
            m_shaderResourceGroup->SetConstant(m_minRayMarchingStepsIndex, minSteps);
            m_shaderResourceGroup->SetConstant(m_maxRayMarchingStepsIndex, maxSteps);
+           m_shaderResourceGroup->SetConstant(m_occludedPixelPolicyIndex, m_shaderConstantData->m_occludedPixelPolicy);
+           m_shaderResourceGroup->SetConstant(m_temporalBlendFactorIndex, AZStd::clamp(m_shaderConstantData->m_temporalBlendFactor, 0.0f, 1.0f));
 
 
            m_shaderResourceGroup->SetConstant(m_planetRadiusKmIndex, static_cast<float>(m_shaderConstantData->m_planetRadiusKm));
@@ -175,6 +214,17 @@ namespace VolumetricClouds
            m_shaderResourceGroup->SetImage(m_lowFreqNoiseTextureImageIndex, m_shaderConstantData->m_lowFrequencyNoiseTexture);
            m_shaderResourceGroup->SetImage(m_highFreqNoiseTextureImageIndex, m_shaderConstantData->m_highFrequencyNoiseTexture);
            m_shaderResourceGroup->SetImage(m_weatherMapImageIndex, m_shaderConstantData->m_weatherMap);
+           // Until the pyramid is ready the weather map is bound in its place, the shader doesn't read it
+           // when the level count is 0.
+           const bool hasWeatherMapPyramid = !!m_shaderConstantData->m_weatherMapPyramid;
+           m_shaderResourceGroup->SetImage(m_weatherMapPyramidImageIndex,
+               hasWeatherMapPyramid ? m_shaderConstantData->m_weatherMapPyramid : m_shaderConstantData->m_weatherMap);
+           m_shaderResourceGroup->SetConstant(m_weatherMapPyramidLevelsIndex,
+               hasWeatherMapPyramid ? m_shaderConstantData->m_weatherMapPyramidLevels : 0u);
+
+           m_shaderResourceGroup->SetConstant(m_opticalDepthVolumeSizeKmIndex, m_shaderConstantData->m_opticalDepthVolumeSizeKm);
+
+           UpdateShaderOptions();
 
            m_srgNeedsUpdate = false;
        }
@@ -191,10 +241,17 @@ namespace VolumetricClouds
 
     void CloudscapeComputePass::UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData)
     {
-        // If any of the textures is nullptr we disable this pass.
+        if (shaderData.m_lowFrequencyNoiseTexture && shaderData.m_highFrequencyNoiseTexture)
+        {
+            ReportUnsupportedNoiseTexture(shaderData.m_lowFrequencyNoiseTexture, false, m_reportedLowFreqNoiseTexture);
+            ReportUnsupportedNoiseTexture(shaderData.m_highFrequencyNoiseTexture, true, m_reportedHighFreqNoiseTexture);
+        }
+
+        // If any of the textures is nullptr, or can't be sampled, we disable this pass.
         if (!shaderData.m_lowFrequencyNoiseTexture ||
             !shaderData.m_highFrequencyNoiseTexture ||
-            !shaderData.m_weatherMap)
+            !shaderData.m_weatherMap ||
+            !AreNoiseTexturesSupported(shaderData))
         {
             m_shaderConstantData = nullptr;
             SetEnabled(false);
@@ -211,9 +268,105 @@ namespace VolumetricClouds
     }
 
 
-    void CloudscapeComputePass::UpdateFrameCounter(uint32_t frameCounter)
+    void CloudscapeComputePass::UpdateShaderOptions()
+    {
+        m_shaderOptionGroup = m_shader->CreateShaderOptionGroup();
+        m_shaderOptionGroup.SetValue(m_lowFreqNoiseLayoutOptionName,
+            GetNoiseLayoutOptionValue("LowFreqNoiseLayout", m_shaderConstantData->m_lowFrequencyNoiseTexture));
+        m_shaderOptionGroup.SetValue(m_highFreqNoiseLayoutOptionName,
+            GetNoiseLayoutOptionValue("HighFreqNoiseLayout", m_shaderConstantData->m_highFrequencyNoiseTexture));
+        m_shaderOptionGroup.SetValue(m_useOpticalDepthVolumeOptionName,
+            m_shaderConstantData->m_useOpticalDepthVolume ? AZ::Name("true") : AZ::Name("false"));
+
+        const auto qualitySettings = CloudscapeQualitySettings::Get(static_cast<CloudscapeQualityTier>(m_shaderConstantData->m_qualityTier));
+        m_shaderOptionGroup.SetValue(m_lightSampleCountOptionName, AZ::RPI::ShaderOptionValue(qualitySettings.m_lightSampleCount));
+        m_shaderOptionGroup.SetValue(m_maxOctavesOptionName, AZ::RPI::ShaderOptionValue(qualitySettings.m_maxOctaves));
+        m_shaderOptionGroup.SetValue(m_largeStepIncrementOptionName, AZ::RPI::ShaderOptionValue(qualitySettings.m_largeStepIncrement));
+        m_shaderOptionGroup.SetValue(m_dualLobeWeightQuartersOptionName, AZ::RPI::ShaderOptionValue(qualitySettings.m_dualLobeWeightQuarters));
+        m_shaderOptionGroup.SetValue(m_highFrequencyDetailOptionName,
+            qualitySettings.m_highFrequencyDetail ? AZ::Name("true") : AZ::Name("false"));
+        m_shaderOptionGroup.SetUnspecifiedToDefaultValues();
+
+        // The quality options of each tier are baked in CloudscapeCS.shadervariantlist. This picks the pipeline state
+        // of that variant, so its loops are unrolled. The noise layout and optical depth options are not baked, and still
+        // go through the fallback key. Until the variant is loaded, everything goes through the fallback key of the root variant,
+        // and OnShaderReloadedInternal() calls this function again once it is.
+        m_shaderResourceGroup->SetShaderVariantKeyFallbackValue(m_shaderOptionGroup.GetShaderVariantKey());
+        AZ::RPI::ComputePass::UpdateShaderOptions(m_shaderOptionGroup.GetShaderVariantId());
+    }
+
+    bool CloudscapeComputePass::GetNoiseTextureChannelLayout(const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture, CloudTextureChannelLayout& channelLayout)
+    {
+        const auto format = noiseTexture->GetDescriptor().m_format;
+        if (format == AZ::RHI::Format::BC7_UNORM)
+        {
+            // The NoiseBaker compresses all the channels of the RGBA8 layout to BC7.
+            channelLayout = CloudTextureChannelLayout::RGBA8;
+            return true;
+        }
+        // BC4 and BC5 hold raw channels of the RGBA8 layout, which don't match the RG8 and R8 layouts.
+        return CloudTextureComputePass::GetChannelLayout(format, channelLayout);
+    }
+
+    AZ::Name CloudscapeComputePass::GetNoiseLayoutOptionValue(const char* optionEnumName, const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture)
+    {
+        // Same order as VolumetricClouds::CloudTextureChannelLayout.
+        static constexpr const char* LayoutNames[] = { "RGBA8", "RG8", "R8", "R16F" };
+
+        // The passes are disabled while a noise texture is not supported, see UpdateShaderConstantData().
+        CloudTextureChannelLayout channelLayout = CloudTextureChannelLayout::RGBA8;
+        GetNoiseTextureChannelLayout(noiseTexture, channelLayout);
+        return AZ::Name(AZStd::string::format("%s::%s", optionEnumName, LayoutNames[static_cast<uint32_t>(channelLayout)]));
+    }
+
+    bool CloudscapeComputePass::IsNoiseTextureSupported(const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture, bool isHighFrequencyNoise)
+    {
+        CloudTextureChannelLayout channelLayout = CloudTextureChannelLayout::RGBA8;
+        if (!GetNoiseTextureChannelLayout(noiseTexture, channelLayout))
+        {
+            return false;
+        }
+        return !isHighFrequencyNoise || CloudTextureFormat::HasDetailNoise(channelLayout);
+    }
+
+    bool CloudscapeComputePass::AreNoiseTexturesSupported(const CloudscapeShaderConstantData& shaderData)
+    {
+        return IsNoiseTextureSupported(shaderData.m_lowFrequencyNoiseTexture, false) &&
+            IsNoiseTextureSupported(shaderData.m_highFrequencyNoiseTexture, true);
+    }
+
+    void CloudscapeComputePass::ReportUnsupportedNoiseTexture(const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture,
+        bool isHighFrequencyNoise, const AZ::RPI::Image*& lastReportedTexture)
+    {
+        if (IsNoiseTextureSupported(noiseTexture, isHighFrequencyNoise))
+        {
+            lastReportedTexture = nullptr;
+            return;
+        }
+        // This is called on every update of the shader constant data, each texture is reported once.
+        if (lastReportedTexture != noiseTexture.get())
+        {
+            lastReportedTexture = noiseTexture.get();
+            CloudTextureChannelLayout channelLayout = CloudTextureChannelLayout::RGBA8;
+            if (!GetNoiseTextureChannelLayout(noiseTexture, channelLayout))
+            {
+                AZ_Error(LogName, false, "Noise texture format %s doesn't match any channel layout. The cloudscape is disabled until it is replaced.",
+                    AZ::RHI::ToString(noiseTexture->GetDescriptor().m_format));
+            }
+            else
+            {
+                AZ_Error(LogName, false, "The high frequency noise texture format %s has no detail noise, use the RGBA8 or RG8 layout. "
+                    "The cloudscape is disabled until it is replaced.", AZ::RHI::ToString(noiseTexture->GetDescriptor().m_format));
+            }
+        }
+    }
+
+    void CloudscapeComputePass::UpdateFrameCounter(uint32_t frameCounter, const CloudscapeUpdatePattern& updatePattern)
     {
-        m_pixelIndex4x4 = frameCounter % 16;
+        m_outputTextureIndex = frameCounter % 2;
+        m_jitterFrameIndex = frameCounter % JitterFrameCount;
+        updatePattern.GetPixelOffset(frameCounter, m_updatePixelOffset[0], m_updatePixelOffset[1]);
+        m_updateBlockSize = updatePattern.GetBlockSize();
     }
 
     // ComputePass overrides...
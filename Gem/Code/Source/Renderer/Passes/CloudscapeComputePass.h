@@ -18,6 +18,8 @@
 #include <Atom/RPI.Public/Image/StreamingImage.h>
 
 #include <Renderer/CloudscapeShaderConstantData.h>
+#include <Renderer/Passes/CloudTextureComputeData.h>
+#include <Renderer/Cpu/CloudscapeUpdatePattern.h>
 
 namespace VolumetricClouds
 {
@@ -28,8 +30,11 @@ namespace VolumetricClouds
      *  we only render to one of them in an alternated (aka ping pong) fashion.
      *  The idea is that one of the attachments carries the pixel from the previous frame.
      *  while the other is the one we are going to write to in the current frame.
-     *  When we are rendering to the current frame we only render to 1 of 16 pixels
-     *  in a 4x4 block.
+     *  When we are rendering to the current frame we only render to 1 pixel
+     *  of each NxN block, see CloudscapeUpdatePattern.
+     *  That pixel is blended with its history, see CloudscapeTemporalAccumulation.
+     *  The pass is dispatched indirectly, one thread group per tile of blocks that the
+     *  CloudscapeTileClassificationPass found worth ray marching, see CloudscapeRaymarchTiles.
      */
     class CloudscapeComputePass final
         : public AZ::RPI::ComputePass
@@ -47,11 +52,29 @@ namespace VolumetricClouds
 
         void UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData);
 
-        void UpdateFrameCounter(uint32_t frameCounter);
+        // @updatePattern defines which pixel of each block is ray marched at @frameCounter.
+        void UpdateFrameCounter(uint32_t frameCounter, const CloudscapeUpdatePattern& updatePattern);
+
+        // Returns the name of the shader option value, e.g. "LowFreqNoiseLayout::RG8", for the format of @noiseTexture.
+        // Also used by the CloudscapeOpticalDepthPass, which samples the same noise textures.
+        static AZ::Name GetNoiseLayoutOptionValue(const char* optionEnumName, const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture);
+
+        // Gets the channel layout of @noiseTexture from its format. BC7 textures hold the RGBA8 layout.
+        // Returns false for the formats that match no layout, e.g. BC4 and BC5.
+        static bool GetNoiseTextureChannelLayout(const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture, CloudTextureChannelLayout& channelLayout);
+
+        // Whether @noiseTexture can be sampled by the cloudscape shaders. The high frequency texture
+        // also needs the detail noise, so the single channel layouts are only supported as low frequency noise.
+        static bool IsNoiseTextureSupported(const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture, bool isHighFrequencyNoise);
+
+        // Whether both noise textures of @shaderData, which must not be null, can be sampled by the cloudscape shaders.
+        static bool AreNoiseTexturesSupported(const CloudscapeShaderConstantData& shaderData);
     
     private:
         CloudscapeComputePass(const AZ::RPI::PassDescriptor& descriptor);
 
+        static constexpr char LogName[] = "CloudscapeComputePass";
+
         //! Pass behavior overrides
         void InitializeInternal() override;
         void BuildInternal() override;
@@ -67,17 +90,47 @@ namespace VolumetricClouds
 
         // A helper function
         void SetImageAttachmentBinding(uint32_t attachmentIndex, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
+
+        // Binds the optical depth volume, written by the CloudscapeOpticalDepthPass, to the "OpticalDepthVolume" slot.
+        void SetOpticalDepthVolumeBinding(AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
+
+        // Binds the history confidence of the output @attachmentIndex to the "HistoryConfidence<attachmentIndex>" slot.
+        // The CloudscapeReprojectionComputePass gets them through its connections to these slots.
+        void SetHistoryConfidenceBinding(uint32_t attachmentIndex, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
+
+        // Selects, in CloudscapeCS.azsl, the fetch path that matches the channel layout of each noise texture,
+        // whether the optical depth towards the sun is read from the optical depth volume, and the quality options
+        // of CloudscapeShaderConstantData::m_qualityTier. Switches to the baked variant of the tier when available.
+        void UpdateShaderOptions();
+
+        // Reports with an error when @noiseTexture is not supported, unless it is @lastReportedTexture.
+        static void ReportUnsupportedNoiseTexture(const AZ::Data::Instance<AZ::RPI::Image>& noiseTexture, bool isHighFrequencyNoise,
+            const AZ::RPI::Image*& lastReportedTexture);
     
         bool m_srgNeedsUpdate = true;
         const CloudscapeShaderConstantData* m_shaderConstantData = nullptr;
-        uint32_t m_pixelIndex4x4 = 0; // Frame Counter % 16.
-
-        AZ::RHI::ShaderInputNameIndex m_pixelIndex4x4Index = "m_pixelIndex4x4";
+        // The last unsupported noise textures that were reported. Only compared, never dereferenced.
+        const AZ::RPI::Image* m_reportedLowFreqNoiseTexture = nullptr;
+        const AZ::RPI::Image* m_reportedHighFreqNoiseTexture = nullptr;
+        // Updated each frame by UpdateFrameCounter().
+        uint32_t m_updateBlockSize = CloudscapeUpdatePattern::DefaultBlockSize;
+        uint32_t m_updatePixelOffset[2] = { 0, 0 };
+        uint32_t m_outputTextureIndex = 0; // Frame Counter % 2.
+        // Frame Counter % JitterFrameCount. Offsets the ray marching jitter while the temporal accumulation is enabled.
+        static constexpr uint32_t JitterFrameCount = 64;
+        uint32_t m_jitterFrameIndex = 0;
+
+        AZ::RHI::ShaderInputNameIndex m_updateBlockSizeIndex = "m_updateBlockSize";
+        AZ::RHI::ShaderInputNameIndex m_updatePixelOffsetIndex = "m_updatePixelOffset";
+        AZ::RHI::ShaderInputNameIndex m_outputTextureIndexIndex = "m_outputTextureIndex";
+        AZ::RHI::ShaderInputNameIndex m_jitterFrameIndexIndex = "m_jitterFrameIndex";
 
         AZ::RHI::ShaderInputNameIndex m_uvwScaleIndex = "m_uvwScale";
         AZ::RHI::ShaderInputNameIndex m_maxMipLevelsIndex = "m_maxMipLevels";
         AZ::RHI::ShaderInputNameIndex m_minRayMarchingStepsIndex = "m_minRayMarchingSteps";
         AZ::RHI::ShaderInputNameIndex m_maxRayMarchingStepsIndex = "m_maxRayMarchingSteps";
+        AZ::RHI::ShaderInputNameIndex m_occludedPixelPolicyIndex = "m_occludedPixelPolicy";
+        AZ::RHI::ShaderInputNameIndex m_temporalBlendFactorIndex = "m_temporalBlendFactor";
 
         AZ::RHI::ShaderInputNameIndex m_planetRadiusKmIndex = "m_planetRadiusKm";
         AZ::RHI::ShaderInputNameIndex m_cloudSlabDistanceAboveSeaLevelKmIndex = "m_cloudSlabDistanceAboveSeaLevelKm";
@@ -102,6 +155,20 @@ namespace VolumetricClouds
         AZ::RHI::ShaderInputNameIndex m_lowFreqNoiseTextureImageIndex = "m_lowFreqNoiseTexture";
         AZ::RHI::ShaderInputNameIndex m_highFreqNoiseTextureImageIndex = "m_highFreqNoiseTexture";
         AZ::RHI::ShaderInputNameIndex m_weatherMapImageIndex = "m_weatherMap";
+        AZ::RHI::ShaderInputNameIndex m_weatherMapPyramidImageIndex = "m_weatherMapPyramid";
+        AZ::RHI::ShaderInputNameIndex m_weatherMapPyramidLevelsIndex = "m_weatherMapPyramidLevels";
+
+        AZ::RHI::ShaderInputNameIndex m_opticalDepthVolumeSizeKmIndex = "m_opticalDepthVolumeSizeKm";
+
+        AZ::RPI::ShaderOptionGroup m_shaderOptionGroup;
+        const AZ::Name m_lowFreqNoiseLayoutOptionName{"o_lowFreqNoiseLayout"};
+        const AZ::Name m_highFreqNoiseLayoutOptionName{"o_highFreqNoiseLayout"};
+        const AZ::Name m_useOpticalDepthVolumeOptionName{"o_useOpticalDepthVolume"};
+        const AZ::Name m_lightSampleCountOptionName{"o_lightSampleCount"};
+        const AZ::Name m_maxOctavesOptionName{"o_maxOctaves"};
+        const AZ::Name m_largeStepIncrementOptionName{"o_largeStepIncrement"};
+        const AZ::Name m_dualLobeWeightQuartersOptionName{"o_dualLobeWeightQuarters"};
+        const AZ::Name m_highFrequencyDetailOptionName{"o_highFrequencyDetail"};
 
     };
 
@@ -0,0 +1,149 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <Atom/RPI.Public/RenderPipeline.h>
+#include <Atom/RPI.Public/Scene.h>
+
+#include <Renderer/CloudscapeFeatureProcessor.h>
+#include <Renderer/Cpu/CloudscapeOpticalDepthVolume.h>
+#include "CloudscapeComputePass.h"
+#include "CloudscapeOpticalDepthPass.h"
+
+namespace VolumetricClouds
+{
+
+    AZ::RPI::Ptr<CloudscapeOpticalDepthPass> CloudscapeOpticalDepthPass::Create(const AZ::RPI::PassDescriptor& descriptor)
+    {
+        AZ::RPI::Ptr<CloudscapeOpticalDepthPass> pass = aznew CloudscapeOpticalDepthPass(descriptor);
+        return pass;
+    }
+
+    CloudscapeOpticalDepthPass::CloudscapeOpticalDepthPass(const AZ::RPI::PassDescriptor& descriptor)
+        : AZ::RPI::ComputePass(descriptor)
+    {
+    }
+
+    void CloudscapeOpticalDepthPass::InitializeInternal()
+    {
+        AZ::RPI::ComputePass::InitializeInternal();
+
+        m_srgNeedsUpdate = (m_shaderConstantData != nullptr);
+    }
+
+    void CloudscapeOpticalDepthPass::BuildInternal()
+    {
+        AZ::RPI::Scene* scene = m_pipeline->GetScene();
+        auto* cloudscapeFeatureProcessor = scene->GetFeatureProcessor<CloudscapeFeatureProcessor>();
+        if (!cloudscapeFeatureProcessor)
+        {
+            // This can happen when the feature processor is being destroyed.
+            return;
+        }
+
+        // Same as the outputs of the CloudscapeComputePass, the *.pass asset starts with "NoBind"
+        // because the volume is created at runtime by the CloudscapeFeatureProcessor.
+        const auto opticalDepthVolume = cloudscapeFeatureProcessor->GetOpticalDepthVolumeImageAttachment();
+        const auto slotName = AZ::Name("Output");
+        auto binding = FindAttachmentBinding(slotName);
+        AZ_Assert(!!binding, "Failed to find attachment binding for slot %s", slotName.GetCStr());
+        binding->m_shaderInputName = AZ::Name("m_opticalDepthOut");
+        AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create(opticalDepthVolume->GetDescriptor().m_format,
+            0, 0);
+        binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+        AttachImageToSlot(slotName, opticalDepthVolume);
+
+        // One thread per voxel.
+        SetTargetThreadCounts(CloudscapeOpticalDepthVolume::Width, CloudscapeOpticalDepthVolume::Height, CloudscapeOpticalDepthVolume::Depth);
+    }
+
+    void CloudscapeOpticalDepthPass::CompileResources(const AZ::RHI::FrameGraphCompileContext& context)
+    {
+        AZ_Assert(m_shaderResourceGroup != nullptr, "CloudscapeOpticalDepthPass %s has a null shader resource group when calling Compile.", GetPathName().GetCStr());
+
+        if (m_srgNeedsUpdate && m_shaderConstantData)
+        {
+            // Same values as CloudscapeComputePass::CompileResources().
+            m_shaderResourceGroup->SetConstant(m_uvwScaleIndex, m_shaderConstantData->m_uvwScale);
+            m_shaderResourceGroup->SetConstant(m_maxMipLevelsIndex, m_shaderConstantData->m_clampedMipLevels);
+
+            m_shaderResourceGroup->SetConstant(m_planetRadiusKmIndex, static_cast<float>(m_shaderConstantData->m_planetRadiusKm));
+            m_shaderResourceGroup->SetConstant(m_cloudSlabDistanceAboveSeaLevelKmIndex, m_shaderConstantData->m_cloudSlabDistanceAboveSeaLevelKm);
+            m_shaderResourceGroup->SetConstant(m_cloudSlabThicknessKmIndex, m_shaderConstantData->m_cloudSlabThicknessKm);
+
+            m_shaderResourceGroup->SetConstant(m_directionTowardsTheSunIndex, m_shaderConstantData->m_directionTowardsTheSun);
+
+            // The user inputs the data in [m-1], but the shader assumes all the data is computed in Km.
+            m_shaderResourceGroup->SetConstant(m_aCoefIndex, m_shaderConstantData->m_cloudMaterialProperties.m_absorptionCoefficient * 1000.0f);
+            m_shaderResourceGroup->SetConstant(m_sCoefIndex, m_shaderConstantData->m_cloudMaterialProperties.m_scatteringCoefficient * 1000.0f);
+
+            m_shaderResourceGroup->SetConstant(m_weatherMapSizeKmIndex, m_shaderConstantData->m_weatherMapSizeKm);
+            m_shaderResourceGroup->SetConstant(m_globalCloudCoverageIndex, m_shaderConstantData->m_globalCloudCoverage);
+            m_shaderResourceGroup->SetConstant(m_globalCloudDensityIndex, m_shaderConstantData->m_globalCloudDensity);
+
+            AZ::Vector3 windDirection = m_shaderConstantData->m_windDirection;
+            const float windDirectionLength = windDirection.GetLength();
+            windDirection = AZ::IsClose(windDirectionLength, 0.0f, 0.01f)
+                ? AZ::Vector3::CreateZero()
+                : (windDirection / windDirectionLength);
+            m_shaderResourceGroup->SetConstant(m_windSpeedKmPerSecIndex, m_shaderConstantData->m_windSpeedKmPerSec);
+            m_shaderResourceGroup->SetConstant(m_windDirectionIndex, windDirection);
+            m_shaderResourceGroup->SetConstant(m_cloudTopOffsetKmIndex, m_shaderConstantData->m_cloudTopOffsetKm);
+
+            m_shaderResourceGroup->SetConstant(m_opticalDepthVolumeSizeKmIndex, m_shaderConstantData->m_opticalDepthVolumeSizeKm);
+
+            m_shaderResourceGroup->SetImage(m_lowFreqNoiseTextureImageIndex, m_shaderConstantData->m_lowFrequencyNoiseTexture);
+            m_shaderResourceGroup->SetImage(m_highFreqNoiseTextureImageIndex, m_shaderConstantData->m_highFrequencyNoiseTexture);
+            m_shaderResourceGroup->SetImage(m_weatherMapImageIndex, m_shaderConstantData->m_weatherMap);
+
+            UpdateShaderOptions();
+
+            m_srgNeedsUpdate = false;
+        }
+
+        AZ::RPI::ComputePass::CompileResources(context);
+    }
+
+    void CloudscapeOpticalDepthPass::UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData)
+    {
+        if (!shaderData.m_lowFrequencyNoiseTexture ||
+            !shaderData.m_highFrequencyNoiseTexture ||
+            !shaderData.m_weatherMap ||
+            !shaderData.m_useOpticalDepthVolume ||
+            !CloudscapeComputePass::AreNoiseTexturesSupported(shaderData))
+        {
+            m_shaderConstantData = nullptr;
+            SetEnabled(false);
+        }
+        else
+        {
+            m_shaderConstantData = &shaderData;
+            m_srgNeedsUpdate = true;
+            if (!IsEnabled())
+            {
+                SetEnabled(true);
+            }
+        }
+    }
+
+    void CloudscapeOpticalDepthPass::UpdateShaderOptions()
+    {
+        m_shaderOptionGroup = m_shader->CreateShaderOptionGroup();
+        m_shaderOptionGroup.SetValue(m_lowFreqNoiseLayoutOptionName,
+            CloudscapeComputePass::GetNoiseLayoutOptionValue("LowFreqNoiseLayout", m_shaderConstantData->m_lowFrequencyNoiseTexture));
+        m_shaderOptionGroup.SetValue(m_highFreqNoiseLayoutOptionName,
+            CloudscapeComputePass::GetNoiseLayoutOptionValue("HighFreqNoiseLayout", m_shaderConstantData->m_highFrequencyNoiseTexture));
+        m_shaderOptionGroup.SetUnspecifiedToDefaultValues();
+        m_shaderResourceGroup->SetShaderVariantKeyFallbackValue(m_shaderOptionGroup.GetShaderVariantKey());
+    }
+
+    // ComputePass overrides...
+    void CloudscapeOpticalDepthPass::OnShaderReloadedInternal()
+    {
+        m_srgNeedsUpdate = true;
+    }
+
+}   // namespace VolumetricClouds
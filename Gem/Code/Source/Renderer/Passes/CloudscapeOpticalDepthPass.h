@@ -0,0 +1,94 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+#pragma once
+
+#include <AzCore/Memory/SystemAllocator.h>
+
+#include <Atom/RPI.Public/Pass/ComputePass.h>
+#include <Atom/RPI.Public/Shader/Shader.h>
+#include <Atom/RPI.Public/Shader/ShaderResourceGroup.h>
+
+#include <Renderer/CloudscapeShaderConstantData.h>
+
+namespace VolumetricClouds
+{
+    /**
+     *  Runs before the CloudscapeComputePass. Each frame it calculates, for every voxel
+     *  of the optical depth volume owned by the CloudscapeFeatureProcessor, the optical depth
+     *  towards the sun. The CloudscapeComputePass then reads it with a single fetch per raymarching step,
+     *  instead of cone sampling the cloud density towards the sun.
+     *  See CloudscapeOpticalDepthCS.azsl, and CloudscapeOpticalDepthVolume for the CPU version.
+     */
+    class CloudscapeOpticalDepthPass final
+        : public AZ::RPI::ComputePass
+    {
+        AZ_RPI_PASS(CloudscapeOpticalDepthPass);
+
+    public:
+        AZ_RTTI(CloudscapeOpticalDepthPass, "{9B3D3E79-8973-43FE-B646-EEC2C2AFE6E4}", AZ::RPI::ComputePass);
+        AZ_CLASS_ALLOCATOR(CloudscapeOpticalDepthPass, AZ::SystemAllocator);
+
+        virtual ~CloudscapeOpticalDepthPass() = default;
+
+        static AZ::RPI::Ptr<CloudscapeOpticalDepthPass> Create(const AZ::RPI::PassDescriptor& descriptor);
+
+        // The pass is disabled when any of the textures is missing, or when
+        // CloudscapeShaderConstantData::m_useOpticalDepthVolume is false.
+        void UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData);
+
+    private:
+        CloudscapeOpticalDepthPass(const AZ::RPI::PassDescriptor& descriptor);
+
+        static constexpr char LogName[] = "CloudscapeOpticalDepthPass";
+
+        //! Pass behavior overrides
+        void InitializeInternal() override;
+        void BuildInternal() override;
+
+        // Scope producer functions...
+        void CompileResources(const AZ::RHI::FrameGraphCompileContext& context) override;
+
+        // ComputePass overrides...
+        void OnShaderReloadedInternal() override;
+
+        // Selects, in CloudscapeOpticalDepthCS.azsl, the fetch path that matches the channel layout of each noise texture.
+        void UpdateShaderOptions();
+
+        bool m_srgNeedsUpdate = true;
+        const CloudscapeShaderConstantData* m_shaderConstantData = nullptr;
+
+        AZ::RHI::ShaderInputNameIndex m_uvwScaleIndex = "m_uvwScale";
+        AZ::RHI::ShaderInputNameIndex m_maxMipLevelsIndex = "m_maxMipLevels";
+
+        AZ::RHI::ShaderInputNameIndex m_planetRadiusKmIndex = "m_planetRadiusKm";
+        AZ::RHI::ShaderInputNameIndex m_cloudSlabDistanceAboveSeaLevelKmIndex = "m_cloudSlabDistanceAboveSeaLevelKm";
+        AZ::RHI::ShaderInputNameIndex m_cloudSlabThicknessKmIndex = "m_cloudSlabThicknessKm";
+
+        AZ::RHI::ShaderInputNameIndex m_directionTowardsTheSunIndex = "m_directionTowardsTheSun";
+
+        AZ::RHI::ShaderInputNameIndex m_aCoefIndex = "m_aCoef";
+        AZ::RHI::ShaderInputNameIndex m_sCoefIndex = "m_sCoef";
+
+        AZ::RHI::ShaderInputNameIndex m_weatherMapSizeKmIndex = "m_weatherMapSizeKm";
+        AZ::RHI::ShaderInputNameIndex m_globalCloudCoverageIndex = "m_globalCloudCoverage";
+        AZ::RHI::ShaderInputNameIndex m_globalCloudDensityIndex = "m_globalCloudDensity";
+        AZ::RHI::ShaderInputNameIndex m_windSpeedKmPerSecIndex = "m_windSpeedKmPerSec";
+        AZ::RHI::ShaderInputNameIndex m_windDirectionIndex = "m_windDirection";
+        AZ::RHI::ShaderInputNameIndex m_cloudTopOffsetKmIndex = "m_cloudTopOffsetKm";
+
+        AZ::RHI::ShaderInputNameIndex m_opticalDepthVolumeSizeKmIndex = "m_opticalDepthVolumeSizeKm";
+
+        AZ::RHI::ShaderInputNameIndex m_lowFreqNoiseTextureImageIndex = "m_lowFreqNoiseTexture";
+        AZ::RHI::ShaderInputNameIndex m_highFreqNoiseTextureImageIndex = "m_highFreqNoiseTexture";
+        AZ::RHI::ShaderInputNameIndex m_weatherMapImageIndex = "m_weatherMap";
+
+        AZ::RPI::ShaderOptionGroup m_shaderOptionGroup;
+        const AZ::Name m_lowFreqNoiseLayoutOptionName{"o_lowFreqNoiseLayout"};
+        const AZ::Name m_highFreqNoiseLayoutOptionName{"o_highFreqNoiseLayout"};
+    };
+
+}   // namespace VolumetricClouds
@@ -0,0 +1,178 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <Atom/RPI.Public/RenderPipeline.h>
+#include <Atom/RPI.Public/Scene.h>
+
+#include <Renderer/CloudscapeFeatureProcessor.h>
+#include <Renderer/Cpu/CloudscapeRaymarchTiles.h>
+#include "CloudscapeComputePass.h"
+#include "CloudscapeTileClassificationPass.h"
+#include "DepthBufferCopyPass.h"
+
+namespace VolumetricClouds
+{
+
+    AZ::RPI::Ptr<CloudscapeTileClassificationPass> CloudscapeTileClassificationPass::Create(const AZ::RPI::PassDescriptor& descriptor)
+    {
+        AZ::RPI::Ptr<CloudscapeTileClassificationPass> pass = aznew CloudscapeTileClassificationPass(descriptor);
+        return pass;
+    }
+
+    CloudscapeTileClassificationPass::CloudscapeTileClassificationPass(const AZ::RPI::PassDescriptor& descriptor)
+        : AZ::RPI::ComputePass(descriptor)
+    {
+    }
+
+    void CloudscapeTileClassificationPass::InitializeInternal()
+    {
+        AZ::RPI::ComputePass::InitializeInternal();
+
+        m_srgNeedsUpdate = (m_shaderConstantData != nullptr);
+    }
+
+    void CloudscapeTileClassificationPass::SetImageAttachmentBinding(uint32_t attachmentIndex, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage)
+    {
+        // Same as CloudscapeComputePass::SetImageAttachmentBinding().
+        const AZStd::string slotNameStr = AZStd::string::format("Output%u", attachmentIndex);
+        const auto slotName = AZ::Name(slotNameStr);
+        auto binding = FindAttachmentBinding(slotName);
+        AZ_Assert(!!binding, "Failed to find attachment binding for slot %s", slotName.GetCStr());
+        binding->m_shaderInputName = AZ::Name("m_cloudscapeOut");
+        AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create(attachmentImage->GetDescriptor().m_format,
+            0, 0);
+        binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+        AttachImageToSlot(slotName, attachmentImage);
+    }
+
+    void CloudscapeTileClassificationPass::SetHistoryConfidenceBinding(uint32_t attachmentIndex, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage)
+    {
+        const AZStd::string slotNameStr = AZStd::string::format("HistoryConfidence%u", attachmentIndex);
+        const auto slotName = AZ::Name(slotNameStr);
+        auto binding = FindAttachmentBinding(slotName);
+        AZ_Assert(!!binding, "Failed to find attachment binding for slot %s", slotName.GetCStr());
+        binding->m_shaderInputName = AZ::Name("m_historyConfidence");
+        AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create(attachmentImage->GetDescriptor().m_format,
+            0, 0);
+        binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+        AttachImageToSlot(slotName, attachmentImage);
+    }
+
+    void CloudscapeTileClassificationPass::SetBufferAttachmentBinding(AZ::RPI::Pass& pass, const char* slotName, const char* shaderInputName,
+        AZ::Data::Instance<AZ::RPI::Buffer> buffer)
+    {
+        const auto slotNameId = AZ::Name(slotName);
+        auto binding = pass.FindAttachmentBinding(slotNameId);
+        AZ_Assert(!!binding, "Failed to find attachment binding for slot %s", slotName);
+
+        // Starts as "NoBind" for the same reason as the outputs, see CloudscapeComputePass::SetImageAttachmentBinding().
+        // The dispatch arguments slot of the CloudscapeComputePass is not bound to the shader, @shaderInputName is null.
+        if (shaderInputName)
+        {
+            binding->m_shaderInputName = AZ::Name(shaderInputName);
+        }
+        binding->m_unifiedScopeDesc.SetAsBuffer(buffer->GetBufferViewDescriptor());
+
+        pass.AttachBufferToSlot(slotNameId, buffer);
+    }
+
+    void CloudscapeTileClassificationPass::BuildInternal()
+    {
+        AZ::RPI::Scene* scene = m_pipeline->GetScene();
+        auto* cloudscapeFeatureProcessor = scene->GetFeatureProcessor<CloudscapeFeatureProcessor>();
+        if (!cloudscapeFeatureProcessor)
+        {
+            // This can happen when the feature processor is being destroyed.
+            return;
+        }
+
+        const auto output0ImageAttachment = cloudscapeFeatureProcessor->GetOutput0ImageAttachment();
+        SetImageAttachmentBinding(0, output0ImageAttachment);
+        SetImageAttachmentBinding(1, cloudscapeFeatureProcessor->GetOutput1ImageAttachment());
+        SetHistoryConfidenceBinding(0, cloudscapeFeatureProcessor->GetHistoryConfidence0ImageAttachment());
+        SetHistoryConfidenceBinding(1, cloudscapeFeatureProcessor->GetHistoryConfidence1ImageAttachment());
+        SetBufferAttachmentBinding(*this, "TileDispatchArgs", "m_tileDispatchArgs", cloudscapeFeatureProcessor->GetTileDispatchArgsBuffer());
+        SetBufferAttachmentBinding(*this, "TileList", "m_tileList", cloudscapeFeatureProcessor->GetTileListBuffer());
+        DepthBufferCopyPass::SetPreviousFrameDepthBinding(*this, cloudscapeFeatureProcessor->GetPreviousFrameDepthImageAttachment());
+
+        const auto attachmentSize = output0ImageAttachment->GetDescriptor().m_size;
+        m_outputWidth = attachmentSize.m_width;
+        m_outputHeight = attachmentSize.m_height;
+        UpdateTargetThreadCounts();
+    }
+
+    void CloudscapeTileClassificationPass::UpdateTargetThreadCounts()
+    {
+        // Same threads as a direct dispatch of the CloudscapeComputePass, ceil(imageWidth/N) x ceil(imageHeight/N),
+        // so each thread group is a tile.
+        const auto totalThreadsX = CloudscapeRaymarchTiles::GetTileCount(m_outputWidth, m_updateBlockSize) * CloudscapeRaymarchTiles::TileSize;
+        const auto totalThreadsY = CloudscapeRaymarchTiles::GetTileCount(m_outputHeight, m_updateBlockSize) * CloudscapeRaymarchTiles::TileSize;
+        SetTargetThreadCounts(totalThreadsX, totalThreadsY, 1);
+    }
+
+    void CloudscapeTileClassificationPass::CompileResources(const AZ::RHI::FrameGraphCompileContext& context)
+    {
+        AZ_Assert(m_shaderResourceGroup != nullptr, "CloudscapeTileClassificationPass %s has a null shader resource group when calling Compile.", GetPathName().GetCStr());
+
+        m_shaderResourceGroup->SetConstant(m_updateBlockSizeIndex, m_updateBlockSize);
+        m_shaderResourceGroup->SetConstant(m_updatePixelOffsetIndex, m_updatePixelOffset);
+        m_shaderResourceGroup->SetConstant(m_outputTextureIndexIndex, m_outputTextureIndex);
+
+        if (m_srgNeedsUpdate && m_shaderConstantData)
+        {
+            // Same values as CloudscapeComputePass::CompileResources().
+            m_shaderResourceGroup->SetConstant(m_planetRadiusKmIndex, static_cast<float>(m_shaderConstantData->m_planetRadiusKm));
+            m_shaderResourceGroup->SetConstant(m_cloudSlabDistanceAboveSeaLevelKmIndex, m_shaderConstantData->m_cloudSlabDistanceAboveSeaLevelKm);
+            m_shaderResourceGroup->SetConstant(m_cloudSlabThicknessKmIndex, m_shaderConstantData->m_cloudSlabThicknessKm);
+            m_shaderResourceGroup->SetConstant(m_occludedPixelPolicyIndex, m_shaderConstantData->m_occludedPixelPolicy);
+
+            m_srgNeedsUpdate = false;
+        }
+
+        AZ::RPI::ComputePass::CompileResources(context);
+    }
+
+    void CloudscapeTileClassificationPass::UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData)
+    {
+        // If any of the textures is nullptr, or can't be sampled, the CloudscapeComputePass is disabled, so is this one.
+        if (!shaderData.m_lowFrequencyNoiseTexture ||
+            !shaderData.m_highFrequencyNoiseTexture ||
+            !shaderData.m_weatherMap ||
+            !CloudscapeComputePass::AreNoiseTexturesSupported(shaderData))
+        {
+            m_shaderConstantData = nullptr;
+            SetEnabled(false);
+        }
+        else
+        {
+            m_shaderConstantData = &shaderData;
+            m_srgNeedsUpdate = true;
+            if (!IsEnabled())
+            {
+                SetEnabled(true);
+            }
+        }
+    }
+
+    void CloudscapeTileClassificationPass::UpdateFrameCounter(uint32_t frameCounter, const CloudscapeUpdatePattern& updatePattern)
+    {
+        m_outputTextureIndex = frameCounter % 2;
+        updatePattern.GetPixelOffset(frameCounter, m_updatePixelOffset[0], m_updatePixelOffset[1]);
+        if (m_updateBlockSize != updatePattern.GetBlockSize())
+        {
+            m_updateBlockSize = updatePattern.GetBlockSize();
+            UpdateTargetThreadCounts();
+        }
+    }
+
+    // ComputePass overrides...
+    void CloudscapeTileClassificationPass::OnShaderReloadedInternal()
+    {
+        m_srgNeedsUpdate = true;
+    }
+
+}   // namespace VolumetricClouds
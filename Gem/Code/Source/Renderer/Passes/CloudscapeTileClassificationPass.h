@@ -0,0 +1,96 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+#pragma once
+
+#include <AzCore/Memory/SystemAllocator.h>
+
+#include <Atom/RPI.Public/Buffer/Buffer.h>
+#include <Atom/RPI.Public/Pass/ComputePass.h>
+#include <Atom/RPI.Public/Shader/Shader.h>
+#include <Atom/RPI.Public/Shader/ShaderResourceGroup.h>
+
+#include <Renderer/CloudscapeShaderConstantData.h>
+#include <Renderer/Cpu/CloudscapeUpdatePattern.h>
+
+namespace VolumetricClouds
+{
+    /**
+     *  Runs before the CloudscapeComputePass. Each frame it classifies the tiles of pixels ray marched
+     *  by the CloudscapeComputePass, and appends the ones where some ray may find clouds to the tile list owned
+     *  by the CloudscapeFeatureProcessor. It also writes the indirect dispatch arguments of the CloudscapeComputePass,
+     *  one thread group per live tile, and clears the pixels, and the history confidence, of the other tiles.
+     *  See CloudscapeTileClassificationCS.azsl, and CloudscapeRaymarchTiles for the CPU version.
+     */
+    class CloudscapeTileClassificationPass final
+        : public AZ::RPI::ComputePass
+    {
+        AZ_RPI_PASS(CloudscapeTileClassificationPass);
+
+    public:
+        AZ_RTTI(CloudscapeTileClassificationPass, "{4C7E1B65-3A2D-4F08-9E51-7D6A0C2B9F34}", AZ::RPI::ComputePass);
+        AZ_CLASS_ALLOCATOR(CloudscapeTileClassificationPass, AZ::SystemAllocator);
+
+        virtual ~CloudscapeTileClassificationPass() = default;
+
+        static AZ::RPI::Ptr<CloudscapeTileClassificationPass> Create(const AZ::RPI::PassDescriptor& descriptor);
+
+        // Same as CloudscapeComputePass::UpdateShaderConstantData(). Both passes are enabled and disabled together.
+        void UpdateShaderConstantData(const CloudscapeShaderConstantData& shaderData);
+
+        // Same as CloudscapeComputePass::UpdateFrameCounter().
+        void UpdateFrameCounter(uint32_t frameCounter, const CloudscapeUpdatePattern& updatePattern);
+
+        // Binds the buffers owned by the CloudscapeFeatureProcessor, which are also
+        // read by the CloudscapeComputePass, to the slot @slotName.
+        // Used by both passes.
+        static void SetBufferAttachmentBinding(AZ::RPI::Pass& pass, const char* slotName, const char* shaderInputName,
+            AZ::Data::Instance<AZ::RPI::Buffer> buffer);
+
+    private:
+        CloudscapeTileClassificationPass(const AZ::RPI::PassDescriptor& descriptor);
+
+        static constexpr char LogName[] = "CloudscapeTileClassificationPass";
+
+        //! Pass behavior overrides
+        void InitializeInternal() override;
+        void BuildInternal() override;
+
+        // Scope producer functions...
+        void CompileResources(const AZ::RHI::FrameGraphCompileContext& context) override;
+
+        // ComputePass overrides...
+        void OnShaderReloadedInternal() override;
+
+        // A helper function
+        void SetImageAttachmentBinding(uint32_t attachmentIndex, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
+        // Same as CloudscapeComputePass::SetHistoryConfidenceBinding().
+        void SetHistoryConfidenceBinding(uint32_t attachmentIndex, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
+
+        // One thread per block of pixels of the update pattern, one thread group per tile.
+        void UpdateTargetThreadCounts();
+
+        bool m_srgNeedsUpdate = true;
+        const CloudscapeShaderConstantData* m_shaderConstantData = nullptr;
+        // Updated each frame by UpdateFrameCounter().
+        uint32_t m_updateBlockSize = CloudscapeUpdatePattern::DefaultBlockSize;
+        uint32_t m_updatePixelOffset[2] = { 0, 0 };
+        uint32_t m_outputTextureIndex = 0; // Frame Counter % 2.
+        // Size of the output attachments, in pixels.
+        uint32_t m_outputWidth = 0;
+        uint32_t m_outputHeight = 0;
+
+        AZ::RHI::ShaderInputNameIndex m_updateBlockSizeIndex = "m_updateBlockSize";
+        AZ::RHI::ShaderInputNameIndex m_updatePixelOffsetIndex = "m_updatePixelOffset";
+        AZ::RHI::ShaderInputNameIndex m_outputTextureIndexIndex = "m_outputTextureIndex";
+
+        AZ::RHI::ShaderInputNameIndex m_planetRadiusKmIndex = "m_planetRadiusKm";
+        AZ::RHI::ShaderInputNameIndex m_cloudSlabDistanceAboveSeaLevelKmIndex = "m_cloudSlabDistanceAboveSeaLevelKm";
+        AZ::RHI::ShaderInputNameIndex m_cloudSlabThicknessKmIndex = "m_cloudSlabThicknessKm";
+        AZ::RHI::ShaderInputNameIndex m_occludedPixelPolicyIndex = "m_occludedPixelPolicy";
+    };
+
+}   // namespace VolumetricClouds
@@ -0,0 +1,57 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <Atom/RPI.Public/RenderPipeline.h>
+#include <Atom/RPI.Public/Scene.h>
+
+#include <Renderer/CloudscapeFeatureProcessor.h>
+#include "DepthBufferCopyPass.h"
+
+namespace VolumetricClouds
+{
+
+    AZ::RPI::Ptr<DepthBufferCopyPass> DepthBufferCopyPass::Create(const AZ::RPI::PassDescriptor& descriptor)
+    {
+        AZ::RPI::Ptr<DepthBufferCopyPass> pass = aznew DepthBufferCopyPass(descriptor);
+        return AZStd::move(pass);
+    }
+
+    DepthBufferCopyPass::DepthBufferCopyPass(const AZ::RPI::PassDescriptor& descriptor)
+        : AZ::RPI::FullscreenTrianglePass(descriptor)
+    {
+    }
+
+    void DepthBufferCopyPass::SetPreviousFrameDepthBinding(AZ::RPI::Pass& pass, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage)
+    {
+        const auto slotName = AZ::Name("PreviousFrameDepth");
+        auto binding = pass.FindAttachmentBinding(slotName);
+        AZ_Assert(!!binding, "Failed to find attachment binding for slot %s", slotName.GetCStr());
+
+        // Starts as "NoBind" for the same reason as the outputs, see CloudscapeComputePass::SetImageAttachmentBinding().
+        binding->m_shaderInputName = AZ::Name("m_previousFrameDepthTexture");
+
+        AZ::RHI::ImageViewDescriptor viewDesc = AZ::RHI::ImageViewDescriptor::Create(attachmentImage->GetDescriptor().m_format,
+            0, 0);
+        binding->m_unifiedScopeDesc.SetAsImage(viewDesc);
+
+        pass.AttachImageToSlot(slotName, attachmentImage);
+    }
+
+    void DepthBufferCopyPass::BuildInternal()
+    {
+        AZ::RPI::Scene* scene = m_pipeline->GetScene();
+        auto* cloudscapeFeatureProcessor = scene->GetFeatureProcessor<CloudscapeFeatureProcessor>();
+        if (cloudscapeFeatureProcessor)
+        {
+            // The render target must be attached before the FullscreenTrianglePass sets up the viewport and scissor from it.
+            AttachImageToSlot(AZ::Name("PreviousFrameDepth"), cloudscapeFeatureProcessor->GetPreviousFrameDepthImageAttachment());
+        }
+
+        AZ::RPI::FullscreenTrianglePass::BuildInternal();
+    }
+
+}   // namespace VolumetricClouds
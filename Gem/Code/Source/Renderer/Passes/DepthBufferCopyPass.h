@@ -0,0 +1,44 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/Memory/SystemAllocator.h>
+
+#include <Atom/RPI.Public/Image/AttachmentImage.h>
+#include <Atom/RPI.Public/Pass/FullscreenTrianglePass.h>
+
+namespace VolumetricClouds
+{
+    /**
+     *  Copies the depth buffer into the previous frame depth buffer owned by the CloudscapeFeatureProcessor.
+     *  It runs after the CloudscapeComputePass, so the cloudscape compute passes of each frame read the
+     *  depth of the previous frame. See WasCloudSlabEntryOccluded() in CloudscapeSlabIntersection.azsli.
+     */
+    class DepthBufferCopyPass final
+        : public AZ::RPI::FullscreenTrianglePass
+    {
+    public:
+        AZ_RTTI(DepthBufferCopyPass, "{8D3F5A27-61C4-4B9E-A0D2-3E7C91F4B658}", AZ::RPI::FullscreenTrianglePass);
+        AZ_CLASS_ALLOCATOR(DepthBufferCopyPass, AZ::SystemAllocator);
+
+        virtual ~DepthBufferCopyPass() = default;
+
+        static AZ::RPI::Ptr<DepthBufferCopyPass> Create(const AZ::RPI::PassDescriptor& descriptor);
+
+        // Binds the previous frame depth buffer to the "PreviousFrameDepth" input slot of @pass.
+        // Used by the CloudscapeComputePass and the CloudscapeTileClassificationPass.
+        static void SetPreviousFrameDepthBinding(AZ::RPI::Pass& pass, AZ::Data::Instance<AZ::RPI::AttachmentImage> attachmentImage);
+
+    protected:
+        DepthBufferCopyPass(const AZ::RPI::PassDescriptor& descriptor);
+
+        //! Pass behavior overrides
+        void BuildInternal() override;
+    };
+
+}   // namespace VolumetricClouds
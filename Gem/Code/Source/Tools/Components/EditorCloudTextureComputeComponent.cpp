@@ -9,7 +9,7 @@
 
 #include <AzToolsFramework/UI/PropertyEditor/PropertyFilePathCtrl.h>
 
-#include <Tools/Utils/PngCloudTextureWriter.h>
+#include <Tools/Utils/CloudVolCloudTextureWriter.h>
 #include <Tools/Utils/DdsCloudTextureWriter.h>
 #include <Renderer/Passes/CloudTextureComputePass.h> // To get function that calculates num mips.
 #include "EditorCloudTextureComputeComponent.h"
@@ -28,8 +28,12 @@ namespace VolumetricClouds
         if (serialize)
         {
             serialize->Class<SaveToDiskConfig, AZ::ComponentConfig>()
-                ->Version(1)
+                ->Version(4)
                 ->Field("OutputImagePath", &SaveToDiskConfig::m_outputImagePath)
+                ->Field("Compression", &SaveToDiskConfig::m_compression)
+                ->Field("FirstChannel", &SaveToDiskConfig::m_firstChannel)
+                ->Field("PngLayout", &SaveToDiskConfig::m_pngLayout)
+                ->Field("CloudVolumeCodec", &SaveToDiskConfig::m_cloudVolumeCodec)
                 ;
 
             AZ::EditContext* edit = serialize->GetEditContext();
@@ -43,11 +47,42 @@ namespace VolumetricClouds
                         AZ::Edit::UIHandlers::Default, &SaveToDiskConfig::m_outputImagePath, "Output Path",
                         "Output path to save the image(s) to.")
                         ->Attribute(AZ::Edit::Attributes::SourceAssetFilterPattern, SaveToDiskConfig::GetSupportedImagesFilter())
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &SaveToDiskConfig::m_compression, "Compression",
+                        "Block compression of the DDS file. BC7 keeps the four channels, BC4 one channel and BC5 two channels, "
+                        "starting at 'First Channel'. The PSNR of each mip level is reported when the file is saved.")
+                        ->EnumAttribute(CloudTextureCompression::None, "None (RGBA8)")
+                        ->EnumAttribute(CloudTextureCompression::BC7,  "BC7 (RGBA)")
+                        ->EnumAttribute(CloudTextureCompression::BC5,  "BC5 (two channels)")
+                        ->EnumAttribute(CloudTextureCompression::BC4,  "BC4 (one channel)")
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &SaveToDiskConfig::m_firstChannel, "First Channel",
+                        "First channel saved with BC4 or BC5. e.g. the high frequency noise only uses gba, which can be saved as BC5 (G) plus BC4 (A).")
+                        ->EnumAttribute(0u, "R")
+                        ->EnumAttribute(1u, "G")
+                        ->EnumAttribute(2u, "B")
+                        ->EnumAttribute(3u, "A")
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &SaveToDiskConfig::m_pngLayout, "PNG Layout",
+                        "Only used when the output path is a .png file. 'Slices' saves one file per mip level, per depth slice. "
+                        "'Flipbook Atlas' saves one 2D file per mip level with all the depth slices laid out in a grid.")
+                        ->EnumAttribute(PngCloudTextureLayout::Slices, "Slices")
+                        ->EnumAttribute(PngCloudTextureLayout::FlipbookAtlas, "Flipbook Atlas")
+                    ->DataElement(AZ::Edit::UIHandlers::ComboBox, &SaveToDiskConfig::m_cloudVolumeCodec, "Cloud Volume Codec",
+                        "Only used when the output path is a .cloudvol file. Compression of each brick of the volume. "
+                        "LZ4 is faster to load, ZStd makes smaller files.")
+                        ->EnumAttribute(CloudVolumeCodec::None, "None")
+                        ->EnumAttribute(CloudVolumeCodec::LZ4, "LZ4")
+                        ->EnumAttribute(CloudVolumeCodec::ZStd, "ZStd")
                     ;
             }
         }
     }
 
+    AZStd::string SaveToDiskConfig::GetOutputExtension() const
+    {
+        AZStd::string extension = m_outputImagePath.Extension().String();
+        AZStd::to_lower(extension.begin(), extension.end());
+        return extension;
+    }
+
     void EditorCloudTextureComputeComponent::Reflect(AZ::ReflectContext* context)
     {
         BaseClass::Reflect(context);
@@ -111,7 +146,8 @@ namespace VolumetricClouds
             [this](AZ::Data::Instance<AZ::RPI::Image> image,
                 AZStd::shared_ptr<AZStd::vector<uint8_t>> mipDataBuffer, uint16_t mipSlice, const AZ::RHI::Size& mipSize)
             {
-                if (!m_cloudTextureWriter)
+                // The writer must not be modified while the write thread is running.
+                if (!m_cloudTextureWriter || m_writeStatus)
                 {
                     return;
                 }
@@ -126,8 +162,12 @@ namespace VolumetricClouds
 
                 if (m_cloudTextureWriter->GetMipLevelsWithDataCount() == m_cloudTextureWriter->GetMipLevels())
                 {
-                    // We got all the data. We can start the Tick events and save mip level to disk.
-                    m_progressDialog->setValue(1);
+                    // We got all the data. The file is written from its own thread, and the
+                    // Tick events only poll the progress of the write.
+                    // The stats were delivered with the texture ready event, before the readback notifications.
+                    m_cloudTextureWriter->SetStats(m_controller.GetCloudTextureStats());
+                    m_writeStatus = AZStd::make_shared<CloudTextureWriteStatus>();
+                    ICloudTextureWriter::SaveAllMipLevelsAsync(m_cloudTextureWriter, m_writeStatus);
                     AZ::SystemTickBus::Handler::BusConnect();
                 }
             }
@@ -137,6 +177,13 @@ namespace VolumetricClouds
 
     void EditorCloudTextureComputeComponent::Deactivate()
     {
+        // The write thread keeps the writer alive until it sees the cancellation.
+        if (m_writeStatus)
+        {
+            m_writeStatus->RequestCancel();
+            m_writeStatus.reset();
+        }
+        m_cloudTextureWriter.reset();
         BaseClass::Deactivate();
         AZ::SystemTickBus::Handler::BusDisconnect();
     }
@@ -212,8 +259,26 @@ namespace VolumetricClouds
         const uint16_t mipLevels = CloudTextureComputePass::CalculateMipCount(m_controller.m_configuration.m_computeData.m_pixelSize);
         const AZ::RHI::Format pixFormat = m_controller.GetCloudTextureImage()->GetDescriptor().m_format;
         m_cloudTextureWriter.reset();
-        m_cloudTextureWriter = AZStd::make_unique<DdsCloudTextureWriter>(
-            mipLevels, pixFormat, parentPath, prefix);
+        m_writeStatus.reset();
+        const AZStd::string extension = m_saveToDiskConfig.GetOutputExtension();
+        if (extension == ".png")
+        {
+            m_cloudTextureWriter = AZStd::make_shared<PngCloudTextureWriter>(
+                mipLevels, pixFormat, parentPath, prefix, static_cast<PngCloudTextureLayout>(m_saveToDiskConfig.m_pngLayout));
+        }
+        else if (extension == CloudVolumeFile::FileExtension)
+        {
+            CloudVolumeWriteSettings writeSettings;
+            writeSettings.m_codec = static_cast<CloudVolumeCodec>(m_saveToDiskConfig.m_cloudVolumeCodec);
+            m_cloudTextureWriter = AZStd::make_shared<CloudVolCloudTextureWriter>(
+                mipLevels, pixFormat, parentPath, prefix, m_controller.m_configuration.m_computeData, writeSettings);
+        }
+        else
+        {
+            m_cloudTextureWriter = AZStd::make_shared<DdsCloudTextureWriter>(
+                mipLevels, pixFormat, parentPath, prefix,
+                static_cast<CloudTextureCompression>(m_saveToDiskConfig.m_compression), m_saveToDiskConfig.m_firstChannel);
+        }
 
         m_controller.ForceCloudTextureRegeneration(&m_readbackHandler);
         ShowProgressDialog();
@@ -238,8 +303,8 @@ namespace VolumetricClouds
         m_progressDialog->setMinimum(0);
         m_progressDialog->setMinimumDuration(0);
         m_progressDialog->setAutoClose(true);
-        uint32_t numImages = m_controller.m_configuration.m_computeData.m_pixelSize;
-        m_progressDialog->setMaximum(numImages);
+        // Percentage of the bytes written to disk.
+        m_progressDialog->setMaximum(100);
 
 
         class MyCancelButton final : public QPushButton {
@@ -264,6 +329,14 @@ namespace VolumetricClouds
 
     void EditorCloudTextureComputeComponent::OnProgressDialogCanceled()
     {
+        if (m_writeStatus)
+        {
+            // The write thread is running. It will delete the partially written file,
+            // and OnSystemTick() will enable the "Save To Disk" button once the write is done.
+            m_writeStatus->RequestCancel();
+            return;
+        }
+
         m_cloudTextureWriter.reset();
 
         // Force UI refresh of the component so the "Save To Disk" button becomes
@@ -277,62 +350,86 @@ namespace VolumetricClouds
     // AZ::SystemTickBus::Handler overrides ...
     void EditorCloudTextureComputeComponent::OnSystemTick()
     {
-        if (!m_cloudTextureWriter)
+        if (!m_cloudTextureWriter || !m_writeStatus)
         {
             AZ::SystemTickBus::Handler::BusDisconnect();
             return;
         }
 
-        uint16_t nextMipLevelToSave = m_cloudTextureWriter->GetSavedMipLevelsCount();
-        if (nextMipLevelToSave < m_cloudTextureWriter->GetMipLevels())
+        if (!m_writeStatus->IsFinished())
         {
-            if (!m_cloudTextureWriter->SaveMipLevel(nextMipLevelToSave))
+            // The dialog closes by itself when it reaches the maximum, which only happens once the write is done.
+            if (m_progressDialog && !m_writeStatus->IsCancelRequested())
             {
-                m_cloudTextureWriter.reset();
-                m_progressDialog->reset();
-                AZ::SystemTickBus::Handler::BusDisconnect();
-
-                QString msg = QString::asprintf("Saving cloud texture to disk failed at mip level=%hu!", nextMipLevelToSave);
-                QMessageBox::information(
-                    QApplication::activeWindow(),
-                    "Error",
-                    msg,
-                    QMessageBox::Ok);
-
-                // Force UI refresh of the component so the "Save To Disk" button becomes
-                // enabled again.
-                AzToolsFramework::ToolsApplicationNotificationBus::Broadcast(
-                    &AzToolsFramework::ToolsApplicationEvents::InvalidatePropertyDisplay, AzToolsFramework::Refresh_AttributesAndValues);
-                return;
+                const int percentage = static_cast<int>(m_writeStatus->GetProgress() * 100.0f);
+                m_progressDialog->setValue(AZStd::min(percentage, m_progressDialog->maximum() - 1));
             }
+            return;
+        }
 
-            m_progressDialog->setValue(m_progressDialog->value() + 1);
+        OnSaveToDiskFinished();
+    }
+
+    void EditorCloudTextureComputeComponent::OnSaveToDiskFinished()
+    {
+        AZ::SystemTickBus::Handler::BusDisconnect();
+        if (m_progressDialog)
+        {
+            m_progressDialog->reset();
+        }
 
-            if (m_cloudTextureWriter->GetSavedMipLevelsCount() == m_cloudTextureWriter->GetMipLevels())
+        const auto state = m_writeStatus->GetState();
+        if (state == CloudTextureWriteStatus::State::Succeeded)
+        {
+            const auto& fileList = m_cloudTextureWriter->GetListOfSavedFiles();
+
+            QString msg = QString::asprintf("Successfully saved all mip levels=%hu for cloud texture to disk.\n%zu files were created. First file was:\n%s",
+                m_cloudTextureWriter->GetMipLevels(), fileList.size(), fileList.empty() ? "" : fileList[0].c_str());
+            const auto& mipLevelsPsnr = m_cloudTextureWriter->GetMipLevelsPsnr();
+            for (size_t mipIdx = 0; mipIdx < mipLevelsPsnr.size(); mipIdx++)
             {
-                m_progressDialog->setValue(m_progressDialog->value() + 1);
-
-                const auto& fileList = m_cloudTextureWriter->GetListOfSavedFiles();
-
-                QString msg = QString::asprintf("Successfully saved all mip levels=%hu for cloud texture to disk.\n%zu files were created. First file was:\n%s",
-                    m_cloudTextureWriter->GetMipLevels(), fileList.size(), fileList[0].c_str());
-                QMessageBox::information(
-                    QApplication::activeWindow(),
-                    "Error",
-                    msg,
-                    QMessageBox::Ok);
-
-                m_cloudTextureWriter.reset();
-                m_progressDialog->reset();
-                AZ::SystemTickBus::Handler::BusDisconnect();
-                // Force UI refresh of the component so the "Save To Disk" button becomes
-                // enabled again.
-                AzToolsFramework::ToolsApplicationNotificationBus::Broadcast(
-                    &AzToolsFramework::ToolsApplicationEvents::InvalidatePropertyDisplay, AzToolsFramework::Refresh_AttributesAndValues);
+                msg += QString::asprintf("\nMip %zu PSNR: %.2f dB", mipIdx, mipLevelsPsnr[mipIdx]);
             }
-
-            
+            const auto& stats = m_cloudTextureWriter->GetStats();
+            if (stats && stats->IsValid())
+            {
+                static constexpr const char* ChannelNames = "RGBA";
+                for (uint32_t channelIdx = 0; channelIdx < stats->m_channelCount; channelIdx++)
+                {
+                    const CloudTextureChannelStats& channelStats = stats->m_mipLevels[0].m_channels[channelIdx];
+                    msg += QString::asprintf("\nMip 0 %c: min=%.3f max=%.3f mean=%.3f", ChannelNames[channelIdx],
+                        channelStats.m_min, channelStats.m_max, channelStats.m_mean);
+                    if (stats->m_normalized)
+                    {
+                        msg += QString::asprintf(" (remapped from [%.3f, %.3f])",
+                            stats->m_sourceRangeMin[channelIdx], stats->m_sourceRangeMax[channelIdx]);
+                    }
+                }
+            }
+            QMessageBox::information(
+                QApplication::activeWindow(),
+                "Save To Disk",
+                msg,
+                QMessageBox::Ok);
         }
+        else if (state == CloudTextureWriteStatus::State::Failed)
+        {
+            QString msg = QString::asprintf("Saving cloud texture to disk failed!\n%s", m_writeStatus->GetErrorMessage().c_str());
+            QMessageBox::information(
+                QApplication::activeWindow(),
+                "Error",
+                msg,
+                QMessageBox::Ok);
+        }
+        // Nothing to report if the user canceled.
+
+        m_cloudTextureWriter.reset();
+        m_writeStatus.reset();
+
+        // Force UI refresh of the component so the "Save To Disk" button becomes
+        // enabled again.
+        AzToolsFramework::ToolsApplicationNotificationBus::Broadcast(
+            &AzToolsFramework::ToolsApplicationEvents::InvalidatePropertyDisplay, AzToolsFramework::Refresh_AttributesAndValues);
     }
 
 } // namespace VolumetricClouds
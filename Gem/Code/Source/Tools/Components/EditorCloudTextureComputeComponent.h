@@ -16,7 +16,10 @@ AZ_POP_DISABLE_WARNING
 #include <Atom/Feature/Utils/EditorRenderComponentAdapter.h>
 
 #include <Clients/Components/CloudTextureComputeComponent.h>
+#include <Renderer/Cpu/CloudTextureBlockCompressor.h>
+#include <Renderer/CloudVolumeFile.h>
 #include <Tools/Utils/ICloudTextureWriter.h>
+#include <Tools/Utils/PngCloudTextureWriter.h>
 #include <Renderer/CloudTexturesComputeFeatureProcessor.h>
 
 namespace VolumetricClouds
@@ -29,10 +32,21 @@ namespace VolumetricClouds
         static void Reflect(AZ::ReflectContext* context);
 
         AZ::IO::Path m_outputImagePath;
+        // One of CloudTextureCompression.
+        uint32_t m_compression = static_cast<uint32_t>(CloudTextureCompression::None);
+        // First channel (0 = R, 3 = A) stored by BC4 and BC5.
+        uint32_t m_firstChannel = 0;
+        // One of PngCloudTextureLayout. Only used when the output path is a .png file.
+        uint32_t m_pngLayout = 0;
+        // One of CloudVolumeCodec. Only used when the output path is a .cloudvol file.
+        uint32_t m_cloudVolumeCodec = static_cast<uint32_t>(CloudVolumeCodec::LZ4);
+
+        // Lower case extension of the output path, including the dot.
+        AZStd::string GetOutputExtension() const;
 
         static AZStd::string GetSupportedImagesFilter()
         {
-            return "Volume Texture (*.dds)";
+            return "Volume Texture (*.dds);;PNG Slices (*.png);;Cloud Volume (*.cloudvol)";
         }
     };
 
@@ -60,6 +74,7 @@ namespace VolumetricClouds
         void Deactivate() override;
 
         // AZ::SystemTickBus::Handler overrides ...
+        // Polls m_writeStatus to update the progress dialog.
         void OnSystemTick() override;
             
         AZ::u32 OnConfigurationChanged() override;
@@ -78,11 +93,16 @@ namespace VolumetricClouds
         // AzToolsFramework::EditorEntityVisibilityNotificationBus::Handler overrides
         void OnEntityVisibilityChanged(bool visibility) override;
 
+        // Called when the write job is done. Shows the result and enables the "Save" button again.
+        void OnSaveToDiskFinished();
+
         SaveToDiskConfig m_saveToDiskConfig;
         std::unique_ptr<QProgressDialog> m_progressDialog; // Will be visible when we are writing the 3D Texture to disk.
         // If this smart ptr is different than null it means we are saving a cloud texture
-        // to disk.
-        AZStd::unique_ptr<ICloudTextureWriter> m_cloudTextureWriter;
+        // to disk. Shared with the job that writes the file.
+        AZStd::shared_ptr<ICloudTextureWriter> m_cloudTextureWriter;
+        // Progress of the write job. Null until all the mip levels are read back.
+        AZStd::shared_ptr<CloudTextureWriteStatus> m_writeStatus;
         CloudTexturesComputeFeatureProcessor::ReadbackEvent::Handler m_readbackHandler;
 
     };
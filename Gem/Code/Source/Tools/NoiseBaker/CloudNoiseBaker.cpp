@@ -0,0 +1,193 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Serialization/Json/JsonSerialization.h>
+#include <AzCore/Serialization/Json/JsonUtils.h>
+#include <AzCore/std/chrono/chrono.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Renderer/Cpu/CloudTextureStatistics.h>
+#include <Tools/Utils/CloudTextureWriteStatus.h>
+#include <Tools/Utils/CloudVolCloudTextureWriter.h>
+#include <Tools/Utils/DdsCloudTextureWriter.h>
+#include "CloudNoiseBaker.h"
+
+namespace VolumetricClouds
+{
+    namespace
+    {
+        double GetSecondsSince(AZStd::chrono::steady_clock::time_point startTime)
+        {
+            return AZStd::chrono::duration<double>(AZStd::chrono::steady_clock::now() - startTime).count();
+        }
+    }
+
+    CloudNoiseBaker::CloudNoiseBaker(const Settings& settings, AZ::SerializeContext* serializeContext, AZ::JsonRegistrationContext* registrationContext)
+        : m_settings(settings), m_serializeContext(serializeContext), m_registrationContext(registrationContext)
+    {
+    }
+
+    bool CloudNoiseBaker::LoadComputeData(const AZ::IO::Path& jsonFilePath, CloudTextureComputeData& computeData, AZStd::string& errorMessage) const
+    {
+        auto readOutcome = AZ::JsonSerializationUtils::ReadJsonFile(jsonFilePath.Native());
+        if (!readOutcome.IsSuccess())
+        {
+            errorMessage = readOutcome.GetError();
+            return false;
+        }
+
+        const rapidjson::Document& document = readOutcome.GetValue();
+        if (!document.IsObject())
+        {
+            errorMessage = "The root of the JSON document must be an object.";
+            return false;
+        }
+
+        // Documents saved with AZ::JsonSerializationUtils::SaveObjectToFile() have the object in "ClassData".
+        const rapidjson::Value* objectValue = &document;
+        if (auto classDataIt = document.FindMember("ClassData"); classDataIt != document.MemberEnd())
+        {
+            objectValue = &classDataIt->value;
+        }
+
+        AZ::JsonDeserializerSettings deserializerSettings;
+        deserializerSettings.m_serializeContext = m_serializeContext;
+        deserializerSettings.m_registrationContext = m_registrationContext;
+        deserializerSettings.m_reporting = [&jsonFilePath](AZStd::string_view message, AZ::JsonSerializationResult::ResultCode result,
+            AZStd::string_view path) -> AZ::JsonSerializationResult::ResultCode
+        {
+            // A misspelled field would silently bake the default value, which defeats the purpose
+            // of having the parameters in a file.
+            if (result.GetOutcome() == AZ::JsonSerializationResult::Outcomes::Skipped ||
+                result.GetOutcome() == AZ::JsonSerializationResult::Outcomes::Unknown)
+            {
+                AZ_Warning(LogName, false, "%s: %.*s (%.*s)\n", jsonFilePath.c_str(),
+                    AZ_STRING_ARG(message), AZ_STRING_ARG(path));
+            }
+            return result;
+        };
+
+        computeData = CloudTextureComputeData();
+        const AZ::JsonSerializationResult::ResultCode result = AZ::JsonSerialization::Load(computeData, *objectValue, deserializerSettings);
+        if (result.GetProcessing() == AZ::JsonSerializationResult::Processing::Halted)
+        {
+            errorMessage = result.ToString("");
+            return false;
+        }
+        return true;
+    }
+
+    CloudNoiseBaker::Result CloudNoiseBaker::BakeFile(const AZ::IO::Path& jsonFilePath) const
+    {
+        Result result;
+        result.m_jsonFilePath = jsonFilePath;
+
+        CloudTextureComputeData computeData;
+        AZStd::string errorMessage;
+        if (!LoadComputeData(jsonFilePath, computeData, errorMessage))
+        {
+            result.m_errorMessage = AZStd::string::format("Failed to load the compute data: %s", errorMessage.c_str());
+            return result;
+        }
+        result.m_pixelSize = computeData.m_pixelSize;
+
+        auto bakeStartTime = AZStd::chrono::steady_clock::now();
+        AZStd::vector<CloudTextureCpuBaker::MipLevelData> mipLevels = CloudTextureCpuBaker::Bake(computeData, m_settings.m_noiseVariant);
+        if (mipLevels.empty())
+        {
+            result.m_errorMessage = AZStd::string::format("Invalid pixel size %u.", computeData.m_pixelSize);
+            return result;
+        }
+        result.m_mipLevels = aznumeric_caster(mipLevels.size());
+
+        // Same format the GPU creates for the channel layout.
+        const AZ::RHI::Format pixelFormat = CloudTextureFormat::GetImageFormat(static_cast<CloudTextureChannelLayout>(computeData.m_channelLayout));
+        if (!CloudTextureStatistics::Calculate(pixelFormat, mipLevels, result.m_stats))
+        {
+            result.m_errorMessage = "Failed to calculate the stats of the mip levels.";
+            return result;
+        }
+        if (computeData.m_normalizeChannelRange)
+        {
+            AZStd::vector<CloudTextureCpuBaker::MipLevelData> normalizedMipLevels;
+            if (!CloudTextureStatistics::NormalizeChannelRange(pixelFormat, mipLevels, result.m_stats, normalizedMipLevels))
+            {
+                result.m_errorMessage = "Failed to normalize the channel range of the mip levels.";
+                return result;
+            }
+            mipLevels = AZStd::move(normalizedMipLevels);
+        }
+        // The stats, and the renormalization, are part of the bake.
+        result.m_bakeSeconds = GetSecondsSince(bakeStartTime);
+
+        const AZ::IO::Path outputDir = m_settings.m_outputDir.empty() ? jsonFilePath.ParentPath() : m_settings.m_outputDir;
+        const AZStd::string stemPrefix = jsonFilePath.Stem().String();
+
+        AZStd::shared_ptr<ICloudTextureWriter> writer;
+        switch (m_settings.m_outputFormat)
+        {
+        case NoiseBakerOutputFormat::Png:
+            writer = AZStd::make_shared<PngCloudTextureWriter>(result.m_mipLevels, pixelFormat, outputDir, stemPrefix, m_settings.m_pngLayout);
+            break;
+        case NoiseBakerOutputFormat::CloudVol:
+            writer = AZStd::make_shared<CloudVolCloudTextureWriter>(
+                result.m_mipLevels, pixelFormat, outputDir, stemPrefix, computeData, m_settings.m_cloudVolumeSettings);
+            break;
+        default:
+            writer = AZStd::make_shared<DdsCloudTextureWriter>(
+                result.m_mipLevels, pixelFormat, outputDir, stemPrefix, m_settings.m_compression, m_settings.m_firstChannel);
+            break;
+        }
+        writer->SetStats(AZStd::make_shared<CloudTextureStats>(result.m_stats));
+
+        for (const auto& mipLevelData : mipLevels)
+        {
+            if (!writer->SetDataBufferForMipLevel(mipLevelData.m_dataBuffer, mipLevelData.m_mipSlice, mipLevelData.m_mipSize))
+            {
+                result.m_errorMessage = AZStd::string::format("Failed to set the data of mip level %hu.", mipLevelData.m_mipSlice);
+                return result;
+            }
+            result.m_totalBytes += mipLevelData.m_dataBuffer->size();
+        }
+
+        auto writeStartTime = AZStd::chrono::steady_clock::now();
+        CloudTextureWriteStatus status;
+        status.SetRunning();
+        const bool success = writer->SaveAllMipLevels(status);
+        status.SetFinished(success);
+        result.m_writeSeconds = GetSecondsSince(writeStartTime);
+        if (!success)
+        {
+            result.m_errorMessage = status.GetErrorMessage();
+            if (result.m_errorMessage.empty())
+            {
+                result.m_errorMessage = AZStd::string::format("%s failed to save the texture.", writer->GetLogName());
+            }
+            return result;
+        }
+
+        result.m_savedFiles = writer->GetListOfSavedFiles();
+        result.m_mipLevelsPsnr = writer->GetMipLevelsPsnr();
+        result.m_success = true;
+        return result;
+    }
+
+    const char* CloudNoiseBaker::GetOutputFormatName(NoiseBakerOutputFormat outputFormat)
+    {
+        switch (outputFormat)
+        {
+        case NoiseBakerOutputFormat::Png:
+            return "png";
+        case NoiseBakerOutputFormat::CloudVol:
+            return "cloudvol";
+        default:
+            return "dds";
+        }
+    }
+
+} // namespace VolumetricClouds
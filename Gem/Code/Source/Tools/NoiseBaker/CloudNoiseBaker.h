@@ -0,0 +1,98 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/IO/Path/Path.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/string/string.h>
+
+#include <Renderer/CloudVolumeFile.h>
+#include <Renderer/Cpu/CloudTextureBlockCompressor.h>
+#include <Renderer/Cpu/PerlinWorleyNoiseKernels.h>
+#include <Renderer/Passes/CloudTextureComputeData.h>
+#include <Tools/Utils/PngCloudTextureWriter.h>
+
+namespace AZ
+{
+    class SerializeContext;
+    class JsonRegistrationContext;
+}
+
+namespace VolumetricClouds
+{
+    enum class NoiseBakerOutputFormat : uint32_t
+    {
+        Dds = 0,
+        Png = 1,
+        CloudVol = 2,
+    };
+
+    // Bakes CloudTextureComputeData JSON files with CloudTextureCpuBaker, without a GPU, and saves
+    // them with the same ICloudTextureWriter(s) used by EditorCloudTextureComputeComponent.
+    // Used by the VolumetricClouds.NoiseBaker executable.
+    // The CPU kernels are deterministic, so baking the same JSON file always produces the same texture.
+    class CloudNoiseBaker final
+    {
+    public:
+        struct Settings
+        {
+            // If empty, each texture is saved next to its JSON file.
+            AZ::IO::Path m_outputDir;
+            NoiseBakerOutputFormat m_outputFormat = NoiseBakerOutputFormat::Dds;
+            PerlinWorleyNoiseVariant m_noiseVariant = PerlinWorleyNoiseVariant::A;
+            // Only for DDS.
+            CloudTextureCompression m_compression = CloudTextureCompression::None;
+            uint32_t m_firstChannel = 0;
+            // Only for PNG.
+            PngCloudTextureLayout m_pngLayout = PngCloudTextureLayout::Slices;
+            // Only for .cloudvol.
+            CloudVolumeWriteSettings m_cloudVolumeSettings;
+        };
+
+        struct Result
+        {
+            AZ::IO::Path m_jsonFilePath;
+            bool m_success = false;
+            AZStd::string m_errorMessage;
+            uint32_t m_pixelSize = 0;
+            uint16_t m_mipLevels = 0;
+            uint64_t m_totalBytes = 0;
+            double m_bakeSeconds = 0.0;
+            double m_writeSeconds = 0.0;
+            AZStd::vector<AZ::IO::Path> m_savedFiles;
+            // Empty for lossless formats.
+            AZStd::vector<double> m_mipLevelsPsnr;
+            // Stats of the saved mip levels, after the optional channel renormalization.
+            CloudTextureStats m_stats;
+        };
+
+        // @serializeContext and @registrationContext must have CloudTextureComputeData,
+        // and the JSON serializers, reflected.
+        CloudNoiseBaker(const Settings& settings, AZ::SerializeContext* serializeContext, AZ::JsonRegistrationContext* registrationContext);
+        ~CloudNoiseBaker() = default;
+
+        // Loads a CloudTextureComputeData from a JSON file. The file can either be a plain object
+        // with the serialized field names, e.g. { "PixelSize": 128, "Frequency": 4.0 }, or the document
+        // created by AZ::JsonSerializationUtils::SaveObjectToFile(). Missing fields keep their default value.
+        bool LoadComputeData(const AZ::IO::Path& jsonFilePath, CloudTextureComputeData& computeData, AZStd::string& errorMessage) const;
+
+        // Loads, bakes and saves a single texture. The stem of the saved files is the stem of the JSON file.
+        // Baking and writing use the global job context.
+        Result BakeFile(const AZ::IO::Path& jsonFilePath) const;
+
+        static const char* GetOutputFormatName(NoiseBakerOutputFormat outputFormat);
+
+    private:
+        static constexpr char LogName[] = "CloudNoiseBaker";
+
+        Settings m_settings;
+        AZ::SerializeContext* m_serializeContext = nullptr;
+        AZ::JsonRegistrationContext* m_registrationContext = nullptr;
+    };
+
+} // namespace VolumetricClouds
@@ -0,0 +1,235 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/Jobs/JobManager.h>
+#include <AzCore/Jobs/JobManagerDesc.h>
+#include <AzCore/Serialization/Json/JsonSystemComponent.h>
+#include <AzCore/Serialization/Json/RegistrationContext.h>
+#include <AzCore/Serialization/SerializeContext.h>
+#include <AzCore/Settings/CommandLine.h>
+#include <AzCore/StringFunc/StringFunc.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/chrono/chrono.h>
+#include <AzCore/std/parallel/thread.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "CloudNoiseBaker.h"
+
+// Headless baker for the cloud noise textures. Reads one or more CloudTextureComputeData JSON files,
+// bakes each one with the CPU noise kernels, using all the worker threads, and saves them as DDS, PNG or .cloudvol.
+// Usage:
+//     VolumetricClouds.NoiseBaker [--options] file1.json [file2.json ...]
+// Returns 0 if all the textures were saved, 1 if any of them failed, and 2 for invalid arguments.
+namespace VolumetricClouds
+{
+    namespace
+    {
+        constexpr int ExitSuccess = 0;
+        constexpr int ExitBakeFailed = 1;
+        constexpr int ExitInvalidArguments = 2;
+
+        void PrintUsage()
+        {
+            printf(
+                "Usage: VolumetricClouds.NoiseBaker [--options] file1.json [file2.json ...]\n"
+                "Bakes CloudTextureComputeData JSON files on the CPU. Each JSON file is an object with any of the fields:\n"
+                "    PixelSize, Frequency, PerlinOctaves, PerlinGain, PerlinAmplitude,\n"
+                "    WorleyOctaves, WorleyGain, WorleyAmplitude, MipFilter (0: Box, 1: Kaiser),\n"
+                "    ChannelLayout (0: RGBA8, 1: RG8, 2: R8, 3: R16F), NormalizeChannelRange (true|false)\n"
+                "The saved files are named after the JSON files.\n"
+                "Options:\n"
+                "    --output-dir=<dir>                  Default: The directory of each JSON file.\n"
+                "    --format=dds|png|cloudvol           Default: dds.\n"
+                "    --compression=none|bc4|bc5|bc7      DDS block compression, RGBA8 layout only. Default: none.\n"
+                "    --first-channel=<0..3>              First source channel for BC4 and BC5. Default: 0.\n"
+                "    --png-layout=slices|atlas           Default: slices.\n"
+                "    --codec=none|lz4|zstd               .cloudvol brick compression. Default: lz4.\n"
+                "    --variant=a|b                       Perlin-Worley noise variant. Default: a.\n"
+                "    --threads=<count>                   Worker threads. Default: All the hardware threads.\n"
+                "    --help\n");
+        }
+
+        // Matches the value of @switchName, if present, against @names and stores the index of the match in @value.
+        template<typename EnumType, size_t NameCount>
+        bool ParseEnumSwitch(const AZ::CommandLine& commandLine, const char* switchName, const char* const (&names)[NameCount], EnumType& value)
+        {
+            if (!commandLine.HasSwitch(switchName))
+            {
+                return true;
+            }
+            const AZStd::string& switchValue = commandLine.GetSwitchValue(switchName, 0);
+            for (size_t nameIndex = 0; nameIndex < NameCount; ++nameIndex)
+            {
+                if (AZ::StringFunc::Equal(switchValue, names[nameIndex]))
+                {
+                    value = static_cast<EnumType>(nameIndex);
+                    return true;
+                }
+            }
+            fprintf(stderr, "Invalid value '%s' for --%s.\n", switchValue.c_str(), switchName);
+            return false;
+        }
+
+        bool ParseUintSwitch(const AZ::CommandLine& commandLine, const char* switchName, uint32_t minValue, uint32_t maxValue, uint32_t& value)
+        {
+            if (!commandLine.HasSwitch(switchName))
+            {
+                return true;
+            }
+            const AZStd::string& switchValue = commandLine.GetSwitchValue(switchName, 0);
+            char* end = nullptr;
+            const unsigned long parsedValue = strtoul(switchValue.c_str(), &end, 10);
+            if (switchValue.empty() || *end != '\0' || parsedValue < minValue || parsedValue > maxValue)
+            {
+                fprintf(stderr, "Invalid value '%s' for --%s. Expected a number between %u and %u.\n",
+                    switchValue.c_str(), switchName, minValue, maxValue);
+                return false;
+            }
+            value = static_cast<uint32_t>(parsedValue);
+            return true;
+        }
+
+        bool ParseSettings(const AZ::CommandLine& commandLine, CloudNoiseBaker::Settings& settings, uint32_t& threadCount)
+        {
+            static constexpr const char* OutputFormatNames[] = { "dds", "png", "cloudvol" };
+            static constexpr const char* CompressionNames[] = { "none", "bc4", "bc5", "bc7" };
+            static constexpr const char* PngLayoutNames[] = { "slices", "atlas" };
+            static constexpr const char* CodecNames[] = { "none", "lz4", "zstd" };
+            static constexpr const char* VariantNames[] = { "a", "b" };
+
+            if (commandLine.HasSwitch("output-dir"))
+            {
+                settings.m_outputDir = commandLine.GetSwitchValue("output-dir", 0);
+            }
+
+            return ParseEnumSwitch(commandLine, "format", OutputFormatNames, settings.m_outputFormat) &&
+                ParseEnumSwitch(commandLine, "compression", CompressionNames, settings.m_compression) &&
+                ParseUintSwitch(commandLine, "first-channel", 0, 3, settings.m_firstChannel) &&
+                ParseEnumSwitch(commandLine, "png-layout", PngLayoutNames, settings.m_pngLayout) &&
+                ParseEnumSwitch(commandLine, "codec", CodecNames, settings.m_cloudVolumeSettings.m_codec) &&
+                ParseEnumSwitch(commandLine, "variant", VariantNames, settings.m_noiseVariant) &&
+                ParseUintSwitch(commandLine, "threads", 1, 256, threadCount);
+        }
+
+        void PrintResult(size_t jsonFileIndex, size_t fileCount, const CloudNoiseBaker::Result& result)
+        {
+            if (!result.m_success)
+            {
+                fprintf(stderr, "[%zu/%zu] %s: FAILED. %s\n", jsonFileIndex + 1, fileCount,
+                    result.m_jsonFilePath.c_str(), result.m_errorMessage.c_str());
+                return;
+            }
+
+            printf("[%zu/%zu] %s: %u^3, %hu mips, %.2f MiB, bake %.1f ms, write %.1f ms, total %.1f ms\n",
+                jsonFileIndex + 1, fileCount, result.m_jsonFilePath.c_str(), result.m_pixelSize, result.m_mipLevels,
+                static_cast<double>(result.m_totalBytes) / (1024.0 * 1024.0),
+                result.m_bakeSeconds * 1000.0, result.m_writeSeconds * 1000.0,
+                (result.m_bakeSeconds + result.m_writeSeconds) * 1000.0);
+            for (size_t mipLevel = 0; mipLevel < result.m_mipLevelsPsnr.size(); ++mipLevel)
+            {
+                printf("    mip %zu PSNR: %.2f dB\n", mipLevel, result.m_mipLevelsPsnr[mipLevel]);
+            }
+            if (result.m_stats.IsValid())
+            {
+                constexpr const char* ChannelNames = "RGBA";
+                for (uint32_t channel = 0; channel < result.m_stats.m_channelCount; ++channel)
+                {
+                    const CloudTextureChannelStats& channelStats = result.m_stats.m_mipLevels[0].m_channels[channel];
+                    printf("    mip 0 %c: min %.3f, max %.3f, mean %.3f", ChannelNames[channel],
+                        channelStats.m_min, channelStats.m_max, channelStats.m_mean);
+                    if (result.m_stats.m_normalized)
+                    {
+                        printf(", remapped from [%.3f, %.3f]",
+                            result.m_stats.m_sourceRangeMin[channel], result.m_stats.m_sourceRangeMax[channel]);
+                    }
+                    printf("\n");
+                }
+            }
+            // PNG slices can be hundreds of files.
+            constexpr size_t MaxPrintedFiles = 4;
+            for (size_t savedFileIndex = 0; savedFileIndex < AZStd::min(result.m_savedFiles.size(), MaxPrintedFiles); ++savedFileIndex)
+            {
+                printf("    -> %s\n", result.m_savedFiles[savedFileIndex].c_str());
+            }
+            if (result.m_savedFiles.size() > MaxPrintedFiles)
+            {
+                printf("    -> ... and %zu more files.\n", result.m_savedFiles.size() - MaxPrintedFiles);
+            }
+        }
+
+        int RunNoiseBaker(int argc, char** argv)
+        {
+            AZ::CommandLine commandLine;
+            commandLine.Parse(argc, argv);
+
+            if (commandLine.HasSwitch("help") || commandLine.GetNumMiscValues() == 0)
+            {
+                PrintUsage();
+                return commandLine.HasSwitch("help") ? ExitSuccess : ExitInvalidArguments;
+            }
+
+            CloudNoiseBaker::Settings settings;
+            uint32_t threadCount = AZStd::max(AZStd::thread::hardware_concurrency(), 1u);
+            if (!ParseSettings(commandLine, settings, threadCount))
+            {
+                return ExitInvalidArguments;
+            }
+
+            // The same job system setup as AZ::JobManagerComponent. All the ICloudTextureWriter(s)
+            // and CloudTextureCpuBaker use the global job context.
+            AZ::JobManagerDesc jobManagerDesc;
+            for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+            {
+                jobManagerDesc.m_workerThreads.push_back(AZ::JobManagerThreadDesc());
+            }
+            auto jobManager = AZStd::make_unique<AZ::JobManager>(jobManagerDesc);
+            auto jobContext = AZStd::make_unique<AZ::JobContext>(*jobManager);
+            AZ::JobContext::SetGlobalContext(jobContext.get());
+
+            auto serializeContext = AZStd::make_unique<AZ::SerializeContext>();
+            auto registrationContext = AZStd::make_unique<AZ::JsonRegistrationContext>();
+            AZ::JsonSystemComponent::Reflect(registrationContext.get());
+            CloudTextureComputeData::Reflect(serializeContext.get());
+
+            printf("Baking %zu texture(s) as %s with %u worker threads.\n", commandLine.GetNumMiscValues(),
+                CloudNoiseBaker::GetOutputFormatName(settings.m_outputFormat), threadCount);
+
+            const CloudNoiseBaker noiseBaker(settings, serializeContext.get(), registrationContext.get());
+            const size_t fileCount = commandLine.GetNumMiscValues();
+            size_t failedCount = 0;
+            const auto startTime = AZStd::chrono::steady_clock::now();
+            for (size_t fileIndex = 0; fileIndex < fileCount; ++fileIndex)
+            {
+                const CloudNoiseBaker::Result result = noiseBaker.BakeFile(AZ::IO::Path(commandLine.GetMiscValue(fileIndex)));
+                PrintResult(fileIndex, fileCount, result);
+                failedCount += result.m_success ? 0 : 1;
+            }
+            const double totalSeconds = AZStd::chrono::duration<double>(AZStd::chrono::steady_clock::now() - startTime).count();
+            printf("Baked %zu of %zu texture(s) in %.2f s.\n", fileCount - failedCount, fileCount, totalSeconds);
+
+            registrationContext->EnableRemoveReflection();
+            AZ::JsonSystemComponent::Reflect(registrationContext.get());
+            registrationContext->DisableRemoveReflection();
+
+            AZ::JobContext::SetGlobalContext(nullptr);
+            jobContext.reset();
+            jobManager.reset();
+
+            return (failedCount == 0) ? ExitSuccess : ExitBakeFailed;
+        }
+    }
+
+} // namespace VolumetricClouds
+
+int main(int argc, char** argv)
+{
+    return VolumetricClouds::RunNoiseBaker(argc, argv);
+}
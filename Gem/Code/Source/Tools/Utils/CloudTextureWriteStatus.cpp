@@ -0,0 +1,52 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/std/algorithm.h>
+
+#include "CloudTextureWriteStatus.h"
+
+namespace VolumetricClouds
+{
+    bool CloudTextureWriteStatus::IsFinished() const
+    {
+        const State state = m_state;
+        return (state == State::Succeeded) || (state == State::Failed) || (state == State::Canceled);
+    }
+
+    float CloudTextureWriteStatus::GetProgress() const
+    {
+        const uint64_t totalBytes = m_totalBytes;
+        if (totalBytes == 0)
+        {
+            return IsFinished() ? 1.0f : 0.0f;
+        }
+        return AZStd::min(static_cast<float>(static_cast<double>(m_writtenBytes) / static_cast<double>(totalBytes)), 1.0f);
+    }
+
+    AZStd::string CloudTextureWriteStatus::GetErrorMessage() const
+    {
+        AZStd::scoped_lock lock(m_errorMessageMutex);
+        return m_errorMessage;
+    }
+
+    void CloudTextureWriteStatus::SetErrorMessage(const AZStd::string& errorMessage)
+    {
+        AZStd::scoped_lock lock(m_errorMessageMutex);
+        m_errorMessage = errorMessage;
+    }
+
+    void CloudTextureWriteStatus::SetFinished(bool success)
+    {
+        if (m_cancelRequested)
+        {
+            m_state = State::Canceled;
+            return;
+        }
+        m_state = success ? State::Succeeded : State::Failed;
+    }
+
+} // namespace VolumetricClouds
@@ -0,0 +1,68 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/parallel/atomic.h>
+#include <AzCore/std/parallel/mutex.h>
+#include <AzCore/std/string/string.h>
+
+namespace VolumetricClouds
+{
+    // Shared between an ICloudTextureWriter that saves from its own thread, and the thread
+    // that started it (e.g. the Editor main thread), which polls the progress
+    // and can request the cancellation at any time.
+    // All functions are thread safe.
+    class CloudTextureWriteStatus final
+    {
+    public:
+        enum class State : uint32_t
+        {
+            Pending,
+            Running,
+            Succeeded,
+            Failed,
+            Canceled,
+        };
+
+        CloudTextureWriteStatus() = default;
+        ~CloudTextureWriteStatus() = default;
+
+        // Functions called by the thread that waits for the writer.
+        void RequestCancel() { m_cancelRequested = true; }
+        State GetState() const { return m_state; }
+        bool IsFinished() const;
+        // A value between 0.0 and 1.0.
+        float GetProgress() const;
+        uint64_t GetWrittenBytes() const { return m_writtenBytes; }
+        uint64_t GetTotalBytes() const { return m_totalBytes; }
+        // Only valid once the state is Failed.
+        AZStd::string GetErrorMessage() const;
+
+        // Functions called by the writer.
+        bool IsCancelRequested() const { return m_cancelRequested; }
+        void SetRunning() { m_state = State::Running; }
+        void SetTotalBytes(uint64_t totalBytes) { m_totalBytes = totalBytes; }
+        void AddWrittenBytes(uint64_t byteCount) { m_writtenBytes += byteCount; }
+        void SetErrorMessage(const AZStd::string& errorMessage);
+        // Sets the final state: Succeeded or Failed depending on @success, unless
+        // the cancellation was requested, in which case the state is Canceled.
+        void SetFinished(bool success);
+
+    private:
+        AZ_DISABLE_COPY_MOVE(CloudTextureWriteStatus);
+
+        AZStd::atomic<State> m_state{ State::Pending };
+        AZStd::atomic_bool m_cancelRequested{ false };
+        AZStd::atomic<uint64_t> m_writtenBytes{ 0 };
+        AZStd::atomic<uint64_t> m_totalBytes{ 0 };
+
+        mutable AZStd::mutex m_errorMessageMutex;
+        AZStd::string m_errorMessage;
+    };
+
+} // namespace VolumetricClouds
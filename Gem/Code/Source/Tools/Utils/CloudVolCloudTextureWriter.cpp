@@ -0,0 +1,141 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include "CloudVolCloudTextureWriter.h"
+
+namespace VolumetricClouds
+{
+    CloudVolCloudTextureWriter::CloudVolCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix,
+        const CloudTextureComputeData& computeData, const CloudVolumeWriteSettings& writeSettings)
+        : ICloudTextureWriter(mipLevels, pixelFormat, outputDir, stemPrefix)
+        , m_computeData(computeData), m_writeSettings(writeSettings)
+    {
+
+    }
+
+
+    CloudVolCloudTextureWriter::~CloudVolCloudTextureWriter()
+    {
+
+    }
+
+    bool CloudVolCloudTextureWriter::WriteCloudVolumeFile(CloudTextureWriteStatus* status)
+    {
+        AZStd::vector<CloudTextureMipData> mipLevels;
+        mipLevels.reserve(GetMipLevels());
+        uint64_t totalBytes = 0;
+        for (const auto& mipLevelData : GetMipLevelDataList())
+        {
+            CloudTextureMipData& mipData = mipLevels.emplace_back();
+            mipData.m_dataBuffer = mipLevelData.m_dataBuffer;
+            mipData.m_mipSlice = mipLevelData.m_mipLevel;
+            mipData.m_mipSize = mipLevelData.m_mipSize;
+            totalBytes += mipLevelData.m_dataBuffer->size();
+        }
+
+        CloudVolumeFile::ProgressCallback progressCallback;
+        if (status)
+        {
+            status->SetTotalBytes(totalBytes);
+            progressCallback = [status](uint64_t writtenBytes)
+            {
+                status->AddWrittenBytes(writtenBytes);
+                return !status->IsCancelRequested();
+            };
+        }
+
+        const AZ::IO::Path outputFilePath = GetOutputFilePath();
+        if (!CloudVolumeFile::Write(outputFilePath, m_computeData, GetPixelFormat(), mipLevels, m_writeSettings, progressCallback,
+            nullptr, GetStats().get()))
+        {
+            if (status && !status->IsCancelRequested())
+            {
+                status->SetErrorMessage(AZStd::string::format("Failed to write %s.", outputFilePath.c_str()));
+            }
+            return false;
+        }
+
+        m_savedFiles.push_back(outputFilePath);
+        return true;
+    }
+
+    AZ::IO::Path CloudVolCloudTextureWriter::GetOutputFilePath() const
+    {
+        AZ::IO::Path outputFile = GetOuputDir();
+        outputFile.Append(AZStd::string::format("%s%s", GetStemPrefix().c_str(), CloudVolumeFile::FileExtension));
+        return outputFile;
+    }
+
+    //////////////////////////////////////////////////////////////
+    // ICloudTextureWriter Overrides ....
+    bool CloudVolCloudTextureWriter::SaveMipLevel(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles)
+    {
+        if (mipLevel >= GetMipLevels())
+        {
+            AZ_Error(LogName, false, "Invalid mip level=%hu. Max Level is %hu.\n", mipLevel, GetMipLevels());
+            return false;
+        }
+
+        if (!GetMipLevelDataList()[mipLevel].m_dataBuffer)
+        {
+            AZ_Error(LogName, false, "Can't save mip level %hu if there's no data buffer.\n", mipLevel);
+            return false;
+        }
+
+        SetMipLevelSaved(mipLevel);
+
+        if (GetMipLevelsWithDataCount() != GetMipLevels())
+        {
+            // The file is written once all the mip levels have data.
+            return true;
+        }
+
+        if (!m_savedFiles.empty())
+        {
+            return true; // File already created.
+        }
+
+        if (!WriteCloudVolumeFile(nullptr))
+        {
+            return false;
+        }
+
+        if (savedFiles)
+        {
+            savedFiles->push_back(m_savedFiles.back());
+        }
+        return true;
+    }
+
+    bool CloudVolCloudTextureWriter::SaveAllMipLevels(CloudTextureWriteStatus& status)
+    {
+        if (GetMipLevelsWithDataCount() != GetMipLevels())
+        {
+            status.SetErrorMessage(AZStd::string::format("Only %hu of %hu mip levels have data.", GetMipLevelsWithDataCount(), GetMipLevels()));
+            return false;
+        }
+
+        if (!m_savedFiles.empty())
+        {
+            return true; // File already created.
+        }
+
+        if (!WriteCloudVolumeFile(&status))
+        {
+            return false;
+        }
+
+        for (uint16_t mipIdx = 0; mipIdx < GetMipLevels(); mipIdx++)
+        {
+            SetMipLevelSaved(mipIdx);
+        }
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////
+
+} // namespace VolumetricClouds
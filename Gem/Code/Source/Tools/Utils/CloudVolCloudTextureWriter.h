@@ -0,0 +1,49 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <Renderer/CloudVolumeFile.h>
+#include "ICloudTextureWriter.h"
+
+namespace VolumetricClouds
+{
+    // Writes all the mips of a volume texture in a single .cloudvol file. See CloudVolumeFile.
+    // The CloudTextureComputeData that generated the texture is saved in the file header.
+    class CloudVolCloudTextureWriter final : public ICloudTextureWriter
+    {
+    public:
+        CloudVolCloudTextureWriter() = delete;
+        CloudVolCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix,
+                                   const CloudTextureComputeData& computeData, const CloudVolumeWriteSettings& writeSettings = {});
+        virtual ~CloudVolCloudTextureWriter();
+
+        static constexpr char LogName[] = "CloudVolCloudTextureWriter";
+
+        //////////////////////////////////////////////////////////////
+        // ICloudTextureWriter Overrides ....
+        const char* GetLogName() const override { return LogName; }
+        bool SaveMipLevel(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles = nullptr) override;
+        bool SaveAllMipLevels(CloudTextureWriteStatus& status) override;
+        const AZStd::vector<AZ::IO::Path>& GetListOfSavedFiles() const override { return m_savedFiles; }
+        //////////////////////////////////////////////////////////////
+
+
+    private:
+        // Writes the .cloudvol file. All the mip levels must have data.
+        // @status Optional. Receives the progress, and is checked for cancellation after each brick.
+        bool WriteCloudVolumeFile(CloudTextureWriteStatus* status);
+
+        AZ::IO::Path GetOutputFilePath() const;
+
+        CloudTextureComputeData m_computeData;
+        CloudVolumeWriteSettings m_writeSettings;
+
+        // All mip levels are saved in a single file.
+        AZStd::vector<AZ::IO::Path> m_savedFiles;
+    };
+} // namespace VolumetricClouds
@@ -5,18 +5,17 @@
 *
 */
 
-#pragma once
-
 #include <AzCore/Console/Console.h>
-
-#include <Atom/Utils/DdsFile.h>
+#include <AzCore/IO/SystemFile.h>
 
 #include "DdsCloudTextureWriter.h"
 
 namespace VolumetricClouds
 {
-    DdsCloudTextureWriter::DdsCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix)
+    DdsCloudTextureWriter::DdsCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix,
+        CloudTextureCompression compression, uint32_t firstChannel)
         : ICloudTextureWriter(mipLevels, pixelFormat, outputDir, stemPrefix)
+        , m_compression(compression), m_firstChannel(firstChannel)
     {
 
     }
@@ -43,16 +42,282 @@ namespace VolumetricClouds
         return  depthSliceSize * mipSize.m_depth;
     }
 
-    uint32_t DdsCloudTextureWriter::CalculatePixelBufferSize()
+    // The DDS header is written here, instead of with AZ::DdsFile::WriteFile(), so the mips can be
+    // streamed to the file one after the other, without concatenating them in a single buffer first.
+    // See https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+    // and https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header-dxt10
+    namespace DdsLayout
+    {
+        static constexpr uint32_t Magic = 0x20534444; // "DDS "
+        static constexpr uint32_t FourCCDX10 = 0x30315844; // "DX10"
+
+        static constexpr uint32_t FlagCaps = 0x1;
+        static constexpr uint32_t FlagHeight = 0x2;
+        static constexpr uint32_t FlagWidth = 0x4;
+        static constexpr uint32_t FlagPitch = 0x8;
+        static constexpr uint32_t FlagPixelFormat = 0x1000;
+        static constexpr uint32_t FlagMipMapCount = 0x20000;
+        static constexpr uint32_t FlagLinearSize = 0x80000;
+        static constexpr uint32_t FlagDepth = 0x800000;
+
+        static constexpr uint32_t PixelFormatFlagFourCC = 0x4;
+
+        static constexpr uint32_t CapsComplex = 0x8;
+        static constexpr uint32_t CapsTexture = 0x1000;
+        static constexpr uint32_t CapsMipMap = 0x400000;
+        static constexpr uint32_t Caps2Volume = 0x200000;
+
+        static constexpr uint32_t ResourceDimensionTexture3D = 4;
+
+        struct PixelFormat
+        {
+            uint32_t m_size = sizeof(PixelFormat);
+            uint32_t m_flags = 0;
+            uint32_t m_fourCC = 0;
+            uint32_t m_rgbBitCount = 0;
+            uint32_t m_bitMasks[4] = {};
+        };
+
+        struct Header
+        {
+            uint32_t m_size = sizeof(Header);
+            uint32_t m_flags = 0;
+            uint32_t m_height = 0;
+            uint32_t m_width = 0;
+            uint32_t m_pitchOrLinearSize = 0;
+            uint32_t m_depth = 0;
+            uint32_t m_mipMapCount = 0;
+            uint32_t m_reserved1[11] = {};
+            PixelFormat m_pixelFormat;
+            uint32_t m_caps = 0;
+            uint32_t m_caps2 = 0;
+            uint32_t m_caps3 = 0;
+            uint32_t m_caps4 = 0;
+            uint32_t m_reserved2 = 0;
+        };
+        static_assert(sizeof(Header) == 124, "The DDS header must be 124 bytes");
+
+        struct HeaderDxt10
+        {
+            uint32_t m_dxgiFormat = 0;
+            uint32_t m_resourceDimension = ResourceDimensionTexture3D;
+            uint32_t m_miscFlag = 0;
+            uint32_t m_arraySize = 1;
+            uint32_t m_miscFlags2 = 0;
+        };
+
+        // Returns 0 (DXGI_FORMAT_UNKNOWN) for the formats that are never written by this class.
+        static uint32_t GetDxgiFormat(AZ::RHI::Format format)
+        {
+            switch (format)
+            {
+            case AZ::RHI::Format::R8G8B8A8_UNORM: return 28;
+            case AZ::RHI::Format::R8G8_UNORM: return 49;
+            case AZ::RHI::Format::R16_FLOAT: return 54;
+            case AZ::RHI::Format::R8_UNORM: return 61;
+            case AZ::RHI::Format::BC4_UNORM: return 80;
+            case AZ::RHI::Format::BC5_UNORM: return 83;
+            case AZ::RHI::Format::BC7_UNORM: return 98;
+            default: return 0;
+            }
+        }
+    } // namespace DdsLayout
+
+    bool DdsCloudTextureWriter::CompressMipLevels(AZStd::vector<CloudTextureBlockCompressor::CompressedMipLevel>& compressedMips)
+    {
+        if (GetPixelFormat() != AZ::RHI::Format::R8G8B8A8_UNORM)
+        {
+            AZ_Error(LogName, false, "Block compression requires R8G8B8A8_UNORM data. Got format %s.\n", AZ::RHI::ToString(GetPixelFormat()));
+            return false;
+        }
+
+        AZStd::vector<CloudTextureMipData> mipLevels;
+        mipLevels.reserve(GetMipLevels());
+        for (const auto& mipLevelData : GetMipLevelDataList())
+        {
+            CloudTextureMipData mipData;
+            mipData.m_dataBuffer = mipLevelData.m_dataBuffer;
+            mipData.m_mipSlice = mipLevelData.m_mipLevel;
+            mipData.m_mipSize = mipLevelData.m_mipSize;
+            mipLevels.push_back(mipData);
+        }
+
+        // All the slices of all the mips are compressed in parallel.
+        compressedMips = CloudTextureBlockCompressor::Compress(m_compression, m_firstChannel, mipLevels);
+        if (compressedMips.size() != mipLevels.size())
+        {
+            AZ_Error(LogName, false, "Failed to compress the mip levels.\n");
+            return false;
+        }
+
+        m_mipLevelsPsnr.clear();
+        for (size_t mipIdx = 0; mipIdx < compressedMips.size(); mipIdx++)
+        {
+            const auto& compressedMip = compressedMips[mipIdx];
+            m_mipLevelsPsnr.push_back(compressedMip.m_psnr);
+            AZ_Printf(LogName, "Mip %zu (%ux%ux%u): %zu bytes, PSNR=%.2f dB.\n", mipIdx,
+                compressedMip.m_mipSize.m_width, compressedMip.m_mipSize.m_height, compressedMip.m_mipSize.m_depth,
+                compressedMip.m_data.size(), compressedMip.m_psnr);
+        }
+        return true;
+    }
+
+    bool DdsCloudTextureWriter::WriteDdsFile(CloudTextureWriteStatus* status)
     {
-        // See https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-file-layout-for-volume-textures.
-        uint32_t totalBufferSize = 0;
+        auto reportError = [status](const AZStd::string& errorMessage)
+        {
+            AZ_Error(LogName, false, "%s\n", errorMessage.c_str());
+            if (status)
+            {
+                status->SetErrorMessage(errorMessage);
+            }
+            return false;
+        };
+
+        // Block compressed volumes have the same layout, each slice is just made of 4x4 blocks instead of pixels.
+        AZStd::vector<CloudTextureBlockCompressor::CompressedMipLevel> compressedMips;
+        AZ::RHI::Format ddsFormat = GetPixelFormat();
+        if (m_compression != CloudTextureCompression::None)
+        {
+            if (!CompressMipLevels(compressedMips))
+            {
+                return reportError("Failed to compress the mip levels.");
+            }
+            ddsFormat = CloudTextureBlockCompressor::GetFormat(m_compression);
+        }
+
+        const uint32_t dxgiFormat = DdsLayout::GetDxgiFormat(ddsFormat);
+        if (!dxgiFormat)
+        {
+            return reportError(AZStd::string::format("Format %s is not supported.", AZ::RHI::ToString(ddsFormat)));
+        }
+
+        // Where the bytes of each mip level come from. Either the readback buffers or the compressed mips.
+        // Per https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-file-layout-for-volume-textures
+        // the mips go one after the other, and within each mip, the depth slices one after the other.
+        struct MipBytes
+        {
+            const uint8_t* m_data = nullptr;
+            size_t m_byteCount = 0;
+            uint32_t m_depth = 1;
+        };
+        AZStd::vector<MipBytes> mipBytesList;
+        mipBytesList.reserve(GetMipLevels());
+        uint64_t totalBytes = sizeof(DdsLayout::Magic) + sizeof(DdsLayout::Header) + sizeof(DdsLayout::HeaderDxt10);
         for (uint16_t mipIdx = 0; mipIdx < GetMipLevels(); mipIdx++)
         {
-            const auto & mipLevelData = GetMipLevelDataList()[mipIdx];
-            totalBufferSize += DdsCalculateMipSizeInBytes(mipLevelData.m_mipSize, GetPixelFormat());
+            const auto& mipLevelData = GetMipLevelDataList()[mipIdx];
+            MipBytes& mipBytes = mipBytesList.emplace_back();
+            mipBytes.m_depth = mipLevelData.m_mipSize.m_depth;
+            if (m_compression != CloudTextureCompression::None)
+            {
+                mipBytes.m_data = compressedMips[mipIdx].m_data.data();
+                mipBytes.m_byteCount = compressedMips[mipIdx].m_data.size();
+            }
+            else
+            {
+                mipBytes.m_data = mipLevelData.m_dataBuffer->data();
+                mipBytes.m_byteCount = DdsCalculateMipSizeInBytes(mipLevelData.m_mipSize, GetPixelFormat());
+                if (mipLevelData.m_dataBuffer->size() < mipBytes.m_byteCount)
+                {
+                    return reportError(AZStd::string::format("Mip level %hu has %zu bytes, expected %zu.",
+                        mipIdx, mipLevelData.m_dataBuffer->size(), mipBytes.m_byteCount));
+                }
+            }
+            totalBytes += mipBytes.m_byteCount;
+        }
+        if (status)
+        {
+            status->SetTotalBytes(totalBytes);
+        }
+
+        const auto& mip0Size = GetMipLevelDataList()[0].m_mipSize;
+        DdsLayout::Header header;
+        header.m_flags = DdsLayout::FlagCaps | DdsLayout::FlagHeight | DdsLayout::FlagWidth | DdsLayout::FlagPixelFormat
+            | DdsLayout::FlagMipMapCount | DdsLayout::FlagDepth;
+        if (m_compression != CloudTextureCompression::None)
+        {
+            // Size of the top level slice.
+            header.m_flags |= DdsLayout::FlagLinearSize;
+            header.m_pitchOrLinearSize = static_cast<uint32_t>(mipBytesList[0].m_byteCount / mipBytesList[0].m_depth);
         }
-        return totalBufferSize;
+        else
+        {
+            header.m_flags |= DdsLayout::FlagPitch;
+            header.m_pitchOrLinearSize = DdsCalculateRowSizeForWidth(mip0Size.m_width, GetPixelFormat());
+        }
+        header.m_height = mip0Size.m_height;
+        header.m_width = mip0Size.m_width;
+        header.m_depth = mip0Size.m_depth;
+        header.m_mipMapCount = GetMipLevels();
+        header.m_pixelFormat.m_flags = DdsLayout::PixelFormatFlagFourCC;
+        header.m_pixelFormat.m_fourCC = DdsLayout::FourCCDX10;
+        header.m_caps = DdsLayout::CapsComplex | DdsLayout::CapsTexture | DdsLayout::CapsMipMap;
+        header.m_caps2 = DdsLayout::Caps2Volume;
+
+        DdsLayout::HeaderDxt10 headerDxt10;
+        headerDxt10.m_dxgiFormat = dxgiFormat;
+
+        const AZ::IO::Path outputFile = GetOutputFilePath();
+        AZ::IO::SystemFile file;
+        if (!file.Open(outputFile.c_str(), AZ::IO::SystemFile::SF_OPEN_CREATE | AZ::IO::SystemFile::SF_OPEN_WRITE_ONLY))
+        {
+            return reportError(AZStd::string::format("Failed to create file %s.", outputFile.c_str()));
+        }
+
+        auto writeBytes = [&](const void* data, uint64_t byteCount)
+        {
+            if (file.Write(data, byteCount) != byteCount)
+            {
+                return false;
+            }
+            if (status)
+            {
+                status->AddWrittenBytes(byteCount);
+            }
+            return true;
+        };
+
+        auto discardFile = [&](const AZStd::string& errorMessage)
+        {
+            file.Close();
+            AZ::IO::SystemFile::Delete(outputFile.c_str());
+            return errorMessage.empty() ? false : reportError(errorMessage);
+        };
+
+        const uint32_t magic = DdsLayout::Magic;
+        if (!writeBytes(&magic, sizeof(magic)) || !writeBytes(&header, sizeof(header)) || !writeBytes(&headerDxt10, sizeof(headerDxt10)))
+        {
+            return discardFile(AZStd::string::format("Failed to write the header of %s.", outputFile.c_str()));
+        }
+
+        for (uint16_t mipIdx = 0; mipIdx < GetMipLevels(); mipIdx++)
+        {
+            const MipBytes& mipBytes = mipBytesList[mipIdx];
+            const size_t sliceByteCount = mipBytes.m_byteCount / mipBytes.m_depth;
+            for (uint32_t sliceIdx = 0; sliceIdx < mipBytes.m_depth; sliceIdx++)
+            {
+                if (status && status->IsCancelRequested())
+                {
+                    return discardFile({});
+                }
+                if (!writeBytes(mipBytes.m_data + sliceIdx * sliceByteCount, sliceByteCount))
+                {
+                    return discardFile(AZStd::string::format("Failed to write mip level %hu of %s.", mipIdx, outputFile.c_str()));
+                }
+            }
+        }
+
+        file.Close();
+        m_savedFiles.push_back(outputFile);
+        return true;
+    }
+
+    AZ::IO::Path DdsCloudTextureWriter::GetOutputFilePath() const
+    {
+        AZ::IO::Path outputFile = GetOuputDir();
+        outputFile.Append(AZStd::string::format("%s.dds", GetStemPrefix().c_str()));
+        return outputFile;
     }
 
     //////////////////////////////////////////////////////////////
@@ -85,41 +350,41 @@ namespace VolumetricClouds
             return true; // DDS file already created.
         }
 
-        AZStd::vector<uint8_t> ddsPixelBuffer;
-        ddsPixelBuffer.resize_no_construct(CalculatePixelBufferSize());
+        // We have everything we need to create the one and only DDS File.
+        if (!WriteDdsFile(nullptr))
+        {
+            return false;
+        }
 
-        // Time to dump all the mips into a single buffer
-        // per https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-file-layout-for-volume-textures
-        uint8_t* currentPixelPtr = ddsPixelBuffer.data();
-        for (uint16_t mipIdx = 0; mipIdx < GetMipLevels(); mipIdx++)
+        if (savedFiles)
         {
-            const auto& mipLevelData = GetMipLevelDataList()[mipIdx];
-            memcpy(currentPixelPtr, mipLevelData.m_dataBuffer->data(), mipLevelData.m_dataBuffer->size());
-            currentPixelPtr += mipLevelData.m_dataBuffer->size();
+            savedFiles->push_back(m_savedFiles.back());
         }
+        return true;
+    }
 
-        const auto & mipLevel0Data = GetMipLevelDataList()[0];
-        // We have everything we need to create the one and only DDS File.
-        AZ::DdsFile::DdsFileData ddsFileData;
-        ddsFileData.m_size = mipLevel0Data.m_mipSize;
-        ddsFileData.m_format = GetPixelFormat();
-        ddsFileData.m_mipLevels = GetMipLevels();
-        ddsFileData.m_buffer = &ddsPixelBuffer;
+    bool DdsCloudTextureWriter::SaveAllMipLevels(CloudTextureWriteStatus& status)
+    {
+        if (GetMipLevelsWithDataCount() != GetMipLevels())
+        {
+            status.SetErrorMessage(AZStd::string::format("Only %hu of %hu mip levels have data.", GetMipLevelsWithDataCount(), GetMipLevels()));
+            return false;
+        }
 
-        AZ::IO::Path outputFile = GetOuputDir();
-        outputFile.Append(AZStd::string::format("%s.dds", GetStemPrefix().c_str()));
-        auto outcome = AZ::DdsFile::WriteFile(outputFile.String(), ddsFileData);
-        if (!outcome)
+        if (!m_savedFiles.empty())
+        {
+            return true; // DDS file already created.
+        }
+
+        if (!WriteDdsFile(&status))
         {
-            AZ_Error(LogName, false, outcome.GetError().m_message.c_str());
             return false;
         }
 
-        if (savedFiles)
+        for (uint16_t mipIdx = 0; mipIdx < GetMipLevels(); mipIdx++)
         {
-            savedFiles->push_back(outputFile);
+            SetMipLevelSaved(mipIdx);
         }
-        m_savedFiles.emplace_back(AZStd::move(outputFile));
         return true;
     }
 
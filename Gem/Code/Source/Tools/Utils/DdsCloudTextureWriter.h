@@ -7,31 +7,53 @@
 
 #pragma once
 
+#include <Renderer/Cpu/CloudTextureBlockCompressor.h>
 #include "ICloudTextureWriter.h"
 
 namespace VolumetricClouds
 {
+    // Writes all the mips of a volume texture in a single DDS file.
+    // The RGBA8 data can optionally be block compressed (BC4, BC5 or BC7) before writing. In that
+    // case, the PSNR of each compressed mip level is available after the file is saved.
+    // The DDS header is followed by each mip buffer, streamed to the file one depth slice
+    // at a time, straight from the readback buffers. The mips are never concatenated in memory.
     class DdsCloudTextureWriter final : public ICloudTextureWriter
     {
     public:
         DdsCloudTextureWriter() = delete;
-        DdsCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix);
+        // @compression If different than None, @pixelFormat must be R8G8B8A8_UNORM.
+        // @firstChannel First source channel for BC4 and BC5. See CloudTextureBlockCompressor.
+        DdsCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix,
+                              CloudTextureCompression compression = CloudTextureCompression::None, uint32_t firstChannel = 0);
         virtual ~DdsCloudTextureWriter();
 
-        static constexpr char LogName[] = "PngCloudTextureWriter";
+        static constexpr char LogName[] = "DdsCloudTextureWriter";
 
         //////////////////////////////////////////////////////////////
         // ICloudTextureWriter Overrides ....
         const char* GetLogName() const override { return LogName; }
         bool SaveMipLevel(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles = nullptr) override;
+        bool SaveAllMipLevels(CloudTextureWriteStatus& status) override;
         const AZStd::vector<AZ::IO::Path>& GetListOfSavedFiles() const override { return m_savedFiles; }
+        // Empty if the texture is not compressed, or not saved yet.
+        const AZStd::vector<double>& GetMipLevelsPsnr() const override { return m_mipLevelsPsnr; }
         //////////////////////////////////////////////////////////////
 
 
     private:
-        // Returns the expected size of the buffer that contains all the mips and slices
-        // as required for a volume texture.
-        uint32_t CalculatePixelBufferSize();
+        // Compresses all the mips, and records their PSNR.
+        bool CompressMipLevels(AZStd::vector<CloudTextureBlockCompressor::CompressedMipLevel>& compressedMips);
+
+        // Writes the DDS file. All the mip levels must have data.
+        // @status Optional. Receives the progress, and is checked for cancellation between depth slices.
+        // A partially written file is deleted.
+        bool WriteDdsFile(CloudTextureWriteStatus* status);
+
+        AZ::IO::Path GetOutputFilePath() const;
+
+        CloudTextureCompression m_compression = CloudTextureCompression::None;
+        uint32_t m_firstChannel = 0;
+        AZStd::vector<double> m_mipLevelsPsnr;
 
         // REMARK: In a single DDS file we save all mip levels of a volume texture.
         AZStd::vector<AZ::IO::Path> m_savedFiles;
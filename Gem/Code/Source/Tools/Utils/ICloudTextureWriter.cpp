@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <AzCore/std/parallel/thread.h>
+
 #include "ICloudTextureWriter.h"
 
 namespace VolumetricClouds
@@ -44,6 +46,53 @@ namespace VolumetricClouds
         return DataBufferForMipLevelAdded(mipData);
     }
 
+    bool ICloudTextureWriter::SaveAllMipLevels(CloudTextureWriteStatus& status)
+    {
+        uint64_t totalBytes = 0;
+        for (const auto& mipLevelData : m_mipLevelsDataList)
+        {
+            if (!mipLevelData.m_dataBuffer)
+            {
+                status.SetErrorMessage(AZStd::string::format("There's no data for mip level=%hu", mipLevelData.m_mipLevel));
+                return false;
+            }
+            totalBytes += mipLevelData.m_dataBuffer->size();
+        }
+        status.SetTotalBytes(totalBytes);
+
+        for (uint16_t mipLevel = 0; mipLevel < m_mipLevels; mipLevel++)
+        {
+            if (status.IsCancelRequested())
+            {
+                return false;
+            }
+            if (!SaveMipLevel(mipLevel))
+            {
+                status.SetErrorMessage(AZStd::string::format("Failed to save mip level=%hu", mipLevel));
+                return false;
+            }
+            status.AddWrittenBytes(m_mipLevelsDataList[mipLevel].m_dataBuffer->size());
+        }
+        return true;
+    }
+
+    void ICloudTextureWriter::SaveAllMipLevelsAsync(AZStd::shared_ptr<ICloudTextureWriter> writer, AZStd::shared_ptr<CloudTextureWriteStatus> status)
+    {
+        status->SetRunning();
+        auto saveFunction = [writer, status]()
+        {
+            const bool success = writer->SaveAllMipLevels(*status);
+            status->SetFinished(success);
+        };
+
+        // The file writes block for as long as the disk takes. A dedicated thread, instead of a job,
+        // keeps the workers of the job system free for the frame.
+        AZStd::thread_desc threadDesc;
+        threadDesc.m_name = "CloudTextureWriter";
+        AZStd::thread saveThread(threadDesc, AZStd::move(saveFunction));
+        saveThread.detach();
+    }
+
     void ICloudTextureWriter::SetMipLevelSaved(uint16_t mipLevel)
     {
         m_savedMipLevels[mipLevel] = true;
@@ -15,6 +15,10 @@
 #include <Atom/RHI.Reflect/Size.h>
 #include <Atom/RHI.Reflect/Format.h>
 
+#include <VolumetricClouds/CloudTextureStats.h>
+
+#include "CloudTextureWriteStatus.h"
+
 namespace VolumetricClouds
 {
     class ICloudTextureWriter
@@ -27,6 +31,11 @@ namespace VolumetricClouds
         bool SetDataBufferForMipLevel(AZStd::shared_ptr<AZStd::vector<uint8_t>> dataBuffer,
                                       uint16_t mipLevel, AZ::RHI::Size mipSize);
 
+        //! Optional stats of the mip levels, saved as metadata by the formats that have room for it,
+        //! like .cloudvol. DDS and PNG ignore them.
+        void SetStats(AZStd::shared_ptr<const CloudTextureStats> stats) { m_stats = stats; }
+        const AZStd::shared_ptr<const CloudTextureStats>& GetStats() const { return m_stats; }
+
         // Used for AZ_Warning, AZ_Printf, etc
         virtual const char* GetLogName() const = 0;
 
@@ -40,11 +49,25 @@ namespace VolumetricClouds
         //! is out of bounds.
         virtual bool SaveMipLevel(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles = nullptr) = 0;
 
+        //! Saves all the mip levels. All of them must have data.
+        //! The progress is reported to @status, and the function returns false as soon as
+        //! possible once the cancellation is requested.
+        //! The default implementation calls SaveMipLevel() for each mip level.
+        virtual bool SaveAllMipLevels(CloudTextureWriteStatus& status);
+
+        //! Calls SaveAllMipLevels() from a dedicated thread and returns right away. The final state is set in @status
+        //! when the thread is done. The thread keeps @writer and @status alive, so the caller can drop them at any time.
+        static void SaveAllMipLevelsAsync(AZStd::shared_ptr<ICloudTextureWriter> writer, AZStd::shared_ptr<CloudTextureWriteStatus> status);
+
         //! Returns a list of all created files. If an empty list is returned it is not necessarily
         //! a sign of error. For example for DDS files it may mean that not all mips data buffers
         //! are available
         virtual const AZStd::vector<AZ::IO::Path>& GetListOfSavedFiles() const = 0;
 
+        //! Returns the PSNR, in decibels, of each saved mip level against the original data.
+        //! Empty for lossless formats.
+        virtual const AZStd::vector<double>& GetMipLevelsPsnr() const { return m_losslessMipLevelsPsnr; }
+
         uint16_t GetSavedMipLevelsCount() const { return static_cast<uint16_t>(m_savedMipLevels.count()); }
         uint16_t GetMipLevelsWithDataCount() const { return static_cast<uint16_t>(m_mipLevelsWithData.count()); }
         uint16_t GetMipLevels() const { return m_mipLevels; }
@@ -72,5 +95,7 @@ namespace VolumetricClouds
         AZStd::vector<MipLevelData> m_mipLevelsDataList;
         AZStd::bitset<16> m_savedMipLevels;
         AZStd::bitset<16> m_mipLevelsWithData;
+        const AZStd::vector<double> m_losslessMipLevelsPsnr;
+        AZStd::shared_ptr<const CloudTextureStats> m_stats;
     };
 } // namespace VolumetricClouds
\ No newline at end of file
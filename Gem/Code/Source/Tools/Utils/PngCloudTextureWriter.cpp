@@ -8,15 +8,37 @@
 #pragma once
 
 #include <AzCore/Console/Console.h>
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/std/parallel/atomic.h>
 
+#include <Atom/RHI.Reflect/Format.h>
 #include <Atom/Utils/PngFile.h>
 
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+
 #include "PngCloudTextureWriter.h"
 
 namespace VolumetricClouds
 {
-    PngCloudTextureWriter::PngCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix)
+    namespace
+    {
+        AZ::Utils::PngFile::SaveSettings GetPngSaveSettings()
+        {
+            AZ::Utils::PngFile::SaveSettings saveSettings;
+            if (auto console = AZ::Interface<AZ::IConsole>::Get(); console != nullptr)
+            {
+                console->GetCvarValue("r_pngCompressionLevel", saveSettings.m_compressionLevel);
+            }
+            saveSettings.m_stripAlpha = false;
+            return saveSettings;
+        }
+    }
+
+    PngCloudTextureWriter::PngCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix,
+        PngCloudTextureLayout layout, size_t maxInFlightBytes)
         : ICloudTextureWriter(mipLevels, pixelFormat, outputDir, stemPrefix)
+        , m_layout(layout)
+        , m_maxInFlightBytes(maxInFlightBytes)
     {
 
     }
@@ -27,9 +49,53 @@ namespace VolumetricClouds
 
     }
 
+    void PngCloudTextureWriter::CalculateAtlasGrid(uint32_t sliceCount, uint32_t& columns, uint32_t& rows)
+    {
+        columns = 1;
+        while (columns * columns < sliceCount)
+        {
+            columns <<= 1;
+        }
+        rows = AZStd::max((sliceCount + columns - 1) / columns, 1u);
+    }
+
     //////////////////////////////////////////////////////////////
     // ICloudTextureWriter Overrides ....
     bool PngCloudTextureWriter::SaveMipLevel(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles)
+    {
+        return SaveMipLevelInternal(mipLevel, savedFiles, nullptr);
+    }
+
+    bool PngCloudTextureWriter::SaveAllMipLevels(CloudTextureWriteStatus& status)
+    {
+        uint64_t totalBytes = 0;
+        for (const auto& mipLevelData : GetMipLevelDataList())
+        {
+            if (!mipLevelData.m_dataBuffer)
+            {
+                status.SetErrorMessage(AZStd::string::format("There's no data for mip level=%hu", mipLevelData.m_mipLevel));
+                return false;
+            }
+            totalBytes += mipLevelData.m_dataBuffer->size();
+        }
+        status.SetTotalBytes(totalBytes);
+
+        for (uint16_t mipLevel = 0; mipLevel < GetMipLevels(); mipLevel++)
+        {
+            if (!SaveMipLevelInternal(mipLevel, nullptr, &status))
+            {
+                if (!status.IsCancelRequested())
+                {
+                    status.SetErrorMessage(AZStd::string::format("Failed to save mip level=%hu", mipLevel));
+                }
+                return false;
+            }
+        }
+        return true;
+    }
+    //////////////////////////////////////////////////////////////
+
+    bool PngCloudTextureWriter::SaveMipLevelInternal(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles, CloudTextureWriteStatus* status)
     {
         if (mipLevel >= GetMipLevels())
         {
@@ -37,58 +103,159 @@ namespace VolumetricClouds
             return false;
         }
 
-        const auto& mipLevelData = GetMipLevelDataList()[mipLevel];
-        if (!mipLevelData.m_dataBuffer)
+        if (!GetMipLevelDataList()[mipLevel].m_dataBuffer)
         {
             AZ_Error(LogName, false, "There's no data for mip level=%hu\n", mipLevel);
             return false;
         }
 
-        AZ::Utils::PngFile::SaveSettings saveSettings;
-        if (auto console = AZ::Interface<AZ::IConsole>::Get(); console != nullptr)
+        AZStd::vector<AZ::IO::Path> outputFiles;
+        const bool success = (m_layout == PngCloudTextureLayout::FlipbookAtlas) ?
+            SaveFlipbookAtlas(mipLevel, outputFiles, status) : SaveSlices(mipLevel, outputFiles, status);
+        if (!success)
         {
-            console->GetCvarValue("r_pngCompressionLevel", saveSettings.m_compressionLevel);
+            return false;
         }
-        saveSettings.m_stripAlpha = false; 
 
+        if (savedFiles)
+        {
+            savedFiles->insert(savedFiles->end(), outputFiles.begin(), outputFiles.end());
+        }
+        m_savedFiles.insert(m_savedFiles.end(), outputFiles.begin(), outputFiles.end());
+        SetMipLevelSaved(mipLevel);
+        return true;
+    }
+
+    bool PngCloudTextureWriter::SaveSlices(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>& outputFiles, CloudTextureWriteStatus* status)
+    {
+        const auto& mipLevelData = GetMipLevelDataList()[mipLevel];
         const uint8_t* const mipDataBuffer = mipLevelData.m_dataBuffer->data();
+        const auto saveSettings = GetPngSaveSettings();
 
         const auto mipSize = mipLevelData.m_mipSize;
         const uint32_t numSlices = mipSize.m_depth;
-        const uint32_t numRows = mipSize.m_height;
-        const uint32_t numColumns = mipSize.m_width;
-        const uint32_t bytesPerRow = numColumns * 4;
-        const uint32_t bytesPerSlice = bytesPerRow * numRows;
-        //const uint8_t* bytes = imageCpuBytes->data();
+        const size_t bytesPerRow = static_cast<size_t>(mipSize.m_width) * AZ::RHI::GetFormatSize(GetPixelFormat());
+        const size_t bytesPerSlice = bytesPerRow * mipSize.m_height;
+
+        // Each slice is written to a file whose name only depends on the slice index, and the list
+        // of files is kept in slice order, so the output doesn't depend on the order the jobs finish.
+        outputFiles.resize(numSlices);
         for (uint32_t sliceIdx = 0; sliceIdx < numSlices; ++sliceIdx)
         {
-            //const uint8_t* slicePtr = bytes + (bytesPerSlice * sliceIdx);
-            const auto itBegin = mipDataBuffer + (bytesPerSlice * sliceIdx);
-            const auto itEnd = itBegin + bytesPerSlice;
-            AZStd::span<const uint8_t> spanBytes = { itBegin, itEnd };
-            AZ::Utils::PngFile pngImage = AZ::Utils::PngFile::Create(mipSize, GetPixelFormat(), spanBytes);
-            if (!pngImage)
+            outputFiles[sliceIdx] = GetOuputDir();
+            outputFiles[sliceIdx].Append(AZStd::string::format("%s_%u_%u.png", GetStemPrefix().c_str(), mipLevel, sliceIdx));
+        }
+
+        // Each PngFile holds a copy of its slice, plus the zlib buffers, while it is encoded.
+        // Encoding the slices in batches bounds the memory used by the jobs, no matter the size of the volume.
+        const uint32_t sliceBatchSize = static_cast<uint32_t>(AZStd::clamp(m_maxInFlightBytes / AZStd::max(bytesPerSlice, size_t(1)),
+            size_t(1), static_cast<size_t>(numSlices)));
+        AZStd::atomic_bool failed{ false };
+        for (uint32_t firstBatchSlice = 0; firstBatchSlice < numSlices; firstBatchSlice += sliceBatchSize)
+        {
+            if (status && status->IsCancelRequested())
             {
-                AZ_Error(LogName, false, "Failed to create png image for slice number=%u\n", sliceIdx);
                 return false;
             }
-            AZ::IO::Path outputFilePath = GetOuputDir();
-            outputFilePath.Append(AZStd::string::format("%s_%u_%u.png", GetStemPrefix().c_str(), mipLevel, sliceIdx));
-            if (!pngImage.Save(outputFilePath.c_str(), saveSettings))
+
+            const uint32_t batchSliceCount = AZStd::min(sliceBatchSize, numSlices - firstBatchSlice);
+            CloudTextureCpuBaker::ForEachSlab(AZ::JobContext::GetGlobalContext(), batchSliceCount, [&](uint32_t firstSlice, uint32_t sliceCount)
+                {
+                    for (uint32_t sliceIdx = firstBatchSlice + firstSlice; sliceIdx < firstBatchSlice + firstSlice + sliceCount; ++sliceIdx)
+                    {
+                        if (failed)
+                        {
+                            return;
+                        }
+                        const auto itBegin = mipDataBuffer + (bytesPerSlice * sliceIdx);
+                        const auto itEnd = itBegin + bytesPerSlice;
+                        AZStd::span<const uint8_t> spanBytes = { itBegin, itEnd };
+                        AZ::Utils::PngFile pngImage = AZ::Utils::PngFile::Create(mipSize, GetPixelFormat(), spanBytes);
+                        if (!pngImage)
+                        {
+                            AZ_Error(LogName, false, "Failed to create png image for slice number=%u\n", sliceIdx);
+                            failed = true;
+                            return;
+                        }
+                        if (!pngImage.Save(outputFiles[sliceIdx].c_str(), saveSettings))
+                        {
+                            AZ_Error(LogName, false, "Failed to save png image=%s\n", outputFiles[sliceIdx].c_str());
+                            failed = true;
+                            return;
+                        }
+                        if (status)
+                        {
+                            status->AddWrittenBytes(bytesPerSlice);
+                        }
+                    }
+                });
+
+            if (failed)
             {
-                AZ_Error(LogName, false, "Failed to save png image=%s\n", outputFilePath.c_str());
                 return false;
             }
+        }
+        return true;
+    }
+
+    bool PngCloudTextureWriter::SaveFlipbookAtlas(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>& outputFiles, CloudTextureWriteStatus* status)
+    {
+        if (status && status->IsCancelRequested())
+        {
+            return false;
+        }
+
+        const auto& mipLevelData = GetMipLevelDataList()[mipLevel];
+        const uint8_t* const mipDataBuffer = mipLevelData.m_dataBuffer->data();
+
+        const auto mipSize = mipLevelData.m_mipSize;
+        const uint32_t numSlices = mipSize.m_depth;
+        const size_t bytesPerRow = static_cast<size_t>(mipSize.m_width) * AZ::RHI::GetFormatSize(GetPixelFormat());
+        const size_t bytesPerSlice = bytesPerRow * mipSize.m_height;
 
-            if (savedFiles)
+        uint32_t columns = 0;
+        uint32_t rows = 0;
+        CalculateAtlasGrid(numSlices, columns, rows);
+        const AZ::RHI::Size atlasSize(mipSize.m_width * columns, mipSize.m_height * rows, 1);
+        const size_t atlasBytesPerRow = bytesPerRow * columns;
+
+        // Cells past the last slice stay black.
+        AZStd::vector<uint8_t> atlasBuffer(atlasBytesPerRow * atlasSize.m_height, uint8_t(0));
+        CloudTextureCpuBaker::ForEachSlab(AZ::JobContext::GetGlobalContext(), numSlices, [&](uint32_t firstSlice, uint32_t sliceCount)
             {
-                savedFiles->push_back(outputFilePath);
-            }
-            m_savedFiles.push_back(outputFilePath);
+                for (uint32_t sliceIdx = firstSlice; sliceIdx < firstSlice + sliceCount; ++sliceIdx)
+                {
+                    const uint8_t* srcSlice = mipDataBuffer + (bytesPerSlice * sliceIdx);
+                    uint8_t* dstCell = atlasBuffer.data() + (atlasBytesPerRow * mipSize.m_height * (sliceIdx / columns))
+                        + (bytesPerRow * (sliceIdx % columns));
+                    for (uint32_t row = 0; row < mipSize.m_height; ++row)
+                    {
+                        memcpy(dstCell + (atlasBytesPerRow * row), srcSlice + (bytesPerRow * row), bytesPerRow);
+                    }
+                }
+            });
+
+        AZ::IO::Path outputFilePath = GetOuputDir();
+        outputFilePath.Append(AZStd::string::format("%s_%u_atlas_%ux%u.png", GetStemPrefix().c_str(), mipLevel, columns, rows));
+
+        AZ::Utils::PngFile pngImage = AZ::Utils::PngFile::Create(atlasSize, GetPixelFormat(), AZStd::move(atlasBuffer));
+        if (!pngImage)
+        {
+            AZ_Error(LogName, false, "Failed to create the png atlas for mip level=%hu\n", mipLevel);
+            return false;
         }
-        SetMipLevelSaved(mipLevel);
+        if (!pngImage.Save(outputFilePath.c_str(), GetPngSaveSettings()))
+        {
+            AZ_Error(LogName, false, "Failed to save png image=%s\n", outputFilePath.c_str());
+            return false;
+        }
+        if (status)
+        {
+            status->AddWrittenBytes(bytesPerSlice * numSlices);
+        }
+
+        outputFiles.push_back(outputFilePath);
         return true;
     }
-    //////////////////////////////////////////////////////////////
 
-} // namespace VolumetricClouds
\ No newline at end of file
+} // namespace VolumetricClouds
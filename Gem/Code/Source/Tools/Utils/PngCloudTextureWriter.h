@@ -11,24 +11,51 @@
 
 namespace VolumetricClouds
 {
+    enum class PngCloudTextureLayout : uint32_t
+    {
+        // One PNG per mip level, per depth slice: "<stem>_<mip>_<slice>.png".
+        Slices = 0,
+        // One 2D PNG per mip level with all the depth slices laid out in a grid,
+        // left to right, top to bottom: "<stem>_<mip>_atlas_<columns>x<rows>.png".
+        FlipbookAtlas = 1,
+    };
+
     class PngCloudTextureWriter final : public ICloudTextureWriter
     {
     public:
+        // Upper limit of uncompressed slice bytes being encoded at the same time.
+        static constexpr size_t DefaultMaxInFlightBytes = 64 * 1024 * 1024;
+
         PngCloudTextureWriter() = delete;
-        PngCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix);
+        PngCloudTextureWriter(uint16_t mipLevels, AZ::RHI::Format pixelFormat, const AZ::IO::Path& outputDir, const AZStd::string& stemPrefix,
+            PngCloudTextureLayout layout = PngCloudTextureLayout::Slices, size_t maxInFlightBytes = DefaultMaxInFlightBytes);
         virtual ~PngCloudTextureWriter();
 
         static constexpr char LogName[] = "PngCloudTextureWriter";
 
+        // Number of columns and rows of the flipbook atlas for a volume with @sliceCount slices.
+        // The column count is the smallest power of two whose square is not less than @sliceCount.
+        static void CalculateAtlasGrid(uint32_t sliceCount, uint32_t& columns, uint32_t& rows);
+
         //////////////////////////////////////////////////////////////
         // ICloudTextureWriter Overrides ....
         const char* GetLogName() const override { return LogName; }
         bool SaveMipLevel(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles = nullptr) override;
+        bool SaveAllMipLevels(CloudTextureWriteStatus& status) override;
         const AZStd::vector<AZ::IO::Path>& GetListOfSavedFiles() const override { return m_savedFiles; }
         //////////////////////////////////////////////////////////////
 
 
     private:
+        // @status is optional. When valid, the progress is reported per slice and the cancellation
+        // is checked before each batch of slices.
+        bool SaveMipLevelInternal(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>* savedFiles, CloudTextureWriteStatus* status);
+        // The slices are encoded in jobs, in batches whose uncompressed size fits in m_maxInFlightBytes.
+        bool SaveSlices(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>& outputFiles, CloudTextureWriteStatus* status);
+        bool SaveFlipbookAtlas(uint16_t mipLevel, AZStd::vector<AZ::IO::Path>& outputFiles, CloudTextureWriteStatus* status);
+
+        PngCloudTextureLayout m_layout;
+        size_t m_maxInFlightBytes;
         AZStd::vector<AZ::IO::Path> m_savedFiles;
     };
-} // namespace VolumetricClouds
\ No newline at end of file
+} // namespace VolumetricClouds
@@ -0,0 +1,251 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#if defined(HAVE_BENCHMARK)
+
+#include <AzCore/std/containers/vector.h>
+
+#include <CloudTextureBenchmarkFixture.h>
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Renderer/Cpu/PerlinWorleyNoiseKernels.h>
+
+// Run with:
+//     AzTestRunner <VolumetricClouds.Tests module> AzRunBenchmarks --benchmark_out_format=json --benchmark_out=<file>.json
+// "items_per_second" is voxels per second, so results of different sizes and octave counts can be compared.
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudNoiseKernelsBenchmark : public CloudTextureBenchmarkFixture
+    {
+    protected:
+        using Vec = AZ::Simd::Vec4;
+
+        // Points per axis of the grid evaluated by each iteration of the kernel benchmarks.
+        static constexpr uint32_t GridSize = 16;
+
+        void SetUpBenchmark([[maybe_unused]] const ::benchmark::State& state) override
+        {
+            // Same normalized coordinates CloudTextureCpuBaker uses for a GridSize^3 volume.
+            const float invGridSize = 1.0f / static_cast<float>(GridSize);
+            m_coords.clear();
+            m_coords.reserve(GridSize * GridSize * GridSize * 3);
+            for (uint32_t z = 0; z < GridSize; z++)
+            {
+                for (uint32_t y = 0; y < GridSize; y++)
+                {
+                    for (uint32_t x = 0; x < GridSize; x += Vec::ElementCount)
+                    {
+                        for (uint32_t lane = 0; lane < Vec::ElementCount; lane++)
+                        {
+                            m_coords.push_back(static_cast<float>(x + lane) * invGridSize);
+                        }
+                        for (uint32_t lane = 0; lane < Vec::ElementCount; lane++)
+                        {
+                            m_coords.push_back(static_cast<float>(y) * invGridSize);
+                        }
+                        for (uint32_t lane = 0; lane < Vec::ElementCount; lane++)
+                        {
+                            m_coords.push_back(static_cast<float>(z) * invGridSize);
+                        }
+                    }
+                }
+            }
+        }
+
+        void TearDownBenchmark([[maybe_unused]] const ::benchmark::State& state) override
+        {
+            m_coords = {};
+        }
+
+        // Calls @kernel(input) for every point of the grid, every iteration.
+        // The kernel returns a Vec::FloatType, which is accumulated so the compiler can't discard the work.
+        template<PerlinWorleyNoiseVariant Variant, typename KernelFunction>
+        void RunKernel(::benchmark::State& state, const KernelFunction& kernel)
+        {
+            using Kernels = PerlinWorleyNoiseKernels<Vec, Variant>;
+            const size_t vectorCount = m_coords.size() / (Vec::ElementCount * 3);
+            for ([[maybe_unused]] auto _ : state)
+            {
+                Vec::FloatType sum = Vec::ZeroFloat();
+                const float* coords = m_coords.data();
+                for (size_t vectorIndex = 0; vectorIndex < vectorCount; vectorIndex++)
+                {
+                    typename Kernels::Float3 input;
+                    input.m_x = Vec::LoadUnaligned(coords);
+                    input.m_y = Vec::LoadUnaligned(coords + Vec::ElementCount);
+                    input.m_z = Vec::LoadUnaligned(coords + Vec::ElementCount * 2);
+                    coords += Vec::ElementCount * 3;
+                    sum = Vec::Add(sum, kernel(input));
+                }
+                ::benchmark::DoNotOptimize(sum);
+            }
+            state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * GridSize * GridSize * GridSize);
+        }
+
+        // Arguments: octaves, frequency.
+        static PerlinWorleyNoiseParameters GetNoiseParameters(const ::benchmark::State& state)
+        {
+            PerlinWorleyNoiseParameters params;
+            params.m_perlinOctaves = static_cast<int>(state.range(0));
+            params.m_worleyOctaves = static_cast<int>(state.range(0));
+            params.m_frequency = static_cast<float>(state.range(1));
+            return params;
+        }
+
+        template<PerlinWorleyNoiseVariant Variant>
+        void PerlinNoiseFbm(::benchmark::State& state)
+        {
+            using Kernels = PerlinWorleyNoiseKernels<Vec, Variant>;
+            const PerlinWorleyNoiseParameters params = GetNoiseParameters(state);
+            RunKernel<Variant>(state, [&params](const typename Kernels::Float3& input)
+            {
+                return Kernels::PerlinNoiseFbm(input, params.m_frequency, params.m_perlinOctaves, params.m_perlinGain, params.m_perlinAmplitude);
+            });
+        }
+
+        template<PerlinWorleyNoiseVariant Variant>
+        void WorleyNoiseFbm(::benchmark::State& state)
+        {
+            using Kernels = PerlinWorleyNoiseKernels<Vec, Variant>;
+            const PerlinWorleyNoiseParameters params = GetNoiseParameters(state);
+            RunKernel<Variant>(state, [&params](const typename Kernels::Float3& input)
+            {
+                return Kernels::WorleyNoiseFbm(input, params.m_frequency, params.m_worleyOctaves, params.m_worleyGain, params.m_worleyAmplitude);
+            });
+        }
+
+        // Same as WorleyNoiseFbm(), reading the feature points from the WorleyFeaturePointTables that
+        // CloudTextureCpuBaker builds for a GridSize^3 volume. Compare against WorleyNoiseFbm() for the speedup.
+        // The tables are built before the benchmark loop, like the baker does once per bake.
+        template<PerlinWorleyNoiseVariant Variant>
+        void WorleyNoiseFbmWithTables(::benchmark::State& state)
+        {
+            using Kernels = PerlinWorleyNoiseKernels<Vec, Variant>;
+            const PerlinWorleyNoiseParameters params = GetNoiseParameters(state);
+            WorleyFeaturePointTables worleyTables;
+            CloudTextureCpuBaker::BuildWorleyFeaturePointTables(params, Variant, GridSize, worleyTables, GetJobContext());
+            RunKernel<Variant>(state, [&params, &worleyTables](const typename Kernels::Float3& input)
+            {
+                return Kernels::WorleyNoiseFbm(input, params.m_frequency, params.m_worleyOctaves, params.m_worleyGain, params.m_worleyAmplitude,
+                    &worleyTables);
+            });
+            state.counters["tableBytes"] = static_cast<double>(worleyTables.GetSizeInBytes());
+        }
+
+        // The Perlin FBM remapped by the Worley FBM, which is the red channel of the cloud texture.
+        // Only the Perlin octaves change, the Worley FBM uses the default 3 octaves like the shader.
+        template<PerlinWorleyNoiseVariant Variant>
+        void PerlinWorleyNoise(::benchmark::State& state)
+        {
+            using Kernels = PerlinWorleyNoiseKernels<Vec, Variant>;
+            PerlinWorleyNoiseParameters params = GetNoiseParameters(state);
+            params.m_worleyOctaves = PerlinWorleyNoiseParameters().m_worleyOctaves;
+            RunKernel<Variant>(state, [&params](const typename Kernels::Float3& input)
+            {
+                return Kernels::PerlinWorleyNoise(input, params);
+            });
+        }
+
+    private:
+        // For each group of Vec::ElementCount points along X: the X, Y and Z coordinates of each lane.
+        AZStd::vector<float> m_coords;
+    };
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, PerlinNoiseFbm_A)(::benchmark::State& state)
+    {
+        PerlinNoiseFbm<PerlinWorleyNoiseVariant::A>(state);
+    }
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, PerlinNoiseFbm_B)(::benchmark::State& state)
+    {
+        PerlinNoiseFbm<PerlinWorleyNoiseVariant::B>(state);
+    }
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbm_A)(::benchmark::State& state)
+    {
+        WorleyNoiseFbm<PerlinWorleyNoiseVariant::A>(state);
+    }
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbm_B)(::benchmark::State& state)
+    {
+        WorleyNoiseFbm<PerlinWorleyNoiseVariant::B>(state);
+    }
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbmWithTables_A)(::benchmark::State& state)
+    {
+        WorleyNoiseFbmWithTables<PerlinWorleyNoiseVariant::A>(state);
+    }
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbmWithTables_B)(::benchmark::State& state)
+    {
+        WorleyNoiseFbmWithTables<PerlinWorleyNoiseVariant::B>(state);
+    }
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, PerlinWorleyNoise_A)(::benchmark::State& state)
+    {
+        PerlinWorleyNoise<PerlinWorleyNoiseVariant::A>(state);
+    }
+
+    BENCHMARK_DEFINE_F(CloudNoiseKernelsBenchmark, PerlinWorleyNoise_B)(::benchmark::State& state)
+    {
+        PerlinWorleyNoise<PerlinWorleyNoiseVariant::B>(state);
+    }
+
+    // Octaves cover the range of the "Perlin Octaves" and "Worley Octaves" sliders,
+    // frequencies cover the range of the "Frequency" slider.
+    static void NoiseKernelArguments(::benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({ "octaves", "frequency" });
+        benchmark->ArgsProduct({ { 1, 3, 5, 7, 10 }, { 1, 4, 10 } });
+        benchmark->Unit(::benchmark::kMicrosecond);
+    }
+
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, PerlinNoiseFbm_A)->Apply(NoiseKernelArguments);
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, PerlinNoiseFbm_B)->Apply(NoiseKernelArguments);
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbm_A)->Apply(NoiseKernelArguments);
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbm_B)->Apply(NoiseKernelArguments);
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbmWithTables_A)->Apply(NoiseKernelArguments);
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, WorleyNoiseFbmWithTables_B)->Apply(NoiseKernelArguments);
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, PerlinWorleyNoise_A)->Apply(NoiseKernelArguments);
+    BENCHMARK_REGISTER_F(CloudNoiseKernelsBenchmark, PerlinWorleyNoise_B)->Apply(NoiseKernelArguments);
+
+    // Full mip chain bakes with CloudTextureCpuBaker, with the default CloudTextureComputeData,
+    // using all the worker threads. "worleyTables" 0 is the hash per sample path, 1 shares the
+    // Worley feature points in WorleyFeaturePointTables. Both produce the same texture.
+    class CloudTextureCpuBakerBenchmark : public CloudTextureBenchmarkFixture
+    {
+    };
+
+    BENCHMARK_DEFINE_F(CloudTextureCpuBakerBenchmark, Bake)(::benchmark::State& state)
+    {
+        CloudTextureComputeData computeData;
+        computeData.m_pixelSize = static_cast<uint32_t>(state.range(0));
+        const auto variant = static_cast<PerlinWorleyNoiseVariant>(state.range(1));
+        const bool useWorleyFeaturePointTables = state.range(2) != 0;
+
+        for ([[maybe_unused]] auto _ : state)
+        {
+            AZStd::vector<CloudTextureCpuBaker::MipLevelData> mipLevels = CloudTextureCpuBaker::Bake(computeData, variant, GetJobContext(),
+                useWorleyFeaturePointTables);
+            ::benchmark::DoNotOptimize(mipLevels.data());
+        }
+
+        const int64_t voxelCount = static_cast<int64_t>(computeData.m_pixelSize) * computeData.m_pixelSize * computeData.m_pixelSize;
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * voxelCount);
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * voxelCount * CloudTextureCpuBaker::BytesPerPixel);
+    }
+
+    BENCHMARK_REGISTER_F(CloudTextureCpuBakerBenchmark, Bake)
+        ->ArgNames({ "size", "variant", "worleyTables" })
+        ->ArgsProduct({ { 32, 64, 128, 256 }, { static_cast<int64_t>(PerlinWorleyNoiseVariant::A), static_cast<int64_t>(PerlinWorleyNoiseVariant::B) }, { 0, 1 } })
+        ->Unit(::benchmark::kMillisecond)
+        ->UseRealTime();
+
+} // namespace UnitTest
+
+#endif // HAVE_BENCHMARK
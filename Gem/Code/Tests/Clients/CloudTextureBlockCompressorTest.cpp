@@ -0,0 +1,150 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/Cpu/CloudTextureBlockCompressor.h>
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudTextureBlockCompressorTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static uint32_t SquaredError(const uint8_t* a, const uint8_t* b, size_t count)
+        {
+            uint32_t error = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                const int32_t diff = static_cast<int32_t>(a[i]) - static_cast<int32_t>(b[i]);
+                error += static_cast<uint32_t>(diff * diff);
+            }
+            return error;
+        }
+    };
+
+    TEST_F(CloudTextureBlockCompressorTest, BC4_ConstantBlock_IsLossless)
+    {
+        uint8_t values[16];
+        memset(values, 77, sizeof(values));
+        uint8_t block[8];
+        uint8_t decoded[16];
+        CloudTextureBlockCompressor::CompressBlockBC4(values, block);
+        CloudTextureBlockCompressor::DecompressBlockBC4(block, decoded);
+        EXPECT_EQ(SquaredError(values, decoded, 16), 0u);
+    }
+
+    TEST_F(CloudTextureBlockCompressorTest, BC4_ExtremeValues_AreExact)
+    {
+        // Only the mode with 6 interpolated values has exact 0 and 255 besides its endpoints.
+        const uint8_t values[16] = { 0, 255, 100, 110, 0, 255, 120, 130, 0, 255, 100, 110, 0, 255, 120, 130 };
+        uint8_t block[8];
+        uint8_t decoded[16];
+        CloudTextureBlockCompressor::CompressBlockBC4(values, block);
+        CloudTextureBlockCompressor::DecompressBlockBC4(block, decoded);
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            if ((values[pixel] == 0) || (values[pixel] == 255))
+            {
+                EXPECT_EQ(decoded[pixel], values[pixel]) << "Pixel " << pixel;
+            }
+        }
+        EXPECT_LE(SquaredError(values, decoded, 16), 16u * 4u);
+    }
+
+    TEST_F(CloudTextureBlockCompressorTest, BC7_GradientBlock_IsAccurate)
+    {
+        uint8_t rgba[64];
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            for (uint32_t channel = 0; channel < 4; channel++)
+            {
+                rgba[pixel * 4 + channel] = static_cast<uint8_t>(pixel * 16 + channel * 2);
+            }
+        }
+        uint8_t block[16];
+        uint8_t decoded[64];
+        CloudTextureBlockCompressor::CompressBlockBC7(rgba, block);
+        ASSERT_TRUE(CloudTextureBlockCompressor::DecompressBlockBC7(block, decoded));
+        // Mean squared error below 4.
+        EXPECT_LT(SquaredError(rgba, decoded, 64), 64u * 4u);
+    }
+
+    TEST_F(CloudTextureBlockCompressorTest, BC7_IndependentChannel_UsesRotation)
+    {
+        // r, g and b are a gradient, a is unrelated to them, which mode 5 handles with its separate alpha line.
+        constexpr uint8_t Shuffle[16] = { 3, 9, 0, 14, 7, 1, 12, 5, 10, 2, 15, 8, 4, 11, 6, 13 };
+        uint8_t rgba[64];
+        for (uint32_t pixel = 0; pixel < 16; pixel++)
+        {
+            rgba[pixel * 4 + 0] = rgba[pixel * 4 + 1] = rgba[pixel * 4 + 2] = static_cast<uint8_t>(pixel * 4);
+            rgba[pixel * 4 + 3] = static_cast<uint8_t>(Shuffle[pixel] * 4);
+        }
+        uint8_t block[16];
+        uint8_t decoded[64];
+        CloudTextureBlockCompressor::CompressBlockBC7(rgba, block);
+        ASSERT_TRUE(CloudTextureBlockCompressor::DecompressBlockBC7(block, decoded));
+        // Mode 5 is identified by the lowest 6 bits being 0b100000.
+        EXPECT_EQ(block[0] & 0x3F, 0x20);
+        EXPECT_LT(SquaredError(rgba, decoded, 64), 64u * 32u);
+    }
+
+    TEST_F(CloudTextureBlockCompressorTest, DecompressBlockBC7_UnsupportedMode_ReturnsFalse)
+    {
+        uint8_t block[16] = {};
+        block[0] = 1; // Mode 0.
+        uint8_t decoded[64];
+        EXPECT_FALSE(CloudTextureBlockCompressor::DecompressBlockBC7(block, decoded));
+    }
+
+    TEST_F(CloudTextureBlockCompressorTest, Compress_BakedNoise_SizesAndPsnr)
+    {
+        CloudTextureComputeData computeData;
+        computeData.m_pixelSize = 32;
+        const auto mipLevels = CloudTextureCpuBaker::Bake(computeData);
+        ASSERT_FALSE(mipLevels.empty());
+
+        for (const auto compression : { CloudTextureCompression::BC4, CloudTextureCompression::BC5, CloudTextureCompression::BC7 })
+        {
+            const auto compressedMips = CloudTextureBlockCompressor::Compress(compression, 0, mipLevels);
+            ASSERT_EQ(compressedMips.size(), mipLevels.size());
+            for (size_t mipIndex = 0; mipIndex < mipLevels.size(); mipIndex++)
+            {
+                const auto& mipSize = mipLevels[mipIndex].m_mipSize;
+                // Mips smaller than 4x4 still take a whole block per slice.
+                const size_t blocksPerSlice = AZStd::max(mipSize.m_width / 4, 1u) * AZStd::max(mipSize.m_height / 4, 1u);
+                EXPECT_EQ(compressedMips[mipIndex].m_data.size(),
+                    blocksPerSlice * mipSize.m_depth * CloudTextureBlockCompressor::GetBytesPerBlock(compression));
+            }
+            // The noise is smooth at mip 0.
+            EXPECT_GT(compressedMips[0].m_psnr, 25.0) << "Compression " << static_cast<uint32_t>(compression);
+        }
+    }
+
+    TEST_F(CloudTextureBlockCompressorTest, Compress_InvalidChannel_ReturnsEmpty)
+    {
+        AZStd::vector<CloudTextureMipData> mipLevels(1);
+        mipLevels[0].m_mipSize = AZ::RHI::Size(4, 4, 4);
+        mipLevels[0].m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(4 * 4 * 4 * 4, uint8_t(0));
+
+        AZ_TEST_START_TRACE_SUPPRESSION;
+        EXPECT_TRUE(CloudTextureBlockCompressor::Compress(CloudTextureCompression::BC5, 3, mipLevels).empty());
+        AZ_TEST_STOP_TRACE_SUPPRESSION(1);
+
+        const auto compressedMips = CloudTextureBlockCompressor::Compress(CloudTextureCompression::BC4, 3, mipLevels);
+        ASSERT_EQ(compressedMips.size(), 1u);
+        EXPECT_EQ(compressedMips[0].m_psnr, AZStd::numeric_limits<double>::infinity());
+    }
+
+} // namespace UnitTest
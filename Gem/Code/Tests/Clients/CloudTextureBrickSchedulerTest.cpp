@@ -0,0 +1,145 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/CloudTextureBrickScheduler.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudTextureBrickSchedulerTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        // Schedules frames until all bricks are scheduled, reporting @brickCost microseconds
+        // per brick after each frame. Returns the number of bricks of each frame.
+        static AZStd::vector<uint32_t> ScheduleAll(CloudTextureBrickScheduler& scheduler, uint32_t frameBudget, uint64_t brickCost,
+            AZStd::vector<uint32_t>* visitCounts = nullptr)
+        {
+            AZStd::vector<uint32_t> bricksPerFrame;
+            while (!scheduler.IsFullyScheduled())
+            {
+                const auto range = scheduler.ScheduleNextFrame(frameBudget);
+                bricksPerFrame.push_back(range.m_brickCount);
+                if (visitCounts)
+                {
+                    for (uint32_t i = 0; i < range.m_brickCount; i++)
+                    {
+                        (*visitCounts)[range.m_firstBrick + i]++;
+                    }
+                }
+                scheduler.ReportFrameCost(range.m_brickCount, range.m_brickCount * brickCost);
+                if (bricksPerFrame.size() > scheduler.GetBrickCount())
+                {
+                    break; // No progress.
+                }
+            }
+            return bricksPerFrame;
+        }
+    };
+
+    TEST_F(CloudTextureBrickSchedulerTest, Constructor_BrickLargerThanVolume_SingleBrick)
+    {
+        CloudTextureBrickScheduler scheduler(16, 32);
+        EXPECT_EQ(scheduler.GetBrickSize(), 16u);
+        EXPECT_EQ(scheduler.GetBricksPerAxis(), 1u);
+        EXPECT_EQ(scheduler.GetBrickCount(), 1u);
+    }
+
+    TEST_F(CloudTextureBrickSchedulerTest, ScheduleNextFrame_EveryBrickScheduledExactlyOnce)
+    {
+        CloudTextureBrickScheduler scheduler(128, 32);
+        ASSERT_EQ(scheduler.GetBrickCount(), 64u);
+
+        AZStd::vector<uint32_t> visitCounts(scheduler.GetBrickCount(), 0);
+        ScheduleAll(scheduler, 1000, 300, &visitCounts);
+        for (uint32_t brickIndex = 0; brickIndex < visitCounts.size(); brickIndex++)
+        {
+            EXPECT_EQ(visitCounts[brickIndex], 1u) << "Brick " << brickIndex;
+        }
+
+        const auto range = scheduler.ScheduleNextFrame(1000);
+        EXPECT_EQ(range.m_brickCount, 0u);
+    }
+
+    TEST_F(CloudTextureBrickSchedulerTest, ScheduleNextFrame_StaysWithinBudget)
+    {
+        constexpr uint32_t FrameBudget = 1000;
+        constexpr uint64_t BrickCost = 300;
+        CloudTextureBrickScheduler scheduler(256, 32);
+
+        const auto bricksPerFrame = ScheduleAll(scheduler, FrameBudget, BrickCost);
+        ASSERT_FALSE(bricksPerFrame.empty());
+        // The first frame doesn't know the cost yet.
+        EXPECT_EQ(bricksPerFrame[0], 1u);
+        for (size_t frame = 1; frame < bricksPerFrame.size(); frame++)
+        {
+            EXPECT_LE(bricksPerFrame[frame] * BrickCost, FrameBudget) << "Frame " << frame;
+            EXPECT_GE(bricksPerFrame[frame], 1u);
+        }
+        EXPECT_FLOAT_EQ(scheduler.GetEstimatedBrickCostMicroseconds(), static_cast<float>(BrickCost));
+        // 512 bricks, 3 per frame, after the first frame.
+        EXPECT_EQ(bricksPerFrame.size(), 1u + (511u + 2u) / 3u);
+    }
+
+    TEST_F(CloudTextureBrickSchedulerTest, ScheduleNextFrame_BrickMoreExpensiveThanBudget_StillMakesProgress)
+    {
+        CloudTextureBrickScheduler scheduler(64, 32);
+        const auto bricksPerFrame = ScheduleAll(scheduler, 100, 5000);
+        EXPECT_TRUE(scheduler.IsFullyScheduled());
+        EXPECT_EQ(bricksPerFrame.size(), scheduler.GetBrickCount());
+    }
+
+    TEST_F(CloudTextureBrickSchedulerTest, ScheduleNextFrame_ZeroBudget_SchedulesEverythingAtOnce)
+    {
+        CloudTextureBrickScheduler scheduler(128, 16);
+        const auto range = scheduler.ScheduleNextFrame(0);
+        EXPECT_EQ(range.m_firstBrick, 0u);
+        EXPECT_EQ(range.m_brickCount, scheduler.GetBrickCount());
+        EXPECT_TRUE(scheduler.IsFullyScheduled());
+    }
+
+    TEST_F(CloudTextureBrickSchedulerTest, GetBrickOffset_CoversVolumeWithoutOverlap)
+    {
+        constexpr uint32_t PixelSize = 64;
+        CloudTextureBrickScheduler scheduler(PixelSize, 16);
+
+        AZStd::vector<uint8_t> covered(PixelSize * PixelSize * PixelSize, 0);
+        const uint32_t brickSize = scheduler.GetBrickSize();
+        for (uint32_t brickIndex = 0; brickIndex < scheduler.GetBrickCount(); brickIndex++)
+        {
+            const auto offset = scheduler.GetBrickOffset(brickIndex);
+            ASSERT_LE(offset.m_x + brickSize, PixelSize);
+            ASSERT_LE(offset.m_y + brickSize, PixelSize);
+            ASSERT_LE(offset.m_z + brickSize, PixelSize);
+            for (uint32_t z = offset.m_z; z < offset.m_z + brickSize; z++)
+            {
+                for (uint32_t y = offset.m_y; y < offset.m_y + brickSize; y++)
+                {
+                    for (uint32_t x = offset.m_x; x < offset.m_x + brickSize; x++)
+                    {
+                        covered[(z * PixelSize + y) * PixelSize + x]++;
+                    }
+                }
+            }
+        }
+
+        for (const auto count : covered)
+        {
+            ASSERT_EQ(count, 1u);
+        }
+        // X first, then Y, then Z.
+        EXPECT_EQ(scheduler.GetBrickOffset(1).m_x, brickSize);
+        EXPECT_EQ(scheduler.GetBrickOffset(scheduler.GetBricksPerAxis()).m_y, brickSize);
+        EXPECT_EQ(scheduler.GetBrickOffset(scheduler.GetBricksPerAxis() * scheduler.GetBricksPerAxis()).m_z, brickSize);
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,251 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/IO/SystemFile.h>
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/UnitTest/Utils.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+#include <AzCore/std/string/string.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/CloudTextureCache.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudTextureCacheTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        // Size of the file header, and of each mip header, of a cache entry.
+        static constexpr size_t FileHeaderByteCount = 60;
+        static constexpr size_t MipHeaderByteCount = 24;
+
+        static CloudTextureComputeData CreateComputeData(float frequency)
+        {
+            CloudTextureComputeData computeData;
+            computeData.m_pixelSize = 16;
+            computeData.m_frequency = frequency;
+            return computeData;
+        }
+
+        // The mip chain of a 16^3 RGBA8 texture, 16, 8 and 4 pixels.
+        static AZStd::vector<CloudTextureMipData> CreateMipChain(uint8_t seed)
+        {
+            AZStd::vector<CloudTextureMipData> mipLevels;
+            for (uint16_t mipIndex = 0; mipIndex < 3; mipIndex++)
+            {
+                const uint32_t mipSize = 16u >> mipIndex;
+                CloudTextureMipData& mipData = mipLevels.emplace_back();
+                mipData.m_mipSlice = mipIndex;
+                mipData.m_mipSize = AZ::RHI::Size(mipSize, mipSize, mipSize);
+                mipData.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(static_cast<size_t>(mipSize) * mipSize * mipSize * 4);
+                auto& pixels = *mipData.m_dataBuffer;
+                for (size_t byteIndex = 0; byteIndex < pixels.size(); byteIndex++)
+                {
+                    pixels[byteIndex] = static_cast<uint8_t>((byteIndex * 13) ^ seed ^ mipIndex);
+                }
+            }
+            return mipLevels;
+        }
+
+        static uint64_t CalculateEntrySize(const AZStd::vector<CloudTextureMipData>& mipLevels)
+        {
+            uint64_t sizeInBytes = FileHeaderByteCount;
+            for (const auto& mipData : mipLevels)
+            {
+                sizeInBytes += MipHeaderByteCount + mipData.m_dataBuffer->size();
+            }
+            return sizeInBytes;
+        }
+
+        static void ExpectEqualMipChains(const AZStd::vector<CloudTextureMipData>& expected, const AZStd::vector<CloudTextureMipData>& actual)
+        {
+            ASSERT_EQ(expected.size(), actual.size());
+            for (size_t mipIndex = 0; mipIndex < expected.size(); mipIndex++)
+            {
+                EXPECT_EQ(actual[mipIndex].m_mipSlice, expected[mipIndex].m_mipSlice);
+                EXPECT_EQ(actual[mipIndex].m_mipSize, expected[mipIndex].m_mipSize);
+                ASSERT_TRUE(actual[mipIndex].m_dataBuffer);
+                EXPECT_TRUE(*actual[mipIndex].m_dataBuffer == *expected[mipIndex].m_dataBuffer) << "Mip " << mipIndex;
+            }
+        }
+
+        static AZStd::vector<uint8_t> ReadFile(const AZ::IO::Path& filePath)
+        {
+            AZStd::vector<uint8_t> fileBytes;
+            AZ::IO::SystemFile file;
+            if (file.Open(filePath.c_str(), AZ::IO::SystemFile::SF_OPEN_READ_ONLY))
+            {
+                fileBytes.resize(file.Length());
+                file.Read(fileBytes.size(), fileBytes.data());
+            }
+            return fileBytes;
+        }
+
+        static void WriteFile(const AZ::IO::Path& filePath, const AZStd::vector<uint8_t>& fileBytes)
+        {
+            AZ::IO::SystemFile file;
+            const int openMode = AZ::IO::SystemFile::SF_OPEN_CREATE | AZ::IO::SystemFile::SF_OPEN_WRITE_ONLY;
+            ASSERT_TRUE(file.Open(filePath.c_str(), openMode));
+            file.Write(fileBytes.data(), fileBytes.size());
+        }
+
+        static AZ::IO::Path GetEntryFilePath(const CloudTextureCache& cache, const CloudTextureComputeData& computeData)
+        {
+            return cache.GetCacheFolder() / AZStd::string::format("%016llx%s",
+                static_cast<unsigned long long>(CloudTextureCache::CalculateKey(computeData)), CloudTextureCache::FileExtension);
+        }
+
+        AZ::Test::ScopedAutoTempDirectory m_tempDirectory;
+    };
+
+    TEST_F(CloudTextureCacheTest, CalculateKey_DependsOnEveryNoiseParameter)
+    {
+        const CloudTextureComputeData computeData;
+        const uint64_t key = CloudTextureCache::CalculateKey(computeData);
+        EXPECT_EQ(CloudTextureCache::CalculateKey(CloudTextureComputeData()), key);
+
+        AZStd::vector<CloudTextureComputeData> variations(10, computeData);
+        variations[0].m_pixelSize = 64;
+        variations[1].m_frequency += 1.0f;
+        variations[2].m_perlinOctaves++;
+        variations[3].m_perlinGain *= 0.5f;
+        variations[4].m_perlinAmplitude *= 0.5f;
+        variations[5].m_worleyOctaves++;
+        variations[6].m_worleyGain *= 0.5f;
+        variations[7].m_worleyAmplitude *= 0.5f;
+        variations[8].m_mipFilter = static_cast<uint32_t>(CloudTextureMipFilter::Box);
+        variations[9].m_channelLayout = static_cast<uint32_t>(CloudTextureChannelLayout::R8);
+        AZStd::vector<uint64_t> keys = { key };
+        for (const auto& variation : variations)
+        {
+            const uint64_t variationKey = CloudTextureCache::CalculateKey(variation);
+            EXPECT_EQ(AZStd::find(keys.begin(), keys.end(), variationKey), keys.end());
+            keys.push_back(variationKey);
+        }
+
+        // The entries have the texture as generated, the renormalization is done after loading it.
+        CloudTextureComputeData normalized = computeData;
+        normalized.m_normalizeChannelRange = true;
+        EXPECT_EQ(CloudTextureCache::CalculateKey(normalized), key);
+    }
+
+    TEST_F(CloudTextureCacheTest, StoreAndLoad_RoundTrip)
+    {
+        CloudTextureCache cache(AZ::IO::Path(m_tempDirectory.GetDirectory()), AZStd::numeric_limits<uint64_t>::max());
+        const auto computeData = CreateComputeData(3.0f);
+        const auto mipLevels = CreateMipChain(7);
+
+        AZStd::vector<CloudTextureMipData> loadedMipLevels;
+        EXPECT_FALSE(cache.Load(computeData, loadedMipLevels));
+        ASSERT_TRUE(cache.Store(computeData, mipLevels));
+        const auto storedFileBytes = ReadFile(GetEntryFilePath(cache, computeData));
+        ASSERT_TRUE(cache.Load(computeData, loadedMipLevels));
+        ExpectEqualMipChains(mipLevels, loadedMipLevels);
+        // A hit only touches the file, its content is the same.
+        EXPECT_TRUE(ReadFile(GetEntryFilePath(cache, computeData)) == storedFileBytes);
+        EXPECT_FALSE(cache.Load(CreateComputeData(4.0f), loadedMipLevels));
+
+        auto stats = cache.GetStats();
+        EXPECT_EQ(stats.m_hits, 1u);
+        EXPECT_EQ(stats.m_misses, 2u);
+        EXPECT_EQ(stats.m_stores, 1u);
+        EXPECT_EQ(stats.m_entryCount, 1u);
+        EXPECT_EQ(stats.m_sizeInBytes, CalculateEntrySize(mipLevels));
+
+        // A new cache on the same folder finds the entry.
+        CloudTextureCache reopenedCache(AZ::IO::Path(m_tempDirectory.GetDirectory()), AZStd::numeric_limits<uint64_t>::max());
+        EXPECT_EQ(reopenedCache.GetStats().m_entryCount, 1u);
+        ASSERT_TRUE(reopenedCache.Load(computeData, loadedMipLevels));
+        ExpectEqualMipChains(mipLevels, loadedMipLevels);
+    }
+
+    TEST_F(CloudTextureCacheTest, Store_OverTheLimit_EvictsTheLeastRecentlyUsedEntry)
+    {
+        const auto mipLevels = CreateMipChain(1);
+        const uint64_t entrySize = CalculateEntrySize(mipLevels);
+        CloudTextureCache cache(AZ::IO::Path(m_tempDirectory.GetDirectory()), entrySize * 2);
+        const auto computeData0 = CreateComputeData(1.0f);
+        const auto computeData1 = CreateComputeData(2.0f);
+        const auto computeData2 = CreateComputeData(3.0f);
+
+        ASSERT_TRUE(cache.Store(computeData0, mipLevels));
+        ASSERT_TRUE(cache.Store(computeData1, mipLevels));
+        // Entry 0 becomes the most recently used, so entry 1 is evicted.
+        AZStd::vector<CloudTextureMipData> loadedMipLevels;
+        ASSERT_TRUE(cache.Load(computeData0, loadedMipLevels));
+        ASSERT_TRUE(cache.Store(computeData2, mipLevels));
+
+        auto stats = cache.GetStats();
+        EXPECT_EQ(stats.m_evictions, 1u);
+        EXPECT_EQ(stats.m_entryCount, 2u);
+        EXPECT_EQ(stats.m_sizeInBytes, entrySize * 2);
+        EXPECT_FALSE(AZ::IO::SystemFile::Exists(GetEntryFilePath(cache, computeData1).c_str()));
+        EXPECT_TRUE(cache.Load(computeData0, loadedMipLevels));
+        EXPECT_FALSE(cache.Load(computeData1, loadedMipLevels));
+        EXPECT_TRUE(cache.Load(computeData2, loadedMipLevels));
+
+        // Lowering the limit evicts right away, least recently used first.
+        cache.SetMaxSizeInBytes(entrySize);
+        EXPECT_FALSE(cache.Load(computeData0, loadedMipLevels));
+        EXPECT_TRUE(cache.Load(computeData2, loadedMipLevels));
+        EXPECT_EQ(cache.GetStats().m_evictions, 2u);
+    }
+
+    TEST_F(CloudTextureCacheTest, Load_CorruptMipHeaders_DiscardsTheEntry)
+    {
+        const auto computeData = CreateComputeData(5.0f);
+        const auto mipLevels = CreateMipChain(3);
+        AZStd::vector<uint8_t> fileBytes;
+        AZ::IO::Path filePath;
+        {
+            CloudTextureCache cache(AZ::IO::Path(m_tempDirectory.GetDirectory()), AZStd::numeric_limits<uint64_t>::max());
+            ASSERT_TRUE(cache.Store(computeData, mipLevels));
+            filePath = GetEntryFilePath(cache, computeData);
+            fileBytes = ReadFile(filePath);
+            ASSERT_EQ(fileBytes.size(), CalculateEntrySize(mipLevels));
+        }
+
+        // The byte count of mip 0, the last field of its header.
+        const size_t byteCountOffset = FileHeaderByteCount + MipHeaderByteCount - sizeof(uint64_t);
+        auto setMip0ByteCount = [&](uint64_t byteCount)
+        {
+            AZStd::vector<uint8_t> corruptFileBytes = fileBytes;
+            memcpy(corruptFileBytes.data() + byteCountOffset, &byteCount, sizeof(byteCount));
+            return corruptFileBytes;
+        };
+
+        AZStd::vector<AZStd::vector<uint8_t>> corruptFiles;
+        // Huge, it must not be allocated.
+        corruptFiles.push_back(setMip0ByteCount(AZStd::numeric_limits<uint64_t>::max() / 2));
+        // Within the file, but not the size of the mip.
+        corruptFiles.push_back(setMip0ByteCount(mipLevels[0].m_dataBuffer->size() - 4));
+        // Truncated pixel data.
+        corruptFiles.push_back(AZStd::vector<uint8_t>(fileBytes.begin(), fileBytes.end() - 16));
+        // A mip count that doesn't match the pixel size.
+        corruptFiles.push_back(fileBytes);
+        corruptFiles.back()[FileHeaderByteCount - 8] = 200;
+
+        for (size_t fileIndex = 0; fileIndex < corruptFiles.size(); fileIndex++)
+        {
+            WriteFile(filePath, corruptFiles[fileIndex]);
+            CloudTextureCache cache(AZ::IO::Path(m_tempDirectory.GetDirectory()), AZStd::numeric_limits<uint64_t>::max());
+            AZStd::vector<CloudTextureMipData> loadedMipLevels;
+            EXPECT_FALSE(cache.Load(computeData, loadedMipLevels)) << "File " << fileIndex;
+            EXPECT_TRUE(loadedMipLevels.empty()) << "File " << fileIndex;
+            EXPECT_FALSE(AZ::IO::SystemFile::Exists(filePath.c_str())) << "File " << fileIndex;
+            EXPECT_EQ(cache.GetStats().m_entryCount, 0u) << "File " << fileIndex;
+            EXPECT_EQ(cache.GetStats().m_misses, 1u) << "File " << fileIndex;
+        }
+    }
+
+} // namespace UnitTest
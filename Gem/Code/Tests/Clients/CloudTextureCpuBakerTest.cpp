@@ -0,0 +1,148 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <cstring>
+
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Renderer/Cpu/CloudTextureStatistics.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudTextureCpuBakerTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static AZStd::vector<CloudTextureMipData> Bake(CloudTextureChannelLayout channelLayout)
+        {
+            CloudTextureComputeData computeData;
+            computeData.m_pixelSize = 16;
+            computeData.m_perlinOctaves = 3;
+            computeData.m_channelLayout = static_cast<uint32_t>(channelLayout);
+            return CloudTextureCpuBaker::Bake(computeData);
+        }
+
+        static float ToFloat(uint8_t value)
+        {
+            return static_cast<float>(value) / 255.0f;
+        }
+    };
+
+    TEST_F(CloudTextureCpuBakerTest, PackCloudChannels_RemapsTheBaseShapeByTheWorleyFbm)
+    {
+        // Worley FBM = 0.625 * 0.8 + 0.25 * 0.4 + 0.125 * 0.2 = 0.625.
+        const float cloudChannels[4] = { 0.5f, 0.8f, 0.4f, 0.2f };
+        float packedChannels[2];
+        CloudTextureCpuBaker::PackCloudChannels(cloudChannels, packedChannels);
+        EXPECT_NEAR(packedChannels[1], 0.625f, 1e-6f);
+        // Remap(0.5, 0.625 - 1.0, 1.0, 0.0, 1.0) = 0.875 / 1.375.
+        EXPECT_NEAR(packedChannels[0], 0.875f / 1.375f, 1e-6f);
+
+        // The base shape is saturated.
+        const float fullCoverage[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+        CloudTextureCpuBaker::PackCloudChannels(fullCoverage, packedChannels);
+        EXPECT_FLOAT_EQ(packedChannels[0], 1.0f);
+        EXPECT_FLOAT_EQ(packedChannels[1], 0.0f);
+    }
+
+    TEST_F(CloudTextureCpuBakerTest, CloudTextureFormat_MapsEachLayoutToOneFormat)
+    {
+        for (const auto channelLayout : { CloudTextureChannelLayout::RGBA8, CloudTextureChannelLayout::RG8,
+                                          CloudTextureChannelLayout::R8, CloudTextureChannelLayout::R16F })
+        {
+            CloudTextureChannelLayout mappedLayout = CloudTextureChannelLayout::RGBA8;
+            EXPECT_TRUE(CloudTextureFormat::GetChannelLayout(CloudTextureFormat::GetImageFormat(channelLayout), mappedLayout));
+            EXPECT_EQ(mappedLayout, channelLayout);
+        }
+        CloudTextureChannelLayout mappedLayout = CloudTextureChannelLayout::RGBA8;
+        EXPECT_FALSE(CloudTextureFormat::GetChannelLayout(AZ::RHI::Format::BC4_UNORM, mappedLayout));
+
+        // Only the layouts with the Worley FBM can be the high frequency noise.
+        EXPECT_TRUE(CloudTextureFormat::HasDetailNoise(CloudTextureChannelLayout::RGBA8));
+        EXPECT_TRUE(CloudTextureFormat::HasDetailNoise(CloudTextureChannelLayout::RG8));
+        EXPECT_FALSE(CloudTextureFormat::HasDetailNoise(CloudTextureChannelLayout::R8));
+        EXPECT_FALSE(CloudTextureFormat::HasDetailNoise(CloudTextureChannelLayout::R16F));
+    }
+
+    TEST_F(CloudTextureCpuBakerTest, Bake_EachChannelLayout_UsesTheImageFormat)
+    {
+        for (const auto channelLayout : { CloudTextureChannelLayout::RGBA8, CloudTextureChannelLayout::RG8,
+                                          CloudTextureChannelLayout::R8, CloudTextureChannelLayout::R16F })
+        {
+            const uint32_t bytesPerPixel = AZ::RHI::GetFormatSize(CloudTextureFormat::GetImageFormat(channelLayout));
+            const auto mipLevels = Bake(channelLayout);
+            ASSERT_EQ(mipLevels.size(), CloudTextureFormat::CalculateMipCount(16));
+            for (const auto& mipLevelData : mipLevels)
+            {
+                const size_t mipSize = mipLevelData.m_mipSize.m_width;
+                EXPECT_EQ(mipLevelData.m_dataBuffer->size(), mipSize * mipSize * mipSize * bytesPerPixel)
+                    << "Layout " << static_cast<uint32_t>(channelLayout) << ", mip " << mipLevelData.m_mipSlice;
+            }
+        }
+    }
+
+    TEST_F(CloudTextureCpuBakerTest, Bake_RG8_PacksTheRGBA8Channels)
+    {
+        const auto rgba8MipLevels = Bake(CloudTextureChannelLayout::RGBA8);
+        const auto rg8MipLevels = Bake(CloudTextureChannelLayout::RG8);
+        ASSERT_EQ(rg8MipLevels.size(), rgba8MipLevels.size());
+
+        // The RG8 texture is packed from the unquantized, and unclamped, noise. So it only matches
+        // the packed RGBA8 bytes within a couple of units, where none of the RGBA8 channels saturated.
+        const auto& rgba8 = *rgba8MipLevels[0].m_dataBuffer;
+        const auto& rg8 = *rg8MipLevels[0].m_dataBuffer;
+        const size_t pixelCount = rg8.size() / 2;
+        size_t comparedPixelCount = 0;
+        for (size_t pixelIndex = 0; pixelIndex < pixelCount; pixelIndex++)
+        {
+            const uint8_t* src = rgba8.data() + (pixelIndex * 4);
+            if (AZStd::any_of(src, src + 4, [](uint8_t value) { return (value == 0) || (value == 255); }))
+            {
+                continue;
+            }
+            comparedPixelCount++;
+            const float cloudChannels[4] = { ToFloat(src[0]), ToFloat(src[1]), ToFloat(src[2]), ToFloat(src[3]) };
+            float packedChannels[2];
+            CloudTextureCpuBaker::PackCloudChannels(cloudChannels, packedChannels);
+            ASSERT_NEAR(ToFloat(rg8[pixelIndex * 2 + 0]), packedChannels[0], 3.0f / 255.0f) << "Pixel " << pixelIndex;
+            ASSERT_NEAR(ToFloat(rg8[pixelIndex * 2 + 1]), packedChannels[1], 2.0f / 255.0f) << "Pixel " << pixelIndex;
+        }
+        EXPECT_GT(comparedPixelCount, 0u);
+    }
+
+    TEST_F(CloudTextureCpuBakerTest, Bake_SingleChannelLayouts_KeepTheBaseShapeOfRG8)
+    {
+        const auto rg8MipLevels = Bake(CloudTextureChannelLayout::RG8);
+        const auto r8MipLevels = Bake(CloudTextureChannelLayout::R8);
+        const auto r16fMipLevels = Bake(CloudTextureChannelLayout::R16F);
+        ASSERT_EQ(r8MipLevels.size(), rg8MipLevels.size());
+        ASSERT_EQ(r16fMipLevels.size(), rg8MipLevels.size());
+
+        // All the mips are reduced from the same packed channels.
+        for (size_t mipIndex = 0; mipIndex < rg8MipLevels.size(); mipIndex++)
+        {
+            const auto& rg8 = *rg8MipLevels[mipIndex].m_dataBuffer;
+            const auto& r8 = *r8MipLevels[mipIndex].m_dataBuffer;
+            const auto& r16f = *r16fMipLevels[mipIndex].m_dataBuffer;
+            for (size_t pixelIndex = 0; pixelIndex < r8.size(); pixelIndex++)
+            {
+                ASSERT_EQ(r8[pixelIndex], rg8[pixelIndex * 2]) << "Mip " << mipIndex << ", pixel " << pixelIndex;
+                uint16_t halfValue;
+                memcpy(&halfValue, r16f.data() + (pixelIndex * sizeof(uint16_t)), sizeof(uint16_t));
+                ASSERT_NEAR(CloudTextureStatistics::HalfToFloat(halfValue), ToFloat(r8[pixelIndex]), 1e-3f)
+                    << "Mip " << mipIndex << ", pixel " << pixelIndex;
+            }
+        }
+    }
+
+} // namespace UnitTest
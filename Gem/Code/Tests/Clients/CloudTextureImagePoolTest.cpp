@@ -0,0 +1,195 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/limits.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/CloudTextureImagePool.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    // Stands for an attachment image, without creating GPU resources.
+    struct FakeCloudTextureImage
+    {
+        CloudTextureImagePoolKey m_key;
+        uint32_t m_id = 0;
+    };
+
+    struct FakeCloudTextureImageTraits
+    {
+        using Image = AZStd::shared_ptr<FakeCloudTextureImage>;
+
+        static Image CreateImage(const CloudTextureImagePoolKey& key)
+        {
+            auto image = AZStd::make_shared<FakeCloudTextureImage>();
+            image->m_key = key;
+            image->m_id = ++s_createdImageCount;
+            return image;
+        }
+
+        static CloudTextureImagePoolKey GetKey(const Image& image)
+        {
+            return image->m_key;
+        }
+
+        static uint32_t GetUseCount(const Image& image)
+        {
+            return static_cast<uint32_t>(image.use_count());
+        }
+
+        static inline uint32_t s_createdImageCount = 0;
+    };
+
+    using FakeImagePool = CloudTextureImagePoolBase<FakeCloudTextureImageTraits>;
+
+    class CloudTextureImagePoolTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static constexpr uint32_t ReleaseDelayFrames = 3;
+
+        void SetUp() override
+        {
+            LeakDetectionFixture::SetUp();
+            FakeCloudTextureImageTraits::s_createdImageCount = 0;
+        }
+
+        static CloudTextureImagePoolKey MakeKey(uint32_t pixelSize, AZ::RHI::Format format = AZ::RHI::Format::R8G8B8A8_UNORM)
+        {
+            CloudTextureImagePoolKey key;
+            key.m_pixelSize = pixelSize;
+            key.m_mipCount = 1;
+            key.m_format = format;
+            return key;
+        }
+
+        // Releases @image at @frame, and updates the pool until the release delay is over.
+        static uint64_t ReleaseAndWait(FakeImagePool& pool, FakeImagePool::Image image, uint64_t frame)
+        {
+            pool.Release(AZStd::move(image), frame);
+            frame += ReleaseDelayFrames;
+            pool.Update(frame);
+            return frame;
+        }
+    };
+
+    TEST_F(CloudTextureImagePoolTest, Key_MatchesSizeMipsAndFormat)
+    {
+        const auto key = MakeKey(64);
+        EXPECT_TRUE(key == MakeKey(64));
+        EXPECT_FALSE(key == MakeKey(32));
+        EXPECT_FALSE(key == MakeKey(64, AZ::RHI::Format::R8_UNORM));
+        auto withMips = MakeKey(64);
+        withMips.m_mipCount = 7;
+        EXPECT_FALSE(key == withMips);
+
+        EXPECT_EQ(MakeKey(64).CalculateSizeInBytes(), 64ull * 64 * 64 * 4);
+        EXPECT_EQ(MakeKey(64, AZ::RHI::Format::R8_UNORM).CalculateSizeInBytes(), 64ull * 64 * 64);
+        // 4^3 + 2^3 + 1, the smallest mips are clamped to 1 pixel.
+        auto mipChain = MakeKey(4, AZ::RHI::Format::R8_UNORM);
+        mipChain.m_mipCount = 4;
+        EXPECT_EQ(mipChain.CalculateSizeInBytes(), 64ull + 8 + 1 + 1);
+    }
+
+    TEST_F(CloudTextureImagePoolTest, Acquire_OnlyReusesTheSameKey)
+    {
+        FakeImagePool pool(AZStd::numeric_limits<uint64_t>::max(), ReleaseDelayFrames);
+        auto image = pool.Acquire(MakeKey(64));
+        const uint32_t imageId = image->m_id;
+        ReleaseAndWait(pool, AZStd::move(image), 0);
+
+        auto otherKeyImage = pool.Acquire(MakeKey(32));
+        EXPECT_NE(otherKeyImage->m_id, imageId);
+        auto sameKeyImage = pool.Acquire(MakeKey(64));
+        EXPECT_EQ(sameKeyImage->m_id, imageId);
+
+        const auto stats = pool.GetStats();
+        EXPECT_EQ(stats.m_allocations, 2u);
+        EXPECT_EQ(stats.m_reuses, 1u);
+        EXPECT_EQ(stats.m_availableImageCount, 0u);
+        EXPECT_EQ(stats.m_availableSizeInBytes, 0u);
+    }
+
+    TEST_F(CloudTextureImagePoolTest, Update_WaitsForTheReleaseDelay)
+    {
+        FakeImagePool pool(AZStd::numeric_limits<uint64_t>::max(), ReleaseDelayFrames);
+        auto image = pool.Acquire(MakeKey(64));
+        const uint32_t imageId = image->m_id;
+        pool.Release(AZStd::move(image), 10);
+
+        pool.Update(10 + ReleaseDelayFrames - 1);
+        EXPECT_EQ(pool.GetStats().m_pendingImageCount, 1u);
+        EXPECT_NE(pool.Acquire(MakeKey(64))->m_id, imageId);
+
+        pool.Update(10 + ReleaseDelayFrames);
+        EXPECT_EQ(pool.GetStats().m_pendingImageCount, 0u);
+        EXPECT_EQ(pool.GetStats().m_availableImageCount, 1u);
+        EXPECT_EQ(pool.Acquire(MakeKey(64))->m_id, imageId);
+    }
+
+    TEST_F(CloudTextureImagePoolTest, Update_KeepsImagesThatAreStillReferenced)
+    {
+        FakeImagePool pool(AZStd::numeric_limits<uint64_t>::max(), ReleaseDelayFrames);
+        auto image = pool.Acquire(MakeKey(64));
+        // E.g. the Cloudscape still samples the texture.
+        auto reader = image;
+        const uint32_t imageId = image->m_id;
+        // Released after the referenced one, it must not wait for it.
+        auto otherImage = pool.Acquire(MakeKey(32));
+        const uint32_t otherImageId = otherImage->m_id;
+
+        pool.Release(AZStd::move(image), 0);
+        pool.Release(AZStd::move(otherImage), 1);
+        uint64_t frame = 1 + ReleaseDelayFrames * 4;
+        pool.Update(frame);
+        EXPECT_EQ(pool.GetStats().m_pendingImageCount, 1u);
+        EXPECT_EQ(pool.GetStats().m_availableImageCount, 1u);
+        EXPECT_NE(pool.Acquire(MakeKey(64))->m_id, imageId);
+        EXPECT_EQ(pool.Acquire(MakeKey(32))->m_id, otherImageId);
+
+        reader = nullptr;
+        pool.Update(++frame);
+        EXPECT_EQ(pool.GetStats().m_pendingImageCount, 0u);
+        EXPECT_EQ(pool.Acquire(MakeKey(64))->m_id, imageId);
+    }
+
+    TEST_F(CloudTextureImagePoolTest, Update_EvictsTheLeastRecentlyReleasedImages)
+    {
+        const uint64_t imageSize = MakeKey(16).CalculateSizeInBytes();
+        FakeImagePool pool(imageSize * 2, ReleaseDelayFrames);
+        auto image0 = pool.Acquire(MakeKey(16));
+        auto image1 = pool.Acquire(MakeKey(16));
+        auto image2 = pool.Acquire(MakeKey(16));
+        const uint32_t image1Id = image1->m_id;
+        const uint32_t image2Id = image2->m_id;
+
+        uint64_t frame = ReleaseAndWait(pool, AZStd::move(image0), 0);
+        frame = ReleaseAndWait(pool, AZStd::move(image1), frame);
+        frame = ReleaseAndWait(pool, AZStd::move(image2), frame);
+
+        auto stats = pool.GetStats();
+        EXPECT_EQ(stats.m_evictions, 1u);
+        EXPECT_EQ(stats.m_availableImageCount, 2u);
+        EXPECT_EQ(stats.m_availableSizeInBytes, imageSize * 2);
+
+        // The most recently released image is reused first.
+        EXPECT_EQ(pool.Acquire(MakeKey(16))->m_id, image2Id);
+
+        // Lowering the limit evicts right away.
+        pool.SetMaxSizeInBytes(0);
+        stats = pool.GetStats();
+        EXPECT_EQ(stats.m_evictions, 2u);
+        EXPECT_EQ(stats.m_availableImageCount, 0u);
+        EXPECT_EQ(stats.m_availableSizeInBytes, 0u);
+        EXPECT_NE(pool.Acquire(MakeKey(16))->m_id, image1Id);
+    }
+
+} // namespace UnitTest
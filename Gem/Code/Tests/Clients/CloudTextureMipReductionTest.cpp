@@ -0,0 +1,185 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <cmath>
+
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Renderer/Cpu/CloudTextureMipReduction.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    // Straightforward, non optimized, reference of a 3D downsample by a factor of 2
+    // with a separable kernel of 2 (Box) or 4 (Kaiser) taps per axis and wrap addressing.
+    class ReferenceDownsampler
+    {
+    public:
+        explicit ReferenceDownsampler(CloudTextureMipFilter filter)
+        {
+            if (filter == CloudTextureMipFilter::Box)
+            {
+                m_firstTapOffset = 0;
+                m_weights = { 0.5, 0.5 };
+                return;
+            }
+
+            // Kaiser windowed sinc, alpha = 4, radius = 2 source texels.
+            // Taps are 0.5 and 1.5 source texels away from the destination texel center.
+            m_firstTapOffset = -1;
+            const double w0 = KaiserSinc(0.5);
+            const double w1 = KaiserSinc(1.5);
+            const double sum = 2.0 * (w0 + w1);
+            m_weights = { w1 / sum, w0 / sum, w0 / sum, w1 / sum };
+        }
+
+        AZStd::vector<uint8_t> Downsample(const AZStd::vector<uint8_t>& src, int srcSize) const
+        {
+            const int dstSize = srcSize / 2;
+            const int tapCount = static_cast<int>(m_weights.size());
+            AZStd::vector<uint8_t> dst(static_cast<size_t>(dstSize) * dstSize * dstSize * 4);
+            for (int z = 0; z < dstSize; z++)
+            {
+                for (int y = 0; y < dstSize; y++)
+                {
+                    for (int x = 0; x < dstSize; x++)
+                    {
+                        for (int channel = 0; channel < 4; channel++)
+                        {
+                            double sum = 0.0;
+                            for (int tz = 0; tz < tapCount; tz++)
+                            {
+                                for (int ty = 0; ty < tapCount; ty++)
+                                {
+                                    for (int tx = 0; tx < tapCount; tx++)
+                                    {
+                                        const int sx = Wrap(2 * x + m_firstTapOffset + tx, srcSize);
+                                        const int sy = Wrap(2 * y + m_firstTapOffset + ty, srcSize);
+                                        const int sz = Wrap(2 * z + m_firstTapOffset + tz, srcSize);
+                                        const double weight = m_weights[tx] * m_weights[ty] * m_weights[tz];
+                                        sum += weight * src[((static_cast<size_t>(sz) * srcSize + sy) * srcSize + sx) * 4 + channel];
+                                    }
+                                }
+                            }
+                            const double clamped = AZStd::clamp(sum, 0.0, 255.0);
+                            dst[((static_cast<size_t>(z) * dstSize + y) * dstSize + x) * 4 + channel] = static_cast<uint8_t>(clamped + 0.5);
+                        }
+                    }
+                }
+            }
+            return dst;
+        }
+
+    private:
+        static int Wrap(int coord, int size)
+        {
+            return ((coord % size) + size) % size;
+        }
+
+        static double BesselI0(double x)
+        {
+            double sum = 1.0;
+            double term = 1.0;
+            for (int k = 1; k < 32; k++)
+            {
+                term *= (x * x * 0.25) / (k * k);
+                sum += term;
+            }
+            return sum;
+        }
+
+        static double KaiserSinc(double distance)
+        {
+            constexpr double Pi = 3.14159265358979323846;
+            constexpr double Alpha = 4.0;
+            constexpr double Radius = 2.0;
+            const double x = distance * 0.5;
+            const double sinc = std::sin(Pi * x) / (Pi * x);
+            const double ratio = distance / Radius;
+            return sinc * BesselI0(Alpha * std::sqrt(1.0 - ratio * ratio)) / BesselI0(Alpha);
+        }
+
+        int m_firstTapOffset = 0;
+        AZStd::vector<double> m_weights;
+    };
+
+    class CloudTextureMipReductionTest
+        : public LeakDetectionFixture
+        , public ::testing::WithParamInterface<CloudTextureMipFilter>
+    {
+    };
+
+    TEST_P(CloudTextureMipReductionTest, BakedMips_MatchReferenceDownsample_WithinTolerance)
+    {
+        // Mips are quantized to 8 bits per channel at each level, so we allow
+        // one unit of difference due to float rounding.
+        constexpr int Tolerance = 1;
+
+        CloudTextureComputeData computeData;
+        computeData.m_pixelSize = 32;
+        computeData.m_perlinOctaves = 3;
+        computeData.m_mipFilter = static_cast<uint32_t>(GetParam());
+
+        const auto mipLevels = CloudTextureCpuBaker::Bake(computeData);
+        ASSERT_EQ(mipLevels.size(), 4u); // 32, 16, 8, 4
+
+        const ReferenceDownsampler reference(GetParam());
+        for (size_t mipIndex = 1; mipIndex < mipLevels.size(); mipIndex++)
+        {
+            const auto& srcMip = mipLevels[mipIndex - 1];
+            const auto& dstMip = mipLevels[mipIndex];
+            const int srcSize = static_cast<int>(srcMip.m_mipSize.m_width);
+            EXPECT_EQ(dstMip.m_mipSize.m_width, srcMip.m_mipSize.m_width / 2);
+            EXPECT_EQ(dstMip.m_mipSlice, mipIndex);
+
+            const AZStd::vector<uint8_t> expected = reference.Downsample(*srcMip.m_dataBuffer, srcSize);
+            const AZStd::vector<uint8_t>& actual = *dstMip.m_dataBuffer;
+            ASSERT_EQ(actual.size(), expected.size());
+
+            int maxDifference = 0;
+            for (size_t i = 0; i < actual.size(); i++)
+            {
+                const int difference = static_cast<int>(actual[i]) - static_cast<int>(expected[i]);
+                maxDifference = AZStd::max(maxDifference, (difference < 0) ? -difference : difference);
+            }
+            EXPECT_LE(maxDifference, Tolerance) << "Mip level " << mipIndex;
+        }
+    }
+
+    TEST_P(CloudTextureMipReductionTest, ReduceSlices_SlabsMatchWholeVolume)
+    {
+        constexpr uint32_t SrcSize = 16;
+        constexpr uint32_t DstSize = SrcSize / 2;
+        constexpr size_t DstSliceBytes = DstSize * DstSize * CloudTextureMipReduction::BytesPerPixel;
+
+        AZStd::vector<uint8_t> src(SrcSize * SrcSize * SrcSize * CloudTextureMipReduction::BytesPerPixel);
+        for (size_t i = 0; i < src.size(); i++)
+        {
+            src[i] = static_cast<uint8_t>((i * 7919) >> 3);
+        }
+
+        AZStd::vector<uint8_t> wholeVolume(DstSliceBytes * DstSize);
+        CloudTextureMipReduction::ReduceSlices(GetParam(), src.data(), SrcSize, 0, DstSize, wholeVolume.data());
+
+        AZStd::vector<uint8_t> slabs(DstSliceBytes * DstSize);
+        for (uint32_t firstSlice = 0; firstSlice < DstSize; firstSlice += 3)
+        {
+            const uint32_t sliceCount = AZStd::min(3u, DstSize - firstSlice);
+            CloudTextureMipReduction::ReduceSlices(GetParam(), src.data(), SrcSize, firstSlice, sliceCount, slabs.data() + DstSliceBytes * firstSlice);
+        }
+
+        EXPECT_EQ(wholeVolume, slabs);
+    }
+
+    INSTANTIATE_TEST_CASE_P(MipFilters, CloudTextureMipReductionTest,
+        ::testing::Values(CloudTextureMipFilter::Box, CloudTextureMipFilter::Kaiser));
+
+} // namespace UnitTest
@@ -0,0 +1,191 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+#include <AzTest/AzTest.h>
+
+#include <cstring>
+
+#include <Renderer/Cpu/CloudTextureStatistics.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudTextureStatisticsTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        // A single mip level whose byte i is @byteFn(i).
+        template<typename ByteFunction>
+        static AZStd::vector<CloudTextureMipData> CreateMipLevel(uint32_t pixelSize, uint32_t bytesPerPixel, ByteFunction byteFn)
+        {
+            AZStd::vector<CloudTextureMipData> mipLevels(1);
+            mipLevels[0].m_mipSize = AZ::RHI::Size(pixelSize, pixelSize, pixelSize);
+            mipLevels[0].m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(
+                static_cast<size_t>(pixelSize) * pixelSize * pixelSize * bytesPerPixel);
+            auto& pixels = *mipLevels[0].m_dataBuffer;
+            for (size_t byteIndex = 0; byteIndex < pixels.size(); byteIndex++)
+            {
+                pixels[byteIndex] = byteFn(byteIndex);
+            }
+            return mipLevels;
+        }
+
+        static uint64_t GetHistogramTotal(const CloudTextureChannelStats& channelStats)
+        {
+            uint64_t total = 0;
+            for (uint32_t count : channelStats.m_histogram)
+            {
+                total += count;
+            }
+            return total;
+        }
+    };
+
+    TEST_F(CloudTextureStatisticsTest, Calculate_RGBA8_MatchesBruteForce)
+    {
+        constexpr uint32_t PixelSize = 16;
+        const auto mipLevels = CreateMipLevel(PixelSize, 4, [](size_t byteIndex)
+            {
+                return static_cast<uint8_t>(((byteIndex * 37) ^ (byteIndex >> 7)) & 0x7F) + static_cast<uint8_t>((byteIndex & 3) * 32);
+            });
+        CloudTextureStats stats;
+        ASSERT_TRUE(CloudTextureStatistics::Calculate(AZ::RHI::Format::R8G8B8A8_UNORM, mipLevels, stats));
+        ASSERT_TRUE(stats.IsValid());
+        EXPECT_EQ(stats.m_channelCount, 4u);
+        EXPECT_FALSE(stats.m_normalized);
+        ASSERT_EQ(stats.m_mipLevels.size(), 1u);
+
+        const auto& pixels = *mipLevels[0].m_dataBuffer;
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            uint8_t minCode = 255;
+            uint8_t maxCode = 0;
+            double sum = 0.0;
+            AZStd::array<uint32_t, CloudTextureChannelStats::HistogramBinCount> histogram = {};
+            for (size_t byteIndex = channel; byteIndex < pixels.size(); byteIndex += 4)
+            {
+                minCode = AZStd::min(minCode, pixels[byteIndex]);
+                maxCode = AZStd::max(maxCode, pixels[byteIndex]);
+                sum += pixels[byteIndex];
+                histogram[pixels[byteIndex]]++;
+            }
+            const auto& channelStats = stats.m_mipLevels[0].m_channels[channel];
+            EXPECT_FLOAT_EQ(channelStats.m_min, minCode / 255.0f);
+            EXPECT_FLOAT_EQ(channelStats.m_max, maxCode / 255.0f);
+            EXPECT_NEAR(channelStats.m_mean, sum / (pixels.size() / 4) / 255.0, 1e-5);
+            EXPECT_EQ(channelStats.m_histogram, histogram);
+        }
+    }
+
+    TEST_F(CloudTextureStatisticsTest, Calculate_R16F_MatchesBruteForce)
+    {
+        constexpr uint32_t PixelSize = 8;
+        constexpr size_t PixelCount = PixelSize * PixelSize * PixelSize;
+        AZStd::vector<float> values(PixelCount);
+        for (size_t pixelIndex = 0; pixelIndex < PixelCount; pixelIndex++)
+        {
+            values[pixelIndex] = 0.2f + 0.5f * static_cast<float>(pixelIndex) / static_cast<float>(PixelCount - 1);
+        }
+        auto mipLevels = CreateMipLevel(PixelSize, 2, [](size_t) { return uint8_t(0); });
+        for (size_t pixelIndex = 0; pixelIndex < PixelCount; pixelIndex++)
+        {
+            const uint16_t halfValue = CloudTextureStatistics::FloatToHalf(values[pixelIndex]);
+            memcpy(mipLevels[0].m_dataBuffer->data() + pixelIndex * sizeof(uint16_t), &halfValue, sizeof(uint16_t));
+        }
+
+        CloudTextureStats stats;
+        ASSERT_TRUE(CloudTextureStatistics::Calculate(AZ::RHI::Format::R16_FLOAT, mipLevels, stats));
+        EXPECT_EQ(stats.m_channelCount, 1u);
+        const auto& channelStats = stats.m_mipLevels[0].m_channels[0];
+        // Half precision has 11 bits of mantissa.
+        EXPECT_NEAR(channelStats.m_min, 0.2f, 1e-3f);
+        EXPECT_NEAR(channelStats.m_max, 0.7f, 1e-3f);
+        EXPECT_NEAR(channelStats.m_mean, 0.45f, 1e-3f);
+        EXPECT_EQ(GetHistogramTotal(channelStats), PixelCount);
+        EXPECT_EQ(channelStats.m_histogram[0], 0u);
+        EXPECT_EQ(channelStats.m_histogram[255], 0u);
+        EXPECT_GT(channelStats.m_histogram[51], 0u);
+        EXPECT_GT(channelStats.m_histogram[178], 0u);
+    }
+
+    TEST_F(CloudTextureStatisticsTest, Calculate_MismatchedBufferSize_Fails)
+    {
+        auto mipLevels = CreateMipLevel(4, 4, [](size_t) { return uint8_t(0); });
+        mipLevels[0].m_dataBuffer->pop_back();
+        CloudTextureStats stats;
+        AZ_TEST_START_TRACE_SUPPRESSION;
+        EXPECT_FALSE(CloudTextureStatistics::Calculate(AZ::RHI::Format::R8G8B8A8_UNORM, mipLevels, stats));
+        EXPECT_FALSE(CloudTextureStatistics::Calculate(AZ::RHI::Format::R32_FLOAT, mipLevels, stats));
+        AZ_TEST_STOP_TRACE_SUPPRESSION(2);
+    }
+
+    TEST_F(CloudTextureStatisticsTest, NormalizeChannelRange_RG8_RemapsToFullRange)
+    {
+        // R goes from 64 to 191, and G is constant.
+        const auto mipLevels = CreateMipLevel(16, 2, [](size_t byteIndex)
+            {
+                return (byteIndex & 1) ? uint8_t(100) : static_cast<uint8_t>(64 + ((byteIndex / 2) % 128));
+            });
+        CloudTextureStats stats;
+        ASSERT_TRUE(CloudTextureStatistics::Calculate(AZ::RHI::Format::R8G8_UNORM, mipLevels, stats));
+        const auto sourceMipLevels = *mipLevels[0].m_dataBuffer;
+
+        AZStd::vector<CloudTextureMipData> normalizedMipLevels;
+        ASSERT_TRUE(CloudTextureStatistics::NormalizeChannelRange(AZ::RHI::Format::R8G8_UNORM, mipLevels, stats, normalizedMipLevels));
+        ASSERT_EQ(normalizedMipLevels.size(), 1u);
+        EXPECT_NE(normalizedMipLevels[0].m_dataBuffer, mipLevels[0].m_dataBuffer);
+        // The source buffers may be shared, they must be left untouched.
+        EXPECT_TRUE(*mipLevels[0].m_dataBuffer == sourceMipLevels);
+
+        EXPECT_TRUE(stats.m_normalized);
+        EXPECT_FLOAT_EQ(stats.m_sourceRangeMin[0], 64.0f / 255.0f);
+        EXPECT_FLOAT_EQ(stats.m_sourceRangeMax[0], 191.0f / 255.0f);
+        EXPECT_FLOAT_EQ(stats.m_sourceRangeMin[1], 0.0f);
+        EXPECT_FLOAT_EQ(stats.m_sourceRangeMax[1], 1.0f);
+
+        const auto& redStats = stats.m_mipLevels[0].m_channels[0];
+        EXPECT_FLOAT_EQ(redStats.m_min, 0.0f);
+        EXPECT_FLOAT_EQ(redStats.m_max, 1.0f);
+        const auto& greenStats = stats.m_mipLevels[0].m_channels[1];
+        EXPECT_FLOAT_EQ(greenStats.m_min, 100.0f / 255.0f);
+        EXPECT_FLOAT_EQ(greenStats.m_max, 100.0f / 255.0f);
+
+        // Remapping back with the source range recovers the original values within one code.
+        const auto& normalizedPixels = *normalizedMipLevels[0].m_dataBuffer;
+        for (size_t byteIndex = 0; byteIndex < normalizedPixels.size(); byteIndex += 2)
+        {
+            const float value = normalizedPixels[byteIndex] / 255.0f;
+            const float sourceValue = stats.m_sourceRangeMin[0] + value * (stats.m_sourceRangeMax[0] - stats.m_sourceRangeMin[0]);
+            ASSERT_NEAR(sourceValue * 255.0f, static_cast<float>(sourceMipLevels[byteIndex]), 1.0f) << byteIndex;
+            ASSERT_EQ(normalizedPixels[byteIndex + 1], 100);
+        }
+    }
+
+    TEST_F(CloudTextureStatisticsTest, HalfConversion_AllHalfValues_RoundTrip)
+    {
+        for (uint32_t bits = 0; bits <= 0xFFFF; bits++)
+        {
+            const uint16_t halfValue = static_cast<uint16_t>(bits);
+            const float value = CloudTextureStatistics::HalfToFloat(halfValue);
+            if (value != value)
+            {
+                // NaN payloads are not preserved, only the NaN-ness.
+                const float roundTrip = CloudTextureStatistics::HalfToFloat(CloudTextureStatistics::FloatToHalf(value));
+                ASSERT_NE(roundTrip, roundTrip) << bits;
+                continue;
+            }
+            ASSERT_EQ(CloudTextureStatistics::FloatToHalf(value), halfValue) << bits;
+        }
+        EXPECT_EQ(CloudTextureStatistics::HalfToFloat(CloudTextureStatistics::FloatToHalf(0.5f)), 0.5f);
+        EXPECT_EQ(CloudTextureStatistics::FloatToHalf(1.0f), 0x3C00);
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,139 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#if defined(HAVE_BENCHMARK)
+
+#include <AzCore/UnitTest/Utils.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
+
+#include <CloudTextureBenchmarkFixture.h>
+#include <Renderer/CloudVolumeFile.h>
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+
+// Run with:
+//     AzTestRunner <VolumetricClouds.Tests module> AzRunBenchmarks --benchmark_out_format=json --benchmark_out=<file>.json
+// "bytes_per_second" is the uncompressed RGBA8 mip chain written, or loaded, per second.
+// "ratio" is the compressed size of the bricks divided by the uncompressed size.
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    // Measures CloudVolumeFile::Write() and CloudVolumeFileReader::LoadMipChain() with each codec,
+    // on a mip chain baked by CloudTextureCpuBaker with the default CloudTextureComputeData.
+    // Arguments: size, codec.
+    class CloudVolumeFileBenchmark : public CloudTextureBenchmarkFixture
+    {
+    protected:
+        void SetUpBenchmark(const ::benchmark::State& state) override
+        {
+            m_tempDirectory = AZStd::make_unique<AZ::Test::ScopedAutoTempDirectory>();
+            // The bake is not measured.
+            m_computeData.m_pixelSize = static_cast<uint32_t>(state.range(0));
+            m_mipLevels = CloudTextureCpuBaker::Bake(m_computeData, PerlinWorleyNoiseVariant::A, GetJobContext());
+            m_writeSettings.m_codec = static_cast<CloudVolumeCodec>(state.range(1));
+            m_filePath = AZ::IO::Path(m_tempDirectory->Resolve("benchmark.cloudvol").Native());
+        }
+
+        void TearDownBenchmark([[maybe_unused]] const ::benchmark::State& state) override
+        {
+            m_mipLevels = {};
+            m_tempDirectory.reset();
+        }
+
+        bool WriteFile() const
+        {
+            return CloudVolumeFile::Write(m_filePath, m_computeData, AZ::RHI::Format::R8G8B8A8_UNORM, m_mipLevels, m_writeSettings,
+                nullptr, GetJobContext());
+        }
+
+        uint64_t GetMipChainSizeInBytes() const
+        {
+            uint64_t totalBytes = 0;
+            for (const auto& mipLevelData : m_mipLevels)
+            {
+                totalBytes += mipLevelData.m_dataBuffer->size();
+            }
+            return totalBytes;
+        }
+
+        void SetCounters(::benchmark::State& state, const CloudVolumeFileReader& reader) const
+        {
+            const uint64_t mipChainSizeInBytes = GetMipChainSizeInBytes();
+            state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(mipChainSizeInBytes));
+            state.counters["ratio"] = static_cast<double>(reader.GetCompressedSizeInBytes()) / static_cast<double>(mipChainSizeInBytes);
+        }
+
+        CloudTextureComputeData m_computeData;
+        CloudVolumeWriteSettings m_writeSettings;
+        AZStd::vector<CloudTextureCpuBaker::MipLevelData> m_mipLevels;
+        AZ::IO::Path m_filePath;
+
+    private:
+        AZStd::unique_ptr<AZ::Test::ScopedAutoTempDirectory> m_tempDirectory;
+    };
+
+    BENCHMARK_DEFINE_F(CloudVolumeFileBenchmark, Write)(::benchmark::State& state)
+    {
+        for ([[maybe_unused]] auto _ : state)
+        {
+            if (!WriteFile())
+            {
+                state.SkipWithError("CloudVolumeFile::Write failed");
+                return;
+            }
+        }
+
+        CloudVolumeFileReader reader;
+        if (reader.Open(m_filePath))
+        {
+            SetCounters(state, reader);
+        }
+    }
+
+    BENCHMARK_DEFINE_F(CloudVolumeFileBenchmark, LoadMipChain)(::benchmark::State& state)
+    {
+        // Writing, and mapping, the file is not measured.
+        CloudVolumeFileReader reader;
+        if (!WriteFile() || !reader.Open(m_filePath))
+        {
+            state.SkipWithError("Failed to write the file");
+            return;
+        }
+
+        for ([[maybe_unused]] auto _ : state)
+        {
+            AZStd::vector<CloudTextureMipData> loadedMipLevels;
+            if (!reader.LoadMipChain(loadedMipLevels, GetJobContext()))
+            {
+                state.SkipWithError("LoadMipChain failed");
+                return;
+            }
+            ::benchmark::DoNotOptimize(loadedMipLevels.data());
+        }
+        SetCounters(state, reader);
+    }
+
+    static void CloudVolumeFileArguments(::benchmark::internal::Benchmark* benchmark)
+    {
+        benchmark->ArgNames({ "size", "codec" });
+        benchmark->ArgsProduct({
+            { 32, 64, 128 },
+            {
+                static_cast<int64_t>(CloudVolumeCodec::None),
+                static_cast<int64_t>(CloudVolumeCodec::LZ4),
+                static_cast<int64_t>(CloudVolumeCodec::ZStd),
+            } });
+        benchmark->Unit(::benchmark::kMillisecond);
+        benchmark->UseRealTime();
+    }
+
+    BENCHMARK_REGISTER_F(CloudVolumeFileBenchmark, Write)->Apply(CloudVolumeFileArguments);
+    BENCHMARK_REGISTER_F(CloudVolumeFileBenchmark, LoadMipChain)->Apply(CloudVolumeFileArguments);
+
+} // namespace UnitTest
+
+#endif // HAVE_BENCHMARK
@@ -0,0 +1,348 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/IO/SystemFile.h>
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/UnitTest/Utils.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+#include <AzTest/AzTest.h>
+
+#include <cstddef>
+#include <cstring>
+
+#include <Renderer/CloudVolumeFile.h>
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Renderer/Cpu/CloudTextureStatistics.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudVolumeFileTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        // A mip chain whose dimensions are not multiples of the brick size, to cover the edge bricks.
+        static AZStd::vector<CloudTextureMipData> CreatePatternMipChain(uint32_t width, uint32_t height, uint32_t depth, uint32_t bytesPerPixel)
+        {
+            AZStd::vector<CloudTextureMipData> mipLevels;
+            for (uint16_t mipIndex = 0; ; mipIndex++)
+            {
+                CloudTextureMipData& mipData = mipLevels.emplace_back();
+                mipData.m_mipSlice = mipIndex;
+                mipData.m_mipSize = AZ::RHI::Size(width, height, depth);
+                mipData.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(static_cast<size_t>(width) * height * depth * bytesPerPixel);
+                auto& pixels = *mipData.m_dataBuffer;
+                for (size_t byteIndex = 0; byteIndex < pixels.size(); byteIndex++)
+                {
+                    pixels[byteIndex] = static_cast<uint8_t>((byteIndex * 7) ^ (byteIndex >> 9) ^ mipIndex);
+                }
+                if ((width == 1) && (height == 1) && (depth == 1))
+                {
+                    break;
+                }
+                width = AZStd::max(width / 2, 1u);
+                height = AZStd::max(height / 2, 1u);
+                depth = AZStd::max(depth / 2, 1u);
+            }
+            return mipLevels;
+        }
+
+        static void ExpectEqualMipChains(const AZStd::vector<CloudTextureMipData>& expected, const AZStd::vector<CloudTextureMipData>& actual)
+        {
+            ASSERT_EQ(expected.size(), actual.size());
+            for (size_t mipIndex = 0; mipIndex < expected.size(); mipIndex++)
+            {
+                EXPECT_EQ(actual[mipIndex].m_mipSlice, expected[mipIndex].m_mipSlice);
+                EXPECT_EQ(actual[mipIndex].m_mipSize, expected[mipIndex].m_mipSize);
+                ASSERT_TRUE(actual[mipIndex].m_dataBuffer);
+                EXPECT_TRUE(*actual[mipIndex].m_dataBuffer == *expected[mipIndex].m_dataBuffer) << "Mip " << mipIndex;
+            }
+        }
+
+        AZ::Test::ScopedAutoTempDirectory m_tempDirectory;
+    };
+
+    TEST_F(CloudVolumeFileTest, WriteAndLoad_AllCodecsAndBrickSizes_RoundTrip)
+    {
+        const auto mipLevels = CreatePatternMipChain(48, 40, 36, 4);
+        CloudTextureComputeData computeData;
+        computeData.m_frequency = 7.5f;
+        computeData.m_worleyOctaves = 2;
+        computeData.m_channelLayout = static_cast<uint32_t>(CloudTextureChannelLayout::RG8);
+
+        for (const auto codec : { CloudVolumeCodec::None, CloudVolumeCodec::LZ4, CloudVolumeCodec::ZStd })
+        {
+            for (const uint32_t brickSize : { 4u, 16u, 64u })
+            {
+                const AZ::IO::Path filePath(m_tempDirectory.Resolve("roundtrip.cloudvol").Native());
+                CloudVolumeWriteSettings settings;
+                settings.m_codec = codec;
+                settings.m_brickSize = brickSize;
+                uint64_t reportedBytes = 0;
+                ASSERT_TRUE(CloudVolumeFile::Write(filePath, computeData, AZ::RHI::Format::R8G8B8A8_UNORM, mipLevels, settings,
+                    [&reportedBytes](uint64_t writtenBytes) { reportedBytes += writtenBytes; return true; }));
+
+                CloudVolumeFileReader reader;
+                ASSERT_TRUE(reader.Open(filePath));
+                EXPECT_EQ(reader.GetFormat(), AZ::RHI::Format::R8G8B8A8_UNORM);
+                EXPECT_EQ(reader.GetMipCount(), mipLevels.size());
+                EXPECT_EQ(reader.GetFileHeader().m_codec, static_cast<uint32_t>(codec));
+                // The provenance is the compute data, not the layout of the stored pixels.
+                EXPECT_TRUE(reader.GetComputeData() == computeData);
+
+                AZStd::vector<CloudTextureMipData> loadedMipLevels;
+                ASSERT_TRUE(reader.LoadMipChain(loadedMipLevels));
+                ExpectEqualMipChains(mipLevels, loadedMipLevels);
+
+                uint64_t totalBytes = 0;
+                for (const auto& mipData : mipLevels)
+                {
+                    totalBytes += mipData.m_dataBuffer->size();
+                }
+                EXPECT_EQ(reportedBytes, totalBytes);
+            }
+        }
+    }
+
+    TEST_F(CloudVolumeFileTest, DecompressBrick_SingleBrick_OnlyWritesItsRegion)
+    {
+        const auto mipLevels = CreatePatternMipChain(32, 32, 32, 1);
+        const AZ::IO::Path filePath(m_tempDirectory.Resolve("brick.cloudvol").Native());
+        CloudVolumeWriteSettings settings;
+        settings.m_brickSize = 16;
+        ASSERT_TRUE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R8_UNORM, mipLevels, settings));
+
+        CloudVolumeFileReader reader;
+        ASSERT_TRUE(reader.Open(filePath));
+        const auto& mipHeader = reader.GetMipHeader(0);
+        EXPECT_EQ(mipHeader.m_bricksX * mipHeader.m_bricksY * mipHeader.m_bricksZ, 8u);
+
+        // Brick 5 is x = 1, y = 0, z = 1.
+        AZStd::vector<uint8_t> pixels(32 * 32 * 32, uint8_t(0));
+        ASSERT_TRUE(reader.DecompressBrick(0, 5, pixels.data()));
+        const auto& expectedPixels = *mipLevels[0].m_dataBuffer;
+        for (uint32_t z = 0; z < 32; z++)
+        {
+            for (uint32_t y = 0; y < 32; y++)
+            {
+                for (uint32_t x = 0; x < 32; x++)
+                {
+                    const size_t pixelIndex = (z * 32 * 32) + (y * 32) + x;
+                    const bool isInBrick = (x >= 16) && (y < 16) && (z >= 16);
+                    ASSERT_EQ(pixels[pixelIndex], isInBrick ? expectedPixels[pixelIndex] : 0) << x << ", " << y << ", " << z;
+                }
+            }
+        }
+        EXPECT_FALSE(reader.DecompressBrick(0, 8, pixels.data()));
+    }
+
+    TEST_F(CloudVolumeFileTest, Open_TruncatedFile_Fails)
+    {
+        const auto mipLevels = CreatePatternMipChain(16, 16, 16, 4);
+        const AZ::IO::Path filePath(m_tempDirectory.Resolve("truncated.cloudvol").Native());
+        ASSERT_TRUE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R8G8B8A8_UNORM, mipLevels));
+
+        AZStd::vector<uint8_t> fileBytes;
+        {
+            AZ::IO::SystemFile file;
+            ASSERT_TRUE(file.Open(filePath.c_str(), AZ::IO::SystemFile::SF_OPEN_READ_ONLY));
+            fileBytes.resize(file.Length());
+            ASSERT_EQ(file.Read(fileBytes.size(), fileBytes.data()), fileBytes.size());
+        }
+
+        // Drop the last bytes of the payload, and separately, corrupt the magic number.
+        const AZ::IO::Path truncatedFilePath(m_tempDirectory.Resolve("truncated2.cloudvol").Native());
+        const AZ::IO::Path corruptFilePath(m_tempDirectory.Resolve("corrupt.cloudvol").Native());
+        {
+            AZ::IO::SystemFile file;
+            ASSERT_TRUE(file.Open(truncatedFilePath.c_str(), AZ::IO::SystemFile::SF_OPEN_CREATE | AZ::IO::SystemFile::SF_OPEN_WRITE_ONLY));
+            file.Write(fileBytes.data(), fileBytes.size() - 16);
+        }
+        fileBytes[0] ^= 0xFF;
+        {
+            AZ::IO::SystemFile file;
+            ASSERT_TRUE(file.Open(corruptFilePath.c_str(), AZ::IO::SystemFile::SF_OPEN_CREATE | AZ::IO::SystemFile::SF_OPEN_WRITE_ONLY));
+            file.Write(fileBytes.data(), fileBytes.size());
+        }
+
+        CloudVolumeFileReader reader;
+        AZ_TEST_START_TRACE_SUPPRESSION;
+        EXPECT_FALSE(reader.Open(truncatedFilePath));
+        EXPECT_FALSE(reader.Open(corruptFilePath));
+        AZ_TEST_STOP_TRACE_SUPPRESSION(2);
+        EXPECT_FALSE(reader.IsOpen());
+    }
+
+    TEST_F(CloudVolumeFileTest, Open_InvalidMipChain_Fails)
+    {
+        const auto mipLevels = CreatePatternMipChain(16, 16, 16, 4);
+        const AZ::IO::Path filePath(m_tempDirectory.Resolve("mipchain.cloudvol").Native());
+        ASSERT_TRUE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R8G8B8A8_UNORM, mipLevels));
+
+        AZStd::vector<uint8_t> fileBytes;
+        {
+            AZ::IO::SystemFile file;
+            ASSERT_TRUE(file.Open(filePath.c_str(), AZ::IO::SystemFile::SF_OPEN_READ_ONLY));
+            fileBytes.resize(file.Length());
+            ASSERT_EQ(file.Read(fileBytes.size(), fileBytes.data()), fileBytes.size());
+        }
+
+        auto setUint32 = [&fileBytes](size_t offset, uint32_t value)
+        {
+            AZStd::vector<uint8_t> corruptFileBytes = fileBytes;
+            memcpy(corruptFileBytes.data() + offset, &value, sizeof(value));
+            return corruptFileBytes;
+        };
+        const size_t mipHeadersOffset = sizeof(CloudVolumeFile::FileHeader);
+        const size_t provenancePixelSizeOffset = offsetof(CloudVolumeFile::FileHeader, m_provenance) + offsetof(CloudVolumeFile::Provenance, m_pixelSize);
+
+        AZStd::vector<AZStd::vector<uint8_t>> corruptFiles;
+        // The width of mip 0 is huge, its buffer must not be allocated.
+        corruptFiles.push_back(setUint32(mipHeadersOffset, 0x40000000));
+        // The width of mip 1 is not half the width of mip 0.
+        corruptFiles.push_back(setUint32(mipHeadersOffset + sizeof(CloudVolumeFile::MipHeader), 16));
+        corruptFiles.push_back(setUint32(provenancePixelSizeOffset, CloudTextureFormat::MaxPixelSize * 2));
+
+        CloudVolumeFileReader reader;
+        for (size_t fileIndex = 0; fileIndex < corruptFiles.size(); fileIndex++)
+        {
+            {
+                AZ::IO::SystemFile file;
+                ASSERT_TRUE(file.Open(filePath.c_str(), AZ::IO::SystemFile::SF_OPEN_CREATE | AZ::IO::SystemFile::SF_OPEN_WRITE_ONLY));
+                file.Write(corruptFiles[fileIndex].data(), corruptFiles[fileIndex].size());
+            }
+            AZ_TEST_START_TRACE_SUPPRESSION;
+            EXPECT_FALSE(reader.Open(filePath)) << "File " << fileIndex;
+            AZ_TEST_STOP_TRACE_SUPPRESSION(1);
+        }
+
+        // The writer rejects the same mip chains.
+        AZ_TEST_START_TRACE_SUPPRESSION;
+        EXPECT_FALSE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R8_UNORM,
+            CreatePatternMipChain(CloudTextureFormat::MaxPixelSize * 2, 1, 1, 1)));
+        AZ_TEST_STOP_TRACE_SUPPRESSION(1);
+    }
+
+    TEST_F(CloudVolumeFileTest, Write_CanceledByProgressCallback_DeletesFile)
+    {
+        const auto mipLevels = CreatePatternMipChain(16, 16, 16, 4);
+        const AZ::IO::Path filePath(m_tempDirectory.Resolve("canceled.cloudvol").Native());
+        CloudVolumeWriteSettings settings;
+        settings.m_brickSize = 4;
+        EXPECT_FALSE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R8G8B8A8_UNORM, mipLevels, settings,
+            [](uint64_t) { return false; }));
+        EXPECT_FALSE(AZ::IO::SystemFile::Exists(filePath.c_str()));
+    }
+
+    TEST_F(CloudVolumeFileTest, Write_InvalidFormat_Fails)
+    {
+        const auto mipLevels = CreatePatternMipChain(8, 8, 8, 4);
+        const AZ::IO::Path filePath(m_tempDirectory.Resolve("invalid.cloudvol").Native());
+        AZ_TEST_START_TRACE_SUPPRESSION;
+        EXPECT_FALSE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R32G32B32A32_FLOAT, mipLevels));
+        AZ_TEST_STOP_TRACE_SUPPRESSION(1);
+    }
+
+    TEST_F(CloudVolumeFileTest, WriteAndLoad_WithStats_RoundTrip)
+    {
+        const auto mipLevels = CreatePatternMipChain(16, 16, 16, 2);
+        CloudTextureStats stats;
+        ASSERT_TRUE(CloudTextureStatistics::Calculate(AZ::RHI::Format::R8G8_UNORM, mipLevels, stats));
+        stats.m_normalized = true;
+        stats.m_sourceRangeMin[1] = 0.25f;
+        stats.m_sourceRangeMax[1] = 0.75f;
+
+        const AZ::IO::Path filePath(m_tempDirectory.Resolve("stats.cloudvol").Native());
+        ASSERT_TRUE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R8G8_UNORM, mipLevels, {},
+            nullptr, nullptr, &stats));
+
+        CloudVolumeFileReader reader;
+        ASSERT_TRUE(reader.Open(filePath));
+        ASSERT_TRUE(reader.HasStats());
+        // Normalized files are reported as such in the provenance.
+        EXPECT_TRUE(reader.GetComputeData().m_normalizeChannelRange);
+
+        CloudTextureStats loadedStats;
+        ASSERT_TRUE(reader.GetStats(loadedStats));
+        EXPECT_EQ(loadedStats.m_channelCount, 2u);
+        EXPECT_TRUE(loadedStats.m_normalized);
+        EXPECT_EQ(loadedStats.m_sourceRangeMin, stats.m_sourceRangeMin);
+        EXPECT_EQ(loadedStats.m_sourceRangeMax, stats.m_sourceRangeMax);
+        ASSERT_EQ(loadedStats.m_mipLevels.size(), stats.m_mipLevels.size());
+        for (size_t mipIndex = 0; mipIndex < stats.m_mipLevels.size(); mipIndex++)
+        {
+            EXPECT_EQ(loadedStats.m_mipLevels[mipIndex].m_mipSlice, stats.m_mipLevels[mipIndex].m_mipSlice);
+            for (uint32_t channel = 0; channel < 2; channel++)
+            {
+                const auto& expected = stats.m_mipLevels[mipIndex].m_channels[channel];
+                const auto& actual = loadedStats.m_mipLevels[mipIndex].m_channels[channel];
+                EXPECT_EQ(actual.m_min, expected.m_min);
+                EXPECT_EQ(actual.m_max, expected.m_max);
+                EXPECT_EQ(actual.m_mean, expected.m_mean);
+                EXPECT_EQ(actual.m_histogram, expected.m_histogram);
+            }
+        }
+
+        AZStd::vector<CloudTextureMipData> loadedMipLevels;
+        ASSERT_TRUE(reader.LoadMipChain(loadedMipLevels));
+        ExpectEqualMipChains(mipLevels, loadedMipLevels);
+    }
+
+    TEST_F(CloudVolumeFileTest, Open_WithoutStats_HasNoStats)
+    {
+        const auto mipLevels = CreatePatternMipChain(8, 8, 8, 1);
+        const AZ::IO::Path filePath(m_tempDirectory.Resolve("nostats.cloudvol").Native());
+        ASSERT_TRUE(CloudVolumeFile::Write(filePath, CloudTextureComputeData(), AZ::RHI::Format::R8_UNORM, mipLevels));
+
+        CloudVolumeFileReader reader;
+        ASSERT_TRUE(reader.Open(filePath));
+        EXPECT_FALSE(reader.HasStats());
+        CloudTextureStats stats;
+        EXPECT_FALSE(reader.GetStats(stats));
+    }
+
+    // The throughput of each codec is measured by CloudVolumeFileBenchmark.
+    TEST_F(CloudVolumeFileTest, WriteAndLoad_BakedNoise_NoCodecGrowsTheFile)
+    {
+        CloudTextureComputeData computeData;
+        computeData.m_pixelSize = 64;
+        const auto mipLevels = CloudTextureCpuBaker::Bake(computeData);
+        ASSERT_FALSE(mipLevels.empty());
+        uint64_t uncompressedBytes = 0;
+        for (const auto& mipData : mipLevels)
+        {
+            uncompressedBytes += mipData.m_dataBuffer->size();
+        }
+
+        for (const auto codec : { CloudVolumeCodec::None, CloudVolumeCodec::LZ4, CloudVolumeCodec::ZStd })
+        {
+            const AZ::IO::Path filePath(m_tempDirectory.Resolve("bakednoise.cloudvol").Native());
+            CloudVolumeWriteSettings settings;
+            settings.m_codec = codec;
+            ASSERT_TRUE(CloudVolumeFile::Write(filePath, computeData, AZ::RHI::Format::R8G8B8A8_UNORM, mipLevels, settings));
+
+            CloudVolumeFileReader reader;
+            ASSERT_TRUE(reader.Open(filePath));
+            AZStd::vector<CloudTextureMipData> loadedMipLevels;
+            ASSERT_TRUE(reader.LoadMipChain(loadedMipLevels));
+            ExpectEqualMipChains(mipLevels, loadedMipLevels);
+
+            // Incompressible bricks are stored raw, so no codec makes the file bigger.
+            const double ratio = static_cast<double>(reader.GetCompressedSizeInBytes()) / static_cast<double>(uncompressedBytes);
+            EXPECT_LE(ratio, 1.0);
+            if (codec == CloudVolumeCodec::ZStd)
+            {
+                // The noise is smooth, the entropy coder always finds some redundancy.
+                EXPECT_LT(ratio, 1.0);
+            }
+        }
+    }
+
+} // namespace UnitTest
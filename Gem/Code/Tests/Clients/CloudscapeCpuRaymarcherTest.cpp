@@ -0,0 +1,258 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/Math/Vector4.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/utils.h>
+#include <AzTest/AzTest.h>
+
+#include <cmath>
+
+#include <CloudscapeTestTextures.h>
+#include <Renderer/CloudscapeShaderConstantData.h>
+#include <Renderer/Cpu/CloudscapeCpuRaymarcher.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudscapeCpuRaymarcherTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static constexpr uint32_t NoiseSize = CloudscapeTestTextures::NoiseSize;
+        static constexpr uint32_t WeatherMapSize = CloudscapeTestTextures::WeatherMapSize;
+
+        // A perspective view, with a 90 degrees field of view, at @heightMeters above the ground.
+        static CloudscapeCpuRaymarcher::View CreateView(float heightMeters, const AZ::Vector3& forward)
+        {
+            const AZ::Vector3 worldUp = AZ::Vector3::CreateAxisZ();
+            const AZ::Vector3 right = (std::abs(forward.Dot(worldUp)) > 0.99f)
+                ? AZ::Vector3::CreateAxisX()
+                : forward.Cross(worldUp).GetNormalized();
+            const AZ::Vector3 up = right.Cross(forward);
+
+            CloudscapeCpuRaymarcher::View view;
+            view.m_worldPosition = AZ::Vector3(0.0f, 0.0f, heightMeters);
+            // Maps the clip position (x, y, 1, 1) to a point one meter in front of the camera.
+            view.m_viewProjectionInverse = AZ::Matrix4x4::CreateFromColumns(
+                AZ::Vector4::CreateFromVector3AndFloat(right, 0.0f),
+                AZ::Vector4::CreateFromVector3AndFloat(up, 0.0f),
+                AZ::Vector4::CreateFromVector3AndFloat(forward, 0.0f),
+                AZ::Vector4::CreateFromVector3AndFloat(view.m_worldPosition, 1.0f));
+            return view;
+        }
+
+        void SetUp() override
+        {
+            LeakDetectionFixture::SetUp();
+            m_lowFrequencyNoise = CloudscapeTestTextures::CreateNoiseTexture(1);
+            m_highFrequencyNoise = CloudscapeTestTextures::CreateNoiseTexture(2);
+            m_weatherMap = CloudscapeTestTextures::CreateWeatherMap(255, 255);
+
+            m_textures.m_lowFrequencyNoise = &m_lowFrequencyNoise;
+            m_textures.m_highFrequencyNoise = &m_highFrequencyNoise;
+            m_textures.m_weatherMapPixels = m_weatherMap.data();
+            m_textures.m_weatherMapWidth = WeatherMapSize;
+            m_textures.m_weatherMapHeight = WeatherMapSize;
+
+            m_shaderConstantData.m_windSpeedKmPerSec = 0.05f;
+            m_shaderConstantData.m_cloudTopOffsetKm = 0.5f;
+            m_shaderConstantData.m_directionTowardsTheSun = AZ::Vector3(0.3f, 0.2f, 0.9f).GetNormalized();
+        }
+
+        void TearDown() override
+        {
+            m_lowFrequencyNoise = {};
+            m_highFrequencyNoise = {};
+            m_weatherMap = {};
+            LeakDetectionFixture::TearDown();
+        }
+
+        // Returns the number of pixels with clouds.
+        static uint32_t ExpectValidPixels(const CloudscapeCpuRaymarcher::Image& image)
+        {
+            uint32_t cloudPixelCount = 0;
+            for (size_t pixelIndex = 0; pixelIndex < image.m_pixels.size() / 4; pixelIndex++)
+            {
+                const float* pixel = image.m_pixels.data() + pixelIndex * 4;
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    EXPECT_TRUE(std::isfinite(pixel[channel])) << pixelIndex;
+                    EXPECT_GE(pixel[channel], 0.0f) << pixelIndex;
+                }
+                EXPECT_LE(pixel[3], 1.0f) << pixelIndex;
+                cloudPixelCount += (pixel[3] > 0.0f) ? 1 : 0;
+            }
+            return cloudPixelCount;
+        }
+
+        CloudscapeShaderConstantData m_shaderConstantData;
+        AZStd::vector<CloudTextureMipData> m_lowFrequencyNoise;
+        AZStd::vector<CloudTextureMipData> m_highFrequencyNoise;
+        AZStd::vector<uint8_t> m_weatherMap;
+        CloudscapeCpuRaymarcher::Textures m_textures;
+    };
+
+    TEST_F(CloudscapeCpuRaymarcherTest, GetCloudSlabIntersections_LookingUp_MarchesTheSlabThickness)
+    {
+        const CloudscapeRaymarchConstants constants = CloudscapeCpuRaymarcher::GetConstants(m_shaderConstantData, 5, 0.0f);
+        const auto view = CreateView(0.0f, AZ::Vector3::CreateAxisZ());
+
+        CloudscapeCpuRaymarcher::AtmosphereIntersectionInfo intersectionInfo;
+        ASSERT_TRUE(CloudscapeCpuRaymarcher::GetCloudSlabIntersections(constants, view, 0.5f, 0.5f, intersectionInfo));
+        EXPECT_NEAR(intersectionInfo.m_distanceFromCameraToInnerSphereKm, m_shaderConstantData.m_cloudSlabDistanceAboveSeaLevelKm, 1e-3f);
+        EXPECT_NEAR(intersectionInfo.m_rayMarchDistanceKm, m_shaderConstantData.m_cloudSlabThicknessKm, 1e-3f);
+        EXPECT_TRUE(intersectionInfo.m_rayDirection.IsClose(AZ::Vector3::CreateAxisZ()));
+
+        // Looking down, the ray hits the planet before the cloud slab.
+        const auto downView = CreateView(0.0f, -AZ::Vector3::CreateAxisZ());
+        EXPECT_FALSE(CloudscapeCpuRaymarcher::GetCloudSlabIntersections(constants, downView, 0.5f, 0.5f, intersectionInfo));
+    }
+
+    TEST_F(CloudscapeCpuRaymarcherTest, Render_SimdAndScalar_ProduceSameImage)
+    {
+        // Not a multiple of the tile size, and looking at the horizon so each ray takes a different number of steps.
+        static constexpr uint32_t Width = 37;
+        static constexpr uint32_t Height = 21;
+        const auto view = CreateView(100.0f, AZ::Vector3(1.0f, 0.0f, 0.3f).GetNormalized());
+
+        CloudscapeCpuRaymarcher::Image simdImage;
+        ASSERT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 10.0f, Width, Height, simdImage, nullptr, true));
+        CloudscapeCpuRaymarcher::Image scalarImage;
+        ASSERT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 10.0f, Width, Height, scalarImage, nullptr, false));
+
+        ASSERT_EQ(simdImage.m_width, Width);
+        ASSERT_EQ(simdImage.m_height, Height);
+        ASSERT_EQ(simdImage.m_pixels.size(), static_cast<size_t>(Width) * Height * 4);
+        ASSERT_EQ(scalarImage.m_pixels.size(), simdImage.m_pixels.size());
+        for (size_t valueIndex = 0; valueIndex < simdImage.m_pixels.size(); valueIndex++)
+        {
+            ASSERT_NEAR(simdImage.m_pixels[valueIndex], scalarImage.m_pixels[valueIndex],
+                1e-5f * AZStd::max(1.0f, std::abs(scalarImage.m_pixels[valueIndex]))) << valueIndex;
+        }
+
+        // The comparison is pointless without clouds, and below the horizon there are none.
+        EXPECT_GT(ExpectValidPixels(simdImage), (Width * Height) / 4);
+        const float* bottomRowPixel = simdImage.m_pixels.data() + (static_cast<size_t>(Height - 1) * Width) * 4;
+        EXPECT_EQ(bottomRowPixel[3], 0.0f);
+    }
+
+    TEST_F(CloudscapeCpuRaymarcherTest, Render_DenseClouds_LookingUp_IsOpaque)
+    {
+        static constexpr uint32_t Size = 8;
+        const auto view = CreateView(0.0f, AZ::Vector3::CreateAxisZ());
+        m_shaderConstantData.m_globalCloudCoverage = 1.0f;
+        m_shaderConstantData.m_globalCloudDensity = 10.0f;
+
+        CloudscapeCpuRaymarcher::Image image;
+        ASSERT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 0.0f, Size, Size, image));
+        EXPECT_EQ(ExpectValidPixels(image), Size * Size);
+        for (size_t pixelIndex = 0; pixelIndex < Size * Size; pixelIndex++)
+        {
+            // The ray marching stops once the transmittance is below 0.05.
+            EXPECT_GE(image.m_pixels[pixelIndex * 4 + 3], 0.95f) << pixelIndex;
+            EXPECT_GT(image.m_pixels[pixelIndex * 4 + 0], 0.0f) << pixelIndex;
+        }
+    }
+
+    TEST_F(CloudscapeCpuRaymarcherTest, Render_NoDensity_IsTransparent)
+    {
+        m_weatherMap = CloudscapeTestTextures::CreateWeatherMap(255, 0);
+        m_textures.m_weatherMapPixels = m_weatherMap.data();
+        const auto view = CreateView(0.0f, AZ::Vector3(0.0f, 1.0f, 1.0f).GetNormalized());
+
+        CloudscapeCpuRaymarcher::Image image;
+        ASSERT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 0.0f, 19, 19, image));
+        for (float value : image.m_pixels)
+        {
+            ASSERT_EQ(value, 0.0f);
+        }
+    }
+
+    TEST_F(CloudscapeCpuRaymarcherTest, GetConstants_HighQualityTier_MatchesTheDefaultShaderOptions)
+    {
+        // The defaults of the options in CloudscapeCS.azsl, which used to be hard coded.
+        m_shaderConstantData.m_qualityTier = static_cast<uint32_t>(CloudscapeQualityTier::High);
+        const CloudscapeRaymarchConstants constants = CloudscapeCpuRaymarcher::GetConstants(m_shaderConstantData, 5, 0.0f);
+        EXPECT_EQ(constants.m_lightSampleCount, 6u);
+        EXPECT_EQ(constants.m_maxOctaves, 3u);
+        EXPECT_EQ(constants.m_largeStepIncrement, 1);
+        EXPECT_FLOAT_EQ(constants.m_dualLobePhaseFunctionWeight, 0.75f);
+        EXPECT_TRUE(constants.m_highFrequencyDetail);
+
+        // The light samples are bounded by the cone sampling kernel.
+        for (uint32_t tier = static_cast<uint32_t>(CloudscapeQualityTier::Low); tier <= static_cast<uint32_t>(CloudscapeQualityTier::Ultra); tier++)
+        {
+            const auto qualitySettings = CloudscapeQualitySettings::Get(static_cast<CloudscapeQualityTier>(tier));
+            EXPECT_GE(qualitySettings.m_lightSampleCount, 1u) << tier;
+            EXPECT_LE(qualitySettings.m_lightSampleCount, 12u) << tier;
+            EXPECT_GE(qualitySettings.m_largeStepIncrement, 1u) << tier;
+            EXPECT_LE(qualitySettings.m_dualLobeWeightQuarters, 4u) << tier;
+        }
+    }
+
+    TEST_F(CloudscapeCpuRaymarcherTest, Render_EachQualityTier_ProducesClouds)
+    {
+        static constexpr uint32_t Width = 24;
+        static constexpr uint32_t Height = 12;
+        const auto view = CreateView(100.0f, AZ::Vector3(1.0f, 0.0f, 0.5f).GetNormalized());
+        m_shaderConstantData.m_useOpticalDepthVolume = false;
+
+        AZStd::vector<CloudscapeCpuRaymarcher::Image> images;
+        for (uint32_t tier = static_cast<uint32_t>(CloudscapeQualityTier::Low); tier <= static_cast<uint32_t>(CloudscapeQualityTier::Ultra); tier++)
+        {
+            m_shaderConstantData.m_qualityTier = tier;
+            CloudscapeCpuRaymarcher::Image image;
+            ASSERT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 10.0f, Width, Height, image));
+            EXPECT_GT(ExpectValidPixels(image), (Width * Height) / 4) << tier;
+            images.push_back(AZStd::move(image));
+        }
+
+        // Each tier is a different tradeoff, so the images are not the same.
+        for (size_t tier = 1; tier < images.size(); tier++)
+        {
+            EXPECT_NE(images[tier - 1].m_pixels, images[tier].m_pixels) << tier;
+        }
+    }
+
+    TEST_F(CloudscapeCpuRaymarcherTest, Render_MissingTexture_Fails)
+    {
+        m_textures.m_highFrequencyNoise = nullptr;
+        const auto view = CreateView(0.0f, AZ::Vector3::CreateAxisZ());
+
+        CloudscapeCpuRaymarcher::Image image;
+        AZ_TEST_START_TRACE_SUPPRESSION;
+        EXPECT_FALSE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 0.0f, 4, 4, image));
+        AZ_TEST_STOP_TRACE_SUPPRESSION(1);
+        EXPECT_TRUE(image.m_pixels.empty());
+    }
+
+    TEST_F(CloudscapeCpuRaymarcherTest, Render_SingleChannelHighFrequencyNoise_Fails)
+    {
+        // The R8 layout only has the base shape, there's no detail noise to erode the clouds with.
+        const auto r8Noise = CloudscapeTestTextures::CreateNoiseTexture(2, 1);
+        m_textures.m_highFrequencyNoise = &r8Noise;
+        m_textures.m_highFrequencyNoiseFormat = AZ::RHI::Format::R8_UNORM;
+        const auto view = CreateView(0.0f, AZ::Vector3::CreateAxisZ());
+
+        CloudscapeCpuRaymarcher::Image image;
+        AZ_TEST_START_TRACE_SUPPRESSION;
+        EXPECT_FALSE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 0.0f, 4, 4, image));
+        AZ_TEST_STOP_TRACE_SUPPRESSION(1);
+
+        // It's fine as the low frequency noise.
+        m_textures.m_highFrequencyNoise = &m_highFrequencyNoise;
+        m_textures.m_highFrequencyNoiseFormat = AZ::RHI::Format::R8G8B8A8_UNORM;
+        m_textures.m_lowFrequencyNoise = &r8Noise;
+        m_textures.m_lowFrequencyNoiseFormat = AZ::RHI::Format::R8_UNORM;
+        EXPECT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, m_textures, view, 0.0f, 4, 4, image));
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,268 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/Math/Vector3.h>
+#include <AzCore/Math/Vector4.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <cmath>
+
+#include <CloudscapeTestTextures.h>
+#include <Renderer/CloudscapeShaderConstantData.h>
+#include <Renderer/Cpu/CloudscapeCpuRaymarcher.h>
+#include <Renderer/Cpu/CloudscapeOpticalDepthVolume.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudscapeOpticalDepthVolumeTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static constexpr uint32_t NoiseSize = CloudscapeTestTextures::NoiseSize;
+        static constexpr uint32_t WeatherMapSize = CloudscapeTestTextures::WeatherMapSize;
+        static constexpr float VolumeSizeKm = 48.0f;
+
+        void SetUp() override
+        {
+            LeakDetectionFixture::SetUp();
+            m_lowFrequencyNoise = CloudscapeTestTextures::CreateNoiseTexture(1);
+            m_highFrequencyNoise = CloudscapeTestTextures::CreateNoiseTexture(2);
+            m_weatherMap = CloudscapeTestTextures::CreateWeatherMap(255, 255);
+
+            m_shaderConstantData.m_globalCloudCoverage = 1.0f;
+            m_shaderConstantData.m_cloudTopOffsetKm = 0.5f;
+            m_shaderConstantData.m_directionTowardsTheSun = AZ::Vector3(0.3f, 0.2f, 0.9f).GetNormalized();
+            InitializeSamplers();
+        }
+
+        void TearDown() override
+        {
+            m_samplers = {};
+            m_lowFrequencyNoise = {};
+            m_highFrequencyNoise = {};
+            m_weatherMap = {};
+            LeakDetectionFixture::TearDown();
+        }
+
+        void InitializeSamplers()
+        {
+            ASSERT_TRUE(m_samplers.m_lowFreqNoise.Initialize(&m_lowFrequencyNoise, AZ::RHI::Format::R8G8B8A8_UNORM));
+            ASSERT_TRUE(m_samplers.m_highFreqNoise.Initialize(&m_highFrequencyNoise, AZ::RHI::Format::R8G8B8A8_UNORM));
+            ASSERT_TRUE(m_samplers.m_weatherMap.Initialize(m_weatherMap.data(), WeatherMapSize, WeatherMapSize));
+            m_constants = CloudscapeCpuRaymarcher::GetConstants(m_shaderConstantData, m_samplers.m_lowFreqNoise.GetMipCount(), 0.0f);
+        }
+
+        // Scalar brute force version of the light march of a single voxel, with AZ::Vector3 instead of the SIMD kernels.
+        float GetReferenceOpticalDepth(uint32_t x, uint32_t y, uint32_t z) const
+        {
+            using Kernels = CloudscapeRaymarchKernels<AZ::Simd::Vec1>;
+            float voxelPosition[3];
+            CloudscapeOpticalDepthVolume::GetVoxelPositionKm(m_constants, 0.0f, 0.0f, VolumeSizeKm, x, y, z, voxelPosition);
+            const AZ::Vector3 voxelPosKm = AZ::Vector3::CreateFromFloat3(voxelPosition);
+            const AZ::Vector3 sunDirection = AZ::Vector3::CreateFromFloat3(m_constants.m_directionTowardsTheSun);
+
+            // Walk towards the sun, in small steps, until the light ray leaves the cloud slab.
+            const float innerSphereRadiusKm = m_constants.m_planetRadiusKm + m_constants.m_cloudSlabDistanceAboveSeaLevelKm;
+            const float outerSphereRadiusKm = innerSphereRadiusKm + m_constants.m_cloudSlabThicknessKm;
+            float distanceToOuterSphereKm = 0.0f;
+            while ((voxelPosKm + sunDirection * distanceToOuterSphereKm).GetLength() < outerSphereRadiusKm)
+            {
+                distanceToOuterSphereKm += 0.001f;
+            }
+            const float lightMarchDistanceKm = AZStd::min(distanceToOuterSphereKm,
+                m_constants.m_cloudSlabThicknessKm * CloudscapeOpticalDepthVolume::MaxLightMarchDistanceFactor);
+            const float stepSizeKm = lightMarchDistanceKm / CloudscapeOpticalDepthVolume::LightMarchSteps;
+            const float mipLevel = CloudscapeOpticalDepthVolume::GetMipLevel(m_constants, NoiseSize, VolumeSizeKm);
+
+            float opticalDepth = 0.0f;
+            for (uint32_t stepIdx = 0; stepIdx < CloudscapeOpticalDepthVolume::LightMarchSteps; stepIdx++)
+            {
+                const AZ::Vector3 samplePosKm = voxelPosKm + sunDirection * ((stepIdx + 0.5f) * stepSizeKm);
+                const float heightFraction = (samplePosKm.GetLength() - innerSphereRadiusKm) / m_constants.m_cloudSlabThicknessKm;
+                if ((heightFraction < 0.0f) || (heightFraction > 1.0f))
+                {
+                    continue;
+                }
+                const bool sampleLanes[1] = { true };
+                const bool noHighFreqNoise[1] = { false };
+                const Kernels::Float3 position = {
+                    AZ::Simd::Vec1::Splat(samplePosKm.GetX()), AZ::Simd::Vec1::Splat(samplePosKm.GetY()), AZ::Simd::Vec1::Splat(samplePosKm.GetZ()) };
+                const auto density = Kernels::SampleCloudDensity(m_constants, m_samplers, position, AZ::Simd::Vec1::Splat(m_constants.m_uvwScale),
+                    AZ::Simd::Vec1::Splat(mipLevel), AZ::Simd::Vec1::Splat(heightFraction), sampleLanes, noHighFreqNoise);
+                float densityValue;
+                AZ::Simd::Vec1::StoreAligned(&densityValue, density);
+                opticalDepth += AZStd::max(densityValue, 0.0f) * stepSizeKm;
+            }
+            return opticalDepth * (m_constants.m_aCoef + m_constants.m_sCoef);
+        }
+
+        float GetSliceAverage(const CloudscapeOpticalDepthVolume& volume, uint32_t z) const
+        {
+            float sum = 0.0f;
+            for (uint32_t y = 0; y < CloudscapeOpticalDepthVolume::Height; y++)
+            {
+                for (uint32_t x = 0; x < CloudscapeOpticalDepthVolume::Width; x++)
+                {
+                    sum += volume.GetVoxel(x, y, z);
+                }
+            }
+            return sum / static_cast<float>(CloudscapeOpticalDepthVolume::Width * CloudscapeOpticalDepthVolume::Height);
+        }
+
+        CloudscapeShaderConstantData m_shaderConstantData;
+        AZStd::vector<CloudTextureMipData> m_lowFrequencyNoise;
+        AZStd::vector<CloudTextureMipData> m_highFrequencyNoise;
+        AZStd::vector<uint8_t> m_weatherMap;
+        CloudscapeRaymarchTextures m_samplers;
+        CloudscapeRaymarchConstants m_constants;
+    };
+
+    TEST_F(CloudscapeOpticalDepthVolumeTest, GetOriginKm_SnapsToTheVoxelSize)
+    {
+        const float voxelSizeKm = VolumeSizeKm / CloudscapeOpticalDepthVolume::Width;
+        float originXKm, originYKm;
+        CloudscapeOpticalDepthVolume::GetOriginKm(1000.0f, -2000.0f, VolumeSizeKm, originXKm, originYKm);
+        EXPECT_NEAR(originXKm, 1.0f, voxelSizeKm * 0.5f);
+        EXPECT_NEAR(originYKm, -2.0f, voxelSizeKm * 0.5f);
+
+        // The origin doesn't move while the camera moves within the same voxel.
+        float movedOriginXKm, movedOriginYKm;
+        CloudscapeOpticalDepthVolume::GetOriginKm(1000.0f + voxelSizeKm * 100.0f, -2000.0f - voxelSizeKm * 100.0f,
+            VolumeSizeKm, movedOriginXKm, movedOriginYKm);
+        EXPECT_FLOAT_EQ(movedOriginXKm, originXKm);
+        EXPECT_FLOAT_EQ(movedOriginYKm, originYKm);
+
+        // And moves by exactly one voxel when the camera moves one voxel.
+        CloudscapeOpticalDepthVolume::GetOriginKm(1000.0f + voxelSizeKm * 1000.0f, -2000.0f, VolumeSizeKm, movedOriginXKm, movedOriginYKm);
+        EXPECT_NEAR(movedOriginXKm - originXKm, voxelSizeKm, 1e-4f);
+    }
+
+    TEST_F(CloudscapeOpticalDepthVolumeTest, GetUVW_AtVoxelCenters_SamplesTheVoxel)
+    {
+        CloudscapeOpticalDepthVolume volume;
+        volume.Build(m_constants, m_samplers, 0.0f, 0.0f, VolumeSizeKm);
+        ASSERT_TRUE(volume.IsValid());
+
+        const uint32_t voxels[][3] = { { 0, 0, 0 }, { 5, 77, 13 }, { 127, 64, 31 }, { 64, 127, 1 } };
+        for (const auto& voxel : voxels)
+        {
+            float positionKm[3];
+            CloudscapeOpticalDepthVolume::GetVoxelPositionKm(m_constants, 0.0f, 0.0f, VolumeSizeKm, voxel[0], voxel[1], voxel[2], positionKm);
+            const float innerSphereRadiusKm = m_constants.m_planetRadiusKm + m_constants.m_cloudSlabDistanceAboveSeaLevelKm;
+            const float heightFraction = (AZ::Vector3::CreateFromFloat3(positionKm).GetLength() - innerSphereRadiusKm)
+                / m_constants.m_cloudSlabThicknessKm;
+
+            float uvw[3];
+            ASSERT_TRUE(volume.GetUVW(positionKm, heightFraction, uvw));
+            EXPECT_NEAR(uvw[0], (voxel[0] + 0.5f) / CloudscapeOpticalDepthVolume::Width, 1e-4f);
+            EXPECT_NEAR(uvw[1], (voxel[1] + 0.5f) / CloudscapeOpticalDepthVolume::Height, 1e-4f);
+            EXPECT_NEAR(uvw[2], (voxel[2] + 0.5f) / CloudscapeOpticalDepthVolume::Depth, 1e-3f);
+            const float voxelValue = volume.GetVoxel(voxel[0], voxel[1], voxel[2]);
+            EXPECT_NEAR(volume.Sample(uvw), voxelValue, 0.05f * AZStd::max(1.0f, voxelValue));
+        }
+
+        // Outside the footprint the cone sampling is used.
+        const float outsidePositionKm[3] = { VolumeSizeKm, 0.0f, m_constants.m_planetRadiusKm + 2.0f };
+        float uvw[3];
+        EXPECT_FALSE(volume.GetUVW(outsidePositionKm, 0.5f, uvw));
+    }
+
+    TEST_F(CloudscapeOpticalDepthVolumeTest, Build_MatchesScalarReference)
+    {
+        CloudscapeOpticalDepthVolume volume;
+        volume.Build(m_constants, m_samplers, 0.0f, 0.0f, VolumeSizeKm);
+
+        const uint32_t voxels[][3] = { { 0, 0, 0 }, { 3, 9, 4 }, { 66, 21, 15 }, { 127, 127, 31 }, { 90, 45, 27 } };
+        float opticalDepthSum = 0.0f;
+        for (const auto& voxel : voxels)
+        {
+            const float expected = GetReferenceOpticalDepth(voxel[0], voxel[1], voxel[2]);
+            const float actual = volume.GetVoxel(voxel[0], voxel[1], voxel[2]);
+            // The reference finds the top of the cloud slab in 1m increments.
+            EXPECT_NEAR(actual, expected, 0.01f * AZStd::max(1.0f, expected)) << voxel[0] << ", " << voxel[1] << ", " << voxel[2];
+            opticalDepthSum += actual;
+        }
+        // The comparison is pointless without clouds.
+        EXPECT_GT(opticalDepthSum, 0.0f);
+    }
+
+    TEST_F(CloudscapeOpticalDepthVolumeTest, Build_NoDensity_IsZero)
+    {
+        m_weatherMap = CloudscapeTestTextures::CreateWeatherMap(255, 0);
+        InitializeSamplers();
+
+        CloudscapeOpticalDepthVolume volume;
+        volume.Build(m_constants, m_samplers, 0.0f, 0.0f, VolumeSizeKm);
+        for (uint32_t z = 0; z < CloudscapeOpticalDepthVolume::Depth; z++)
+        {
+            EXPECT_EQ(GetSliceAverage(volume, z), 0.0f) << z;
+        }
+    }
+
+    TEST_F(CloudscapeOpticalDepthVolumeTest, Build_SunStraightUp_DecreasesWithHeight)
+    {
+        m_shaderConstantData.m_directionTowardsTheSun = AZ::Vector3::CreateAxisZ();
+        InitializeSamplers();
+
+        CloudscapeOpticalDepthVolume volume;
+        volume.Build(m_constants, m_samplers, 0.0f, 0.0f, VolumeSizeKm);
+
+        // The light rays of the higher voxels cross less cloud.
+        const float bottom = GetSliceAverage(volume, 0);
+        const float middle = GetSliceAverage(volume, CloudscapeOpticalDepthVolume::Depth / 2);
+        const float top = GetSliceAverage(volume, CloudscapeOpticalDepthVolume::Depth - 1);
+        EXPECT_GT(bottom, middle);
+        EXPECT_GT(middle, top);
+        EXPECT_GE(top, 0.0f);
+    }
+
+    TEST_F(CloudscapeOpticalDepthVolumeTest, Render_WithAndWithoutVolume_HaveTheSameAlpha)
+    {
+        // The optical depth towards the sun only changes the light that reaches the clouds, not their opacity.
+        static constexpr uint32_t Width = 20;
+        static constexpr uint32_t Height = 12;
+        CloudscapeCpuRaymarcher::Textures textures;
+        textures.m_lowFrequencyNoise = &m_lowFrequencyNoise;
+        textures.m_highFrequencyNoise = &m_highFrequencyNoise;
+        textures.m_weatherMapPixels = m_weatherMap.data();
+        textures.m_weatherMapWidth = WeatherMapSize;
+        textures.m_weatherMapHeight = WeatherMapSize;
+
+        CloudscapeCpuRaymarcher::View view;
+        view.m_worldPosition = AZ::Vector3(0.0f, 0.0f, 100.0f);
+        // Looking straight up, see CloudscapeCpuRaymarcherTest.
+        view.m_viewProjectionInverse = AZ::Matrix4x4::CreateFromColumns(
+            AZ::Vector4(1.0f, 0.0f, 0.0f, 0.0f), AZ::Vector4(0.0f, 1.0f, 0.0f, 0.0f),
+            AZ::Vector4(0.0f, 0.0f, 1.0f, 0.0f), AZ::Vector4::CreateFromVector3AndFloat(view.m_worldPosition, 1.0f));
+
+        m_shaderConstantData.m_useOpticalDepthVolume = true;
+        CloudscapeCpuRaymarcher::Image volumeImage;
+        ASSERT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, textures, view, 0.0f, Width, Height, volumeImage));
+        m_shaderConstantData.m_useOpticalDepthVolume = false;
+        CloudscapeCpuRaymarcher::Image coneImage;
+        ASSERT_TRUE(CloudscapeCpuRaymarcher::Render(m_shaderConstantData, textures, view, 0.0f, Width, Height, coneImage));
+
+        uint32_t cloudPixelCount = 0;
+        for (size_t pixelIndex = 0; pixelIndex < static_cast<size_t>(Width) * Height; pixelIndex++)
+        {
+            EXPECT_FLOAT_EQ(volumeImage.m_pixels[pixelIndex * 4 + 3], coneImage.m_pixels[pixelIndex * 4 + 3]) << pixelIndex;
+            for (uint32_t channel = 0; channel < 3; channel++)
+            {
+                EXPECT_TRUE(std::isfinite(volumeImage.m_pixels[pixelIndex * 4 + channel])) << pixelIndex;
+                EXPECT_GE(volumeImage.m_pixels[pixelIndex * 4 + channel], 0.0f) << pixelIndex;
+            }
+            cloudPixelCount += (volumeImage.m_pixels[pixelIndex * 4 + 3] > 0.0f) ? 1 : 0;
+        }
+        EXPECT_GT(cloudPixelCount, 0u);
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,116 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/Cpu/CloudscapeRaymarchTiles.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudscapeRaymarchTilesTest
+        : public LeakDetectionFixture
+    {
+    };
+
+    TEST_F(CloudscapeRaymarchTilesTest, GetTileCount_CoversEveryBlock)
+    {
+        // 1280 pixels in 4x4 blocks are 320 blocks, 40 tiles.
+        EXPECT_EQ(CloudscapeRaymarchTiles::GetTileCount(1280, 4), 40u);
+        // 720 pixels in 4x4 blocks are 180 blocks, 22.5 tiles.
+        EXPECT_EQ(CloudscapeRaymarchTiles::GetTileCount(720, 4), 23u);
+        // 1000 pixels in 3x3 blocks are 333.3 blocks, 41.7 tiles.
+        EXPECT_EQ(CloudscapeRaymarchTiles::GetTileCount(1000, 3), 42u);
+        EXPECT_EQ(CloudscapeRaymarchTiles::GetTileCount(1, 8), 1u);
+        EXPECT_EQ(CloudscapeRaymarchTiles::GetTileCount(0, 4), 0u);
+
+        for (uint32_t blockSize : { 1u, 2u, 3u, 4u, 8u })
+        {
+            for (uint32_t outputSize : { 1u, 7u, 64u, 719u, 1080u, 2161u })
+            {
+                const uint32_t tileCount = CloudscapeRaymarchTiles::GetTileCount(outputSize, blockSize);
+                const uint32_t tilePixels = CloudscapeRaymarchTiles::TileSize * blockSize;
+                // The last pixel is in the last tile.
+                EXPECT_EQ((outputSize - 1) / tilePixels, tileCount - 1) << outputSize << " " << blockSize;
+            }
+        }
+    }
+
+    TEST_F(CloudscapeRaymarchTilesTest, PackTileLocation_RoundTrips)
+    {
+        for (uint32_t tileY : { 0u, 1u, 255u, 65535u })
+        {
+            for (uint32_t tileX : { 0u, 3u, 1024u, 65535u })
+            {
+                uint32_t x = 0, y = 0;
+                CloudscapeRaymarchTiles::UnpackTileLocation(CloudscapeRaymarchTiles::PackTileLocation(tileX, tileY), x, y);
+                EXPECT_EQ(x, tileX);
+                EXPECT_EQ(y, tileY);
+            }
+        }
+    }
+
+    TEST_F(CloudscapeRaymarchTilesTest, TileBounds_NoRayReachesTheSlab_IsNotLive)
+    {
+        CloudscapeRaymarchTiles::TileBounds tileBounds;
+        EXPECT_FALSE(tileBounds.IsLive(false));
+
+        // Below the horizon, the distances are ignored.
+        tileBounds.AddPixel(false, 1.0f, CloudscapeRaymarchTiles::SkyDistanceKm, false);
+        tileBounds.AddPixel(false, 2.0f, 0.1f, true);
+        EXPECT_FALSE(tileBounds.IsLive(false));
+        EXPECT_FALSE(tileBounds.IsLive(true));
+    }
+
+    TEST_F(CloudscapeRaymarchTilesTest, TileBounds_SkyPixel_IsLive)
+    {
+        CloudscapeRaymarchTiles::TileBounds tileBounds;
+        tileBounds.AddPixel(false, 0.0f, 0.0f, true);
+        tileBounds.AddPixel(true, 1.5f, CloudscapeRaymarchTiles::SkyDistanceKm, false);
+        EXPECT_TRUE(tileBounds.IsLive(false));
+        EXPECT_TRUE(tileBounds.IsLive(true));
+    }
+
+    TEST_F(CloudscapeRaymarchTilesTest, TileBounds_OccludedTile_IsCulledOnlyWhenRequested)
+    {
+        // A wall 50 meters away hides the slab, which starts 1.5Km away.
+        CloudscapeRaymarchTiles::TileBounds tileBounds;
+        tileBounds.AddPixel(true, 1.5f, 0.05f, true);
+        tileBounds.AddPixel(true, 1.6f, 0.06f, true);
+        tileBounds.AddPixel(true, 2.0f, 1.5f, true);
+        EXPECT_FLOAT_EQ(tileBounds.m_minDistanceToSlabKm, 1.5f);
+        EXPECT_FLOAT_EQ(tileBounds.m_maxDistanceToGeometryKm, 1.5f);
+        EXPECT_TRUE(tileBounds.IsLive(false));
+        EXPECT_FALSE(tileBounds.IsLive(true));
+
+        // A mountain beyond the slab entry of one of the rays. The bounds are conservative, the tile is live.
+        tileBounds.AddPixel(true, 1.7f, 3.0f, true);
+        EXPECT_TRUE(tileBounds.IsLive(true));
+    }
+
+    TEST_F(CloudscapeRaymarchTilesTest, TileBounds_OccludedOnlyInThisFrame_IsLive)
+    {
+        // The wall moved in front of the slab this frame. The tile is still ray marched,
+        // otherwise its pixels would be reprojected as empty sky when the wall moves away.
+        CloudscapeRaymarchTiles::TileBounds tileBounds;
+        tileBounds.AddPixel(true, 1.5f, 0.05f, true);
+        EXPECT_FALSE(tileBounds.IsLive(true));
+        tileBounds.AddPixel(true, 1.6f, 0.06f, false);
+        EXPECT_TRUE(tileBounds.m_anyRayWasVisible);
+        EXPECT_TRUE(tileBounds.IsLive(true));
+
+        // The pixels that don't reach the slab are ignored.
+        CloudscapeRaymarchTiles::TileBounds belowHorizonBounds;
+        belowHorizonBounds.AddPixel(true, 1.5f, 0.05f, true);
+        belowHorizonBounds.AddPixel(false, 1.5f, 0.05f, false);
+        EXPECT_FALSE(belowHorizonBounds.m_anyRayWasVisible);
+        EXPECT_FALSE(belowHorizonBounds.IsLive(true));
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,159 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/Math/MathUtils.h>
+#include <AzCore/std/algorithm.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/Cpu/CloudscapeTemporalAccumulation.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudscapeTemporalAccumulationTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static constexpr float Tolerance = 1.0e-5f;
+
+        static void ExpectClose(const AZ::Vector4& a, const AZ::Vector4& b, float tolerance = Tolerance)
+        {
+            EXPECT_NEAR(a.GetX(), b.GetX(), tolerance);
+            EXPECT_NEAR(a.GetY(), b.GetY(), tolerance);
+            EXPECT_NEAR(a.GetZ(), b.GetZ(), tolerance);
+            EXPECT_NEAR(a.GetW(), b.GetW(), tolerance);
+        }
+
+        // Same as storing the confidence in the 8 bits history confidence attachments.
+        static float QuantizeConfidence(float confidence)
+        {
+            return std::floor(confidence * 255.0f + 0.5f) / 255.0f;
+        }
+    };
+
+    TEST_F(CloudscapeTemporalAccumulationTest, RgbaToYCoCgA_RoundTrip)
+    {
+        for (const AZ::Vector4& rgba : { AZ::Vector4(0.0f, 0.0f, 0.0f, 0.0f), AZ::Vector4(1.0f, 1.0f, 1.0f, 1.0f),
+                 AZ::Vector4(0.9f, 0.2f, 0.4f, 0.5f), AZ::Vector4(0.1f, 0.7f, 0.3f, 0.25f) })
+        {
+            ExpectClose(CloudscapeTemporalAccumulation::YCoCgAToRgba(CloudscapeTemporalAccumulation::RgbaToYCoCgA(rgba)), rgba);
+        }
+
+        // Grays have no chroma.
+        ExpectClose(CloudscapeTemporalAccumulation::RgbaToYCoCgA(AZ::Vector4(0.6f, 0.6f, 0.6f, 0.3f)), AZ::Vector4(0.6f, 0.0f, 0.0f, 0.3f));
+    }
+
+    TEST_F(CloudscapeTemporalAccumulationTest, GetHistorySampleCount_SurvivesQuantization)
+    {
+        for (uint32_t sampleCount = 0; sampleCount <= CloudscapeTemporalAccumulation::MaxHistorySamples; sampleCount++)
+        {
+            const float confidence = static_cast<float>(sampleCount) / CloudscapeTemporalAccumulation::MaxHistorySamples;
+            EXPECT_EQ(CloudscapeTemporalAccumulation::GetHistorySampleCount(QuantizeConfidence(confidence)), sampleCount);
+        }
+    }
+
+    TEST_F(CloudscapeTemporalAccumulationTest, GetBlendWeight_AveragesTheFirstSamples)
+    {
+        const float blendFactor = 0.1f;
+        EXPECT_FLOAT_EQ(CloudscapeTemporalAccumulation::GetBlendWeight(0.0f, blendFactor), 1.0f);
+        for (uint32_t sampleCount = 1; sampleCount <= CloudscapeTemporalAccumulation::MaxHistorySamples; sampleCount++)
+        {
+            const float confidence = static_cast<float>(sampleCount) / CloudscapeTemporalAccumulation::MaxHistorySamples;
+            const float expectedWeight = AZStd::max(blendFactor, 1.0f / (sampleCount + 1));
+            EXPECT_FLOAT_EQ(CloudscapeTemporalAccumulation::GetBlendWeight(confidence, blendFactor), expectedWeight) << sampleCount;
+            // No accumulation.
+            EXPECT_FLOAT_EQ(CloudscapeTemporalAccumulation::GetBlendWeight(confidence, 1.0f), 1.0f) << sampleCount;
+        }
+    }
+
+    TEST_F(CloudscapeTemporalAccumulationTest, ResolveReprojectedPixel_HistoryInsideTheBox_IsKept)
+    {
+        CloudscapeTemporalAccumulation::NeighborhoodBox box;
+        box.AddSample(AZ::Vector4(0.2f, 0.2f, 0.2f, 0.2f));
+        box.AddSample(AZ::Vector4(0.8f, 0.8f, 0.8f, 0.8f));
+        const CloudscapeTemporalAccumulation::Pixel history = { AZ::Vector4(0.5f, 0.5f, 0.5f, 0.6f), 0.5f };
+
+        const auto result = CloudscapeTemporalAccumulation::ResolveReprojectedPixel(box, true, history, AZ::Vector4(1.0f, 0.0f, 0.0f, 1.0f));
+        ExpectClose(result.m_rgba, history.m_rgba);
+        EXPECT_FLOAT_EQ(result.m_confidence, history.m_confidence);
+    }
+
+    TEST_F(CloudscapeTemporalAccumulationTest, ResolveReprojectedPixel_HistoryOutsideTheBox_IsClampedAndRejected)
+    {
+        CloudscapeTemporalAccumulation::NeighborhoodBox box;
+        box.AddSample(AZ::Vector4(0.0f, 0.0f, 0.0f, 0.0f));
+        box.AddSample(AZ::Vector4(0.1f, 0.1f, 0.1f, 0.1f));
+
+        // A bit outside of the box, the history is clamped and its confidence reduced.
+        const CloudscapeTemporalAccumulation::Pixel nearHistory = { AZ::Vector4(0.15f, 0.15f, 0.15f, 0.15f), 1.0f };
+        const auto nearResult = CloudscapeTemporalAccumulation::ResolveReprojectedPixel(box, true, nearHistory, AZ::Vector4::CreateZero());
+        ExpectClose(nearResult.m_rgba, AZ::Vector4(0.1f, 0.1f, 0.1f, 0.1f));
+        EXPECT_GT(nearResult.m_confidence, 0.0f);
+        EXPECT_LT(nearResult.m_confidence, 1.0f);
+
+        // A cloud that is gone, e.g. moved by the wind. The history is discarded.
+        const CloudscapeTemporalAccumulation::Pixel farHistory = { AZ::Vector4(0.9f, 0.9f, 0.9f, 1.0f), 1.0f };
+        const auto farResult = CloudscapeTemporalAccumulation::ResolveReprojectedPixel(box, true, farHistory, AZ::Vector4::CreateZero());
+        ExpectClose(farResult.m_rgba, AZ::Vector4(0.1f, 0.1f, 0.1f, 0.1f));
+        EXPECT_FLOAT_EQ(farResult.m_confidence, 0.0f);
+
+        // Disoccluded, or out of the previous view.
+        const AZ::Vector4 fallback(0.05f, 0.05f, 0.05f, 0.05f);
+        const auto noHistoryResult = CloudscapeTemporalAccumulation::ResolveReprojectedPixel(box, false, nearHistory, fallback);
+        ExpectClose(noHistoryResult.m_rgba, fallback);
+        EXPECT_FLOAT_EQ(noHistoryResult.m_confidence, 0.0f);
+    }
+
+    TEST_F(CloudscapeTemporalAccumulationTest, ResolveRayMarchedPixel_JitterNoise_ConvergesToTheMean)
+    {
+        // A static cloud ray marched with a jittered start. Each fresh sample is the mean plus noise, and
+        // the neighbor pixels see the same noise, so the box always spans it.
+        const AZ::Vector4 mean(0.4f, 0.42f, 0.45f, 0.6f);
+        const float noise[] = { 0.1f, -0.07f, 0.03f, -0.1f, 0.06f, -0.02f, 0.08f, -0.08f };
+        const float blendFactor = 0.1f;
+
+        CloudscapeTemporalAccumulation::Pixel pixel;
+        bool hasHistory = false;
+        for (uint32_t frame = 0; frame < 256; frame++)
+        {
+            const float frameNoise = noise[frame % AZ_ARRAY_SIZE(noise)];
+            const AZ::Vector4 fresh = mean + AZ::Vector4(frameNoise);
+            CloudscapeTemporalAccumulation::NeighborhoodBox box;
+            box.AddSample(fresh);
+            box.AddSample(mean - AZ::Vector4(frameNoise));
+            pixel = CloudscapeTemporalAccumulation::ResolveRayMarchedPixel(fresh, box, hasHistory, pixel, blendFactor);
+            pixel.m_confidence = QuantizeConfidence(pixel.m_confidence);
+            hasHistory = true;
+        }
+
+        // The noise of a single sample is up to 0.1.
+        ExpectClose(pixel.m_rgba, mean, 0.02f);
+        EXPECT_FLOAT_EQ(pixel.m_confidence, 1.0f);
+    }
+
+    TEST_F(CloudscapeTemporalAccumulationTest, ResolveRayMarchedPixel_WithoutHistory_IsTheFreshPixel)
+    {
+        const AZ::Vector4 fresh(0.3f, 0.2f, 0.1f, 0.5f);
+        CloudscapeTemporalAccumulation::NeighborhoodBox box;
+        box.AddSample(fresh);
+        const CloudscapeTemporalAccumulation::Pixel history = { AZ::Vector4(1.0f, 1.0f, 1.0f, 1.0f), 1.0f };
+
+        const auto result = CloudscapeTemporalAccumulation::ResolveRayMarchedPixel(fresh, box, false, history, 0.1f);
+        ExpectClose(result.m_rgba, fresh);
+        EXPECT_EQ(CloudscapeTemporalAccumulation::GetHistorySampleCount(result.m_confidence), 1u);
+
+        // The second sample is averaged evenly with the first one.
+        const AZ::Vector4 secondFresh(0.5f, 0.4f, 0.3f, 0.7f);
+        box.AddSample(secondFresh);
+        const auto secondResult = CloudscapeTemporalAccumulation::ResolveRayMarchedPixel(secondFresh, box, true, result, 0.1f);
+        ExpectClose(secondResult.m_rgba, (fresh + secondFresh) * 0.5f);
+        EXPECT_EQ(CloudscapeTemporalAccumulation::GetHistorySampleCount(secondResult.m_confidence), 2u);
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,124 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/Cpu/CloudscapeUpdatePattern.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudscapeUpdatePatternTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        // Same as CloudscapeUpdateBlockSize.
+        static constexpr uint32_t BlockSizes[] = { 1, 2, 3, 4, 8 };
+
+        // Squared distance between two pixels of a block, wrapping around the borders.
+        static uint32_t GetWrappedDistanceSq(uint32_t ax, uint32_t ay, uint32_t bx, uint32_t by, uint32_t blockSize)
+        {
+            uint32_t dx = (ax > bx) ? (ax - bx) : (bx - ax);
+            uint32_t dy = (ay > by) ? (ay - by) : (by - ay);
+            dx = AZStd::min(dx, blockSize - dx);
+            dy = AZStd::min(dy, blockSize - dy);
+            return dx * dx + dy * dy;
+        }
+    };
+
+    TEST_F(CloudscapeUpdatePatternTest, Generate_InvalidBlockSize_KeepsThePattern)
+    {
+        CloudscapeUpdatePattern updatePattern;
+        ASSERT_TRUE(updatePattern.Generate(4));
+        const auto ordering = updatePattern.GetOrdering();
+        for (uint32_t blockSize : { 0u, 5u, 6u, 7u, 9u, 16u })
+        {
+            EXPECT_FALSE(CloudscapeUpdatePattern::IsValidBlockSize(blockSize)) << blockSize;
+            EXPECT_FALSE(updatePattern.Generate(blockSize)) << blockSize;
+        }
+        EXPECT_EQ(updatePattern.GetBlockSize(), 4u);
+        EXPECT_EQ(updatePattern.GetOrdering(), ordering);
+    }
+
+    TEST_F(CloudscapeUpdatePatternTest, GetPixelOffset_EachCycle_VisitsEveryPixelOnce)
+    {
+        for (uint32_t blockSize : BlockSizes)
+        {
+            CloudscapeUpdatePattern updatePattern;
+            ASSERT_TRUE(updatePattern.Generate(blockSize)) << blockSize;
+            ASSERT_EQ(updatePattern.GetBlockSize(), blockSize);
+            const uint32_t cycleLength = updatePattern.GetCycleLength();
+            ASSERT_EQ(cycleLength, blockSize * blockSize);
+
+            // A few cycles, starting at frame counters that are not a multiple of the cycle length.
+            for (uint32_t firstFrame : { 0u, 1u, cycleLength * 3 + 2, 1000003u })
+            {
+                AZStd::vector<uint32_t> visitCounts(cycleLength, 0);
+                for (uint32_t frame = 0; frame < cycleLength; frame++)
+                {
+                    uint32_t offsetX = blockSize;
+                    uint32_t offsetY = blockSize;
+                    updatePattern.GetPixelOffset(firstFrame + frame, offsetX, offsetY);
+                    ASSERT_LT(offsetX, blockSize);
+                    ASSERT_LT(offsetY, blockSize);
+                    visitCounts[offsetY * blockSize + offsetX]++;
+                }
+                for (uint32_t pixel = 0; pixel < cycleLength; pixel++)
+                {
+                    EXPECT_EQ(visitCounts[pixel], 1u) << "Block size " << blockSize << ", first frame " << firstFrame << ", pixel " << pixel;
+                }
+            }
+        }
+    }
+
+    TEST_F(CloudscapeUpdatePatternTest, GetOrdering_IsLowDiscrepancy)
+    {
+        for (uint32_t blockSize : BlockSizes)
+        {
+            CloudscapeUpdatePattern updatePattern;
+            ASSERT_TRUE(updatePattern.Generate(blockSize));
+            const auto& ordering = updatePattern.GetOrdering();
+            EXPECT_EQ(ordering[0], 0u);
+
+            // Each new pixel is at least as far from the pixels visited before it, as any pixel
+            // visited later in the cycle. So the distance between visited pixels never grows.
+            uint32_t previousMinDistanceSq = blockSize * blockSize * 2;
+            for (size_t frame = 1; frame < ordering.size(); frame++)
+            {
+                uint32_t minDistanceSq = blockSize * blockSize * 2;
+                for (size_t previousFrame = 0; previousFrame < frame; previousFrame++)
+                {
+                    minDistanceSq = AZStd::min(minDistanceSq, GetWrappedDistanceSq(ordering[frame] % blockSize, ordering[frame] / blockSize,
+                        ordering[previousFrame] % blockSize, ordering[previousFrame] / blockSize, blockSize));
+                }
+                EXPECT_LE(minDistanceSq, previousMinDistanceSq) << "Block size " << blockSize << ", frame " << frame;
+                previousMinDistanceSq = minDistanceSq;
+            }
+        }
+
+        // For power of two sizes, the first 4 frames cover the pixels of a lattice
+        // with half the block size as spacing.
+        for (uint32_t blockSize : { 2u, 4u, 8u })
+        {
+            CloudscapeUpdatePattern updatePattern;
+            ASSERT_TRUE(updatePattern.Generate(blockSize));
+            const uint32_t halfBlockSize = blockSize / 2;
+            for (uint32_t frame = 0; frame < 4; frame++)
+            {
+                uint32_t offsetX, offsetY;
+                updatePattern.GetPixelOffset(frame, offsetX, offsetY);
+                EXPECT_EQ(offsetX % halfBlockSize, 0u) << "Block size " << blockSize << ", frame " << frame;
+                EXPECT_EQ(offsetY % halfBlockSize, 0u) << "Block size " << blockSize << ", frame " << frame;
+            }
+        }
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,188 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <Renderer/Cpu/CloudscapeUpsampleFilter.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class CloudscapeUpsampleFilterTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static constexpr float SkyDistance = 1.0e6f;
+
+        static float GetWeightSum(const float weights[4])
+        {
+            return weights[0] + weights[1] + weights[2] + weights[3];
+        }
+    };
+
+    TEST_F(CloudscapeUpsampleFilterTest, GetReducedSize_RoundsUp)
+    {
+        EXPECT_EQ(CloudscapeUpsampleFilter::GetReducedSize(3840, 1), 3840u);
+        EXPECT_EQ(CloudscapeUpsampleFilter::GetReducedSize(3840, 2), 1920u);
+        EXPECT_EQ(CloudscapeUpsampleFilter::GetReducedSize(2160, 4), 540u);
+        EXPECT_EQ(CloudscapeUpsampleFilter::GetReducedSize(1081, 2), 541u);
+        EXPECT_EQ(CloudscapeUpsampleFilter::GetReducedSize(3, 4), 1u);
+    }
+
+    TEST_F(CloudscapeUpsampleFilterTest, GetFootprint_FullResolution_IsThePixelItself)
+    {
+        for (uint32_t y : { 0u, 5u, 9u })
+        {
+            for (uint32_t x : { 0u, 7u, 15u })
+            {
+                const auto footprint = CloudscapeUpsampleFilter::GetFootprint(x, y, 16, 10, 16, 10);
+                EXPECT_EQ(footprint.m_texelX[0], x);
+                EXPECT_EQ(footprint.m_texelY[0], y);
+                EXPECT_FLOAT_EQ(footprint.m_bilinearWeights[0], 1.0f);
+                EXPECT_FLOAT_EQ(GetWeightSum(footprint.m_bilinearWeights), 1.0f);
+            }
+        }
+    }
+
+    TEST_F(CloudscapeUpsampleFilterTest, GetFootprint_HalfResolution_BlendsTheNeighborTexels)
+    {
+        // Pixel 4 is where texel 2 sampled the depth, pixel 5 is half way to texel 3.
+        auto footprint = CloudscapeUpsampleFilter::GetFootprint(4, 4, 16, 16, 8, 8);
+        EXPECT_EQ(footprint.m_texelX[0], 2u);
+        EXPECT_EQ(footprint.m_texelY[0], 2u);
+        EXPECT_FLOAT_EQ(footprint.m_bilinearWeights[0], 1.0f);
+
+        footprint = CloudscapeUpsampleFilter::GetFootprint(5, 4, 16, 16, 8, 8);
+        EXPECT_EQ(footprint.m_texelX[0], 2u);
+        EXPECT_EQ(footprint.m_texelX[1], 3u);
+        EXPECT_FLOAT_EQ(footprint.m_bilinearWeights[0], 0.5f);
+        EXPECT_FLOAT_EQ(footprint.m_bilinearWeights[1], 0.5f);
+        EXPECT_FLOAT_EQ(footprint.m_bilinearWeights[2], 0.0f);
+        EXPECT_FLOAT_EQ(footprint.m_bilinearWeights[3], 0.0f);
+
+        // The last texel is clamped.
+        footprint = CloudscapeUpsampleFilter::GetFootprint(15, 15, 16, 16, 8, 8);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            EXPECT_EQ(footprint.m_texelX[i], 7u);
+            EXPECT_EQ(footprint.m_texelY[i], 7u);
+        }
+        EXPECT_FLOAT_EQ(GetWeightSum(footprint.m_bilinearWeights), 1.0f);
+
+        // The source pixel of each texel is that texel alone when the viewport is a multiple of the reduced size.
+        // Otherwise the source pixel drifts by less than one full resolution pixel, and the texel still dominates.
+        for (uint32_t fullSize : { 1080u, 1081u, 1082u, 1083u })
+        {
+            for (uint32_t resolutionScale : { 2u, 4u })
+            {
+                const uint32_t reducedSize = CloudscapeUpsampleFilter::GetReducedSize(fullSize, resolutionScale);
+                const bool isMultiple = (fullSize % resolutionScale) == 0;
+                for (uint32_t texel = 0; texel < reducedSize; texel++)
+                {
+                    const uint32_t sourcePixel = CloudscapeUpsampleFilter::GetSourcePixel(texel, fullSize, reducedSize);
+                    ASSERT_LT(sourcePixel, fullSize);
+                    const auto sourceFootprint = CloudscapeUpsampleFilter::GetFootprint(sourcePixel, 0, fullSize, 1, reducedSize, 1);
+                    float texelWeight = 0.0f;
+                    for (uint32_t i = 0; i < 4; i++)
+                    {
+                        texelWeight += (sourceFootprint.m_texelX[i] == texel) ? sourceFootprint.m_bilinearWeights[i] : 0.0f;
+                    }
+                    EXPECT_GE(texelWeight, isMultiple ? 1.0f : 0.5f) << fullSize << " / " << resolutionScale << ", texel " << texel;
+                }
+            }
+        }
+    }
+
+    TEST_F(CloudscapeUpsampleFilterTest, GetWeights_SameDepth_IsBilinear)
+    {
+        const auto footprint = CloudscapeUpsampleFilter::GetFootprint(5, 7, 16, 16, 4, 4);
+        const float texelDistances[4] = { 250.0f, 250.0f, 250.0f, 250.0f };
+        float weights[4];
+        CloudscapeUpsampleFilter::GetWeights(footprint, 250.0f, texelDistances, weights);
+        for (uint32_t i = 0; i < 4; i++)
+        {
+            EXPECT_NEAR(weights[i], footprint.m_bilinearWeights[i], 1.0e-6f);
+        }
+    }
+
+    TEST_F(CloudscapeUpsampleFilterTest, GetWeights_GeometryTexels_AreRejected)
+    {
+        // A sky pixel next to a building. Only the sky texels contribute.
+        const auto footprint = CloudscapeUpsampleFilter::GetFootprint(5, 5, 16, 16, 8, 8);
+        const float texelDistances[4] = { SkyDistance, 40.0f, SkyDistance, 40.0f };
+        float weights[4];
+        CloudscapeUpsampleFilter::GetWeights(footprint, SkyDistance, texelDistances, weights);
+        EXPECT_NEAR(GetWeightSum(weights), 1.0f, 1.0e-6f);
+        EXPECT_LT(weights[1], 1.0e-6f);
+        EXPECT_LT(weights[3], 1.0e-6f);
+        EXPECT_NEAR(weights[0] + weights[2], 1.0f, 1.0e-6f);
+
+        // Slightly different distances still blend.
+        EXPECT_GT(CloudscapeUpsampleFilter::GetDepthWeight(1000.0f, 1010.0f), 0.5f);
+        EXPECT_LT(CloudscapeUpsampleFilter::GetDepthWeight(1000.0f, 2000.0f), 1.0e-6f);
+    }
+
+    TEST_F(CloudscapeUpsampleFilterTest, GetWeights_NoSimilarTexel_TakesTheClosestOne)
+    {
+        // The sky pixel sits exactly on a building texel, and the only sky texel has no bilinear weight.
+        const auto footprint = CloudscapeUpsampleFilter::GetFootprint(4, 4, 16, 16, 8, 8);
+        const float texelDistances[4] = { 40.0f, SkyDistance, 45.0f, 45.0f };
+        float weights[4];
+        CloudscapeUpsampleFilter::GetWeights(footprint, SkyDistance, texelDistances, weights);
+        EXPECT_FLOAT_EQ(weights[0], 0.0f);
+        EXPECT_FLOAT_EQ(weights[1], 1.0f);
+        EXPECT_FLOAT_EQ(weights[2], 0.0f);
+        EXPECT_FLOAT_EQ(weights[3], 0.0f);
+    }
+
+    TEST_F(CloudscapeUpsampleFilterTest, Upsample_KeepsTheCloudsOffTheGeometry)
+    {
+        // Quarter resolution. Sky on the left half, a wall on the right half.
+        // The reduced clouds are white over the sky, and black (no clouds) behind the wall.
+        const uint32_t fullWidth = 32, fullHeight = 8;
+        const uint32_t reducedWidth = CloudscapeUpsampleFilter::GetReducedSize(fullWidth, 4);
+        const uint32_t reducedHeight = CloudscapeUpsampleFilter::GetReducedSize(fullHeight, 4);
+        AZStd::vector<float> fullDistances(fullWidth * fullHeight);
+        for (uint32_t y = 0; y < fullHeight; y++)
+        {
+            for (uint32_t x = 0; x < fullWidth; x++)
+            {
+                fullDistances[y * fullWidth + x] = (x < 14) ? SkyDistance : 30.0f;
+            }
+        }
+        AZStd::vector<float> reducedColors(reducedWidth * reducedHeight * 4);
+        for (uint32_t y = 0; y < reducedHeight; y++)
+        {
+            for (uint32_t x = 0; x < reducedWidth; x++)
+            {
+                const uint32_t sourceX = CloudscapeUpsampleFilter::GetSourcePixel(x, fullWidth, reducedWidth);
+                const float value = (sourceX < 14) ? 1.0f : 0.0f;
+                for (uint32_t channel = 0; channel < 4; channel++)
+                {
+                    reducedColors[(y * reducedWidth + x) * 4 + channel] = value;
+                }
+            }
+        }
+
+        AZStd::vector<float> fullColors;
+        CloudscapeUpsampleFilter::Upsample(fullDistances, fullWidth, fullHeight, reducedColors, reducedWidth, reducedHeight, fullColors);
+        ASSERT_EQ(fullColors.size(), fullDistances.size() * 4);
+        for (uint32_t y = 0; y < fullHeight; y++)
+        {
+            for (uint32_t x = 0; x < fullWidth; x++)
+            {
+                // A plain bilinear upsample would fade pixels 12 and 13 towards black.
+                const float expected = (x < 14) ? 1.0f : 0.0f;
+                EXPECT_NEAR(fullColors[(y * fullWidth + x) * 4], expected, 1.0e-4f) << x << ", " << y;
+            }
+        }
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,200 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <cmath>
+
+#include <Renderer/Cpu/WeatherMapPyramid.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class WeatherMapPyramidTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        static constexpr uint32_t Width = 37;
+        static constexpr uint32_t Height = 23;
+
+        // Clouds only in a few patches, one of them across the wrap around edges,
+        // so most of the map is empty. Each channel has its own pattern.
+        static AZStd::vector<uint8_t> CreateWeatherMap()
+        {
+            AZStd::vector<uint8_t> pixels(static_cast<size_t>(Width) * Height * WeatherMapPyramid::BytesPerPixel, 0);
+            for (uint32_t y = 0; y < Height; y++)
+            {
+                for (uint32_t x = 0; x < Width; x++)
+                {
+                    const bool inCenterPatch = (x >= 12) && (x < 18) && (y >= 8) && (y < 11);
+                    const bool inCornerPatch = ((x < 2) || (x >= Width - 1)) && ((y < 1) || (y >= Height - 2));
+                    if (!inCenterPatch && !inCornerPatch)
+                    {
+                        continue;
+                    }
+                    uint8_t* pixel = pixels.data() + (static_cast<size_t>(y) * Width + x) * WeatherMapPyramid::BytesPerPixel;
+                    pixel[0] = static_cast<uint8_t>(40 + (x * 7 + y * 13) % 200);
+                    pixel[1] = static_cast<uint8_t>((x * 31 + y) % 256);
+                    pixel[2] = static_cast<uint8_t>(1 + (x * y) % 255);
+                    pixel[3] = static_cast<uint8_t>(255 - (x + y));
+                }
+            }
+            // A lone texel with coverage but no density.
+            pixels[(static_cast<size_t>(3) * Width + 30) * WeatherMapPyramid::BytesPerPixel] = 255;
+            return pixels;
+        }
+
+        // Reference of the bilinear filter with wrap around addressing of the WrapLinearSampler
+        // used by GetWeatherData() in CloudscapeCS.azsl.
+        static float SampleBilinearWrap(const AZStd::vector<uint8_t>& pixels, float u, float v, uint32_t channel)
+        {
+            const float texelX = u * Width - 0.5f;
+            const float texelY = v * Height - 0.5f;
+            const float floorX = std::floor(texelX);
+            const float floorY = std::floor(texelY);
+            const float fracX = texelX - floorX;
+            const float fracY = texelY - floorY;
+            auto wrap = [](int64_t value, uint32_t size)
+            {
+                return static_cast<uint32_t>(((value % size) + size) % size);
+            };
+            const uint32_t x0 = wrap(static_cast<int64_t>(floorX), Width);
+            const uint32_t x1 = wrap(static_cast<int64_t>(floorX) + 1, Width);
+            const uint32_t y0 = wrap(static_cast<int64_t>(floorY), Height);
+            const uint32_t y1 = wrap(static_cast<int64_t>(floorY) + 1, Height);
+            auto fetch = [&pixels, channel](uint32_t x, uint32_t y)
+            {
+                return pixels[(static_cast<size_t>(y) * Width + x) * WeatherMapPyramid::BytesPerPixel + channel] / 255.0f;
+            };
+            const float top = fetch(x0, y0) * (1.0f - fracX) + fetch(x1, y0) * fracX;
+            const float bottom = fetch(x0, y1) * (1.0f - fracX) + fetch(x1, y1) * fracX;
+            return top * (1.0f - fracY) + bottom * fracY;
+        }
+    };
+
+    TEST_F(WeatherMapPyramidTest, GetLevelCount_VariousSizes_HalvesDownTo1x1)
+    {
+        EXPECT_EQ(WeatherMapPyramid::GetLevelCount(0, 16), 0u);
+        EXPECT_EQ(WeatherMapPyramid::GetLevelCount(1, 1), 1u);
+        EXPECT_EQ(WeatherMapPyramid::GetLevelCount(2, 1), 2u);
+        EXPECT_EQ(WeatherMapPyramid::GetLevelCount(512, 512), 10u);
+        EXPECT_EQ(WeatherMapPyramid::GetLevelCount(513, 3), 11u);
+        EXPECT_EQ(WeatherMapPyramid::GetLevelCount(Width, Height), 7u);
+    }
+
+    TEST_F(WeatherMapPyramidTest, Build_NonPowerOfTwo_TopLevelIsGlobalMax)
+    {
+        const auto pixels = CreateWeatherMap();
+        WeatherMapPyramid pyramid;
+        ASSERT_TRUE(pyramid.Build(pixels.data(), Width, Height));
+        const auto& levels = pyramid.GetLevels();
+        ASSERT_EQ(levels.size(), WeatherMapPyramid::GetLevelCount(Width, Height));
+
+        uint32_t levelWidth = Width;
+        uint32_t levelHeight = Height;
+        for (const auto& level : levels)
+        {
+            EXPECT_EQ(level.m_mipSize.m_width, levelWidth);
+            EXPECT_EQ(level.m_mipSize.m_height, levelHeight);
+            EXPECT_EQ(level.m_mipSize.m_depth, 1u);
+            EXPECT_EQ(level.m_dataBuffer->size(), static_cast<size_t>(levelWidth) * levelHeight * WeatherMapPyramid::BytesPerPixel);
+            levelWidth = (levelWidth + 1) >> 1;
+            levelHeight = (levelHeight + 1) >> 1;
+        }
+
+        const auto& topLevel = levels.back();
+        ASSERT_EQ(topLevel.m_mipSize.m_width, 1u);
+        ASSERT_EQ(topLevel.m_mipSize.m_height, 1u);
+        for (uint32_t channel = 0; channel < WeatherMapPyramid::BytesPerPixel; channel++)
+        {
+            uint8_t maxValue = 0;
+            for (size_t byteIndex = channel; byteIndex < pixels.size(); byteIndex += WeatherMapPyramid::BytesPerPixel)
+            {
+                maxValue = AZStd::max(maxValue, pixels[byteIndex]);
+            }
+            EXPECT_EQ((*topLevel.m_dataBuffer)[channel], maxValue) << channel;
+        }
+    }
+
+    TEST_F(WeatherMapPyramidTest, GetBound_RandomUVs_IsConservative)
+    {
+        const auto pixels = CreateWeatherMap();
+        WeatherMapPyramid pyramid;
+        ASSERT_TRUE(pyramid.Build(pixels.data(), Width, Height));
+        const uint32_t levelCount = static_cast<uint32_t>(pyramid.GetLevels().size());
+
+        // Deterministic LCG, the uvs go past [0, 1] to exercise the wrap around,
+        // and some are placed right at the texel borders.
+        uint32_t seed = 12345;
+        auto nextUnit = [&seed]()
+        {
+            seed = seed * 1664525u + 1013904223u;
+            return static_cast<float>(seed >> 8) / static_cast<float>(1u << 24);
+        };
+        uint32_t emptyCount = 0;
+        for (uint32_t sampleIndex = 0; sampleIndex < 20000; sampleIndex++)
+        {
+            float u = nextUnit() * 3.0f - 1.0f;
+            float v = nextUnit() * 3.0f - 1.0f;
+            if ((sampleIndex % 4) == 0)
+            {
+                u = std::floor(u * Width) / Width;
+                v = std::floor(v * Height) / Height;
+            }
+
+            float samples[WeatherMapPyramid::BytesPerPixel];
+            for (uint32_t channel = 0; channel < WeatherMapPyramid::BytesPerPixel; channel++)
+            {
+                samples[channel] = SampleBilinearWrap(pixels, u, v, channel);
+            }
+            for (uint32_t level = 0; level < levelCount; level++)
+            {
+                const uint8_t* bound = pyramid.GetBound(level, u, v);
+                ASSERT_NE(bound, nullptr);
+                for (uint32_t channel = 0; channel < WeatherMapPyramid::BytesPerPixel; channel++)
+                {
+                    ASSERT_LE(samples[channel], bound[channel] / 255.0f + 1e-6f)
+                        << "uv=(" << u << ", " << v << ") level=" << level << " channel=" << channel;
+                }
+                // Anything the pyramid reports as empty must be empty when sampled.
+                for (float globalCoverage : { 0.3f, 0.5f, 1.0f })
+                {
+                    const bool isBoundEmpty = WeatherMapPyramid::IsEmpty(bound[0] / 255.0f, bound[1] / 255.0f,
+                        bound[2] / 255.0f, bound[3] / 255.0f, globalCoverage);
+                    if (isBoundEmpty)
+                    {
+                        ASSERT_TRUE(WeatherMapPyramid::IsEmpty(samples[0], samples[1], samples[2], samples[3], globalCoverage))
+                            << "uv=(" << u << ", " << v << ") level=" << level;
+                    }
+                }
+                if ((level == 0) && WeatherMapPyramid::IsEmpty(bound[0] / 255.0f, bound[1] / 255.0f, bound[2] / 255.0f, bound[3] / 255.0f, 1.0f))
+                {
+                    emptyCount++;
+                }
+            }
+        }
+        // Most of the map is empty, the test is pointless if the pyramid never says so.
+        EXPECT_GT(emptyCount, 1000u);
+        EXPECT_EQ(pyramid.GetBound(levelCount, 0.5f, 0.5f), nullptr);
+    }
+
+    TEST_F(WeatherMapPyramidTest, IsEmpty_HighCoverage_OnlyCountsAboveHalfGlobalCoverage)
+    {
+        // Only high coverage.
+        EXPECT_TRUE(WeatherMapPyramid::IsEmpty(0.0f, 1.0f, 1.0f, 1.0f, 0.5f));
+        EXPECT_FALSE(WeatherMapPyramid::IsEmpty(0.0f, 1.0f, 1.0f, 1.0f, 0.6f));
+        EXPECT_FALSE(WeatherMapPyramid::IsEmpty(0.1f, 0.0f, 1.0f, 1.0f, 0.1f));
+        EXPECT_TRUE(WeatherMapPyramid::IsEmpty(0.1f, 0.0f, 1.0f, 1.0f, 0.0f));
+        EXPECT_TRUE(WeatherMapPyramid::IsEmpty(1.0f, 1.0f, 0.0f, 1.0f, 1.0f));
+        EXPECT_TRUE(WeatherMapPyramid::IsEmpty(1.0f, 1.0f, 1.0f, 0.0f, 1.0f));
+    }
+
+} // namespace UnitTest
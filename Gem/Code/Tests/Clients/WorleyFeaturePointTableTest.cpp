@@ -0,0 +1,149 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzTest/AzTest.h>
+
+#include <cstring>
+
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Renderer/Cpu/PerlinWorleyNoiseKernels.h>
+#include <Renderer/Cpu/WorleyFeaturePointTable.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    class WorleyFeaturePointTableTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        // Evaluates the Worley FBM of every voxel of a @pixelSize^3 volume with and without the tables,
+        // and expects the exact same bits.
+        template<PerlinWorleyNoiseVariant Variant>
+        static void ExpectSameWorleyNoiseFbm(uint32_t pixelSize, float frequency, int octaves)
+        {
+            using Vec = AZ::Simd::Vec4;
+            using Kernels = PerlinWorleyNoiseKernels<Vec, Variant>;
+
+            PerlinWorleyNoiseParameters params;
+            params.m_frequency = frequency;
+            params.m_worleyOctaves = octaves;
+            WorleyFeaturePointTables worleyTables;
+            CloudTextureCpuBaker::BuildWorleyFeaturePointTables(params, Variant, pixelSize, worleyTables);
+            ASSERT_FALSE(worleyTables.GetTables().empty());
+
+            const float invPixelSize = 1.0f / static_cast<float>(pixelSize);
+            alignas(16) float laneCoords[Kernels::LaneCount];
+            alignas(16) float expected[Kernels::LaneCount];
+            alignas(16) float actual[Kernels::LaneCount];
+            uint32_t mismatchCount = 0;
+            for (uint32_t z = 0; z < pixelSize; z++)
+            {
+                for (uint32_t y = 0; y < pixelSize; y++)
+                {
+                    for (uint32_t x = 0; x < pixelSize; x += Kernels::LaneCount)
+                    {
+                        for (uint32_t lane = 0; lane < Kernels::LaneCount; lane++)
+                        {
+                            laneCoords[lane] = static_cast<float>(x + lane) * invPixelSize;
+                        }
+                        typename Kernels::Float3 input;
+                        input.m_x = Vec::LoadAligned(laneCoords);
+                        input.m_y = Vec::Splat(static_cast<float>(y) * invPixelSize);
+                        input.m_z = Vec::Splat(static_cast<float>(z) * invPixelSize);
+
+                        Vec::StoreAligned(expected, Kernels::WorleyNoiseFbm(input, params.m_frequency, params.m_worleyOctaves,
+                            params.m_worleyGain, params.m_worleyAmplitude));
+                        Vec::StoreAligned(actual, Kernels::WorleyNoiseFbm(input, params.m_frequency, params.m_worleyOctaves,
+                            params.m_worleyGain, params.m_worleyAmplitude, &worleyTables));
+                        for (uint32_t lane = 0; lane < Kernels::LaneCount; lane++)
+                        {
+                            mismatchCount += (memcmp(&expected[lane], &actual[lane], sizeof(float)) != 0) ? 1 : 0;
+                        }
+                    }
+                }
+            }
+            EXPECT_EQ(mismatchCount, 0u);
+        }
+    };
+
+    TEST_F(WorleyFeaturePointTableTest, GetTablePeriods_SharedPeriods_AreNotDuplicated)
+    {
+        // Channels x1, x2, x4 with 3 octaves each: 4 8 16, 8 16 32, 16 32 64.
+        const AZStd::vector<uint32_t> periods = WorleyFeaturePointTables::GetTablePeriods(4.0f, 3, 128);
+        EXPECT_EQ(periods, AZStd::vector<uint32_t>({ 4, 8, 16, 32, 64 }));
+    }
+
+    TEST_F(WorleyFeaturePointTableTest, GetTablePeriods_LargePeriods_AreSkipped)
+    {
+        // Periods larger than twice the pixel size are not worth a table.
+        EXPECT_EQ(WorleyFeaturePointTables::GetTablePeriods(4.0f, 3, 16), AZStd::vector<uint32_t>({ 4, 8, 16, 32 }));
+
+        // Periods larger than MaxPeriod would need too much memory.
+        for (uint32_t period : WorleyFeaturePointTables::GetTablePeriods(10.0f, 10, 256))
+        {
+            EXPECT_LE(period, WorleyFeaturePointTables::MaxPeriod);
+        }
+
+        // Only integral periods can have a table: 5 and 10, but not 2.5.
+        EXPECT_EQ(WorleyFeaturePointTables::GetTablePeriods(2.5f, 1, 128), AZStd::vector<uint32_t>({ 5, 10 }));
+    }
+
+    TEST_F(WorleyFeaturePointTableTest, FillTable_PaddingCells_WrapAround)
+    {
+        using Kernels = PerlinWorleyNoiseKernels<AZ::Simd::Vec4, PerlinWorleyNoiseVariant::A>;
+        WorleyFeaturePointTable table(5);
+        Kernels::FillWorleyFeaturePointTable(table, 0, table.GetPaddedSize());
+
+        auto expectSameFeaturePoint = [&table](uint32_t ax, uint32_t ay, uint32_t az, uint32_t bx, uint32_t by, uint32_t bz)
+        {
+            const WorleyFeaturePoint& a = table.GetFeaturePoints()[table.GetPaddedIndex(ax, ay, az)];
+            const WorleyFeaturePoint& b = table.GetFeaturePoints()[table.GetPaddedIndex(bx, by, bz)];
+            EXPECT_EQ(a.m_x, b.m_x);
+            EXPECT_EQ(a.m_y, b.m_y);
+            EXPECT_EQ(a.m_z, b.m_z);
+        };
+        // The padded cell 0 is the cell -1, which wraps to the cell 4 (padded 5).
+        // The padded cell 6 is the cell 5, which wraps to the cell 0 (padded 1).
+        expectSameFeaturePoint(0, 1, 1, 5, 1, 1);
+        expectSameFeaturePoint(6, 2, 3, 1, 2, 3);
+        expectSameFeaturePoint(2, 0, 3, 2, 5, 3);
+        expectSameFeaturePoint(3, 4, 6, 3, 4, 1);
+        expectSameFeaturePoint(0, 0, 0, 5, 5, 5);
+    }
+
+    TEST_F(WorleyFeaturePointTableTest, WorleyNoiseFbm_VariantA_MatchesHashPerSample)
+    {
+        ExpectSameWorleyNoiseFbm<PerlinWorleyNoiseVariant::A>(32, 4.0f, 3);
+        ExpectSameWorleyNoiseFbm<PerlinWorleyNoiseVariant::A>(16, 7.0f, 5);
+    }
+
+    TEST_F(WorleyFeaturePointTableTest, WorleyNoiseFbm_VariantB_MatchesHashPerSample)
+    {
+        ExpectSameWorleyNoiseFbm<PerlinWorleyNoiseVariant::B>(32, 4.0f, 3);
+        ExpectSameWorleyNoiseFbm<PerlinWorleyNoiseVariant::B>(16, 3.0f, 10);
+    }
+
+    TEST_F(WorleyFeaturePointTableTest, Bake_WithTables_MatchesHashPerSample)
+    {
+        CloudTextureComputeData computeData;
+        computeData.m_pixelSize = 32;
+        for (auto variant : { PerlinWorleyNoiseVariant::A, PerlinWorleyNoiseVariant::B })
+        {
+            const auto expected = CloudTextureCpuBaker::Bake(computeData, variant, nullptr, false);
+            const auto actual = CloudTextureCpuBaker::Bake(computeData, variant, nullptr, true);
+            ASSERT_EQ(expected.size(), actual.size());
+            for (size_t mipIndex = 0; mipIndex < expected.size(); mipIndex++)
+            {
+                EXPECT_TRUE(*expected[mipIndex].m_dataBuffer == *actual[mipIndex].m_dataBuffer) << "mip " << mipIndex;
+            }
+        }
+    }
+
+} // namespace UnitTest
@@ -0,0 +1,74 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#if defined(HAVE_BENCHMARK)
+
+#include <AzCore/Jobs/JobContext.h>
+#include <AzCore/Jobs/JobManager.h>
+#include <AzCore/Jobs/JobManagerDesc.h>
+#include <AzCore/std/algorithm.h>
+#include <AzCore/std/parallel/thread.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
+
+#include <benchmark/benchmark.h>
+
+namespace UnitTest
+{
+    // Base fixture for the cloud texture benchmarks.
+    // Creates a job system with one worker per hardware thread and makes it the global job context,
+    // the same way the Editor and VolumetricClouds.NoiseBaker run, so CloudTextureCpuBaker and the
+    // ICloudTextureWriter(s) are measured with all their parallelism.
+    class CloudTextureBenchmarkFixture : public ::benchmark::Fixture
+    {
+    public:
+        using ::benchmark::Fixture::SetUp;
+        using ::benchmark::Fixture::TearDown;
+
+        void SetUp(const ::benchmark::State& state) override
+        {
+            AZ::JobManagerDesc jobManagerDesc;
+            const uint32_t threadCount = AZStd::max(AZStd::thread::hardware_concurrency(), 1u);
+            for (uint32_t threadIndex = 0; threadIndex < threadCount; ++threadIndex)
+            {
+                jobManagerDesc.m_workerThreads.push_back(AZ::JobManagerThreadDesc());
+            }
+            m_jobManager = AZStd::make_unique<AZ::JobManager>(jobManagerDesc);
+            m_jobContext = AZStd::make_unique<AZ::JobContext>(*m_jobManager);
+            m_previousGlobalContext = AZ::JobContext::GetGlobalContext();
+            AZ::JobContext::SetGlobalContext(m_jobContext.get());
+
+            SetUpBenchmark(state);
+        }
+
+        void TearDown(const ::benchmark::State& state) override
+        {
+            TearDownBenchmark(state);
+
+            AZ::JobContext::SetGlobalContext(m_previousGlobalContext);
+            m_jobContext.reset();
+            m_jobManager.reset();
+        }
+
+    protected:
+        // Called after the job system is ready, before the benchmark runs.
+        virtual void SetUpBenchmark([[maybe_unused]] const ::benchmark::State& state) {}
+        // Called before the job system is destroyed.
+        virtual void TearDownBenchmark([[maybe_unused]] const ::benchmark::State& state) {}
+
+        AZ::JobContext* GetJobContext() const { return m_jobContext.get(); }
+
+    private:
+        AZStd::unique_ptr<AZ::JobManager> m_jobManager;
+        AZStd::unique_ptr<AZ::JobContext> m_jobContext;
+        AZ::JobContext* m_previousGlobalContext = nullptr;
+    };
+
+} // namespace UnitTest
+
+#endif // HAVE_BENCHMARK
@@ -0,0 +1,60 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#pragma once
+
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+
+#include <Renderer/CloudTextureMipData.h>
+
+namespace UnitTest
+{
+    // Small textures for the tests of the CPU Cloudscape raymarcher and optical depth volume.
+    namespace CloudscapeTestTextures
+    {
+        static constexpr uint32_t NoiseSize = 16;
+        static constexpr uint32_t WeatherMapSize = 16;
+
+        // RGBA8, or @bytesPerPixel UNORM channels, mip chain with a deterministic pattern, so the density changes along the rays.
+        inline AZStd::vector<VolumetricClouds::CloudTextureMipData> CreateNoiseTexture(uint32_t seed, uint32_t bytesPerPixel = 4)
+        {
+            AZStd::vector<VolumetricClouds::CloudTextureMipData> mipLevels;
+            for (uint32_t mipSize = NoiseSize; mipSize > 0; mipSize >>= 1)
+            {
+                VolumetricClouds::CloudTextureMipData mipData;
+                mipData.m_mipSlice = static_cast<uint16_t>(mipLevels.size());
+                mipData.m_mipSize = AZ::RHI::Size(mipSize, mipSize, mipSize);
+                mipData.m_dataBuffer = AZStd::make_shared<AZStd::vector<uint8_t>>(static_cast<size_t>(mipSize) * mipSize * mipSize * bytesPerPixel);
+                auto& pixels = *mipData.m_dataBuffer;
+                for (size_t byteIndex = 0; byteIndex < pixels.size(); byteIndex++)
+                {
+                    seed = seed * 1664525u + 1013904223u;
+                    // Biased towards high values, so the clouds are dense.
+                    pixels[byteIndex] = static_cast<uint8_t>(128 + (seed >> 25));
+                }
+                mipLevels.push_back(mipData);
+            }
+            return mipLevels;
+        }
+
+        // RGBA8 weather map with the same low and high @coverage, and @density, everywhere.
+        inline AZStd::vector<uint8_t> CreateWeatherMap(uint8_t coverage, uint8_t density)
+        {
+            AZStd::vector<uint8_t> pixels(static_cast<size_t>(WeatherMapSize) * WeatherMapSize * 4);
+            for (size_t pixelIndex = 0; pixelIndex < pixels.size() / 4; pixelIndex++)
+            {
+                pixels[pixelIndex * 4 + 0] = coverage;
+                pixels[pixelIndex * 4 + 1] = coverage;
+                pixels[pixelIndex * 4 + 2] = 255; // Peak height.
+                pixels[pixelIndex * 4 + 3] = density;
+            }
+            return pixels;
+        }
+    } // namespace CloudscapeTestTextures
+
+} // namespace UnitTest
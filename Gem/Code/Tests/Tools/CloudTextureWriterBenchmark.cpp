@@ -0,0 +1,144 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#if defined(HAVE_BENCHMARK)
+
+#include <AzCore/UnitTest/Utils.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+#include <AzCore/std/smart_ptr/unique_ptr.h>
+
+#include <CloudTextureBenchmarkFixture.h>
+#include <Renderer/Cpu/CloudTextureCpuBaker.h>
+#include <Tools/Utils/CloudVolCloudTextureWriter.h>
+#include <Tools/Utils/DdsCloudTextureWriter.h>
+#include <Tools/Utils/PngCloudTextureWriter.h>
+
+// Run with:
+//     AzTestRunner <VolumetricClouds.Editor.Tests module> AzRunBenchmarks --benchmark_out_format=json --benchmark_out=<file>.json
+// "bytes_per_second" is the uncompressed RGBA8 mip chain saved per second.
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    enum class CloudTextureWriterKind : int64_t
+    {
+        Dds,
+        DdsBC4,
+        DdsBC7,
+        PngSlices,
+        PngFlipbookAtlas,
+        CloudVolLZ4,
+        CloudVolZStd,
+    };
+
+    // Measures the time it takes ICloudTextureWriter::SaveAllMipLevels() to save an already baked
+    // mip chain, including block compression and PNG encoding, into a temporary directory.
+    // Arguments: size, writer.
+    class CloudTextureWriterBenchmark : public CloudTextureBenchmarkFixture
+    {
+    protected:
+        void SetUpBenchmark(const ::benchmark::State& state) override
+        {
+            m_tempDirectory = AZStd::make_unique<AZ::Test::ScopedAutoTempDirectory>();
+            // The bake is not measured.
+            CloudTextureComputeData computeData;
+            computeData.m_pixelSize = static_cast<uint32_t>(state.range(0));
+            m_mipLevels = CloudTextureCpuBaker::Bake(computeData, PerlinWorleyNoiseVariant::A, GetJobContext());
+        }
+
+        void TearDownBenchmark([[maybe_unused]] const ::benchmark::State& state) override
+        {
+            m_mipLevels = {};
+            m_tempDirectory.reset();
+        }
+
+        AZStd::shared_ptr<ICloudTextureWriter> CreateWriter(CloudTextureWriterKind writerKind) const
+        {
+            const uint16_t mipLevels = aznumeric_caster(m_mipLevels.size());
+            const AZ::RHI::Format pixelFormat = AZ::RHI::Format::R8G8B8A8_UNORM;
+            const AZ::IO::Path outputDir = m_tempDirectory->GetDirectory();
+            const AZStd::string stemPrefix = "clouds";
+
+            switch (writerKind)
+            {
+            case CloudTextureWriterKind::DdsBC4:
+                return AZStd::make_shared<DdsCloudTextureWriter>(mipLevels, pixelFormat, outputDir, stemPrefix, CloudTextureCompression::BC4);
+            case CloudTextureWriterKind::DdsBC7:
+                return AZStd::make_shared<DdsCloudTextureWriter>(mipLevels, pixelFormat, outputDir, stemPrefix, CloudTextureCompression::BC7);
+            case CloudTextureWriterKind::PngSlices:
+                return AZStd::make_shared<PngCloudTextureWriter>(mipLevels, pixelFormat, outputDir, stemPrefix, PngCloudTextureLayout::Slices);
+            case CloudTextureWriterKind::PngFlipbookAtlas:
+                return AZStd::make_shared<PngCloudTextureWriter>(mipLevels, pixelFormat, outputDir, stemPrefix, PngCloudTextureLayout::FlipbookAtlas);
+            case CloudTextureWriterKind::CloudVolLZ4:
+            case CloudTextureWriterKind::CloudVolZStd:
+            {
+                CloudVolumeWriteSettings writeSettings;
+                writeSettings.m_codec = (writerKind == CloudTextureWriterKind::CloudVolLZ4) ? CloudVolumeCodec::LZ4 : CloudVolumeCodec::ZStd;
+                return AZStd::make_shared<CloudVolCloudTextureWriter>(mipLevels, pixelFormat, outputDir, stemPrefix, CloudTextureComputeData(), writeSettings);
+            }
+            default:
+                return AZStd::make_shared<DdsCloudTextureWriter>(mipLevels, pixelFormat, outputDir, stemPrefix);
+            }
+        }
+
+        uint64_t GetMipChainSizeInBytes() const
+        {
+            uint64_t totalBytes = 0;
+            for (const auto& mipLevelData : m_mipLevels)
+            {
+                totalBytes += mipLevelData.m_dataBuffer->size();
+            }
+            return totalBytes;
+        }
+
+        AZStd::vector<CloudTextureCpuBaker::MipLevelData> m_mipLevels;
+
+    private:
+        AZStd::unique_ptr<AZ::Test::ScopedAutoTempDirectory> m_tempDirectory;
+    };
+
+    BENCHMARK_DEFINE_F(CloudTextureWriterBenchmark, SaveAllMipLevels)(::benchmark::State& state)
+    {
+        const auto writerKind = static_cast<CloudTextureWriterKind>(state.range(1));
+        for ([[maybe_unused]] auto _ : state)
+        {
+            // Creating the writer and handing it the buffers is part of the cost of each save.
+            AZStd::shared_ptr<ICloudTextureWriter> writer = CreateWriter(writerKind);
+            for (const auto& mipLevelData : m_mipLevels)
+            {
+                writer->SetDataBufferForMipLevel(mipLevelData.m_dataBuffer, mipLevelData.m_mipSlice, mipLevelData.m_mipSize);
+            }
+
+            CloudTextureWriteStatus status;
+            if (!writer->SaveAllMipLevels(status))
+            {
+                state.SkipWithError("SaveAllMipLevels failed");
+                break;
+            }
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * static_cast<int64_t>(GetMipChainSizeInBytes()));
+    }
+
+    BENCHMARK_REGISTER_F(CloudTextureWriterBenchmark, SaveAllMipLevels)
+        ->ArgNames({ "size", "writer" })
+        ->ArgsProduct({
+            { 32, 64, 128 },
+            {
+                static_cast<int64_t>(CloudTextureWriterKind::Dds),
+                static_cast<int64_t>(CloudTextureWriterKind::DdsBC4),
+                static_cast<int64_t>(CloudTextureWriterKind::DdsBC7),
+                static_cast<int64_t>(CloudTextureWriterKind::PngSlices),
+                static_cast<int64_t>(CloudTextureWriterKind::PngFlipbookAtlas),
+                static_cast<int64_t>(CloudTextureWriterKind::CloudVolLZ4),
+                static_cast<int64_t>(CloudTextureWriterKind::CloudVolZStd),
+            } })
+        ->Unit(::benchmark::kMillisecond)
+        ->UseRealTime();
+
+} // namespace UnitTest
+
+#endif // HAVE_BENCHMARK
@@ -0,0 +1,206 @@
+/*
+* Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+*
+* SPDX-License-Identifier: Apache-2.0 OR MIT
+*
+*/
+
+#include <AzCore/IO/SystemFile.h>
+#include <AzCore/UnitTest/TestTypes.h>
+#include <AzCore/UnitTest/Utils.h>
+#include <AzCore/std/containers/vector.h>
+#include <AzCore/std/smart_ptr/make_shared.h>
+#include <AzTest/AzTest.h>
+
+#include <Tools/Utils/DdsCloudTextureWriter.h>
+
+namespace UnitTest
+{
+    using namespace VolumetricClouds;
+
+    // Reads back the DDS files written by DdsCloudTextureWriter, whose header is written by hand.
+    // See https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header
+    // and https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dds-header-dxt10
+    class DdsCloudTextureWriterTest
+        : public LeakDetectionFixture
+    {
+    protected:
+        // Byte offsets in the file. The magic number is followed by the 124 bytes
+        // of DDS_HEADER, and the 20 bytes of DDS_HEADER_DXT10.
+        static constexpr size_t MagicOffset = 0;
+        static constexpr size_t HeaderOffset = 4;
+        static constexpr size_t HeaderByteCount = 124;
+        static constexpr size_t HeaderDxt10Offset = HeaderOffset + HeaderByteCount;
+        static constexpr size_t DataOffset = HeaderDxt10Offset + 20;
+
+        // Offsets in DDS_HEADER.
+        static constexpr size_t SizeField = 0;
+        static constexpr size_t FlagsField = 4;
+        static constexpr size_t HeightField = 8;
+        static constexpr size_t WidthField = 12;
+        static constexpr size_t PitchOrLinearSizeField = 16;
+        static constexpr size_t DepthField = 20;
+        static constexpr size_t MipMapCountField = 24;
+        static constexpr size_t PixelFormatFlagsField = 76;
+        static constexpr size_t PixelFormatFourCCField = 80;
+        static constexpr size_t CapsField = 104;
+        static constexpr size_t Caps2Field = 108;
+
+        // Offsets in DDS_HEADER_DXT10.
+        static constexpr size_t DxgiFormatField = 0;
+        static constexpr size_t ResourceDimensionField = 4;
+        static constexpr size_t ArraySizeField = 12;
+
+        // A cube mip chain, @pixelSize, @pixelSize / 2, ..., down to @mipCount mips.
+        static AZStd::vector<AZStd::shared_ptr<AZStd::vector<uint8_t>>> CreateMipChain(uint32_t pixelSize, uint16_t mipCount, uint32_t bytesPerPixel)
+        {
+            AZStd::vector<AZStd::shared_ptr<AZStd::vector<uint8_t>>> mipBuffers;
+            for (uint16_t mipIndex = 0; mipIndex < mipCount; mipIndex++)
+            {
+                const size_t mipSize = pixelSize >> mipIndex;
+                auto& dataBuffer = mipBuffers.emplace_back(AZStd::make_shared<AZStd::vector<uint8_t>>(mipSize * mipSize * mipSize * bytesPerPixel));
+                for (size_t byteIndex = 0; byteIndex < dataBuffer->size(); byteIndex++)
+                {
+                    (*dataBuffer)[byteIndex] = static_cast<uint8_t>((byteIndex * 7) ^ (mipIndex * 31));
+                }
+            }
+            return mipBuffers;
+        }
+
+        static void SetMipChain(ICloudTextureWriter& writer, uint32_t pixelSize,
+            const AZStd::vector<AZStd::shared_ptr<AZStd::vector<uint8_t>>>& mipBuffers)
+        {
+            for (uint16_t mipIndex = 0; mipIndex < mipBuffers.size(); mipIndex++)
+            {
+                const uint32_t mipSize = pixelSize >> mipIndex;
+                ASSERT_TRUE(writer.SetDataBufferForMipLevel(mipBuffers[mipIndex], mipIndex, AZ::RHI::Size(mipSize, mipSize, mipSize)));
+            }
+        }
+
+        static AZStd::vector<uint8_t> ReadFile(const AZ::IO::Path& filePath)
+        {
+            AZStd::vector<uint8_t> fileBytes;
+            AZ::IO::SystemFile file;
+            if (file.Open(filePath.c_str(), AZ::IO::SystemFile::SF_OPEN_READ_ONLY))
+            {
+                fileBytes.resize(file.Length());
+                file.Read(fileBytes.size(), fileBytes.data());
+            }
+            return fileBytes;
+        }
+
+        static uint32_t ReadUint32(const AZStd::vector<uint8_t>& fileBytes, size_t offset)
+        {
+            uint32_t value = 0;
+            memcpy(&value, fileBytes.data() + offset, sizeof(value));
+            return value;
+        }
+
+        // Checks the fields that don't depend on the format.
+        static void ExpectVolumeHeader(const AZStd::vector<uint8_t>& fileBytes, uint32_t pixelSize, uint16_t mipCount, uint32_t dxgiFormat)
+        {
+            ASSERT_GE(fileBytes.size(), DataOffset);
+            EXPECT_EQ(ReadUint32(fileBytes, MagicOffset), 0x20534444u); // "DDS "
+
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + SizeField), HeaderByteCount);
+            // DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PIXELFORMAT | DDSD_MIPMAPCOUNT | DDSD_DEPTH.
+            const uint32_t requiredFlags = 0x1 | 0x2 | 0x4 | 0x1000 | 0x20000 | 0x800000;
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + FlagsField) & requiredFlags, requiredFlags);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + HeightField), pixelSize);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + WidthField), pixelSize);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + DepthField), pixelSize);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + MipMapCountField), mipCount);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + PixelFormatFlagsField), 0x4u); // DDPF_FOURCC
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + PixelFormatFourCCField), 0x30315844u); // "DX10"
+            // DDSCAPS_COMPLEX | DDSCAPS_TEXTURE | DDSCAPS_MIPMAP, and DDSCAPS2_VOLUME.
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + CapsField), 0x8u | 0x1000u | 0x400000u);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + Caps2Field), 0x200000u);
+
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderDxt10Offset + DxgiFormatField), dxgiFormat);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderDxt10Offset + ResourceDimensionField), 4u); // D3D10_RESOURCE_DIMENSION_TEXTURE3D
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderDxt10Offset + ArraySizeField), 1u);
+        }
+
+        AZ::Test::ScopedAutoTempDirectory m_tempDirectory;
+    };
+
+    TEST_F(DdsCloudTextureWriterTest, SaveAllMipLevels_Uncompressed_MipsFollowTheHeaders)
+    {
+        struct FormatCase
+        {
+            AZ::RHI::Format m_format;
+            uint32_t m_bytesPerPixel;
+            uint32_t m_dxgiFormat;
+        };
+        const FormatCase formatCases[] = {
+            { AZ::RHI::Format::R8G8B8A8_UNORM, 4, 28 },
+            { AZ::RHI::Format::R8G8_UNORM, 2, 49 },
+            { AZ::RHI::Format::R8_UNORM, 1, 61 },
+            { AZ::RHI::Format::R16_FLOAT, 2, 54 },
+        };
+
+        constexpr uint32_t PixelSize = 16;
+        constexpr uint16_t MipCount = 3;
+        for (const auto& formatCase : formatCases)
+        {
+            SCOPED_TRACE(AZ::RHI::ToString(formatCase.m_format));
+            const auto mipBuffers = CreateMipChain(PixelSize, MipCount, formatCase.m_bytesPerPixel);
+            DdsCloudTextureWriter writer(MipCount, formatCase.m_format, AZ::IO::Path(m_tempDirectory.GetDirectory()), "uncompressed");
+            SetMipChain(writer, PixelSize, mipBuffers);
+
+            CloudTextureWriteStatus status;
+            ASSERT_TRUE(writer.SaveAllMipLevels(status));
+            ASSERT_EQ(writer.GetListOfSavedFiles().size(), 1u);
+            EXPECT_EQ(writer.GetSavedMipLevelsCount(), MipCount);
+
+            const auto fileBytes = ReadFile(writer.GetListOfSavedFiles()[0]);
+            ExpectVolumeHeader(fileBytes, PixelSize, MipCount, formatCase.m_dxgiFormat);
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + FlagsField) & 0x8u, 0x8u); // DDSD_PITCH
+            EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + PitchOrLinearSizeField), PixelSize * formatCase.m_bytesPerPixel);
+
+            // The mips go one after the other, each one slice after slice, as given to the writer.
+            size_t offset = DataOffset;
+            for (uint16_t mipIndex = 0; mipIndex < MipCount; mipIndex++)
+            {
+                const auto& mipBytes = *mipBuffers[mipIndex];
+                ASSERT_LE(offset + mipBytes.size(), fileBytes.size());
+                EXPECT_EQ(memcmp(fileBytes.data() + offset, mipBytes.data(), mipBytes.size()), 0) << "Mip " << mipIndex;
+                offset += mipBytes.size();
+            }
+            EXPECT_EQ(offset, fileBytes.size());
+            EXPECT_EQ(status.GetWrittenBytes(), fileBytes.size());
+        }
+    }
+
+    TEST_F(DdsCloudTextureWriterTest, SaveAllMipLevels_BC7_WritesOneBlockPer4x4Pixels)
+    {
+        constexpr uint32_t PixelSize = 16;
+        constexpr uint16_t MipCount = 3;
+        const auto mipBuffers = CreateMipChain(PixelSize, MipCount, 4);
+        DdsCloudTextureWriter writer(MipCount, AZ::RHI::Format::R8G8B8A8_UNORM, AZ::IO::Path(m_tempDirectory.GetDirectory()), "bc7",
+            CloudTextureCompression::BC7);
+        SetMipChain(writer, PixelSize, mipBuffers);
+
+        CloudTextureWriteStatus status;
+        ASSERT_TRUE(writer.SaveAllMipLevels(status));
+        ASSERT_EQ(writer.GetListOfSavedFiles().size(), 1u);
+        EXPECT_EQ(writer.GetMipLevelsPsnr().size(), MipCount);
+
+        const auto fileBytes = ReadFile(writer.GetListOfSavedFiles()[0]);
+        ExpectVolumeHeader(fileBytes, PixelSize, MipCount, 98);
+        // The linear size is the size of the top level slice, 16 bytes per block.
+        constexpr uint32_t BlockByteCount = 16;
+        EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + FlagsField) & 0x80000u, 0x80000u); // DDSD_LINEARSIZE
+        EXPECT_EQ(ReadUint32(fileBytes, HeaderOffset + PitchOrLinearSizeField), (PixelSize / 4) * (PixelSize / 4) * BlockByteCount);
+
+        size_t expectedFileSize = DataOffset;
+        for (uint16_t mipIndex = 0; mipIndex < MipCount; mipIndex++)
+        {
+            const size_t mipSize = PixelSize >> mipIndex;
+            const size_t blocksPerRow = (mipSize + 3) / 4;
+            expectedFileSize += blocksPerRow * blocksPerRow * mipSize * BlockByteCount;
+        }
+        EXPECT_EQ(fileBytes.size(), expectedFileSize);
+    }
+
+} // namespace UnitTest
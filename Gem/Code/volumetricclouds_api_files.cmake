@@ -3,4 +3,5 @@ set(FILES
     Include/VolumetricClouds/VolumetricCloudsBus.h
     Include/VolumetricClouds/VolumetricCloudsTypeIds.h
     Include/VolumetricClouds/CloudTextureProviderBus.h
+    Include/VolumetricClouds/CloudTextureStats.h
 )
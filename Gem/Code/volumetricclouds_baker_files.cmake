@@ -0,0 +1,34 @@
+# 
+# Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+# 
+# SPDX-License-Identifier: Apache-2.0 OR MIT
+# 
+
+set(FILES
+    Source/Renderer/CloudTextureMipData.h
+    Source/Renderer/CloudVolumeFile.cpp
+    Source/Renderer/CloudVolumeFile.h
+    Source/Renderer/Cpu/CloudTextureBlockCompressor.cpp
+    Source/Renderer/Cpu/CloudTextureBlockCompressor.h
+    Source/Renderer/Cpu/CloudTextureCpuBaker.cpp
+    Source/Renderer/Cpu/CloudTextureCpuBaker.h
+    Source/Renderer/Cpu/CloudTextureMipReduction.cpp
+    Source/Renderer/Cpu/CloudTextureMipReduction.h
+    Source/Renderer/Cpu/CloudTextureStatistics.cpp
+    Source/Renderer/Cpu/CloudTextureStatistics.h
+    Source/Renderer/Cpu/PerlinWorleyNoiseKernels.h
+    Source/Renderer/Cpu/WorleyFeaturePointTable.cpp
+    Source/Renderer/Cpu/WorleyFeaturePointTable.h
+    Source/Renderer/Passes/CloudTextureComputeData.cpp
+    Source/Renderer/Passes/CloudTextureComputeData.h
+    Source/Tools/Utils/ICloudTextureWriter.h
+    Source/Tools/Utils/ICloudTextureWriter.cpp
+    Source/Tools/Utils/CloudTextureWriteStatus.h
+    Source/Tools/Utils/CloudTextureWriteStatus.cpp
+    Source/Tools/Utils/DdsCloudTextureWriter.h
+    Source/Tools/Utils/DdsCloudTextureWriter.cpp
+    Source/Tools/Utils/PngCloudTextureWriter.h
+    Source/Tools/Utils/PngCloudTextureWriter.cpp
+    Source/Tools/Utils/CloudVolCloudTextureWriter.h
+    Source/Tools/Utils/CloudVolCloudTextureWriter.cpp
+)
@@ -12,10 +12,4 @@ set(FILES
     Source/Tools/Components/EditorCloudTextureAssetComponent.h
     Source/Tools/Components/EditorCloudscapeComponent.cpp
     Source/Tools/Components/EditorCloudscapeComponent.h
-    Source/Tools/Utils/ICloudTextureWriter.h
-    Source/Tools/Utils/ICloudTextureWriter.cpp
-    Source/Tools/Utils/DdsCloudTextureWriter.h
-    Source/Tools/Utils/DdsCloudTextureWriter.cpp
-    Source/Tools/Utils/PngCloudTextureWriter.h
-    Source/Tools/Utils/PngCloudTextureWriter.cpp
 )
@@ -1,4 +1,7 @@
 
 set(FILES
     Tests/Tools/VolumetricCloudsEditorTest.cpp
+    Tests/Tools/CloudTextureWriterBenchmark.cpp
+    Tests/Tools/DdsCloudTextureWriterTest.cpp
+    Tests/CloudTextureBenchmarkFixture.h
 )
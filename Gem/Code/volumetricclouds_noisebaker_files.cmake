@@ -0,0 +1,11 @@
+# 
+# Copyright (c) Galib Arrieta (aka lumbermixalot@github, aka galibzon@github).
+# 
+# SPDX-License-Identifier: Apache-2.0 OR MIT
+# 
+
+set(FILES
+    Source/Tools/NoiseBaker/CloudNoiseBaker.cpp
+    Source/Tools/NoiseBaker/CloudNoiseBaker.h
+    Source/Tools/NoiseBaker/NoiseBakerMain.cpp
+)
@@ -21,8 +21,14 @@ set(FILES
     Source/Clients/Components/CloudscapeComponent.h
     Source/Clients/Components/CloudscapeComponentController.cpp
     Source/Clients/Components/CloudscapeComponentController.h
+    Source/Renderer/CloudTextureBrickScheduler.cpp
+    Source/Renderer/CloudTextureBrickScheduler.h
     Source/Renderer/CloudTextureComputePipeline.cpp
     Source/Renderer/CloudTextureComputePipeline.h
+    Source/Renderer/CloudTextureCache.cpp
+    Source/Renderer/CloudTextureCache.h
+    Source/Renderer/CloudTextureImagePool.cpp
+    Source/Renderer/CloudTextureImagePool.h
     Source/Renderer/CloudTexturesDebugViewerFeatureProcessor.cpp
     Source/Renderer/CloudTexturesDebugViewerFeatureProcessor.h
     Source/Renderer/CloudTexturesComputeFeatureProcessor.cpp
@@ -33,14 +39,37 @@ set(FILES
     Source/Renderer/CloudscapeFeatureProcessor.h
     Source/Renderer/CloudMaterialProperties.cpp
     Source/Renderer/CloudMaterialProperties.h
+    Source/Renderer/Cpu/CloudscapeCpuRaymarcher.cpp
+    Source/Renderer/Cpu/CloudscapeCpuRaymarcher.h
+    Source/Renderer/Cpu/CloudscapeCpuTextures.cpp
+    Source/Renderer/Cpu/CloudscapeCpuTextures.h
+    Source/Renderer/Cpu/CloudscapeOpticalDepthVolume.cpp
+    Source/Renderer/Cpu/CloudscapeOpticalDepthVolume.h
+    Source/Renderer/Cpu/CloudscapeRaymarchKernels.h
+    Source/Renderer/Cpu/CloudscapeRaymarchTiles.cpp
+    Source/Renderer/Cpu/CloudscapeRaymarchTiles.h
+    Source/Renderer/Cpu/CloudscapeTemporalAccumulation.cpp
+    Source/Renderer/Cpu/CloudscapeTemporalAccumulation.h
+    Source/Renderer/Cpu/CloudscapeUpdatePattern.cpp
+    Source/Renderer/Cpu/CloudscapeUpdatePattern.h
+    Source/Renderer/Cpu/CloudscapeUpsampleFilter.cpp
+    Source/Renderer/Cpu/CloudscapeUpsampleFilter.h
+    Source/Renderer/Cpu/WeatherMapPyramid.cpp
+    Source/Renderer/Cpu/WeatherMapPyramid.h
     Source/Renderer/CloudscapeShaderConstantData.cpp
     Source/Renderer/CloudscapeShaderConstantData.h
     Source/Renderer/Passes/CloudTextureComputePass.cpp
     Source/Renderer/Passes/CloudTextureComputePass.h
-    Source/Renderer/Passes/CloudTextureComputeData.cpp
-    Source/Renderer/Passes/CloudTextureComputeData.h
+    Source/Renderer/Passes/CloudTextureMipReductionPass.cpp
+    Source/Renderer/Passes/CloudTextureMipReductionPass.h
     Source/Renderer/Passes/CloudscapeRasterPass.cpp
     Source/Renderer/Passes/CloudscapeRasterPass.h
     Source/Renderer/Passes/CloudscapeComputePass.cpp
     Source/Renderer/Passes/CloudscapeComputePass.h
+    Source/Renderer/Passes/CloudscapeOpticalDepthPass.cpp
+    Source/Renderer/Passes/CloudscapeOpticalDepthPass.h
+    Source/Renderer/Passes/CloudscapeTileClassificationPass.cpp
+    Source/Renderer/Passes/CloudscapeTileClassificationPass.h
+    Source/Renderer/Passes/DepthBufferCopyPass.cpp
+    Source/Renderer/Passes/DepthBufferCopyPass.h
 )
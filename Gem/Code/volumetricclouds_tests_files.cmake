@@ -6,4 +6,24 @@
 
 set(FILES
     Tests/Clients/VolumetricCloudsTest.cpp
+    Tests/Clients/CloudTextureMipReductionTest.cpp
+    Tests/Clients/CloudTextureCpuBakerTest.cpp
+    Tests/Clients/CloudTextureCacheTest.cpp
+    Tests/Clients/CloudTextureBrickSchedulerTest.cpp
+    Tests/Clients/CloudTextureImagePoolTest.cpp
+    Tests/Clients/CloudTextureBlockCompressorTest.cpp
+    Tests/Clients/CloudVolumeFileTest.cpp
+    Tests/Clients/WorleyFeaturePointTableTest.cpp
+    Tests/Clients/CloudTextureStatisticsTest.cpp
+    Tests/Clients/WeatherMapPyramidTest.cpp
+    Tests/Clients/CloudscapeCpuRaymarcherTest.cpp
+    Tests/Clients/CloudscapeOpticalDepthVolumeTest.cpp
+    Tests/Clients/CloudscapeUpdatePatternTest.cpp
+    Tests/Clients/CloudscapeRaymarchTilesTest.cpp
+    Tests/Clients/CloudscapeUpsampleFilterTest.cpp
+    Tests/Clients/CloudscapeTemporalAccumulationTest.cpp
+    Tests/Clients/CloudNoiseKernelsBenchmark.cpp
+    Tests/Clients/CloudVolumeFileBenchmark.cpp
+    Tests/CloudTextureBenchmarkFixture.h
+    Tests/CloudscapeTestTextures.h
 )